@@ -41,6 +41,7 @@
 #include "Utils/StringUtils.h"
 #include "Utils/Scripting/ScriptBindings.h"
 #include "Utils/Timing/Profiler.h"
+#include "Utils/Image/ImageWriteQueue.h"
 
 #if FALCOR_HAS_D3D12
 #include "Core/API/Shared/D3D12DescriptorPool.h"
@@ -606,6 +607,8 @@ Device::Device(const Desc& desc) : mDesc(desc)
     mpProfiler = std::make_unique<Profiler>(ref<Device>(this));
     mpProfiler->breakStrongReferenceToDevice();
 
+    mpImageWriteQueue = std::make_unique<ImageWriteQueue>();
+
     mpDefaultSampler = Sampler::create(ref<Device>(this), Sampler::Desc());
     mpDefaultSampler->breakStrongReferenceToDevice();
 
@@ -623,8 +626,29 @@ Device::Device(const Desc& desc) : mDesc(desc)
     this->decRef(false);
 }
 
+Device::ShaderCacheUsage Device::getShaderCacheUsage() const
+{
+    ShaderCacheUsage stats;
+    if (mDesc.shaderCachePath.empty())
+        return stats;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(mDesc.shaderCachePath, ec))
+    {
+        if (entry.is_regular_file(ec))
+        {
+            stats.fileCount++;
+            stats.size += entry.file_size(ec);
+        }
+    }
+    return stats;
+}
+
 Device::~Device()
 {
+    // Finish writing images before releasing the readback resources they hold.
+    mpImageWriteQueue.reset();
+
     mpRenderContext->flush(true);
 
     mpProfiler.reset();
@@ -861,7 +885,8 @@ void Device::endFrame()
     // Signal frame fence for new frame.
     mpFrameFence->gpuSignal(mpRenderContext->getLowLevelData()->getCommandQueue());
 
-    // Release resources from past frames.
+    // Release image write jobs that have finished and resources from past frames.
+    mpImageWriteQueue->retire();
     executeDeferredReleases();
 }
 
@@ -63,6 +63,7 @@ class PipelineCreationAPIDispatcher;
 class ProgramManager;
 class Profiler;
 class AftermathContext;
+class ImageWriteQueue;
 
 class FALCOR_API Device : public Object
 {
@@ -166,6 +167,12 @@ public:
 
     Profiler* getProfiler() const { return mpProfiler.get(); }
 
+    /**
+     * Get the queue used for writing images asynchronously (e.g. by Texture::captureToFile()).
+     * Finished jobs are retired in endFrame() and the queue is flushed when the device is destroyed.
+     */
+    ImageWriteQueue* getImageWriteQueue() const { return mpImageWriteQueue.get(); }
+
     /**
      * Get the default render-context.
      * The default render-context is managed completely by the device. The user should just queue commands into it, the device will take
@@ -206,6 +213,18 @@ public:
      */
     const Desc& getDesc() const { return mDesc; }
 
+    struct ShaderCacheUsage
+    {
+        size_t fileCount = 0; ///< Number of files in the shader cache directory.
+        uint64_t size = 0;    ///< Combined size of the files in bytes.
+    };
+
+    /**
+     * Get the on-disk size of the GFX shader cache.
+     * This scans the cache directory, so it should not be called every frame.
+     */
+    ShaderCacheUsage getShaderCacheUsage() const;
+
     /**
      * Get the device type.
      */
@@ -355,6 +374,7 @@ private:
 
     std::unique_ptr<ProgramManager> mpProgramManager;
     std::unique_ptr<Profiler> mpProfiler;
+    std::unique_ptr<ImageWriteQueue> mpImageWriteQueue;
 
     std::mutex mGlobalGfxMutex;
 };
@@ -35,7 +35,7 @@
 #include "Core/Errors.h"
 #include "Core/ObjectPython.h"
 #include "Utils/Logger.h"
-#include "Utils/Threading.h"
+#include "Utils/Image/ImageWriteQueue.h"
 #include "Utils/Math/Common.h"
 #include "Utils/Image/ImageIO.h"
 #include "Utils/Scripting/ScriptBindings.h"
@@ -51,6 +51,7 @@
 
 #include <pybind11/numpy.h>
 
+#include <array>
 #include <mutex>
 
 namespace Falcor
@@ -59,6 +60,73 @@ namespace
 {
 static constexpr bool kTopDown = true; // Memory layout when loading from file
 
+/**
+ * Save texture data as a numpy array.
+ * @param[in] shape Array shape (array slices, height, width, channels).
+ * @param[in] type Format type of the texture.
+ * @param[in] bytesPerChannel Number of bytes per channel.
+ * @param[in] data Texture data.
+ */
+void saveNumpy(const std::filesystem::path& path, const std::array<unsigned long, 4>& shape, FormatType type, uint32_t bytesPerChannel, std::vector<unsigned char>& data)
+{
+    size_t expectedDataSize = size_t(shape[0]) * size_t(shape[1]) * size_t(shape[2]) * size_t(shape[3]);
+
+    if(type == FormatType::Float)
+    {
+        // float formats
+        if (bytesPerChannel != 4) throw std::runtime_error("npy format only supports 32-bit floats");
+        assert(data.size() == expectedDataSize * sizeof(float));
+        if (data.size() != expectedDataSize * sizeof(float)) throw std::runtime_error("npy data size mismatch");
+        npy::SaveArrayAsNumpy(path.string(), false, 4, shape.data(), reinterpret_cast<float*>(data.data()));
+    }
+    else if(type == FormatType::Sint || type == FormatType::Snorm)
+    {
+        // signed integer
+        if (bytesPerChannel == 1)
+        {
+            assert(data.size() == expectedDataSize * sizeof(char));
+            if (data.size() != expectedDataSize * sizeof(char)) throw std::runtime_error("npy data size mismatch");
+            npy::SaveArrayAsNumpy(path.string(), false, 4, shape.data(), reinterpret_cast<char*>(data.data()));
+        }
+        else if (bytesPerChannel == 2)
+        {
+            assert(data.size() == expectedDataSize * sizeof(short));
+            if (data.size() != expectedDataSize * sizeof(short)) throw std::runtime_error("npy data size mismatch");
+            npy::SaveArrayAsNumpy(path.string(), false, 4, shape.data(), reinterpret_cast<short*>(data.data()));
+        }
+        else if (bytesPerChannel == 4)
+        {
+            assert(data.size() == expectedDataSize * sizeof(int));
+            if (data.size() != expectedDataSize * sizeof(int)) throw std::runtime_error("npy data size mismatch");
+            npy::SaveArrayAsNumpy(path.string(), false, 4, shape.data(), reinterpret_cast<int*>(data.data()));
+        }
+        else throw std::runtime_error("npy format only supports 8, 16, and 32-bit integers");
+    }
+    else
+    {
+        // unsigned integer
+        if (bytesPerChannel == 1)
+        {
+            assert(data.size() == expectedDataSize * sizeof(unsigned char));
+            if (data.size() != expectedDataSize * sizeof(unsigned char)) throw std::runtime_error("npy data size mismatch");
+            npy::SaveArrayAsNumpy(path.string(), false, 4, shape.data(), reinterpret_cast<unsigned char*>(data.data()));
+        }
+        else if(bytesPerChannel == 2)
+        {
+            assert(data.size() == expectedDataSize * sizeof(unsigned short));
+            if (data.size() != expectedDataSize * sizeof(unsigned short)) throw std::runtime_error("npy data size mismatch");
+            npy::SaveArrayAsNumpy(path.string(), false, 4, shape.data(), reinterpret_cast<unsigned short*>(data.data()));
+        }
+        else if(bytesPerChannel == 4)
+        {
+            assert(data.size() == expectedDataSize * sizeof(unsigned int));
+            if (data.size() != expectedDataSize * sizeof(unsigned int)) throw std::runtime_error("npy data size mismatch");
+            npy::SaveArrayAsNumpy(path.string(), false, 4, shape.data(), reinterpret_cast<unsigned int*>(data.data()));
+        }
+        else throw std::runtime_error("npy format only supports 8, 16, and 32-bit integers");
+    }
+}
+
 Texture::BindFlags updateBindFlags(
     ref<Device> pDevice,
     Texture::BindFlags flags,
@@ -523,7 +591,20 @@ void Texture::captureToFile(
 )
 {
     RenderContext* pContext = mpDevice->getRenderContext();
-    
+
+    // The texture data is read back asynchronously. Waiting for the readback and encoding the image is done by the
+    // write function, which runs on the device's image write queue in async mode. The memory estimate accounts for the
+    // readback data and the converted copy made by the encoder.
+    using ReadTaskList = std::vector<CopyContext::ReadTextureTask::SharedPtr>;
+    std::function<void()> writeFunc;
+    size_t memorySize = 0;
+
+    auto getSubresourceDataSize = [](ResourceFormat resourceFormat, uint32_t width, uint32_t height)
+    {
+        size_t rowCount = div_round_up(height, getFormatHeightCompressionRatio(resourceFormat));
+        return rowCount * div_round_up(width, getFormatWidthCompressionRatio(resourceFormat)) * getFormatBytesPerBlock(resourceFormat);
+    };
+
     if (format == Bitmap::FileFormat::DdsFile)
     {
         gli::dx dxc;
@@ -531,161 +612,129 @@ void Texture::captureToFile(
         auto gliFormat = dxc.find(gli::dx::D3DFMT_DX10, gli::dx::dxgiFormat{ gli::dx::dxgi_format_dds(dxgiFormat) });
 
         if (mType != Type::Texture2D) throw RuntimeError("Texture::captureToFile dds files must be texture 2d");
-        gli::texture2d_array gliTex = gli::texture2d_array(
-            gliFormat,
-            gli::extent2d(mWidth, mHeight),
-            mArraySize, mMipLevels);
 
-        // transfer data
+        // queue the transfer of all subresources
+        ReadTaskList readTasks;
         for (uint32_t level = 0; level < mMipLevels; ++level)
         {
-            const auto size = gliTex.size(level);
             for (uint32_t layer = 0; layer < mArraySize; ++layer)
             {
-                auto subresourceIndex = getSubresourceIndex(layer, level);
-                auto srcData = pContext->readTextureSubresource(this, subresourceIndex);
-                auto dstData = gliTex.data(layer, 0, level);
-                assert(size <= srcData.size());
-                memcpy(dstData, srcData.data(), size);
+                readTasks.push_back(pContext->asyncReadTextureSubresource(this, getSubresourceIndex(layer, level)));
+                memorySize += 2 * getSubresourceDataSize(mFormat, getWidth(level), getHeight(level));
             }
         }
 
-        gli::save_dds(gliTex, path.string());
-        return;
-    }
-
-    if (mType != Type::Texture2D)
-        throw RuntimeError("Texture::captureToFile only supported for 2D textures.");
-
-    // Handle the special case where we have an HDR texture with less then 3 channels.
-    FormatType type = getFormatType(mFormat);
-    uint32_t channels = getFormatChannelCount(mFormat);
-    uint32_t bytesPerBlock = getFormatBytesPerBlock(mFormat);
-    std::vector<uint8_t> textureData;
-    ResourceFormat resourceFormat = mFormat;
-
-    if (format == Bitmap::FileFormat::NumpyFile)
-    {
-        //bool allSlices = arraySlice == Resource::kMaxPossible;
-        bool allSlices = true;
-        unsigned long shape[] = { allSlices ? mArraySize : 1, mHeight, mWidth, channels };
-        
-        std::vector<unsigned char> data;
-
-        if(allSlices)
+        writeFunc = [=, width = mWidth, height = mHeight, arraySize = mArraySize, mipLevels = mMipLevels]()
         {
-            for (uint32_t layer = 0; layer < mArraySize; ++layer)
+            gli::texture2d_array gliTex = gli::texture2d_array(
+                gliFormat,
+                gli::extent2d(width, height),
+                arraySize, mipLevels);
+
+            // transfer data
+            size_t taskIndex = 0;
+            for (uint32_t level = 0; level < mipLevels; ++level)
             {
-                auto subresourceIndex = getSubresourceIndex(layer, mipLevel);
-                auto srcData = pContext->readTextureSubresource(this, subresourceIndex);
-                // append to data
-                data.insert(data.end(), srcData.begin(), srcData.end());
+                const auto size = gliTex.size(level);
+                for (uint32_t layer = 0; layer < arraySize; ++layer)
+                {
+                    auto srcData = readTasks[taskIndex++]->getData();
+                    auto dstData = gliTex.data(layer, 0, level);
+                    assert(size <= srcData.size());
+                    memcpy(dstData, srcData.data(), size);
+                }
             }
-        }
-        else
-        {
-            auto subresourceIndex = getSubresourceIndex(arraySlice, mipLevel);
-            data = pContext->readTextureSubresource(this, subresourceIndex);
-        }
-        
 
-        size_t expectedDataSize = size_t(shape[0]) * size_t(shape[1]) * size_t(shape[2]) * size_t(shape[3]);
-
-        uint32_t bytesPerChannel = bytesPerBlock / channels;
-        if(type == FormatType::Float)
-        {
-            // float formats
-            if (bytesPerChannel != 4) throw std::runtime_error("npy format only supports 32-bit floats");
-            assert(data.size() == expectedDataSize * sizeof(float));
-            if (data.size() != expectedDataSize * sizeof(float)) throw std::runtime_error("npy data size mismatch");
-            npy::SaveArrayAsNumpy(path.string(), false, 4, shape, reinterpret_cast<float*>(data.data()));
-        }
-        else if(type == FormatType::Sint || type == FormatType::Snorm)
+            gli::save_dds(gliTex, path.string());
+        };
+    }
+    else
+    {
+        if (format != Bitmap::FileFormat::NumpyFile && mType != Type::Texture2D)
+            throw RuntimeError("Texture::captureToFile only supported for 2D textures.");
+
+        // Handle the special case where we have an HDR texture with less then 3 channels.
+        FormatType type = getFormatType(mFormat);
+        uint32_t channels = getFormatChannelCount(mFormat);
+        uint32_t bytesPerBlock = getFormatBytesPerBlock(mFormat);
+        ResourceFormat resourceFormat = mFormat;
+        uint32_t width = getWidth(mipLevel);
+        uint32_t height = getHeight(mipLevel);
+
+        if (format == Bitmap::FileFormat::NumpyFile)
         {
-            // signed integer
-            if (bytesPerChannel == 1)
+            //bool allSlices = arraySlice == Resource::kMaxPossible;
+            bool allSlices = true;
+            std::array<unsigned long, 4> shape = { allSlices ? mArraySize : 1, mHeight, mWidth, channels };
+
+            ReadTaskList readTasks;
+            if (allSlices)
             {
-                assert(data.size() == expectedDataSize * sizeof(char));
-                if (data.size() != expectedDataSize * sizeof(char)) throw std::runtime_error("npy data size mismatch");
-                npy::SaveArrayAsNumpy(path.string(), false, 4, shape, reinterpret_cast<char*>(data.data()));
+                for (uint32_t layer = 0; layer < mArraySize; ++layer)
+                {
+                    readTasks.push_back(pContext->asyncReadTextureSubresource(this, getSubresourceIndex(layer, mipLevel)));
+                }
             }
-            else if (bytesPerChannel == 2)
+            else
             {
-                assert(data.size() == expectedDataSize * sizeof(short));
-                if (data.size() != expectedDataSize * sizeof(short)) throw std::runtime_error("npy data size mismatch");
-                npy::SaveArrayAsNumpy(path.string(), false, 4, shape, reinterpret_cast<short*>(data.data()));
+                readTasks.push_back(pContext->asyncReadTextureSubresource(this, getSubresourceIndex(arraySlice, mipLevel)));
             }
-            else if (bytesPerChannel == 4)
+            memorySize = 2 * readTasks.size() * getSubresourceDataSize(mFormat, width, height);
+
+            writeFunc = [=]()
             {
-                assert(data.size() == expectedDataSize * sizeof(int));
-                if (data.size() != expectedDataSize * sizeof(int)) throw std::runtime_error("npy data size mismatch");
-                npy::SaveArrayAsNumpy(path.string(), false, 4, shape, reinterpret_cast<int*>(data.data()));
-            }
-            else throw std::runtime_error("npy format only supports 8, 16, and 32-bit integers");
+                std::vector<unsigned char> data;
+                for (const auto& pTask : readTasks)
+                {
+                    // append to data
+                    auto srcData = pTask->getData();
+                    data.insert(data.end(), srcData.begin(), srcData.end());
+                }
+                saveNumpy(path, shape, type, bytesPerBlock / channels, data);
+            };
         }
         else
         {
-            // unsigned integer
-            if (bytesPerChannel == 1)
+            const Texture* pReadTexture = this;
+            ref<Texture> pStagingTexture;
+            if (format == Bitmap::FileFormat::BmpFile || format == Bitmap::FileFormat::JpegFile || format == Bitmap::FileFormat::PngFile || format == Bitmap::FileFormat::TgaFile)
             {
-                assert(data.size() == expectedDataSize * sizeof(unsigned char));
-                if (data.size() != expectedDataSize * sizeof(unsigned char)) throw std::runtime_error("npy data size mismatch");
-                npy::SaveArrayAsNumpy(path.string(), false, 4, shape, reinterpret_cast<unsigned char*>(data.data()));
+                // use 8 bit staging format
+                resourceFormat = ResourceFormat::BGRA8UnormSrgb;
             }
-            else if(bytesPerChannel == 2)
+            else if (type == FormatType::Float && channels < 3)
             {
-                assert(data.size() == expectedDataSize * sizeof(unsigned short));
-                if (data.size() != expectedDataSize * sizeof(unsigned short)) throw std::runtime_error("npy data size mismatch");
-                npy::SaveArrayAsNumpy(path.string(), false, 4, shape, reinterpret_cast<unsigned short*>(data.data()));
+                resourceFormat = ResourceFormat::RGBA32Float;
             }
-            else if(bytesPerChannel == 4)
+
+            uint32_t subresource = getSubresourceIndex(arraySlice, mipLevel);
+            if (resourceFormat != mFormat)
             {
-                assert(data.size() == expectedDataSize * sizeof(unsigned int));
-                if (data.size() != expectedDataSize * sizeof(unsigned int)) throw std::runtime_error("npy data size mismatch");
-                npy::SaveArrayAsNumpy(path.string(), false, 4, shape, reinterpret_cast<unsigned int*>(data.data()));
+                pStagingTexture = Texture::create2D(
+                    mpDevice, width, height, resourceFormat, 1, 1, nullptr,
+                    ResourceBindFlags::RenderTarget | ResourceBindFlags::ShaderResource
+                );
+                pContext->blit(getSRV(mipLevel, 1, arraySlice, 1), pStagingTexture->getRTV(0, 0, 1));
+                pReadTexture = pStagingTexture.get();
+                subresource = 0;
             }
-            else throw std::runtime_error("npy format only supports 8, 16, and 32-bit integers");
-        }
-        return;
-    }
 
-    if(format == Bitmap::FileFormat::BmpFile || format == Bitmap::FileFormat::JpegFile || format == Bitmap::FileFormat::PngFile || format == Bitmap::FileFormat::TgaFile)
-    {
-        // use 8 bit staging format
-        resourceFormat = ResourceFormat::BGRA8UnormSrgb;
-        ref<Texture> pOther = Texture::create2D(
-            mpDevice, getWidth(mipLevel), getHeight(mipLevel), resourceFormat, 1, 1, nullptr,
-            ResourceBindFlags::RenderTarget | ResourceBindFlags::ShaderResource
-        );
-        pContext->blit(getSRV(mipLevel, 1, arraySlice, 1), pOther->getRTV(0, 0, 1));
-        textureData = pContext->readTextureSubresource(pOther.get(), 0);
+            // The staging texture is kept alive by the deferred release of the device until the readback has finished.
+            auto pReadTask = pContext->asyncReadTextureSubresource(pReadTexture, subresource);
+            memorySize = 2 * getSubresourceDataSize(resourceFormat, width, height);
 
+            writeFunc = [=]()
+            {
+                std::vector<uint8_t> textureData = pReadTask->getData();
+                Bitmap::saveImage(path, width, height, format, exportFlags, resourceFormat, true, (void*)textureData.data());
+            };
+        }
     }
-    else if (type == FormatType::Float && channels < 3)
-    {
-        ref<Texture> pOther = Texture::create2D(
-            mpDevice, getWidth(mipLevel), getHeight(mipLevel), ResourceFormat::RGBA32Float, 1, 1, nullptr,
-            ResourceBindFlags::RenderTarget | ResourceBindFlags::ShaderResource
-        );
-        pContext->blit(getSRV(mipLevel, 1, arraySlice, 1), pOther->getRTV(0, 0, 1));
-        textureData = pContext->readTextureSubresource(pOther.get(), 0);
-        resourceFormat = ResourceFormat::RGBA32Float;
-    }
-    else
-    {
-        uint32_t subresource = getSubresourceIndex(arraySlice, mipLevel);
-        textureData = pContext->readTextureSubresource(this, subresource);
-    }
-
-    uint32_t width = getWidth(mipLevel);
-    uint32_t height = getHeight(mipLevel);
-
-    auto func = [=]() { Bitmap::saveImage(path, width, height, format, exportFlags, resourceFormat, true, (void*)textureData.data()); };
 
     if (async)
-        Threading::dispatchTask(func);
+        mpDevice->getImageWriteQueue()->enqueue(memorySize, std::move(writeFunc));
     else
-        func();
+        writeFunc();
 }
 
 void Texture::uploadInitData(RenderContext* pRenderContext, const void* pData, bool autoGenMips)
@@ -346,6 +346,8 @@ public:
      * @param[in] fileFormat Destination image file format (e.g., PNG, PFM, etc.)
      * @param[in] exportFlags Save flags, see Bitmap::ExportFlags
      * @param[in] async Save asynchronously, otherwise the function blocks until the texture is saved.
+     * In async mode the function returns once the readback is queued. The image is encoded and written by the device's image write queue,
+     * which blocks this call only if the queue's memory budget is exhausted (see Device::getImageWriteQueue()).
      */
     void captureToFile(
         uint32_t mipLevel,
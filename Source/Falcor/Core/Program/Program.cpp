@@ -194,9 +194,8 @@ Program::~Program()
 {
     mpDevice->getProgramManager()->unregisterProgramForReload(this);
 
-    // Invalidate program versions.
-    for (auto& version : mProgramVersions)
-        version.second->mpProgram = nullptr;
+    // Invalidate program versions and keep them for reuse by programs created later.
+    mpDevice->getProgramManager()->releaseProgramVersions(*this);
 }
 
 void Program::validateEntryPoints() const
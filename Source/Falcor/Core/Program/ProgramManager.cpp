@@ -29,13 +29,30 @@
 #include "Core/API/Device.h"
 #include "Core/Platform/OS.h"
 #include "Utils/Logger.h"
+#include "Utils/Threading.h"
 #include "Utils/Timing/CpuTimer.h"
 
 #include <slang.h>
 
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <typeinfo>
+
 namespace Falcor
 {
 
+namespace
+{
+Slang::ComPtr<gfx::IShaderCache> getGfxShaderCache(Device* pDevice)
+{
+    Slang::ComPtr<gfx::IShaderCache> pShaderCache;
+    if (SLANG_FAILED(pDevice->getGfxDevice()->queryInterface(SlangUUID SLANG_UUID_IShaderCache, (void**)pShaderCache.writeRef())))
+        return nullptr;
+    return pShaderCache;
+}
+} // namespace
+
 inline SlangStage getSlangStage(ShaderType type)
 {
     switch (type)
@@ -70,6 +87,24 @@ inline SlangStage getSlangStage(ShaderType type)
     }
 }
 
+/// Hash a string including its length, so that consecutive strings can't alias each other.
+inline void hashString(SHA1& sha1, std::string_view str)
+{
+    sha1.update((uint64_t)str.size());
+    sha1.update(str);
+}
+
+inline void hashTypeConformances(SHA1& sha1, const Program::TypeConformanceList& typeConformances)
+{
+    sha1.update((uint64_t)typeConformances.size());
+    for (const auto& [typeConformance, id] : typeConformances)
+    {
+        hashString(sha1, typeConformance.mTypeName);
+        hashString(sha1, typeConformance.mInterfaceName);
+        sha1.update(id);
+    }
+}
+
 inline std::string getSlangProfileString(const std::string& shaderModel)
 {
     return "sm_" + shaderModel;
@@ -102,12 +137,205 @@ inline bool doSlangReflection(
 
 ProgramManager::ProgramManager(Device* pDevice) : mpDevice(pDevice) {}
 
+ProgramManager::~ProgramManager()
+{
+    // Pooled versions may have been compiled with one of our global sessions, release them first.
+    mVersionPoolMap.clear();
+    mVersionPool.clear();
+}
+
 ref<const ProgramVersion> ProgramManager::createProgramVersion(const Program& program, std::string& log) const
+{
+    program.mFileTimeMap.clear(); // TODO @skallweit
+
+    ref<const ProgramVersion> pVersion = acquirePooledVersion(program, computeVersionPoolKey(program, program.getDefineList()));
+    if (!pVersion)
+        pVersion = compileProgramVersion(program, program.getDefineList(), mpDevice->getSlangGlobalSession(), log);
+
+    if (pVersion)
+        program.mFileTimeMap = pVersion->getFileTimeMap();
+    return pVersion;
+}
+
+size_t ProgramManager::compileProgramVersions(const std::vector<ProgramVersionRequest>& requests)
 {
     CpuTimer timer;
     timer.update();
 
-    auto pSlangRequest = createSlangCompileRequest(program);
+    // Skip versions that are already in the program's cache or in the version pool.
+    std::vector<const ProgramVersionRequest*> pendingRequests;
+    std::set<std::pair<const Program*, DefineList>> pendingKeys;
+    for (const auto& request : requests)
+    {
+        FALCOR_CHECK_ARG(request.pProgram);
+        const Program& program = *request.pProgram;
+        if (program.mProgramVersions.count(Program::ProgramVersionKey{request.defineList, program.mTypeConformanceList}) != 0)
+            continue;
+        if (!pendingKeys.emplace(&program, request.defineList).second)
+            continue;
+        if (auto pVersion = acquirePooledVersion(program, computeVersionPoolKey(program, request.defineList)))
+        {
+            program.mProgramVersions[Program::ProgramVersionKey{request.defineList, program.mTypeConformanceList}] = pVersion;
+            program.mFileTimeMap.insert(pVersion->getFileTimeMap().begin(), pVersion->getFileTimeMap().end());
+            continue;
+        }
+        pendingRequests.push_back(&request);
+    }
+
+    if (pendingRequests.empty())
+        return 0;
+
+    // Slang global sessions are not thread-safe, each thread needs its own.
+    // The thread pool runs the loop serially if it is not started, in which case the device's session is sufficient.
+    // Versions compiled in the extra sessions can be used like the ones from the device's session: the device creates
+    // its session with the same default settings, the compile request is set up from the program desc alone (see
+    // createSlangCompileRequest()) and the kernels are later created through the version's own linked component types.
+    // The extra sessions are owned by the program manager, which releases its pooled versions first. Apart from this function,
+    // which returns once all threads are done, they are only used when creating kernels on the calling thread.
+    size_t threadCount = Threading::isStarted() ? std::min<size_t>(Threading::getThreadCount() + 1, kMaxCompileThreadCount) : 1;
+    threadCount = std::min(threadCount, pendingRequests.size());
+    while (mCompileSlangGlobalSessions.size() + 1 < threadCount)
+    {
+        Slang::ComPtr<slang::IGlobalSession> pSlangGlobalSession;
+        if (SLANG_FAILED(slang::createGlobalSession(pSlangGlobalSession.writeRef())))
+            break;
+        mCompileSlangGlobalSessions.push_back(pSlangGlobalSession);
+    }
+    threadCount = std::min(threadCount, mCompileSlangGlobalSessions.size() + 1);
+
+    struct Result
+    {
+        ref<ProgramVersion> pVersion;
+        std::string log;
+    };
+    std::vector<Result> results(pendingRequests.size());
+    std::atomic<size_t> nextRequest{0};
+
+    // Each loop iteration is a thread pulling requests until all are compiled, so that a global session
+    // is never used by two threads at the same time.
+    Threading::parallelFor(
+        0, threadCount,
+        [&](size_t threadIndex)
+        {
+            slang::IGlobalSession* pSlangGlobalSession =
+                threadIndex == 0 ? mpDevice->getSlangGlobalSession() : mCompileSlangGlobalSessions[threadIndex - 1].get();
+            for (size_t i = nextRequest++; i < pendingRequests.size(); i = nextRequest++)
+            {
+                const auto& request = *pendingRequests[i];
+                auto& result = results[i];
+                try
+                {
+                    result.pVersion = compileProgramVersion(*request.pProgram, request.defineList, pSlangGlobalSession, result.log);
+                }
+                catch (const std::exception& e)
+                {
+                    result.pVersion = nullptr;
+                    result.log += e.what();
+                }
+            }
+        },
+        1
+    );
+
+    size_t compiledCount = 0;
+    for (size_t i = 0; i < pendingRequests.size(); ++i)
+    {
+        const auto& request = *pendingRequests[i];
+        const Program& program = *request.pProgram;
+        const auto& result = results[i];
+        if (!result.pVersion)
+        {
+            logWarning("Failed to compile program version:\n{}\n\n{}", program.getProgramDescString(), result.log);
+            continue;
+        }
+        if (!result.log.empty())
+            logWarning("Warnings in program:\n{}\n{}", program.getProgramDescString(), result.log);
+
+        program.mProgramVersions[Program::ProgramVersionKey{request.defineList, program.mTypeConformanceList}] = result.pVersion;
+        program.mFileTimeMap.insert(result.pVersion->getFileTimeMap().begin(), result.pVersion->getFileTimeMap().end());
+        compiledCount++;
+    }
+
+    timer.update();
+    logInfo("Compiled {} program versions in {:.3f} s using {} threads.", compiledCount, timer.delta(), threadCount);
+
+    return compiledCount;
+}
+
+void ProgramManager::releaseProgramVersions(const Program& program)
+{
+    std::lock_guard<std::mutex> lock(mVersionPoolMutex);
+    for (const auto& [versionKey, pVersion] : program.mProgramVersions)
+    {
+        pVersion->mpProgram = nullptr;
+        if (mVersionPoolSize == 0)
+            continue;
+
+        const SHA1::MD& key = pVersion->mVersionPoolKey;
+        if (auto it = mVersionPoolMap.find(key); it != mVersionPoolMap.end())
+            mVersionPool.erase(it->second);
+        mVersionPool.emplace_front(key, pVersion);
+        mVersionPoolMap[key] = mVersionPool.begin();
+    }
+
+    while (mVersionPool.size() > mVersionPoolSize)
+    {
+        mVersionPoolMap.erase(mVersionPool.back().first);
+        mVersionPool.pop_back();
+    }
+}
+
+void ProgramManager::setVersionPoolSize(size_t size)
+{
+    std::lock_guard<std::mutex> lock(mVersionPoolMutex);
+    mVersionPoolSize = size;
+    while (mVersionPool.size() > mVersionPoolSize)
+    {
+        mVersionPoolMap.erase(mVersionPool.back().first);
+        mVersionPool.pop_back();
+    }
+}
+
+ref<const ProgramVersion> ProgramManager::acquirePooledVersion(const Program& program, const SHA1::MD& key) const
+{
+    std::lock_guard<std::mutex> lock(mVersionPoolMutex);
+    auto it = mVersionPoolMap.find(key);
+    if (it == mVersionPoolMap.end())
+        return nullptr;
+
+    ref<const ProgramVersion> pVersion = it->second->second;
+    mVersionPool.erase(it->second);
+    mVersionPoolMap.erase(it);
+
+    // Versions are only shared between programs once their previous program is gone.
+    // Versions compiled from files that have changed since are dropped.
+    FALCOR_ASSERT(pVersion->mpProgram == nullptr);
+    for (const auto& [path, modifiedTime] : pVersion->getFileTimeMap())
+    {
+        if (getFileModifiedTime(path) != modifiedTime)
+            return nullptr;
+    }
+
+    pVersion->mpProgram = const_cast<Program*>(&program);
+    {
+        std::lock_guard<std::mutex> statsLock(mCompilationStatsMutex);
+        mCompilationStats.versionPoolHitCount++;
+    }
+    logDebug("Reused pooled program version: {}", pVersion->getName());
+    return pVersion;
+}
+
+ref<ProgramVersion> ProgramManager::compileProgramVersion(
+    const Program& program,
+    const DefineList& defineList,
+    slang::IGlobalSession* pSlangGlobalSession,
+    std::string& log
+) const
+{
+    CpuTimer timer;
+    timer.update();
+
+    auto pSlangRequest = createSlangCompileRequest(program, defineList, pSlangGlobalSession);
     if (pSlangRequest == nullptr)
         return nullptr;
 
@@ -149,12 +377,13 @@ ref<const ProgramVersion> ProgramManager::createProgramVersion(const Program& pr
     }
 
     // Extract list of files referenced, for dependency-tracking purposes.
+    FileTimeMap fileTimeMap;
     int depFileCount = spGetDependencyFileCount(pSlangRequest);
     for (int ii = 0; ii < depFileCount; ++ii)
     {
         std::string depFilePath = spGetDependencyFilePath(pSlangRequest, ii);
         if (std::filesystem::exists(depFilePath))
-            program.mFileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
+            fileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
     }
 
     // Note: the `ProgramReflection` needs to be able to refer back to the
@@ -190,13 +419,13 @@ ref<const ProgramVersion> ProgramManager::createProgramVersion(const Program& pr
     }
 
     auto descStr = program.getProgramDescString();
-    pVersion->init(program.getDefineList(), pReflector, descStr, pSlangEntryPoints);
+    pVersion->init(defineList, pReflector, descStr, pSlangEntryPoints);
+    pVersion->mFileTimeMap = std::move(fileTimeMap);
+    pVersion->mVersionPoolKey = computeVersionPoolKey(program, defineList);
 
     timer.update();
     double time = timer.delta();
-    mCompilationStats.programVersionCount++;
-    mCompilationStats.programVersionTotalTime += time;
-    mCompilationStats.programVersionMaxTime = std::max(mCompilationStats.programVersionMaxTime, time);
+    updateVersionStats(time);
     logDebug("Created program version in {:.3f} s: {}", timer.delta(), descStr);
 
     return pVersion;
@@ -476,9 +705,12 @@ ref<const ProgramKernels> ProgramManager::createProgramKernels(
 
     timer.update();
     double time = timer.delta();
-    mCompilationStats.programKernelsCount++;
-    mCompilationStats.programKernelsTotalTime += time;
-    mCompilationStats.programKernelsMaxTime = std::max(mCompilationStats.programKernelsMaxTime, time);
+    {
+        std::lock_guard<std::mutex> lock(mCompilationStatsMutex);
+        mCompilationStats.programKernelsCount++;
+        mCompilationStats.programKernelsTotalTime += time;
+        mCompilationStats.programKernelsMaxTime = std::max(mCompilationStats.programKernelsMaxTime, time);
+    }
     logDebug("Created program kernels in {:.3f} s: {}", time, descStr);
 
     return pProgramKernels;
@@ -524,6 +756,108 @@ ref<const EntryPointGroupKernels> ProgramManager::createEntryPointGroupKernels(
     return nullptr;
 }
 
+void ProgramManager::updateVersionStats(double time) const
+{
+    std::lock_guard<std::mutex> lock(mCompilationStatsMutex);
+    mCompilationStats.programVersionCount++;
+    mCompilationStats.programVersionTotalTime += time;
+    mCompilationStats.programVersionMaxTime = std::max(mCompilationStats.programVersionMaxTime, time);
+}
+
+const ProgramManager::CompilationStats& ProgramManager::getCompilationStats()
+{
+    std::lock_guard<std::mutex> lock(mCompilationStatsMutex);
+    if (auto pShaderCache = getGfxShaderCache(mpDevice))
+    {
+        gfx::ShaderCacheStats cacheStats = {};
+        if (SLANG_SUCCEEDED(pShaderCache->getShaderCacheStats(&cacheStats)))
+        {
+            mCompilationStats.shaderCacheHitCount = cacheStats.hitCount;
+            mCompilationStats.shaderCacheMissCount = cacheStats.missCount;
+            mCompilationStats.shaderCacheEntryCount = cacheStats.entryCount;
+        }
+    }
+    return mCompilationStats;
+}
+
+void ProgramManager::resetCompilationStats()
+{
+    std::lock_guard<std::mutex> lock(mCompilationStatsMutex);
+    mCompilationStats = {};
+    if (auto pShaderCache = getGfxShaderCache(mpDevice))
+        pShaderCache->resetShaderCacheStats();
+}
+
+void ProgramManager::hashProgramInputs(SHA1& sha1, const Program& program, const DefineList& defineList) const
+{
+    hashString(sha1, spGetBuildTagString());
+
+    // Target and compiler options. These mirror the options set in createSlangCompileRequest().
+    Program::CompilerFlags compilerFlags = program.mDesc.getCompilerFlags();
+    compilerFlags &= ~mForcedCompilerFlags.disabled;
+    compilerFlags |= mForcedCompilerFlags.enabled;
+    sha1.update((uint32_t)mpDevice->getType());
+    hashString(sha1, program.mDesc.mShaderModel);
+    sha1.update((uint32_t)compilerFlags);
+    sha1.update((uint32_t)program.mDesc.getCompilerFlags());
+    sha1.update(mGenerateDebugInfo);
+    sha1.update((bool)FALCOR_NVAPI_AVAILABLE);
+    hashString(sha1, program.mDesc.mLanguagePrelude);
+    sha1.update((uint64_t)program.mDesc.mCompilerArguments.size());
+    for (const auto& arg : program.mDesc.mCompilerArguments)
+        hashString(sha1, arg);
+
+    // Global followed by program specific defines, in the order they are passed to Slang.
+    sha1.update((uint64_t)mGlobalDefineList.size());
+    for (const auto& [name, value] : mGlobalDefineList)
+    {
+        hashString(sha1, name);
+        hashString(sha1, value);
+    }
+    sha1.update((uint64_t)defineList.size());
+    for (const auto& [name, value] : defineList)
+    {
+        hashString(sha1, name);
+        hashString(sha1, value);
+    }
+
+    // Sources. File contents are not hashed, versions compiled from changed files are detected through their modification times.
+    sha1.update((uint64_t)program.mDesc.mSources.size());
+    for (const auto& src : program.mDesc.mSources)
+    {
+        sha1.update(src.source.createTranslationUnit);
+        if (src.getType() == Program::ShaderModule::Type::File)
+        {
+            hashString(sha1, src.source.filePath.generic_string());
+        }
+        else
+        {
+            hashString(sha1, src.source.moduleName);
+            hashString(sha1, src.source.str);
+        }
+    }
+
+    sha1.update((uint64_t)program.mDesc.mEntryPoints.size());
+    for (const auto& entryPoint : program.mDesc.mEntryPoints)
+    {
+        hashString(sha1, entryPoint.name);
+        hashString(sha1, entryPoint.exportName);
+        sha1.update((uint32_t)entryPoint.stage);
+        sha1.update(entryPoint.sourceIndex);
+        sha1.update(entryPoint.groupIndex);
+    }
+}
+
+SHA1::MD ProgramManager::computeVersionPoolKey(const Program& program, const DefineList& defineList) const
+{
+    SHA1 sha1;
+    hashProgramInputs(sha1, program, defineList);
+    // Versions hold reflection and kernels that depend on the program type and its type conformances.
+    hashString(sha1, typeid(program).name());
+    hashTypeConformances(sha1, program.mTypeConformanceList);
+    return sha1.finalize();
+}
+
 void ProgramManager::registerProgramForReload(Program* program)
 {
     mLoadedPrograms.push_back(program);
@@ -547,6 +881,14 @@ bool ProgramManager::reloadAllPrograms(bool forceReload)
         }
     }
 
+    // Pooled versions with changed files are dropped when they are looked up, but a forced reload invalidates them all.
+    if (forceReload)
+    {
+        std::lock_guard<std::mutex> lock(mVersionPoolMutex);
+        mVersionPoolMap.clear();
+        mVersionPool.clear();
+    }
+
     return hasReloaded;
 }
 
@@ -583,9 +925,12 @@ ProgramManager::ForcedCompilerFlags ProgramManager::getForcedCompilerFlags()
     return mForcedCompilerFlags;
 }
 
-SlangCompileRequest* ProgramManager::createSlangCompileRequest(const Program& program) const
+SlangCompileRequest* ProgramManager::createSlangCompileRequest(
+    const Program& program,
+    const DefineList& defineList,
+    slang::IGlobalSession* pSlangGlobalSession
+) const
 {
-    slang::IGlobalSession* pSlangGlobalSession = mpDevice->getSlangGlobalSession();
     FALCOR_ASSERT(pSlangGlobalSession);
 
     slang::SessionDesc sessionDesc;
@@ -666,7 +1011,7 @@ SlangCompileRequest* ProgramManager::createSlangCompileRequest(const Program& pr
     // Add global followed by program specific defines.
     for (const auto& shaderDefine : mGlobalDefineList)
         addSlangDefine(shaderDefine.first.c_str(), shaderDefine.second.c_str());
-    for (const auto& shaderDefine : program.getDefineList())
+    for (const auto& shaderDefine : defineList)
         addSlangDefine(shaderDefine.first.c_str(), shaderDefine.second.c_str());
 
     // Add a `#define`s based on the target and shader model.
@@ -692,8 +1037,6 @@ SlangCompileRequest* ProgramManager::createSlangCompileRequest(const Program& pr
     pSlangGlobalSession->createSession(sessionDesc, pSlangSession.writeRef());
     FALCOR_ASSERT(pSlangSession);
 
-    program.mFileTimeMap.clear(); // TODO @skallweit
-
     if (!program.mDesc.mLanguagePrelude.empty())
     {
         if (targetDesc.format == SLANG_DXIL)
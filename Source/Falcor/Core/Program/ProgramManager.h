@@ -29,8 +29,16 @@
 #include "Program.h"
 #include "Core/Macros.h"
 #include "Core/API/fwd.h"
+#include "Utils/CryptoUtils.h"
 
+#include <ctime>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace Falcor
 {
@@ -38,7 +46,14 @@ namespace Falcor
 class FALCOR_API ProgramManager
 {
 public:
+    /// Default maximum number of program versions kept after their programs have been destroyed.
+    static constexpr size_t kDefaultVersionPoolSize = 64;
+
+    /// Maximum number of Slang global sessions used for compiling program versions in parallel.
+    static constexpr size_t kMaxCompileThreadCount = 8;
+
     ProgramManager(Device* pDevice);
+    ~ProgramManager();
 
     /**
      * Defines flags that should be forcefully disabled or enabled on all shaders.
@@ -58,6 +73,19 @@ public:
         double programKernelsMaxTime = 0.0;
         double programVersionTotalTime = 0.0;
         double programKernelsTotalTime = 0.0;
+        size_t versionPoolHitCount = 0;
+        size_t shaderCacheHitCount = 0;   ///< Number of kernels loaded from the GFX shader cache.
+        size_t shaderCacheMissCount = 0;  ///< Number of kernels compiled because they were not in the GFX shader cache.
+        size_t shaderCacheEntryCount = 0; ///< Number of entries in the GFX shader cache.
+    };
+
+    /**
+     * Request for compiling a program version with compileProgramVersions().
+     */
+    struct ProgramVersionRequest
+    {
+        ref<Program> pProgram; ///< Program to compile a version of.
+        DefineList defineList; ///< Program defines of the version. Replaces the defines the program currently uses.
     };
 
     Program::Desc applyForcedCompilerFlags(Program::Desc desc) const;
@@ -66,6 +94,37 @@ public:
 
     ref<const ProgramVersion> createProgramVersion(const Program& program, std::string& log) const;
 
+    /**
+     * Compile a batch of program versions in parallel.
+     * Each thread compiles with its own Slang global session, as global sessions can't be used concurrently.
+     * The versions are added to the version cache of their program, so switching a program to one of the requested
+     * define lists later doesn't compile anymore. Requests for versions that are already available are skipped,
+     * versions that fail to compile are reported as warnings.
+     * This must be called from the thread that uses the device.
+     * @param[in] requests List of program versions to compile.
+     * @return Number of versions that were compiled.
+     */
+    size_t compileProgramVersions(const std::vector<ProgramVersionRequest>& requests);
+
+    /**
+     * Move the versions of a program that is being destroyed to the version pool.
+     * Pooled versions are reused by programs created later with the same desc, defines and type conformances,
+     * as long as none of their source files have changed.
+     * @param[in] program The program being destroyed.
+     */
+    void releaseProgramVersions(const Program& program);
+
+    /**
+     * Set the maximum number of versions kept in the version pool. Least recently used versions are evicted first.
+     * @param[in] size Maximum number of versions. Zero disables the pool.
+     */
+    void setVersionPoolSize(size_t size);
+
+    /**
+     * Get the maximum number of versions kept in the version pool.
+     */
+    size_t getVersionPoolSize() const { return mVersionPoolSize; }
+
     ref<const ProgramKernels> createProgramKernels(
         const Program& program,
         const ProgramVersion& programVersion,
@@ -123,22 +182,73 @@ public:
      */
     ForcedCompilerFlags getForcedCompilerFlags();
 
-    const CompilationStats& getCompilationStats() { return mCompilationStats; }
-    void resetCompilationStats() { mCompilationStats = {}; }
+    /**
+     * Get the compilation stats. The shader cache counters are queried from GFX, they stay zero if GFX doesn't report them.
+     */
+    const CompilationStats& getCompilationStats();
+    void resetCompilationStats();
 
 private:
-    SlangCompileRequest* createSlangCompileRequest(const Program& program) const;
+    using FileTimeMap = std::unordered_map<std::string, time_t>;
+
+    /**
+     * Compile a program version. This doesn't modify the program and can be called concurrently,
+     * as long as each thread uses a different Slang global session.
+     */
+    ref<ProgramVersion> compileProgramVersion(
+        const Program& program,
+        const DefineList& defineList,
+        slang::IGlobalSession* pSlangGlobalSession,
+        std::string& log
+    ) const;
+
+    SlangCompileRequest* createSlangCompileRequest(
+        const Program& program,
+        const DefineList& defineList,
+        slang::IGlobalSession* pSlangGlobalSession
+    ) const;
+
+    /**
+     * Hash the inputs to the compilation of a program version that are known before compiling.
+     * This covers the Slang version, target, compiler flags and arguments, all defines, the sources and the entry points.
+     */
+    void hashProgramInputs(SHA1& sha1, const Program& program, const DefineList& defineList) const;
+
+    /**
+     * Compute the key identifying a program version in the version pool.
+     * In addition to the program inputs this covers the program type and its type conformances.
+     */
+    SHA1::MD computeVersionPoolKey(const Program& program, const DefineList& defineList) const;
+
+    /**
+     * Take a version out of the version pool and attach it to a program.
+     * @return The version, or nullptr if there is no valid version for the key.
+     */
+    ref<const ProgramVersion> acquirePooledVersion(const Program& program, const SHA1::MD& key) const;
+
+    void updateVersionStats(double time) const;
 
     Device* mpDevice;
 
     std::vector<Program*> mLoadedPrograms;
     mutable CompilationStats mCompilationStats;
+    mutable std::mutex mCompilationStatsMutex;
 
     DefineList mGlobalDefineList;
     bool mGenerateDebugInfo = false;
     ForcedCompilerFlags mForcedCompilerFlags;
 
     mutable uint32_t mHitGroupID = 0;
+
+    /// Additional Slang global sessions for compiling in parallel. The device's global session is used by the first thread.
+    std::vector<Slang::ComPtr<slang::IGlobalSession>> mCompileSlangGlobalSessions;
+
+    /// Versions of destroyed programs in least recently used order, front is the most recently used.
+    using VersionPoolList = std::list<std::pair<SHA1::MD, ref<const ProgramVersion>>>;
+    mutable VersionPoolList mVersionPool;
+    mutable std::map<SHA1::MD, VersionPoolList::iterator> mVersionPoolMap;
+    mutable std::mutex mVersionPoolMutex;
+    size_t mVersionPoolSize = kDefaultVersionPoolSize;
 };
 
 } // namespace Falcor
@@ -40,6 +40,28 @@
 namespace Falcor
 {
 
+//
+// EntryPointKernel
+//
+
+EntryPointKernel::BlobData EntryPointKernel::getBlobData() const
+{
+    std::lock_guard<std::mutex> lock(mBlobMutex);
+    if (!mpBlob)
+    {
+        Slang::ComPtr<ISlangBlob> pDiagnostics;
+        if (SLANG_FAILED(mLinkedSlangEntryPoint->getEntryPointCode(0, 0, mpBlob.writeRef(), pDiagnostics.writeRef())))
+        {
+            throw RuntimeError(std::string("Shader compilation failed. \n") + (const char*)pDiagnostics->getBufferPointer());
+        }
+    }
+
+    BlobData result;
+    result.data = mpBlob->getBufferPointer();
+    result.size = mpBlob->getBufferSize();
+    return result;
+}
+
 //
 // EntryPointGroupKernels
 //
@@ -33,7 +33,10 @@
 #include "Core/API/fwd.h"
 #include "Core/API/ShaderType.h"
 #include "Core/API/Handles.h"
+#include "Utils/CryptoUtils.h"
+#include <ctime>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -94,22 +97,10 @@ public:
      */
     const std::string& getEntryPointName() const { return mEntryPointName; }
 
-    BlobData getBlobData() const
-    {
-        if (!mpBlob)
-        {
-            Slang::ComPtr<ISlangBlob> pDiagnostics;
-            if (SLANG_FAILED(mLinkedSlangEntryPoint->getEntryPointCode(0, 0, mpBlob.writeRef(), pDiagnostics.writeRef())))
-            {
-                throw RuntimeError(std::string("Shader compilation failed. \n") + (const char*)pDiagnostics->getBufferPointer());
-            }
-        }
-
-        BlobData result;
-        result.data = mpBlob->getBufferPointer();
-        result.size = mpBlob->getBufferSize();
-        return result;
-    }
+    /**
+     * Get the kernel code. The code is generated on the first call. Can be called from multiple threads.
+     */
+    BlobData getBlobData() const;
 
 protected:
     EntryPointKernel(Slang::ComPtr<slang::IComponentType> linkedSlangEntryPoint, ShaderType type, const std::string& entryPointName)
@@ -119,6 +110,7 @@ protected:
     Slang::ComPtr<slang::IComponentType> mLinkedSlangEntryPoint;
     ShaderType mType;
     std::string mEntryPointName;
+    mutable std::mutex mBlobMutex;
     mutable Slang::ComPtr<ISlangBlob> mpBlob;
 };
 
@@ -276,6 +268,11 @@ public:
     // TODO @skallweit passing pDevice here is a bit of a WAR
     ref<const ProgramKernels> getKernels(Device* pDevice, ProgramVars const* pVars) const;
 
+    /**
+     * Get the source files this version depends on, along with their modification time at compilation.
+     */
+    const std::unordered_map<std::string, time_t>& getFileTimeMap() const { return mFileTimeMap; }
+
     slang::ISession* getSlangSession() const;
     slang::IComponentType* getSlangGlobalScope() const;
     slang::IComponentType* getSlangEntryPoint(uint32_t index) const;
@@ -302,6 +299,8 @@ protected:
     std::string mName;
     Slang::ComPtr<slang::IComponentType> mpSlangGlobalScope;
     std::vector<Slang::ComPtr<slang::IComponentType>> mpSlangEntryPoints;
+    std::unordered_map<std::string, time_t> mFileTimeMap;
+    SHA1::MD mVersionPoolKey{};
 
     // Cached version of compiled kernels for this program version
     mutable std::unordered_map<std::string, ref<const ProgramKernels>> mpKernels;
@@ -94,6 +94,7 @@ void RenderGraph::setScene(const ref<Scene>& pScene)
     for (auto& it : mNodeData)
     {
         it.second.pPass->setScene(mpDevice->getRenderContext(), pScene);
+        mDirtyPasses.insert(it.second.name);
     }
     mRecompile = true;
 }
@@ -114,7 +115,7 @@ uint32_t RenderGraph::addPass(const ref<RenderPass>& pPass, const std::string& p
     uint32_t passIndex = mpGraph->addNode();
     mNameToIndex[passName] = passIndex;
 
-    pPass->mPassChangedCB = [this]() { mRecompile = true; };
+    setPassChangedCallback(pPass.get(), passName);
     pPass->mName = passName;
 
     if (mpScene)
@@ -162,7 +163,7 @@ void RenderGraph::updatePass(const std::string& passName, const Properties& prop
     std::string passTypeName = pOldPass->getType();
     auto pPass = RenderPass::create(passTypeName, mpDevice, props);
     pPassIt->second.pPass = pPass;
-    pPass->mPassChangedCB = [this]() { mRecompile = true; };
+    setPassChangedCallback(pPass.get(), pOldPass->getName());
     pPass->mName = pOldPass->getName();
 
     if (mpScene)
@@ -402,12 +403,15 @@ bool RenderGraph::compile(RenderContext* pRenderContext, std::string& log)
 {
     if (!mRecompile)
         return true;
-    mpExe = nullptr;
+
+    // Keep the previous executable alive during compilation so the compiler can reuse its passes and resources
+    std::unique_ptr<RenderGraphExe> pPreviousExe = std::move(mpExe);
 
     try
     {
-        mpExe = RenderGraphCompiler::compile(*this, pRenderContext, mCompilerDeps);
+        mpExe = RenderGraphCompiler::compile(*this, pRenderContext, mCompilerDeps, pPreviousExe.get());
         mRecompile = false;
+        mDirtyPasses.clear();
         return true;
     }
     catch (const std::exception& e)
@@ -417,6 +421,12 @@ bool RenderGraph::compile(RenderContext* pRenderContext, std::string& log)
     }
 }
 
+const RenderGraphExe::CompileStats& RenderGraph::getCompileStats() const
+{
+    static const RenderGraphExe::CompileStats kEmptyStats;
+    return mpExe ? mpExe->getCompileStats() : kEmptyStats;
+}
+
 void RenderGraph::execute(RenderContext* pRenderContext)
 {
     std::string log;
@@ -629,13 +639,30 @@ void RenderGraph::onResize(const Fbo* pTargetFbo)
         throw RuntimeError("Can't resize render graph without a frame buffer.");
 
     // Store the values
-    mCompilerDeps.defaultResourceProps.format = pColor->getFormat();
-    mCompilerDeps.defaultResourceProps.dims = {pTargetFbo->getWidth(), pTargetFbo->getHeight()};
+    ResourceFormat format = pColor->getFormat();
+    uint2 dims = {pTargetFbo->getWidth(), pTargetFbo->getHeight()};
+
+    // A new size or format affects most passes and resources. Release the previous executable now, so that the old and new resources
+    // don't have to be alive at the same time during recompilation.
+    if (any(dims != mCompilerDeps.defaultResourceProps.dims) || format != mCompilerDeps.defaultResourceProps.format)
+        mpExe = nullptr;
+
+    mCompilerDeps.defaultResourceProps.format = format;
+    mCompilerDeps.defaultResourceProps.dims = dims;
 
     // Invalidate the graph. Render passes might change their reflection based on the resize information
     mRecompile = true;
 }
 
+void RenderGraph::setPassChangedCallback(RenderPass* pPass, const std::string& passName)
+{
+    pPass->mPassChangedCB = [this, passName]()
+    {
+        mDirtyPasses.insert(passName);
+        mRecompile = true;
+    };
+}
+
 bool canFieldsConnect(const RenderPassReflection::Field& src, const RenderPassReflection::Field& dst)
 {
     FALCOR_ASSERT(
@@ -297,6 +297,8 @@ public:
 
     /**
      * Compile the graph.
+     * Recompilation is incremental: only passes that requested a recompile or whose connected resources changed are compiled again,
+     * and resources with unchanged properties are reused.
      */
     bool compile(RenderContext* pRenderContext, std::string& log);
     bool compile(RenderContext* pRenderContext)
@@ -305,6 +307,11 @@ public:
         return compile(pRenderContext, s);
     }
 
+    /**
+     * Get the statistics of the last successful compilation, including which passes were compiled.
+     */
+    const RenderGraphExe::CompileStats& getCompileStats() const;
+
 private:
     struct EdgeData
     {
@@ -357,6 +364,8 @@ private:
 
     bool isGraphOutput(const GraphOut& graphOut) const;
 
+    void setPassChangedCallback(RenderPass* pPass, const std::string& passName);
+
     ref<Device> mpDevice;
 
     std::string mName;  ///< Name of render graph.
@@ -372,6 +381,7 @@ private:
     std::unique_ptr<RenderGraphExe> mpExe;           ///< Helper for allocating resources and executing the graph.
     RenderGraphCompiler::Dependencies mCompilerDeps; ///< Data needed by the graph compiler.
     bool mRecompile = false; ///< Set to true to trigger a recompilation after any graph changes (topology/scene/size/passes/etc.)
+    std::unordered_set<std::string> mDirtyPasses; ///< Passes that requested a recompile since the last compilation.
 
     friend class RenderGraphUI;
     friend class RenderGraphExporter;
@@ -30,6 +30,8 @@
 #include "RenderPasses/ResolvePass.h"
 #include "Utils/Algorithm/DirectedGraphTraversal.h"
 #include "Utils/StringUtils.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuTimer.h"
 
 namespace Falcor
 {
@@ -39,6 +41,12 @@ bool canAutoResolve(const RenderPassReflection::Field& src, const RenderPassRefl
 {
     return src.getSampleCount() > 1 && dst.getSampleCount() == 1;
 }
+
+bool isSameCompileData(const RenderPass::CompileData& a, const RenderPass::CompileData& b)
+{
+    return all(a.defaultTexDims == b.defaultTexDims) && a.defaultTexFormat == b.defaultTexFormat &&
+           a.connectedResources == b.connectedResources;
+}
 } // namespace
 
 RenderGraphCompiler::RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies)
@@ -48,11 +56,25 @@ RenderGraphCompiler::RenderGraphCompiler(RenderGraph& graph, const Dependencies&
 std::unique_ptr<RenderGraphExe> RenderGraphCompiler::compile(
     RenderGraph& graph,
     RenderContext* pRenderContext,
-    const Dependencies& dependencies
+    const Dependencies& dependencies,
+    const RenderGraphExe* pPreviousExe
 )
 {
+    CpuTimer timer;
+    timer.update();
+
     RenderGraphCompiler c = RenderGraphCompiler(graph, dependencies);
 
+    // Start from the passes compiled by the previous compilation, except for the ones that requested a recompile
+    if (pPreviousExe)
+    {
+        for (const auto& [name, compiledPass] : pPreviousExe->mCompiledPasses)
+        {
+            if (graph.mDirtyPasses.count(name) == 0)
+                c.mCompiledPasses.emplace(name, compiledPass);
+        }
+    }
+
     // Register the external resources
     auto pResourcesCache = std::make_unique<ResourceCache>();
     for (const auto& [name, pRes] : dependencies.externalResources)
@@ -60,10 +82,22 @@ std::unique_ptr<RenderGraphExe> RenderGraphCompiler::compile(
 
     c.resolveExecutionOrder();
     c.compilePasses(pRenderContext);
+
+    RenderGraphExe::CompileStats stats;
+    for (const auto& p : c.mExecutionList)
+    {
+        if (c.mRecompiledPasses.count(p.name) != 0)
+            stats.compiledPasses.push_back(p.name);
+        else
+            stats.reusedPasses.push_back(p.name);
+    }
+
     if (c.insertAutoPasses())
         c.resolveExecutionOrder();
     c.validateGraph();
-    c.allocateResources(pRenderContext->getDevice(), pResourcesCache.get());
+    c.allocateResources(
+        pRenderContext->getDevice(), pResourcesCache.get(), pPreviousExe ? pPreviousExe->mpResourceCache.get() : nullptr
+    );
 
     auto pExe = std::make_unique<RenderGraphExe>();
     pExe->mExecutionList.reserve(c.mExecutionList.size());
@@ -71,9 +105,29 @@ std::unique_ptr<RenderGraphExe> RenderGraphCompiler::compile(
     for (auto e : c.mExecutionList)
     {
         pExe->insertPass(e.name, e.pPass);
+
+        // Only keep the compile data of passes that are still part of the graph
+        auto it = c.mCompiledPasses.find(e.name);
+        if (it != c.mCompiledPasses.end() && it->second.pPass == e.pPass)
+            pExe->mCompiledPasses.emplace(e.name, std::move(it->second));
     }
     c.restoreCompilationChanges();
+
+    stats.resourceCount = pResourcesCache->getAllocationStats().slotCount;
+    stats.reusedResourceCount = pResourcesCache->getReusedResourceCount();
+    timer.update();
+    stats.compileTime = timer.delta();
+    logDebug(
+        "RenderGraphCompiler: Compiled {} of {} passes and reused {} of {} resources in {:.3f} ms.",
+        stats.compiledPasses.size(),
+        stats.compiledPasses.size() + stats.reusedPasses.size(),
+        stats.reusedResourceCount,
+        stats.resourceCount,
+        stats.compileTime * 1000.0
+    );
+
     pExe->mpResourceCache = std::move(pResourcesCache);
+    pExe->mCompileStats = std::move(stats);
     return pExe;
 }
 
@@ -260,15 +314,8 @@ bool RenderGraphCompiler::insertAutoPasses()
     return addedPasses;
 }
 
-void RenderGraphCompiler::allocateResources(ref<Device> pDevice, ResourceCache* pResourceCache)
+void RenderGraphCompiler::allocateResources(ref<Device> pDevice, ResourceCache* pResourceCache, const ResourceCache* pPreviousCache)
 {
-    // Build list to look up execution order index from the pass
-    std::unordered_map<RenderPass*, uint32_t> passToIndex;
-    for (size_t i = 0; i < mExecutionList.size(); i++)
-    {
-        passToIndex.emplace(mExecutionList[i].pPass.get(), uint32_t(i));
-    }
-
     for (size_t i = 0; i < mExecutionList.size(); i++)
     {
         uint32_t nodeIndex = mExecutionList[i].index;
@@ -335,13 +382,12 @@ void RenderGraphCompiler::allocateResources(ref<Device> pDevice, ResourceCache*
             std::string srcFieldName = mGraph.mNodeData[pEdge->getSourceNode()].name + '.' + edgeData.srcField;
             std::string dstFieldName = mGraph.mNodeData[nodeIndex].name + '.' + dstField.getName();
 
-            const auto& pSrcPass = mGraph.mNodeData[pEdge->getSourceNode()].pPass.get();
-            const auto& srcReflection = mExecutionList[passToIndex.at(pSrcPass)].reflector;
-            pResourceCache->registerField(dstFieldName, dstField, passToIndex[pSrcPass], srcFieldName);
+            // The resource must stay alive until this pass, which reads it
+            pResourceCache->registerField(dstFieldName, dstField, uint32_t(i), srcFieldName);
         }
     }
 
-    pResourceCache->allocateResources(pDevice, mDependencies.defaultResourceProps);
+    pResourceCache->allocateResources(pDevice, mDependencies.defaultResourceProps, pPreviousCache);
 }
 
 void RenderGraphCompiler::restoreCompilationChanges()
@@ -442,12 +488,22 @@ void RenderGraphCompiler::compilePasses(RenderContext* pRenderContext)
         bool success = true;
         for (auto& p : mExecutionList)
         {
+            // Skip passes that were already compiled with the same data. Changes to a pass's reflection alter the compile data of the
+            // passes connected to it, so only the passes affected by a change are compiled again.
+            RenderPass::CompileData compileData = prepPassCompilationData(p);
+            auto it = mCompiledPasses.find(p.name);
+            if (it != mCompiledPasses.end() && it->second.pPass == p.pPass && isSameCompileData(it->second.compileData, compileData))
+                continue;
+
             try
             {
-                p.pPass->compile(pRenderContext, prepPassCompilationData(p));
+                mRecompiledPasses.insert(p.name);
+                p.pPass->compile(pRenderContext, compileData);
+                mCompiledPasses[p.name] = {p.pPass, std::move(compileData)};
             }
             catch (const std::exception& e)
             {
+                mCompiledPasses.erase(p.name);
                 log += std::string(e.what()) + "\n";
                 success = false;
             }
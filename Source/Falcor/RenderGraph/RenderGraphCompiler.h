@@ -32,6 +32,8 @@
 #include "RenderGraphExe.h"
 #include "Core/Macros.h"
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -47,7 +49,22 @@ public:
         ResourceCache::DefaultProperties defaultResourceProps;
         ResourceCache::ResourcesMap externalResources;
     };
-    static std::unique_ptr<RenderGraphExe> compile(RenderGraph& graph, RenderContext* pRenderContext, const Dependencies& dependencies);
+
+    /**
+     * Compile a render graph.
+     * @param[in] graph The graph to compile.
+     * @param[in] pRenderContext The render context.
+     * @param[in] dependencies Default resource properties and external resources.
+     * @param[in] pPreviousExe Optional. Result of the previous compilation of the same graph. If set, passes that did not request a
+     * recompile and whose compile data is unchanged are not compiled again, and resources whose properties are unchanged are reused.
+     * @return The executable graph.
+     */
+    static std::unique_ptr<RenderGraphExe> compile(
+        RenderGraph& graph,
+        RenderContext* pRenderContext,
+        const Dependencies& dependencies,
+        const RenderGraphExe* pPreviousExe = nullptr
+    );
 
 private:
     RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies);
@@ -64,6 +81,8 @@ private:
         RenderPassReflection reflector;
     };
     std::vector<PassData> mExecutionList;
+    std::unordered_map<std::string, RenderGraphExe::CompiledPass> mCompiledPasses; ///< Compile data of passes that are up to date.
+    std::unordered_set<std::string> mRecompiledPasses;                              ///< Passes compiled during this compilation.
 
     // TODO Better way to track history, or avoid changing the original graph altogether?
     struct
@@ -75,7 +94,7 @@ private:
     void resolveExecutionOrder();
     void compilePasses(RenderContext* pRenderContext);
     bool insertAutoPasses();
-    void allocateResources(ref<Device> pDevice, ResourceCache* pResourceCache);
+    void allocateResources(ref<Device> pDevice, ResourceCache* pResourceCache, const ResourceCache* pPreviousCache);
     void validateGraph() const;
     void restoreCompilationChanges();
     RenderPass::CompileData prepPassCompilationData(const PassData& passData);
@@ -36,6 +36,7 @@
 #include "Utils/InternalDictionary.h"
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Falcor
@@ -54,6 +55,18 @@ public:
         ResourceFormat defaultTexFormat;
     };
 
+    /**
+     * Statistics of the compilation that created this object.
+     */
+    struct CompileStats
+    {
+        std::vector<std::string> compiledPasses; ///< Passes whose compile() function was called, in execution order.
+        std::vector<std::string> reusedPasses;   ///< Passes whose state from the previous compilation was reused, in execution order.
+        uint32_t resourceCount = 0;              ///< Number of resources owned by the graph.
+        uint32_t reusedResourceCount = 0;        ///< Number of resources taken over from the previous compilation.
+        double compileTime = 0.0;                ///< Compilation time in seconds.
+    };
+
     /**
      * Execute the graph
      */
@@ -94,6 +107,11 @@ public:
      */
     void setInput(const std::string& name, const ref<Resource>& pResource);
 
+    /**
+     * Get the statistics of the compilation that created this object.
+     */
+    const CompileStats& getCompileStats() const { return mCompileStats; }
+
 private:
     friend class RenderGraphCompiler;
 
@@ -109,7 +127,16 @@ private:
         Pass(const std::string& name_, const ref<RenderPass>& pPass_) : name(name_), pPass(pPass_) {}
     };
 
+    // The pass instance and compile data each pass was last compiled with. Used to skip unaffected passes when the graph is recompiled.
+    struct CompiledPass
+    {
+        ref<RenderPass> pPass;
+        RenderPass::CompileData compileData;
+    };
+
     std::vector<Pass> mExecutionList;
     std::unique_ptr<ResourceCache> mpResourceCache;
+    std::unordered_map<std::string, CompiledPass> mCompiledPasses;
+    CompileStats mCompileStats;
 };
 } // namespace Falcor
@@ -29,7 +29,11 @@
 #include "Core/API/Device.h"
 #include "Core/API/Texture.h"
 #include "Core/API/Buffer.h"
+#include "Core/Platform/OS.h"
 #include "Utils/Logger.h"
+#include "Utils/Math/Common.h"
+#include <algorithm>
+#include <unordered_set>
 
 namespace Falcor
 {
@@ -37,6 +41,8 @@ void ResourceCache::reset()
 {
     mNameToIndex.clear();
     mResourceData.clear();
+    mAllocationStats = {};
+    mReusedResourceCount = 0;
 }
 
 const ref<Resource>& ResourceCache::getResource(const std::string& name) const
@@ -106,7 +112,8 @@ void ResourceCache::registerField(
         FALCOR_ASSERT(mNameToIndex.count(name) == 0);
         mNameToIndex[name] = (uint32_t)mResourceData.size();
         bool resolveBindFlags = (field.getBindFlags() == ResourceBindFlags::None);
-        mResourceData.push_back({field, {timePoint, timePoint}, nullptr, resolveBindFlags, name});
+        bool persistent = is_set(field.getFlags(), RenderPassReflection::Field::Flags::Persistent);
+        mResourceData.push_back({field, {timePoint, timePoint}, nullptr, resolveBindFlags, name, persistent});
     }
     else // Add alias
     {
@@ -116,30 +123,57 @@ void ResourceCache::registerField(
         mergeTimePoint(mResourceData[index].lifetime, timePoint);
         mResourceData[index].pResource = nullptr;
         mResourceData[index].resolveBindFlags = mResourceData[index].resolveBindFlags || (field.getBindFlags() == ResourceBindFlags::None);
+        mResourceData[index].persistent =
+            mResourceData[index].persistent || is_set(field.getFlags(), RenderPassReflection::Field::Flags::Persistent);
     }
 }
 
-inline ref<Resource> createResourceForPass(
-    ref<Device> pDevice,
+namespace
+{
+/**
+ * Fully resolved properties of a resource created for a field.
+ */
+struct ResourceDesc
+{
+    RenderPassReflection::Field::Type type;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t sampleCount;
+    uint32_t arraySize;
+    uint32_t mipLevels;
+    ResourceFormat format;
+    ResourceBindFlags bindFlags;
+
+    bool operator==(const ResourceDesc& other) const
+    {
+        return type == other.type && width == other.width && height == other.height && depth == other.depth &&
+               sampleCount == other.sampleCount && arraySize == other.arraySize && mipLevels == other.mipLevels && format == other.format &&
+               bindFlags == other.bindFlags;
+    }
+};
+
+ResourceDesc resolveResourceDesc(
+    const ref<Device>& pDevice,
     const ResourceCache::DefaultProperties& params,
     const RenderPassReflection::Field& field,
-    bool resolveBindFlags,
-    const std::string& resourceName
+    bool resolveBindFlags
 )
 {
-    uint32_t width = field.getWidth() ? field.getWidth() : params.dims.x;
-    uint32_t height = field.getHeight() ? field.getHeight() : params.dims.y;
-    uint32_t depth = field.getDepth() ? field.getDepth() : 1;
-    uint32_t sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
-    auto bindFlags = field.getBindFlags();
-    auto arraySize = field.getArraySize();
-    auto mipLevels = field.getMipCount();
-
-    ResourceFormat format = ResourceFormat::Unknown;
+    ResourceDesc desc;
+    desc.type = field.getType();
+    desc.width = field.getWidth() ? field.getWidth() : params.dims.x;
+    desc.height = field.getHeight() ? field.getHeight() : params.dims.y;
+    desc.depth = field.getDepth() ? field.getDepth() : 1;
+    desc.sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
+    desc.arraySize = field.getArraySize();
+    desc.mipLevels = field.getMipCount();
+    desc.bindFlags = field.getBindFlags();
+    desc.format = ResourceFormat::Unknown;
 
     if (field.getType() != RenderPassReflection::Field::Type::RawBuffer)
     {
-        format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
+        desc.format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
         if (resolveBindFlags)
         {
             ResourceBindFlags mask = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
@@ -147,41 +181,81 @@ inline ref<Resource> createResourceForPass(
             bool isInternal = is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Internal);
             if (isOutput || isInternal)
                 mask |= Resource::BindFlags::DepthStencil | Resource::BindFlags::RenderTarget;
-            auto supported = pDevice->getFormatBindFlags(format);
+            auto supported = pDevice->getFormatBindFlags(desc.format);
             mask &= supported;
-            bindFlags |= mask;
+            desc.bindFlags |= mask;
         }
     }
     else // RawBuffer
     {
         if (resolveBindFlags)
-            bindFlags = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
+            desc.bindFlags = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
     }
+    return desc;
+}
+
+/**
+ * Estimate the memory size of a resource, ignoring alignment and padding.
+ */
+uint64_t estimateResourceSize(const ResourceDesc& desc)
+{
+    if (desc.type == RenderPassReflection::Field::Type::RawBuffer)
+        return desc.width;
+
+    using Type = RenderPassReflection::Field::Type;
+    uint32_t height = desc.type == Type::Texture1D ? 1 : desc.height;
+    uint32_t depth = desc.type == Type::Texture3D ? desc.depth : 1;
+    uint32_t layers = desc.type == Type::Texture3D ? 1 : desc.arraySize * (desc.type == Type::TextureCube ? 6 : 1);
+    uint32_t mipLevels = desc.sampleCount > 1 ? 1 : desc.mipLevels;
+    if (mipLevels == Resource::kMaxPossible)
+        mipLevels = bitScanReverse(desc.width | height | depth) + 1;
+
+    uint32_t blockWidth = getFormatWidthCompressionRatio(desc.format);
+    uint32_t blockHeight = getFormatHeightCompressionRatio(desc.format);
+    uint64_t size = 0;
+    for (uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        uint64_t w = std::max(desc.width >> mip, 1u);
+        uint64_t h = std::max(height >> mip, 1u);
+        uint64_t d = std::max(depth >> mip, 1u);
+        size += div_round_up(w, (uint64_t)blockWidth) * div_round_up(h, (uint64_t)blockHeight) * d;
+    }
+    return size * getFormatBytesPerBlock(desc.format) * layers * desc.sampleCount;
+}
+
+ref<Resource> createResource(const ref<Device>& pDevice, const ResourceDesc& desc, const std::string& resourceName)
+{
     ref<Resource> pResource;
 
-    switch (field.getType())
+    switch (desc.type)
     {
     case RenderPassReflection::Field::Type::RawBuffer:
-        pResource = Buffer::create(pDevice, width, bindFlags, Buffer::CpuAccess::None);
+        pResource = Buffer::create(pDevice, desc.width, desc.bindFlags, Buffer::CpuAccess::None);
         break;
     case RenderPassReflection::Field::Type::Texture1D:
-        pResource = Texture::create1D(pDevice, width, format, arraySize, mipLevels, nullptr, bindFlags);
+        pResource = Texture::create1D(pDevice, desc.width, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
         break;
     case RenderPassReflection::Field::Type::Texture2D:
-        if (sampleCount > 1)
+        if (desc.sampleCount > 1)
         {
-            pResource = Texture::create2DMS(pDevice, width, height, format, sampleCount, arraySize, bindFlags);
+            pResource =
+                Texture::create2DMS(pDevice, desc.width, desc.height, desc.format, desc.sampleCount, desc.arraySize, desc.bindFlags);
         }
         else
         {
-            pResource = Texture::create2D(pDevice, width, height, format, arraySize, mipLevels, nullptr, bindFlags);
+            pResource = Texture::create2D(
+                pDevice, desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags
+            );
         }
         break;
     case RenderPassReflection::Field::Type::Texture3D:
-        pResource = Texture::create3D(pDevice, width, height, depth, format, mipLevels, nullptr, bindFlags);
+        pResource =
+            Texture::create3D(pDevice, desc.width, desc.height, desc.depth, desc.format, desc.mipLevels, nullptr, desc.bindFlags);
         break;
     case RenderPassReflection::Field::Type::TextureCube:
-        pResource = Texture::createCube(pDevice, width, height, format, arraySize, mipLevels, nullptr, bindFlags);
+        pResource = Texture::createCube(
+            pDevice, desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags
+        );
         break;
     default:
         FALCOR_UNREACHABLE();
@@ -190,15 +264,102 @@ inline ref<Resource> createResourceForPass(
     pResource->setName(resourceName);
     return pResource;
 }
+} // namespace
 
-void ResourceCache::allocateResources(ref<Device> pDevice, const DefaultProperties& params)
+void ResourceCache::allocateResources(ref<Device> pDevice, const DefaultProperties& params, const ResourceCache* pPreviousCache)
 {
-    for (auto& data : mResourceData)
+    // Resolve the properties of the resources to create and group identical ones into compatibility classes.
+    std::vector<uint32_t> dataIndices;
+    std::vector<ResourceDesc> descs;
+    std::vector<ResourceDesc> classDescs;
+    std::vector<TransientResourcePlanner::Request> requests;
+    for (uint32_t i = 0; i < (uint32_t)mResourceData.size(); i++)
     {
-        if ((data.pResource == nullptr) && (data.field.isValid()))
+        const auto& data = mResourceData[i];
+        if ((data.pResource != nullptr) || (data.field.isValid() == false))
+            continue;
+
+        ResourceDesc desc = resolveResourceDesc(pDevice, params, data.field, data.resolveBindFlags);
+        auto classIt = std::find(classDescs.begin(), classDescs.end(), desc);
+        uint32_t classId = (uint32_t)(classIt - classDescs.begin());
+        if (classIt == classDescs.end())
+            classDescs.push_back(desc);
+
+        // Internal fields typically hold history data. Graph outputs are accessed after the graph has executed.
+        bool isInternal = is_set(data.field.getVisibility(), RenderPassReflection::Field::Visibility::Internal);
+        bool isGraphOutput = data.lifetime.second == uint32_t(-1);
+
+        TransientResourcePlanner::Request request;
+        request.size = estimateResourceSize(desc);
+        request.firstUse = data.lifetime.first;
+        request.lastUse = data.lifetime.second;
+        request.classId = classId;
+        request.aliasable = params.aliasTransientResources && !isInternal && !isGraphOutput && !data.persistent;
+
+        dataIndices.push_back(i);
+        descs.push_back(desc);
+        requests.push_back(request);
+    }
+
+    TransientResourcePlanner::Plan plan = TransientResourcePlanner::plan(requests);
+
+    // Find a resource of the previous cache that was allocated for one of the slot's fields with the same properties.
+    // Every previous resource is handed to at most one slot, as slots may be live at the same time.
+    std::unordered_set<const Resource*> reusedResources;
+    auto findReusableResource = [&](const TransientResourcePlanner::Slot& slot) -> ref<Resource>
+    {
+        if (!pPreviousCache)
+            return nullptr;
+        for (uint32_t r : slot.requests)
+        {
+            auto it = pPreviousCache->mNameToIndex.find(mResourceData[dataIndices[r]].name);
+            if (it == pPreviousCache->mNameToIndex.end())
+                continue;
+            const auto& prevData = pPreviousCache->mResourceData[it->second];
+            if (!prevData.pResource || reusedResources.count(prevData.pResource.get()) != 0)
+                continue;
+            ResourceDesc prevDesc =
+                resolveResourceDesc(pDevice, pPreviousCache->mAllocationParams, prevData.field, prevData.resolveBindFlags);
+            if (prevDesc == descs[slot.requests[0]])
+                return prevData.pResource;
+        }
+        return nullptr;
+    };
+
+    mReusedResourceCount = 0;
+    for (const auto& slot : plan.slots)
+    {
+        std::string name = mResourceData[dataIndices[slot.requests[0]]].name;
+        for (size_t r = 1; r < slot.requests.size(); r++)
+            name += ", " + mResourceData[dataIndices[slot.requests[r]]].name;
+
+        ref<Resource> pResource = findReusableResource(slot);
+        if (pResource)
         {
-            data.pResource = createResourceForPass(pDevice, params, data.field, data.resolveBindFlags, data.name);
+            reusedResources.insert(pResource.get());
+            pResource->setName(name);
+            mReusedResourceCount++;
         }
+        else
+        {
+            pResource = createResource(pDevice, descs[slot.requests[0]], name);
+        }
+        for (uint32_t r : slot.requests)
+            mResourceData[dataIndices[r]].pResource = pResource;
+    }
+
+    mAllocationParams = params;
+    mAllocationStats = plan.stats;
+    if (plan.stats.slotCount < plan.stats.requestCount)
+    {
+        logInfo(
+            "ResourceCache: Allocated {} resources for {} fields. Memory reduced from {:.1f} MB to {:.1f} MB (peak live {:.1f} MB).",
+            plan.stats.slotCount,
+            plan.stats.requestCount,
+            plan.stats.unaliasedBytes / (1024.0 * 1024.0),
+            plan.stats.aliasedBytes / (1024.0 * 1024.0),
+            plan.stats.peakLiveBytes / (1024.0 * 1024.0)
+        );
     }
 }
 } // namespace Falcor
@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "RenderPassReflection.h"
+#include "TransientResourcePlanner.h"
 #include "Core/Macros.h"
 #include "Core/API/fwd.h"
 #include "Core/API/Resource.h"
@@ -49,6 +50,7 @@ public:
     {
         uint2 dims = {512, 512};                         ///< Width, height of the swap chain
         ResourceFormat format = ResourceFormat::RGBA32Float; ///< Format to use for texture creation
+        bool aliasTransientResources = true;                 ///< Share resources between fields with identical properties and disjoint lifetimes
     };
 
     /**
@@ -86,8 +88,24 @@ public:
     /**
      * Allocate all resources that need to be created/updated.
      * This includes new resources, resources whose properties have been updated since last allocation call.
+     * Pass outputs that are neither graph outputs nor persistent are transient. If enabled in the default properties, transient fields
+     * with identical resource properties and disjoint lifetimes share a single resource.
+     * @param[in] pDevice GPU device.
+     * @param[in] params Default resource properties.
+     * @param[in] pPreviousCache Optional. Cache of a previous compilation of the graph. Resources allocated there for fields of the same
+     * name whose resolved properties are unchanged are reused instead of being recreated.
      */
-    void allocateResources(ref<Device> pDevice, const DefaultProperties& params);
+    void allocateResources(ref<Device> pDevice, const DefaultProperties& params, const ResourceCache* pPreviousCache = nullptr);
+
+    /**
+     * Get the memory statistics of the last allocateResources() call.
+     */
+    const TransientResourcePlanner::Stats& getAllocationStats() const { return mAllocationStats; }
+
+    /**
+     * Get the number of resources the last allocateResources() call took over from the previous cache.
+     */
+    uint32_t getReusedResourceCount() const { return mReusedResourceCount; }
 
     /**
      * Clears all registered field/resource properties and allocated resources.
@@ -102,11 +120,15 @@ private:
         ref<Resource> pResource;                // The resource
         bool resolveBindFlags;                  // Whether or not we should resolve the field's bind-flags before creating the resource
         std::string name;                       // Full name of the resource, including the pass name
+        bool persistent;                        // Whether any of the aliased fields requires the resource to persist between executions
     };
 
     // Resources and properties for fields within (and therefore owned by) a render graph
     std::unordered_map<std::string, uint32_t> mNameToIndex;
     std::vector<ResourceData> mResourceData;
+    TransientResourcePlanner::Stats mAllocationStats;
+    uint32_t mReusedResourceCount = 0;
+    DefaultProperties mAllocationParams; // Default properties used by the last allocation, needed to match resources for reuse
 
     // References to output resources not to be allocated by the render graph
     ResourcesMap mExternalResources;
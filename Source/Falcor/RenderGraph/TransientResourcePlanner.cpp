@@ -0,0 +1,147 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "TransientResourcePlanner.h"
+#include "Core/Errors.h"
+#include <algorithm>
+#include <utility>
+
+namespace Falcor
+{
+TransientResourcePlanner::Plan TransientResourcePlanner::plan(const std::vector<Request>& requests)
+{
+    Plan plan;
+    plan.requestSlots.resize(requests.size());
+
+    std::vector<uint32_t> order;
+    order.reserve(requests.size());
+    for (uint32_t i = 0; i < (uint32_t)requests.size(); i++)
+    {
+        const Request& r = requests[i];
+        if (r.firstUse > r.lastUse)
+            throw ArgumentError("Request {} ends at time point {} before it starts at time point {}.", i, r.lastUse, r.firstUse);
+
+        if (r.aliasable)
+        {
+            order.push_back(i);
+        }
+        else
+        {
+            plan.requestSlots[i] = (uint32_t)plan.slots.size();
+            plan.slots.push_back({r.classId, r.size, {i}});
+        }
+    }
+
+    // Visit requests by first use. Larger requests go first on ties so that they open the slots smaller ones can reuse later.
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [&](uint32_t a, uint32_t b)
+        {
+            if (requests[a].firstUse != requests[b].firstUse)
+                return requests[a].firstUse < requests[b].firstUse;
+            return requests[a].size > requests[b].size;
+        }
+    );
+
+    // Last time point at which each slot is in use. Slots of non-aliasable requests are never free.
+    std::vector<uint64_t> slotLastUse(plan.slots.size(), UINT64_MAX);
+
+    for (uint32_t i : order)
+    {
+        const Request& r = requests[i];
+
+        // Best fit: the smallest free slot that is large enough, otherwise the largest free slot, which then grows.
+        uint32_t best = uint32_t(-1);
+        for (uint32_t s = 0; s < (uint32_t)plan.slots.size(); s++)
+        {
+            const Slot& slot = plan.slots[s];
+            if (slot.classId != r.classId || slotLastUse[s] >= r.firstUse)
+                continue;
+            if (best == uint32_t(-1))
+            {
+                best = s;
+                continue;
+            }
+            uint64_t bestSize = plan.slots[best].size;
+            bool fits = slot.size >= r.size;
+            bool bestFits = bestSize >= r.size;
+            if (fits ? (!bestFits || slot.size < bestSize) : (!bestFits && slot.size > bestSize))
+                best = s;
+        }
+
+        if (best == uint32_t(-1))
+        {
+            best = (uint32_t)plan.slots.size();
+            plan.slots.push_back({r.classId, 0, {}});
+            slotLastUse.push_back(0);
+        }
+
+        Slot& slot = plan.slots[best];
+        slot.size = std::max(slot.size, r.size);
+        slot.requests.push_back(i);
+        slotLastUse[best] = r.lastUse;
+        plan.requestSlots[i] = best;
+    }
+
+    // Sweep over the lifetimes to find the peak of simultaneously alive memory.
+    // Non-aliasable requests are alive at all times.
+    std::vector<std::pair<uint64_t, int64_t>> events;
+    events.reserve(order.size() * 2);
+    uint64_t alwaysAliveBytes = 0;
+    for (const Request& r : requests)
+    {
+        plan.stats.unaliasedBytes += r.size;
+        if (r.aliasable)
+        {
+            events.emplace_back(r.firstUse, int64_t(r.size));
+            events.emplace_back(uint64_t(r.lastUse) + 1, -int64_t(r.size));
+        }
+        else
+        {
+            alwaysAliveBytes += r.size;
+        }
+    }
+    // Frees sort before allocations at the same time point.
+    std::sort(events.begin(), events.end());
+    int64_t liveBytes = 0;
+    int64_t peakBytes = 0;
+    for (const auto& [time, delta] : events)
+    {
+        liveBytes += delta;
+        peakBytes = std::max(peakBytes, liveBytes);
+    }
+    plan.stats.peakLiveBytes = alwaysAliveBytes + uint64_t(peakBytes);
+
+    for (const Slot& slot : plan.slots)
+        plan.stats.aliasedBytes += slot.size;
+    plan.stats.requestCount = (uint32_t)requests.size();
+    plan.stats.slotCount = (uint32_t)plan.slots.size();
+
+    return plan;
+}
+} // namespace Falcor
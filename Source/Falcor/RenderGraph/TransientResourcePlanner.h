@@ -0,0 +1,88 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Plans memory sharing between the transient resources of a render graph.
+ *
+ * Each request describes a resource by its size, the range of execution-order time points where it is used
+ * and a compatibility class. Requests of the same class whose lifetimes do not overlap are assigned to the
+ * same slot, and each slot is later backed by a single resource.
+ *
+ * Requests are processed in order of first use. A request takes the free slot of its class that fits it best,
+ * or opens a new slot if no slot of its class is free. Within a class this is the classic greedy interval
+ * coloring, which uses the minimum number of slots.
+ */
+class FALCOR_API TransientResourcePlanner
+{
+public:
+    struct Request
+    {
+        uint64_t size = 0;     ///< Size of the resource in bytes.
+        uint32_t firstUse = 0; ///< First time point where the resource is used (inclusive).
+        uint32_t lastUse = 0;  ///< Last time point where the resource is used (inclusive).
+        uint32_t classId = 0;  ///< Only requests of the same class can share a slot.
+        bool aliasable = true; ///< If false, the request gets a slot of its own that is considered alive at all times.
+    };
+
+    struct Slot
+    {
+        uint32_t classId = 0;           ///< Compatibility class of the requests in this slot.
+        uint64_t size = 0;              ///< Largest size of the requests in this slot.
+        std::vector<uint32_t> requests; ///< Indices of the requests assigned to this slot, in order of first use.
+    };
+
+    struct Stats
+    {
+        uint64_t unaliasedBytes = 0; ///< Memory needed if every request gets a resource of its own.
+        uint64_t aliasedBytes = 0;   ///< Memory needed by the planned slots.
+        uint64_t peakLiveBytes = 0;  ///< Largest total size of the requests alive at the same time point. Lower bound for any plan.
+        uint32_t requestCount = 0;   ///< Number of requests.
+        uint32_t slotCount = 0;      ///< Number of slots.
+    };
+
+    struct Plan
+    {
+        std::vector<uint32_t> requestSlots; ///< Slot index for each request.
+        std::vector<Slot> slots;            ///< Planned slots.
+        Stats stats;
+    };
+
+    /**
+     * Assign the requests to slots.
+     * @param[in] requests The requests. Throws an ArgumentError if a request ends before it starts.
+     * @return The plan.
+     */
+    static Plan plan(const std::vector<Request>& requests);
+};
+} // namespace Falcor
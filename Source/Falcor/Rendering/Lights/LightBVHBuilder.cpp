@@ -29,9 +29,11 @@
 #include "Core/Assert.h"
 #include "Core/Errors.h"
 #include "Utils/Logger.h"
+#include "Utils/Threading.h"
 #include "Utils/Timing/Profiler.h"
 #include "Utils/Math/MathConstants.slangh"
 #include <algorithm>
+#include <mutex>
 
 namespace
 {
@@ -45,6 +47,11 @@ namespace
     const uint32_t kMaxLeafTriangleCount = 1 << PackedNode::kTriangleCountBits;
     const uint32_t kMaxLeafTriangleOffset = 1 << PackedNode::kTriangleOffsetBits;
 
+    // Parallel build parameters. These only affect performance, the built BVH is identical to a serial build.
+    const uint32_t kParallelBuildMinTriangleCount = 4096;       ///< Minimum number of triangles in a node for building its subtrees in parallel.
+    const uint32_t kParallelBinningMinTriangleCount = 65536;    ///< Minimum number of triangles in a node for binning the triangles in parallel.
+    const uint32_t kParallelConeMaxDepth = 10;                  ///< Maximum depth at which the lighting cones of subtrees are computed in parallel.
+
     inline float safeACos(float v)
     {
         return std::acos(std::clamp(v, -1.0f, 1.0f));
@@ -226,6 +233,13 @@ namespace Falcor
     {
     }
 
+    struct LightBVHBuilder::ParallelBuildNode
+    {
+        InternalNode node = {};                                 ///< Internal node. Only valid if there is no serially built subtree.
+        std::unique_ptr<ParallelBuildNode> children[2];         ///< Left and right children of the internal node.
+        std::vector<PackedNode> subtree;                        ///< Serially built subtree with node indices relative to its root.
+    };
+
     void LightBVHBuilder::build(RenderContext* pRenderContext, LightBVH& bvh)
     {
         FALCOR_PROFILE(pRenderContext, "LightBVHBuilder::build()");
@@ -238,9 +252,28 @@ namespace Falcor
         const auto& triangles = bvh.mpLightCollection->getMeshLightTriangles(pRenderContext);
         if (triangles.empty()) return;
 
+        BuildResult result = buildNodes(triangles);
+
+        // If there are no non-culled triangles, we're done.
+        if (result.nodes.empty()) return;
+
+        // The BVH is ready, mark it as valid and upload the data.
+        bvh.mNodes = std::move(result.nodes);
+        bvh.mIsValid = true;
+        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
+        bvh.uploadCPUBuffers(result.triangleIndices, result.triangleBitmasks);
+
+        // Computate metadata.
+        bvh.finalize();
+    }
+
+    LightBVHBuilder::BuildResult LightBVHBuilder::buildNodes(fstd::span<const LightCollection::MeshLightTriangle> triangles) const
+    {
+        BuildResult result;
+
         // Create list of triangles that should be included in BVH.
         // For each triangle, precompute data we need for the build.
-        BuildingData data(bvh.mNodes);
+        BuildingData data;
         data.trianglesData.reserve(triangles.size());
 
         for (size_t i = 0; i < triangles.size(); i++)
@@ -263,7 +296,7 @@ namespace Falcor
         }
 
         // If there are no non-culled triangles, we're done.
-        if (data.trianglesData.empty()) return;
+        if (data.trianglesData.empty()) return result;
 
         // Validate options.
         if (mOptions.maxTriangleCountPerLeaf > kMaxLeafTriangleCount)
@@ -279,17 +312,26 @@ namespace Falcor
         // To be grossly conservative, assume each triangle requires two nodes.
         // This is only system RAM and shouldn't be that much, so it's not worth being more careful about it.
         // TODO: Better estimate of how many nodes we will need.
-        data.nodes.clear();
-        data.nodes.reserve(2 * data.trianglesData.size());
-        data.triangleIndices.reserve(data.trianglesData.size());
+        std::vector<PackedNode>& nodes = result.nodes;
+        nodes.reserve(2 * data.trianglesData.size());
+        data.triangleIndices.resize(data.trianglesData.size());
 
         const uint64_t invalidBitmask = std::numeric_limits<uint64_t>::max();
         data.triangleBitmasks.resize(triangles.size(), invalidBitmask); // This is sized based on input triangle count, as it's indexed by global triangle index.
 
         // Build the tree.
         SplitHeuristicFunction splitFunc = getSplitFunction(mOptions.splitHeuristicSelection);
-        buildInternal(mOptions, splitFunc, 0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())), data);
-        FALCOR_ASSERT(!data.nodes.empty());
+        const Range triangleRange(0, static_cast<uint32_t>(data.trianglesData.size()));
+        if (mOptions.useParallelBuild)
+        {
+            auto pRoot = buildParallel(mOptions, splitFunc, 0ull, 0, triangleRange, data);
+            flattenParallelBuild(*pRoot, nodes);
+        }
+        else
+        {
+            buildInternal(mOptions, splitFunc, 0ull, 0, triangleRange, data, nodes);
+        }
+        FALCOR_ASSERT(!nodes.empty());
 
         size_t numValid = 0;
         for (auto mask : data.triangleBitmasks)
@@ -298,15 +340,11 @@ namespace Falcor
 
         // Compute per-node light bounding cones.
         float cosConeAngle;
-        computeLightingConesInternal(0, data, cosConeAngle);
+        computeLightingConesInternal(0, 0, mOptions, nodes, cosConeAngle);
 
-        // The BVH is ready, mark it as valid and upload the data.
-        bvh.mIsValid = true;
-        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
-        bvh.uploadCPUBuffers(data.triangleIndices, data.triangleBitmasks);
-
-        // Computate metadata.
-        bvh.finalize();
+        result.triangleIndices = std::move(data.triangleIndices);
+        result.triangleBitmasks = std::move(data.triangleBitmasks);
+        return result;
     }
 
     bool LightBVHBuilder::renderUI(Gui::Widgets& widget)
@@ -322,6 +360,7 @@ namespace Falcor
         optionsChanged |= widget.checkbox("Allow refitting", options.allowRefitting);
         optionsChanged |= widget.var("Max triangle count per leaf", options.maxTriangleCountPerLeaf, 1u, kMaxLeafTriangleCount);
         optionsChanged |= widget.dropdown("Split heuristic", options.splitHeuristicSelection);
+        optionsChanged |= widget.checkbox("Parallel build", options.useParallelBuild);
 
         if (auto splitGroup = widget.group("Split Options", true))
         {
@@ -350,26 +389,41 @@ namespace Falcor
         return optionsChanged;
     }
 
-    uint32_t LightBVHBuilder::buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data)
+    LightBVHBuilder::SplitResult LightBVHBuilder::splitNode(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint32_t depth, const Range& triangleRange, BuildingData& data, AABB& nodeBounds, float& nodeFlux)
     {
         FALCOR_ASSERT(triangleRange.begin < triangleRange.end);
 
         // Compute the AABB and total flux of the node.
-        float nodeFlux = 0.f;
-        AABB nodeBounds;
+        // The flux is summed up in order to get the same result as a serial build, but the bounds of large nodes are computed in parallel.
+        nodeFlux = 0.f;
+        nodeBounds = AABB();
         for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
         {
-            nodeBounds |= data.trianglesData[dataIndex].bounds;
             nodeFlux += data.trianglesData[dataIndex].flux;
         }
+        if (options.useParallelBuild && triangleRange.length() >= kParallelBinningMinTriangleCount)
+        {
+            std::mutex mutex;
+            Threading::parallelForChunked(triangleRange.begin, triangleRange.end, [&](size_t begin, size_t end)
+            {
+                AABB bounds;
+                for (size_t dataIndex = begin; dataIndex < end; ++dataIndex) bounds |= data.trianglesData[dataIndex].bounds;
+                std::lock_guard<std::mutex> lock(mutex);
+                nodeBounds |= bounds;
+            });
+        }
+        else
+        {
+            for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
+            {
+                nodeBounds |= data.trianglesData[dataIndex].bounds;
+            }
+        }
         FALCOR_ASSERT(nodeBounds.valid());
 
-        data.currentNodeFlux = nodeFlux;
-
         bool trySplitting = triangleRange.length() > (options.createLeavesASAP ? options.maxTriangleCountPerLeaf : 1);
-        const SplitResult splitResult = trySplitting ? splitHeuristic(data, triangleRange, nodeBounds, options) : SplitResult();
+        const SplitResult splitResult = trySplitting ? splitHeuristic(data, triangleRange, nodeBounds, nodeFlux, options) : SplitResult();
 
-        // If we should split, then create an internal node and split.
         if (splitResult.isValid())
         {
             FALCOR_ASSERT(triangleRange.begin < splitResult.triangleIndex && splitResult.triangleIndex < triangleRange.end);
@@ -378,30 +432,43 @@ namespace Falcor
             auto comp = [dim = splitResult.axis](const TriangleSortData& d1, const TriangleSortData& d2) { return d1.bounds.center()[dim] < d2.bounds.center()[dim]; };
             std::nth_element(std::begin(data.trianglesData) + triangleRange.begin, std::begin(data.trianglesData) + splitResult.triangleIndex, std::begin(data.trianglesData) + triangleRange.end, comp);
 
-            // Allocate internal node.
-            FALCOR_ASSERT(data.nodes.size() < std::numeric_limits<uint32_t>::max());
-            const uint32_t nodeIndex = (uint32_t)data.nodes.size();
-            data.nodes.push_back({});
-
-            InternalNode node = {};
-            node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
-            node.attribs.flux = nodeFlux;
-            // The lighting normal bounding cone will be computed later when all leaf nodes have been created.
-
             if (depth >= kMaxBVHDepth)
             {
                 // This is an unrecoverable error since we use bit masks to represent the traversal path from
                 // the root node to each leaf node in the tree, which is necessary for pdf computation with MIS.
                 throw RuntimeError("BVH depth of {} reached. Maximum of {} allowed.", depth + 1, kMaxBVHDepth);
             }
+        }
 
-            uint32_t leftIndex = buildInternal(options, splitHeuristic, bitmask | (0ull << depth), depth + 1, Range(triangleRange.begin, splitResult.triangleIndex), data);
-            uint32_t rightIndex = buildInternal(options, splitHeuristic, bitmask | (1ull << depth), depth + 1, Range(splitResult.triangleIndex, triangleRange.end), data);
+        return splitResult;
+    }
+
+    uint32_t LightBVHBuilder::buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data, std::vector<PackedNode>& nodes)
+    {
+        AABB nodeBounds;
+        float nodeFlux = 0.f;
+        const SplitResult splitResult = splitNode(options, splitHeuristic, depth, triangleRange, data, nodeBounds, nodeFlux);
+
+        // If we should split, then create an internal node and split.
+        if (splitResult.isValid())
+        {
+            // Allocate internal node.
+            FALCOR_ASSERT(nodes.size() < std::numeric_limits<uint32_t>::max());
+            const uint32_t nodeIndex = (uint32_t)nodes.size();
+            nodes.push_back({});
+
+            InternalNode node = {};
+            node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
+            node.attribs.flux = nodeFlux;
+            // The lighting normal bounding cone will be computed later when all leaf nodes have been created.
+
+            uint32_t leftIndex = buildInternal(options, splitHeuristic, bitmask | (0ull << depth), depth + 1, Range(triangleRange.begin, splitResult.triangleIndex), data, nodes);
+            uint32_t rightIndex = buildInternal(options, splitHeuristic, bitmask | (1ull << depth), depth + 1, Range(splitResult.triangleIndex, triangleRange.end), data, nodes);
 
             FALCOR_ASSERT(leftIndex == nodeIndex + 1); // The left node should always be placed immediately after the current node.
             node.rightChildIdx = rightIndex;
 
-            data.nodes[nodeIndex].setInternalNode(node);
+            nodes[nodeIndex].setInternalNode(node);
             return nodeIndex;
         }
         else // No split => create leaf node
@@ -409,9 +476,9 @@ namespace Falcor
             FALCOR_ASSERT(triangleRange.length() <= options.maxTriangleCountPerLeaf);
 
             // Allocate leaf node.
-            FALCOR_ASSERT(data.nodes.size() < std::numeric_limits<uint32_t>::max());
-            const uint32_t nodeIndex = (uint32_t)data.nodes.size();
-            data.nodes.push_back({});
+            FALCOR_ASSERT(nodes.size() < std::numeric_limits<uint32_t>::max());
+            const uint32_t nodeIndex = (uint32_t)nodes.size();
+            nodes.push_back({});
 
             LeafNode node = {};
             node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
@@ -420,54 +487,122 @@ namespace Falcor
             node.attribs.coneDirection = computeLightingCone(triangleRange, data, cosTheta);
             node.attribs.cosConeAngle = cosTheta;
 
+            // The leaves partition the triangle list in depth-first order, so the leaf's triangles start at the beginning of its range.
             node.triangleCount = triangleRange.length();
-            node.triangleOffset = (uint32_t)data.triangleIndices.size();
+            node.triangleOffset = triangleRange.begin;
             FALCOR_ASSERT(node.triangleCount < kMaxLeafTriangleCount);
             FALCOR_ASSERT(node.triangleOffset < kMaxLeafTriangleOffset);
 
-            for (uint32_t triangleIdx = triangleRange.begin, index = 0; triangleIdx < triangleRange.end; ++triangleIdx, ++index)
+            for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
             {
                 uint32_t globalTriangleIndex = data.trianglesData[triangleIdx].triangleIndex;
-                data.triangleIndices.push_back(globalTriangleIndex);
+                data.triangleIndices[triangleIdx] = globalTriangleIndex;
                 data.triangleBitmasks[globalTriangleIndex] = bitmask;
             }
-            FALCOR_ASSERT(data.triangleIndices.size() == node.triangleOffset + node.triangleCount);
 
-            data.nodes[nodeIndex].setLeafNode(node);
+            nodes[nodeIndex].setLeafNode(node);
             return nodeIndex;
         }
     }
 
-    float3 LightBVHBuilder::computeLightingConesInternal(const uint32_t nodeIndex, BuildingData& data, float& cosConeAngle)
+    std::unique_ptr<LightBVHBuilder::ParallelBuildNode> LightBVHBuilder::buildParallel(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data)
     {
-        if (!data.nodes[nodeIndex].isLeaf())
+        auto pNode = std::make_unique<ParallelBuildNode>();
+
+        // Build small subtrees serially.
+        if (triangleRange.length() < kParallelBuildMinTriangleCount)
         {
-            auto node = data.nodes[nodeIndex].getInternalNode();
+            buildInternal(options, splitHeuristic, bitmask, depth, triangleRange, data, pNode->subtree);
+            return pNode;
+        }
 
-            uint32_t leftIndex = nodeIndex + 1;
-            uint32_t rightIndex = node.rightChildIdx;
+        AABB nodeBounds;
+        float nodeFlux = 0.f;
+        const SplitResult splitResult = splitNode(options, splitHeuristic, depth, triangleRange, data, nodeBounds, nodeFlux);
 
-            float leftNodeCosConeAngle = kInvalidCosConeAngle;
-            float3 leftNodeConeDirection = computeLightingConesInternal(leftIndex, data, leftNodeCosConeAngle);
-            float rightNodeCosConeAngle = kInvalidCosConeAngle;
-            float3 rightNodeConeDirection = computeLightingConesInternal(rightIndex, data, rightNodeCosConeAngle);
+        // A leaf node is only created for small nodes, but fall back to the serial build to handle it just in case.
+        if (!splitResult.isValid())
+        {
+            buildInternal(options, splitHeuristic, bitmask, depth, triangleRange, data, pNode->subtree);
+            return pNode;
+        }
+
+        pNode->node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
+        pNode->node.attribs.flux = nodeFlux;
+
+        // Build the two subtrees in parallel. They operate on disjoint triangle ranges.
+        const Range childRanges[2] = { Range(triangleRange.begin, splitResult.triangleIndex), Range(splitResult.triangleIndex, triangleRange.end) };
+        Threading::parallelFor(0, 2, [&](size_t i)
+        {
+            pNode->children[i] = buildParallel(options, splitHeuristic, bitmask | (uint64_t(i) << depth), depth + 1, childRanges[i], data);
+        }, 1);
+
+        return pNode;
+    }
+
+    uint32_t LightBVHBuilder::flattenParallelBuild(ParallelBuildNode& node, std::vector<PackedNode>& nodes)
+    {
+        FALCOR_ASSERT(nodes.size() < std::numeric_limits<uint32_t>::max());
+        const uint32_t nodeIndex = (uint32_t)nodes.size();
+
+        if (!node.subtree.empty())
+        {
+            // Append the serially built subtree, offsetting the child indices of its internal nodes.
+            // Note the packed data is modified directly as unpacking and re-packing the node is lossy.
+            nodes.insert(nodes.end(), node.subtree.begin(), node.subtree.end());
+            for (size_t i = nodeIndex; i < nodes.size(); i++)
+            {
+                if (!nodes[i].isLeaf()) nodes[i].data[0].x += nodeIndex;
+            }
+            node.subtree = {};
+            return nodeIndex;
+        }
+
+        nodes.push_back({});
+        uint32_t leftIndex = flattenParallelBuild(*node.children[0], nodes);
+        uint32_t rightIndex = flattenParallelBuild(*node.children[1], nodes);
+
+        FALCOR_ASSERT(leftIndex == nodeIndex + 1); // The left node should always be placed immediately after the current node.
+        node.node.rightChildIdx = rightIndex;
+
+        nodes[nodeIndex].setInternalNode(node.node);
+        return nodeIndex;
+    }
+
+    float3 LightBVHBuilder::computeLightingConesInternal(const uint32_t nodeIndex, uint32_t depth, const Options& options, std::vector<PackedNode>& nodes, float& cosConeAngle)
+    {
+        if (!nodes[nodeIndex].isLeaf())
+        {
+            auto node = nodes[nodeIndex].getInternalNode();
+
+            const uint32_t childIndices[2] = { nodeIndex + 1, node.rightChildIdx };
+            float childCosConeAngles[2] = { kInvalidCosConeAngle, kInvalidCosConeAngle };
+            float3 childConeDirections[2];
+
+            // The subtrees are independent, so process them in parallel close to the root.
+            auto processChild = [&](size_t i)
+            {
+                childConeDirections[i] = computeLightingConesInternal(childIndices[i], depth + 1, options, nodes, childCosConeAngles[i]);
+            };
+            if (options.useParallelBuild && depth < kParallelConeMaxDepth) Threading::parallelFor(0, 2, processChild, 1);
+            else for (size_t i = 0; i < 2; i++) processChild(i);
 
             // TODO: Asserts in coneUnion
-            //float3 coneDirection = coneUnion(leftNodeConeDirection, leftNodeCosConeAngle,
-            float3 coneDirection = coneUnionOld(leftNodeConeDirection, leftNodeCosConeAngle,
-                rightNodeConeDirection, rightNodeCosConeAngle, cosConeAngle);
+            //float3 coneDirection = coneUnion(childConeDirections[0], childCosConeAngles[0],
+            float3 coneDirection = coneUnionOld(childConeDirections[0], childCosConeAngles[0],
+                childConeDirections[1], childCosConeAngles[1], cosConeAngle);
 
             // Update bounding cone.
             node.attribs.cosConeAngle = cosConeAngle;
             node.attribs.coneDirection = coneDirection;
-            data.nodes[nodeIndex].setNodeAttributes(node.attribs);
+            nodes[nodeIndex].setNodeAttributes(node.attribs);
 
             return coneDirection;
         }
         else
         {
             // Load bounding cone.
-            auto attribs = data.nodes[nodeIndex].getNodeAttributes();
+            auto attribs = nodes[nodeIndex].getNodeAttributes();
             cosConeAngle = attribs.cosConeAngle;
             return attribs.coneDirection;
         }
@@ -498,7 +633,7 @@ namespace Falcor
         return coneDirection;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, const Options& /*parameters*/)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, float /*nodeFlux*/, const Options& /*parameters*/)
     {
         // Find the largest dimension.
         float3 dimensions = nodeBounds.extent();
@@ -513,6 +648,30 @@ namespace Falcor
         return result;
     }
 
+    /** Evaluates a binning function along the dimensions to consider and returns the best split.
+        The binning function returns the cost and split for a given dimension, or an invalid split if there is none.
+        If requested, all dimensions are binned in parallel. The results are reduced in order of the dimensions,
+        so the result is identical to evaluating them serially.
+    */
+    template<typename BinFunc>
+    static auto findBestSplit(uint32_t largestDimension, bool splitAlongLargest, bool parallel, const BinFunc& binAlongDimension)
+    {
+        using Result = decltype(binAlongDimension(0u));
+
+        Result axisBestSplits[3];
+        auto binDimension = [&](size_t dimension) { axisBestSplits[dimension] = binAlongDimension((uint32_t)dimension); };
+        if (splitAlongLargest) binDimension(largestDimension);
+        else if (parallel) Threading::parallelFor(0, 3, binDimension, 1);
+        else for (size_t dimension = 0; dimension < 3; ++dimension) binDimension(dimension);
+
+        Result overallBestSplit = Result(std::numeric_limits<float>::infinity(), {});
+        for (const Result& axisBestSplit : axisBestSplits)
+        {
+            if (axisBestSplit.second.isValid() && axisBestSplit.first < overallBestSplit.first) overallBestSplit = axisBestSplit;
+        }
+        return overallBestSplit;
+    }
+
     /** Evaluates the SAH cost metric for a node.
         If the node is empty (invalid bounds), the cost evaluates to zero.
         See Eqn 15 in Moreau and Clarberg, "Importance Sampling of Many Lights on the GPU", Ray Tracing Gems, Ch. 18, 2019.
@@ -525,11 +684,8 @@ namespace Falcor
         return cost;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float nodeFlux, const Options& parameters)
     {
-        std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
-        FALCOR_ASSERT(!overallBestSplit.second.isValid());
-
         struct Bin
         {
             AABB bounds;
@@ -546,15 +702,17 @@ namespace Falcor
         };
 
         FALCOR_ASSERT(parameters.binCount > 1);
-        std::vector<Bin> bins(parameters.binCount);
-        std::vector<float> costs(parameters.binCount - 1);
 
         /** Helper function that computes the best split along the given dimension using the SAH metric.
             The triangles are binned to n bins, storing only the aggregate parameters (triangle count and bounds).
             Then the cost metric is evaluated for each of the n-1 potential splits.
+            Returns an invalid split if all lights fall on either side of the best split.
         */
-        const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds](uint32_t dimension)
+        const auto binAlongDimension = [&triangleRange, &data, &parameters, &nodeBounds](uint32_t dimension)
         {
+            std::vector<Bin> bins(parameters.binCount);
+            std::vector<float> costs(parameters.binCount - 1);
+
             // Helper to compute the bin id for a given triangle.
             auto getBinId = [&](const TriangleSortData& td)
             {
@@ -566,9 +724,6 @@ namespace Falcor
                 return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
             };
 
-            // Reset the bins.
-            for (Bin& bin : bins) bin = Bin();
-
             // Fill the bins with all triangles.
             for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
             {
@@ -607,42 +762,29 @@ namespace Falcor
 
             // Early out if all lights fall on either side of the split.
             if (axisBestSplit.second.triangleIndex == triangleRange.begin ||
-                axisBestSplit.second.triangleIndex == triangleRange.end) return;
+                axisBestSplit.second.triangleIndex == triangleRange.end) return std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
 
-            if (axisBestSplit.first < overallBestSplit.first)
-            {
-                overallBestSplit = axisBestSplit;
-                FALCOR_ASSERT(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
-            }
+            return axisBestSplit;
         };
 
-        if (parameters.splitAlongLargest)
-        {
-            // Find the largest dimension.
-            float3 dimensions = nodeBounds.extent();
-            uint32_t largestDimension = dimensions[2] >= dimensions[0] && dimensions[2] >= dimensions[1] ?
-                2 : (dimensions[1] >= dimensions[0] && dimensions[1] >= dimensions[2] ? 1 : 0);
+        // Find the largest dimension.
+        float3 dimensions = nodeBounds.extent();
+        uint32_t largestDimension = dimensions[2] >= dimensions[0] && dimensions[2] >= dimensions[1] ?
+            2 : (dimensions[1] >= dimensions[0] && dimensions[1] >= dimensions[2] ? 1 : 0);
 
-            binAlongDimension(largestDimension);
-        }
-        else
-        {
-            for (uint32_t dimension = 0; dimension < 3; ++dimension)
-            {
-                binAlongDimension(dimension);
-            }
-        }
+        const bool parallel = parameters.useParallelBuild && triangleRange.length() >= kParallelBinningMinTriangleCount;
+        std::pair<float, SplitResult> overallBestSplit = findBestSplit(largestDimension, parameters.splitAlongLargest, parallel, binAlongDimension);
 
         // If we couldn't find a valid split, create leaf node immediately if possible or revert to equal splitting.
         if (!overallBestSplit.second.isValid())
         {
             if (triangleRange.length() <= parameters.maxTriangleCountPerLeaf) return SplitResult();
             logWarning("LightBVHBuilder::computeSplitWithBinnedSAH() was not able to compute a proper split: reverting to LightBVHBuilder::computeSplitWithEqual()");
-            return computeSplitWithEqual(data, triangleRange, nodeBounds, parameters);
+            return computeSplitWithEqual(data, triangleRange, nodeBounds, nodeFlux, parameters);
         }
+        FALCOR_ASSERT(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
 
         // If the best split we found is more expensive than the cost of a leaf node (and we can create one), then create a leaf node.
-        FALCOR_ASSERT(overallBestSplit.second.isValid());
         if (parameters.useLeafCreationCost && triangleRange.length() <= parameters.maxTriangleCountPerLeaf)
         {
             float leafCost = evalSAH(nodeBounds, triangleRange.length(), parameters);
@@ -680,11 +822,8 @@ namespace Falcor
         return cost;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float nodeFlux, const Options& parameters)
     {
-        std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
-        FALCOR_ASSERT(!overallBestSplit.second.isValid());
-
         // Find the largest dimension.
         float3 dimensions = nodeBounds.extent();
         uint32_t largestDimension = dimensions[2] >= dimensions[0] && dimensions[2] >= dimensions[1] ?
@@ -712,8 +851,7 @@ namespace Falcor
         };
 
         FALCOR_ASSERT(parameters.binCount > 1);
-        std::vector<Bin> bins(parameters.binCount);
-        std::vector<float> costs(parameters.binCount - 1);
+        const bool parallel = parameters.useParallelBuild && triangleRange.length() >= kParallelBinningMinTriangleCount;
 
         /** Helper function that computes the best split along the given dimension using the SAOH metric.
             The triangles are binned to n bins, storing only the aggregate parameters (triangle count, bounds, flux, and cone direction).
@@ -721,9 +859,13 @@ namespace Falcor
             Note that while the bounds and flux are accurately represented by the aggregated parameters,
             the bounding cones are approximates based on the bins' bounding cones. This is less expensive,
             but also less precise than computing them directly from the triangles.
+            Returns an invalid split if all lights fall on either side of the best split.
         */
-        const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds, largestDimension, dimensions](uint32_t dimension)
+        const auto binAlongDimension = [&triangleRange, &data, &parameters, &nodeBounds, largestDimension, dimensions, parallel](uint32_t dimension)
         {
+            std::vector<Bin> bins(parameters.binCount);
+            std::vector<float> costs(parameters.binCount - 1);
+
             // Helper to compute the bin id for a given triangle.
             auto getBinId = [&](const TriangleSortData& td)
             {
@@ -736,10 +878,8 @@ namespace Falcor
                 return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
             };
 
-            // Reset the bins.
-            for (Bin& bin : bins) bin = Bin();
-
             // Fill the bins with all triangles.
+            // Note this is done serially as the order of floating-point additions must match the serial build.
             for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
             {
                 const auto& td = data.trianglesData[i];
@@ -755,11 +895,32 @@ namespace Falcor
                 bin.cosConeAngle = length(bin.coneDirection) < FLT_MIN ? kInvalidCosConeAngle : 1.0f;
                 bin.coneDirection = normalize(bin.coneDirection);
             }
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+            if (parallel)
             {
-                const auto& td = data.trianglesData[i];
-                Bin& bin = bins[getBinId(td)];
-                bin.cosConeAngle = computeCosConeAngle(bin.coneDirection, bin.cosConeAngle, td.coneDirection, td.cosConeAngle);
+                // Growing the cones is a min-reduction over the triangles (with kInvalidCosConeAngle = -1 being absorbing),
+                // so the cone angles can be computed per chunk of triangles and merged while giving the same result as the serial loop.
+                std::mutex mutex;
+                Threading::parallelForChunked(triangleRange.begin, triangleRange.end, [&](size_t begin, size_t end)
+                {
+                    std::vector<float> cosConeAngles(bins.size(), 1.f);
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        const auto& td = data.trianglesData[i];
+                        const uint32_t binId = getBinId(td);
+                        cosConeAngles[binId] = computeCosConeAngle(bins[binId].coneDirection, cosConeAngles[binId], td.coneDirection, td.cosConeAngle);
+                    }
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (size_t j = 0; j < bins.size(); ++j) bins[j].cosConeAngle = std::min(bins[j].cosConeAngle, cosConeAngles[j]);
+                });
+            }
+            else
+            {
+                for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+                {
+                    const auto& td = data.trianglesData[i];
+                    Bin& bin = bins[getBinId(td)];
+                    bin.cosConeAngle = computeCosConeAngle(bin.coneDirection, bin.cosConeAngle, td.coneDirection, td.cosConeAngle);
+                }
             }
 
             // First, compute A_j(L) * N_j(L) by sweeping over the bins from left to right.
@@ -822,44 +983,30 @@ namespace Falcor
 
             // Early out if all lights fall on either side of the split.
             if (axisBestSplit.second.triangleIndex == triangleRange.begin ||
-                axisBestSplit.second.triangleIndex == triangleRange.end) return;
+                axisBestSplit.second.triangleIndex == triangleRange.end) return std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
 
-            if (axisBestSplit.first < overallBestSplit.first)
-            {
-                overallBestSplit = axisBestSplit;
-                FALCOR_ASSERT(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
-            }
+            return axisBestSplit;
         };
 
         // Compute the best split.
-        if (parameters.splitAlongLargest)
-        {
-            binAlongDimension(largestDimension);
-        }
-        else
-        {
-            for (uint32_t dimension = 0; dimension < 3; ++dimension)
-            {
-                binAlongDimension(dimension);
-            }
-        }
+        std::pair<float, SplitResult> overallBestSplit = findBestSplit(largestDimension, parameters.splitAlongLargest, parallel, binAlongDimension);
 
         // If we couldn't find a valid split, create leaf node immediately if possible or revert to equal splitting.
         if (!overallBestSplit.second.isValid())
         {
             if (triangleRange.length() <= parameters.maxTriangleCountPerLeaf) return SplitResult();
             logWarning("LightBVHBuilder::computeSplitWithBinnedSAOH() was not able to compute a proper split: reverting to LightBVHBuilder::computeSplitWithEqual()");
-            return computeSplitWithEqual(data, triangleRange, nodeBounds, parameters);
+            return computeSplitWithEqual(data, triangleRange, nodeBounds, nodeFlux, parameters);
         }
+        FALCOR_ASSERT(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
 
         // If the best split we found is more expensive than the cost of a leaf node (and we can create one), then create a leaf node.
-        FALCOR_ASSERT(overallBestSplit.second.isValid());
         if (parameters.useLeafCreationCost && triangleRange.length() <= parameters.maxTriangleCountPerLeaf)
         {
             // Evaluate the cost metric for the node. This requires us to first compute the cone angle.
             float cosTheta = kInvalidCosConeAngle;
             computeLightingCone(triangleRange, data, cosTheta);
-            float leafCost = evalSAOH(nodeBounds, data.currentNodeFlux, cosTheta, parameters);
+            float leafCost = evalSAOH(nodeBounds, nodeFlux, cosTheta, parameters);
             if (leafCost <= overallBestSplit.first) return SplitResult();
         }
 
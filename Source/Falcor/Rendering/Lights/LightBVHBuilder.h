@@ -32,6 +32,7 @@
 #include "Utils/Math/AABB.h"
 #include "Utils/Math/Vector.h"
 #include "Utils/UI/Gui.h"
+#include <fstd/span.h>
 #include <functional>
 #include <limits>
 #include <memory>
@@ -78,6 +79,7 @@ namespace Falcor
             bool           allowRefitting = true;                                ///< Rather than always rebuilding the BVH from scratch, keep the hierarchy but update the bounds and lighting cones.
             bool           usePreintegration = true;                             ///< Use pre-integration for culling out emissive triangles and use their flux when computing the splits. Only valid when using the BinnedSAOH split heuristic.
             bool           useLightingCones = true;                              ///< Use lighting cones when computing the splits. Only valid when using the BinnedSAOH split heuristic.
+            bool           useParallelBuild = true;                              ///< Build the BVH using multiple threads. The result is identical to the serial build.
 
             template<typename Archive>
             void serialize(Archive& ar)
@@ -93,6 +95,7 @@ namespace Falcor
                 ar("allowRefitting", allowRefitting);
                 ar("usePreintegration", usePreintegration);
                 ar("useLightingCones", useLightingCones);
+                ar("useParallelBuild", useParallelBuild);
             }
         };
 
@@ -101,11 +104,27 @@ namespace Falcor
         */
         LightBVHBuilder(const Options& options);
 
+        /** Result of building the BVH on the CPU.
+        */
+        struct BuildResult
+        {
+            std::vector<PackedNode> nodes;          ///< BVH nodes in depth-first order. Empty if no triangles were included in the build.
+            std::vector<uint32_t> triangleIndices;  ///< Triangle indices sorted by leaf node.
+            std::vector<uint64_t> triangleBitmasks; ///< Per triangle bit pattern retracing the tree traversal to reach the triangle. Indexed by global triangle index.
+        };
+
         /** Build the BVH.
             \param[in,out] bvh The light BVH to build.
         */
         void build(RenderContext* pRenderContext, LightBVH& bvh);
 
+        /** Build the BVH nodes on the CPU without uploading them to the GPU.
+            This is used by build() and is useful for testing and benchmarking the builder.
+            \param[in] triangles List of emissive triangles.
+            \return The BVH nodes and triangle data.
+        */
+        BuildResult buildNodes(fstd::span<const LightCollection::MeshLightTriangle> triangles) const;
+
         bool renderUI(Gui::Widgets& widget);
 
         const Options& getOptions() const { return mOptions; }
@@ -145,22 +164,24 @@ namespace Falcor
 
         struct BuildingData
         {
-            std::vector<PackedNode>& nodes;                 ///< BVH nodes generated by the builder.
             std::vector<TriangleSortData> trianglesData;    ///< Compact list of triangles to include in build.
-            std::vector<uint32_t> triangleIndices;          ///< Triangle indices sorted by leaf node. Each leaf node refers to a contiguous array of triangle indices.
+            std::vector<uint32_t> triangleIndices;          ///< Triangle indices sorted by leaf node. Each leaf node refers to a contiguous array of triangle indices. As leaves partition the triangle list in order, each leaf writes at the start of its triangle range.
             std::vector<uint64_t> triangleBitmasks;         ///< Array containing the per triangle bit pattern retracing the tree traversal to reach the triangle: 0=left child, 1=right child; this array gets filled in during the build process. Indexed by global triangle index.
-            float currentNodeFlux = 0.f;                    ///< Used by computeSAOHSplit() as the leaf creation cost.
-
-            BuildingData(std::vector<PackedNode>& bvhNodes) : nodes(bvhNodes) {}
         };
 
+        /** Node in the top part of the BVH, which is built in parallel.
+            Each node is either an internal node with two children or the root of a subtree that was built serially.
+        */
+        struct ParallelBuildNode;
+
         /** Compute the split according to a specified heuristic.
             \param[in] data Prepared light data.
             \param[in] triangleRange Range of triangles to process.
             \param[in] nodeBounds Bounds for the node to be splitted.
+            \param[in] nodeFlux Total flux of the node to be splitted. Used as the leaf creation cost.
             \param[in] parameters Various parameters defining how the building should occur.
         */
-        using SplitHeuristicFunction = std::function<SplitResult(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)>;
+        using SplitHeuristicFunction = std::function<SplitResult(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float nodeFlux, const Options& parameters)>;
 
         /** Renders the UI with builder options.
         */
@@ -172,17 +193,42 @@ namespace Falcor
             \param[in] depth Depth of the node to be built
             \param[in] triangleRange Range of triangles to process.
             \param[in,out] data Prepared light data.
+            \param[in,out] nodes BVH nodes generated by the builder. New nodes are appended.
             \return Index of the allocated node.
         */
-        uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data);
+        static uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data, std::vector<PackedNode>& nodes);
+
+        /** Recursive parallel BVH build.
+            The two subtrees of large nodes are built in parallel. Small nodes are built serially using buildInternal().
+            The tree is identical to the one built by buildInternal() once flattened using flattenParallelBuild().
+            See buildInternal() for a description of the parameters.
+            \return The root of the built tree.
+        */
+        static std::unique_ptr<ParallelBuildNode> buildParallel(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data);
+
+        /** Flatten a tree built by buildParallel() into the depth-first node order used by buildInternal().
+            \param[in,out] node Root of the tree. Serially built subtrees are moved from.
+            \param[in,out] nodes BVH nodes. New nodes are appended.
+            \return Index of the root node.
+        */
+        static uint32_t flattenParallelBuild(ParallelBuildNode& node, std::vector<PackedNode>& nodes);
+
+        /** Compute the bounds and flux of a node, and split it if a split should be made.
+            If the node is split, the triangles in the range are partitioned accordingly.
+            \param[out] nodeBounds Bounds of the node.
+            \param[out] nodeFlux Total flux of the node.
+            \return The split, or an invalid split if a leaf node should be created.
+        */
+        static SplitResult splitNode(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint32_t depth, const Range& triangleRange, BuildingData& data, AABB& nodeBounds, float& nodeFlux);
 
         /** Recursive computation of lighting cones for all internal nodes.
             \param[in] nodeIndex Index of the current node.
-            \param[in,out] data Updated node data.
+            \param[in] depth Depth of the current node. Subtrees of nodes close to the root are processed in parallel.
+            \param[in,out] nodes BVH nodes to update.
             \param[out] cosConeAngle Cosine of the cone angle of the lighting cone for the current node, or kInvalidCosConeAngle if the cone is invalid.
             \return direction of the lighting cone for the current node.
         */
-        float3 computeLightingConesInternal(const uint32_t nodeIndex, BuildingData& data, float& cosConeAngle);
+        static float3 computeLightingConesInternal(const uint32_t nodeIndex, uint32_t depth, const Options& options, std::vector<PackedNode>& nodes, float& cosConeAngle);
 
         /** Compute lighting cone for a range of triangles.
             \param[in] triangleRange Range of triangles to process.
@@ -193,9 +239,9 @@ namespace Falcor
         static float3 computeLightingCone(const Range& triangleRange, const BuildingData& data, float& cosTheta);
 
         // See the documentation of SplitHeuristicFunction.
-        static SplitResult computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, const Options& /*parameters*/);
-        static SplitResult computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters);
-        static SplitResult computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters);
+        static SplitResult computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, float /*nodeFlux*/, const Options& /*parameters*/);
+        static SplitResult computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float nodeFlux, const Options& parameters);
+        static SplitResult computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float nodeFlux, const Options& parameters);
 
         static SplitHeuristicFunction getSplitFunction(SplitHeuristic heuristic);
 
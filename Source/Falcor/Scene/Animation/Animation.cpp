@@ -31,6 +31,7 @@
 #include "Utils/Math/Common.h"
 #include "Utils/Scripting/ScriptBindings.h"
 #include "Scene/Transform.h"
+#include <algorithm>
 
 namespace Falcor
 {
@@ -159,15 +160,25 @@ namespace Falcor
     {
         FALCOR_ASSERT(!mKeyframes.empty());
 
-        // Validate cached frame index.
-        size_t frameIndex = std::clamp(mCachedFrameIndex, (size_t)0, mKeyframes.size() - 1);
-        if (time < mKeyframes[frameIndex].time) frameIndex = 0;
+        // Find frame index, i.e. the last keyframe at or before the given time.
+        // During playback the time is usually in the cached or the next segment, otherwise use binary search.
+        auto isInSegment = [this, time] (size_t frame)
+        {
+            return (frame == 0 || mKeyframes[frame].time <= time) && (frame + 1 == mKeyframes.size() || mKeyframes[frame + 1].time > time);
+        };
 
-        // Find frame index.
-        while (frameIndex < mKeyframes.size() - 1)
+        size_t frameIndex = std::min(mCachedFrameIndex, mKeyframes.size() - 1);
+        if (!isInSegment(frameIndex))
         {
-            if (mKeyframes[frameIndex + 1].time > time) break;
-            frameIndex++;
+            if (frameIndex + 1 < mKeyframes.size() && isInSegment(frameIndex + 1))
+            {
+                frameIndex++;
+            }
+            else
+            {
+                auto it = std::upper_bound(mKeyframes.begin(), mKeyframes.end(), time, [] (double t, const Keyframe& k) { return t < k.time; });
+                frameIndex = it == mKeyframes.begin() ? 0 : (size_t)(it - mKeyframes.begin()) - 1;
+            }
         }
 
         // Cache frame index;
@@ -223,15 +234,22 @@ namespace Falcor
     // current time is returned. This function should not be used if the current time lies
     // within the range of defined keyframe times.
     double Animation::calcSampleTime(double currentTime)
+    {
+        return calcSampleTime(currentTime, mKeyframes.front().time, mKeyframes.back().time, mPreInfinityBehavior, mPostInfinityBehavior);
+    }
+
+    double Animation::calcSampleTime(double currentTime, double firstKeyframeTime, double lastKeyframeTime, Behavior preInfinityBehavior, Behavior postInfinityBehavior)
     {
         double modifiedTime = currentTime;
-        double firstKeyframeTime = mKeyframes.front().time;
-        double lastKeyframeTime = mKeyframes.back().time;
         double duration = lastKeyframeTime - firstKeyframeTime;
 
         FALCOR_ASSERT(currentTime < firstKeyframeTime || currentTime > lastKeyframeTime);
 
-        Behavior behavior = (currentTime < firstKeyframeTime) ? mPreInfinityBehavior : mPostInfinityBehavior;
+        Behavior behavior = (currentTime < firstKeyframeTime) ? preInfinityBehavior : postInfinityBehavior;
+
+        // Cycling or oscillating a single point in time is the same as clamping.
+        if (duration <= 0.0 && behavior != Behavior::Linear) behavior = Behavior::Constant;
+
         switch (behavior)
         {
         case Behavior::Constant:
@@ -256,6 +274,7 @@ namespace Falcor
     void Animation::addKeyframe(const Keyframe& keyframe)
     {
         FALCOR_ASSERT(keyframe.time <= mDuration);
+        mRevision++;
 
         if (mKeyframes.size() == 0 || mKeyframes[0].time > keyframe.time)
         {
@@ -314,8 +333,8 @@ namespace Falcor
 
     void Animation::renderUI(Gui::Widgets& widget)
     {
-        widget.dropdown("Pre-Infinity Behavior", kChannelLoopModeDropdown, reinterpret_cast<uint32_t&>(mPreInfinityBehavior));
-        widget.dropdown("Post-Infinity Behavior", kChannelLoopModeDropdown, reinterpret_cast<uint32_t&>(mPostInfinityBehavior));
+        if (widget.dropdown("Pre-Infinity Behavior", kChannelLoopModeDropdown, reinterpret_cast<uint32_t&>(mPreInfinityBehavior))) mRevision++;
+        if (widget.dropdown("Post-Infinity Behavior", kChannelLoopModeDropdown, reinterpret_cast<uint32_t&>(mPostInfinityBehavior))) mRevision++;
     }
 
     FALCOR_SCRIPT_BINDING(Animation)
@@ -51,6 +51,9 @@ namespace Falcor
             Hermite,
         };
 
+        /** Behavior of the animation before the first and after the last keyframe.
+            An animation whose keyframes all have the same time has zero length, Cycle and Oscillate behave like Constant in that case.
+        */
         enum class Behavior
         {
             Constant,
@@ -86,7 +89,7 @@ namespace Falcor
 
         /** Set the animated node.
         */
-        void setNodeID(NodeID id) { mNodeID = id; }
+        void setNodeID(NodeID id) { mNodeID = id; mRevision++; }
 
         /** Get the animation duration in seconds.
         */
@@ -98,7 +101,7 @@ namespace Falcor
 
         /** Set the animation's behavior before the first keyframe.
         */
-        void setPreInfinityBehavior(Behavior behavior) { mPreInfinityBehavior = behavior; }
+        void setPreInfinityBehavior(Behavior behavior) { mPreInfinityBehavior = behavior; mRevision++; }
 
         /** Get the animation's behavior after the last keyframe.
         */
@@ -106,7 +109,7 @@ namespace Falcor
 
         /** Set the animation's behavior after the last keyframe.
         */
-        void setPostInfinityBehavior(Behavior behavior) { mPostInfinityBehavior = behavior; }
+        void setPostInfinityBehavior(Behavior behavior) { mPostInfinityBehavior = behavior; mRevision++; }
 
         /** Get the interpolation mode.
         */
@@ -114,7 +117,7 @@ namespace Falcor
 
         /** Set the interpolation mode.
         */
-        void setInterpolationMode(InterpolationMode interpolationMode) { mInterpolationMode = interpolationMode; }
+        void setInterpolationMode(InterpolationMode interpolationMode) { mInterpolationMode = interpolationMode; mRevision++; }
 
         /** Return true if warping is enabled.
         */
@@ -122,7 +125,7 @@ namespace Falcor
 
         /** Enable/disable warping.
         */
-        void setEnableWarping(bool enableWarping) { mEnableWarping = enableWarping; }
+        void setEnableWarping(bool enableWarping) { mEnableWarping = enableWarping; mRevision++; }
 
         /** Add a keyframe.
             If there's already a keyframe at the requested time, this call will override the existing frame.
@@ -143,6 +146,15 @@ namespace Falcor
         */
         bool doesKeyframeExists(double time) const;
 
+        /** Get the number of keyframes.
+        */
+        size_t getKeyframeCount() const { return mKeyframes.size(); }
+
+        /** Get the revision of the animation.
+            The revision is incremented whenever keyframes or animation parameters change.
+        */
+        uint32_t getRevision() const { return mRevision; }
+
         /** Compute the animation.
             \param time The current time in seconds. This can be larger then the animation time, in which case the animation will loop.
             \return Returns the animation's transform matrix for the specified time.
@@ -156,6 +168,7 @@ namespace Falcor
     private:
         Keyframe interpolate(InterpolationMode mode, double time) const;
         double calcSampleTime(double currentTime);
+        static double calcSampleTime(double currentTime, double firstKeyframeTime, double lastKeyframeTime, Behavior preInfinityBehavior, Behavior postInfinityBehavior);
 
         std::string mName;
         NodeID mNodeID;
@@ -169,7 +182,9 @@ namespace Falcor
 
         std::vector<Keyframe> mKeyframes;
         mutable size_t mCachedFrameIndex = 0;
+        uint32_t mRevision = 0;
 
+        friend class AnimationEvaluator;
         friend class SceneCache;
     };
 }
@@ -51,6 +51,15 @@ namespace Falcor
         , mMatricesChanged(pScene->mSceneGraph.size())
         , mpScene(pScene)
     {
+        // Create level-ordered layout of the scene graph.
+        std::vector<uint32_t> parents(pScene->mSceneGraph.size());
+        for (size_t i = 0; i < parents.size(); i++)
+        {
+            NodeID parent = pScene->mSceneGraph[i].parent;
+            parents[i] = parent == NodeID::Invalid() ? TransformHierarchy::kInvalidNode : parent.get();
+        }
+        mTransformHierarchy = TransformHierarchy(parents);
+
         // Create GPU resources.
         FALCOR_ASSERT(mLocalMatrices.size() <= std::numeric_limits<uint32_t>::max());
 
@@ -288,44 +297,25 @@ namespace Falcor
 
     void AnimationController::updateLocalMatrices(double time)
     {
-        for (auto& pAnimation : mAnimations)
-        {
-            NodeID nodeID = pAnimation->getNodeID();
-            FALCOR_ASSERT(nodeID.get() < mLocalMatrices.size());
-            mLocalMatrices[nodeID.get()] = pAnimation->animate(time);
-            mMatricesChanged[nodeID.get()] = true;
-        }
+        if (mAnimationEvaluator.isOutOfDate(mAnimations)) mAnimationEvaluator = AnimationEvaluator(mAnimations);
+        mAnimationEvaluator.evaluate(time, mLocalMatrices, mMatricesChanged);
     }
 
     void AnimationController::updateWorldMatrices(bool updateAll)
     {
-        const auto& sceneGraph = mpScene->mSceneGraph;
+        TransformHierarchy::Matrices matrices;
+        matrices.local = mLocalMatrices;
+        matrices.global = mGlobalMatrices;
+        matrices.invTransposeGlobal = mInvTransposeGlobalMatrices;
 
-        for (size_t i = 0; i < mGlobalMatrices.size(); i++)
+        if (mpSkinningPass)
         {
-            // Propagate matrix change flag to children.
-            if (sceneGraph[i].parent != NodeID::Invalid())
-            {
-                mMatricesChanged[i] = mMatricesChanged[i] || mMatricesChanged[sceneGraph[i].parent.get()];
-            }
-
-            if (!mMatricesChanged[i] && !updateAll) continue;
-
-            mGlobalMatrices[i] = mLocalMatrices[i];
-
-            if (mpScene->mSceneGraph[i].parent != NodeID::Invalid())
-            {
-                mGlobalMatrices[i] = mul(mGlobalMatrices[sceneGraph[i].parent.get()], mGlobalMatrices[i]);
-            }
-
-            mInvTransposeGlobalMatrices[i] = transpose(inverse(mGlobalMatrices[i]));
-
-            if (mpSkinningPass)
-            {
-                mSkinningMatrices[i] = mul(mGlobalMatrices[i], sceneGraph[i].localToBindSpace);
-                mInvTransposeSkinningMatrices[i] = transpose(inverse(mSkinningMatrices[i]));
-            }
+            matrices.localToBindSpace = mLocalToBindSpaceMatrices;
+            matrices.skinning = mSkinningMatrices;
+            matrices.invTransposeSkinning = mInvTransposeSkinningMatrices;
         }
+
+        mTransformHierarchy.propagate(matrices, mMatricesChanged, updateAll);
     }
 
     void AnimationController::uploadWorldMatrices(bool uploadAll)
@@ -389,7 +379,7 @@ namespace Falcor
         return m;
     }
 
-    void AnimationController::createSkinningPass(const std::vector<PackedStaticVertexData>& staticVertexData, const std::vector<SkinningVertexData>& skinningVertexData)
+    void AnimationController::createSkinningPass(const StaticVertexVector& staticVertexData, const SkinningVertexVector& skinningVertexData)
     {
         if (staticVertexData.empty()) return;
 
@@ -404,6 +394,7 @@ namespace Falcor
             mSkinningMatrices.resize(mpScene->mSceneGraph.size());
             mInvTransposeSkinningMatrices.resize(mSkinningMatrices.size());
             mMeshBindMatrices.resize(mpScene->mSceneGraph.size());
+            mLocalToBindSpaceMatrices.resize(mpScene->mSceneGraph.size());
 
             mpSkinningPass = ComputePass::create(mpDevice, "Scene/Animation/Skinning.slang");
             auto block = mpSkinningPass->getRootVar()["gData"];
@@ -414,6 +405,7 @@ namespace Falcor
             {
                 mMeshBindMatrices[i] = mpScene->mSceneGraph[i].meshBind;
                 meshInvBindMatrices[i] = inverse(mMeshBindMatrices[i]);
+                mLocalToBindSpaceMatrices[i] = mpScene->mSceneGraph[i].localToBindSpace;
             }
 
             // Bind vertex data.
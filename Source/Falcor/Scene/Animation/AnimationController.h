@@ -28,11 +28,14 @@
 #pragma once
 #include "Animation.h"
 #include "AnimatedVertexCache.h"
+#include "AnimationEvaluator.h"
+#include "TransformHierarchy.h"
 #include "Core/Macros.h"
 #include "Core/API/Buffer.h"
 #include "Core/Pass/ComputePass.h"
 #include "Utils/Math/Matrix.h"
 #include "Scene/SceneTypes.slang"
+#include <fstd/span.h>
 #include <memory>
 #include <vector>
 
@@ -45,8 +48,8 @@ namespace Falcor
     public:
         ~AnimationController() = default;
 
-        using StaticVertexVector = std::vector<PackedStaticVertexData>;
-        using SkinningVertexVector = std::vector<SkinningVertexData>;
+        using StaticVertexVector = fstd::span<const PackedStaticVertexData>;
+        using SkinningVertexVector = fstd::span<const SkinningVertexData>;
 
         /** Constructor. Throws an exception if creation failed.
         */
@@ -108,7 +111,7 @@ namespace Falcor
 
         /** Check if a matrix changed since last frame.
         */
-        bool isMatrixChanged(NodeID matrixID) const { return mMatricesChanged[matrixID.get()]; }
+        bool isMatrixChanged(NodeID matrixID) const { return mMatricesChanged[matrixID.get()] != 0; }
 
         /** Get the local matrices.
             These represent the current local transform for each scene graph node.
@@ -153,18 +156,20 @@ namespace Falcor
 
         void bindBuffers();
 
-        void createSkinningPass(const std::vector<PackedStaticVertexData>& staticVertexData, const SkinningVertexVector& skinningVertexData);
+        void createSkinningPass(const StaticVertexVector& staticVertexData, const SkinningVertexVector& skinningVertexData);
         void executeSkinningPass(RenderContext* pRenderContext, bool initPrev = false);
 
         ref<Device> mpDevice;
 
         // Animation
         std::vector<ref<Animation>> mAnimations;
+        AnimationEvaluator mAnimationEvaluator;     ///< Batch evaluator for mAnimations, recreated when the animations change.
         std::vector<bool> mNodesEdited;
         std::vector<float4x4> mLocalMatrices;
         std::vector<float4x4> mGlobalMatrices;
         std::vector<float4x4> mInvTransposeGlobalMatrices;
-        std::vector<bool> mMatricesChanged;         ///< Flag per matrix, true if matrix changed since last frame.
+        std::vector<uint8_t> mMatricesChanged;      ///< Flag per matrix, true if matrix changed since last frame. Stored as bytes so that nodes can be updated in parallel.
+        TransformHierarchy mTransformHierarchy;     ///< Level-ordered scene graph used for transform propagation.
 
         bool mFirstUpdate = true;       ///< True if this is the first update.
         bool mEnabled = true;           ///< True if animations are enabled.
@@ -184,6 +189,7 @@ namespace Falcor
         // Skinning
         ref<ComputePass> mpSkinningPass;
         std::vector<float4x4> mMeshBindMatrices; // Optimization TODO: These are only needed per mesh
+        std::vector<float4x4> mLocalToBindSpaceMatrices;
         std::vector<float4x4> mSkinningMatrices;
         std::vector<float4x4> mInvTransposeSkinningMatrices;
         uint32_t mSkinningDispatchSize = 0;
@@ -0,0 +1,357 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "AnimationEvaluator.h"
+#include "Core/Assert.h"
+#include "Core/Errors.h"
+#include "Utils/Threading.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Number of animations interpolated together. Lane arrays of one block live on the stack.
+        const uint32_t kBlockSize = 64;
+
+        // Minimum number of animations per parallel task.
+        const uint32_t kParallelGrainSize = 256;
+
+        // Translation (3), scaling (3) and rotation (4) components of a keyframe.
+        const uint32_t kComponentCount = 10;
+
+        /** Structure-of-arrays data of one block of linearly interpolated animations.
+        */
+        struct LinearBlock
+        {
+            uint32_t count = 0;
+            uint32_t nodeIDs[kBlockSize];
+            float t[kBlockSize];
+            float v0[kComponentCount][kBlockSize];
+            float v1[kComponentCount][kBlockSize];
+            float result[kComponentCount][kBlockSize];
+            float weights[3][kBlockSize];
+        };
+
+        void gather(float (&v)[kComponentCount][kBlockSize], uint32_t lane, const float3& translation, const float3& scaling, const quatf& rotation)
+        {
+            v[0][lane] = translation.x;
+            v[1][lane] = translation.y;
+            v[2][lane] = translation.z;
+            v[3][lane] = scaling.x;
+            v[4][lane] = scaling.y;
+            v[5][lane] = scaling.z;
+            v[6][lane] = rotation.x;
+            v[7][lane] = rotation.y;
+            v[8][lane] = rotation.z;
+            v[9][lane] = rotation.w;
+        }
+
+        /** Interpolate all lanes of a block and write the composed matrices.
+            The arithmetic matches lerp(), slerp(), matrixFromQuat() and the T * R * S product used by Animation::animate().
+        */
+        void interpolateBlock(LinearBlock& block, fstd::span<float4x4> localMatrices)
+        {
+            const uint32_t n = block.count;
+
+            // Translation and scaling.
+            for (uint32_t c = 0; c < 6; ++c)
+            {
+                for (uint32_t k = 0; k < n; ++k)
+                {
+                    block.result[c][k] = (1.f - block.t[k]) * block.v0[c][k] + block.t[k] * block.v1[c][k];
+                }
+            }
+
+            // Rotation. Compute the slerp weights first, the trigonometric functions are evaluated per lane.
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                float t = block.t[k];
+                float cosTheta = (block.v0[9][k] * block.v1[9][k] + block.v0[6][k] * block.v1[6][k]) + (block.v0[7][k] * block.v1[7][k] + block.v0[8][k] * block.v1[8][k]);
+
+                // Take the short way around the sphere.
+                float sign = 1.f;
+                if (cosTheta < 0.f)
+                {
+                    sign = -1.f;
+                    cosTheta = -cosTheta;
+                }
+
+                if (cosTheta > 1.f - std::numeric_limits<float>::epsilon())
+                {
+                    block.weights[0][k] = 1.f - t;
+                    block.weights[1][k] = sign * t;
+                    block.weights[2][k] = 1.f;
+                }
+                else
+                {
+                    float angle = std::acos(cosTheta);
+                    block.weights[0][k] = std::sin((1.f - t) * angle);
+                    block.weights[1][k] = sign * std::sin(t * angle);
+                    block.weights[2][k] = std::sin(angle);
+                }
+            }
+            for (uint32_t c = 6; c < kComponentCount; ++c)
+            {
+                for (uint32_t k = 0; k < n; ++k)
+                {
+                    block.result[c][k] = (block.weights[0][k] * block.v0[c][k] + block.weights[1][k] * block.v1[c][k]) / block.weights[2][k];
+                }
+            }
+
+            // Compose the rotation matrix scaled by column with the translation in the last column.
+            // The results are written to the (no longer needed) input lanes before scattering them.
+            float (&m)[kComponentCount][kBlockSize] = block.v0;
+            float (&m2)[kComponentCount][kBlockSize] = block.v1;
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                float tx = block.result[0][k], ty = block.result[1][k], tz = block.result[2][k];
+                float sx = block.result[3][k], sy = block.result[4][k], sz = block.result[5][k];
+                float qx = block.result[6][k], qy = block.result[7][k], qz = block.result[8][k], qw = block.result[9][k];
+
+                float qxx = qx * qx, qyy = qy * qy, qzz = qz * qz;
+                float qxz = qx * qz, qxy = qx * qy, qyz = qy * qz;
+                float qwx = qw * qx, qwy = qw * qy, qwz = qw * qz;
+
+                m[0][k] = (1.f - 2.f * (qyy + qzz)) * sx;
+                m[1][k] = (2.f * (qxy - qwz)) * sy;
+                m[2][k] = (2.f * (qxz + qwy)) * sz;
+                m[3][k] = tx;
+                m[4][k] = (2.f * (qxy + qwz)) * sx;
+                m[5][k] = (1.f - 2.f * (qxx + qzz)) * sy;
+                m[6][k] = (2.f * (qyz - qwx)) * sz;
+                m[7][k] = ty;
+                m[8][k] = (2.f * (qxz - qwy)) * sx;
+                m2[0][k] = (2.f * (qyz + qwx)) * sy;
+                m2[1][k] = (1.f - 2.f * (qxx + qyy)) * sz;
+                m2[2][k] = tz;
+            }
+
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                float4x4& out = localMatrices[block.nodeIDs[k]];
+                out[0] = float4(m[0][k], m[1][k], m[2][k], m[3][k]);
+                out[1] = float4(m[4][k], m[5][k], m[6][k], m[7][k]);
+                out[2] = float4(m[8][k], m2[0][k], m2[1][k], m2[2][k]);
+                out[3] = float4(0.f, 0.f, 0.f, 1.f);
+            }
+        }
+    }
+
+    AnimationEvaluator::AnimationEvaluator(const std::vector<ref<Animation>>& animations)
+        : mAnimations(animations)
+    {
+        size_t keyframeCount = 0;
+        for (const auto& pAnimation : animations)
+        {
+            if (!pAnimation || pAnimation->mKeyframes.empty()) throw ArgumentError("Animations need at least one keyframe.");
+            keyframeCount += pAnimation->mKeyframes.size();
+        }
+        if (keyframeCount > std::numeric_limits<uint32_t>::max()) throw ArgumentError("Too many keyframes ({}).", keyframeCount);
+
+        mRevisions.reserve(animations.size());
+        mChannels.reserve(animations.size());
+        mTimes.reserve(keyframeCount);
+        mValues.reserve(keyframeCount);
+
+        uint32_t maxNodeID = 0;
+        for (const auto& pAnimation : animations)
+        {
+            Channel channel;
+            channel.offset = (uint32_t)mTimes.size();
+            channel.count = (uint32_t)pAnimation->mKeyframes.size();
+            channel.nodeID = pAnimation->getNodeID().get();
+            channel.linear = pAnimation->getInterpolationMode() == Animation::InterpolationMode::Linear;
+            channel.warping = pAnimation->isWarpingEnabled();
+            channel.preInfinityBehavior = pAnimation->getPreInfinityBehavior();
+            channel.postInfinityBehavior = pAnimation->getPostInfinityBehavior();
+            channel.duration = pAnimation->getDuration();
+            mChannels.push_back(channel);
+            mRevisions.push_back(pAnimation->getRevision());
+            maxNodeID = std::max(maxNodeID, channel.nodeID);
+
+            for (const auto& keyframe : pAnimation->mKeyframes)
+            {
+                mTimes.push_back(keyframe.time);
+                mValues.push_back({ keyframe.translation, keyframe.scaling, keyframe.rotation });
+            }
+        }
+
+        // Animations are applied in order, so only the last animation of each node has a visible effect.
+        // Skipping the others also makes sure that no node is written concurrently.
+        std::vector<bool> nodeAnimated(mChannels.empty() ? 0 : (size_t)maxNodeID + 1, false);
+        for (size_t i = mChannels.size(); i-- > 0;)
+        {
+            uint32_t nodeID = mChannels[i].nodeID;
+            if (nodeAnimated[nodeID]) continue;
+            nodeAnimated[nodeID] = true;
+            mActiveChannels.push_back((uint32_t)i);
+        }
+        std::reverse(mActiveChannels.begin(), mActiveChannels.end());
+
+        mCachedFrames.resize(mChannels.size(), 0);
+    }
+
+    bool AnimationEvaluator::isOutOfDate(const std::vector<ref<Animation>>& animations) const
+    {
+        if (animations.size() != mAnimations.size()) return true;
+        for (size_t i = 0; i < animations.size(); ++i)
+        {
+            if (animations[i] != mAnimations[i] || animations[i]->getRevision() != mRevisions[i]) return true;
+        }
+        return false;
+    }
+
+    void AnimationEvaluator::evaluate(double time, fstd::span<float4x4> localMatrices, fstd::span<uint8_t> changed, bool parallel)
+    {
+        for (uint32_t channelIndex : mActiveChannels)
+        {
+            uint32_t nodeID = mChannels[channelIndex].nodeID;
+            if (nodeID >= localMatrices.size() || nodeID >= changed.size()) throw ArgumentError("Animated node {} is out of range.", nodeID);
+        }
+
+        uint32_t count = (uint32_t)mActiveChannels.size();
+        auto evaluateChunk = [&] (size_t begin, size_t end) { evaluateRange(time, (uint32_t)begin, (uint32_t)end, localMatrices); };
+        if (parallel && count > kParallelGrainSize) Threading::parallelForChunked(0, count, evaluateChunk, kParallelGrainSize);
+        else evaluateChunk(0, count);
+
+        for (uint32_t channelIndex : mActiveChannels) changed[mChannels[channelIndex].nodeID] = 1;
+    }
+
+    float4x4 AnimationEvaluator::evaluate(uint32_t animationIndex, double time) const
+    {
+        if (animationIndex >= mChannels.size()) throw ArgumentError("'animationIndex' ({}) is out of range.", animationIndex);
+
+        // Start with an invalid hint to force a binary search.
+        uint32_t frameHint = std::numeric_limits<uint32_t>::max();
+        Segment segment;
+        if (!findSegment(mChannels[animationIndex], time, frameHint, segment)) return mAnimations[animationIndex]->animate(time);
+
+        LinearBlock block;
+        block.count = 1;
+        block.nodeIDs[0] = 0;
+        block.t[0] = segment.t;
+        const KeyframeValue& v0 = mValues[segment.i0];
+        const KeyframeValue& v1 = mValues[segment.i1];
+        gather(block.v0, 0, v0.translation, v0.scaling, v0.rotation);
+        gather(block.v1, 0, v1.translation, v1.scaling, v1.rotation);
+
+        float4x4 result;
+        interpolateBlock(block, fstd::span<float4x4>(&result, 1));
+        return result;
+    }
+
+    // Locates the keyframe segment of a linearly interpolated animation, following Animation::animate().
+    // Returns false if the animation needs to be evaluated by Animation::animate() instead.
+    bool AnimationEvaluator::findSegment(const Channel& channel, double time, uint32_t& frameHint, Segment& segment) const
+    {
+        const double* times = mTimes.data() + channel.offset;
+        const uint32_t count = channel.count;
+        const double firstTime = times[0];
+        const double lastTime = times[count - 1];
+
+        if (time < firstTime || time > lastTime)
+        {
+            time = Animation::calcSampleTime(time, firstTime, lastTime, channel.preInfinityBehavior, channel.postInfinityBehavior);
+        }
+
+        // Linear extrapolation and Hermite interpolation are not supported.
+        if (count > 1)
+        {
+            if (time < firstTime && channel.preInfinityBehavior == Animation::Behavior::Linear) return false;
+            if (time > lastTime && channel.postInfinityBehavior == Animation::Behavior::Linear) return false;
+        }
+        if (!channel.linear && count >= 4) return false;
+
+        // Find the last keyframe at or before the given time. Check the cached and the next segment before doing a binary search.
+        auto isInSegment = [times, count, time] (uint32_t frame)
+        {
+            return (frame == 0 || times[frame] <= time) && (frame + 1 == count || times[frame + 1] > time);
+        };
+
+        uint32_t frame = std::min(frameHint, count - 1);
+        if (!isInSegment(frame))
+        {
+            if (frame + 1 < count && isInSegment(frame + 1))
+            {
+                frame++;
+            }
+            else
+            {
+                const double* it = std::upper_bound(times, times + count, time);
+                frame = it == times ? 0 : (uint32_t)(it - times) - 1;
+            }
+        }
+        frameHint = frame;
+
+        uint32_t next = channel.warping ? (frame + 1) % count : std::min(frame + 1, count - 1);
+        double segmentDuration = times[next] - times[frame];
+        if (channel.warping && segmentDuration < 0.0) segmentDuration += channel.duration;
+
+        segment.i0 = channel.offset + frame;
+        segment.i1 = channel.offset + next;
+        segment.t = (float)std::clamp(segmentDuration > 0.0 ? (time - times[frame]) / segmentDuration : 1.0, 0.0, 1.0);
+        return true;
+    }
+
+    void AnimationEvaluator::evaluateRange(double time, uint32_t begin, uint32_t end, fstd::span<float4x4> localMatrices)
+    {
+        LinearBlock block;
+
+        for (uint32_t blockBegin = begin; blockBegin < end; blockBegin += kBlockSize)
+        {
+            uint32_t blockEnd = std::min(blockBegin + kBlockSize, end);
+
+            // Locate segments and gather keyframe values into lanes.
+            block.count = 0;
+            for (uint32_t i = blockBegin; i < blockEnd; ++i)
+            {
+                uint32_t channelIndex = mActiveChannels[i];
+                const Channel& channel = mChannels[channelIndex];
+
+                Segment segment;
+                if (!findSegment(channel, time, mCachedFrames[channelIndex], segment))
+                {
+                    localMatrices[channel.nodeID] = mAnimations[channelIndex]->animate(time);
+                    continue;
+                }
+
+                uint32_t lane = block.count++;
+                block.nodeIDs[lane] = channel.nodeID;
+                block.t[lane] = segment.t;
+                const KeyframeValue& v0 = mValues[segment.i0];
+                const KeyframeValue& v1 = mValues[segment.i1];
+                gather(block.v0, lane, v0.translation, v0.scaling, v0.rotation);
+                gather(block.v1, lane, v1.translation, v1.scaling, v1.rotation);
+            }
+
+            interpolateBlock(block, localMatrices);
+        }
+    }
+}
@@ -0,0 +1,135 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Animation.h"
+#include "Core/Macros.h"
+#include "Core/Object.h"
+#include "Utils/Math/Matrix.h"
+#include <fstd/span.h>
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+    /** Batch evaluator for the keyframe animations of a scene.
+
+        The keyframes of all animations are stored in structure-of-arrays form: the keyframe times of
+        all animations are packed into one array that is searched with a binary search, the transforms
+        are stored in a separate array and only read for the two keyframes that are interpolated.
+
+        Animations using linear interpolation (the common case) are evaluated in blocks. The segment
+        of each animation is located first, then interpolation and TRS composition run as tight loops
+        over the block, which the compiler can vectorize. Hermite interpolation and linear
+        extrapolation outside of the keyframe range fall back to Animation::animate().
+
+        The evaluator takes a snapshot of the animations. Use isOutOfDate() to check if the
+        animations were modified and the evaluator needs to be recreated.
+    */
+    class FALCOR_API AnimationEvaluator
+    {
+    public:
+        AnimationEvaluator() = default;
+
+        /** Create the evaluator.
+            \param[in] animations Animations to evaluate. All animations need at least one keyframe.
+        */
+        explicit AnimationEvaluator(const std::vector<ref<Animation>>& animations);
+
+        /** Check if the animations were modified since the evaluator was created.
+            \param[in] animations List of animations, expected to be the same list the evaluator was created from.
+            \return True if the list or any of the animations has changed.
+        */
+        bool isOutOfDate(const std::vector<ref<Animation>>& animations) const;
+
+        /** Evaluate all animations and write the local matrices of the animated nodes.
+            If several animations target the same node, the last one in the list is used.
+            \param[in] time Time in seconds.
+            \param[out] localMatrices Local matrix of each node. Only animated nodes are written.
+            \param[out] changed Flag per node. Set to 1 for all animated nodes.
+            \param[in] parallel If true, large batches are distributed over the thread pool.
+        */
+        void evaluate(double time, fstd::span<float4x4> localMatrices, fstd::span<uint8_t> changed, bool parallel = true);
+
+        /** Evaluate a single animation at an arbitrary time.
+            This uses a binary search only and can be used for random access, e.g. for scrubbing
+            or for sampling several times per frame. The keyframe positions cached by evaluate() are not modified.
+            \param[in] animationIndex Index of the animation in the list the evaluator was created from.
+            \param[in] time Time in seconds.
+            \return The animation's transform matrix for the specified time.
+        */
+        float4x4 evaluate(uint32_t animationIndex, double time) const;
+
+        uint32_t getAnimationCount() const { return (uint32_t)mChannels.size(); }
+        uint32_t getKeyframeCount() const { return (uint32_t)mTimes.size(); }
+
+    private:
+        /** Transform of a keyframe.
+        */
+        struct KeyframeValue
+        {
+            float3 translation;
+            float3 scaling;
+            quatf rotation;
+        };
+
+        /** Per-animation data.
+        */
+        struct Channel
+        {
+            uint32_t offset = 0;                ///< Offset of the first keyframe in mTimes and mValues.
+            uint32_t count = 0;                 ///< Number of keyframes.
+            uint32_t nodeID = 0;                ///< Animated node.
+            bool linear = true;                 ///< True if the animation is interpolated linearly.
+            bool warping = false;               ///< True if warping is enabled.
+            Animation::Behavior preInfinityBehavior = Animation::Behavior::Constant;
+            Animation::Behavior postInfinityBehavior = Animation::Behavior::Constant;
+            double duration = 0.0;              ///< Animation duration, used for warping.
+        };
+
+        /** Segment of a linearly interpolated animation.
+        */
+        struct Segment
+        {
+            uint32_t i0;
+            uint32_t i1;
+            float t;
+        };
+
+        bool findSegment(const Channel& channel, double time, uint32_t& frameHint, Segment& segment) const;
+        void evaluateRange(double time, uint32_t begin, uint32_t end, fstd::span<float4x4> localMatrices);
+
+        std::vector<ref<Animation>> mAnimations;
+        std::vector<uint32_t> mRevisions;       ///< Revision of each animation when the evaluator was created.
+        std::vector<Channel> mChannels;
+        std::vector<uint32_t> mActiveChannels;  ///< Animations that are not overridden by a later animation of the same node.
+        std::vector<uint32_t> mCachedFrames;    ///< Keyframe found in the last evaluation of each animation (relative to its offset).
+
+        std::vector<double> mTimes;             ///< Keyframe times of all animations.
+        std::vector<KeyframeValue> mValues;     ///< Keyframe transforms of all animations.
+    };
+}
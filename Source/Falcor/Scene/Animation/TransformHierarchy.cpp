@@ -0,0 +1,237 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "TransformHierarchy.h"
+#include "Core/Assert.h"
+#include "Core/Errors.h"
+#include "Utils/Threading.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define FALCOR_TRANSFORM_HIERARCHY_SSE 1
+#include <immintrin.h>
+#else
+#define FALCOR_TRANSFORM_HIERARCHY_SSE 0
+#endif
+
+namespace Falcor
+{
+    namespace
+    {
+        // Levels and index ranges with fewer nodes than this are processed on the calling thread.
+        const uint32_t kParallelGrainSize = 2048;
+
+        // Maximum number of levels that are processed level by level before switching to index ranges.
+        const uint32_t kMaxTopLevelCount = 4;
+
+        // Index ranges are only used if the hierarchy splits into at least this many independent pieces.
+        const uint32_t kMinPieceCount = 16;
+
+        /** Multiply two 4x4 matrices using SSE.
+            Rows of the result are linear combinations of the rows of b, accumulated in the same order as math::mul().
+        */
+        float4x4 mulTransform(const float4x4& a, const float4x4& b)
+        {
+#if FALCOR_TRANSFORM_HIERARCHY_SSE
+            const float* pA = a.data();
+            const float* pB = b.data();
+            const __m128 b0 = _mm_loadu_ps(pB);
+            const __m128 b1 = _mm_loadu_ps(pB + 4);
+            const __m128 b2 = _mm_loadu_ps(pB + 8);
+            const __m128 b3 = _mm_loadu_ps(pB + 12);
+
+            float4x4 result;
+            float* pResult = result.data();
+            for (int r = 0; r < 4; ++r)
+            {
+                const float* pRow = pA + 4 * r;
+                __m128 row = _mm_mul_ps(_mm_set1_ps(pRow[0]), b0);
+                row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(pRow[1]), b1));
+                row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(pRow[2]), b2));
+                row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(pRow[3]), b3));
+                _mm_storeu_ps(pResult + 4 * r, row);
+            }
+            return result;
+#else
+            return mul(a, b);
+#endif
+        }
+
+        float4x4 invTransposeTransform(const float4x4& m)
+        {
+            return transpose(isAffine(m) ? inverseAffine(m) : inverse(m));
+        }
+    }
+
+    TransformHierarchy::TransformHierarchy(const std::vector<uint32_t>& parents)
+        : mNodeParents(parents)
+    {
+        const size_t nodeCount = parents.size();
+        if (nodeCount >= kInvalidNode) throw ArgumentError("Transform hierarchy has too many nodes ({}).", nodeCount);
+
+        bool parentsFirst = true;
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            if (parents[i] == kInvalidNode) continue;
+            if (parents[i] >= nodeCount) throw ArgumentError("Node {} has invalid parent index {}.", i, parents[i]);
+            if (parents[i] >= i) parentsFirst = false;
+        }
+
+        // Compute the depth of each node. Walk up from each node until a node with known depth is found,
+        // then assign depths on the way back down. This handles parents stored after their children.
+        mDepths.assign(nodeCount, kInvalidNode);
+        std::vector<uint32_t> path;
+        uint32_t maxDepth = 0;
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            path.clear();
+            uint32_t node = (uint32_t)i;
+            while (node != kInvalidNode && mDepths[node] == kInvalidNode)
+            {
+                path.push_back(node);
+                if (path.size() > nodeCount) throw ArgumentError("Transform hierarchy contains a cycle at node {}.", i);
+                node = parents[node];
+            }
+
+            uint32_t depth = node == kInvalidNode ? 0 : mDepths[node] + 1;
+            for (auto it = path.rbegin(); it != path.rend(); ++it) mDepths[*it] = depth++;
+            if (!path.empty()) maxDepth = std::max(maxDepth, mDepths[path.front()]);
+        }
+
+        // Counting sort of the nodes by depth (stable, so nodes within a level stay in index order).
+        mLevelOffsets.assign(nodeCount > 0 ? maxDepth + 2 : 1, 0);
+        for (uint32_t depth : mDepths) mLevelOffsets[depth + 1]++;
+        for (size_t level = 1; level < mLevelOffsets.size(); ++level) mLevelOffsets[level] += mLevelOffsets[level - 1];
+
+        mLevelNodes.resize(nodeCount);
+        std::vector<uint32_t> cursor(mLevelOffsets.begin(), mLevelOffsets.end() - 1);
+        for (size_t i = 0; i < nodeCount; ++i) mLevelNodes[cursor[mDepths[i]]++] = (uint32_t)i;
+
+        chooseRanges(parentsFirst);
+    }
+
+    void TransformHierarchy::chooseRanges(bool parentsFirst)
+    {
+        // Default to processing all levels level by level.
+        mTopLevelCount = getLevelCount();
+        mRangeOffsets.clear();
+        const uint32_t nodeCount = getNodeCount();
+        if (!parentsFirst || nodeCount == 0) return;
+
+        const uint32_t maxPieceSize = std::max<uint32_t>((uint32_t)kParallelGrainSize, nodeCount / kMinPieceCount);
+        std::vector<uint32_t> splits;
+
+        for (uint32_t topLevelCount = 0; topLevelCount <= std::min(kMaxTopLevelCount, getLevelCount()); ++topLevelCount)
+        {
+            // The index range can be split before node s if no node at or after s has a parent before s.
+            // Parents in the top levels are updated up front and don't prevent a split.
+            splits.clear();
+            uint32_t minParent = nodeCount;
+            for (uint32_t s = nodeCount; s-- > 0;)
+            {
+                uint32_t parent = mNodeParents[s];
+                if (mDepths[s] >= topLevelCount && parent != kInvalidNode && mDepths[parent] >= topLevelCount) minParent = std::min(minParent, parent);
+                if (minParent >= s) splits.push_back(s);
+            }
+            std::reverse(splits.begin(), splits.end());
+            FALCOR_ASSERT(!splits.empty() && splits.front() == 0);
+
+            uint32_t maxSize = nodeCount - splits.back();
+            for (size_t i = 0; i + 1 < splits.size(); ++i) maxSize = std::max(maxSize, splits[i + 1] - splits[i]);
+            if (maxSize > maxPieceSize) continue;
+
+            // Merge the independent pieces into ranges of at least kParallelGrainSize nodes.
+            mTopLevelCount = topLevelCount;
+            mRangeOffsets.push_back(0);
+            for (uint32_t split : splits)
+            {
+                if (split - mRangeOffsets.back() >= kParallelGrainSize) mRangeOffsets.push_back(split);
+            }
+            if (mRangeOffsets.back() != nodeCount) mRangeOffsets.push_back(nodeCount);
+            return;
+        }
+    }
+
+    void TransformHierarchy::propagate(const Matrices& matrices, fstd::span<uint8_t> changed, bool updateAll, bool parallel) const
+    {
+        const size_t nodeCount = mNodeParents.size();
+        FALCOR_ASSERT(matrices.local.size() == nodeCount && matrices.global.size() == nodeCount && matrices.invTransposeGlobal.size() == nodeCount);
+        FALCOR_ASSERT(changed.size() == nodeCount);
+
+        const bool updateSkinning = !matrices.skinning.empty();
+        FALCOR_ASSERT(!updateSkinning || (matrices.localToBindSpace.size() == nodeCount && matrices.skinning.size() == nodeCount && matrices.invTransposeSkinning.size() == nodeCount));
+
+        auto updateNode = [&](uint32_t node)
+        {
+            const uint32_t parent = mNodeParents[node];
+
+            // Propagate matrix change flag to children.
+            if (parent != kInvalidNode) changed[node] |= changed[parent];
+
+            if (!changed[node] && !updateAll) return;
+
+            const float4x4 global = parent != kInvalidNode ? mulTransform(matrices.global[parent], matrices.local[node]) : matrices.local[node];
+            matrices.global[node] = global;
+            matrices.invTransposeGlobal[node] = invTransposeTransform(global);
+
+            if (updateSkinning)
+            {
+                const float4x4 skinning = mulTransform(global, matrices.localToBindSpace[node]);
+                matrices.skinning[node] = skinning;
+                matrices.invTransposeSkinning[node] = invTransposeTransform(skinning);
+            }
+        };
+
+        // Process the top levels in order. All parents of a level have been updated by the previous levels.
+        auto updateLevelNodes = [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) updateNode(mLevelNodes[i]);
+        };
+        for (uint32_t level = 0; level < mTopLevelCount; ++level)
+        {
+            const size_t begin = mLevelOffsets[level];
+            const size_t end = mLevelOffsets[level + 1];
+            if (parallel && end - begin > kParallelGrainSize) Threading::parallelForChunked(begin, end, updateLevelNodes, kParallelGrainSize);
+            else updateLevelNodes(begin, end);
+        }
+
+        // Process the remaining nodes in independent index ranges.
+        auto updateRanges = [&](size_t begin, size_t end)
+        {
+            for (size_t range = begin; range < end; ++range)
+            {
+                for (uint32_t node = mRangeOffsets[range]; node < mRangeOffsets[range + 1]; ++node)
+                {
+                    if (mDepths[node] >= mTopLevelCount) updateNode(node);
+                }
+            }
+        };
+        const size_t rangeCount = getRangeCount();
+        if (parallel && rangeCount > 1) Threading::parallelForChunked(0, rangeCount, updateRanges, 1);
+        else updateRanges(0, rangeCount);
+    }
+}
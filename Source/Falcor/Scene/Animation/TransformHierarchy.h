@@ -0,0 +1,107 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Utils/Math/Matrix.h"
+#include <fstd/span.h>
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+    /** Level-ordered layout of a transform hierarchy (scene graph) for parallel transform propagation.
+
+        Nodes are grouped by their depth in the hierarchy. Nodes of one level only depend on nodes of
+        previous levels, so all nodes of a level can be updated in parallel. Node indices themselves are
+        not changed, the layout only stores the order in which nodes are visited.
+
+        Visiting a whole level touches nodes spread over the entire index range, which is slow for large
+        scene graphs. If parents are stored before their children (as done by SceneBuilder), only the first
+        few levels are therefore processed level by level. Below these levels, the hierarchy is split into
+        contiguous index ranges that contain complete subtrees (e.g. one skeleton each). The ranges are
+        independent and are processed in parallel, each one sequentially in index order.
+    */
+    class FALCOR_API TransformHierarchy
+    {
+    public:
+        static constexpr uint32_t kInvalidNode = 0xffffffff;
+
+        /** Matrices read and written during propagation. All spans are indexed by node.
+        */
+        struct Matrices
+        {
+            fstd::span<const float4x4> local;               ///< Local transform of each node.
+            fstd::span<float4x4> global;                    ///< Output object-to-world transform.
+            fstd::span<float4x4> invTransposeGlobal;        ///< Output inverse transpose of the global transform.
+
+            // Optional skinning matrices. Leave empty if the scene has no skinned meshes.
+            fstd::span<const float4x4> localToBindSpace;    ///< Skeleton to bind space transform of each node.
+            fstd::span<float4x4> skinning;                  ///< Output global transform multiplied by localToBindSpace.
+            fstd::span<float4x4> invTransposeSkinning;      ///< Output inverse transpose of the skinning transform.
+        };
+
+        TransformHierarchy() = default;
+
+        /** Create the level-ordered layout.
+            \param[in] parents Parent index of each node, or kInvalidNode for root nodes.
+            Throws an ArgumentError if a parent index is out of range or the hierarchy contains a cycle.
+        */
+        explicit TransformHierarchy(const std::vector<uint32_t>& parents);
+
+        /** Propagate transforms from the local matrices to all output matrices.
+            \param[in] matrices Input and output matrices.
+            \param[in,out] changed Flag per node. On input, marks nodes whose local matrix changed.
+                On output, the flags are propagated to all descendants of changed nodes.
+            \param[in] updateAll If true, all nodes are updated regardless of their changed flag.
+            \param[in] parallel If true, large levels are distributed over the thread pool.
+        */
+        void propagate(const Matrices& matrices, fstd::span<uint8_t> changed, bool updateAll, bool parallel = true) const;
+
+        uint32_t getNodeCount() const { return (uint32_t)mNodeParents.size(); }
+        uint32_t getLevelCount() const { return (uint32_t)mLevelOffsets.size() - 1; }
+
+        /** Get the number of levels that are processed level by level. The remaining levels are processed as independent index ranges.
+        */
+        uint32_t getTopLevelCount() const { return mTopLevelCount; }
+
+        /** Get the number of independent index ranges below the top levels.
+        */
+        uint32_t getRangeCount() const { return mRangeOffsets.empty() ? 0 : (uint32_t)mRangeOffsets.size() - 1; }
+
+    private:
+        void chooseRanges(bool parentsFirst);
+
+        std::vector<uint32_t> mNodeParents;         ///< Parent index of each node.
+        std::vector<uint32_t> mDepths;              ///< Depth of each node.
+
+        std::vector<uint32_t> mLevelNodes;          ///< Node indices sorted by level. Within a level, nodes are sorted by index.
+        std::vector<uint32_t> mLevelOffsets = {0};  ///< Offset of each level in mLevelNodes, followed by the node count.
+        uint32_t mTopLevelCount = 0;                ///< Number of levels processed level by level.
+        std::vector<uint32_t> mRangeOffsets;        ///< Boundaries of the independent node index ranges below the top levels.
+    };
+}
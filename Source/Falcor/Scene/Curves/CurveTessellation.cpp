@@ -32,15 +32,20 @@
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/Matrix.h"
 #include "Utils/Math/Quaternion.h"
+#include "Utils/ScratchArena.h"
+#include "Utils/Threading.h"
 #include <cmath>
+#include <memory_resource>
 
 namespace Falcor
 {
     struct StrandArrays {
-        std::vector<float3> controlPoints;
-        std::vector<float>  widths;
-        std::vector<float2> UVs;
+        std::pmr::vector<float3> controlPoints;
+        std::pmr::vector<float>  widths;
+        std::pmr::vector<float2> UVs;
         uint32_t vertexCount { 0 };
+
+        explicit StrandArrays(std::pmr::memory_resource* pResource) : controlPoints(pResource), widths(pResource), UVs(pResource) {}
     };
 
     struct CurveArrays {
@@ -59,10 +64,6 @@ namespace Falcor
 
     struct CubicSplineCache
     {
-        CubicSpline<float3> optSplinePoints;
-        CubicSpline<float>  optSplineWidths;
-        CubicSpline<float2> optSplineUVs;
-
         CubicSpline<float3> splinePoints;
         CubicSpline<float>  splineWidths;
         CubicSpline<float2> splineUVs;
@@ -74,6 +75,56 @@ namespace Falcor
         // To achieve curveWidth on average, however, we need to scale the initial curveWidth by 1.11 (the number was deducted numerically).
         const float kMeshCompensationScale = 1.11f;
 
+        // Number of kept strands tessellated by a single task.
+        const size_t kStrandsPerTask = 256;
+
+        struct StrandLayout
+        {
+            uint32_t pointOffset;   ///< Offset of the first control point of the strand in the input arrays.
+            uint32_t outputOffset;  ///< Offset of the first tessellated point of the strand in the output.
+        };
+
+        /** Computes where the kept strands read their control points from and where their tessellated points go.
+            Each kept strand i = s * keepOneEveryXStrands produces one point per kept sub-segment of its deduplicated control points plus the last point.
+            The layout has one extra entry at the end holding the totals, so the output point count of kept strand s is layout[s + 1].outputOffset - layout[s].outputOffset.
+        */
+        std::vector<StrandLayout> computeStrandLayout(uint32_t strandCount, const uint32_t* vertexCountsPerStrand, const float3* controlPoints, uint32_t subdivPerSegment, uint32_t keepOneEveryXStrands, uint32_t keepOneEveryXVerticesPerStrand)
+        {
+            const uint32_t keptStrandCount = div_round_up(strandCount, keepOneEveryXStrands);
+            std::vector<StrandLayout> layout(keptStrandCount + 1);
+
+            uint32_t pointOffset = 0;
+            for (uint32_t i = 0; i < strandCount; i++)
+            {
+                if (i % keepOneEveryXStrands == 0) layout[i / keepOneEveryXStrands].pointOffset = pointOffset;
+                pointOffset += vertexCountsPerStrand[i];
+            }
+            layout[keptStrandCount].pointOffset = pointOffset;
+
+            // Count the output points of each strand, this requires removing duplicated control points first.
+            Threading::parallelFor(0, keptStrandCount, [&](size_t s)
+            {
+                const float3* points = controlPoints + layout[s].pointOffset;
+                const uint32_t vertexCount = vertexCountsPerStrand[s * keepOneEveryXStrands];
+                uint32_t uniqueCount = 1;
+                for (uint32_t j = 0; j < vertexCount - 1; j++)
+                {
+                    if (any(points[j] != points[j + 1])) uniqueCount++;
+                }
+                layout[s].outputOffset = div_round_up(subdivPerSegment * (uniqueCount - 1), keepOneEveryXVerticesPerStrand) + 1;
+            }, kStrandsPerTask);
+
+            uint32_t outputOffset = 0;
+            for (uint32_t s = 0; s <= keptStrandCount; s++)
+            {
+                uint32_t count = layout[s].outputOffset;
+                layout[s].outputOffset = outputOffset;
+                if (s < keptStrandCount) outputOffset += count;
+            }
+
+            return layout;
+        }
+
         float4 transformSphere(const float4x4& xform, const float4& sphere)
         {
             // Spheres are represented as (center.x, center.y, center.z, radius).
@@ -91,7 +142,7 @@ namespace Falcor
 #endif
         }
 
-        void optimizeStrandGeometry(CubicSplineCache& splineCache, const CurveArrays& curveArrays, StrandArrays& strandArrays, StrandArrays& optimizedStrandArrays, uint32_t pointOffset, uint32_t subdivPerSegment, uint32_t keepOneEveryXVerticesPerStrand, float widthScale)
+        void removeDuplicatePoints(const CurveArrays& curveArrays, StrandArrays& strandArrays, uint32_t pointOffset)
         {
             strandArrays.controlPoints.clear();
             strandArrays.UVs.clear();
@@ -112,11 +163,16 @@ namespace Falcor
             strandArrays.controlPoints.push_back(curveArrays.controlPoints[pointOffset + strandArrays.vertexCount - 1]);
             strandArrays.widths.push_back(curveArrays.widths[pointOffset + strandArrays.vertexCount - 1]);
             if (curveArrays.UVs) strandArrays.UVs.push_back(curveArrays.UVs[pointOffset + strandArrays.vertexCount - 1]);
+        }
+
+        void optimizeStrandGeometry(CubicSplineCache& splineCache, const CurveArrays& curveArrays, StrandArrays& strandArrays, StrandArrays& optimizedStrandArrays, uint32_t pointOffset, uint32_t subdivPerSegment, uint32_t keepOneEveryXVerticesPerStrand, float widthScale)
+        {
+            removeDuplicatePoints(curveArrays, strandArrays, pointOffset);
 
             optimizedStrandArrays.vertexCount = static_cast<uint32_t>(strandArrays.controlPoints.size());
 
-            const CubicSpline<float3>& splinePoints = splineCache.optSplinePoints.setup(strandArrays.controlPoints.data(), optimizedStrandArrays.vertexCount);
-            const CubicSpline<float>& splineWidths = splineCache.optSplineWidths.setup(strandArrays.widths.data(), optimizedStrandArrays.vertexCount);
+            const CubicSpline<float3>& splinePoints = splineCache.splinePoints.setup(strandArrays.controlPoints.data(), optimizedStrandArrays.vertexCount);
+            const CubicSpline<float>& splineWidths = splineCache.splineWidths.setup(strandArrays.widths.data(), optimizedStrandArrays.vertexCount);
 
             uint32_t tmpCount = 0;
             for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
@@ -140,7 +196,7 @@ namespace Falcor
             // Texture coordinates.
             if (curveArrays.UVs)
             {
-                const CubicSpline<float2>& splineUVs = splineCache.optSplineUVs.setup(strandArrays.UVs.data(), optimizedStrandArrays.vertexCount);
+                const CubicSpline<float2>& splineUVs = splineCache.splineUVs.setup(strandArrays.UVs.data(), optimizedStrandArrays.vertexCount);
                 tmpCount = 0;
                 for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
                 {
@@ -191,40 +247,44 @@ namespace Falcor
             t = mul(rotQuat, t);
         }
 
-        void updateMeshResultBuffers(CurveTessellation::MeshResult& result, const CurveArrays& curveArrays, StrandArrays& optimizedStrandArrays, const float3& fwd, const float3& s, const float3& t, uint32_t pointCountPerCrossSection, const float& widthScale, uint32_t j)
+        // The result buffers are sized up front, the writers below fill them in place starting at the given element index.
+
+        void updateMeshResultBuffers(CurveTessellation::MeshResult& result, size_t& vertexIndex, const CurveArrays& curveArrays, StrandArrays& optimizedStrandArrays, const float3& fwd, const float3& s, const float3& t, uint32_t pointCountPerCrossSection, const float& widthScale, uint32_t j)
         {
             // Mesh vertices, normals, tangents, and texCrds (if any).
-            for (uint32_t k = 0; k < pointCountPerCrossSection; k++)
+            for (uint32_t k = 0; k < pointCountPerCrossSection; k++, vertexIndex++)
             {
                 float phi = (float)k / (float)pointCountPerCrossSection * (float)M_PI * 2.f;
                 float3 vNormal = std::cos(phi) * s + std::sin(phi) * t;
 
                 float curveRadius = 0.5f * optimizedStrandArrays.widths[j];
-                result.vertices.push_back(optimizedStrandArrays.controlPoints[j] + curveRadius * vNormal);
-                result.normals.push_back(vNormal);
-                result.tangents.push_back(float4(fwd.x, fwd.y, fwd.z, 1));
-                result.radii.push_back(curveRadius);
+                result.vertices[vertexIndex] = optimizedStrandArrays.controlPoints[j] + curveRadius * vNormal;
+                result.normals[vertexIndex] = vNormal;
+                result.tangents[vertexIndex] = float4(fwd.x, fwd.y, fwd.z, 1);
+                result.radii[vertexIndex] = curveRadius;
 
                 if (curveArrays.UVs)
                 {
-                    result.texCrds.push_back(optimizedStrandArrays.UVs[j]);
+                    result.texCrds[vertexIndex] = optimizedStrandArrays.UVs[j];
                 }
             }
         }
 
-        void connectFaceVertices(CurveTessellation::MeshResult& result, uint32_t meshVertexOffset, uint32_t pointCountPerCrossSection, uint32_t quadCountLimit, uint32_t nextCrossSectionVertexOffset, uint32_t multiplier, uint32_t j)
+        void connectFaceVertices(CurveTessellation::MeshResult& result, size_t& faceIndex, uint32_t meshVertexOffset, uint32_t pointCountPerCrossSection, uint32_t quadCountLimit, uint32_t nextCrossSectionVertexOffset, uint32_t multiplier, uint32_t j)
         {
-            for (uint32_t k = 0; k < quadCountLimit; k++)
+            for (uint32_t k = 0; k < quadCountLimit; k++, faceIndex += 2)
             {
-                result.faceVertexCounts.push_back(3);
-                result.faceVertexIndices.push_back(meshVertexOffset + multiplier * j * pointCountPerCrossSection + k);
-                result.faceVertexIndices.push_back(meshVertexOffset + multiplier * j * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection);
-                result.faceVertexIndices.push_back(meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection);
-
-                result.faceVertexCounts.push_back(3);
-                result.faceVertexIndices.push_back(meshVertexOffset + multiplier * j * pointCountPerCrossSection + k);
-                result.faceVertexIndices.push_back(meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection);
-                result.faceVertexIndices.push_back(meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + k);
+                uint32_t* indices = &result.faceVertexIndices[3 * faceIndex];
+
+                result.faceVertexCounts[faceIndex] = 3;
+                indices[0] = meshVertexOffset + multiplier * j * pointCountPerCrossSection + k;
+                indices[1] = meshVertexOffset + multiplier * j * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection;
+                indices[2] = meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection;
+
+                result.faceVertexCounts[faceIndex + 1] = 3;
+                indices[3] = meshVertexOffset + multiplier * j * pointCountPerCrossSection + k;
+                indices[4] = meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection;
+                indices[5] = meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + k;
             }
         }
     }
@@ -238,93 +298,90 @@ namespace Falcor
         FALCOR_ASSERT(degree == 1);
         result.degree = degree;
 
-        uint32_t pointCounts = 0;
-        uint32_t segCounts = 0;
-        uint32_t maxVertexCountsPerStrand = 0;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
-        {
-            uint32_t tmpPointCount = div_round_up(subdivPerSegment * (vertexCountsPerStrand[i] - 1), keepOneEveryXVerticesPerStrand) + 1;
-            pointCounts += tmpPointCount;
-            segCounts += tmpPointCount - 1;
-            maxVertexCountsPerStrand = std::max(maxVertexCountsPerStrand, vertexCountsPerStrand[i]);
-        }
-        result.indices.reserve(segCounts);
-        result.points.reserve(pointCounts);
-        result.radius.reserve(pointCounts);
-        result.texCrds.reserve(pointCounts);
+        // Strands are tessellated in parallel, each one writes to its own range of the output.
+        // Strand s owns the points [outputOffset(s), outputOffset(s + 1)) and one segment index for all but its last point.
+        const std::vector<StrandLayout> layout = computeStrandLayout(strandCount, vertexCountsPerStrand, controlPoints, subdivPerSegment, keepOneEveryXStrands, keepOneEveryXVerticesPerStrand);
+        const size_t keptStrandCount = layout.size() - 1;
+        const uint32_t pointCounts = layout.back().outputOffset;
 
-        uint32_t pointOffset = 0;
+        result.indices.resize(pointCounts - keptStrandCount);
+        result.points.resize(pointCounts);
+        result.radius.resize(pointCounts);
+        if (UVs) result.texCrds.resize(pointCounts);
 
-        StrandArrays strandArrays;
-        strandArrays.controlPoints.reserve(maxVertexCountsPerStrand);
-        strandArrays.widths.reserve(maxVertexCountsPerStrand);
-        strandArrays.UVs.reserve(maxVertexCountsPerStrand);
         CurveArrays curveArrays(controlPoints, widths, UVs);
 
-        StrandArrays optimizedStrandArrays;
-        CubicSplineCache splineCache;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
+        Threading::parallelForChunked(0, keptStrandCount, [&](size_t begin, size_t end)
         {
-            optimizedStrandArrays.controlPoints.clear();
-            optimizedStrandArrays.UVs.clear();
-            optimizedStrandArrays.widths.clear();
-            optimizedStrandArrays.vertexCount = 0;
-            strandArrays.vertexCount = vertexCountsPerStrand[i];
-
-            optimizeStrandGeometry(splineCache, curveArrays, strandArrays, optimizedStrandArrays, pointOffset, subdivPerSegment, keepOneEveryXVerticesPerStrand, widthScale);
-
-            const CubicSpline<float3>& splinePoints = splineCache.splinePoints.setup(strandArrays.controlPoints.data(), optimizedStrandArrays.vertexCount);
-            const CubicSpline<float>& splineWidths = splineCache.splineWidths.setup(strandArrays.widths.data(), optimizedStrandArrays.vertexCount);
+            ScratchArena& arena = ScratchArena::getThreadLocal();
+            ScratchArena::Scope scope(arena);
 
-            uint32_t tmpCount = 0;
-            for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
+            StrandArrays strandArrays(&arena);
+            CubicSplineCache splineCache;
+            for (size_t s = begin; s < end; s++)
             {
-                for (uint32_t k = 0; k < subdivPerSegment; k++)
-                {
-                    if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
-                    {
-                        float t = (float)k / (float)subdivPerSegment;
-                        result.indices.push_back((uint32_t)result.points.size());
-
-                        // Pre-transform curve points.
-                        float4 sph = transformSphere(xform, float4(splinePoints.interpolate(j, t), splineWidths.interpolate(j, t) * 0.5f * widthScale));
+                strandArrays.vertexCount = vertexCountsPerStrand[s * keepOneEveryXStrands];
+                removeDuplicatePoints(curveArrays, strandArrays, layout[s].pointOffset);
+                const uint32_t vertexCount = static_cast<uint32_t>(strandArrays.controlPoints.size());
 
-                        result.points.push_back(sph.xyz());
-                        result.radius.push_back(sph.w);
-                    }
-                    tmpCount++;
-                }
-            }
+                const CubicSpline<float3>& splinePoints = splineCache.splinePoints.setup(strandArrays.controlPoints.data(), vertexCount);
+                const CubicSpline<float>& splineWidths = splineCache.splineWidths.setup(strandArrays.widths.data(), vertexCount);
 
-            // Always keep the last vertex.
-            float4 sph = transformSphere(xform, float4(splinePoints.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f), splineWidths.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f) * 0.5f * widthScale));
-            result.points.push_back(sph.xyz());
-            result.radius.push_back(sph.w);
+                const uint32_t strandOffset = layout[s].outputOffset;
+                uint32_t pointIndex = strandOffset;
+                size_t segmentIndex = strandOffset - s;
 
-            // Texture coordinates.
-            if (UVs)
-            {
-                const CubicSpline<float2>& splineUVs = splineCache.splineUVs.setup(strandArrays.UVs.data(), optimizedStrandArrays.vertexCount);
-                tmpCount = 0;
-                for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
+                uint32_t tmpCount = 0;
+                for (uint32_t j = 0; j < vertexCount - 1; j++)
                 {
                     for (uint32_t k = 0; k < subdivPerSegment; k++)
                     {
                         if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
                         {
                             float t = (float)k / (float)subdivPerSegment;
-                            result.texCrds.push_back(splineUVs.interpolate(j, t));
+                            result.indices[segmentIndex++] = pointIndex;
+
+                            // Pre-transform curve points.
+                            float4 sph = transformSphere(xform, float4(splinePoints.interpolate(j, t), splineWidths.interpolate(j, t) * 0.5f * widthScale));
+
+                            result.points[pointIndex] = sph.xyz();
+                            result.radius[pointIndex] = sph.w;
+                            pointIndex++;
                         }
                         tmpCount++;
                     }
                 }
 
                 // Always keep the last vertex.
-                result.texCrds.push_back(splineUVs.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f));
-            }
+                float4 sph = transformSphere(xform, float4(splinePoints.interpolate(vertexCount - 2, 1.f), splineWidths.interpolate(vertexCount - 2, 1.f) * 0.5f * widthScale));
+                result.points[pointIndex] = sph.xyz();
+                result.radius[pointIndex] = sph.w;
+                FALCOR_ASSERT(pointIndex + 1 == layout[s + 1].outputOffset);
 
-            for (uint32_t j = i; j < std::min(strandCount, i + keepOneEveryXStrands); j++) pointOffset += vertexCountsPerStrand[j];
-        }
+                // Texture coordinates.
+                if (UVs)
+                {
+                    const CubicSpline<float2>& splineUVs = splineCache.splineUVs.setup(strandArrays.UVs.data(), vertexCount);
+                    pointIndex = strandOffset;
+                    tmpCount = 0;
+                    for (uint32_t j = 0; j < vertexCount - 1; j++)
+                    {
+                        for (uint32_t k = 0; k < subdivPerSegment; k++)
+                        {
+                            if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
+                            {
+                                float t = (float)k / (float)subdivPerSegment;
+                                result.texCrds[pointIndex++] = splineUVs.interpolate(j, t);
+                            }
+                            tmpCount++;
+                        }
+                    }
+
+                    // Always keep the last vertex.
+                    result.texCrds[pointIndex] = splineUVs.interpolate(vertexCount - 2, 1.f);
+                }
+            }
+        }, kStrandsPerTask);
 
         return result;
     }
@@ -332,74 +389,72 @@ namespace Falcor
     CurveTessellation::MeshResult CurveTessellation::convertToPolytube(uint32_t strandCount, const uint32_t* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t subdivPerSegment, uint32_t keepOneEveryXStrands, uint32_t keepOneEveryXVerticesPerStrand, float widthScale, uint32_t pointCountPerCrossSection)
     {
         MeshResult result;
-        uint32_t vertexCounts = 0;
-        uint32_t faceCounts = 0;
-        uint32_t maxVertexCountsPerStrand = 0;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
-        {
-            uint32_t tmpPointCount = div_round_up(subdivPerSegment * (vertexCountsPerStrand[i] - 1), keepOneEveryXVerticesPerStrand) + 1;
-            vertexCounts += pointCountPerCrossSection * tmpPointCount;
-            faceCounts += 2 * pointCountPerCrossSection * (tmpPointCount - 1);
-            maxVertexCountsPerStrand = std::max(maxVertexCountsPerStrand, vertexCountsPerStrand[i]);
-        }
-        result.vertices.reserve(vertexCounts);
-        result.normals.reserve(vertexCounts);
-        result.tangents.reserve(vertexCounts);
-        result.texCrds.reserve(vertexCounts);
-        result.radii.reserve(vertexCounts);
-        result.faceVertexCounts.reserve(faceCounts);
-        result.faceVertexIndices.reserve(faceCounts * 3);
-
-        uint32_t pointOffset = 0;
-        uint32_t meshVertexOffset = 0;
-
-        StrandArrays strandArrays;
-        strandArrays.controlPoints.reserve(maxVertexCountsPerStrand);
-        strandArrays.widths.reserve(maxVertexCountsPerStrand);
-        strandArrays.UVs.reserve(maxVertexCountsPerStrand);
+
+        // Strands are tessellated in parallel, each one writes to its own range of the output.
+        // Strand s owns the cross-sections [outputOffset(s), outputOffset(s + 1)) and two triangles per point for all but its last cross-section.
+        const std::vector<StrandLayout> layout = computeStrandLayout(strandCount, vertexCountsPerStrand, controlPoints, subdivPerSegment, keepOneEveryXStrands, keepOneEveryXVerticesPerStrand);
+        const size_t keptStrandCount = layout.size() - 1;
+        const uint32_t vertexCounts = pointCountPerCrossSection * layout.back().outputOffset;
+        const uint32_t faceCounts = 2 * pointCountPerCrossSection * (layout.back().outputOffset - (uint32_t)keptStrandCount);
+
+        result.vertices.resize(vertexCounts);
+        result.normals.resize(vertexCounts);
+        result.tangents.resize(vertexCounts);
+        if (UVs) result.texCrds.resize(vertexCounts);
+        result.radii.resize(vertexCounts);
+        result.faceVertexCounts.resize(faceCounts);
+        result.faceVertexIndices.resize(faceCounts * 3);
+
         CurveArrays curveArrays(controlPoints, widths, UVs);
 
-        StrandArrays optimizedStrandArrays;
-        CubicSplineCache splineCache;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
+        Threading::parallelForChunked(0, keptStrandCount, [&](size_t begin, size_t end)
         {
-            optimizedStrandArrays.controlPoints.clear();
-            optimizedStrandArrays.UVs.clear();
-            optimizedStrandArrays.widths.clear();
-            optimizedStrandArrays.vertexCount = 0;
-
-            strandArrays.vertexCount = vertexCountsPerStrand[i];
+            ScratchArena& arena = ScratchArena::getThreadLocal();
+            ScratchArena::Scope scope(arena);
 
-            optimizeStrandGeometry(splineCache, curveArrays, strandArrays, optimizedStrandArrays, pointOffset, subdivPerSegment, keepOneEveryXVerticesPerStrand, widthScale);
+            StrandArrays strandArrays(&arena);
+            StrandArrays optimizedStrandArrays(&arena);
+            CubicSplineCache splineCache;
+            for (size_t i = begin; i < end; i++)
+            {
+                optimizedStrandArrays.controlPoints.clear();
+                optimizedStrandArrays.UVs.clear();
+                optimizedStrandArrays.widths.clear();
+                optimizedStrandArrays.vertexCount = 0;
 
-            for (uint32_t j = i; j < std::min(strandCount, i + keepOneEveryXStrands); j++) pointOffset += vertexCountsPerStrand[j];
+                strandArrays.vertexCount = vertexCountsPerStrand[i * keepOneEveryXStrands];
 
-            // Build the initial frame.
-            float3 fwd, s, t;
-            fwd = normalize(optimizedStrandArrays.controlPoints[1] - optimizedStrandArrays.controlPoints[0]);
-            buildFrame(fwd, s, t);
+                optimizeStrandGeometry(splineCache, curveArrays, strandArrays, optimizedStrandArrays, layout[i].pointOffset, subdivPerSegment, keepOneEveryXVerticesPerStrand, widthScale);
+                FALCOR_ASSERT(optimizedStrandArrays.controlPoints.size() == layout[i + 1].outputOffset - layout[i].outputOffset);
 
-            // Create mesh.
-            for (uint32_t j = 0; j < optimizedStrandArrays.controlPoints.size(); j++)
-            {
-                // Update the curve's frame vectors: [fwd, s, t]
-                updateCurveFrame(optimizedStrandArrays, fwd, s, t, j);
+                const uint32_t meshVertexOffset = pointCountPerCrossSection * layout[i].outputOffset;
+                size_t vertexIndex = meshVertexOffset;
+                size_t faceIndex = 2 * pointCountPerCrossSection * (size_t)(layout[i].outputOffset - i);
 
-                // Mesh vertices, normals, tangents, and texCrds (if any).
-                updateMeshResultBuffers(result, curveArrays, optimizedStrandArrays, fwd, s, t, pointCountPerCrossSection, widthScale, j);
+                // Build the initial frame.
+                float3 fwd, s, t;
+                fwd = normalize(optimizedStrandArrays.controlPoints[1] - optimizedStrandArrays.controlPoints[0]);
+                buildFrame(fwd, s, t);
 
-                // Mesh faces.
-                if (j < optimizedStrandArrays.controlPoints.size() - 1)
+                // Create mesh.
+                for (uint32_t j = 0; j < optimizedStrandArrays.controlPoints.size(); j++)
                 {
-                    uint32_t quadCountLimit = pointCountPerCrossSection;
-                    connectFaceVertices(result, meshVertexOffset, pointCountPerCrossSection, quadCountLimit, 1, 1, j);
+                    // Update the curve's frame vectors: [fwd, s, t]
+                    updateCurveFrame(optimizedStrandArrays, fwd, s, t, j);
+
+                    // Mesh vertices, normals, tangents, and texCrds (if any).
+                    updateMeshResultBuffers(result, vertexIndex, curveArrays, optimizedStrandArrays, fwd, s, t, pointCountPerCrossSection, widthScale, j);
+
+                    // Mesh faces.
+                    if (j < optimizedStrandArrays.controlPoints.size() - 1)
+                    {
+                        uint32_t quadCountLimit = pointCountPerCrossSection;
+                        connectFaceVertices(result, faceIndex, meshVertexOffset, pointCountPerCrossSection, quadCountLimit, 1, 1, j);
+                    }
                 }
             }
+        }, kStrandsPerTask);
 
-            meshVertexOffset += pointCountPerCrossSection * (uint32_t)optimizedStrandArrays.controlPoints.size();
-        }
         return result;
     }
-
-
 }
@@ -608,6 +608,32 @@ namespace Falcor
         return true;
     }
 
+    uint64_t BasicMaterial::computeHash() const
+    {
+        FNVHash64 hash;
+        hashBase(hash);
+
+        // Hash the same fields as operator==.
+        hashValue(hash, mData.flags);
+        hashValue(hash, mData.displacementScale);
+        hashValue(hash, mData.displacementOffset);
+        hashValue(hash, mData.baseColor);
+        hashValue(hash, mData.specular);
+        hashValue(hash, mData.emissive);
+        hashValue(hash, mData.emissiveFactor);
+        hashValue(hash, mData.diffuseTransmission);
+        hashValue(hash, mData.specularTransmission);
+        hashValue(hash, mData.transmission);
+        hashValue(hash, mData.volumeAbsorption);
+        hashValue(hash, mData.volumeAnisotropy);
+        hashValue(hash, mData.volumeScattering);
+
+        // The displacement min/max samplers are derived from the default sampler.
+        if (mpDefaultSampler) hashSamplerDesc(hash, mpDefaultSampler->getDesc());
+
+        return hash.get();
+    }
+
     void BasicMaterial::updateAlphaMode()
     {
         if (!isAlphaSupported())
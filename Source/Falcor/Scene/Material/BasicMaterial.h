@@ -66,6 +66,8 @@ namespace Falcor
         */
         bool isEqual(const ref<Material>& pOther) const override;
 
+        uint64_t computeHash() const override;
+
         /** Set the alpha mode.
         */
         void setAlphaMode(AlphaMode alphaMode) override;
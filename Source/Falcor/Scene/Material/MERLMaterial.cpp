@@ -145,6 +145,14 @@ namespace Falcor
         return true;
     }
 
+    uint64_t MERLMaterial::computeHash() const
+    {
+        FNVHash64 hash;
+        hashBase(hash);
+        hashPath(hash, mPath);
+        return hash.get();
+    }
+
     Program::ShaderModuleList MERLMaterial::getShaderModules() const
     {
         return { Program::ShaderModule(kShaderFile) };
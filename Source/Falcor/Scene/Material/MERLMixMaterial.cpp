@@ -235,6 +235,20 @@ namespace Falcor
         return true;
     }
 
+    uint64_t MERLMixMaterial::computeHash() const
+    {
+        FNVHash64 hash;
+        hashBase(hash);
+        hashValue(hash, mBRDFs.size());
+        for (const auto& brdf : mBRDFs)
+        {
+            hashString(hash, brdf.name);
+            hashPath(hash, brdf.path);
+        }
+        if (mpDefaultSampler) hashSamplerDesc(hash, mpDefaultSampler->getDesc());
+        return hash.get();
+    }
+
     Program::ShaderModuleList MERLMixMaterial::getShaderModules() const
     {
         return { Program::ShaderModule(kShaderFile) };
@@ -318,6 +318,73 @@ namespace Falcor
         return true;
     }
 
+    uint64_t Material::computeHash() const
+    {
+        FNVHash64 hash;
+        hashBase(hash);
+        return hash.get();
+    }
+
+    void Material::hashBase(FNVHash64& hash) const
+    {
+        // Hash the data compared in isBaseEqual().
+        hash.insert(&mHeader.packedData, sizeof(mHeader.packedData));
+
+        hashValue(hash, mTextureTransform.getTranslation());
+        hashValue(hash, mTextureTransform.getScaling());
+        const quatf& rotation = mTextureTransform.getRotation();
+        for (size_t i = 0; i < 4; i++) hashValue(hash, rotation[i]);
+
+        for (size_t i = 0; i < mTextureSlotInfo.size(); i++)
+        {
+            auto slot = (TextureSlot)i;
+            bool hasSlot = hasTextureSlot(slot);
+            hashValue(hash, hasSlot);
+            if (hasSlot)
+            {
+                hashString(hash, mTextureSlotInfo[i].name);
+                hashValue(hash, mTextureSlotInfo[i].mask);
+                hashValue(hash, mTextureSlotInfo[i].srgb);
+                const Texture* pTexture = mTextureSlotData[i].pTexture.get();
+                hash.insert(&pTexture, sizeof(pTexture));
+            }
+        }
+    }
+
+    void Material::hashString(FNVHash64& hash, const std::string& str)
+    {
+        hashValue(hash, str.size());
+        hash.insert(str.data(), str.size());
+    }
+
+    void Material::hashPath(FNVHash64& hash, const std::filesystem::path& path)
+    {
+        // Paths compare equal element by element, hash them the same way.
+        for (const auto& element : path)
+        {
+            const auto& native = element.native();
+            hashValue(hash, native.size());
+            hash.insert(native.data(), native.size() * sizeof(native[0]));
+        }
+    }
+
+    void Material::hashSamplerDesc(FNVHash64& hash, const Sampler::Desc& desc)
+    {
+        hashValue(hash, desc.magFilter);
+        hashValue(hash, desc.minFilter);
+        hashValue(hash, desc.mipFilter);
+        hashValue(hash, desc.maxAnisotropy);
+        hashValue(hash, desc.maxLod);
+        hashValue(hash, desc.minLod);
+        hashValue(hash, desc.lodBias);
+        hashValue(hash, desc.comparisonMode);
+        hashValue(hash, desc.reductionMode);
+        hashValue(hash, desc.addressModeU);
+        hashValue(hash, desc.addressModeV);
+        hashValue(hash, desc.addressModeW);
+        hashValue(hash, desc.borderColor);
+    }
+
     NormalMapType Material::detectNormalMapType(const ref<Texture>& pNormalMap)
     {
         NormalMapType type = NormalMapType::None;
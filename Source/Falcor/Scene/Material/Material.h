@@ -36,6 +36,7 @@
 #include "Core/API/Texture.h"
 #include "Core/API/Sampler.h"
 #include "Utils/Image/TextureAnalyzer.h"
+#include "Utils/Math/FNVHash.h"
 #include "Utils/UI/Gui.h"
 #include "Scene/Transform.h"
 #include "MaterialTypeRegistry.h"
@@ -155,6 +156,13 @@ namespace Falcor
         */
         virtual bool isEqual(const ref<Material>& pOther) const = 0;
 
+        /** Compute a hash of the material properties compared by isEqual().
+            Materials that are equal have the same hash, so duplicates can be found without comparing all pairs of materials.
+            The base implementation covers the data compared by isBaseEqual(), derived classes add their own data.
+            \return 64-bit hash of all material properties *except* the name.
+        */
+        virtual uint64_t computeHash() const;
+
         /** Set the double-sided flag. This flag doesn't affect the cull state, just the shading.
         */
         virtual void setDoubleSided(bool doubleSided);
@@ -338,6 +346,32 @@ namespace Falcor
         void updateTextureHandle(MaterialSystem* pOwner, const TextureSlot slot, TextureHandle& handle);
         void updateDefaultTextureSamplerID(MaterialSystem* pOwner, const ref<Sampler>& pSampler);
         bool isBaseEqual(const Material& other) const;
+        void hashBase(FNVHash64& hash) const;
+
+        /** Add a value to a material hash.
+            Floating-point values are hashed as float with zero normalized, so that values comparing equal produce the same hash.
+        */
+        template<typename T>
+        static void hashValue(FNVHash64& hash, const T& value)
+        {
+            if constexpr (std::is_same_v<T, float> || std::is_same_v<T, float16_t>)
+            {
+                float v = (float)value;
+                if (v == 0.f) v = 0.f;
+                hash.insert(&v, sizeof(v));
+            }
+            else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+            {
+                hash.insert(&value, sizeof(value));
+            }
+            else
+            {
+                for (int i = 0; i < T::length(); i++) hashValue(hash, value[i]);
+            }
+        }
+        static void hashString(FNVHash64& hash, const std::string& str);
+        static void hashPath(FNVHash64& hash, const std::filesystem::path& path);
+        static void hashSamplerDesc(FNVHash64& hash, const Sampler::Desc& desc);
 
         static NormalMapType detectNormalMapType(const ref<Texture>& pNormalMap);
 
@@ -30,6 +30,7 @@
 #include "Core/API/Device.h"
 #include "Utils/Logger.h"
 #include "Utils/StringUtils.h"
+#include "Utils/Threading.h"
 #include "MaterialTypeRegistry.h"
 #include <numeric>
 
@@ -212,9 +213,9 @@ namespace Falcor
         checkArgument(pMaterial != nullptr, "'pMaterial' is missing");
 
         // Reuse previously added materials.
-        if (auto it = std::find(mMaterials.begin(), mMaterials.end(), pMaterial); it != mMaterials.end())
+        if (auto it = mMaterialIndices.find(pMaterial.get()); it != mMaterialIndices.end())
         {
-            return MaterialID{(size_t)std::distance(mMaterials.begin(), it) };
+            return MaterialID{ it->second };
         }
 
         // Add material.
@@ -230,6 +231,7 @@ namespace Falcor
         }
 
         pMaterial->registerUpdateCallback([this](auto flags) { mMaterialUpdates |= flags; });
+        mMaterialIndices.emplace(pMaterial.get(), (uint32_t)mMaterials.size());
         mMaterials.push_back(pMaterial);
         mMaterialsChanged = true;
 
@@ -242,9 +244,10 @@ namespace Falcor
         checkArgument(pReplacement != nullptr, "'pReplacement' is missing");
 
         // Find material to replace.
-        if (auto it = std::find(mMaterials.begin(), mMaterials.end(), pMaterial); it != mMaterials.end())
+        if (auto it = mMaterialIndices.find(pMaterial.get()); it != mMaterialIndices.end())
         {
-            *it = pReplacement;
+            mMaterials[it->second] = pReplacement;
+            updateMaterialIndices();
 
             if (pReplacement->getDefaultTextureSampler() == nullptr)
             {
@@ -302,36 +305,72 @@ namespace Falcor
 
     size_t MaterialSystem::removeDuplicateMaterials(std::vector<MaterialID>& idMap)
     {
-        std::vector<ref<Material>> uniqueMaterials;
-        idMap.resize(mMaterials.size());
+        const size_t materialCount = mMaterials.size();
+        idMap.resize(materialCount);
+
+        // Hash all materials. Equal materials have equal hashes, so only materials in the same bucket need to be compared.
+        std::vector<uint64_t> hashes(materialCount);
+        Threading::parallelFor(0, materialCount, [&](size_t i) { hashes[i] = mMaterials[i]->computeHash(); });
+
+        std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+        buckets.reserve(materialCount);
+        for (uint32_t i = 0; i < materialCount; ++i)
+            buckets[hashes[i]].push_back(i);
+
+        // For each material find the first material it is equal to. Buckets are sorted by index,
+        // so this is the first material of its set of duplicates, same as a linear search would find.
+        std::vector<uint32_t> firstEqual(materialCount);
+        Threading::parallelFor(0, materialCount, [&](size_t i)
+        {
+            const auto& bucket = buckets.at(hashes[i]);
+            firstEqual[i] = (uint32_t)i;
+            for (uint32_t j : bucket)
+            {
+                if (j >= i) break;
+                if (mMaterials[j]->isEqual(mMaterials[i]))
+                {
+                    firstEqual[i] = j;
+                    break;
+                }
+            }
+        });
 
         // Find unique set of materials.
-        for (MaterialID id{ 0 }; id.get() < mMaterials.size(); ++id)
+        std::vector<ref<Material>> uniqueMaterials;
+        for (MaterialID id{ 0 }; id.get() < materialCount; ++id)
         {
             const auto& pMaterial = mMaterials[id.get()];
-            auto it = std::find_if(uniqueMaterials.begin(), uniqueMaterials.end(), [&pMaterial](const auto& m) { return m->isEqual(pMaterial); });
-            if (it == uniqueMaterials.end())
+            const uint32_t first = firstEqual[id.get()];
+            if (first == id.get())
             {
                 idMap[id.get()] = MaterialID{ uniqueMaterials.size() };
                 uniqueMaterials.push_back(pMaterial);
             }
             else
             {
-                logInfo("Removing duplicate material '{}' (duplicate of '{}').", pMaterial->getName(), (*it)->getName());
-                idMap[id.get()] = MaterialID{ (size_t)std::distance(uniqueMaterials.begin(), it) };
+                logInfo("Removing duplicate material '{}' (duplicate of '{}').", pMaterial->getName(), mMaterials[first]->getName());
+                idMap[id.get()] = idMap[first];
             }
         }
 
-        size_t removed = mMaterials.size() - uniqueMaterials.size();
+        size_t removed = materialCount - uniqueMaterials.size();
         if (removed > 0)
         {
             mMaterials = uniqueMaterials;
+            updateMaterialIndices();
             mMaterialsChanged = true;
         }
 
         return removed;
     }
 
+    void MaterialSystem::updateMaterialIndices()
+    {
+        mMaterialIndices.clear();
+        for (uint32_t i = 0; i < (uint32_t)mMaterials.size(); ++i)
+            mMaterialIndices.emplace(mMaterials[i].get(), i);
+    }
+
     void MaterialSystem::optimizeMaterials()
     {
         // Gather a list of all textures to analyze.
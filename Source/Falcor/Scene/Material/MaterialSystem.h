@@ -39,6 +39,7 @@
 #include <memory>
 #include <vector>
 #include <set>
+#include <unordered_map>
 
 namespace Falcor
 {
@@ -231,10 +232,12 @@ namespace Falcor
         void updateUI();
         void createParameterBlock();
         void uploadMaterial(const uint32_t materialID);
+        void updateMaterialIndices();
 
         ref<Device> mpDevice;
 
         std::vector<ref<Material>> mMaterials;                      ///< List of all materials.
+        std::unordered_map<const Material*, uint32_t> mMaterialIndices; ///< Index of the first occurrence of each material in mMaterials.
         std::vector<Material::UpdateFlags> mMaterialsUpdateFlags;   ///< List of all material update flags, after the update() calls
         std::unique_ptr<TextureManager> mpTextureManager;           ///< Texture manager holding all material textures.
         Program::ShaderModuleList mShaderModules;                   ///< Shader modules for all materials in use.
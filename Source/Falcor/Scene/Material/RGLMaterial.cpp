@@ -133,6 +133,14 @@ namespace Falcor
         return true;
     }
 
+    uint64_t RGLMaterial::computeHash() const
+    {
+        FNVHash64 hash;
+        hashBase(hash);
+        hashPath(hash, mFilePath);
+        return hash.get();
+    }
+
     Program::ShaderModuleList RGLMaterial::getShaderModules() const
     {
         return { Program::ShaderModule(kShaderFile) };
@@ -0,0 +1,333 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "MeshOptimizer.h"
+#include "Core/Assert.h"
+#include "Utils/Math/VectorMath.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Parameters of the vertex cache optimizer from Forsyth's paper.
+        const uint32_t kForsythCacheSize = 32;      ///< Simulated LRU cache size.
+        const float kCacheDecayPower = 1.5f;
+        const float kLastTriangleScore = 0.75f;
+        const float kValenceBoostScale = 2.0f;
+        const float kValenceBoostPower = 0.5f;
+
+        const uint32_t kInvalidIndex = 0xffffffff;
+
+        float computeVertexScore(int cachePosition, uint32_t remainingValence)
+        {
+            // Vertices without remaining triangles are never used again.
+            if (remainingValence == 0) return -1.f;
+
+            float score = 0.f;
+            if (cachePosition >= 0)
+            {
+                // The vertices of the last triangle are given a fixed score to avoid favoring a triangle reusing all three of them.
+                if (cachePosition < 3) score = kLastTriangleScore;
+                else score = std::pow(1.f - float(cachePosition - 3) / float(kForsythCacheSize - 3), kCacheDecayPower);
+            }
+
+            // Boost vertices with few remaining triangles to get rid of lone triangles.
+            score += kValenceBoostScale * std::pow(float(remainingValence), -kValenceBoostPower);
+            return score;
+        }
+
+        /** Simple FIFO cache simulation based on timestamps.
+        */
+        class FifoCache
+        {
+        public:
+            FifoCache(uint32_t vertexCount, uint32_t cacheSize) : mTimestamps(vertexCount, 0), mCacheSize(cacheSize), mTime(cacheSize + 1) {}
+
+            /** Reset the cache to empty without touching the timestamps.
+            */
+            void reset() { mTime += mCacheSize + 1; }
+
+            /** Reference a vertex. Returns 1 if it is a miss, 0 otherwise.
+            */
+            uint32_t reference(uint32_t vertex)
+            {
+                if (mTime - mTimestamps[vertex] > mCacheSize)
+                {
+                    mTimestamps[vertex] = mTime++;
+                    return 1;
+                }
+                return 0;
+            }
+
+        private:
+            std::vector<uint64_t> mTimestamps;
+            uint64_t mCacheSize;
+            uint64_t mTime;
+        };
+    }
+
+    MeshOptimizer::VertexCacheStats MeshOptimizer::analyzeVertexCache(fstd::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        FALCOR_ASSERT(indices.size() % 3 == 0);
+        FALCOR_ASSERT(cacheSize > 0);
+
+        VertexCacheStats stats;
+        stats.triangleCount = indices.size() / 3;
+
+        FifoCache cache(vertexCount, cacheSize);
+        std::vector<bool> referenced(vertexCount, false);
+
+        for (uint32_t index : indices)
+        {
+            FALCOR_ASSERT(index < vertexCount);
+            stats.transformedVertexCount += cache.reference(index);
+            if (!referenced[index])
+            {
+                referenced[index] = true;
+                stats.vertexCount++;
+            }
+        }
+
+        return stats;
+    }
+
+    void MeshOptimizer::optimizeVertexCache(fstd::span<uint32_t> indices, uint32_t vertexCount)
+    {
+        FALCOR_ASSERT(indices.size() % 3 == 0);
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        // Build vertex to triangle adjacency. The per-vertex lists are compacted as triangles are emitted,
+        // and 'valence' holds the number of remaining triangles for each vertex.
+        std::vector<uint32_t> valence(vertexCount, 0);
+        for (uint32_t index : indices)
+        {
+            FALCOR_ASSERT(index < vertexCount);
+            valence[index]++;
+        }
+
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        std::partial_sum(valence.begin(), valence.end(), offsets.begin() + 1);
+
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+
+        // Initialize scores.
+        std::vector<int> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++) vertexScores[v] = computeVertexScore(-1, valence[v]);
+
+        std::vector<float> triangleScores(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        std::vector<uint32_t> cache, newCache;
+        cache.reserve(kForsythCacheSize + 3);
+        newCache.reserve(kForsythCacheSize + 3);
+
+        uint32_t bestTriangle = (uint32_t)std::distance(triangleScores.begin(), std::max_element(triangleScores.begin(), triangleScores.end()));
+        size_t cursor = 0;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+        {
+            // If there is no candidate in the cache, continue with the next triangle in input order.
+            if (bestTriangle == kInvalidIndex)
+            {
+                while (emitted[cursor]) cursor++;
+                bestTriangle = (uint32_t)cursor;
+            }
+
+            const uint32_t t = bestTriangle;
+            FALCOR_ASSERT(!emitted[t]);
+            emitted[t] = true;
+
+            const uint32_t tri[3] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+            output.insert(output.end(), tri, tri + 3);
+
+            // Remove the triangle from the adjacency lists of its vertices.
+            for (uint32_t v : tri)
+            {
+                uint32_t* pList = adjacency.data() + offsets[v];
+                for (uint32_t i = 0; i < valence[v]; i++)
+                {
+                    if (pList[i] == t)
+                    {
+                        std::swap(pList[i], pList[valence[v] - 1]);
+                        valence[v]--;
+                        break;
+                    }
+                }
+            }
+
+            // Move the vertices of the triangle to the front of the LRU cache.
+            newCache.assign(tri, tri + 3);
+            for (uint32_t v : cache)
+            {
+                if (v != tri[0] && v != tri[1] && v != tri[2]) newCache.push_back(v);
+            }
+            std::swap(cache, newCache);
+
+            // Update vertex scores and propagate the changes to the adjacent triangles.
+            for (size_t i = 0; i < cache.size(); i++)
+            {
+                const uint32_t v = cache[i];
+                const int cachePosition = i < kForsythCacheSize ? (int)i : -1;
+                cachePositions[v] = cachePosition;
+
+                const float score = computeVertexScore(cachePosition, valence[v]);
+                const float delta = score - vertexScores[v];
+                vertexScores[v] = score;
+
+                for (uint32_t j = 0; j < valence[v]; j++) triangleScores[adjacency[offsets[v] + j]] += delta;
+            }
+            if (cache.size() > kForsythCacheSize) cache.resize(kForsythCacheSize);
+
+            // Pick the best triangle among the ones referencing cached vertices.
+            bestTriangle = kInvalidIndex;
+            float bestScore = -std::numeric_limits<float>::infinity();
+            for (uint32_t v : cache)
+            {
+                for (uint32_t j = 0; j < valence[v]; j++)
+                {
+                    const uint32_t candidate = adjacency[offsets[v] + j];
+                    if (triangleScores[candidate] > bestScore)
+                    {
+                        bestScore = triangleScores[candidate];
+                        bestTriangle = candidate;
+                    }
+                }
+            }
+        }
+
+        FALCOR_ASSERT(output.size() == indices.size());
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void MeshOptimizer::optimizeOverdraw(fstd::span<uint32_t> indices, fstd::span<const float3> positions, float threshold)
+    {
+        FALCOR_ASSERT(indices.size() % 3 == 0);
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        const uint32_t vertexCount = (uint32_t)positions.size();
+        const float targetACMR = analyzeVertexCache(indices, vertexCount).getACMR() * threshold;
+
+        // Split the triangles into clusters. A new cluster is started whenever the current cluster's cache
+        // miss ratio falls below the target, so that reordering the clusters keeps the ACMR close to the original one.
+        // The cache is reset at the start of each cluster as the clusters are drawn in arbitrary order.
+        std::vector<size_t> clusterOffsets;
+        {
+            FifoCache cache(vertexCount, kDefaultCacheSize);
+            size_t clusterStart = 0;
+            uint64_t clusterMisses = 0;
+            clusterOffsets.push_back(0);
+
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                for (size_t k = 0; k < 3; k++) clusterMisses += cache.reference(indices[t * 3 + k]);
+
+                const size_t clusterSize = t + 1 - clusterStart;
+                if (t + 1 < triangleCount && (float)clusterMisses / clusterSize <= targetACMR)
+                {
+                    clusterOffsets.push_back(t + 1);
+                    clusterStart = t + 1;
+                    clusterMisses = 0;
+                    cache.reset();
+                }
+            }
+            clusterOffsets.push_back(triangleCount);
+        }
+
+        const size_t clusterCount = clusterOffsets.size() - 1;
+        if (clusterCount < 2) return;
+
+        // Compute area weighted centroid and normal of each cluster and the mesh.
+        std::vector<float3> clusterCentroids(clusterCount, float3(0.f));
+        std::vector<float3> clusterNormals(clusterCount, float3(0.f));
+        float3 meshCentroid(0.f);
+        float meshArea = 0.f;
+
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            float clusterArea = 0.f;
+            for (size_t t = clusterOffsets[c]; t < clusterOffsets[c + 1]; t++)
+            {
+                const float3 p0 = positions[indices[t * 3]];
+                const float3 p1 = positions[indices[t * 3 + 1]];
+                const float3 p2 = positions[indices[t * 3 + 2]];
+                const float3 n = cross(p1 - p0, p2 - p0);
+                const float area = length(n);
+
+                clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.f);
+                clusterNormals[c] += n;
+                clusterArea += area;
+            }
+
+            meshCentroid += clusterCentroids[c];
+            meshArea += clusterArea;
+            if (clusterArea > 0.f) clusterCentroids[c] /= clusterArea;
+        }
+        if (meshArea > 0.f) meshCentroid /= meshArea;
+
+        // Sort clusters such that the ones facing away from the mesh center are drawn first, as they are likely to occlude the other ones.
+        std::vector<float> sortKeys(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            const float normalLength = length(clusterNormals[c]);
+            const float3 normal = normalLength > 0.f ? clusterNormals[c] / normalLength : float3(0.f);
+            sortKeys[c] = dot(clusterCentroids[c] - meshCentroid, normal);
+        }
+
+        std::vector<size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (size_t c : order)
+        {
+            output.insert(output.end(), indices.begin() + clusterOffsets[c] * 3, indices.begin() + clusterOffsets[c + 1] * 3);
+        }
+
+        FALCOR_ASSERT(output.size() == indices.size());
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+}
@@ -0,0 +1,96 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Utils/Math/Vector.h"
+#include <fstd/span.h>
+#include <cstdint>
+
+namespace Falcor
+{
+    /** Triangle reordering for indexed triangle lists.
+        The optimizations operate on the index buffer only, the vertex data is left unchanged.
+    */
+    class FALCOR_API MeshOptimizer
+    {
+    public:
+        static constexpr uint32_t kDefaultCacheSize = 16;   ///< FIFO cache size used for analysis.
+
+        /** Statistics of a simulated post-transform vertex cache.
+            Counts are accumulated so statistics of multiple meshes can be summed up.
+        */
+        struct VertexCacheStats
+        {
+            uint64_t triangleCount = 0;             ///< Number of triangles.
+            uint64_t vertexCount = 0;               ///< Number of unique vertices referenced by the triangles.
+            uint64_t transformedVertexCount = 0;    ///< Number of vertex shader invocations (cache misses).
+
+            /** Average cache miss ratio, i.e. transformed vertices per triangle. Lower is better, the optimum is approx. 0.5.
+            */
+            float getACMR() const { return triangleCount > 0 ? (float)transformedVertexCount / triangleCount : 0.f; }
+
+            /** Average transform to vertex ratio, i.e. transformed vertices per vertex. Lower is better, the optimum is 1.0.
+            */
+            float getATVR() const { return vertexCount > 0 ? (float)transformedVertexCount / vertexCount : 0.f; }
+
+            VertexCacheStats& operator+=(const VertexCacheStats& other)
+            {
+                triangleCount += other.triangleCount;
+                vertexCount += other.vertexCount;
+                transformedVertexCount += other.transformedVertexCount;
+                return *this;
+            }
+        };
+
+        /** Simulate a FIFO post-transform vertex cache for an indexed triangle list.
+            \param[in] indices Triangle list indices.
+            \param[in] vertexCount Number of vertices. All indices must be smaller than this.
+            \param[in] cacheSize Number of cache entries.
+            \return Cache statistics.
+        */
+        static VertexCacheStats analyzeVertexCache(fstd::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = kDefaultCacheSize);
+
+        /** Reorder triangles for post-transform vertex cache locality.
+            This uses the greedy algorithm from Tom Forsyth, "Linear-Speed Vertex Cache Optimisation", 2006.
+            The winding of each triangle is preserved.
+            \param[in,out] indices Triangle list indices.
+            \param[in] vertexCount Number of vertices. All indices must be smaller than this.
+        */
+        static void optimizeVertexCache(fstd::span<uint32_t> indices, uint32_t vertexCount);
+
+        /** Reorder triangles to reduce overdraw, while retaining most of the vertex cache locality.
+            The index buffer is expected to be optimized for the vertex cache first. It is split into clusters
+            whose individual cache miss ratio stays below the threshold, and the clusters are sorted such that
+            outward facing clusters are drawn first (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007).
+            \param[in,out] indices Triangle list indices.
+            \param[in] positions Vertex positions. All indices must be smaller than the number of positions.
+            \param[in] threshold Maximum allowed ACMR of a cluster relative to the ACMR of the whole mesh.
+        */
+        static void optimizeOverdraw(fstd::span<uint32_t> indices, fstd::span<const float3> positions, float threshold = 1.05f);
+    };
+}
@@ -39,6 +39,7 @@
 #include "Core/API/RenderContext.h"
 #include "Core/API/IndirectCommands.h"
 #include "Utils/StringUtils.h"
+#include "Utils/Threading.h"
 #include "Utils/ObjectIDPython.h"
 #include "Utils/Math/Common.h"
 #include "Utils/Math/MathHelpers.h"
@@ -121,6 +122,9 @@ namespace Falcor
             { (uint32_t)Scene::CameraControllerType::SixDOF, "6-DOF" },
         };
 
+        // Minimum number of geometry instances per parallel task in updateGeometryInstances().
+        const size_t kGeometryInstanceGrainSize = 4096;
+
         // Checks if the transform flips the coordinate system handedness (its determinant is negative).
         bool doesTransformFlip(const float4x4& m)
         {
@@ -204,13 +208,25 @@ namespace Falcor
         // Set default SDF grid config.
         setSDFGridConfig();
 
+        // Mesh data is either owned by the scene data or memory mapped from the scene cache.
+        // It is only needed until all GPU resources are created.
+        fstd::span<const uint32_t> meshIndexData = sceneData.meshIndexData;
+        fstd::span<const PackedStaticVertexData> meshStaticData = sceneData.meshStaticData;
+        fstd::span<const SkinningVertexData> meshSkinningData = sceneData.meshSkinningData;
+        if (sceneData.mappedMeshData)
+        {
+            meshIndexData = sceneData.mappedMeshData->indexData;
+            meshStaticData = sceneData.mappedMeshData->staticData;
+            meshSkinningData = sceneData.mappedMeshData->skinningData;
+        }
+
         // Create vertex array objects for meshes and curves.
-        createMeshVao(sceneData.meshDrawCount, sceneData.meshIndexData, sceneData.meshStaticData, sceneData.meshSkinningData);
+        createMeshVao(sceneData.meshDrawCount, meshIndexData, meshStaticData, meshSkinningData);
         createCurveVao(mCurveIndexData, mCurveStaticData);
-        createMeshUVTiles(mMeshDesc, sceneData.meshIndexData, sceneData.meshStaticData);
+        createMeshUVTiles(mMeshDesc, meshIndexData, meshStaticData);
 
         // Create animation controller.
-        mpAnimationController = std::make_unique<AnimationController>(mpDevice, this, sceneData.meshStaticData, sceneData.meshSkinningData, sceneData.prevVertexCount, sceneData.animations);
+        mpAnimationController = std::make_unique<AnimationController>(mpDevice, this, meshStaticData, meshSkinningData, sceneData.prevVertexCount, sceneData.animations);
 
         // Some runtime mesh data validation. These are essentially asserts, but large scenes are mostly opened in Release
         for (const auto& mesh : mMeshDesc)
@@ -238,7 +254,7 @@ namespace Falcor
         }
 
         // Must be placed after curve data/AABB creation.
-        mpAnimationController->addAnimatedVertexCaches(std::move(sceneData.cachedCurves), std::move(sceneData.cachedMeshes), sceneData.meshStaticData);
+        mpAnimationController->addAnimatedVertexCaches(std::move(sceneData.cachedCurves), std::move(sceneData.cachedMeshes), meshStaticData);
 
         // Finalize scene.
         finalize();
@@ -406,7 +422,7 @@ namespace Falcor
         pRenderContext->raytrace(pProgram, pVars.get(), dispatchDims.x, dispatchDims.y, dispatchDims.z);
     }
 
-    void Scene::createMeshVao(uint32_t drawCount, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData, const std::vector<SkinningVertexData>& skinningData)
+    void Scene::createMeshVao(uint32_t drawCount, fstd::span<const uint32_t> indexData, fstd::span<const PackedStaticVertexData> staticData, fstd::span<const SkinningVertexData> skinningData)
     {
         if (drawCount == 0) return;
 
@@ -538,7 +554,7 @@ namespace Falcor
         mpCurveVao = Vao::create(Vao::Topology::LineStrip, pLayout, pVBs, pIB, ResourceFormat::R32Uint);
     }
 
-    void Scene::createMeshUVTiles(const std::vector<MeshDesc>& meshDescs, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData)
+    void Scene::createMeshUVTiles(const std::vector<MeshDesc>& meshDescs, fstd::span<const uint32_t> indexData, fstd::span<const PackedStaticVertexData> staticData)
     {
         const uint8_t* indexData8 = reinterpret_cast<const uint8_t*>(indexData.data());
 
@@ -878,13 +894,21 @@ namespace Falcor
     {
         if (mGeometryInstanceData.empty()) return;
 
-        bool dataChanged = false;
         const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
 
-        for (auto& inst : mGeometryInstanceData)
+        // Update the instance flags. Unless a full update is forced, only instances whose transform changed
+        // in the last animation update are visited. Instances with modified data are marked for upload.
+        mGeometryInstancesChanged.resize(mGeometryInstanceData.size());
+        auto updateInstances = [&](size_t begin, size_t end)
         {
-            if (inst.getType() == GeometryType::TriangleMesh || inst.getType() == GeometryType::DisplacedTriangleMesh)
+            for (size_t i = begin; i < end; ++i)
             {
+                auto& inst = mGeometryInstanceData[i];
+                mGeometryInstancesChanged[i] = false;
+
+                if (inst.getType() != GeometryType::TriangleMesh && inst.getType() != GeometryType::DisplacedTriangleMesh) continue;
+                if (!forceUpdate && !mpAnimationController->isMatrixChanged(NodeID{ inst.globalMatrixID })) continue;
+
                 uint32_t prevFlags = inst.flags;
 
                 FALCOR_ASSERT(inst.globalMatrixID < globalMatrices.size());
@@ -902,14 +926,32 @@ namespace Falcor
                 if (isWorldFrontFaceCW) inst.flags |= (uint32_t)GeometryInstanceFlags::IsWorldFrontFaceCW;
                 else inst.flags &= ~(uint32_t)GeometryInstanceFlags::IsWorldFrontFaceCW;
 
-                dataChanged |= (inst.flags != prevFlags);
+                mGeometryInstancesChanged[i] = inst.flags != prevFlags;
             }
-        }
+        };
+        Threading::parallelForChunked(0, mGeometryInstanceData.size(), updateInstances, kGeometryInstanceGrainSize);
 
-        if (forceUpdate || dataChanged)
+        if (forceUpdate)
         {
             uint32_t byteSize = (uint32_t)(mGeometryInstanceData.size() * sizeof(GeometryInstanceData));
             mpGeometryInstancesBuffer->setBlob(mGeometryInstanceData.data(), 0, byteSize);
+            return;
+        }
+
+        // Upload changed instances only.
+        for (size_t i = 0; i < mGeometryInstanceData.size();)
+        {
+            // Detect ranges of consecutive instances that have all changed or not.
+            size_t offset = i;
+            bool changed = mGeometryInstancesChanged[i];
+            while (i < mGeometryInstanceData.size() && mGeometryInstancesChanged[i] == changed) ++i;
+
+            // Upload range of changed instances.
+            if (changed)
+            {
+                size_t count = i - offset;
+                mpGeometryInstancesBuffer->setBlob(&mGeometryInstanceData[offset], offset * sizeof(GeometryInstanceData), count * sizeof(GeometryInstanceData));
+            }
         }
     }
 
@@ -1791,6 +1833,7 @@ namespace Falcor
                 if (mpAnimationController->isMatrixChanged(NodeID{ inst.globalMatrixID }))
                 {
                     mUpdates |= UpdateFlags::GeometryMoved;
+                    break;
                 }
             }
 
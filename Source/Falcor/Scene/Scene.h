@@ -54,6 +54,8 @@
 #include "Utils/UI/Gui.h"
 #include "Utils/Settings.h"
 
+#include <fstd/span.h>
+
 #include <functional>
 #include <memory>
 #include <type_traits>
@@ -70,6 +72,7 @@ namespace Falcor
     struct GamepadState;
 
     class RtProgramVars;
+    class MemoryMappedFile;
 
     /** This class is the main scene representation.
         It holds all scene resources such as geometry, cameras, lights, and materials.
@@ -338,6 +341,18 @@ namespace Falcor
             std::vector<PackedStaticVertexData> meshStaticData;     ///< Vertex attributes for all meshes in packed format.
             std::vector<SkinningVertexData> meshSkinningData;       ///< Additional vertex attributes for skinned meshes.
 
+            /** Mesh data memory mapped from an uncompressed scene cache.
+                The views point directly into the mapped file and are used instead of meshIndexData, meshStaticData and meshSkinningData, which are left empty.
+            */
+            struct MappedMeshData
+            {
+                std::shared_ptr<MemoryMappedFile> pFile;            ///< Mapped scene cache file. Keeps the mapping alive.
+                fstd::span<const uint32_t> indexData;
+                fstd::span<const PackedStaticVertexData> staticData;
+                fstd::span<const SkinningVertexData> skinningData;
+            };
+            std::optional<MappedMeshData> mappedMeshData;           ///< Memory-mapped mesh data (optional).
+
             // Curve data
             std::vector<CurveDesc> curveDesc;                       ///< List of curve descriptors.
             std::vector<AABB> curveBBs;                             ///< List of curve bounding boxes in object space. Each curve consists of many segments, each with its own AABB. The bounding boxes here are the unions of those.
@@ -1107,9 +1122,9 @@ namespace Falcor
         static constexpr uint32_t kDrawIdBufferIndex = kStaticDataBufferIndex + 1;
         static constexpr uint32_t kVertexBufferCount = kDrawIdBufferIndex + 1;
 
-        void createMeshVao(uint32_t drawCount, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData, const std::vector<SkinningVertexData>& skinningData);
+        void createMeshVao(uint32_t drawCount, fstd::span<const uint32_t> indexData, fstd::span<const PackedStaticVertexData> staticData, fstd::span<const SkinningVertexData> skinningData);
         void createCurveVao(const std::vector<uint32_t>& indexData, const std::vector<StaticCurveVertexData>& staticData);
-        void createMeshUVTiles(const std::vector<MeshDesc>& meshDesc, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData);
+        void createMeshUVTiles(const std::vector<MeshDesc>& meshDesc, fstd::span<const uint32_t> indexData, fstd::span<const PackedStaticVertexData> staticData);
 
         void updateSceneDefines();
         DefineList getSceneSDFGridDefines() const;
@@ -1236,6 +1251,7 @@ namespace Falcor
         GeometryTypeFlags mGeometryTypes;                           ///< Set of geometry types that exist in the scene.
 
         std::vector<GeometryInstanceData> mGeometryInstanceData;    ///< Geometry instance data (for all types of geometry).
+        std::vector<uint8_t> mGeometryInstancesChanged;             ///< Flag per geometry instance, true if its data changed in the last call to updateGeometryInstances().
 
         bool mUseCompressedHitInfo = false;                         ///< True if scene should used compressed HitInfo (on scenes with triangles meshes only).
         bool mHas16BitIndices = false;                              ///< True if any meshes use 16-bit indices.
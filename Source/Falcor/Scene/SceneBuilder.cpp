@@ -37,6 +37,7 @@
 #include "Utils/Scripting/ScriptBindings.h"
 #include "Utils/Math/MathHelpers.h"
 #include "Utils/ObjectIDPython.h"
+#include "Utils/Threading.h"
 #include <mikktspace.h>
 #include <filesystem>
 #include <cmath>
@@ -162,9 +163,16 @@ namespace Falcor
             if (isZero(v.normal) || isZero(v.tangent.xyz())) zeroCount++;
         }
 
-        bool compareVertices(const SceneBuilder::Mesh::Vertex& lhs, const SceneBuilder::Mesh::Vertex& rhs, float threshold = 1e-6f)
+        bool compareVertices(const SceneBuilder::Mesh::Vertex& lhs, const SceneBuilder::Mesh::Vertex& rhs, float threshold = 1e-6f, float positionThreshold = 0.f)
         {
-            if (any(lhs.position != rhs.position)) return false; // Position need to be exact to avoid cracks
+            if (positionThreshold == 0.f)
+            {
+                if (any(lhs.position != rhs.position)) return false; // Position need to be exact to avoid cracks
+            }
+            else
+            {
+                if (any(abs(lhs.position - rhs.position) > float3(positionThreshold))) return false;
+            }
             if (lhs.tangent.w != rhs.tangent.w) return false;
             if (lhs.curveRadius != rhs.curveRadius) return false;
             if (any(lhs.boneIDs != rhs.boneIDs)) return false;
@@ -175,6 +183,14 @@ namespace Falcor
             return true;
         }
 
+        /** Compute the spatial hash key of a grid cell used for vertex welding.
+        */
+        uint64_t hashWeldCell(const int3& cell)
+        {
+            // Large primes as used in "Optimized Spatial Hashing for Collision Detection of Deformable Objects" (Teschner et al. 2003).
+            return (uint64_t(uint32_t(cell.x)) * 73856093ull) ^ (uint64_t(uint32_t(cell.y)) * 19349663ull) ^ (uint64_t(uint32_t(cell.z)) * 83492791ull);
+        }
+
         std::vector<uint32_t> compact16BitIndices(const std::vector<uint32_t>& indices)
         {
             if (indices.empty()) return {};
@@ -189,16 +205,60 @@ namespace Falcor
             return indexData;
         }
 
-        SceneCache::Key computeSceneCacheKey(const std::filesystem::path& path, SceneBuilder::Flags buildFlags)
+        SceneCache::Key computeSceneCacheKey(const std::filesystem::path& path, SceneBuilder::Flags buildFlags, float vertexWeldEpsilon)
         {
             SceneBuilder::Flags cacheFlags = buildFlags & (~(SceneBuilder::Flags::UseCache | SceneBuilder::Flags::RebuildCache));
             SHA1 sha1;
             auto pathStr = path.string();
             sha1.update(pathStr.data(), pathStr.size());
             sha1.update(&cacheFlags, sizeof(cacheFlags));
+            // The weld tolerance changes the geometry, it is only hashed when welding so that other caches stay valid.
+            if (is_set(buildFlags, SceneBuilder::Flags::WeldVertices)) sha1.update(&vertexWeldEpsilon, sizeof(vertexWeldEpsilon));
             return sha1.finalize();
 
         }
+
+        /** Vertex attribute storage backing a SceneBuilder::Mesh created from a TriangleMesh.
+        */
+        struct TriangleMeshAttributes
+        {
+            std::vector<float3> positions;
+            std::vector<float3> normals;
+            std::vector<float2> texCoords;
+        };
+
+        SceneBuilder::Mesh createMeshFromTriangleMesh(const ref<TriangleMesh>& pTriangleMesh, const ref<Material>& pMaterial, TriangleMeshAttributes& attributes)
+        {
+            checkArgument(pTriangleMesh != nullptr, "'pTriangleMesh' is missing");
+            checkArgument(pMaterial != nullptr, "'pMaterial' is missing");
+
+            SceneBuilder::Mesh mesh;
+
+            const auto& indices = pTriangleMesh->getIndices();
+            const auto& vertices = pTriangleMesh->getVertices();
+
+            mesh.name = pTriangleMesh->getName();
+            mesh.faceCount = (uint32_t)(indices.size() / 3);
+            mesh.vertexCount = (uint32_t)vertices.size();
+            mesh.indexCount = (uint32_t)indices.size();
+            mesh.pIndices = indices.data();
+            mesh.topology = Vao::Topology::TriangleList;
+            mesh.isFrontFaceCW = pTriangleMesh->getFrontFaceCW();
+            mesh.pMaterial = pMaterial;
+
+            attributes.positions.resize(vertices.size());
+            attributes.normals.resize(vertices.size());
+            attributes.texCoords.resize(vertices.size());
+            std::transform(vertices.begin(), vertices.end(), attributes.positions.begin(), [] (const auto& v) { return v.position; });
+            std::transform(vertices.begin(), vertices.end(), attributes.normals.begin(), [] (const auto& v) { return v.normal; });
+            std::transform(vertices.begin(), vertices.end(), attributes.texCoords.begin(), [] (const auto& v) { return v.texCoord; });
+
+            mesh.positions = { attributes.positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            mesh.normals = { attributes.normals.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            mesh.texCrds = { attributes.texCoords.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+
+            return mesh;
+        }
     }
 
     SceneBuilder::SceneBuilder(ref<Device> pDevice, const Settings& settings, Flags flags)
@@ -208,6 +268,8 @@ namespace Falcor
     {
         mpFence = GpuFence::create(mpDevice);
         mSceneData.pMaterials = std::make_unique<MaterialSystem>(mpDevice);
+        if (is_set(flags, Flags::UseTextureCache))
+            mSceneData.pMaterials->getTextureManager().setTextureCacheEnabled(true);
     }
 
     SceneBuilder::SceneBuilder(ref<Device> pDevice, const std::filesystem::path& path, const Settings& settings, Flags flags)
@@ -219,8 +281,8 @@ namespace Falcor
             throw ImporterError(path, "Can't find scene file '{}'.", path);
         }
 
-        // Compute scene cache key based on absolute scene path and build flags.
-        mSceneCacheKey = computeSceneCacheKey(fullPath, flags);
+        // Compute scene cache key based on absolute scene path, build flags and the settings affecting the build.
+        mSceneCacheKey = computeSceneCacheKey(fullPath, flags, getVertexWeldEpsilon());
 
         // Determine if scene cache should be written after import.
         bool useCache = is_set(flags, Flags::UseCache);
@@ -232,7 +294,7 @@ namespace Falcor
         {
             try
             {
-                mpScene = Scene::create(pDevice, SceneCache::readCache(pDevice, mSceneCacheKey));
+                mpScene = Scene::create(pDevice, SceneCache::readCache(pDevice, mSceneCacheKey, SceneCache::Sections::All, is_set(mFlags, Flags::UseTextureCache)));
                 return;
             }
             catch (const std::exception& e)
@@ -308,6 +370,18 @@ namespace Falcor
             addMeshInstance(nodeID, meshID);
         }
 
+        if (is_set(mFlags, Flags::WeldVertices))
+        {
+            logInfo("Vertex welding removed {} vertices.", mWeldedVertexCount);
+        }
+
+        if (is_set(mFlags, Flags::ReorderTriangles))
+        {
+            const auto& r = mVertexCacheReport;
+            logInfo("Triangle reordering: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f} (FIFO cache size {}).",
+                r.original.getACMR(), r.optimized.getACMR(), r.original.getATVR(), r.optimized.getATVR(), MeshOptimizer::kDefaultCacheSize);
+        }
+
         // Post-process the scene data.
         TimeReport timeReport;
 
@@ -358,7 +432,7 @@ namespace Falcor
         // Write scene cache if requested.
         if (mWriteSceneCache)
         {
-            SceneCache::writeCache(mSceneData, mSceneCacheKey);
+            SceneCache::writeCache(mSceneData, mSceneCacheKey, is_set(mFlags, Flags::UncompressedCache));
             timeReport.measure("Writing cache");
         }
 
@@ -381,35 +455,36 @@ namespace Falcor
 
     MeshID SceneBuilder::addTriangleMesh(const ref<TriangleMesh>& pTriangleMesh, const ref<Material>& pMaterial)
     {
-        checkArgument(pTriangleMesh != nullptr, "'pTriangleMesh' is missing");
-        checkArgument(pMaterial != nullptr, "'pMaterial' is missing");
-
-        Mesh mesh;
+        TriangleMeshAttributes attributes;
+        return addMesh(createMeshFromTriangleMesh(pTriangleMesh, pMaterial, attributes));
+    }
 
-        const auto& indices = pTriangleMesh->getIndices();
-        const auto& vertices = pTriangleMesh->getVertices();
+    std::vector<MeshID> SceneBuilder::addMeshes(fstd::span<const Mesh> meshes)
+    {
+        // Pre-process the meshes in parallel. processMesh() is thread safe.
+        std::vector<ProcessedMesh> processedMeshes(meshes.size());
+        Threading::parallelFor(0, meshes.size(), [&](size_t i) { processedMeshes[i] = processMesh(meshes[i]); });
 
-        mesh.name = pTriangleMesh->getName();
-        mesh.faceCount = (uint32_t)(indices.size() / 3);
-        mesh.vertexCount = (uint32_t)vertices.size();
-        mesh.indexCount = (uint32_t)indices.size();
-        mesh.pIndices = indices.data();
-        mesh.topology = Vao::Topology::TriangleList;
-        mesh.isFrontFaceCW = pTriangleMesh->getFrontFaceCW();
-        mesh.pMaterial = pMaterial;
+        // Add the meshes sequentially in input order to retain a deterministic order of the mesh IDs.
+        std::vector<MeshID> meshIDs;
+        meshIDs.reserve(processedMeshes.size());
+        for (const auto& mesh : processedMeshes) meshIDs.push_back(addProcessedMesh(mesh));
+        return meshIDs;
+    }
 
-        std::vector<float3> positions(vertices.size());
-        std::vector<float3> normals(vertices.size());
-        std::vector<float2> texCoords(vertices.size());
-        std::transform(vertices.begin(), vertices.end(), positions.begin(), [] (const auto& v) { return v.position; });
-        std::transform(vertices.begin(), vertices.end(), normals.begin(), [] (const auto& v) { return v.normal; });
-        std::transform(vertices.begin(), vertices.end(), texCoords.begin(), [] (const auto& v) { return v.texCoord; });
+    std::vector<MeshID> SceneBuilder::addTriangleMeshes(fstd::span<const ref<TriangleMesh>> triangleMeshes, fstd::span<const ref<Material>> materials)
+    {
+        checkArgument(triangleMeshes.size() == materials.size(), "'triangleMeshes' and 'materials' must have the same size");
 
-        mesh.positions = { positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
-        mesh.normals = { normals.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
-        mesh.texCrds = { texCoords.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+        // The attribute storage must outlive the call to addMeshes().
+        std::vector<TriangleMeshAttributes> attributes(triangleMeshes.size());
+        std::vector<Mesh> meshes(triangleMeshes.size());
+        Threading::parallelFor(0, triangleMeshes.size(), [&](size_t i)
+        {
+            meshes[i] = createMeshFromTriangleMesh(triangleMeshes[i], materials[i], attributes[i]);
+        });
 
-        return addMesh(mesh);
+        return addMeshes(meshes);
     }
 
     SceneBuilder::ProcessedMesh SceneBuilder::processMesh(const Mesh& mesh_, MeshAttributeIndices* pAttributeIndices) const
@@ -513,7 +588,100 @@ namespace Falcor
             pAttributeIndices->reserve(mesh.vertexCount);
         }
 
-        if (mesh.mergeDuplicateVertices)
+        const bool weldVertices = is_set(mFlags, Flags::WeldVertices);
+        uint32_t weldedVertexCount = 0;
+
+        if (mesh.mergeDuplicateVertices && weldVertices)
+        {
+            // Weld vertices using a spatial hash of the vertex positions.
+            // This does not rely on the original index buffer and hence also merges vertices of triangle soups.
+            //
+            // The positions are quantized to a grid with cell size equal to the weld epsilon. A vertex can only
+            // match vertices in its own or the directly neighboring cells. With an epsilon of zero, positions have
+            // to match exactly and the cell is given by the bit pattern of the position.
+            // Each hash bucket points to the first vertex of a linked-list of vertices, similar to the scheme below.
+            //
+            const float epsilon = getVertexWeldEpsilon();
+            const int cellRange = epsilon > 0.f ? 1 : 0;
+
+            auto getCell = [&](const float3& position) -> int3
+            {
+                if (epsilon > 0.f)
+                {
+                    // Clamp the cells to a range where the cell and its neighbors are representable.
+                    // Cells at the border of the range may hold distant vertices, which are still compared by distance.
+                    // NaNs map to cell zero.
+                    auto toCell = [](float c) -> int32_t
+                    {
+                        const float kMaxCell = float(1 << 30);
+                        if (!(std::abs(c) < kMaxCell)) return c > 0.f ? (1 << 30) : (c < 0.f ? -(1 << 30) : 0);
+                        return int32_t(c);
+                    };
+                    const float3 c = math::floor(position / epsilon);
+                    return int3(toCell(c.x), toCell(c.y), toCell(c.z));
+                }
+                const float3 p = position + float3(0.f); // Map -0 to +0.
+                return int3(math::asint(p.x), math::asint(p.y), math::asint(p.z));
+            };
+
+            vertices.reserve(mesh.vertexCount);
+
+            std::unordered_map<uint64_t, uint32_t> heads;
+            heads.reserve(mesh.vertexCount);
+
+            for (uint32_t face = 0; face < mesh.faceCount; face++)
+            {
+                for (uint32_t vert = 0; vert < 3; vert++)
+                {
+                    const Mesh::Vertex v = mesh.getVertex(face, vert);
+                    const int3 cell = getCell(v.position);
+
+                    // Search the vertex lists of the cell and its neighbors.
+                    uint32_t index = invalidIndex;
+                    for (int z = -cellRange; z <= cellRange && index == invalidIndex; z++)
+                    {
+                        for (int y = -cellRange; y <= cellRange && index == invalidIndex; y++)
+                        {
+                            for (int x = -cellRange; x <= cellRange && index == invalidIndex; x++)
+                            {
+                                auto it = heads.find(hashWeldCell(cell + int3(x, y, z)));
+                                if (it == heads.end()) continue;
+                                for (uint32_t i = it->second; i != invalidIndex; i = vertices[i].second)
+                                {
+                                    if (compareVertices(v, vertices[i].first, 1e-6f, epsilon))
+                                    {
+                                        index = i;
+                                        break;
+                                    }
+                                }
+                            }
+                        }
+                    }
+
+                    // Insert new vertex if we couldn't find it.
+                    if (index == invalidIndex)
+                    {
+                        FALCOR_ASSERT(vertices.size() < std::numeric_limits<uint32_t>::max());
+                        index = (uint32_t)vertices.size();
+                        auto [it, inserted] = heads.try_emplace(hashWeldCell(cell), invalidIndex);
+                        vertices.push_back({ v, it->second });
+                        it->second = index;
+
+                        if (pAttributeIndices)
+                        {
+                            pAttributeIndices->push_back(mesh.getAttributeIndices(face, vert));
+                            FALCOR_ASSERT(vertices.size() == pAttributeIndices->size());
+                        }
+                    }
+
+                    // Store new vertex index.
+                    indices[face * 3 + vert] = index;
+                }
+            }
+
+            if (vertices.size() < mesh.vertexCount) weldedVertexCount = mesh.vertexCount - (uint32_t)vertices.size();
+        }
+        else if (mesh.mergeDuplicateVertices)
         {
             vertices.reserve(mesh.vertexCount);
 
@@ -608,6 +776,21 @@ namespace Falcor
         if (invalidCount > 0) logWarning("The mesh '{}' has inf/nan vertex attributes at {} vertices. Please fix the asset.", mesh.name, invalidCount);
         if (zeroCount > 0) logWarning("The mesh '{}' has zero-length normals/tangents at {} vertices. Please fix the asset.", mesh.name, zeroCount);
 
+        // Reorder triangles for post-transform vertex cache locality and reduced overdraw.
+        if (is_set(mFlags, Flags::ReorderTriangles))
+        {
+            const uint32_t uniqueVertexCount = (uint32_t)vertices.size();
+            processedMesh.originalVertexCacheStats = MeshOptimizer::analyzeVertexCache(indices, uniqueVertexCount);
+
+            std::vector<float3> positions(vertices.size());
+            std::transform(vertices.begin(), vertices.end(), positions.begin(), [] (const auto& v) { return v.first.position; });
+
+            MeshOptimizer::optimizeVertexCache(indices, uniqueVertexCount);
+            MeshOptimizer::optimizeOverdraw(indices, positions);
+
+            processedMesh.optimizedVertexCacheStats = MeshOptimizer::analyzeVertexCache(indices, uniqueVertexCount);
+        }
+
         // If the non-indexed vertices build flag is set, we will de-index the data below.
         const bool isIndexed = !is_set(mFlags, Flags::NonIndexedVertices);
         const uint32_t vertexCount = isIndexed ? (uint32_t)vertices.size() : mesh.indexCount;
@@ -622,6 +805,8 @@ namespace Falcor
             else processedMesh.indexData = compact16BitIndices(indices);
         }
 
+        processedMesh.weldedVertexCount = weldedVertexCount;
+
         // Copy vertices into processed mesh.
         processedMesh.staticData.reserve(vertexCount);
         if (mesh.hasBones()) processedMesh.skinningData.reserve(vertexCount);
@@ -708,6 +893,9 @@ namespace Falcor
         }
 
         mMeshes.push_back(spec);
+        mWeldedVertexCount += mesh.weldedVertexCount;
+        mVertexCacheReport.original += mesh.originalVertexCacheStats;
+        mVertexCacheReport.optimized += mesh.optimizedVertexCacheStats;
 
         if (mMeshes.size() > std::numeric_limits<uint32_t>::max())
         {
@@ -1694,6 +1882,11 @@ namespace Falcor
         }
     }
 
+    float SceneBuilder::getVertexWeldEpsilon() const
+    {
+        return std::max(0.f, mSettings.getOption("SceneBuilder:vertexWeldEpsilon", 0.f));
+    }
+
     void SceneBuilder::unifyTriangleWinding()
     {
         // This function makes the triangle winding for all meshes consistent in object space,
@@ -2858,8 +3051,12 @@ namespace Falcor
         flags.value("DontUseDisplacement", SceneBuilder::Flags::DontUseDisplacement);
         flags.value("UseCompressedHitInfo", SceneBuilder::Flags::UseCompressedHitInfo);
         flags.value("TessellateCurvesIntoPolyTubes", SceneBuilder::Flags::TessellateCurvesIntoPolyTubes);
+        flags.value("WeldVertices", SceneBuilder::Flags::WeldVertices);
+        flags.value("ReorderTriangles", SceneBuilder::Flags::ReorderTriangles);
+        flags.value("UseTextureCache", SceneBuilder::Flags::UseTextureCache);
         flags.value("UseCache", SceneBuilder::Flags::UseCache);
         flags.value("RebuildCache", SceneBuilder::Flags::RebuildCache);
+        flags.value("UncompressedCache", SceneBuilder::Flags::UncompressedCache);
         ScriptBindings::addEnumBinaryOperators(flags);
 
         pybind11::class_<SceneBuilder> sceneBuilder(m, "SceneBuilder");
@@ -2876,6 +3073,10 @@ namespace Falcor
         sceneBuilder.def_property("cameraSpeed", &SceneBuilder::getCameraSpeed, &SceneBuilder::setCameraSpeed);
         sceneBuilder.def("importScene", &SceneBuilder::import, "path"_a, "dict"_a = pybind11::dict());
         sceneBuilder.def("addTriangleMesh", &SceneBuilder::addTriangleMesh, "triangleMesh"_a, "material"_a);
+        sceneBuilder.def("addTriangleMeshes", [] (SceneBuilder* pSceneBuilder, const std::vector<ref<TriangleMesh>>& triangleMeshes, const std::vector<ref<Material>>& materials) {
+            checkArgument(pSceneBuilder, "'pSceneBuilder' is missing");
+            return pSceneBuilder->addTriangleMeshes(triangleMeshes, materials);
+        }, "triangleMeshes"_a, "materials"_a);
         sceneBuilder.def("addSDFGrid", &SceneBuilder::addSDFGrid, "sdfGrid"_a, "material"_a);
         sceneBuilder.def("addMaterial", &SceneBuilder::addMaterial, "material"_a);
         sceneBuilder.def("replaceMaterial", &SceneBuilder::replaceMaterial, "material"_a, "replacement"_a);
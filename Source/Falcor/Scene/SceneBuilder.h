@@ -28,6 +28,7 @@
 #pragma once
 #include "Scene.h"
 #include "SceneCache.h"
+#include "MeshOptimizer.h"
 #include "SceneIDs.h"
 #include "Transform.h"
 #include "TriangleMesh.h"
@@ -44,6 +45,8 @@
 
 #include <pybind11/pytypes.h>
 
+#include <fstd/span.h>
+
 #include <filesystem>
 #include <memory>
 #include <string>
@@ -76,9 +79,13 @@ namespace Falcor
             DontUseDisplacement             = 0x4000,   ///< Don't use displacement mapping.
             UseCompressedHitInfo            = 0x8000,   ///< Use compressed hit info (on scenes with triangle meshes only).
             TessellateCurvesIntoPolyTubes   = 0x10000,  ///< Tessellate curves into poly-tubes (the default is linear swept spheres).
+            WeldVertices                    = 0x20000,  ///< Merge duplicate vertices using a spatial hash instead of the original index buffer. This also welds non-indexed and badly indexed meshes. Positions are welded within the tolerance given by the 'SceneBuilder:vertexWeldEpsilon' option (default 0, i.e. exact match).
+            ReorderTriangles                = 0x40000,  ///< Reorder triangles within meshes for post-transform vertex cache locality and reduced overdraw. Vertex cache statistics are available via getVertexCacheReport().
+            UseTextureCache                 = 0x80000,  ///< Cache decoded textures and their mip chains on disk, keyed by file contents.
 
             UseCache                        = 0x10000000, ///< Enable scene caching. This caches the runtime scene representation on disk to reduce load time.
             RebuildCache                    = 0x20000000, ///< Rebuild scene cache.
+            UncompressedCache               = 0x40000000, ///< Store mesh data uncompressed in the scene cache. The data is memory mapped when loading the cache, which avoids decompression and intermediate copies at the cost of a larger file.
 
             Default = None
         };
@@ -275,10 +282,22 @@ namespace Falcor
             std::vector<uint32_t> indexData;    ///< Vertex indices in either 32-bit or 16-bit format packed tightly, or empty if non-indexed.
             std::vector<StaticVertexData> staticData;
             std::vector<SkinningVertexData> skinningData;
+            uint32_t weldedVertexCount = 0;     ///< Number of vertices removed by vertex welding (see Flags::WeldVertices).
+            MeshOptimizer::VertexCacheStats originalVertexCacheStats;   ///< Vertex cache statistics before triangle reordering (see Flags::ReorderTriangles).
+            MeshOptimizer::VertexCacheStats optimizedVertexCacheStats;  ///< Vertex cache statistics after triangle reordering (see Flags::ReorderTriangles).
         };
 
         using MeshAttributeIndices = std::vector<Mesh::VertexAttributeIndices>;
 
+        /** Vertex cache statistics of all meshes, before and after triangle reordering.
+            The statistics are only collected if Flags::ReorderTriangles is set.
+        */
+        struct VertexCacheReport
+        {
+            MeshOptimizer::VertexCacheStats original;
+            MeshOptimizer::VertexCacheStats optimized;
+        };
+
         /** Curve description.
         */
         struct Curve
@@ -409,6 +428,22 @@ namespace Falcor
         */
         MeshID addTriangleMesh(const ref<TriangleMesh>& pTriangleMesh, const ref<Material>& pMaterial);
 
+        /** Add a batch of meshes.
+            The meshes are pre-processed concurrently and then added in input order, so the returned mesh IDs are deterministic.
+            Throws an exception if something went wrong.
+            \param meshes The meshes to add. The attribute data must stay valid until the call returns.
+            \return The IDs of the meshes in the scene, in the same order as the input.
+        */
+        std::vector<MeshID> addMeshes(fstd::span<const Mesh> meshes);
+
+        /** Add a batch of triangle meshes.
+            The meshes are pre-processed concurrently and then added in input order, so the returned mesh IDs are deterministic.
+            \param triangleMeshes The triangle meshes to add.
+            \param materials The materials to use for the meshes. Must have the same size as triangleMeshes.
+            \return The IDs of the meshes in the scene, in the same order as the input.
+        */
+        std::vector<MeshID> addTriangleMeshes(fstd::span<const ref<TriangleMesh>> triangleMeshes, fstd::span<const ref<Material>> materials);
+
         /** Pre-process a mesh into the data format that is used in the global scene buffers.
             Throws an exception if something went wrong.
             \param mesh The mesh to pre-process.
@@ -429,6 +464,11 @@ namespace Falcor
         */
         MeshID addProcessedMesh(const ProcessedMesh& mesh);
 
+        /** Get the vertex cache statistics of the meshes added so far.
+            \return The statistics before and after triangle reordering. Only collected if Flags::ReorderTriangles is set.
+        */
+        const VertexCacheReport& getVertexCacheReport() const { return mVertexCacheReport; }
+
         /** Set mesh vertex cache for animation.
             \param[in] cachedCurves The mesh vertex cache data (will be moved from).
         */
@@ -754,6 +794,8 @@ namespace Falcor
         ref<Scene> mpScene;
         SceneCache::Key mSceneCacheKey;
         bool mWriteSceneCache = false;  ///< True if scene cache should be written after import.
+        uint64_t mWeldedVertexCount = 0; ///< Total number of vertices removed by vertex welding.
+        VertexCacheReport mVertexCacheReport;
 
         SceneGraph mSceneGraph;
 
@@ -773,6 +815,10 @@ namespace Falcor
         void flipTriangleWinding(MeshSpec& mesh);
         void updateSDFGridID(SdfGridID oldID, SdfGridID newID);
 
+        /** Get the tolerance for vertex welding (see Flags::WeldVertices) from the 'SceneBuilder:vertexWeldEpsilon' option.
+        */
+        float getVertexWeldEpsilon() const;
+
         /** Split a mesh by the given axis-aligned splitting plane.
             \return Pair of optional mesh IDs for the meshes on the left and right side, respectively.
         */
@@ -31,9 +31,12 @@
 #include "Material/ClothMaterial.h"
 #include "Material/MaterialTextureLoader.h"
 #include "Utils/Logger.h"
+#include "Utils/Threading.h"
+#include "Core/Platform/MemoryMappedFile.h"
 
-#include <lz4_stream/lz4_stream.h>
+#include <lz4.h>
 
+#include <algorithm>
 #include <fstream>
 
 namespace Falcor
@@ -43,37 +46,96 @@ namespace Falcor
         /** Specfies the current cache file version.
             This needs to be incremented every time the file format changes!
         */
-        const uint32_t kVersion = 25;
+        const uint32_t kVersion = 27;
 
         /** Scene cache directory (subdirectory in the application data directory).
         */
         const std::string kDirectory = "NVIDIA/Falcor/SceneCache";
 
-        const size_t kBlockSize = 1 * 1024 * 1024;
+        /** Size of uncompressed chunks. Each chunk is compressed independently.
+        */
+        const size_t kChunkSize = 4 * 1024 * 1024;
+
+        /** Maximum amount of data (compressed or uncompressed) that is kept in flight while reading/writing.
+        */
+        const size_t kBatchSize = 256 * 1024 * 1024;
+
+        /** Alignment of uncompressed sections in the file.
+            This is a multiple of the page size (and the allocation granularity on Windows) so the data can be memory mapped.
+        */
+        const uint64_t kUncompressedAlignment = 64 * 1024;
 
         const char* kMagic = "FalcorS$";
         struct Header
         {
             uint8_t magic[8]{};
             uint32_t version{};
+            uint32_t sectionCount{};
+            uint64_t tocOffset{};           ///< File offset of the table of contents.
+            uint64_t chunkCount{};
 
             bool isValid() const
             {
                 return std::memcmp(magic, kMagic, sizeof(Header::magic)) == 0 && version == kVersion;
             }
         };
+
+        /** Sections stored in the cache file.
+            Bulk vertex/index arrays are stored in their own sections so they can be decompressed directly into the destination arrays.
+        */
+        enum class SectionID : uint32_t
+        {
+            Metadata,
+            Cameras,
+            Lights,
+            Volumes,
+            EnvMap,
+            Materials,
+            SceneGraph,
+            Animations,
+            Meshes,
+            MeshIndexData,
+            MeshStaticData,
+            MeshSkinningData,
+            Curves,
+            CurveIndexData,
+            CurveStaticData,
+            CustomPrimitives,
+
+            Count
+        };
+
+        const uint32_t kSectionUncompressed = 0x1;
+
+        struct SectionEntry
+        {
+            uint32_t id{};
+            uint32_t flags{};
+            uint64_t firstChunk{};
+            uint64_t chunkCount{};
+            uint64_t size{};                ///< Uncompressed size in bytes.
+            uint64_t offset{};              ///< File offset of the data (uncompressed sections only).
+        };
+
+        struct ChunkEntry
+        {
+            uint64_t offset{};              ///< File offset of the compressed data.
+            uint32_t compressedSize{};
+            uint32_t size{};                ///< Uncompressed size in bytes.
+        };
     }
 
-    /** Wrapper around std::ostream to ease serialization of basic types.
+    /** Helper to serialize basic types into a memory buffer.
     */
     class SceneCache::OutputStream
     {
     public:
-        OutputStream(std::ostream& stream) : mStream(stream) {}
+        OutputStream() = default;
 
         void write(const void* data, size_t len)
         {
-            mStream.write(reinterpret_cast<const char*>(data), len);
+            const uint8_t* pData = reinterpret_cast<const uint8_t*>(data);
+            mBuffer.insert(mBuffer.end(), pData, pData + len);
         }
 
         template<typename T>
@@ -117,20 +179,24 @@ namespace Falcor
             if (hasValue) write(opt.value());
         }
 
+        const std::vector<uint8_t>& getBuffer() const { return mBuffer; }
+
     private:
-        std::ostream& mStream;
+        std::vector<uint8_t> mBuffer;
     };
 
-    /** Wrapper around std::istream to ease serialization of basic types.
+    /** Helper to deserialize basic types from a memory buffer.
     */
     class SceneCache::InputStream
     {
     public:
-        InputStream(std::istream& stream) : mStream(stream) {}
+        InputStream(const std::vector<uint8_t>& buffer) : mpData(buffer.data()), mSize(buffer.size()) {}
 
         void read(void* data, size_t len)
         {
-            mStream.read(reinterpret_cast<char*>(data), len);
+            if (len > mSize - mOffset) throw RuntimeError("Unexpected end of scene cache section.");
+            std::memcpy(data, mpData + mOffset, len);
+            mOffset += len;
         }
 
         template<typename T>
@@ -188,8 +254,312 @@ namespace Falcor
             }
         }
 
+        /** Check that the whole section has been consumed.
+        */
+        void checkEnd() const
+        {
+            if (mOffset != mSize) throw RuntimeError("Scene cache section has unexpected size.");
+        }
+
     private:
-        std::istream& mStream;
+        const uint8_t* mpData;
+        size_t mSize;
+        size_t mOffset = 0;
+    };
+
+    /** Writes sections of chunked, LZ4 compressed data to a cache file.
+        Chunks are compressed in parallel in batches of up to `kBatchSize` bytes.
+        Sections can optionally be stored uncompressed and aligned for memory mapping.
+    */
+    class SceneCache::FileWriter
+    {
+    public:
+        FileWriter(std::ofstream& fs) : mStream(fs)
+        {
+            // Reserve space for the header.
+            Header header;
+            mStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            mOffset = sizeof(header);
+        }
+
+        void writeSection(SectionID id, const void* pData, size_t size, bool compress = true)
+        {
+            SectionEntry section;
+            section.id = (uint32_t)id;
+            section.size = size;
+            section.firstChunk = mChunks.size();
+
+            if (!compress)
+            {
+                uint64_t alignedOffset = (mOffset + kUncompressedAlignment - 1) / kUncompressedAlignment * kUncompressedAlignment;
+                std::vector<char> padding(alignedOffset - mOffset, 0);
+                mStream.write(padding.data(), padding.size());
+                mStream.write(reinterpret_cast<const char*>(pData), size);
+                section.flags = kSectionUncompressed;
+                section.offset = alignedOffset;
+                mOffset = alignedOffset + size;
+                mSections.push_back(section);
+                return;
+            }
+
+            section.chunkCount = (size + kChunkSize - 1) / kChunkSize;
+
+            const char* pSrc = reinterpret_cast<const char*>(pData);
+            const size_t batchChunkCount = kBatchSize / kChunkSize;
+            std::vector<std::vector<char>> compressed(std::min<size_t>(section.chunkCount, batchChunkCount));
+
+            for (size_t batchBegin = 0; batchBegin < section.chunkCount; batchBegin += batchChunkCount)
+            {
+                size_t batchEnd = std::min<size_t>(section.chunkCount, batchBegin + batchChunkCount);
+
+                Threading::parallelFor(batchBegin, batchEnd, [&](size_t chunk)
+                {
+                    size_t offset = chunk * kChunkSize;
+                    int srcSize = (int)std::min(kChunkSize, size - offset);
+                    auto& dst = compressed[chunk - batchBegin];
+                    dst.resize(LZ4_compressBound(srcSize));
+                    int compressedSize = LZ4_compress_default(pSrc + offset, dst.data(), srcSize, (int)dst.size());
+                    if (compressedSize <= 0) throw RuntimeError("Failed to compress scene cache data.");
+                    dst.resize(compressedSize);
+                }, 1);
+
+                for (size_t chunk = batchBegin; chunk < batchEnd; ++chunk)
+                {
+                    const auto& data = compressed[chunk - batchBegin];
+                    ChunkEntry entry;
+                    entry.offset = mOffset;
+                    entry.compressedSize = (uint32_t)data.size();
+                    entry.size = (uint32_t)std::min(kChunkSize, size - chunk * kChunkSize);
+                    mStream.write(data.data(), data.size());
+                    mOffset += data.size();
+                    mChunks.push_back(entry);
+                }
+            }
+
+            mSections.push_back(section);
+        }
+
+        void writeSection(SectionID id, const OutputStream& stream)
+        {
+            const auto& buffer = stream.getBuffer();
+            writeSection(id, buffer.data(), buffer.size());
+        }
+
+        template<typename T>
+        void writeSection(SectionID id, const std::vector<T>& vec, bool compress = true)
+        {
+            static_assert(std::is_trivially_copyable<T>::value);
+            writeSection(id, vec.data(), vec.size() * sizeof(T), compress);
+        }
+
+        /** Write the table of contents and the final header.
+        */
+        void finalize()
+        {
+            Header header;
+            std::memcpy(header.magic, kMagic, sizeof(Header::magic));
+            header.version = kVersion;
+            header.sectionCount = (uint32_t)mSections.size();
+            header.tocOffset = mOffset;
+            header.chunkCount = mChunks.size();
+
+            mStream.write(reinterpret_cast<const char*>(mSections.data()), mSections.size() * sizeof(SectionEntry));
+            mStream.write(reinterpret_cast<const char*>(mChunks.data()), mChunks.size() * sizeof(ChunkEntry));
+
+            mStream.seekp(0);
+            mStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+
+    private:
+        std::ofstream& mStream;
+        uint64_t mOffset = 0;
+        std::vector<SectionEntry> mSections;
+        std::vector<ChunkEntry> mChunks;
+    };
+
+    /** Reads sections of chunked, LZ4 compressed data from a cache file.
+        File I/O runs on the calling thread while previously read batches of chunks are decompressed in parallel.
+        Uncompressed sections can alternatively be accessed through a memory mapping of the file.
+    */
+    class SceneCache::FileReader
+    {
+    public:
+        struct Request
+        {
+            SectionID id;
+            void* pData;        ///< Destination buffer. Must be large enough to hold the uncompressed section.
+        };
+
+        FileReader(std::ifstream& fs, const std::filesystem::path& path) : mStream(fs), mPath(path)
+        {
+            Header header;
+            mStream.read(reinterpret_cast<char*>(&header), sizeof(header));
+            if (!mStream.good() || !header.isValid()) throw RuntimeError("Invalid header in scene cache file '{}'.", path);
+
+            // Validate the table of contents against the file size before allocating memory for it.
+            mStream.seekg(0, std::ios_base::end);
+            const uint64_t fileSize = (uint64_t)mStream.tellg();
+            if (header.tocOffset < sizeof(Header) || header.tocOffset > fileSize ||
+                header.sectionCount > (fileSize - header.tocOffset) / sizeof(SectionEntry) ||
+                header.chunkCount > (fileSize - header.tocOffset - header.sectionCount * sizeof(SectionEntry)) / sizeof(ChunkEntry))
+                throw RuntimeError("Invalid table of contents in scene cache file '{}'.", path);
+
+            std::vector<SectionEntry> sections(header.sectionCount);
+            mChunks.resize(header.chunkCount);
+            mStream.seekg(header.tocOffset);
+            mStream.read(reinterpret_cast<char*>(sections.data()), sections.size() * sizeof(SectionEntry));
+            mStream.read(reinterpret_cast<char*>(mChunks.data()), mChunks.size() * sizeof(ChunkEntry));
+            if (!mStream.good()) throw RuntimeError("Failed to read table of contents from scene cache file '{}'.", path);
+
+            for (const auto& chunk : mChunks)
+            {
+                if (chunk.size > kChunkSize || chunk.offset > header.tocOffset || chunk.compressedSize > header.tocOffset - chunk.offset)
+                    throw RuntimeError("Invalid table of contents in scene cache file '{}'.", path);
+            }
+
+            mSections.resize((size_t)SectionID::Count);
+            for (const auto& section : sections)
+            {
+                if (section.id >= (uint32_t)SectionID::Count || section.firstChunk > mChunks.size() || section.chunkCount > mChunks.size() - section.firstChunk)
+                    throw RuntimeError("Invalid table of contents in scene cache file '{}'.", path);
+                if (section.flags & kSectionUncompressed)
+                {
+                    if (section.offset > header.tocOffset || section.size > header.tocOffset - section.offset)
+                        throw RuntimeError("Invalid table of contents in scene cache file '{}'.", path);
+                }
+                else
+                {
+                    // The chunks are decompressed back to back into the destination buffer, their sizes have to add up to the section size.
+                    uint64_t size = 0;
+                    for (uint64_t i = 0; i < section.chunkCount; ++i) size += mChunks[section.firstChunk + i].size;
+                    if (size != section.size)
+                        throw RuntimeError("Invalid table of contents in scene cache file '{}'.", path);
+                }
+                mSections[section.id] = section;
+            }
+        }
+
+        uint64_t getSectionSize(SectionID id) const { return mSections[(size_t)id].size; }
+
+        bool isSectionUncompressed(SectionID id) const { return (mSections[(size_t)id].flags & kSectionUncompressed) != 0; }
+
+        /** Get a view of an uncompressed section in the memory mapped file.
+            The file is mapped on first use, use getMappedFile() to keep the mapping alive.
+        */
+        template<typename T>
+        fstd::span<const T> mapSection(SectionID id)
+        {
+            const auto& section = mSections[(size_t)id];
+            FALCOR_ASSERT(section.flags & kSectionUncompressed);
+            if (section.size % sizeof(T) != 0 || section.offset % alignof(T) != 0) throw RuntimeError("Scene cache section has unexpected size.");
+            if (section.size == 0) return {};
+
+            if (!mpMappedFile)
+            {
+                mpMappedFile = std::make_shared<MemoryMappedFile>(mPath, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan);
+                if (!mpMappedFile->isOpen()) throw RuntimeError("Failed to memory map scene cache file '{}'.", mPath);
+            }
+            if (section.offset + section.size > mpMappedFile->getMappedSize()) throw RuntimeError("Scene cache section exceeds mapped file size.");
+
+            const uint8_t* pData = reinterpret_cast<const uint8_t*>(mpMappedFile->getData()) + section.offset;
+            return fstd::span<const T>(reinterpret_cast<const T*>(pData), section.size / sizeof(T));
+        }
+
+        const std::shared_ptr<MemoryMappedFile>& getMappedFile() const { return mpMappedFile; }
+
+        /** Read and decompress the requested sections.
+        */
+        void readSections(const std::vector<Request>& requests)
+        {
+            struct Job
+            {
+                const ChunkEntry* pChunk;
+                char* pDst;
+            };
+
+            std::vector<Job> jobs;
+            for (const auto& request : requests)
+            {
+                const auto& section = mSections[(size_t)request.id];
+                char* pDst = reinterpret_cast<char*>(request.pData);
+                if (section.flags & kSectionUncompressed)
+                {
+                    mStream.seekg(section.offset);
+                    mStream.read(pDst, section.size);
+                    if (!mStream.good()) throw RuntimeError("Failed to read scene cache data.");
+                    continue;
+                }
+                for (uint64_t i = 0; i < section.chunkCount; ++i)
+                {
+                    const auto& chunk = mChunks[section.firstChunk + i];
+                    jobs.push_back({ &chunk, pDst });
+                    pDst += chunk.size;
+                }
+            }
+            std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.pChunk->offset < b.pChunk->offset; });
+
+            // Double buffered: read the next batch while the previous one is decompressed on the thread pool.
+            std::vector<char> buffers[2];
+            Threading::Task decodeTask;
+            size_t bufferIndex = 0;
+
+            try
+            {
+                for (size_t batchBegin = 0; batchBegin < jobs.size();)
+                {
+                    size_t batchEnd = batchBegin;
+                    size_t batchSize = 0;
+                    while (batchEnd < jobs.size() && (batchEnd == batchBegin || batchSize + jobs[batchEnd].pChunk->compressedSize <= kBatchSize))
+                    {
+                        batchSize += jobs[batchEnd].pChunk->compressedSize;
+                        ++batchEnd;
+                    }
+
+                    auto& buffer = buffers[bufferIndex];
+                    buffer.resize(batchSize);
+                    std::vector<size_t> bufferOffsets(batchEnd - batchBegin);
+                    size_t bufferOffset = 0;
+                    for (size_t i = batchBegin; i < batchEnd; ++i)
+                    {
+                        const auto& chunk = *jobs[i].pChunk;
+                        if ((uint64_t)mStream.tellg() != chunk.offset) mStream.seekg(chunk.offset);
+                        mStream.read(buffer.data() + bufferOffset, chunk.compressedSize);
+                        bufferOffsets[i - batchBegin] = bufferOffset;
+                        bufferOffset += chunk.compressedSize;
+                    }
+                    if (!mStream.good()) throw RuntimeError("Failed to read scene cache data.");
+
+                    decodeTask.finish();
+                    decodeTask = Threading::dispatchTask([&jobs, &buffer, batchBegin, batchEnd, offsets = std::move(bufferOffsets)]()
+                    {
+                        Threading::parallelFor(batchBegin, batchEnd, [&](size_t i)
+                        {
+                            const auto& chunk = *jobs[i].pChunk;
+                            int size = LZ4_decompress_safe(buffer.data() + offsets[i - batchBegin], jobs[i].pDst, (int)chunk.compressedSize, (int)chunk.size);
+                            if (size != (int)chunk.size) throw RuntimeError("Failed to decompress scene cache data.");
+                        }, 1);
+                    });
+
+                    bufferIndex = 1 - bufferIndex;
+                    batchBegin = batchEnd;
+                }
+            }
+            catch (...)
+            {
+                // Make sure the in-flight decode task does not outlive the buffers.
+                try { decodeTask.finish(); } catch (...) {}
+                throw;
+            }
+
+            decodeTask.finish();
+        }
+
+    private:
+        std::ifstream& mStream;
+        std::filesystem::path mPath;
+        std::shared_ptr<MemoryMappedFile> mpMappedFile;
+        std::vector<SectionEntry> mSections;
+        std::vector<ChunkEntry> mChunks;
     };
 
     bool SceneCache::hasValidCache(const Key& key)
@@ -207,7 +577,7 @@ namespace Falcor
         return !fs.eof() && header.isValid();
     }
 
-    void SceneCache::writeCache(const Scene::SceneData& sceneData, const Key& key)
+    void SceneCache::writeCache(const Scene::SceneData& sceneData, const Key& key, bool uncompressedMeshData)
     {
         auto cachePath = getCachePath(key);
 
@@ -220,20 +590,14 @@ namespace Falcor
         std::ofstream fs(cachePath.c_str(), std::ios_base::binary);
         if (fs.bad()) throw RuntimeError("Failed to create scene cache file '{}'.", cachePath);
 
-        // Write header (uncompressed).
-        Header header;
-        std::memcpy(header.magic, kMagic, sizeof(Header::magic));
-        header.version = kVersion;
-        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
-
-        // Write cache (compressed).
-        lz4_stream::basic_ostream<kBlockSize> zs(fs);
-        OutputStream stream(zs);
-        writeSceneData(stream, sceneData);
+        // Write sections followed by the table of contents and header.
+        FileWriter writer(fs);
+        writeSceneData(writer, sceneData, uncompressedMeshData);
+        writer.finalize();
         if (fs.bad()) throw RuntimeError("Failed to write scene cache file to '{}'.", cachePath);
     }
 
-    Scene::SceneData SceneCache::readCache(ref<Device> pDevice, const Key& key)
+    Scene::SceneData SceneCache::readCache(ref<Device> pDevice, const Key& key, Sections sections, bool useTextureCache)
     {
         auto cachePath = getCachePath(key);
 
@@ -243,17 +607,8 @@ namespace Falcor
         std::ifstream fs(cachePath.c_str(), std::ios_base::binary);
         if (fs.bad()) throw RuntimeError("Failed to open scene cache file '{}'.", cachePath);
 
-        // Read header (uncompressed).
-        Header header;
-        fs.read(reinterpret_cast<char*>(&header), sizeof(header));
-        if (!header.isValid()) throw RuntimeError("Invalid header in scene cache file '{}'.", cachePath);
-
-        // Read cache (compressed).
-        lz4_stream::basic_istream<kBlockSize, kBlockSize> zs(fs);
-        InputStream stream(zs);
-        auto sceneData = readSceneData(stream, pDevice);
-        if (fs.bad()) throw RuntimeError("Failed to read scene cache file from '{}'.", cachePath);
-        return sceneData;
+        FileReader reader(fs, cachePath);
+        return readSceneData(reader, pDevice, sections, useTextureCache);
     }
 
     std::filesystem::path SceneCache::getCachePath(const Key& key)
@@ -263,151 +618,254 @@ namespace Falcor
 
     // SceneData
 
-    void SceneCache::writeSceneData(OutputStream& stream, const Scene::SceneData& sceneData)
+    void SceneCache::writeSceneData(FileWriter& writer, const Scene::SceneData& sceneData, bool uncompressedMeshData)
     {
-        writeMarker(stream, "Path");
-        stream.write(sceneData.path);
-
-        writeMarker(stream, "RenderSettings");
-        stream.write(sceneData.renderSettings);
-
-        writeMarker(stream, "Cameras");
-        stream.write((uint32_t)sceneData.cameras.size());
-        for (const auto& pCamera : sceneData.cameras) writeCamera(stream, pCamera);
-        stream.write(sceneData.selectedCamera);
-        stream.write(sceneData.cameraSpeed);
-
-        writeMarker(stream, "Lights");
-        stream.write((uint32_t)sceneData.lights.size());
-        for (const auto& pLight : sceneData.lights) writeLight(stream, pLight);
-
-        writeMarker(stream, "Grids");
-        stream.write((uint32_t)sceneData.grids.size());
-        for (const auto& pGrid : sceneData.grids) writeGrid(stream, pGrid);
-
-        writeMarker(stream, "GridVolumes");
-        stream.write((uint32_t)sceneData.gridVolumes.size());
-        for (const auto& pGridVolume : sceneData.gridVolumes) writeGridVolume(stream, pGridVolume, sceneData.grids);
-
-        writeMarker(stream, "EnvMap");
-        bool hasEnvMap = sceneData.pEnvMap != nullptr;
-        stream.write(hasEnvMap);
-        if (hasEnvMap) writeEnvMap(stream, sceneData.pEnvMap);
-
-        writeMarker(stream, "Materials");
-        writeMaterials(stream, *sceneData.pMaterials);
+        {
+            OutputStream stream;
+            stream.write(sceneData.path);
+            stream.write(sceneData.renderSettings);
+            writeMetadata(stream, sceneData.metadata);
+            writer.writeSection(SectionID::Metadata, stream);
+        }
 
-        writeMarker(stream, "SceneGraph");
-        stream.write((uint32_t)sceneData.sceneGraph.size());
-        for (const auto& node : sceneData.sceneGraph)
         {
-            stream.write(node.name);
-            stream.write(node.parent);
-            stream.write(node.transform);
-            stream.write(node.meshBind);
-            stream.write(node.localToBindSpace);
+            OutputStream stream;
+            stream.write((uint32_t)sceneData.cameras.size());
+            for (const auto& pCamera : sceneData.cameras) writeCamera(stream, pCamera);
+            stream.write(sceneData.selectedCamera);
+            stream.write(sceneData.cameraSpeed);
+            writer.writeSection(SectionID::Cameras, stream);
         }
 
-        writeMarker(stream, "Animations");
-        stream.write((uint32_t)sceneData.animations.size());
-        for (const auto& pAnimation : sceneData.animations)
         {
-            writeAnimation(stream, pAnimation);
+            OutputStream stream;
+            stream.write((uint32_t)sceneData.lights.size());
+            for (const auto& pLight : sceneData.lights) writeLight(stream, pLight);
+            writer.writeSection(SectionID::Lights, stream);
         }
 
-        writeMarker(stream, "Metadata");
-        writeMetadata(stream, sceneData.metadata);
+        {
+            OutputStream stream;
+            stream.write((uint32_t)sceneData.grids.size());
+            for (const auto& pGrid : sceneData.grids) writeGrid(stream, pGrid);
+            stream.write((uint32_t)sceneData.gridVolumes.size());
+            for (const auto& pGridVolume : sceneData.gridVolumes) writeGridVolume(stream, pGridVolume, sceneData.grids);
+            writer.writeSection(SectionID::Volumes, stream);
+        }
 
-        writeMarker(stream, "Meshes");
-        stream.write(sceneData.meshDesc);
-        stream.write(sceneData.meshNames);
-        stream.write(sceneData.meshBBs);
-        stream.write(sceneData.meshInstanceData);
-        stream.write((uint32_t)sceneData.meshIdToInstanceIds.size());
-        for (const auto& item : sceneData.meshIdToInstanceIds)
         {
-            stream.write(item);
+            OutputStream stream;
+            bool hasEnvMap = sceneData.pEnvMap != nullptr;
+            stream.write(hasEnvMap);
+            if (hasEnvMap) writeEnvMap(stream, sceneData.pEnvMap);
+            writer.writeSection(SectionID::EnvMap, stream);
         }
-        stream.write((uint32_t)sceneData.meshGroups.size());
-        for (const auto& group : sceneData.meshGroups)
+
         {
-            stream.write(group.meshList);
-            stream.write(group.isStatic);
-            stream.write(group.isDisplaced);
+            OutputStream stream;
+            writeMaterials(stream, *sceneData.pMaterials);
+            writer.writeSection(SectionID::Materials, stream);
         }
-        stream.write((uint32_t)sceneData.cachedMeshes.size());
-        for (const auto& cachedMesh : sceneData.cachedMeshes)
+
         {
-            stream.write(cachedMesh.meshID);
-            stream.write(cachedMesh.timeSamples);
-            stream.write((uint32_t)cachedMesh.vertexData.size());
-            for (const auto& data : cachedMesh.vertexData) stream.write(data);
+            OutputStream stream;
+            stream.write((uint32_t)sceneData.sceneGraph.size());
+            for (const auto& node : sceneData.sceneGraph)
+            {
+                stream.write(node.name);
+                stream.write(node.parent);
+                stream.write(node.transform);
+                stream.write(node.meshBind);
+                stream.write(node.localToBindSpace);
+            }
+            writer.writeSection(SectionID::SceneGraph, stream);
         }
-        stream.write(sceneData.useCompressedHitInfo);
-        stream.write(sceneData.has16BitIndices);
-        stream.write(sceneData.has32BitIndices);
-        stream.write(sceneData.meshDrawCount);
-        stream.write(sceneData.meshIndexData);
-        stream.write(sceneData.meshStaticData);
-        stream.write(sceneData.meshSkinningData);
 
-        writeMarker(stream, "Curves");
-        stream.write(sceneData.curveDesc);
-        stream.write(sceneData.curveBBs);
-        stream.write(sceneData.curveInstanceData);
-        stream.write(sceneData.curveIndexData);
-        stream.write(sceneData.curveStaticData);
+        {
+            OutputStream stream;
+            stream.write((uint32_t)sceneData.animations.size());
+            for (const auto& pAnimation : sceneData.animations)
+            {
+                writeAnimation(stream, pAnimation);
+            }
+            writer.writeSection(SectionID::Animations, stream);
+        }
 
-        stream.write((uint32_t)sceneData.cachedCurves.size());
-        for (const auto& cachedCurve : sceneData.cachedCurves)
         {
-            stream.write(cachedCurve.tessellationMode);
-            stream.write(cachedCurve.geometryID);
-            stream.write(cachedCurve.timeSamples);
-            stream.write(cachedCurve.indexData);
-            stream.write((uint32_t)cachedCurve.vertexData.size());
-            for (const auto& data : cachedCurve.vertexData) stream.write(data);
+            OutputStream stream;
+            stream.write(sceneData.meshDesc);
+            stream.write(sceneData.meshNames);
+            stream.write(sceneData.meshBBs);
+            stream.write(sceneData.meshInstanceData);
+            stream.write((uint32_t)sceneData.meshIdToInstanceIds.size());
+            for (const auto& item : sceneData.meshIdToInstanceIds)
+            {
+                stream.write(item);
+            }
+            stream.write((uint32_t)sceneData.meshGroups.size());
+            for (const auto& group : sceneData.meshGroups)
+            {
+                stream.write(group.meshList);
+                stream.write(group.isStatic);
+                stream.write(group.isDisplaced);
+            }
+            stream.write((uint32_t)sceneData.cachedMeshes.size());
+            for (const auto& cachedMesh : sceneData.cachedMeshes)
+            {
+                stream.write(cachedMesh.meshID);
+                stream.write(cachedMesh.timeSamples);
+                stream.write((uint32_t)cachedMesh.vertexData.size());
+                for (const auto& data : cachedMesh.vertexData) stream.write(data);
+            }
+            stream.write(sceneData.useCompressedHitInfo);
+            stream.write(sceneData.has16BitIndices);
+            stream.write(sceneData.has32BitIndices);
+            stream.write(sceneData.meshDrawCount);
+            writer.writeSection(SectionID::Meshes, stream);
         }
+        writer.writeSection(SectionID::MeshIndexData, sceneData.meshIndexData, !uncompressedMeshData);
+        writer.writeSection(SectionID::MeshStaticData, sceneData.meshStaticData, !uncompressedMeshData);
+        writer.writeSection(SectionID::MeshSkinningData, sceneData.meshSkinningData, !uncompressedMeshData);
 
-        writeMarker(stream, "CustomPrimitives");
-        stream.write(sceneData.customPrimitiveDesc);
-        stream.write(sceneData.customPrimitiveAABBs);
+        {
+            OutputStream stream;
+            stream.write(sceneData.curveDesc);
+            stream.write(sceneData.curveBBs);
+            stream.write(sceneData.curveInstanceData);
+            stream.write((uint32_t)sceneData.cachedCurves.size());
+            for (const auto& cachedCurve : sceneData.cachedCurves)
+            {
+                stream.write(cachedCurve.tessellationMode);
+                stream.write(cachedCurve.geometryID);
+                stream.write(cachedCurve.timeSamples);
+                stream.write(cachedCurve.indexData);
+                stream.write((uint32_t)cachedCurve.vertexData.size());
+                for (const auto& data : cachedCurve.vertexData) stream.write(data);
+            }
+            writer.writeSection(SectionID::Curves, stream);
+        }
+        writer.writeSection(SectionID::CurveIndexData, sceneData.curveIndexData);
+        writer.writeSection(SectionID::CurveStaticData, sceneData.curveStaticData);
 
-        writeMarker(stream, "End");
+        {
+            OutputStream stream;
+            stream.write(sceneData.customPrimitiveDesc);
+            stream.write(sceneData.customPrimitiveAABBs);
+            writer.writeSection(SectionID::CustomPrimitives, stream);
+        }
     }
 
-    Scene::SceneData SceneCache::readSceneData(InputStream& stream, ref<Device> pDevice)
+    Scene::SceneData SceneCache::readSceneData(FileReader& reader, ref<Device> pDevice, Sections sections, bool useTextureCache)
     {
         Scene::SceneData sceneData;
         sceneData.pMaterials = std::make_unique<MaterialSystem>(pDevice);
+        if (useTextureCache) sceneData.pMaterials->getTextureManager().setTextureCacheEnabled(true);
+
+        // Decompress all requested sections in parallel.
+        // Bulk arrays are decompressed directly into the scene data, all other sections into temporary buffers.
+        std::vector<std::vector<uint8_t>> buffers((size_t)SectionID::Count);
+        std::vector<FileReader::Request> requests;
+
+        auto requestSection = [&](SectionID id)
+        {
+            auto& buffer = buffers[(size_t)id];
+            buffer.resize(reader.getSectionSize(id));
+            requests.push_back({ id, buffer.data() });
+        };
+
+        auto requestArray = [&](SectionID id, auto& vec)
+        {
+            using T = typename std::decay_t<decltype(vec)>::value_type;
+            uint64_t size = reader.getSectionSize(id);
+            if (size % sizeof(T) != 0) throw RuntimeError("Scene cache section has unexpected size.");
+            vec.resize(size / sizeof(T));
+            requests.push_back({ id, vec.data() });
+        };
 
-        readMarker(stream, "Path");
-        stream.read(sceneData.path);
+        if (is_set(sections, Sections::Metadata)) requestSection(SectionID::Metadata);
+        if (is_set(sections, Sections::Cameras)) requestSection(SectionID::Cameras);
+        if (is_set(sections, Sections::Lights)) requestSection(SectionID::Lights);
+        if (is_set(sections, Sections::Volumes)) requestSection(SectionID::Volumes);
+        if (is_set(sections, Sections::EnvMap)) requestSection(SectionID::EnvMap);
+        if (is_set(sections, Sections::Materials)) requestSection(SectionID::Materials);
+        if (is_set(sections, Sections::SceneGraph)) requestSection(SectionID::SceneGraph);
+        if (is_set(sections, Sections::Animations)) requestSection(SectionID::Animations);
+        if (is_set(sections, Sections::Meshes))
+        {
+            requestSection(SectionID::Meshes);
+            if (reader.isSectionUncompressed(SectionID::MeshIndexData) &&
+                reader.isSectionUncompressed(SectionID::MeshStaticData) &&
+                reader.isSectionUncompressed(SectionID::MeshSkinningData))
+            {
+                // Reference the mesh data directly in the mapped file to avoid a copy on the heap.
+                Scene::SceneData::MappedMeshData mapped;
+                mapped.indexData = reader.mapSection<uint32_t>(SectionID::MeshIndexData);
+                mapped.staticData = reader.mapSection<PackedStaticVertexData>(SectionID::MeshStaticData);
+                mapped.skinningData = reader.mapSection<SkinningVertexData>(SectionID::MeshSkinningData);
+                mapped.pFile = reader.getMappedFile();
+                sceneData.mappedMeshData = std::move(mapped);
+            }
+            else
+            {
+                requestArray(SectionID::MeshIndexData, sceneData.meshIndexData);
+                requestArray(SectionID::MeshStaticData, sceneData.meshStaticData);
+                requestArray(SectionID::MeshSkinningData, sceneData.meshSkinningData);
+            }
+        }
+        if (is_set(sections, Sections::Curves))
+        {
+            requestSection(SectionID::Curves);
+            requestArray(SectionID::CurveIndexData, sceneData.curveIndexData);
+            requestArray(SectionID::CurveStaticData, sceneData.curveStaticData);
+        }
+        if (is_set(sections, Sections::CustomPrimitives)) requestSection(SectionID::CustomPrimitives);
 
-        readMarker(stream, "RenderSettings");
-        stream.read(sceneData.renderSettings);
+        reader.readSections(requests);
 
-        readMarker(stream, "Cameras");
-        sceneData.cameras.resize(stream.read<uint32_t>());
-        for (auto& pCamera : sceneData.cameras) pCamera = readCamera(stream);
-        stream.read(sceneData.selectedCamera);
-        stream.read(sceneData.cameraSpeed);
+        if (is_set(sections, Sections::Metadata))
+        {
+            InputStream stream(buffers[(size_t)SectionID::Metadata]);
+            stream.read(sceneData.path);
+            stream.read(sceneData.renderSettings);
+            sceneData.metadata = readMetadata(stream);
+            stream.checkEnd();
+        }
 
-        readMarker(stream, "Lights");
-        sceneData.lights.resize(stream.read<uint32_t>());
-        for (auto& pLight : sceneData.lights) pLight = readLight(stream);
+        if (is_set(sections, Sections::Cameras))
+        {
+            InputStream stream(buffers[(size_t)SectionID::Cameras]);
+            sceneData.cameras.resize(stream.read<uint32_t>());
+            for (auto& pCamera : sceneData.cameras) pCamera = readCamera(stream);
+            stream.read(sceneData.selectedCamera);
+            stream.read(sceneData.cameraSpeed);
+            stream.checkEnd();
+        }
 
-        readMarker(stream, "Grids");
-        sceneData.grids.resize(stream.read<uint32_t>());
-        for (auto& pGrid : sceneData.grids) pGrid = readGrid(stream, pDevice);
+        if (is_set(sections, Sections::Lights))
+        {
+            InputStream stream(buffers[(size_t)SectionID::Lights]);
+            sceneData.lights.resize(stream.read<uint32_t>());
+            for (auto& pLight : sceneData.lights) pLight = readLight(stream);
+            stream.checkEnd();
+        }
 
-        readMarker(stream, "GridVolumes");
-        sceneData.gridVolumes.resize(stream.read<uint32_t>());
-        for (auto& pGridVolume : sceneData.gridVolumes) pGridVolume = readGridVolume(stream, sceneData.grids, pDevice);
+        if (is_set(sections, Sections::Volumes))
+        {
+            InputStream stream(buffers[(size_t)SectionID::Volumes]);
+            sceneData.grids.resize(stream.read<uint32_t>());
+            for (auto& pGrid : sceneData.grids) pGrid = readGrid(stream, pDevice);
+            sceneData.gridVolumes.resize(stream.read<uint32_t>());
+            for (auto& pGridVolume : sceneData.gridVolumes) pGridVolume = readGridVolume(stream, sceneData.grids, pDevice);
+            stream.checkEnd();
+        }
 
-        readMarker(stream, "EnvMap");
-        auto hasEnvMap = stream.read<bool>();
-        if (hasEnvMap) sceneData.pEnvMap = readEnvMap(stream, pDevice);
+        if (is_set(sections, Sections::EnvMap))
+        {
+            InputStream stream(buffers[(size_t)SectionID::EnvMap]);
+            auto hasEnvMap = stream.read<bool>();
+            if (hasEnvMap) sceneData.pEnvMap = readEnvMap(stream, pDevice);
+            stream.checkEnd();
+        }
 
         // Material textures are loaded asynchronously to allow loading other data
         // in parallel while loading textures from files and uploading them to the GPU.
@@ -416,85 +874,99 @@ namespace Falcor
         // before material textures, as they upload buffers to the GPU when created.
         // Make sure no other GPU operations are executed until calling pMaterialTextureLoader.reset()
         // further down which blocks until all textures are loaded.
-        auto pMaterialTextureLoader = std::make_unique<MaterialTextureLoader>(sceneData.pMaterials->getTextureManager(), true);
-
-        readMarker(stream, "Materials");
-        readMaterials(stream, *sceneData.pMaterials, *pMaterialTextureLoader, pDevice);
+        std::unique_ptr<MaterialTextureLoader> pMaterialTextureLoader;
 
-        readMarker(stream, "SceneGraph");
-        sceneData.sceneGraph.resize(stream.read<uint32_t>());
-        for (auto &node : sceneData.sceneGraph)
+        if (is_set(sections, Sections::Materials))
         {
-            stream.read(node.name);
-            stream.read(node.parent);
-            stream.read(node.transform);
-            stream.read(node.meshBind);
-            stream.read(node.localToBindSpace);
+            pMaterialTextureLoader = std::make_unique<MaterialTextureLoader>(sceneData.pMaterials->getTextureManager(), true);
+            InputStream stream(buffers[(size_t)SectionID::Materials]);
+            readMaterials(stream, *sceneData.pMaterials, *pMaterialTextureLoader, pDevice);
+            stream.checkEnd();
         }
 
-        readMarker(stream, "Animations");
-        sceneData.animations.resize(stream.read<uint32_t>());
-        for (auto& pAnimation : sceneData.animations) pAnimation = readAnimation(stream);
-
-        readMarker(stream, "Metadata");
-        sceneData.metadata = readMetadata(stream);
-
-        readMarker(stream, "Meshes");
-        stream.read(sceneData.meshDesc);
-        stream.read(sceneData.meshNames);
-        stream.read(sceneData.meshBBs);
-        stream.read(sceneData.meshInstanceData);
-        sceneData.meshIdToInstanceIds.resize(stream.read<uint32_t>());
-        for (auto& item : sceneData.meshIdToInstanceIds)
+        if (is_set(sections, Sections::SceneGraph))
         {
-            stream.read(item);
+            InputStream stream(buffers[(size_t)SectionID::SceneGraph]);
+            sceneData.sceneGraph.resize(stream.read<uint32_t>());
+            for (auto &node : sceneData.sceneGraph)
+            {
+                stream.read(node.name);
+                stream.read(node.parent);
+                stream.read(node.transform);
+                stream.read(node.meshBind);
+                stream.read(node.localToBindSpace);
+            }
+            stream.checkEnd();
         }
-        sceneData.meshGroups.resize(stream.read<uint32_t>());
-        for (auto& group : sceneData.meshGroups)
+
+        if (is_set(sections, Sections::Animations))
         {
-            stream.read(group.meshList);
-            stream.read(group.isStatic);
-            stream.read(group.isDisplaced);
+            InputStream stream(buffers[(size_t)SectionID::Animations]);
+            sceneData.animations.resize(stream.read<uint32_t>());
+            for (auto& pAnimation : sceneData.animations) pAnimation = readAnimation(stream);
+            stream.checkEnd();
         }
-        sceneData.cachedMeshes.resize(stream.read<uint32_t>());
-        for (auto& cachedMesh : sceneData.cachedMeshes)
+
+        if (is_set(sections, Sections::Meshes))
         {
-            stream.read(cachedMesh.meshID);
-            stream.read(cachedMesh.timeSamples);
-            cachedMesh.vertexData.resize(stream.read<uint32_t>());
-            for (auto& data : cachedMesh.vertexData) stream.read(data);
+            InputStream stream(buffers[(size_t)SectionID::Meshes]);
+            stream.read(sceneData.meshDesc);
+            stream.read(sceneData.meshNames);
+            stream.read(sceneData.meshBBs);
+            stream.read(sceneData.meshInstanceData);
+            sceneData.meshIdToInstanceIds.resize(stream.read<uint32_t>());
+            for (auto& item : sceneData.meshIdToInstanceIds)
+            {
+                stream.read(item);
+            }
+            sceneData.meshGroups.resize(stream.read<uint32_t>());
+            for (auto& group : sceneData.meshGroups)
+            {
+                stream.read(group.meshList);
+                stream.read(group.isStatic);
+                stream.read(group.isDisplaced);
+            }
+            sceneData.cachedMeshes.resize(stream.read<uint32_t>());
+            for (auto& cachedMesh : sceneData.cachedMeshes)
+            {
+                stream.read(cachedMesh.meshID);
+                stream.read(cachedMesh.timeSamples);
+                cachedMesh.vertexData.resize(stream.read<uint32_t>());
+                for (auto& data : cachedMesh.vertexData) stream.read(data);
+            }
+            stream.read(sceneData.useCompressedHitInfo);
+            stream.read(sceneData.has16BitIndices);
+            stream.read(sceneData.has32BitIndices);
+            stream.read(sceneData.meshDrawCount);
+            stream.checkEnd();
         }
-        stream.read(sceneData.useCompressedHitInfo);
-        stream.read(sceneData.has16BitIndices);
-        stream.read(sceneData.has32BitIndices);
-        stream.read(sceneData.meshDrawCount);
-        stream.read(sceneData.meshIndexData);
-        stream.read(sceneData.meshStaticData);
-        stream.read(sceneData.meshSkinningData);
-
-        readMarker(stream, "Curves");
-        stream.read(sceneData.curveDesc);
-        stream.read(sceneData.curveBBs);
-        stream.read(sceneData.curveInstanceData);
-        stream.read(sceneData.curveIndexData);
-        stream.read(sceneData.curveStaticData);
 
-        sceneData.cachedCurves.resize(stream.read<uint32_t>());
-        for (auto& cachedCurve : sceneData.cachedCurves)
+        if (is_set(sections, Sections::Curves))
         {
-            stream.read(cachedCurve.tessellationMode);
-            stream.read(cachedCurve.geometryID);
-            stream.read(cachedCurve.timeSamples);
-            stream.read(cachedCurve.indexData);
-            cachedCurve.vertexData.resize(stream.read<uint32_t>());
-            for (auto& data : cachedCurve.vertexData) stream.read(data);
+            InputStream stream(buffers[(size_t)SectionID::Curves]);
+            stream.read(sceneData.curveDesc);
+            stream.read(sceneData.curveBBs);
+            stream.read(sceneData.curveInstanceData);
+            sceneData.cachedCurves.resize(stream.read<uint32_t>());
+            for (auto& cachedCurve : sceneData.cachedCurves)
+            {
+                stream.read(cachedCurve.tessellationMode);
+                stream.read(cachedCurve.geometryID);
+                stream.read(cachedCurve.timeSamples);
+                stream.read(cachedCurve.indexData);
+                cachedCurve.vertexData.resize(stream.read<uint32_t>());
+                for (auto& data : cachedCurve.vertexData) stream.read(data);
+            }
+            stream.checkEnd();
         }
 
-        readMarker(stream, "CustomPrimitives");
-        stream.read(sceneData.customPrimitiveDesc);
-        stream.read(sceneData.customPrimitiveAABBs);
-
-        readMarker(stream, "End");
+        if (is_set(sections, Sections::CustomPrimitives))
+        {
+            InputStream stream(buffers[(size_t)SectionID::CustomPrimitives]);
+            stream.read(sceneData.customPrimitiveDesc);
+            stream.read(sceneData.customPrimitiveAABBs);
+            stream.checkEnd();
+        }
 
         pMaterialTextureLoader.reset();
 
@@ -934,17 +1406,4 @@ namespace Falcor
         stream.read(pAnimation->mKeyframes);
         return pAnimation;
     }
-
-    // Marker
-
-    void SceneCache::writeMarker(OutputStream& stream, const std::string& id)
-    {
-        stream.write(id);
-    }
-
-    void SceneCache::readMarker(InputStream& stream, const std::string& id)
-    {
-        auto str = stream.read<std::string>();
-        if (id != str) throw RuntimeError("Found invalid marker");
-    }
 }
@@ -50,12 +50,35 @@ namespace Falcor
     /** Helper class for reading and writing scene cache files.
         The scene cache is used to heavily reduce load times of more complex assets.
         The cache stores a binary representation of `Scene::SceneData` which contains everything to re-create a `Scene`.
+        The data is split into sections that are listed in a table of contents at the end of the file.
+        Each section is stored as a sequence of independently LZ4 compressed chunks, which allows
+        compressing/decompressing in parallel and reading only a subset of the sections.
     */
     class FALCOR_API SceneCache
     {
     public:
         using Key = SHA1::MD;
 
+        /** Flags for selecting which parts of the scene data to read.
+        */
+        enum class Sections : uint32_t
+        {
+            None                = 0x0,
+            Metadata            = 0x1,      ///< Asset path, render settings and scene metadata.
+            Cameras             = 0x2,      ///< Cameras, selected camera and camera speed.
+            Lights              = 0x4,      ///< Analytic lights.
+            Volumes             = 0x8,      ///< Grids and grid volumes.
+            EnvMap              = 0x10,     ///< Environment map.
+            Materials           = 0x20,     ///< Materials (including loading of material textures).
+            SceneGraph          = 0x40,     ///< Scene graph nodes.
+            Animations          = 0x80,     ///< Animations.
+            Meshes              = 0x100,    ///< Mesh descriptors, instances and vertex/index data.
+            Curves              = 0x200,    ///< Curve descriptors, instances and vertex/index data.
+            CustomPrimitives    = 0x400,    ///< Custom primitives.
+
+            All = Metadata | Cameras | Lights | Volumes | EnvMap | Materials | SceneGraph | Animations | Meshes | Curves | CustomPrimitives,
+        };
+
         /** Check if there is a valid scene cache for a given cache key.
             \param[in] key Cache key.
             \return Returns true if a valid cache exists.
@@ -65,24 +88,32 @@ namespace Falcor
         /** Write a scene cache.
             \param[in] sceneData Scene data.
             \param[in] key Cache key.
+            \param[in] uncompressedMeshData Store the mesh vertex/index data uncompressed and page-aligned.
+                        This increases the file size, but the data is memory mapped and uploaded without an intermediate copy when reading the cache.
         */
-        static void writeCache(const Scene::SceneData& sceneData, const Key& key);
+        static void writeCache(const Scene::SceneData& sceneData, const Key& key, bool uncompressedMeshData = false);
 
         /** Read a scene cache.
+            Only the selected sections are read, the remaining fields of the returned scene data are left default initialized.
+            A `Scene` can only be created from scene data that was read with `Sections::All`.
             \param[in] pDevice GPU device.
             \param[in] key Cache key.
+            \param[in] sections Sections to read.
+            \param[in] useTextureCache Load material textures through the on-disk texture cache.
             \return Returns the loaded scene data.
         */
-        static Scene::SceneData readCache(ref<Device> pDevice, const Key& key);
+        static Scene::SceneData readCache(ref<Device> pDevice, const Key& key, Sections sections = Sections::All, bool useTextureCache = false);
 
     private:
         class OutputStream;
         class InputStream;
+        class FileWriter;
+        class FileReader;
 
         static std::filesystem::path getCachePath(const Key& key);
 
-        static void writeSceneData(OutputStream& stream, const Scene::SceneData& sceneData);
-        static Scene::SceneData readSceneData(InputStream& stream, ref<Device> pDevice);
+        static void writeSceneData(FileWriter& writer, const Scene::SceneData& sceneData, bool uncompressedMeshData);
+        static Scene::SceneData readSceneData(FileReader& reader, ref<Device> pDevice, Sections sections, bool useTextureCache);
 
         static void writeMetadata(OutputStream& stream, const Scene::Metadata& metadata);
         static Scene::Metadata readMetadata(InputStream& stream);
@@ -117,8 +148,7 @@ namespace Falcor
 
         static void writeAnimation(OutputStream& stream, const ref<Animation>& pAnimation);
         static ref<Animation> readAnimation(InputStream& stream);
-
-        static void writeMarker(OutputStream& stream, const std::string& id);
-        static void readMarker(InputStream& stream, const std::string& id);
     };
+
+    FALCOR_ENUM_CLASS_OPERATORS(SceneCache::Sections);
 }
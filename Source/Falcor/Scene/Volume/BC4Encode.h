@@ -28,12 +28,20 @@
 #pragma once
 #include <algorithm>
 #include <cstdint>
-#include <climits>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define FALCOR_BC4_ENCODE_SSE 1
+#include <immintrin.h>
+#else
+#define FALCOR_BC4_ENCODE_SSE 0
+#endif
 
 // this file exposes a single function, CompressAlphaDxt5, which encodes a 4x4 set of uint8 alpha values into a single 64 bit BC4 encoded block
 static void CompressAlphaDxt5(uint8_t* tile, void* block);
 
 // derived from libsquish, alpha.cpp
+// the range search and code fitting process all 16 values of a tile at once, using SSE2 where available
 /* -----------------------------------------------------------------------------
     Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
     Permission is hereby granted, free of charge, to any person obtaining
@@ -64,146 +72,131 @@ static void FixRange(int& min, int& max, int steps)
 
 static int FitCodes(uint8_t const* tile, uint8_t const* codes, uint8_t* indices)
 {
-    // fit each alpha value to the codebook
-    int err = 0;
+    // fit each alpha value to the codebook, testing one code against all 16 values at a time
+    // the absolute error orders codes like the squared error, which lets the error and code index share one 16 bit key
+    // the least key is then the first code with the least error
+#if FALCOR_BC4_ENCODE_SSE
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tile));
+    __m128i keyLo = _mm_set1_epi16(INT16_MAX);
+    __m128i keyHi = keyLo;
+    for (int j = 0; j < 8; ++j)
+    {
+        const __m128i code = _mm_set1_epi8((char)codes[j]);
+        const __m128i index = _mm_set1_epi16((short)j);
+        const __m128i dist = _mm_or_si128(_mm_subs_epu8(values, code), _mm_subs_epu8(code, values));
+        keyLo = _mm_min_epi16(keyLo, _mm_or_si128(_mm_slli_epi16(_mm_unpacklo_epi8(dist, zero), 3), index));
+        keyHi = _mm_min_epi16(keyHi, _mm_or_si128(_mm_slli_epi16(_mm_unpackhi_epi8(dist, zero), 3), index));
+    }
+
+    // save the indices and return the total squared error
+    const __m128i mask = _mm_set1_epi16(7);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), _mm_packus_epi16(_mm_and_si128(keyLo, mask), _mm_and_si128(keyHi, mask)));
+    const __m128i distLo = _mm_srli_epi16(keyLo, 3);
+    const __m128i distHi = _mm_srli_epi16(keyHi, 3);
+    __m128i err = _mm_add_epi32(_mm_madd_epi16(distLo, distLo), _mm_madd_epi16(distHi, distHi));
+    err = _mm_add_epi32(err, _mm_srli_si128(err, 8));
+    err = _mm_add_epi32(err, _mm_srli_si128(err, 4));
+    return _mm_cvtsi128_si32(err);
+#else
+    int16_t key[16];
     for (int i = 0; i < 16; ++i)
+        key[i] = INT16_MAX;
+    for (int j = 0; j < 8; ++j)
     {
-        // find the least error and corresponding index
-        int value = (int)(tile[i]);
-        int least = INT_MAX;
-        int index = 0;
-        for (int j = 0; j < 8; ++j)
+        for (int i = 0; i < 16; ++i)
         {
-            // get the squared error from this code
-            int dist = (int)value - (int)codes[j];
-            dist *= dist;
-
-            // compare with the best so far
-            if (dist < least)
-            {
-                least = dist;
-                index = j;
-            }
+            int16_t dist = (int16_t)std::abs((int)tile[i] - (int)codes[j]);
+            key[i] = std::min(key[i], (int16_t)((dist << 3) | j));
         }
-
-        // save this index and accumulate the error
-        indices[i] = (uint8_t)index;
-        err += least;
     }
 
-    // return the total error
+    // save the indices and return the total squared error
+    int err = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int dist = key[i] >> 3;
+        indices[i] = (uint8_t)(key[i] & 7);
+        err += dist * dist;
+    }
     return err;
+#endif
 }
 
-static void WriteAlphaBlock(int alpha0, int alpha1, uint8_t const* indices, void* block)
+static void WriteAlphaBlock(int alpha0, int alpha1, uint8_t const* indices, const uint8_t* remap, void* block)
 {
-    uint8_t* bytes = reinterpret_cast<uint8_t*>(block);
-
-    // write the first two bytes
-    bytes[0] = (uint8_t)alpha0;
-    bytes[1] = (uint8_t)alpha1;
-
-    // pack the indices with 3 bits each
-    uint8_t* dest = bytes + 2;
-    uint8_t const* src = indices;
-    for (int i = 0; i < 2; ++i)
-    {
-        // pack 8 3-bit values
-        int value = 0;
-        for (int j = 0; j < 8; ++j)
-        {
-            int index = *src++;
-            value |= (index << 3 * j);
-        }
+    // pack the two endpoints and 16 3-bit indices into 64 bits, stored in little endian byte order
+    uint64_t bits = (uint64_t)alpha0 | ((uint64_t)alpha1 << 8);
+    for (int i = 0; i < 16; ++i)
+        bits |= (uint64_t)remap[indices[i]] << (16 + 3 * i);
 
-        // store in 3 bytes
-        for (int j = 0; j < 3; ++j)
-        {
-            int byte = (value >> 8 * j) & 0xff;
-            *dest++ = (uint8_t)byte;
-        }
-    }
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(block);
+    for (int i = 0; i < 8; ++i)
+        bytes[i] = (uint8_t)(bits >> (8 * i));
 }
 
 static void WriteAlphaBlock5(int alpha0, int alpha1, uint8_t const* indices, void* block)
 {
-    // check the relative values of the endpoints
-    if (alpha0 > alpha1)
-    {
-        // swap the indices
-        uint8_t swapped[16];
-        for (int i = 0; i < 16; ++i)
-        {
-            uint8_t index = indices[i];
-            if (index == 0)
-                swapped[i] = 1;
-            else if (index == 1)
-                swapped[i] = 0;
-            else if (index <= 5)
-                swapped[i] = 7 - index;
-            else
-                swapped[i] = index;
-        }
+    static const uint8_t kIdentity[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    static const uint8_t kSwapped[8] = {1, 0, 5, 4, 3, 2, 6, 7};
 
-        // write the block
-        WriteAlphaBlock(alpha1, alpha0, swapped, block);
-    }
+    // check the relative values of the endpoints, swap them and the indices if needed
+    if (alpha0 > alpha1)
+        WriteAlphaBlock(alpha1, alpha0, indices, kSwapped, block);
     else
-    {
-        // write the block
-        WriteAlphaBlock(alpha0, alpha1, indices, block);
-    }
+        WriteAlphaBlock(alpha0, alpha1, indices, kIdentity, block);
 }
 
 static void WriteAlphaBlock7(int alpha0, int alpha1, uint8_t const* indices, void* block)
 {
-    // check the relative values of the endpoints
-    if (alpha0 < alpha1)
-    {
-        // swap the indices
-        uint8_t swapped[16];
-        for (int i = 0; i < 16; ++i)
-        {
-            uint8_t index = indices[i];
-            if (index == 0)
-                swapped[i] = 1;
-            else if (index == 1)
-                swapped[i] = 0;
-            else
-                swapped[i] = 9 - index;
-        }
+    static const uint8_t kIdentity[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    static const uint8_t kSwapped[8] = {1, 0, 7, 6, 5, 4, 3, 2};
 
-        // write the block
-        WriteAlphaBlock(alpha1, alpha0, swapped, block);
-    }
+    // check the relative values of the endpoints, swap them and the indices if needed
+    if (alpha0 < alpha1)
+        WriteAlphaBlock(alpha1, alpha0, indices, kSwapped, block);
     else
-    {
-        // write the block
-        WriteAlphaBlock(alpha0, alpha1, indices, block);
-    }
+        WriteAlphaBlock(alpha0, alpha1, indices, kIdentity, block);
 }
 
-
 static void CompressAlphaDxt5(uint8_t* tile, void* block)
 {
     // get the range for 5-alpha and 7-alpha interpolation
+    // the 5-alpha range excludes 0 and 255, which have their own codes
+#if FALCOR_BC4_ENCODE_SSE
+    const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tile));
+    const __m128i ones = _mm_set1_epi8((char)0xff);
+    __m128i minValues = _mm_unpacklo_epi64(values, _mm_or_si128(values, _mm_cmpeq_epi8(values, _mm_setzero_si128())));
+    __m128i maxValues = _mm_unpacklo_epi64(values, _mm_andnot_si128(_mm_cmpeq_epi8(values, ones), values));
+    __m128i minValuesHi = _mm_unpackhi_epi64(values, _mm_or_si128(values, _mm_cmpeq_epi8(values, _mm_setzero_si128())));
+    __m128i maxValuesHi = _mm_unpackhi_epi64(values, _mm_andnot_si128(_mm_cmpeq_epi8(values, ones), values));
+
+    // reduce each 8 byte half, the low half holds the 7-alpha range and the high half the 5-alpha range
+    minValues = _mm_min_epu8(minValues, minValuesHi);
+    maxValues = _mm_max_epu8(maxValues, maxValuesHi);
+    for (int shift = 4; shift > 0; shift /= 2)
+    {
+        minValues = _mm_min_epu8(minValues, _mm_srli_epi64(minValues, 8 * shift));
+        maxValues = _mm_max_epu8(maxValues, _mm_srli_epi64(maxValues, 8 * shift));
+    }
+    int min7 = _mm_cvtsi128_si32(minValues) & 0xff;
+    int max7 = _mm_cvtsi128_si32(maxValues) & 0xff;
+    int min5 = _mm_extract_epi16(minValues, 4) & 0xff;
+    int max5 = _mm_extract_epi16(maxValues, 4) & 0xff;
+#else
     int min5 = 255;
     int max5 = 0;
     int min7 = 255;
     int max7 = 0;
     for (int i = 0; i < 16; ++i)
     {
-        // incorporate into the min/max
         int value = (int)(tile[i]);
-        if (value < min7)
-            min7 = value;
-        if (value > max7)
-            max7 = value;
-        if (value != 0 && value < min5)
-            min5 = value;
-        if (value != 255 && value > max5)
-            max5 = value;
+        min7 = std::min(min7, value);
+        max7 = std::max(max7, value);
+        min5 = std::min(min5, value != 0 ? value : 255);
+        max5 = std::max(max5, value != 255 ? value : 0);
     }
+#endif
 
     // handle the case that no valid range was found
     if (min5 > max5)
@@ -243,4 +236,3 @@ static void CompressAlphaDxt5(uint8_t* tile, void* block)
     else
         WriteAlphaBlock7(min7, max7, indices7, block);
 }
-
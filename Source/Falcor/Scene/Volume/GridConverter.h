@@ -28,10 +28,11 @@
 #pragma once
 #include "BrickedGrid.h"
 #include "BC4Encode.h"
+#include "Core/Assert.h"
 #include "Core/API/Formats.h"
 #include "Utils/Logger.h"
 #include "Utils/HostDeviceShared.slangh"
-#include "Utils/NumericRange.h"
+#include "Utils/Threading.h"
 #include "Utils/Math/Vector.h"
 #include "Utils/Timing/CpuTimer.h"
 
@@ -45,8 +46,6 @@
 #endif
 
 #include <algorithm>
-#include <atomic>
-#include <execution>
 #include <vector>
 
 namespace Falcor
@@ -56,21 +55,45 @@ namespace Falcor
     using NanoVDBConverterUNORM8 = NanoVDBToBricksConverter<uint8_t, 8>;
     using NanoVDBConverterUNORM16 = NanoVDBToBricksConverter<uint16_t, 16>;
 
+    /** Converts a NanoVDB float grid to a bricked grid.
+        The conversion runs in three parallel passes: computing the value range of every brick, computing the range mips,
+        and encoding the occupied bricks into the atlas. The atlas is allocated after the range pass and only holds
+        bricks with a non-constant value range.
+    */
     template <typename TexelType, unsigned int kBitsPerTexel>
     struct NanoVDBToBricksConverter
     {
     public:
+        /** Statistics of the last conversion. Times are in ms.
+        */
+        struct Stats
+        {
+            double rangeTime = 0.0;             ///< Time for computing the value range of all bricks.
+            double mipTime = 0.0;               ///< Time for computing the range mips.
+            double encodeTime = 0.0;            ///< Time for allocating the atlas and encoding the occupied bricks.
+            double uploadTime = 0.0;            ///< Time for creating the textures.
+            double totalTime = 0.0;             ///< Total conversion time.
+            uint32_t brickCount = 0;            ///< Number of bricks covering the grid bounds.
+            uint32_t occupiedBrickCount = 0;    ///< Number of bricks stored in the atlas.
+            uint64_t atlasSize = 0;             ///< Size of the atlas data in bytes.
+        };
+
         NanoVDBToBricksConverter(const nanovdb::FloatGrid* grid);
         NanoVDBToBricksConverter(const NanoVDBToBricksConverter& rhs) = delete;
 
         BrickedGrid convert(ref<Device> pDevice);
 
+        const Stats& getStats() const { return mStats; }
+
     private:
         const static uint32_t kBrickSize = 8; // Must be 8, to match both NanoVDB leaf size.
         const static int32_t kBC4Compress = kBitsPerTexel == 4;
+        const static uint32_t kMaxAtlasSizeBricks = 256; // Atlas coordinates are stored in 8 bits each.
 
-        void convertSlice(int z);
-        void computeMip(int mip);
+        void computeRanges(int y, int z);
+        void computeMip(int mip, int z);
+        void allocateAtlas();
+        void encodeBrick(const float* data, uint32_t atlasBrick, uint32_t range);
 
         inline uint3 getAtlasSizeBricks() const { return mAtlasSizeBricks; }
         inline uint3 getAtlasSizePixels() const { return mAtlasSizeBricks * kBrickSize; }
@@ -109,14 +132,14 @@ namespace Falcor
         uint32_t mLeafCount[4];
         std::vector<uint32_t> mRangeData;
         std::vector<uint32_t> mPtrData;
+        std::vector<uint32_t> mOccupiedBricks; ///< Indices of the occupied bricks in the finest range level, in atlas order.
         std::vector<TexelType> mAtlasData;
-        std::atomic_uint32_t mNonEmptyCount;
+        Stats mStats;
     };
 
     template <typename TexelType, unsigned int kBitsPerTexel>
     NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::NanoVDBToBricksConverter(const nanovdb::FloatGrid* grid)
     {
-        mNonEmptyCount.store(0);
         mpFloatGrid = grid;
         auto& voxelbox = mpFloatGrid->indexBBox();
         mBBMin = (int3(voxelbox.min().x(), voxelbox.min().y(), voxelbox.min().z())) & (~7);
@@ -128,130 +151,58 @@ namespace Falcor
             mLeafDim[i] = mPixDim / (8 << i);
             mLeafCount[i] = (mLeafDim[i].x * mLeafDim[i].y * mLeafDim[i].z) + (i ? mLeafCount[i - 1] : 0); // Cumulative leaf count up the mips.
         }
-        uint leafCount = grid->tree().nodeCount(0);
-        uint approxdim = 1u << uint(log2f((float)leafCount + 1.f) / 3.f); // Choose the first 2 dimensions to be powers of 2.
-        uint lastdim = (leafCount + approxdim * approxdim - 1) / (approxdim * approxdim);
-        mAtlasSizeBricks = uint3(approxdim, approxdim, lastdim);
-        uint3 atlasSizePixels = getAtlasSizePixels();
-        uint leafTexelCount = atlasSizePixels.x * atlasSizePixels.y * atlasSizePixels.z;
         mRangeData.resize(mLeafCount[3]);
         mPtrData.resize(mLeafCount[0]);
-        mAtlasData.resize(kBC4Compress ? (leafTexelCount / 16) : leafTexelCount);
     }
 
     template <typename TexelType, unsigned int kBitsPerTexel>
-    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::convertSlice(int z)
+    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::computeRanges(int y, int z)
     {
-        uint3 atlasSizePixels = getAtlasSizePixels();
-        uint brickMax = getAtlasMaxBrick();
-        uint bricksPerSlice = mAtlasSizeBricks.x * mAtlasSizeBricks.y;
-        uint pixelsPerSlice = atlasSizePixels.x * atlasSizePixels.y;
-
-        size_t offset = z * mLeafDim[0].x * mLeafDim[0].y;
+        size_t offset = (z * mLeafDim[0].y + y) * mLeafDim[0].x;
         uint32_t* rangedst = mRangeData.data() + offset;
         uint32_t* ptrdst = mPtrData.data() + offset;
         auto a = mpFloatGrid->getAccessor();
-        for (int y = 0; y < mLeafDim[0].y; ++y)
+        for (int x = 0; x < mLeafDim[0].x; ++x)
         {
-            for (int x = 0; x < mLeafDim[0].x; ++x)
+            nanovdb::Coord ijk = { x * 8 + mBBMin.x, y * 8 + mBBMin.y, z * 8 + mBBMin.z };
+            auto val = a.getValue(ijk);
+            auto leaf = a.probeLeaf(ijk);
+            float minorant = val, majorant = val;
+            if (leaf)
             {
-                nanovdb::Coord ijk = { x * 8 + mBBMin.x, y * 8 + mBBMin.y, z * 8 + mBBMin.z };
-                auto val = a.getValue(ijk);
-                auto leaf = a.probeLeaf(ijk);
-                float minorant = val, majorant = val;
-                uint myleaf = 0;
-                if (leaf)
-                {
-                    // Nanovdb only stores minorant/majorant for active voxels, but we need all of them... Grab the central 8x8x8 first the quick way.
-                    const float* data = leaf->data()->mValues;
-                    for (int i = 0; i < kBrickSize * kBrickSize * kBrickSize; ++i) expandMinorantMajorant(data[i], minorant, majorant);
-                    // We also need the 1-halo from neighbouring bricks. Fetch them in an order that maximises nanovdb's internal cache reuse.
-                    for (int j = -1; j <= kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, j, -1)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, j, kBrickSize)), minorant, majorant);
-                    for (int j = 0; j < kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, -1, j)), minorant, majorant);
-                    for (int j = 0; j < kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, kBrickSize, j)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(-1, j, i)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(kBrickSize, j, i)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(-1, j, -1)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(kBrickSize, j, -1)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(-1, j, kBrickSize)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(kBrickSize, j, kBrickSize)), minorant, majorant);
-
-                    if (minorant != majorant) myleaf = mNonEmptyCount.fetch_add(1);
-                }
-                if (majorant == minorant || myleaf >= brickMax || leaf == nullptr)
-                {
-                    *rangedst++ = f32tof16(majorant) + (f32tof16(majorant) << 16); // force identical major and minor
-                    *ptrdst++ = 0;
-                }
-                else
-                {
-                    const float* data = leaf->data()->mValues;
-                    majorant = f16tof32(f32tof16(majorant) + 1);
-                    minorant = f16tof32(f32tof16(minorant));
-                    *rangedst++ = f32tof16(majorant) + (f32tof16(minorant) << 16);
-                    uint32_t atlasx = myleaf % mAtlasSizeBricks.x;
-                    uint32_t atlasy = (myleaf / mAtlasSizeBricks.x) % mAtlasSizeBricks.y;
-                    uint32_t atlasz = myleaf / bricksPerSlice;
-                    *ptrdst++ = (atlasx + (atlasy << 8) + (atlasz << 16));
-
-                    if (!kBC4Compress) {
-                        float invRange = ((1 << kBitsPerTexel) - 1.f) / (majorant - minorant);
-                        TexelType* atlasdst = (TexelType*)mAtlasData.data() + atlasx * kBrickSize + atlasy * (atlasSizePixels.x * kBrickSize) + atlasz * (pixelsPerSlice * kBrickSize);
-                        for (int pixz = 0; pixz < kBrickSize; ++pixz)
-                        {
-                            for (int pixy = 0; pixy < kBrickSize; ++pixy)
-                            {
-                                for (int pixx = 0; pixx < kBrickSize; ++pixx)
-                                {
-                                    float f = data[pixx * kBrickSize * kBrickSize + pixy * kBrickSize + pixz];
-                                    *atlasdst++ = TexelType((f - minorant) * invRange);
-                                }
-                                atlasdst += (atlasSizePixels.x - kBrickSize); // next scanline
-                            }
-                            atlasdst += (pixelsPerSlice - (atlasSizePixels.x * kBrickSize)); // next slice
-                        }
-                    }
-                    else {
-                        // BC4 compression:
-                        float invRange = (255.f) / (majorant - minorant);
-                        uint64_t* atlasdst = ((uint64_t*)mAtlasData.data() + atlasx * (kBrickSize / 4) + atlasy * ((atlasSizePixels.x / 4) * kBrickSize / 4) + atlasz * (pixelsPerSlice / 16 * kBrickSize));
-                        for (int pixz = 0; pixz < kBrickSize; ++pixz)
-                        {
-                            for (int tiley = 0; tiley < kBrickSize; tiley += 4)
-                            {
-                                for (int tilex = 0; tilex < kBrickSize; tilex += 4) {
-                                    uint8_t tilevals[4][4];
-                                    uint8_t tileminorant = 255, tilemajorant = 0;
-                                    for (int pixy = 0; pixy < 4; ++pixy)
-                                    {
-                                        for (int pixx = 0; pixx < 4; ++pixx)
-                                        {
-                                            float f = data[(pixx + tilex) * (kBrickSize * kBrickSize) + (pixy + tiley) * kBrickSize + pixz];
-                                            uint8_t voxel = uint8_t((f - minorant) * invRange);
-                                            tileminorant = std::min(tileminorant, voxel);
-                                            tilemajorant = std::max(tilemajorant, voxel);
-                                            tilevals[pixy][pixx] = voxel;
-                                        }
-                                    }
-                                    CompressAlphaDxt5((uint8_t*)&tilevals[0][0], atlasdst);
-                                    atlasdst++;
-                                }
-                                atlasdst += (atlasSizePixels.x / 4 - kBrickSize / 4); // next scanline
-                            }
-                            atlasdst += (pixelsPerSlice / 16 - (atlasSizePixels.x / 4 * kBrickSize / 4)); // next slice
-                        } // z slice loop
-                    } // bc4 compress?
-                } // non empty brick?
-            } // x brick loop
-        } // y brick loop
+                // Nanovdb only stores minorant/majorant for active voxels, but we need all of them... Grab the central 8x8x8 first the quick way.
+                const float* data = leaf->data()->mValues;
+                for (int i = 0; i < kBrickSize * kBrickSize * kBrickSize; ++i) expandMinorantMajorant(data[i], minorant, majorant);
+                // We also need the 1-halo from neighbouring bricks. Fetch them in an order that maximises nanovdb's internal cache reuse.
+                for (int j = -1; j <= (int)kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, j, -1)), minorant, majorant);
+                for (int j = -1; j <= (int)kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, j, kBrickSize)), minorant, majorant);
+                for (int j = 0; j < kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, -1, j)), minorant, majorant);
+                for (int j = 0; j < kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, kBrickSize, j)), minorant, majorant);
+                for (int j = -1; j <= (int)kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(-1, j, i)), minorant, majorant);
+                for (int j = -1; j <= (int)kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(kBrickSize, j, i)), minorant, majorant);
+                for (int j = -1; j <= (int)kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(-1, j, -1)), minorant, majorant);
+                for (int j = -1; j <= (int)kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(kBrickSize, j, -1)), minorant, majorant);
+                for (int j = -1; j <= (int)kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(-1, j, kBrickSize)), minorant, majorant);
+                for (int j = -1; j <= (int)kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(kBrickSize, j, kBrickSize)), minorant, majorant);
+            }
+            if (majorant == minorant || leaf == nullptr)
+            {
+                *rangedst++ = f32tof16(majorant) + (f32tof16(majorant) << 16); // force identical major and minor
+                *ptrdst++ = 0;
+            }
+            else
+            {
+                majorant = f16tof32(f32tof16(majorant) + 1);
+                minorant = f16tof32(f32tof16(minorant));
+                *rangedst++ = f32tof16(majorant) + (f32tof16(minorant) << 16);
+                *ptrdst++ = 1; // Mark as occupied, replaced by the atlas location in allocateAtlas().
+            }
+        } // x brick loop
     }
 
     template <typename TexelType, unsigned int kBitsPerTexel>
-    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::computeMip(int mip)
+    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::computeMip(int mip, int z)
     {
-        uint32_t* rangedst = mRangeData.data() + mLeafCount[mip - 1];
-        uint32_t* rangesrc = mRangeData.data() + ((mip > 1) ? mLeafCount[mip - 2] : 0);
         int3 leafdim_src = mLeafDim[mip - 1];
         uint32_t rowstride_src = leafdim_src.x;
         uint32_t slicestride_src = leafdim_src.y * rowstride_src;
@@ -260,43 +211,181 @@ namespace Falcor
         uint32_t rowstride_tgt = leafdim_tgt.x;
         uint32_t slicestride_tgt = leafdim_tgt.y * rowstride_tgt;
 
-        for (int z = 0; z < leafdim_tgt.z; ++z, rangesrc += slicestride_src)
+        // Each target slice reads two source slices.
+        uint32_t* rangedst = mRangeData.data() + mLeafCount[mip - 1] + z * slicestride_tgt;
+        const uint32_t* rangesrc = mRangeData.data() + ((mip > 1) ? mLeafCount[mip - 2] : 0) + z * 2 * slicestride_src;
+
+        for (int y = 0; y < leafdim_tgt.y; ++y, rangesrc += rowstride_src)
+        {
+            for (int x = 0; x < leafdim_tgt.x; ++x, rangesrc += 2)
+            {
+                float2 majmin_dst = combineMajMin(
+                    combineMajMin(
+                        combineMajMin(unpackMajMin(rangesrc), unpackMajMin(rangesrc + 1)),
+                        combineMajMin(unpackMajMin(rangesrc + rowstride_src), unpackMajMin(rangesrc + 1 + rowstride_src))
+                    ),
+                    combineMajMin(
+                        combineMajMin(unpackMajMin(rangesrc + slicestride_src), unpackMajMin(rangesrc + slicestride_src + 1)),
+                        combineMajMin(unpackMajMin(rangesrc + slicestride_src + rowstride_src), unpackMajMin(rangesrc + slicestride_src + 1 + rowstride_src))
+                    )
+                );
+                *rangedst++ = f32tof16(majmin_dst.x) + (f32tof16(majmin_dst.y) << 16);
+            } // x
+        } // y
+    }
+
+    template <typename TexelType, unsigned int kBitsPerTexel>
+    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::allocateAtlas()
+    {
+        // Collect the occupied bricks in index order, so that the atlas layout does not depend on the thread count.
+        mOccupiedBricks.clear();
+        for (uint32_t i = 0; i < mLeafCount[0]; ++i)
+        {
+            if (mPtrData[i]) mOccupiedBricks.push_back(i);
+        }
+        uint32_t occupiedCount = (uint32_t)mOccupiedBricks.size();
+        if (occupiedCount > kMaxAtlasSizeBricks * kMaxAtlasSizeBricks * kMaxAtlasSizeBricks)
+        {
+            throw RuntimeError("Grid '{}' has too many occupied bricks ({}) for the brick atlas.", mpFloatGrid->gridName(), occupiedCount);
+        }
+
+        // Size the atlas for the occupied bricks only. Choose the first 2 dimensions to be powers of 2, grown until the last one fits.
+        uint approxdim = 1u << uint(log2f((float)occupiedCount + 1.f) / 3.f);
+        while (approxdim < kMaxAtlasSizeBricks && (occupiedCount + approxdim * approxdim - 1) / (approxdim * approxdim) > kMaxAtlasSizeBricks) approxdim *= 2;
+        uint lastdim = std::max(1u, (occupiedCount + approxdim * approxdim - 1) / (approxdim * approxdim));
+        mAtlasSizeBricks = uint3(approxdim, approxdim, lastdim);
+        uint3 atlasSizePixels = getAtlasSizePixels();
+        uint64_t atlasTexelCount = uint64_t(atlasSizePixels.x) * atlasSizePixels.y * atlasSizePixels.z;
+        mAtlasData.clear();
+        mAtlasData.resize(kBC4Compress ? (atlasTexelCount / 16) : atlasTexelCount);
+
+        // Replace the occupancy flags by the atlas locations.
+        uint32_t bricksPerSlice = mAtlasSizeBricks.x * mAtlasSizeBricks.y;
+        for (uint32_t brick = 0; brick < occupiedCount; ++brick)
         {
-            for (int y = 0; y < leafdim_tgt.y; ++y, rangesrc += rowstride_src)
+            uint32_t atlasx = brick % mAtlasSizeBricks.x;
+            uint32_t atlasy = (brick / mAtlasSizeBricks.x) % mAtlasSizeBricks.y;
+            uint32_t atlasz = brick / bricksPerSlice;
+            mPtrData[mOccupiedBricks[brick]] = (atlasx + (atlasy << 8) + (atlasz << 16));
+        }
+    }
+
+    template <typename TexelType, unsigned int kBitsPerTexel>
+    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::encodeBrick(const float* data, uint32_t atlasBrick, uint32_t range)
+    {
+        // The atlas can hold more than 2^32 texels, offsets into it are computed in size_t.
+        uint3 atlasSizePixels = getAtlasSizePixels();
+        uint bricksPerSlice = mAtlasSizeBricks.x * mAtlasSizeBricks.y;
+        size_t pixelsPerSlice = size_t(atlasSizePixels.x) * atlasSizePixels.y;
+
+        // The range stores the majorant and minorant rounded to fp16, as used for quantization.
+        float majorant = f16tof32(range & 0xffff);
+        float minorant = f16tof32(range >> 16);
+        size_t atlasx = atlasBrick % mAtlasSizeBricks.x;
+        size_t atlasy = (atlasBrick / mAtlasSizeBricks.x) % mAtlasSizeBricks.y;
+        size_t atlasz = atlasBrick / bricksPerSlice;
+
+        if (!kBC4Compress) {
+            float invRange = ((1 << kBitsPerTexel) - 1.f) / (majorant - minorant);
+            TexelType* atlasdst = (TexelType*)mAtlasData.data() + atlasx * kBrickSize + atlasy * (atlasSizePixels.x * kBrickSize) + atlasz * (pixelsPerSlice * kBrickSize);
+            for (int pixz = 0; pixz < kBrickSize; ++pixz)
+            {
+                for (int pixy = 0; pixy < kBrickSize; ++pixy)
+                {
+                    for (int pixx = 0; pixx < kBrickSize; ++pixx)
+                    {
+                        float f = data[pixx * kBrickSize * kBrickSize + pixy * kBrickSize + pixz];
+                        *atlasdst++ = TexelType((f - minorant) * invRange);
+                    }
+                    atlasdst += (atlasSizePixels.x - kBrickSize); // next scanline
+                }
+                atlasdst += (pixelsPerSlice - (atlasSizePixels.x * kBrickSize)); // next slice
+            }
+        }
+        else {
+            // BC4 compression:
+            float invRange = (255.f) / (majorant - minorant);
+            uint64_t* atlasdst = ((uint64_t*)mAtlasData.data() + atlasx * (kBrickSize / 4) + atlasy * ((atlasSizePixels.x / 4) * kBrickSize / 4) + atlasz * (pixelsPerSlice / 16 * kBrickSize));
+            for (int pixz = 0; pixz < kBrickSize; ++pixz)
             {
-                for (int x = 0; x < leafdim_tgt.x; ++x, rangesrc += 2)
+                for (int tiley = 0; tiley < kBrickSize; tiley += 4)
                 {
-                    float2 majmin_dst = combineMajMin(
-                        combineMajMin(
-                            combineMajMin(unpackMajMin(rangesrc), unpackMajMin(rangesrc + 1)),
-                            combineMajMin(unpackMajMin(rangesrc + rowstride_src), unpackMajMin(rangesrc + 1 + rowstride_src))
-                        ),
-                        combineMajMin(
-                            combineMajMin(unpackMajMin(rangesrc + slicestride_src), unpackMajMin(rangesrc + slicestride_src + 1)),
-                            combineMajMin(unpackMajMin(rangesrc + slicestride_src + rowstride_src), unpackMajMin(rangesrc + slicestride_src + 1 + rowstride_src))
-                        )
-                    );
-                    *rangedst++ = f32tof16(majmin_dst.x) + (f32tof16(majmin_dst.y) << 16);
-                } // x
-            } // y
-        } // z
+                    for (int tilex = 0; tilex < kBrickSize; tilex += 4) {
+                        uint8_t tilevals[4][4];
+                        for (int pixy = 0; pixy < 4; ++pixy)
+                        {
+                            for (int pixx = 0; pixx < 4; ++pixx)
+                            {
+                                float f = data[(pixx + tilex) * (kBrickSize * kBrickSize) + (pixy + tiley) * kBrickSize + pixz];
+                                tilevals[pixy][pixx] = uint8_t((f - minorant) * invRange);
+                            }
+                        }
+                        CompressAlphaDxt5((uint8_t*)&tilevals[0][0], atlasdst);
+                        atlasdst++;
+                    }
+                    atlasdst += (atlasSizePixels.x / 4 - kBrickSize / 4); // next scanline
+                }
+                atlasdst += (pixelsPerSlice / 16 - (atlasSizePixels.x / 4 * kBrickSize / 4)); // next slice
+            } // z slice loop
+        } // bc4 compress?
     }
 
     template <typename TexelType, unsigned int kBitsPerTexel>
     BrickedGrid NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::convert(ref<Device> pDevice)
     {
         auto t0 = CpuTimer::getCurrentTimePoint();
-        auto range = NumericRange<int>(0, mLeafDim[0].z);
-        std::for_each(std::execution::par, range.begin(), range.end(), [&](int z) { convertSlice(z); });
-        for (int mip = 1; mip < 4; ++mip) computeMip(mip);
+
+        // Value ranges of the finest level, one task per row of bricks.
+        Threading::parallelFor(0, size_t(mLeafDim[0].y) * mLeafDim[0].z, [&](size_t row) { computeRanges(int(row % mLeafDim[0].y), int(row / mLeafDim[0].y)); });
+        auto t1 = CpuTimer::getCurrentTimePoint();
+
+        // Range mips, each level depends on the previous one.
+        for (int mip = 1; mip < 4; ++mip)
+        {
+            Threading::parallelFor(0, mLeafDim[mip].z, [&](size_t z) { computeMip(mip, int(z)); });
+        }
+        auto t2 = CpuTimer::getCurrentTimePoint();
+
+        // Occupied bricks into the atlas.
+        allocateAtlas();
+        Threading::parallelForChunked(
+            0,
+            mOccupiedBricks.size(),
+            [&](size_t begin, size_t end)
+            {
+                auto a = mpFloatGrid->getAccessor();
+                for (size_t brick = begin; brick < end; ++brick)
+                {
+                    uint32_t index = mOccupiedBricks[brick];
+                    int x = index % mLeafDim[0].x;
+                    int y = (index / mLeafDim[0].x) % mLeafDim[0].y;
+                    int z = index / (mLeafDim[0].x * mLeafDim[0].y);
+                    auto leaf = a.probeLeaf(nanovdb::Coord(x * 8 + mBBMin.x, y * 8 + mBBMin.y, z * 8 + mBBMin.z));
+                    FALCOR_ASSERT(leaf);
+                    encodeBrick(leaf->data()->mValues, (uint32_t)brick, mRangeData[index]);
+                }
+            }
+        );
+        auto t3 = CpuTimer::getCurrentTimePoint();
 
         BrickedGrid bricks;
         bricks.range = Texture::create3D(pDevice, mLeafDim[0].x, mLeafDim[0].y, mLeafDim[0].z, ResourceFormat::RG16Float, 4, mRangeData.data(), ResourceBindFlags::ShaderResource, false);
         bricks.indirection = Texture::create3D(pDevice, mLeafDim[0].x, mLeafDim[0].y, mLeafDim[0].z, ResourceFormat::RGBA8Uint, 1, mPtrData.data(), ResourceBindFlags::ShaderResource, false);
         bricks.atlas = Texture::create3D(pDevice, getAtlasSizePixels().x, getAtlasSizePixels().y, getAtlasSizePixels().z, getAtlasFormat(), 1, mAtlasData.data(), ResourceBindFlags::ShaderResource, false);
+        auto t4 = CpuTimer::getCurrentTimePoint();
+
+        mStats.rangeTime = CpuTimer::calcDuration(t0, t1);
+        mStats.mipTime = CpuTimer::calcDuration(t1, t2);
+        mStats.encodeTime = CpuTimer::calcDuration(t2, t3);
+        mStats.uploadTime = CpuTimer::calcDuration(t3, t4);
+        mStats.totalTime = CpuTimer::calcDuration(t0, t4);
+        mStats.brickCount = mLeafCount[0];
+        mStats.occupiedBrickCount = (uint32_t)mOccupiedBricks.size();
+        mStats.atlasSize = mAtlasData.size() * sizeof(TexelType);
 
-        double dt = CpuTimer::calcDuration(t0, CpuTimer::getCurrentTimePoint());
-        logDebug("Converted '{}' in {:.4}ms: mNonEmptyCount {} vs max {}", mpFloatGrid->gridName(), dt, mNonEmptyCount.load(), getAtlasMaxBrick());
+        logDebug("Converted '{}' in {:.4}ms (ranges {:.4}ms, mips {:.4}ms, encode {:.4}ms, upload {:.4}ms): {} of {} bricks occupied, atlas {} bytes",
+            mpFloatGrid->gridName(), mStats.totalTime, mStats.rangeTime, mStats.mipTime, mStats.encodeTime, mStats.uploadTime,
+            mStats.occupiedBrickCount, mStats.brickCount, mStats.atlasSize);
         return bricks;
     }
 }
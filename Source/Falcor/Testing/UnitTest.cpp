@@ -605,6 +605,10 @@ std::vector<Test> filterTests(
             includeTags.insert(token);
     }
 
+    // Benchmarks take too long for the default run, they only run when their tag is selected explicitly.
+    if (includeTags.count("benchmark") == 0)
+        excludeTags.insert("benchmark");
+
     auto matchTags =
         [](const std::set<std::string>& tags, const std::set<std::string>& includeTags, const std::set<std::string>& excludeTags)
     {
@@ -543,6 +543,7 @@ using GPUUnitTestContext = unittest::GPUUnitTestContext;
  * CPU_TEST(Test4, "Not implemented") {} // Test is skipped (same as above)
  *
  * Note: All CPU tests are implicitly tagged with "cpu".
+ * Tests tagged with "benchmark" are only run when the tag filter includes "benchmark".
  */
 #define CPU_TEST(name, ...)                                                     \
     static void CPUUnitTest##name(CPUUnitTestContext& ctx);                     \
@@ -584,6 +585,7 @@ using GPUUnitTestContext = unittest::GPUUnitTestContext;
  * GPU_TEST(Test6, Device::Type::D3D12) {} // Test is only run on D3D12 (same as above)
  *
  * Note: All GPU tests are implicitly tagged with "gpu".
+ * Tests tagged with "benchmark" are only run when the tag filter includes "benchmark".
  */
 #define GPU_TEST(name, ...)                                                     \
     static void GPUUnitTest##name(GPUUnitTestContext& ctx);                     \
@@ -30,14 +30,246 @@
 #include "Core/Assert.h"
 #include "Core/API/RenderContext.h"
 #include "Utils/Math/Common.h"
+#include "Utils/Math/Float16.h"
+#include "Utils/Threading.h"
 #include "Utils/Timing/Profiler.h"
+#include <limits>
 
 namespace Falcor
 {
 static const char kShaderFile[] = "Utils/Algorithm/ParallelReduction.cs.slang";
 
-ParallelReduction::ParallelReduction(ref<Device> pDevice) : mpDevice(pDevice)
+namespace
 {
+// Number of pixels reduced per task on the CPU. Blocks are fixed so that results do not depend on the thread count.
+const uint64_t kCPUBlockSize = 1 << 16;
+
+/**
+ * Returns the format type (FORMAT_TYPE_*) used for reducing the given format in type T.
+ * Throws if the format is not supported or not compatible with T.
+ */
+template<typename T>
+uint32_t getReductionFormatType(ResourceFormat format)
+{
+    uint32_t formatType = FORMAT_TYPE_UNKNOWN;
+    switch (getFormatType(format))
+    {
+    case FormatType::Float:
+    case FormatType::Unorm:
+    case FormatType::Snorm:
+        formatType = FORMAT_TYPE_FLOAT;
+        break;
+    case FormatType::Sint:
+        formatType = FORMAT_TYPE_SINT;
+        break;
+    case FormatType::Uint:
+        formatType = FORMAT_TYPE_UINT;
+        break;
+    default:
+        throw RuntimeError("ParallelReduction::execute() - Input texture format unsupported.");
+    }
+
+    // Check that reduction type T is compatible with the resource format.
+    if (sizeof(typename T::value_type) != 4 || // The shader is written for 32-bit types
+        (formatType == FORMAT_TYPE_FLOAT && !std::is_floating_point<typename T::value_type>::value) ||
+        (formatType == FORMAT_TYPE_SINT &&
+         (!std::is_integral<typename T::value_type>::value || !std::is_signed<typename T::value_type>::value)) ||
+        (formatType == FORMAT_TYPE_UINT &&
+         (!std::is_integral<typename T::value_type>::value || !std::is_unsigned<typename T::value_type>::value)))
+    {
+        throw RuntimeError("ParallelReduction::execute() - Template type T is not compatible with resource format.");
+    }
+
+    return formatType;
+}
+
+/// Returns the number of values of type T produced by a reduction operation.
+uint32_t getResultElementCount(ParallelReduction::Type operation)
+{
+    switch (operation)
+    {
+    case ParallelReduction::Type::Sum:
+        return 1;
+    case ParallelReduction::Type::MinMax:
+        return 2;
+    default:
+        throw RuntimeError("ParallelReduction::execute() - Unknown reduction type.");
+    }
+}
+
+// Channel decoders. Each converts a stored channel value to the value type of the reduction.
+struct DecodeUnorm8
+{
+    using Storage = uint8_t;
+    float operator()(uint8_t v) const { return v * (1.f / 255.f); }
+};
+struct DecodeUnorm16
+{
+    using Storage = uint16_t;
+    float operator()(uint16_t v) const { return v * (1.f / 65535.f); }
+};
+struct DecodeSnorm8
+{
+    using Storage = int8_t;
+    float operator()(int8_t v) const { return std::max(v * (1.f / 127.f), -1.f); }
+};
+struct DecodeSnorm16
+{
+    using Storage = int16_t;
+    float operator()(int16_t v) const { return std::max(v * (1.f / 32767.f), -1.f); }
+};
+struct DecodeFloat16
+{
+    using Storage = uint16_t;
+    float operator()(uint16_t v) const { return math::float16ToFloat32(v); }
+};
+template<typename S, typename V>
+struct DecodeCast
+{
+    using Storage = S;
+    V operator()(S v) const { return static_cast<V>(v); }
+};
+
+/**
+ * Reduces a range of pixels with C channels. Missing channels are treated as zero, as on the GPU.
+ * Sums of floating-point values are accumulated in double precision, integer sums wrap around like on the GPU.
+ */
+template<typename T, uint32_t C, typename Decode>
+void reduceBlock(const void* pData, uint64_t begin, uint64_t end, ParallelReduction::Type operation, T* pResult)
+{
+    using V = typename T::value_type;
+    using Acc = std::conditional_t<std::is_floating_point_v<V>, double, uint32_t>;
+    const typename Decode::Storage* pSrc = static_cast<const typename Decode::Storage*>(pData) + begin * C;
+    const uint64_t count = end - begin;
+    Decode decode;
+
+    if (operation == ParallelReduction::Type::Sum)
+    {
+        Acc sum[C] = {};
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            for (uint32_t c = 0; c < C; ++c)
+                sum[c] += static_cast<Acc>(decode(pSrc[i * C + c]));
+        }
+        T result{};
+        for (uint32_t c = 0; c < C; ++c)
+            result[c] = static_cast<V>(sum[c]);
+        pResult[0] = result;
+    }
+    else
+    {
+        V minValue[C], maxValue[C];
+        for (uint32_t c = 0; c < C; ++c)
+        {
+            minValue[c] = std::numeric_limits<V>::max();
+            maxValue[c] = std::numeric_limits<V>::lowest();
+        }
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            for (uint32_t c = 0; c < C; ++c)
+            {
+                V value = decode(pSrc[i * C + c]);
+                minValue[c] = value < minValue[c] ? value : minValue[c];
+                maxValue[c] = value > maxValue[c] ? value : maxValue[c];
+            }
+        }
+        T resultMin{}, resultMax{};
+        for (uint32_t c = 0; c < C; ++c)
+        {
+            resultMin[c] = minValue[c];
+            resultMax[c] = maxValue[c];
+        }
+        pResult[0] = resultMin;
+        pResult[1] = resultMax;
+    }
+}
+
+template<typename T, uint32_t C, typename Decode>
+void reduceCPU(const void* pData, uint64_t pixelCount, ParallelReduction::Type operation, T* pResult)
+{
+    using V = typename T::value_type;
+    const uint32_t resultCount = getResultElementCount(operation);
+    const uint64_t blockCount = div_round_up(pixelCount, kCPUBlockSize);
+
+    // Reduce blocks in parallel, then combine the block results in order.
+    std::vector<T> blockResults(blockCount * resultCount);
+    Threading::parallelForChunked(
+        0,
+        blockCount,
+        [&](size_t blockBegin, size_t blockEnd)
+        {
+            for (size_t block = blockBegin; block < blockEnd; ++block)
+            {
+                const uint64_t begin = block * kCPUBlockSize;
+                const uint64_t end = std::min(pixelCount, begin + kCPUBlockSize);
+                reduceBlock<T, C, Decode>(pData, begin, end, operation, &blockResults[block * resultCount]);
+            }
+        },
+        1
+    );
+
+    if (operation == ParallelReduction::Type::Sum)
+    {
+        using Acc = std::conditional_t<std::is_floating_point_v<V>, double, uint32_t>;
+        Acc sum[4] = {};
+        for (uint64_t block = 0; block < blockCount; ++block)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+                sum[c] += static_cast<Acc>(blockResults[block][c]);
+        }
+        T result;
+        for (uint32_t c = 0; c < 4; ++c)
+            result[c] = static_cast<V>(sum[c]);
+        pResult[0] = result;
+    }
+    else
+    {
+        // Matches the initial values used on the GPU if there are no pixels.
+        T minValue(std::numeric_limits<V>::max());
+        T maxValue(std::numeric_limits<V>::lowest());
+        for (uint64_t block = 0; block < blockCount; ++block)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                minValue[c] = std::min(minValue[c], blockResults[block * 2][c]);
+                maxValue[c] = std::max(maxValue[c], blockResults[block * 2 + 1][c]);
+            }
+        }
+        pResult[0] = minValue;
+        pResult[1] = maxValue;
+    }
+}
+
+template<typename T, typename Decode>
+void reduceCPU(const void* pData, uint64_t pixelCount, uint32_t channelCount, ParallelReduction::Type operation, T* pResult)
+{
+    switch (channelCount)
+    {
+    case 1:
+        return reduceCPU<T, 1, Decode>(pData, pixelCount, operation, pResult);
+    case 2:
+        return reduceCPU<T, 2, Decode>(pData, pixelCount, operation, pResult);
+    case 3:
+        return reduceCPU<T, 3, Decode>(pData, pixelCount, operation, pResult);
+    case 4:
+        return reduceCPU<T, 4, Decode>(pData, pixelCount, operation, pResult);
+    default:
+        FALCOR_UNREACHABLE();
+    }
+}
+} // namespace
+
+ParallelReduction::ParallelReduction(ref<Device> pDevice, Backend backend) : mpDevice(pDevice), mBackend(backend)
+{
+    if (mBackend == Backend::GPU)
+        createPrograms();
+}
+
+void ParallelReduction::createPrograms()
+{
+    if (mpInitialProgram)
+        return;
+
     // Create the programs.
     // Set defines to avoid compiler warnings about undefined macros. Proper values will be assigned at runtime.
     DefineList defines = {{"REDUCTION_TYPE", "1"}, {"FORMAT_CHANNELS", "1"}, {"FORMAT_TYPE", "1"}};
@@ -91,51 +323,32 @@ void ParallelReduction::execute(
     }
 
     // Check texture format.
-    uint32_t formatType = FORMAT_TYPE_UNKNOWN;
-    switch (getFormatType(pInput->getFormat()))
-    {
-    case FormatType::Float:
-    case FormatType::Unorm:
-    case FormatType::Snorm:
-        formatType = FORMAT_TYPE_FLOAT;
-        break;
-    case FormatType::Sint:
-        formatType = FORMAT_TYPE_SINT;
-        break;
-    case FormatType::Uint:
-        formatType = FORMAT_TYPE_UINT;
-        break;
-    default:
-        throw RuntimeError("ParallelReduction::execute() - Input texture format unsupported.");
-    }
+    const uint32_t formatType = getReductionFormatType<T>(pInput->getFormat());
+    const uint32_t elementSize = getResultElementCount(operation);
+    const uint32_t reductionType = operation == Type::Sum ? REDUCTION_TYPE_SUM : REDUCTION_TYPE_MINMAX;
+    const size_t resultSize = elementSize * 16;
 
-    // Check that reduction type T is compatible with the resource format.
-    if (sizeof(typename T::value_type) != 4 || // The shader is written for 32-bit types
-        (formatType == FORMAT_TYPE_FLOAT && !std::is_floating_point<typename T::value_type>::value) ||
-        (formatType == FORMAT_TYPE_SINT &&
-         (!std::is_integral<typename T::value_type>::value || !std::is_signed<typename T::value_type>::value)) ||
-        (formatType == FORMAT_TYPE_UINT &&
-         (!std::is_integral<typename T::value_type>::value || !std::is_unsigned<typename T::value_type>::value)))
+    if (pResultBuffer && resultOffset + resultSize > pResultBuffer->getSize())
     {
-        throw RuntimeError("ParallelReduction::execute() - Template type T is not compatible with resource format.");
+        throw RuntimeError("ParallelReduction::execute() - Results buffer is too small.");
     }
 
-    uint32_t reductionType = REDUCTION_TYPE_UNKNOWN;
-    uint32_t elementSize = 0;
-    switch (operation)
+    if (mBackend == Backend::CPU)
     {
-    case Type::Sum:
-        reductionType = REDUCTION_TYPE_SUM;
-        elementSize = 1;
-        break;
-    case Type::MinMax:
-        reductionType = REDUCTION_TYPE_MINMAX;
-        elementSize = 2;
-        break;
-    default:
-        throw RuntimeError("ParallelReduction::execute() - Unknown reduction type.");
+        // Read back the texture and reduce on the CPU.
+        std::vector<uint8_t> data = pRenderContext->readTextureSubresource(pInput.get(), 0);
+        T result[2];
+        executeCPU(data.data(), uint64_t(pInput->getWidth()) * pInput->getHeight(), pInput->getFormat(), operation, result);
+
+        if (pResultBuffer)
+            pResultBuffer->setBlob(result, resultOffset, resultSize);
+        if (pResult)
+            std::memcpy(pResult, result, resultSize);
+        return;
     }
 
+    createPrograms();
+
     // Allocate intermediate buffers if needed.
     const uint2 resolution = uint2(pInput->getWidth(), pInput->getHeight());
     FALCOR_ASSERT(resolution.x > 0 && resolution.y > 0);
@@ -193,16 +406,9 @@ void ParallelReduction::execute(
         }
     }
 
-    size_t resultSize = elementSize * 16;
-
     // Copy the result to GPU buffer.
     if (pResultBuffer)
     {
-        if (resultOffset + resultSize > pResultBuffer->getSize())
-        {
-            throw RuntimeError("ParallelReduction::execute() - Results buffer is too small.");
-        }
-
         pRenderContext->copyBufferRegion(pResultBuffer.get(), resultOffset, mpBuffers[inputsBufferIndex].get(), 0, resultSize);
     }
 
@@ -216,10 +422,78 @@ void ParallelReduction::execute(
     }
 }
 
+template<typename T>
+void ParallelReduction::executeCPU(const void* pData, uint64_t pixelCount, ResourceFormat format, Type operation, T* pResult)
+{
+    const uint32_t formatType = getReductionFormatType<T>(format);
+    FALCOR_ASSERT(pResult);
+
+    // Only formats with equally sized channels in RGBA order are supported.
+    const uint32_t channelCount = getFormatChannelCount(format);
+    const uint32_t bits = getNumChannelBits(format, 0);
+    bool supported = !isCompressedFormat(format) && channelCount >= 1 && channelCount <= 4 &&
+                     getFormatBytesPerBlock(format) * 8 == bits * channelCount && format != ResourceFormat::BGRA8Unorm &&
+                     format != ResourceFormat::BGRX8Unorm;
+    for (uint32_t i = 1; i < channelCount; ++i)
+        supported = supported && getNumChannelBits(format, (int)i) == bits;
+    if (!supported)
+        throw RuntimeError("ParallelReduction::executeCPU() - Format '{}' is unsupported.", to_string(format));
+
+    using V = typename T::value_type;
+    const FormatType type = getFormatType(format);
+    if (formatType == FORMAT_TYPE_FLOAT)
+    {
+        if constexpr (std::is_floating_point_v<V>)
+        {
+            if (type == FormatType::Float && bits == 32)
+                return reduceCPU<T, DecodeCast<float, V>>(pData, pixelCount, channelCount, operation, pResult);
+            if (type == FormatType::Float && bits == 16)
+                return reduceCPU<T, DecodeFloat16>(pData, pixelCount, channelCount, operation, pResult);
+            if (type == FormatType::Unorm && bits == 8)
+                return reduceCPU<T, DecodeUnorm8>(pData, pixelCount, channelCount, operation, pResult);
+            if (type == FormatType::Unorm && bits == 16)
+                return reduceCPU<T, DecodeUnorm16>(pData, pixelCount, channelCount, operation, pResult);
+            if (type == FormatType::Snorm && bits == 8)
+                return reduceCPU<T, DecodeSnorm8>(pData, pixelCount, channelCount, operation, pResult);
+            if (type == FormatType::Snorm && bits == 16)
+                return reduceCPU<T, DecodeSnorm16>(pData, pixelCount, channelCount, operation, pResult);
+        }
+    }
+    else if (formatType == FORMAT_TYPE_SINT)
+    {
+        if constexpr (std::is_signed_v<V> && std::is_integral_v<V>)
+        {
+            if (bits == 8)
+                return reduceCPU<T, DecodeCast<int8_t, V>>(pData, pixelCount, channelCount, operation, pResult);
+            if (bits == 16)
+                return reduceCPU<T, DecodeCast<int16_t, V>>(pData, pixelCount, channelCount, operation, pResult);
+            if (bits == 32)
+                return reduceCPU<T, DecodeCast<int32_t, V>>(pData, pixelCount, channelCount, operation, pResult);
+        }
+    }
+    else if (formatType == FORMAT_TYPE_UINT)
+    {
+        if constexpr (std::is_unsigned_v<V>)
+        {
+            if (bits == 8)
+                return reduceCPU<T, DecodeCast<uint8_t, V>>(pData, pixelCount, channelCount, operation, pResult);
+            if (bits == 16)
+                return reduceCPU<T, DecodeCast<uint16_t, V>>(pData, pixelCount, channelCount, operation, pResult);
+            if (bits == 32)
+                return reduceCPU<T, DecodeCast<uint32_t, V>>(pData, pixelCount, channelCount, operation, pResult);
+        }
+    }
+
+    throw RuntimeError("ParallelReduction::executeCPU() - Format '{}' is unsupported.", to_string(format));
+}
+
 // Explicit template instantiation of the supported types.
 // clang-format off
 template FALCOR_API void ParallelReduction::execute<float4>(RenderContext* pRenderContext, const ref<Texture>& pInput, Type operation, float4* pResult, ref<Buffer> pResultBuffer, uint64_t resultOffset);
 template FALCOR_API void ParallelReduction::execute<int4>(RenderContext* pRenderContext, const ref<Texture>& pInput, Type operation, int4* pResult, ref<Buffer> pResultBuffer, uint64_t resultOffset);
 template FALCOR_API void ParallelReduction::execute<uint4>(RenderContext* pRenderContext, const ref<Texture>& pInput, Type operation, uint4* pResult, ref<Buffer> pResultBuffer, uint64_t resultOffset);
+template FALCOR_API void ParallelReduction::executeCPU<float4>(const void* pData, uint64_t pixelCount, ResourceFormat format, Type operation, float4* pResult);
+template FALCOR_API void ParallelReduction::executeCPU<int4>(const void* pData, uint64_t pixelCount, ResourceFormat format, Type operation, int4* pResult);
+template FALCOR_API void ParallelReduction::executeCPU<uint4>(const void* pData, uint64_t pixelCount, ResourceFormat format, Type operation, uint4* pResult);
 // clang-format on
 } // namespace Falcor
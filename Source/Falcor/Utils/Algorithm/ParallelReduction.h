@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "Core/Macros.h"
+#include "Core/Enum.h"
 #include "Core/API/Buffer.h"
 #include "Core/State/ComputeState.h"
 #include "Core/Program/ComputeProgram.h"
@@ -44,6 +45,11 @@ namespace Falcor
  *
  * The numerical error for the summation operation lies between pairwise
  * summation (blocks of size n = 2) and naive running summation.
+ *
+ * Alternatively, the reduction can run on the CPU (see Backend::CPU). The texture is then
+ * read back and reduced by the thread pool in fixed-size blocks, with per-block sums of
+ * floating-point formats accumulated in double precision. The CPU reduction can also be used
+ * directly on data in memory through executeCPU(), which does not require a device.
  */
 class FALCOR_API ParallelReduction
 {
@@ -54,8 +60,32 @@ public:
         MinMax,
     };
 
+    enum class Backend
+    {
+        GPU, ///< Reduction using compute passes.
+        CPU, ///< Multithreaded reduction on the CPU. Requires a GPU flush to read back the input.
+    };
+
+    FALCOR_ENUM_INFO(
+        Backend,
+        {
+            {Backend::GPU, "GPU"},
+            {Backend::CPU, "CPU"},
+        }
+    );
+
     /// Constructor. Throws an exception on failure.
-    ParallelReduction(ref<Device> pDevice);
+    ParallelReduction(ref<Device> pDevice, Backend backend = Backend::GPU);
+
+    /**
+     * Set the backend used by execute(). The GPU programs are created on first use.
+     */
+    void setBackend(Backend backend) { mBackend = backend; }
+
+    /**
+     * Get the backend used by execute().
+     */
+    Backend getBackend() const { return mBackend; }
 
     /**
      * Perform parallel reduction.
@@ -91,10 +121,27 @@ public:
         uint64_t resultOffset = 0
     );
 
+    /**
+     * Perform parallel reduction on the CPU over pixels in memory.
+     * The computations are performed in type T, with the same format requirements as execute().
+     * Supported formats are uncompressed formats in RGBA channel order with 8, 16 or 32 bits per channel.
+     * Throws an exception if the format is not supported.
+     *
+     * @param[in] pData Tightly packed pixel data.
+     * @param[in] pixelCount Number of pixels.
+     * @param[in] format Pixel format.
+     * @param[in] operation Reduction operation.
+     * @param[out] pResult The result of the reduction operation (one value for Sum, two values for MinMax).
+     */
+    template<typename T>
+    static void executeCPU(const void* pData, uint64_t pixelCount, ResourceFormat format, Type operation, T* pResult);
+
 private:
+    void createPrograms();
     void allocate(uint32_t elementCount, uint32_t elementSize);
 
     ref<Device> mpDevice;
+    Backend mBackend = Backend::GPU;
 
     ref<ComputeState> mpState;
     ref<ComputeProgram> mpInitialProgram;
@@ -103,4 +150,6 @@ private:
 
     ref<Buffer> mpBuffers[2]; ///< Intermediate buffers for reduction iterations.
 };
+
+FALCOR_ENUM_REGISTER(ParallelReduction::Backend);
 } // namespace Falcor
@@ -29,6 +29,7 @@
 #include "Core/Assert.h"
 #include "Core/API/RenderContext.h"
 #include "Utils/Math/Common.h"
+#include "Utils/Threading.h"
 #include "Utils/Timing/Profiler.h"
 
 namespace Falcor
@@ -37,10 +38,53 @@ namespace
 {
 const char kShaderFile[] = "Utils/Algorithm/PrefixSum.cs.slang";
 const uint32_t kGroupSize = 1024;
+
+// Number of elements scanned per task on the CPU.
+const size_t kCPUBlockSize = 1 << 16;
+
+/// Exclusive scan of a range with a start offset. Returns the sum of the range plus the offset.
+uint32_t scanRange(uint32_t* pData, size_t count, uint32_t offset)
+{
+    uint32_t sum = offset;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t value = pData[i];
+        pData[i] = sum;
+        sum += value;
+    }
+    return sum;
+}
+
+/// Sum of a range. Independent partial sums let the loop vectorize.
+uint32_t sumRange(const uint32_t* pData, size_t count)
+{
+    uint32_t sums[8] = {};
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        for (size_t j = 0; j < 8; ++j)
+            sums[j] += pData[i + j];
+    }
+    uint32_t sum = 0;
+    for (uint32_t partialSum : sums)
+        sum += partialSum;
+    for (; i < count; ++i)
+        sum += pData[i];
+    return sum;
+}
 } // namespace
 
-PrefixSum::PrefixSum(ref<Device> pDevice) : mpDevice(pDevice)
+PrefixSum::PrefixSum(ref<Device> pDevice, Backend backend) : mpDevice(pDevice), mBackend(backend)
 {
+    if (mBackend == Backend::GPU)
+        createPrograms();
+}
+
+void PrefixSum::createPrograms()
+{
+    if (mpPrefixSumGroupProgram)
+        return;
+
     // Create shaders and state.
     DefineList defines = {{"GROUP_SIZE", std::to_string(kGroupSize)}};
     mpPrefixSumGroupProgram = ComputeProgram::createFromFile(mpDevice, kShaderFile, "groupScan", defines);
@@ -87,6 +131,31 @@ void PrefixSum::execute(
     FALCOR_ASSERT(elementCount > 0);
     FALCOR_ASSERT(pData && pData->getSize() >= elementCount * sizeof(uint32_t));
 
+    if (pTotalSumBuffer && pTotalSumOffset + 4 > pTotalSumBuffer->getSize())
+    {
+        throw RuntimeError("PrefixSum::execute() - Results buffer is too small.");
+    }
+
+    if (mBackend == Backend::CPU)
+    {
+        // Read back the data, compute the prefix sum on the CPU and upload the result.
+        std::vector<uint32_t> data(elementCount);
+        const uint32_t* pMappedData = static_cast<const uint32_t*>(pData->map(Buffer::MapType::Read));
+        std::memcpy(data.data(), pMappedData, elementCount * sizeof(uint32_t));
+        pData->unmap();
+
+        const uint32_t totalSum = executeCPU(data.data(), elementCount);
+        pData->setBlob(data.data(), 0, elementCount * sizeof(uint32_t));
+
+        if (pTotalSumBuffer)
+            pTotalSumBuffer->setBlob(&totalSum, pTotalSumOffset, sizeof(uint32_t));
+        if (pTotalSum)
+            *pTotalSum = totalSum;
+        return;
+    }
+
+    createPrograms();
+
     // Clear total sum to zero.
     pRenderContext->clearUAV(mpTotalSum->getUAV().get(), uint4(0));
 
@@ -151,11 +220,6 @@ void PrefixSum::execute(
     // Copy total sum to separate destination buffer, if specified.
     if (pTotalSumBuffer)
     {
-        if (pTotalSumOffset + 4 > pTotalSumBuffer->getSize())
-        {
-            throw RuntimeError("PrefixSum::execute() - Results buffer is too small.");
-        }
-
         pRenderContext->copyBufferRegion(pTotalSumBuffer.get(), pTotalSumOffset, mpTotalSum.get(), 0, 4);
     }
 
@@ -167,4 +231,49 @@ void PrefixSum::execute(
         mpTotalSum->unmap();
     }
 }
+
+uint32_t PrefixSum::executeCPU(uint32_t* pData, size_t elementCount)
+{
+    FALCOR_ASSERT(pData || elementCount == 0);
+
+    const size_t blockCount = div_round_up(elementCount, kCPUBlockSize);
+    if (blockCount <= 1)
+        return scanRange(pData, elementCount, 0);
+
+    // Pass 1: compute the sum of each block.
+    std::vector<uint32_t> blockOffsets(blockCount);
+    Threading::parallelForChunked(
+        0,
+        blockCount,
+        [&](size_t blockBegin, size_t blockEnd)
+        {
+            for (size_t block = blockBegin; block < blockEnd; ++block)
+            {
+                const size_t begin = block * kCPUBlockSize;
+                blockOffsets[block] = sumRange(pData + begin, std::min(elementCount - begin, kCPUBlockSize));
+            }
+        },
+        1
+    );
+
+    // Scan the block sums to get the offset of each block.
+    const uint32_t totalSum = scanRange(blockOffsets.data(), blockCount, 0);
+
+    // Pass 2: scan each block starting at its offset.
+    Threading::parallelForChunked(
+        0,
+        blockCount,
+        [&](size_t blockBegin, size_t blockEnd)
+        {
+            for (size_t block = blockBegin; block < blockEnd; ++block)
+            {
+                const size_t begin = block * kCPUBlockSize;
+                scanRange(pData + begin, std::min(elementCount - begin, kCPUBlockSize), blockOffsets[block]);
+            }
+        },
+        1
+    );
+
+    return totalSum;
+}
 } // namespace Falcor
@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "Core/Macros.h"
+#include "Core/Enum.h"
 #include "Core/API/Buffer.h"
 #include "Core/State/ComputeState.h"
 #include "Core/Program/ComputeProgram.h"
@@ -42,12 +43,39 @@ class RenderContext;
  *
  * The prefix sum is computed in place using exclusive scan.
  * Each new element is y[i] = x[0] + ... + x[i-1], for i=1..N and y[0] = 0.
+ *
+ * Alternatively, the prefix sum can be computed on the CPU (see Backend::CPU), or directly
+ * on data in memory through executeCPU(), which does not require a device.
  */
 class FALCOR_API PrefixSum
 {
 public:
+    enum class Backend
+    {
+        GPU, ///< Prefix sum using compute passes.
+        CPU, ///< Multithreaded prefix sum on the CPU. Requires a GPU flush to read back the data.
+    };
+
+    FALCOR_ENUM_INFO(
+        Backend,
+        {
+            {Backend::GPU, "GPU"},
+            {Backend::CPU, "CPU"},
+        }
+    );
+
     /// Constructor. Throws an exception if creation failed.
-    PrefixSum(ref<Device> pDevice);
+    PrefixSum(ref<Device> pDevice, Backend backend = Backend::GPU);
+
+    /**
+     * Set the backend used by execute(). The GPU programs are created on first use.
+     */
+    void setBackend(Backend backend) { mBackend = backend; }
+
+    /**
+     * Get the backend used by execute().
+     */
+    Backend getBackend() const { return mBackend; }
 
     /**
      * Computes the parallel prefix sum over an array of uint32_t elements.
@@ -67,8 +95,19 @@ public:
         uint64_t pTotalSumOffset = 0
     );
 
+    /**
+     * Computes the prefix sum over an array of uint32_t elements in memory using the thread pool.
+     * @param[in,out] pData The elements to compute prefix sum over (in place).
+     * @param[in] elementCount Number of elements.
+     * @return The sum of all elements.
+     */
+    static uint32_t executeCPU(uint32_t* pData, size_t elementCount);
+
 private:
+    void createPrograms();
+
     ref<Device> mpDevice;
+    Backend mBackend = Backend::GPU;
 
     ref<ComputeState> mpComputeState;
 
@@ -82,4 +121,6 @@ private:
     ref<Buffer> mpTotalSum;        ///< Temporary buffer for total sum of an iteration.
     ref<Buffer> mpPrevTotalSum;    ///< Temporary buffer for prev total sum of an iteration.
 };
+
+FALCOR_ENUM_REGISTER(PrefixSum::Backend);
 } // namespace Falcor
@@ -112,9 +112,9 @@ SHA1::MD SHA1::compute(const void* data, size_t len)
 std::string SHA1::toString(const SHA1::MD& sha1)
 {
     std::stringstream ss;
-    ss << std::hex << std::setfill('0') << std::setw(2);
+    ss << std::hex << std::setfill('0');
     for (auto c : sha1)
-        ss << (int)c;
+        ss << std::setw(2) << (int)c;
     return ss.str();
 }
 
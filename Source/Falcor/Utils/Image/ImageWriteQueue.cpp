@@ -0,0 +1,189 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "ImageWriteQueue.h"
+#include "Core/Assert.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <algorithm>
+#include <exception>
+
+namespace Falcor
+{
+ImageWriteQueue::ImageWriteQueue(size_t memoryBudget, size_t threadCount) : mMemoryBudget(memoryBudget)
+{
+    threadCount = std::max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        mThreads.emplace_back(&ImageWriteQueue::runWorker, this);
+    }
+}
+
+ImageWriteQueue::~ImageWriteQueue()
+{
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTerminate = true;
+    }
+    mWorkCondition.notify_all();
+
+    for (auto& thread : mThreads)
+        thread.join();
+}
+
+void ImageWriteQueue::enqueue(size_t memorySize, Job job)
+{
+    std::vector<Entry> retired;
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    // Wait until the job fits in the memory budget. A job larger than the budget is accepted once the queue is empty.
+    retireLocked(retired);
+    if (mStats.memoryInFlight > 0 && mStats.memoryInFlight + memorySize > mMemoryBudget)
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        while (mStats.memoryInFlight > 0 && mStats.memoryInFlight + memorySize > mMemoryBudget)
+        {
+            mFinishedCondition.wait(lock, [&]() { return std::any_of(mEntries.begin(), mEntries.end(), [](const Entry& e) { return e.finished; }); });
+            retireLocked(retired);
+        }
+        mStats.stallTime += CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+    }
+
+    mEntries.push_back(Entry{std::move(job), memorySize, false});
+    mPendingEntries.push(&mEntries.back());
+    mStats.jobsQueued++;
+    mStats.memoryInFlight += memorySize;
+    mStats.peakMemoryInFlight = std::max(mStats.peakMemoryInFlight, mStats.memoryInFlight);
+
+    lock.unlock();
+    mWorkCondition.notify_one();
+
+    // The retired jobs are destroyed here, outside of the critical section.
+}
+
+void ImageWriteQueue::retire()
+{
+    std::vector<Entry> retired;
+    std::lock_guard<std::mutex> lock(mMutex);
+    retireLocked(retired);
+}
+
+void ImageWriteQueue::flush()
+{
+    std::vector<Entry> retired;
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFinishedCondition.wait(lock, [&]() { return std::all_of(mEntries.begin(), mEntries.end(), [](const Entry& e) { return e.finished; }); });
+    retireLocked(retired);
+}
+
+void ImageWriteQueue::setMemoryBudget(size_t memoryBudget)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMemoryBudget = memoryBudget;
+}
+
+size_t ImageWriteQueue::getMemoryBudget() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMemoryBudget;
+}
+
+ImageWriteQueue::Stats ImageWriteQueue::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void ImageWriteQueue::retireLocked(std::vector<Entry>& retired)
+{
+    for (auto it = mEntries.begin(); it != mEntries.end();)
+    {
+        if (it->finished)
+        {
+            mStats.memoryInFlight -= it->memorySize;
+            retired.push_back(std::move(*it));
+            it = mEntries.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void ImageWriteQueue::runWorker()
+{
+    // This function is the entry point for worker threads.
+    // The workers wait on the pending queue and execute a job when woken up.
+    // Finished jobs are left in the entry list to be destroyed by the thread owning the queue.
+
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWorkCondition.wait(lock, [&]() { return mTerminate || !mPendingEntries.empty(); });
+
+        if (mPendingEntries.empty())
+        {
+            FALCOR_ASSERT(mTerminate);
+            break;
+        }
+
+        Entry* pEntry = mPendingEntries.front();
+        mPendingEntries.pop();
+
+        lock.unlock();
+
+        // Execute the job (this part is running in parallel).
+        bool failed = false;
+        try
+        {
+            pEntry->job();
+        }
+        catch (const std::exception& e)
+        {
+            logError("ImageWriteQueue: Failed to write image: {}", e.what());
+            failed = true;
+        }
+        catch (...)
+        {
+            logError("ImageWriteQueue: Failed to write image: Unknown error.");
+            failed = true;
+        }
+
+        lock.lock();
+        pEntry->finished = true;
+        mStats.jobsCompleted++;
+        if (failed)
+            mStats.jobsFailed++;
+        lock.unlock();
+
+        mFinishedCondition.notify_all();
+    }
+}
+} // namespace Falcor
@@ -0,0 +1,144 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Queue for writing images asynchronously using a pool of background worker threads.
+ *
+ * Each job declares the amount of memory it holds (e.g. the read back image data). The total memory of
+ * all jobs in the queue is bounded by a memory budget: if enqueuing a job would exceed the budget,
+ * enqueue() blocks until enough of the previously queued jobs have finished. A single job larger than
+ * the budget is accepted once the queue is empty.
+ *
+ * Jobs are executed on the worker threads, but they are destroyed on the thread calling enqueue(),
+ * retire() or flush(). This allows jobs to hold on to GPU resources (such as readback buffers) that
+ * must be released on the thread owning the device. These functions must all be called from the same thread.
+ */
+class FALCOR_API ImageWriteQueue
+{
+public:
+    using Job = std::function<void()>;
+
+    static constexpr size_t kDefaultMemoryBudget = size_t(1) << 30;
+    static constexpr size_t kDefaultThreadCount = 4;
+
+    struct Stats
+    {
+        uint64_t jobsQueued = 0;       ///< Number of jobs enqueued.
+        uint64_t jobsCompleted = 0;    ///< Number of jobs that have finished executing (including failed jobs).
+        uint64_t jobsFailed = 0;       ///< Number of jobs that have thrown an exception.
+        size_t memoryInFlight = 0;     ///< Memory currently held by queued or executing jobs in bytes.
+        size_t peakMemoryInFlight = 0; ///< Peak memory held by queued or executing jobs in bytes.
+        double stallTime = 0.0;        ///< Total time enqueue() was blocked waiting for memory in seconds.
+    };
+
+    /**
+     * Constructor.
+     * @param[in] memoryBudget Maximum memory held by queued jobs in bytes.
+     * @param[in] threadCount Number of worker threads.
+     */
+    ImageWriteQueue(size_t memoryBudget = kDefaultMemoryBudget, size_t threadCount = kDefaultThreadCount);
+
+    /**
+     * Destructor.
+     * Blocks until all queued jobs have finished and the worker threads have terminated.
+     */
+    ~ImageWriteQueue();
+
+    ImageWriteQueue(const ImageWriteQueue&) = delete;
+    ImageWriteQueue& operator=(const ImageWriteQueue&) = delete;
+
+    /**
+     * Enqueue a job. Blocks while the memory budget is exceeded.
+     * Exceptions thrown by the job are logged and counted in the stats.
+     * @param[in] memorySize Memory held by the job in bytes. The memory is accounted for until the job is destroyed.
+     * @param[in] job Function to execute on a worker thread.
+     */
+    void enqueue(size_t memorySize, Job job);
+
+    /**
+     * Destroy the jobs that have finished executing and release their memory from the budget.
+     */
+    void retire();
+
+    /**
+     * Wait for all queued jobs to finish and destroy them.
+     */
+    void flush();
+
+    /**
+     * Set the memory budget in bytes.
+     */
+    void setMemoryBudget(size_t memoryBudget);
+
+    /**
+     * Get the memory budget in bytes.
+     */
+    size_t getMemoryBudget() const;
+
+    /**
+     * Get the queue statistics.
+     */
+    Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        Job job;
+        size_t memorySize = 0;
+        bool finished = false;
+    };
+
+    void runWorker();
+    void retireLocked(std::vector<Entry>& retired);
+
+    std::vector<std::thread> mThreads;            ///< Worker threads.
+
+    mutable std::mutex mMutex;                    ///< Mutex for synchronizing access to the internal state.
+    std::condition_variable mWorkCondition;       ///< Condition variable for workers to wait on new jobs.
+    std::condition_variable mFinishedCondition;   ///< Condition variable for waiting on jobs to finish.
+
+    // Internal state. Do not access outside of critical section.
+    std::list<Entry> mEntries;                    ///< All jobs that have not been retired in order of submission.
+    std::queue<Entry*> mPendingEntries;           ///< Jobs waiting to be executed.
+    size_t mMemoryBudget;
+    Stats mStats;
+    bool mTerminate = false;
+};
+} // namespace Falcor
@@ -0,0 +1,634 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "MipGenerator.h"
+#include "Core/Errors.h"
+#include "Utils/Threading.h"
+#include "Utils/Math/Float16.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Falcor
+{
+namespace
+{
+/// Approximate number of destination texels filtered per task.
+const size_t kTexelsPerTask = 64 * 1024;
+
+/// Radius of the Kaiser filter in destination texels and shape parameter of the window.
+const float kKaiserRadius = 3.f;
+const float kKaiserAlpha = 4.f;
+
+/// Number of binary search steps for finding the alpha reference value that preserves coverage.
+const uint32_t kCoverageSearchSteps = 12;
+
+/// Size of the table used for encoding linear values to 8-bit sRGB.
+const uint32_t kSrgbEncodeTableSize = 1 << 16;
+
+enum class ChannelType
+{
+    Unorm8,
+    Unorm16,
+    Float16,
+    Float32,
+};
+
+struct Layout
+{
+    ChannelType type = ChannelType::Unorm8;
+    uint32_t channelCount = 0;
+    uint32_t bytesPerTexel = 0;
+    uint32_t srgbChannelCount = 0; ///< Number of leading channels that are sRGB encoded.
+    int32_t alphaChannel = -1;     ///< Index of the alpha channel, or -1 if there is none.
+};
+
+bool getChannelType(ResourceFormat format, ChannelType& type)
+{
+    if (format == ResourceFormat::Unknown || isCompressedFormat(format) || isDepthStencilFormat(format))
+        return false;
+
+    // Only formats where all channels have the same size and there is no padding are supported.
+    const uint32_t channelCount = getFormatChannelCount(format);
+    const uint32_t bits = getNumChannelBits(format, 0);
+    if (channelCount == 0 || getFormatBytesPerBlock(format) * 8 != bits * channelCount)
+        return false;
+    for (uint32_t i = 1; i < channelCount; ++i)
+    {
+        if (getNumChannelBits(format, (int)i) != bits)
+            return false;
+    }
+
+    switch (getFormatType(format))
+    {
+    case FormatType::Unorm:
+    case FormatType::UnormSrgb:
+        if (bits == 8 || bits == 16)
+        {
+            type = bits == 8 ? ChannelType::Unorm8 : ChannelType::Unorm16;
+            return true;
+        }
+        return false;
+    case FormatType::Float:
+        if (bits == 16 || bits == 32)
+        {
+            type = bits == 16 ? ChannelType::Float16 : ChannelType::Float32;
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+Layout getLayout(ResourceFormat format, const MipGenerator::Options& options)
+{
+    Layout layout;
+    if (!getChannelType(format, layout.type))
+        throw ArgumentError("Can't generate mips for texture format '{}'.", to_string(format));
+
+    layout.channelCount = getFormatChannelCount(format);
+    layout.bytesPerTexel = getFormatBytesPerBlock(format);
+    if (doesFormatHaveAlpha(format))
+        layout.alphaChannel = 3;
+
+    // sRGB encoding only exists for 8-bit formats with color channels.
+    bool srgb = isSrgbFormat(format) ||
+                (options.srgb && layout.type == ChannelType::Unorm8 && isSrgbFormat(linearToSrgbFormat(format)));
+    if (srgb)
+        layout.srgbChannelCount = std::min(layout.channelCount, 3u);
+
+    return layout;
+}
+
+float srgbToLinear(float v)
+{
+    return v <= 0.04045f ? v * (1.f / 12.92f) : std::pow((v + 0.055f) * (1.f / 1.055f), 2.4f);
+}
+
+float linearToSrgb(float v)
+{
+    return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.f / 2.4f) - 0.055f;
+}
+
+float saturate(float v)
+{
+    return std::min(std::max(v, 0.f), 1.f);
+}
+
+struct SrgbTables
+{
+    float decode[256];
+    std::vector<uint8_t> encode; ///< 8-bit sRGB values indexed by linear values quantized to kSrgbEncodeTableSize levels.
+
+    SrgbTables() : encode(kSrgbEncodeTableSize)
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+            decode[i] = srgbToLinear(i / 255.f);
+        for (uint32_t i = 0; i < kSrgbEncodeTableSize; ++i)
+            encode[i] = (uint8_t)(linearToSrgb(i / float(kSrgbEncodeTableSize - 1)) * 255.f + 0.5f);
+    }
+};
+
+const SrgbTables& getSrgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+/**
+ * Converts texels to linear floats.
+ */
+class Decoder
+{
+public:
+    Decoder(const Layout& layout) : mLayout(layout)
+    {
+        // One lookup table per channel for 8-bit formats, so that sRGB and linear channels are decoded the same way.
+        if (layout.type == ChannelType::Unorm8)
+        {
+            const auto& srgbTables = getSrgbTables();
+            for (uint32_t c = 0; c < layout.channelCount; ++c)
+            {
+                for (uint32_t i = 0; i < 256; ++i)
+                    mTables[c][i] = c < layout.srgbChannelCount ? srgbTables.decode[i] : i * (1.f / 255.f);
+            }
+        }
+    }
+
+    void decode(const uint8_t* pSrc, size_t texelCount, float* pDst) const
+    {
+        const uint32_t channelCount = mLayout.channelCount;
+        const size_t valueCount = texelCount * channelCount;
+        switch (mLayout.type)
+        {
+        case ChannelType::Unorm8:
+            for (size_t i = 0; i < texelCount; ++i)
+            {
+                for (uint32_t c = 0; c < channelCount; ++c)
+                    pDst[i * channelCount + c] = mTables[c][pSrc[i * channelCount + c]];
+            }
+            break;
+        case ChannelType::Unorm16:
+        {
+            const uint16_t* pValues = reinterpret_cast<const uint16_t*>(pSrc);
+            for (size_t i = 0; i < valueCount; ++i)
+                pDst[i] = pValues[i] * (1.f / 65535.f);
+            break;
+        }
+        case ChannelType::Float16:
+        {
+            const uint16_t* pValues = reinterpret_cast<const uint16_t*>(pSrc);
+            for (size_t i = 0; i < valueCount; ++i)
+                pDst[i] = math::float16ToFloat32(pValues[i]);
+            break;
+        }
+        case ChannelType::Float32:
+            std::copy_n(reinterpret_cast<const float*>(pSrc), valueCount, pDst);
+            break;
+        }
+    }
+
+private:
+    Layout mLayout;
+    float mTables[4][256];
+};
+
+/**
+ * Decoded rows of a source image, indexed by row modulo the slot count.
+ * Consecutive destination rows use overlapping windows of source rows, so each row is decoded only once per task.
+ */
+struct RowCache
+{
+    size_t rowSize;
+    std::vector<float> data;
+    std::vector<size_t> rows;
+
+    RowCache(size_t rowSize, size_t slotCount) : rowSize(rowSize), data(rowSize * slotCount), rows(slotCount, SIZE_MAX) {}
+};
+
+/**
+ * Source rows stored as linear floats.
+ */
+struct FloatRows
+{
+    const float* pData;
+    size_t rowSize;
+
+    const float* getRow(size_t y, RowCache& cache) const { return pData + y * rowSize; }
+};
+
+/**
+ * Source rows stored in the texture format. Rows are decoded on demand, which avoids converting the whole base level.
+ */
+struct EncodedRows
+{
+    const uint8_t* pData;
+    size_t rowPitch;
+    uint32_t width;
+    const Decoder& decoder;
+
+    const float* getRow(size_t y, RowCache& cache) const
+    {
+        const size_t slot = y % cache.rows.size();
+        float* pRow = cache.data.data() + slot * cache.rowSize;
+        if (cache.rows[slot] != y)
+        {
+            decoder.decode(pData + y * rowPitch, width, pRow);
+            cache.rows[slot] = y;
+        }
+        return pRow;
+    }
+};
+
+/**
+ * Convert linear floats back to texels. Values of unorm formats are clamped to [0,1].
+ */
+void encodeTexels(const float* pSrc, size_t texelCount, const Layout& layout, float alphaScale, uint8_t* pDst)
+{
+    const uint32_t channelCount = layout.channelCount;
+    float scale[4] = {1.f, 1.f, 1.f, 1.f};
+    if (layout.alphaChannel >= 0)
+        scale[layout.alphaChannel] = alphaScale;
+
+    switch (layout.type)
+    {
+    case ChannelType::Unorm8:
+    {
+        const auto& encode = getSrgbTables().encode;
+        for (size_t i = 0; i < texelCount; ++i)
+        {
+            for (uint32_t c = 0; c < channelCount; ++c)
+            {
+                const float v = saturate(pSrc[i * channelCount + c] * scale[c]);
+                pDst[i * channelCount + c] =
+                    c < layout.srgbChannelCount ? encode[(uint32_t)(v * (kSrgbEncodeTableSize - 1) + 0.5f)] : (uint8_t)(v * 255.f + 0.5f);
+            }
+        }
+        break;
+    }
+    case ChannelType::Unorm16:
+    {
+        uint16_t* pValues = reinterpret_cast<uint16_t*>(pDst);
+        for (size_t i = 0; i < texelCount; ++i)
+        {
+            for (uint32_t c = 0; c < channelCount; ++c)
+                pValues[i * channelCount + c] = (uint16_t)(saturate(pSrc[i * channelCount + c] * scale[c]) * 65535.f + 0.5f);
+        }
+        break;
+    }
+    case ChannelType::Float16:
+    {
+        uint16_t* pValues = reinterpret_cast<uint16_t*>(pDst);
+        for (size_t i = 0; i < texelCount; ++i)
+        {
+            for (uint32_t c = 0; c < channelCount; ++c)
+            {
+                float v = pSrc[i * channelCount + c] * scale[c];
+                pValues[i * channelCount + c] = math::float32ToFloat16((int32_t)c == layout.alphaChannel && alphaScale != 1.f ? saturate(v) : v);
+            }
+        }
+        break;
+    }
+    case ChannelType::Float32:
+    {
+        float* pValues = reinterpret_cast<float*>(pDst);
+        for (size_t i = 0; i < texelCount; ++i)
+        {
+            for (uint32_t c = 0; c < channelCount; ++c)
+            {
+                float v = pSrc[i * channelCount + c] * scale[c];
+                pValues[i * channelCount + c] = (int32_t)c == layout.alphaChannel && alphaScale != 1.f ? saturate(v) : v;
+            }
+        }
+        break;
+    }
+    }
+}
+
+/**
+ * Filter weights for resampling one dimension.
+ * Every destination texel uses the same number of taps. Unused taps have zero weight.
+ */
+struct FilterKernel
+{
+    uint32_t tapCount = 0;
+    std::vector<uint32_t> indices; ///< Source texel index for each destination texel and tap.
+    std::vector<float> weights;    ///< Normalized weight for each destination texel and tap.
+};
+
+float besselI0(float x)
+{
+    // Power series. Converges quickly for the small arguments used by the Kaiser window.
+    const float halfX2 = 0.25f * x * x;
+    float sum = 1.f;
+    float term = 1.f;
+    for (int k = 1; k < 32 && term > 1e-8f * sum; ++k)
+    {
+        term *= halfX2 / float(k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+float evalKaiser(float x)
+{
+    const float t = x / kKaiserRadius;
+    if (std::abs(t) >= 1.f)
+        return 0.f;
+    const float px = float(M_PI) * x;
+    const float sinc = std::abs(px) < 1e-4f ? 1.f : std::sin(px) / px;
+    return sinc * besselI0(kKaiserAlpha * std::sqrt(1.f - t * t)) / besselI0(kKaiserAlpha);
+}
+
+FilterKernel createKernel(uint32_t srcSize, uint32_t dstSize, MipGenerator::Filter filter)
+{
+    FALCOR_ASSERT(dstSize > 0 && dstSize <= srcSize);
+
+    // Compute weights of all source texels covered by the filter footprint, in source texel units.
+    const float scale = float(srcSize) / float(dstSize);
+    const float radius = (filter == MipGenerator::Filter::Box ? 0.5f : kKaiserRadius) * scale;
+
+    std::vector<int32_t> firsts(dstSize);
+    std::vector<std::vector<float>> texelWeights(dstSize);
+    uint32_t tapCount = 1;
+    for (uint32_t i = 0; i < dstSize; ++i)
+    {
+        const float center = (i + 0.5f) * scale;
+        int32_t first = (int32_t)std::floor(center - radius);
+        int32_t last = (int32_t)std::ceil(center + radius);
+        auto& w = texelWeights[i];
+        for (int32_t j = first; j < last; ++j)
+        {
+            if (filter == MipGenerator::Filter::Box)
+                w.push_back(std::max(0.f, std::min(j + 1.f, center + radius) - std::max(float(j), center - radius)));
+            else
+                w.push_back(evalKaiser((j + 0.5f - center) / scale));
+        }
+
+        // Trim taps with zero weight.
+        while (!w.empty() && w.back() == 0.f)
+            w.pop_back();
+        auto nonZero = std::find_if(w.begin(), w.end(), [](float v) { return v != 0.f; });
+        first += (int32_t)(nonZero - w.begin());
+        w.erase(w.begin(), nonZero);
+
+        firsts[i] = first;
+        tapCount = std::max(tapCount, (uint32_t)w.size());
+    }
+
+    FilterKernel kernel;
+    kernel.tapCount = tapCount;
+    kernel.indices.resize(size_t(dstSize) * tapCount);
+    kernel.weights.resize(size_t(dstSize) * tapCount, 0.f);
+    for (uint32_t i = 0; i < dstSize; ++i)
+    {
+        const auto& w = texelWeights[i];
+        float sum = 0.f;
+        for (float v : w)
+            sum += v;
+        for (uint32_t t = 0; t < tapCount; ++t)
+        {
+            // Clamp to edge. Padding taps point to a valid texel and have zero weight.
+            const int32_t j = firsts[i] + (int32_t)t;
+            kernel.indices[i * tapCount + t] = (uint32_t)std::clamp(j, 0, (int32_t)srcSize - 1);
+            if (t < w.size())
+                kernel.weights[i * tapCount + t] = sum != 0.f ? w[t] / sum : 0.f;
+        }
+    }
+    return kernel;
+}
+
+template<uint32_t C>
+void filterRow(const float* pSrcRow, float* pDstRow, uint32_t dstWidth, const FilterKernel& kernel)
+{
+    for (uint32_t x = 0; x < dstWidth; ++x)
+    {
+        const uint32_t* indices = &kernel.indices[size_t(x) * kernel.tapCount];
+        const float* weights = &kernel.weights[size_t(x) * kernel.tapCount];
+        float sum[C] = {};
+        for (uint32_t t = 0; t < kernel.tapCount; ++t)
+        {
+            const float* pTexel = pSrcRow + size_t(indices[t]) * C;
+            for (uint32_t c = 0; c < C; ++c)
+                sum[c] += weights[t] * pTexel[c];
+        }
+        for (uint32_t c = 0; c < C; ++c)
+            pDstRow[size_t(x) * C + c] = sum[c];
+    }
+}
+
+/**
+ * Resample an image with separable filters. The vertical pass runs first over full rows, which keeps the inner loop
+ * contiguous and lets the compiler vectorize it.
+ */
+template<typename RowSource>
+void downsample(
+    const RowSource& src,
+    uint32_t srcWidth,
+    float* pDst,
+    uint32_t dstWidth,
+    uint32_t dstHeight,
+    uint32_t channelCount,
+    const FilterKernel& kernelX,
+    const FilterKernel& kernelY
+)
+{
+    const size_t srcRowSize = size_t(srcWidth) * channelCount;
+    const size_t dstRowSize = size_t(dstWidth) * channelCount;
+
+    auto processRows = [&](size_t begin, size_t end)
+    {
+        std::vector<float> row(srcRowSize);
+        RowCache cache(srcRowSize, kernelY.tapCount);
+        for (size_t y = begin; y < end; ++y)
+        {
+            // Vertical pass into a temporary row at source width.
+            float* pRow = row.data();
+            std::fill(row.begin(), row.end(), 0.f);
+            for (uint32_t t = 0; t < kernelY.tapCount; ++t)
+            {
+                const float w = kernelY.weights[y * kernelY.tapCount + t];
+                if (w == 0.f)
+                    continue;
+                const float* pSrcRow = src.getRow(kernelY.indices[y * kernelY.tapCount + t], cache);
+                for (size_t i = 0; i < srcRowSize; ++i)
+                    pRow[i] += w * pSrcRow[i];
+            }
+
+            // Horizontal pass.
+            float* pDstRow = pDst + y * dstRowSize;
+            switch (channelCount)
+            {
+            case 1:
+                filterRow<1>(pRow, pDstRow, dstWidth, kernelX);
+                break;
+            case 2:
+                filterRow<2>(pRow, pDstRow, dstWidth, kernelX);
+                break;
+            case 3:
+                filterRow<3>(pRow, pDstRow, dstWidth, kernelX);
+                break;
+            case 4:
+                filterRow<4>(pRow, pDstRow, dstWidth, kernelX);
+                break;
+            default:
+                FALCOR_UNREACHABLE();
+            }
+        }
+    };
+
+    const size_t grainSize = std::max<size_t>(1, kTexelsPerTask / dstWidth);
+    Threading::parallelForChunked(0, dstHeight, processRows, grainSize);
+}
+
+/**
+ * Gather the alpha channel of an image into a contiguous array.
+ */
+std::vector<float> gatherAlpha(const float* pData, size_t texelCount, const Layout& layout)
+{
+    std::vector<float> alpha(texelCount);
+    for (size_t i = 0; i < texelCount; ++i)
+        alpha[i] = pData[i * layout.channelCount + layout.alphaChannel];
+    return alpha;
+}
+
+float computeBaseAlphaCoverage(const EncodedRows& src, uint32_t height, const Layout& layout, float alphaReference)
+{
+    size_t count = 0;
+    RowCache cache(size_t(src.width) * layout.channelCount, 1);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const float* pRow = src.getRow(y, cache);
+        for (uint32_t x = 0; x < src.width; ++x)
+            count += pRow[size_t(x) * layout.channelCount + layout.alphaChannel] > alphaReference ? 1 : 0;
+    }
+    return float(count) / float(size_t(src.width) * height);
+}
+
+float computeAlphaCoverage(const std::vector<float>& alpha, float alphaReference)
+{
+    size_t count = 0;
+    for (float a : alpha)
+        count += a > alphaReference ? 1 : 0;
+    return float(count) / float(alpha.size());
+}
+
+/**
+ * Find the alpha scale for a mip level so that its coverage at the given reference matches the target coverage.
+ * Searches for the reference value that yields the target coverage and scales alpha to map it to the actual reference.
+ */
+float findAlphaScale(const std::vector<float>& alpha, float alphaReference, float targetCoverage)
+{
+    float lo = 0.f;
+    float hi = 1.f;
+    for (uint32_t i = 0; i < kCoverageSearchSteps; ++i)
+    {
+        const float mid = 0.5f * (lo + hi);
+        if (computeAlphaCoverage(alpha, mid) > targetCoverage)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    const float reference = 0.5f * (lo + hi);
+    return alphaReference / reference;
+}
+} // namespace
+
+bool MipGenerator::isFormatSupported(ResourceFormat format)
+{
+    ChannelType type;
+    return getChannelType(format, type);
+}
+
+uint32_t MipGenerator::getMipCount(uint32_t width, uint32_t height)
+{
+    uint32_t count = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+        count++;
+    return count;
+}
+
+std::vector<Bitmap::UniqueConstPtr> MipGenerator::generateMips(const Bitmap& base, const Options& options)
+{
+    const Layout layout = getLayout(base.getFormat(), options);
+    const uint32_t channelCount = layout.channelCount;
+    const Decoder decoder(layout);
+    const EncodedRows baseRows{base.getData(), base.getRowPitch(), base.getWidth(), decoder};
+
+    uint32_t width = base.getWidth();
+    uint32_t height = base.getHeight();
+
+    // Coverage is only preserved if the base level is partially covered.
+    float targetCoverage = 0.f;
+    bool preserveAlphaCoverage = options.preserveAlphaCoverage && layout.alphaChannel >= 0;
+    if (preserveAlphaCoverage)
+    {
+        targetCoverage = computeBaseAlphaCoverage(baseRows, height, layout, options.alphaReference);
+        preserveAlphaCoverage = targetCoverage > 0.f && targetCoverage < 1.f;
+    }
+
+    const uint32_t mipCount = getMipCount(width, height);
+    std::vector<Bitmap::UniqueConstPtr> mips;
+    mips.reserve(mipCount - 1);
+
+    std::vector<float> src;
+    std::vector<float> dst;
+    std::vector<uint8_t> texels;
+    for (uint32_t mip = 1; mip < mipCount; ++mip)
+    {
+        const uint32_t dstWidth = std::max(width / 2, 1u);
+        const uint32_t dstHeight = std::max(height / 2, 1u);
+        const size_t texelCount = size_t(dstWidth) * dstHeight;
+
+        // Each level is filtered from the unscaled previous level, so alpha scaling does not accumulate.
+        // The first level reads the base level directly.
+        const FilterKernel kernelX = createKernel(width, dstWidth, options.filter);
+        const FilterKernel kernelY = createKernel(height, dstHeight, options.filter);
+        dst.resize(texelCount * channelCount);
+        if (mip == 1)
+            downsample(baseRows, width, dst.data(), dstWidth, dstHeight, channelCount, kernelX, kernelY);
+        else
+            downsample(FloatRows{src.data(), size_t(width) * channelCount}, width, dst.data(), dstWidth, dstHeight, channelCount, kernelX, kernelY);
+
+        float alphaScale = 1.f;
+        if (preserveAlphaCoverage)
+        {
+            alphaScale = findAlphaScale(gatherAlpha(dst.data(), texelCount, layout), options.alphaReference, targetCoverage);
+        }
+
+        texels.resize(texelCount * layout.bytesPerTexel);
+        encodeTexels(dst.data(), texelCount, layout, alphaScale, texels.data());
+        mips.push_back(Bitmap::create(dstWidth, dstHeight, base.getFormat(), texels.data()));
+
+        std::swap(src, dst);
+        width = dstWidth;
+        height = dstHeight;
+    }
+
+    return mips;
+}
+} // namespace Falcor
@@ -0,0 +1,80 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Bitmap.h"
+#include "Core/Macros.h"
+#include "Core/API/Formats.h"
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * CPU generator for texture mip chains.
+ *
+ * Each mip level is computed from the previous one with a separable filter. Color channels of sRGB textures are
+ * filtered in linear space. Optionally, the alpha channel is rescaled per mip level so that the fraction of texels
+ * passing the alpha test stays the same as in the base level, which keeps alpha-tested geometry from thinning out
+ * in the distance.
+ */
+class FALCOR_API MipGenerator
+{
+public:
+    enum class Filter
+    {
+        Box,    ///< Box filter. Averages 2x2 texels for power-of-two sizes.
+        Kaiser, ///< Kaiser-windowed sinc filter. Sharper than box, but more expensive.
+    };
+
+    struct Options
+    {
+        Filter filter = Filter::Box;
+        bool srgb = false;                  ///< Treat the color channels as sRGB encoded. Always true for sRGB formats.
+        bool preserveAlphaCoverage = false; ///< Rescale alpha to preserve the alpha test coverage of the base level.
+        float alphaReference = 0.5f;        ///< Alpha test reference value used for preserving coverage.
+    };
+
+    /**
+     * Check if mips can be generated for a format. Supports uncompressed formats with 8/16-bit unorm or 16/32-bit float channels.
+     */
+    static bool isFormatSupported(ResourceFormat format);
+
+    /**
+     * Get the number of mip levels of a full mip chain, including the base level.
+     */
+    static uint32_t getMipCount(uint32_t width, uint32_t height);
+
+    /**
+     * Generate a full mip chain down to 1x1 texels. Mip level i has size max(1, width >> i) x max(1, height >> i).
+     * Throws if the format is not supported.
+     * @param[in] base Base level.
+     * @param[in] options Options.
+     * @return Mip levels 1 to getMipCount() - 1. The base level is not included.
+     */
+    static std::vector<Bitmap::UniqueConstPtr> generateMips(const Bitmap& base, const Options& options);
+};
+} // namespace Falcor
@@ -0,0 +1,360 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "NpzWriter.h"
+#include "npy.h"
+#include "Core/Assert.h"
+#include "Core/Errors.h"
+#include "Utils/Logger.h"
+#include "Utils/StringFormatters.h"
+#include <zlib.h>
+#include <sstream>
+
+namespace Falcor
+{
+namespace
+{
+const uint32_t kLocalFileHeaderSignature = 0x04034b50;
+const uint32_t kCentralDirectoryHeaderSignature = 0x02014b50;
+const uint32_t kEndOfCentralDirectorySignature = 0x06054b50;
+
+const size_t kLocalFileHeaderSize = 30;
+const size_t kCentralDirectoryHeaderSize = 46;
+const size_t kEndOfCentralDirectorySize = 22;
+
+const uint16_t kVersion = 20;           ///< Version 2.0 (required for deflate).
+const uint16_t kMethodStored = 0;
+const uint16_t kMethodDeflated = 8;
+const uint16_t kDosDate = (1 << 5) | 1; ///< 1980-01-01, time stamps are not used.
+
+/**
+ * Helper for writing little-endian zip records.
+ */
+class RecordWriter
+{
+public:
+    void u16(uint16_t v)
+    {
+        mData.push_back(uint8_t(v));
+        mData.push_back(uint8_t(v >> 8));
+    }
+
+    void u32(uint32_t v)
+    {
+        u16(uint16_t(v));
+        u16(uint16_t(v >> 16));
+    }
+
+    void bytes(const std::string& str) { mData.insert(mData.end(), str.begin(), str.end()); }
+
+    const std::vector<uint8_t>& getData() const { return mData; }
+
+private:
+    std::vector<uint8_t> mData;
+};
+
+std::string getFileName(const std::string& name)
+{
+    return name + ".npy";
+}
+
+/**
+ * Deflate a list of buffers into a single raw deflate stream (as stored in zip archives).
+ */
+std::vector<uint8_t> deflateBuffers(const std::vector<std::pair<const uint8_t*, size_t>>& buffers)
+{
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw RuntimeError("Failed to initialize deflate stream.");
+
+    size_t totalSize = 0;
+    for (const auto& [pData, size] : buffers)
+        totalSize += size;
+
+    std::vector<uint8_t> result(deflateBound(&stream, (uLong)totalSize));
+    stream.next_out = result.data();
+    stream.avail_out = (uInt)result.size();
+
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+        stream.next_in = const_cast<Bytef*>(buffers[i].first);
+        stream.avail_in = (uInt)buffers[i].second;
+        int flush = i + 1 == buffers.size() ? Z_FINISH : Z_NO_FLUSH;
+        int ret = deflate(&stream, flush);
+        if (ret == Z_STREAM_ERROR || (flush == Z_FINISH && ret != Z_STREAM_END))
+        {
+            deflateEnd(&stream);
+            throw RuntimeError("Failed to deflate data.");
+        }
+    }
+
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result;
+}
+} // namespace
+
+NpzWriter::NpzWriter(const std::filesystem::path& path) : mPath(path), mIndexSize(kEndOfCentralDirectorySize)
+{
+    mStream.open(path, std::ios::binary | std::ios::trunc);
+    if (!mStream)
+        throw RuntimeError("Failed to create archive '{}'.", path);
+}
+
+NpzWriter::~NpzWriter()
+{
+    // Call close() explicitly to handle write errors, a destructor must not throw.
+    try
+    {
+        close();
+    }
+    catch (const std::exception& e)
+    {
+        logError("{}", e.what());
+    }
+}
+
+NpzWriter::EncodedArray NpzWriter::encodeArray(
+    const std::string& name,
+    const std::string& descr,
+    const std::vector<unsigned long>& shape,
+    const void* pData,
+    size_t size,
+    bool compress
+)
+{
+    npy::dtype_t dtype = npy::parse_descr(descr);
+    if (size != npy::comp_size(shape) * dtype.itemsize)
+        throw ArgumentError("Array '{}' data size ({} bytes) does not match its shape and type.", name, size);
+
+    std::ostringstream headerStream;
+    npy::write_header(headerStream, npy::header_t{dtype, false, shape});
+    const std::string header = headerStream.str();
+
+    EncodedArray array;
+    array.name = name;
+    uint64_t uncompressedSize = header.size() + size;
+    if (uncompressedSize > kMaxArchiveSize)
+        throw ArgumentError("Array '{}' is too large to be stored in an archive.", name);
+    array.uncompressedSize = (uint32_t)uncompressedSize;
+
+    uLong crc = ::crc32(0L, Z_NULL, 0);
+    crc = ::crc32(crc, reinterpret_cast<const Bytef*>(header.data()), (uInt)header.size());
+    crc = ::crc32(crc, reinterpret_cast<const Bytef*>(pData), (uInt)size);
+    array.crc32 = (uint32_t)crc;
+
+    const uint8_t* pHeader = reinterpret_cast<const uint8_t*>(header.data());
+    const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+    if (compress)
+    {
+        array.data = deflateBuffers({{pHeader, header.size()}, {pBytes, size}});
+        array.compressed = true;
+    }
+
+    // Store the data uncompressed if compression is disabled or doesn't help.
+    if (!compress || array.data.size() >= uncompressedSize)
+    {
+        array.data.clear();
+        array.data.reserve(uncompressedSize);
+        array.data.insert(array.data.end(), pHeader, pHeader + header.size());
+        array.data.insert(array.data.end(), pBytes, pBytes + size);
+        array.compressed = false;
+    }
+
+    return array;
+}
+
+uint64_t NpzWriter::getStoredSize(const EncodedArray& array)
+{
+    return kLocalFileHeaderSize + getFileName(array.name).size() + array.data.size();
+}
+
+uint64_t NpzWriter::getIndexEntrySize(const EncodedArray& array)
+{
+    return kCentralDirectoryHeaderSize + getFileName(array.name).size();
+}
+
+bool NpzWriter::canAppend(const EncodedArray& array) const
+{
+    if (mClosed || mEntries.size() >= kMaxArrayCount)
+        return false;
+
+    // The archive must fit in 32-bit offsets including the index.
+    return mOffset + getStoredSize(array) + mIndexSize + getIndexEntrySize(array) <= kMaxArchiveSize;
+}
+
+void NpzWriter::append(const EncodedArray& array)
+{
+    if (!canAppend(array))
+        throw RuntimeError("Array '{}' does not fit into archive '{}'.", array.name, mPath);
+
+    Entry entry;
+    entry.fileName = getFileName(array.name);
+    entry.crc32 = array.crc32;
+    entry.compressedSize = (uint32_t)array.data.size();
+    entry.uncompressedSize = array.uncompressedSize;
+    entry.compressionMethod = array.compressed ? kMethodDeflated : kMethodStored;
+    entry.offset = (uint32_t)mOffset;
+
+    RecordWriter header;
+    header.u32(kLocalFileHeaderSignature);
+    header.u16(kVersion);
+    header.u16(0); // flags
+    header.u16(entry.compressionMethod);
+    header.u16(0); // time
+    header.u16(kDosDate);
+    header.u32(entry.crc32);
+    header.u32(entry.compressedSize);
+    header.u32(entry.uncompressedSize);
+    header.u16((uint16_t)entry.fileName.size());
+    header.u16(0); // extra field length
+    header.bytes(entry.fileName);
+    FALCOR_ASSERT(header.getData().size() == kLocalFileHeaderSize + entry.fileName.size());
+
+    mStream.write(reinterpret_cast<const char*>(header.getData().data()), header.getData().size());
+    mStream.write(reinterpret_cast<const char*>(array.data.data()), array.data.size());
+    if (!mStream)
+        throw RuntimeError("Failed to write to archive '{}'.", mPath);
+
+    mOffset += getStoredSize(array);
+    mIndexSize += getIndexEntrySize(array);
+    mEntries.push_back(std::move(entry));
+}
+
+void NpzWriter::close()
+{
+    if (mClosed)
+        return;
+    mClosed = true;
+
+    RecordWriter index;
+    for (const auto& entry : mEntries)
+    {
+        index.u32(kCentralDirectoryHeaderSignature);
+        index.u16(kVersion); // version made by
+        index.u16(kVersion); // version needed to extract
+        index.u16(0);        // flags
+        index.u16(entry.compressionMethod);
+        index.u16(0); // time
+        index.u16(kDosDate);
+        index.u32(entry.crc32);
+        index.u32(entry.compressedSize);
+        index.u32(entry.uncompressedSize);
+        index.u16((uint16_t)entry.fileName.size());
+        index.u16(0); // extra field length
+        index.u16(0); // comment length
+        index.u16(0); // disk number
+        index.u16(0); // internal attributes
+        index.u32(0); // external attributes
+        index.u32(entry.offset);
+        index.bytes(entry.fileName);
+    }
+    uint32_t indexSize = (uint32_t)index.getData().size();
+    FALCOR_ASSERT(indexSize + kEndOfCentralDirectorySize == mIndexSize);
+
+    index.u32(kEndOfCentralDirectorySignature);
+    index.u16(0); // disk number
+    index.u16(0); // disk with the central directory
+    index.u16((uint16_t)mEntries.size());
+    index.u16((uint16_t)mEntries.size());
+    index.u32(indexSize);
+    index.u32((uint32_t)mOffset);
+    index.u16(0); // comment length
+
+    mStream.write(reinterpret_cast<const char*>(index.getData().data()), index.getData().size());
+    mStream.close();
+    if (!mStream)
+        throw RuntimeError("Failed to write to archive '{}'.", mPath);
+}
+
+ShardedNpzWriter::ShardedNpzWriter(const std::filesystem::path& directory, const std::string& prefix, uint64_t maxShardSize)
+    : mDirectory(directory), mPrefix(prefix), mMaxShardSize(std::min(maxShardSize, NpzWriter::kMaxArchiveSize))
+{
+    if (!mDirectory.empty())
+        std::filesystem::create_directories(mDirectory);
+}
+
+ShardedNpzWriter::~ShardedNpzWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (const std::exception& e)
+    {
+        logError("{}", e.what());
+    }
+}
+
+void ShardedNpzWriter::append(uint64_t sampleIndex, const std::vector<NpzWriter::EncodedArray>& arrays)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Start a new shard if the sample doesn't fit into the current one. The size limit applies to the
+    // closed shard, so it includes the index entries of all arrays.
+    if (mpShard)
+    {
+        uint64_t sampleSize = 0;
+        bool fits = mpShard->getArrayCount() + arrays.size() <= NpzWriter::kMaxArrayCount;
+        for (const auto& array : arrays)
+            sampleSize += NpzWriter::getStoredSize(array) + NpzWriter::getIndexEntrySize(array);
+        fits = fits && mpShard->getSize() + mpShard->getIndexSize() + sampleSize <= mMaxShardSize;
+        if (!fits)
+        {
+            // Close the full shard explicitly, so write errors are reported to the caller.
+            auto pShard = std::move(mpShard);
+            pShard->close();
+        }
+    }
+
+    if (!mpShard)
+    {
+        // Never overwrite the shards of an earlier export, e.g. after the sample index was reset.
+        auto path = mDirectory / fmt::format("{}_{}.npz", mPrefix, sampleIndex);
+        for (uint32_t i = 1; std::filesystem::exists(path); i++)
+            path = mDirectory / fmt::format("{}_{}_{}.npz", mPrefix, sampleIndex, i);
+        mpShard = std::make_unique<NpzWriter>(path);
+        mShardCount++;
+    }
+
+    for (const auto& array : arrays)
+        mpShard->append(array);
+}
+
+void ShardedNpzWriter::close()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (auto pShard = std::move(mpShard))
+        pShard->close();
+}
+
+uint32_t ShardedNpzWriter::getShardCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mShardCount;
+}
+} // namespace Falcor
@@ -0,0 +1,208 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Writer for numpy .npz archives, i.e. zip archives of .npy files that can be read with numpy.load().
+ *
+ * Arrays are first encoded (and optionally compressed) with encodeArray(), which does not touch the archive
+ * and can run on any thread. The encoded arrays are then appended to the archive. The archive index
+ * (the zip central directory) is written when the archive is closed.
+ * The zip64 extensions are not used, so an archive is limited to kMaxArrayCount arrays and kMaxArchiveSize bytes.
+ */
+class FALCOR_API NpzWriter
+{
+public:
+    static constexpr size_t kMaxArrayCount = 0xffff;
+    static constexpr uint64_t kMaxArchiveSize = 0xffffffffull;
+
+    /**
+     * An array encoded as a .npy file ready to be stored in an archive.
+     */
+    struct EncodedArray
+    {
+        std::string name;              ///< Name of the array (file name in the archive without the .npy extension).
+        std::vector<uint8_t> data;     ///< Encoded .npy file data, deflated if compressed is set.
+        uint32_t crc32 = 0;            ///< CRC-32 of the uncompressed .npy file.
+        uint32_t uncompressedSize = 0; ///< Size of the uncompressed .npy file in bytes.
+        bool compressed = false;       ///< True if the data is deflated.
+    };
+
+    /**
+     * Create an archive. Throws an exception if the file cannot be created.
+     * @param[in] path File path of the archive.
+     */
+    NpzWriter(const std::filesystem::path& path);
+
+    /**
+     * Destructor. Closes the archive if it is still open. Write errors are logged, call close() to handle them.
+     */
+    ~NpzWriter();
+
+    NpzWriter(const NpzWriter&) = delete;
+    NpzWriter& operator=(const NpzWriter&) = delete;
+
+    /**
+     * Encode an array as a .npy file.
+     * @param[in] name Name of the array.
+     * @param[in] descr Numpy type descriptor of the array elements (e.g. "<f4").
+     * @param[in] shape Shape of the array in C order.
+     * @param[in] pData Array data.
+     * @param[in] size Size of the array data in bytes.
+     * @param[in] compress Deflate the encoded data.
+     * @return The encoded array.
+     */
+    static EncodedArray encodeArray(
+        const std::string& name,
+        const std::string& descr,
+        const std::vector<unsigned long>& shape,
+        const void* pData,
+        size_t size,
+        bool compress
+    );
+
+    /**
+     * Get the size of an encoded array when stored in an archive in bytes, not including its entry in the archive index.
+     */
+    static uint64_t getStoredSize(const EncodedArray& array);
+
+    /**
+     * Get the size of the entry of an encoded array in the archive index in bytes.
+     */
+    static uint64_t getIndexEntrySize(const EncodedArray& array);
+
+    /**
+     * Check if an array fits into the archive.
+     */
+    bool canAppend(const EncodedArray& array) const;
+
+    /**
+     * Append an encoded array to the archive. Throws an exception if the array does not fit (see canAppend()).
+     */
+    void append(const EncodedArray& array);
+
+    /**
+     * Write the archive index and close the file. Throws an exception if writing fails.
+     */
+    void close();
+
+    const std::filesystem::path& getPath() const { return mPath; }
+
+    /**
+     * Get the current size of the archive in bytes, not including the index.
+     */
+    uint64_t getSize() const { return mOffset; }
+
+    /**
+     * Get the size of the archive index in bytes, as it would be written if the archive was closed now.
+     */
+    uint64_t getIndexSize() const { return mIndexSize; }
+
+    size_t getArrayCount() const { return mEntries.size(); }
+
+private:
+    struct Entry
+    {
+        std::string fileName;
+        uint32_t crc32;
+        uint32_t compressedSize;
+        uint32_t uncompressedSize;
+        uint16_t compressionMethod;
+        uint32_t offset;
+    };
+
+    std::filesystem::path mPath;
+    std::ofstream mStream;
+    std::vector<Entry> mEntries;
+    uint64_t mOffset = 0;
+    uint64_t mIndexSize = 0;
+    bool mClosed = false;
+};
+
+/**
+ * Writer for a dataset split into multiple .npz archives (shards).
+ * Groups of arrays (samples) are appended to the current shard. A new shard is started when the current one is full.
+ * Shards are named <prefix>_<index of first sample>.npz. If that file already exists, a counter is appended to the
+ * name (<prefix>_<index>_<counter>.npz), so existing shards are never overwritten. This class is thread-safe.
+ */
+class FALCOR_API ShardedNpzWriter
+{
+public:
+    static constexpr uint64_t kDefaultMaxShardSize = 1ull << 31;
+
+    /**
+     * Constructor.
+     * @param[in] directory Directory to create the shards in. It is created if it does not exist.
+     * @param[in] prefix File name prefix of the shards.
+     * @param[in] maxShardSize Maximum file size of a shard in bytes, including its index. Clamped to NpzWriter::kMaxArchiveSize.
+     */
+    ShardedNpzWriter(const std::filesystem::path& directory, const std::string& prefix, uint64_t maxShardSize = kDefaultMaxShardSize);
+
+    /**
+     * Destructor. Closes the current shard. Write errors are logged, call close() to handle them.
+     */
+    ~ShardedNpzWriter();
+
+    /**
+     * Append a sample to the dataset. All arrays of a sample are stored in the same shard.
+     * Throws an exception if writing fails, including the closing of a full shard.
+     * @param[in] sampleIndex Index of the sample, used for naming new shards.
+     * @param[in] arrays Encoded arrays of the sample.
+     */
+    void append(uint64_t sampleIndex, const std::vector<NpzWriter::EncodedArray>& arrays);
+
+    /**
+     * Close the current shard. The next sample starts a new shard. Throws an exception if writing fails.
+     */
+    void close();
+
+    /**
+     * Get the number of shards created so far.
+     */
+    uint32_t getShardCount() const;
+
+private:
+    std::filesystem::path mDirectory;
+    std::string mPrefix;
+    uint64_t mMaxShardSize;
+
+    mutable std::mutex mMutex;
+    std::unique_ptr<NpzWriter> mpShard;
+    uint32_t mShardCount = 0;
+};
+} // namespace Falcor
@@ -0,0 +1,282 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "TextureCache.h"
+#include "Core/Errors.h"
+#include "Core/Platform/OS.h"
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Utils/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace Falcor
+{
+namespace
+{
+/**
+ * Specifies the current cache entry version.
+ * This needs to be incremented every time the entry format or the mip generation changes!
+ */
+const uint32_t kVersion = 1;
+
+/// Texture cache directory (subdirectory in the application data directory).
+const std::string kDirectory = "NVIDIA/Falcor/TextureCache";
+
+/// Fraction of the maximum size the cache is trimmed to when evicting, so that not every write has to evict.
+const double kEvictionTargetFraction = 0.9;
+
+const char* kMagic = "FalcorT$";
+struct Header
+{
+    uint8_t magic[8]{};
+    uint32_t version{};
+    uint32_t format{};
+    uint32_t width{};
+    uint32_t height{};
+    uint32_t mipCount{};
+    uint32_t reserved{};
+    uint64_t dataSize{}; ///< Size of the texel data of all mip levels in bytes.
+
+    bool isValid() const { return std::memcmp(magic, kMagic, sizeof(Header::magic)) == 0 && version == kVersion; }
+};
+
+/// Size of a mip level in bytes. Matches the size of the data held by a Bitmap.
+size_t getMipSize(ResourceFormat format, uint32_t width, uint32_t height)
+{
+    const size_t rowPitch = getFormatRowPitch(format, width);
+    return isCompressedFormat(format) ? rowPitch * (height / getFormatHeightCompressionRatio(format)) : rowPitch * height;
+}
+
+struct EntryInfo
+{
+    std::filesystem::path path;
+    uint64_t size;
+    std::filesystem::file_time_type lastWriteTime;
+};
+
+/// List the cache entries in a directory. Temporary files of writes in progress are skipped.
+std::vector<EntryInfo> listEntries(const std::filesystem::path& directory)
+{
+    std::vector<EntryInfo> entries;
+    std::error_code ec;
+    for (const auto& it : std::filesystem::directory_iterator(directory, ec))
+    {
+        if (!it.is_regular_file(ec) || it.path().extension() == ".tmp")
+            continue;
+        EntryInfo entry{it.path(), it.file_size(ec), it.last_write_time(ec)};
+        if (!ec)
+            entries.push_back(entry);
+    }
+    return entries;
+}
+} // namespace
+
+TextureCache::TextureCache(const std::filesystem::path& directory, uint64_t maxSize) : mDirectory(directory), mMaxSize(maxSize) {}
+
+std::filesystem::path TextureCache::getDefaultDirectory()
+{
+    return getAppDataDirectory() / kDirectory;
+}
+
+TextureCache::Key TextureCache::computeKey(const std::filesystem::path& path, bool generateMips, const MipGenerator::Options& options)
+{
+    MemoryMappedFile file(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan);
+    if (!file.isOpen())
+        throw RuntimeError("Failed to open texture file '{}'.", path);
+
+    SHA1 sha1;
+    sha1.update(kVersion);
+    sha1.update(file.getData(), file.getSize());
+    sha1.update(generateMips);
+    if (generateMips)
+    {
+        sha1.update((uint32_t)options.filter);
+        sha1.update(options.srgb);
+        sha1.update(options.preserveAlphaCoverage);
+        sha1.update(options.alphaReference);
+    }
+    return sha1.finalize();
+}
+
+std::vector<Bitmap::UniqueConstPtr> TextureCache::read(const Key& key) const
+{
+    const auto entryPath = getEntryPath(key);
+    if (!std::filesystem::exists(entryPath))
+        return {};
+
+    MemoryMappedFile file(entryPath, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan);
+    if (!file.isOpen() || file.getSize() < sizeof(Header))
+    {
+        logWarning("Failed to read texture cache entry '{}'.", entryPath);
+        return {};
+    }
+
+    Header header;
+    std::memcpy(&header, file.getData(), sizeof(Header));
+    if (!header.isValid() || header.format == 0 || header.format >= (uint32_t)ResourceFormat::Count || header.mipCount == 0 ||
+        sizeof(Header) + header.dataSize != file.getSize())
+    {
+        logWarning("Texture cache entry '{}' is invalid.", entryPath);
+        return {};
+    }
+
+    const ResourceFormat format = (ResourceFormat)header.format;
+    const uint8_t* pData = reinterpret_cast<const uint8_t*>(file.getData()) + sizeof(Header);
+    const uint8_t* pEnd = pData + header.dataSize;
+
+    std::vector<Bitmap::UniqueConstPtr> mips;
+    mips.reserve(header.mipCount);
+    for (uint32_t mip = 0; mip < header.mipCount; ++mip)
+    {
+        const uint32_t width = std::max(header.width >> mip, 1u);
+        const uint32_t height = std::max(header.height >> mip, 1u);
+        const size_t size = getMipSize(format, width, height);
+        if (size_t(pEnd - pData) < size)
+        {
+            logWarning("Texture cache entry '{}' is truncated.", entryPath);
+            return {};
+        }
+        mips.push_back(Bitmap::create(width, height, format, pData));
+        pData += size;
+    }
+
+    // The modification time tracks the last use of an entry for eviction.
+    std::error_code ec;
+    std::filesystem::last_write_time(entryPath, std::filesystem::file_time_type::clock::now(), ec);
+
+    return mips;
+}
+
+void TextureCache::write(const Key& key, const std::vector<const Bitmap*>& mips) const
+{
+    if (mips.empty())
+        throw ArgumentError("Texture cache entry needs at least one mip level.");
+
+    const Bitmap& base = *mips[0];
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(Header::magic));
+    header.version = kVersion;
+    header.format = (uint32_t)base.getFormat();
+    header.width = base.getWidth();
+    header.height = base.getHeight();
+    header.mipCount = (uint32_t)mips.size();
+    for (uint32_t mip = 0; mip < header.mipCount; ++mip)
+    {
+        const Bitmap& bitmap = *mips[mip];
+        const uint32_t width = std::max(header.width >> mip, 1u);
+        const uint32_t height = std::max(header.height >> mip, 1u);
+        if (bitmap.getFormat() != base.getFormat() || bitmap.getWidth() != width || bitmap.getHeight() != height ||
+            bitmap.getSize() != getMipSize(bitmap.getFormat(), width, height))
+        {
+            throw ArgumentError("Mip level {} of texture cache entry is inconsistent with the base level.", mip);
+        }
+        header.dataSize += bitmap.getSize();
+    }
+
+    const auto entryPath = getEntryPath(key);
+    std::filesystem::create_directories(entryPath.parent_path());
+
+    // Write to a temporary file first and rename it, so that readers never see a partially written entry.
+    auto tempPath = entryPath;
+    tempPath += fmt::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream fs(tempPath, std::ios_base::binary);
+        fs.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        for (const Bitmap* pMip : mips)
+            fs.write(reinterpret_cast<const char*>(pMip->getData()), pMip->getSize());
+        if (!fs)
+        {
+            fs.close();
+            std::filesystem::remove(tempPath);
+            throw RuntimeError("Failed to write texture cache entry '{}'.", entryPath);
+        }
+    }
+    std::filesystem::rename(tempPath, entryPath);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mSizeValid)
+    {
+        mSize = getSize();
+        mSizeValid = true;
+    }
+    else
+    {
+        mSize += sizeof(Header) + header.dataSize;
+    }
+    if (mSize > mMaxSize)
+        mSize = evict(uint64_t(mMaxSize * kEvictionTargetFraction));
+}
+
+void TextureCache::clear() const
+{
+    std::error_code ec;
+    std::filesystem::remove_all(mDirectory, ec);
+    if (ec)
+        logWarning("Failed to clear texture cache '{}': {}", mDirectory, ec.message());
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSizeValid = false;
+}
+
+uint64_t TextureCache::getSize() const
+{
+    uint64_t size = 0;
+    for (const auto& entry : listEntries(mDirectory))
+        size += entry.size;
+    return size;
+}
+
+uint64_t TextureCache::evict(uint64_t targetSize) const
+{
+    auto entries = listEntries(mDirectory);
+    std::sort(entries.begin(), entries.end(), [](const EntryInfo& a, const EntryInfo& b) { return a.lastWriteTime < b.lastWriteTime; });
+
+    uint64_t size = 0;
+    for (const auto& entry : entries)
+        size += entry.size;
+
+    // Remove the least recently used entries first. Entries that can't be removed (e.g. because they are being read) are skipped.
+    for (const auto& entry : entries)
+    {
+        if (size <= targetSize)
+            break;
+        std::error_code ec;
+        if (std::filesystem::remove(entry.path, ec))
+            size -= entry.size;
+    }
+    return size;
+}
+
+std::filesystem::path TextureCache::getEntryPath(const Key& key) const
+{
+    return mDirectory / SHA1::toString(key);
+}
+} // namespace Falcor
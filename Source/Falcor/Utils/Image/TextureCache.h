@@ -0,0 +1,120 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Bitmap.h"
+#include "MipGenerator.h"
+#include "Core/Macros.h"
+#include "Utils/CryptoUtils.h"
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * On-disk cache of decoded and pre-mipped textures.
+ *
+ * Entries are keyed by a hash of the source file contents and the options used for loading the texture, so an entry
+ * stays valid when the source file is moved and is never used after the file contents change. Each entry stores the
+ * texel data of all mip levels in the layout expected by Texture::create2D(), which makes reading it I/O-bound.
+ * Entries may hold block-compressed formats, e.g. when the mips were loaded from DDS files.
+ *
+ * The total size of the cache is limited. When a write exceeds the limit, the least recently used entries are evicted.
+ */
+class FALCOR_API TextureCache
+{
+public:
+    using Key = SHA1::MD;
+
+    /// Default maximum size of the cache in bytes.
+    static constexpr uint64_t kDefaultMaxSize = 8ull << 30;
+
+    /**
+     * Create a texture cache.
+     * @param[in] directory Directory holding the cache entries. Created on first write.
+     * @param[in] maxSize Maximum total size of the cache entries in bytes.
+     */
+    TextureCache(const std::filesystem::path& directory = getDefaultDirectory(), uint64_t maxSize = kDefaultMaxSize);
+
+    /**
+     * Get the default cache directory (subdirectory in the application data directory).
+     */
+    static std::filesystem::path getDefaultDirectory();
+
+    /**
+     * Compute the cache key of a texture.
+     * Throws if the source file can't be read.
+     * @param[in] path Path of the source image file.
+     * @param[in] generateMips True if a mip chain is generated for the texture.
+     * @param[in] options Mip generation options. Ignored if no mips are generated.
+     * @return Cache key.
+     */
+    static Key computeKey(const std::filesystem::path& path, bool generateMips, const MipGenerator::Options& options);
+
+    /**
+     * Read a cache entry. Marks the entry as recently used.
+     * @param[in] key Cache key.
+     * @return All mip levels of the texture, or an empty list if there is no valid entry.
+     */
+    std::vector<Bitmap::UniqueConstPtr> read(const Key& key) const;
+
+    /**
+     * Write a cache entry. Replaces an existing entry atomically, so it is safe to read and write from multiple threads.
+     * Evicts the least recently used entries if the cache exceeds its maximum size.
+     * Throws if the mip levels are inconsistent or the entry can't be written.
+     * @param[in] key Cache key.
+     * @param[in] mips All mip levels of the texture, starting with the base level. Mip level i must have size
+     * max(1, width >> i) x max(1, height >> i) and all levels must have the same format.
+     */
+    void write(const Key& key, const std::vector<const Bitmap*>& mips) const;
+
+    /**
+     * Remove all cache entries.
+     */
+    void clear() const;
+
+    /**
+     * Get the total size of the cache entries in bytes.
+     */
+    uint64_t getSize() const;
+
+    const std::filesystem::path& getDirectory() const { return mDirectory; }
+    uint64_t getMaxSize() const { return mMaxSize; }
+
+private:
+    std::filesystem::path getEntryPath(const Key& key) const;
+    uint64_t evict(uint64_t targetSize) const;
+
+    std::filesystem::path mDirectory;
+    uint64_t mMaxSize;
+
+    mutable std::mutex mMutex;
+    mutable uint64_t mSize = 0;      ///< Size of the cache entries, counted since the last scan of the directory.
+    mutable bool mSizeValid = false; ///< True if mSize was initialized by a scan of the directory.
+};
+} // namespace Falcor
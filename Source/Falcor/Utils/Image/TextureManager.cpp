@@ -28,9 +28,18 @@
 #include "TextureManager.h"
 #include "Core/API/Device.h"
 #include "Utils/Logger.h"
-#include "Utils/NumericRange.h"
-
-#include <execution>
+#include "Utils/Threading.h"
+#include "Utils/Image/Bitmap.h"
+#include "Utils/Image/ImageIO.h"
+#include "Utils/Image/MipGenerator.h"
+#include "Utils/Image/TextureCache.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iterator>
 
 // Temporarily disable asynchronous texture loader until Falcor supports parallel GPU work submission.
 // Until then `TextureManager` should only called from the main thread.
@@ -42,6 +51,206 @@ namespace
 {
 const size_t kMaxTextureHandleCount = std::numeric_limits<uint32_t>::max();
 static_assert(TextureManager::TextureHandle::kInvalidID >= kMaxTextureHandleCount);
+
+/// Image orientation. Matches the orientation used by Texture::createFromFile().
+const bool kTopDown = true;
+
+/// Amount of texture data uploaded during deferred loading before the device is flushed.
+const size_t kMaxUploadBytesBetweenFlushes = 256ull * 1024 * 1024;
+
+/**
+ * Image data decoded on the CPU, ready to be uploaded to a texture.
+ */
+struct DecodedTexture
+{
+    std::vector<Bitmap::UniqueConstPtr> mips; ///< Decoded mip levels. Empty if decoding failed.
+    std::filesystem::path path;               ///< Path to the image file of the first mip level.
+    size_t size = 0;                          ///< Combined size of all mip levels in bytes.
+    bool loadFromFile = false; ///< True if the texture needs to be loaded directly from file (DDS files with their own mip chain).
+    bool fromCache = false;    ///< True if the mip levels were read from the texture cache.
+};
+
+/**
+ * Decode a single image file and generate its mip chain on the CPU if requested and supported by the format.
+ * If a texture cache is given, the result is read from the cache if available and written to it otherwise.
+ */
+void decodeImageFile(
+    DecodedTexture& decoded,
+    const std::filesystem::path& path,
+    bool generateMipLevels,
+    bool loadAsSRGB,
+    const TextureCache* pCache,
+    MipGenerator::Options mipOptions
+)
+{
+    mipOptions.srgb = loadAsSRGB;
+
+    TextureCache::Key key;
+    if (pCache)
+    {
+        try
+        {
+            key = TextureCache::computeKey(path, generateMipLevels, mipOptions);
+            decoded.mips = pCache->read(key);
+            decoded.fromCache = !decoded.mips.empty();
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Failed to read texture cache for '{}': {}", path, e.what());
+            pCache = nullptr;
+        }
+    }
+
+    if (!decoded.fromCache)
+    {
+        auto pBitmap = Bitmap::createFromFile(path, kTopDown);
+        if (!pBitmap)
+            return;
+        decoded.mips.emplace_back(std::move(pBitmap));
+
+        if (generateMipLevels && MipGenerator::isFormatSupported(decoded.mips[0]->getFormat()))
+        {
+            auto mips = MipGenerator::generateMips(*decoded.mips[0], mipOptions);
+            std::move(mips.begin(), mips.end(), std::back_inserter(decoded.mips));
+        }
+    }
+
+    for (const auto& pMip : decoded.mips)
+        decoded.size += pMip->getSize();
+
+    if (pCache && !decoded.fromCache)
+    {
+        try
+        {
+            std::vector<const Bitmap*> mips;
+            for (const auto& pMip : decoded.mips)
+                mips.push_back(pMip.get());
+            pCache->write(key, mips);
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Failed to write texture cache for '{}': {}", path, e.what());
+        }
+    }
+}
+
+/**
+ * Decode the image files of a texture on the CPU. Does not access the device, so it can be called from any thread.
+ * Loading the mip chain from multiple files follows the same rules as Texture::createMippedFromFiles().
+ * The texture cache is only used for textures loaded from a single file.
+ */
+DecodedTexture decodeTexture(
+    const std::vector<std::filesystem::path>& paths,
+    bool generateMipLevels,
+    bool loadAsSRGB,
+    const TextureCache* pCache,
+    const MipGenerator::Options& mipOptions
+)
+{
+    DecodedTexture decoded;
+    decoded.path = paths[0];
+
+    if (paths.size() == 1)
+    {
+        if (hasExtension(paths[0], "dds"))
+        {
+            // DDS files may contain a mip chain, arrays and compressed formats. These are loaded directly in the upload stage.
+            decoded.loadFromFile = true;
+            decoded.size = std::filesystem::file_size(paths[0]);
+        }
+        else
+        {
+            decodeImageFile(decoded, paths[0], generateMipLevels, loadAsSRGB, pCache, mipOptions);
+        }
+        return decoded;
+    }
+
+    for (const auto& path : paths)
+    {
+        Bitmap::UniqueConstPtr pBitmap = hasExtension(path, "dds") ? ImageIO::loadBitmapFromDDS(path) : Bitmap::createFromFile(path, kTopDown);
+        if (!pBitmap)
+        {
+            logWarning("Error loading mip {}. Loading failed for image file '{}'.", decoded.mips.size(), path);
+            break;
+        }
+
+        if (!decoded.mips.empty())
+        {
+            const auto& prev = decoded.mips.back();
+            if (prev->getFormat() != pBitmap->getFormat())
+            {
+                logWarning("Error loading mip {} from file {}. Texture format of all mip levels must match.", decoded.mips.size(), path);
+                break;
+            }
+            if (std::max(prev->getWidth() / 2, 1u) != pBitmap->getWidth() || std::max(prev->getHeight() / 2, 1u) != pBitmap->getHeight())
+            {
+                logWarning(
+                    "Error loading mip {} from file {}. Image resolution must decrease by half. ({}, {}) != ({}, {})/2",
+                    decoded.mips.size(), path, pBitmap->getWidth(), pBitmap->getHeight(), prev->getWidth(), prev->getHeight()
+                );
+                break;
+            }
+        }
+        decoded.size += pBitmap->getSize();
+        decoded.mips.emplace_back(std::move(pBitmap));
+    }
+    return decoded;
+}
+
+/**
+ * Create a texture from decoded image data. Must be called from the thread owning the render context.
+ */
+ref<Texture> createTexture(
+    ref<Device> pDevice,
+    const DecodedTexture& decoded,
+    bool generateMipLevels,
+    bool loadAsSRGB,
+    Resource::BindFlags bindFlags
+)
+{
+    if (decoded.loadFromFile)
+        return Texture::createFromFile(pDevice, decoded.path, generateMipLevels, loadAsSRGB, bindFlags);
+    if (decoded.mips.empty())
+        return nullptr;
+
+    const auto& mip0 = decoded.mips[0];
+    ResourceFormat texFormat = mip0->getFormat();
+    if (loadAsSRGB)
+        texFormat = linearToSrgbFormat(texFormat);
+
+    ref<Texture> pTex;
+    if (decoded.mips.size() == 1)
+    {
+        pTex = Texture::create2D(
+            pDevice, mip0->getWidth(), mip0->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, mip0->getData(),
+            bindFlags
+        );
+    }
+    else
+    {
+        // Combine all the mip data into a single buffer.
+        std::unique_ptr<uint8_t[]> combinedData(new uint8_t[decoded.size]);
+        size_t copyDst = 0;
+        for (const auto& mip : decoded.mips)
+        {
+            std::memcpy(&combinedData[copyDst], mip->getData(), mip->getSize());
+            copyDst += mip->getSize();
+        }
+        pTex = Texture::create2D(
+            pDevice, mip0->getWidth(), mip0->getHeight(), texFormat, 1, (uint32_t)decoded.mips.size(), combinedData.get(), bindFlags
+        );
+    }
+
+    if (pTex)
+    {
+        pTex->setSourcePath(decoded.path);
+        logDebug(
+            "Loaded texture: size={}x{} mips={} format={} path={}", pTex->getWidth(), pTex->getHeight(), pTex->getMipCount(),
+            to_string(pTex->getFormat()), decoded.path
+        );
+    }
+    return pTex;
+}
 } // namespace
 
 TextureManager::TextureManager(ref<Device> pDevice, size_t maxTextureCount, size_t threadCount)
@@ -298,15 +507,10 @@ TextureManager::TextureHandle TextureManager::loadTexture(
         }
 #else
         // Load texture from main thread.
-        ref<Texture> pTexture;
-        if (paths.size() > 1)
-        {
-            pTexture = Texture::createMippedFromFiles(mpDevice, paths, loadAsSRGB, bindFlags);
-        }
-        else
-        {
-            pTexture = Texture::createFromFile(mpDevice, paths[0], generateMipLevels, loadAsSRGB, bindFlags);
-        }
+        ref<Texture> pTexture = createTexture(
+            mpDevice, decodeTexture(paths, generateMipLevels, loadAsSRGB, mpTextureCache.get(), mMipGeneratorOptions), generateMipLevels,
+            loadAsSRGB, bindFlags
+        );
 
         // Add new texture desc.
         TextureDesc desc = {TextureState::Loaded, pTexture};
@@ -354,6 +558,11 @@ void TextureManager::waitForAllTexturesLoading()
     mpDevice->flushAndSync();
 }
 
+void TextureManager::setTextureCacheEnabled(bool enabled, const std::filesystem::path& directory, uint64_t maxSize)
+{
+    mpTextureCache = enabled ? std::make_unique<TextureCache>(directory, maxSize) : nullptr;
+}
+
 void TextureManager::beginDeferredLoading()
 {
     mUseDeferredLoading = true;
@@ -365,6 +574,7 @@ void TextureManager::endDeferredLoading()
     {
         TextureKey key;
         TextureHandle handle;
+        DecodedTexture decoded;
     };
 
     // Get a list of textures to load.
@@ -373,7 +583,7 @@ void TextureManager::endDeferredLoading()
     {
         auto& desc = getDesc(handle);
         if (desc.state == TextureState::Referenced)
-            jobs.push_back(Job{key, handle});
+            jobs.push_back(Job{key, handle, {}});
     }
 
     // Early out if there are no textures to load.
@@ -381,44 +591,139 @@ void TextureManager::endDeferredLoading()
     if (jobs.empty())
         return;
 
-    // Load textures in parallel.
-    std::atomic<size_t> texturesLoaded;
-    NumericRange<size_t> jobRange(0, jobs.size());
-    std::for_each(
-        std::execution::par_unseq, jobRange.begin(), jobRange.end(),
-        [&](size_t i)
+    auto& counters = mDeferredLoadingCounters;
+    counters.textureCount = jobs.size();
+    counters.decodedCount = 0;
+    counters.uploadedCount = 0;
+    counters.decodedBytes = 0;
+    counters.cacheHitCount = 0;
+    counters.decodeTimeUs = 0;
+    counters.uploadTimeUs = 0;
+    counters.loadTimeUs = 0;
+
+    auto toMicroseconds = [](CpuTimer::TimePoint start, CpuTimer::TimePoint end)
+    { return uint64_t(CpuTimer::calcDuration(start, end) * 1000.0); };
+    const auto loadStart = CpuTimer::getCurrentTimePoint();
+
+    // Stage 1: Decode images on the thread pool. Finished jobs are pushed to a completion queue.
+    // The number of jobs in flight is bounded to limit the amount of decoded image data held in memory.
+    std::mutex completedMutex;
+    std::condition_variable completedCondition;
+    std::deque<size_t> completed;
+
+    std::vector<Threading::Task> tasks;
+    tasks.reserve(jobs.size());
+    size_t dispatchedCount = 0;
+    const size_t maxJobsInFlight = std::max<size_t>(4, 2 * Threading::getThreadCount());
+
+    auto dispatchJobs = [&](size_t inFlightCount)
+    {
+        while (dispatchedCount < jobs.size() && inFlightCount < maxJobsInFlight)
         {
-            const auto& job = jobs[i];
-            auto& desc = getDesc(job.handle);
-            if (job.key.fullPaths.size() == 1)
-            {
-                desc.pTexture = Texture::createFromFile(
-                    mpDevice, job.key.fullPaths[0], job.key.generateMipLevels, job.key.loadAsSRGB, job.key.bindFlags
-                );
-                logDebug("Loading texture from '{}'", job.key.fullPaths[0]);
-            }
-            else
-            {
-                desc.pTexture = Texture::createMippedFromFiles(mpDevice, job.key.fullPaths, job.key.loadAsSRGB, job.key.bindFlags);
-                logDebug("Loading mipped texture from '{}'", job.key.fullPaths[0]);
-            }
-            if (texturesLoaded.fetch_add(1) % 10 == 9)
-            {
-                logDebug("Flush");
-                std::lock_guard<std::mutex> lock(mpDevice->getGlobalGfxMutex());
-                mpDevice->flushAndSync();
-            }
+            size_t index = dispatchedCount++;
+            inFlightCount++;
+            tasks.push_back(Threading::dispatchTask(
+                [&, index]()
+                {
+                    auto& job = jobs[index];
+                    const auto decodeStart = CpuTimer::getCurrentTimePoint();
+                    try
+                    {
+                        job.decoded = decodeTexture(
+                            job.key.fullPaths, job.key.generateMipLevels, job.key.loadAsSRGB, mpTextureCache.get(), mMipGeneratorOptions
+                        );
+                    }
+                    catch (const std::exception& e)
+                    {
+                        logWarning("Error loading '{}': {}", job.key.fullPaths[0], e.what());
+                        job.decoded = {};
+                    }
+                    catch (...)
+                    {
+                        // Always post a result, the calling thread waits for one per job.
+                        logWarning("Error loading '{}': Unknown error.", job.key.fullPaths[0]);
+                        job.decoded = {};
+                    }
+                    counters.decodeTimeUs += toMicroseconds(decodeStart, CpuTimer::getCurrentTimePoint());
+                    counters.decodedBytes += job.decoded.size;
+                    counters.cacheHitCount += job.decoded.fromCache ? 1 : 0;
+                    counters.decodedCount++;
+
+                    std::lock_guard<std::mutex> lock(completedMutex);
+                    completed.push_back(index);
+                    completedCondition.notify_one();
+                }
+            ));
         }
-    );
-    mpDevice->flushAndSync();
+    };
 
-    // Mark loaded textures and add them to lookup table.
-    for (const auto& job : jobs)
+    // Stage 2: Create and upload textures from the calling thread in completion order.
+    // Uploads are recorded on the render context and only flushed once enough data has been queued up.
+    size_t uploadedCount = 0;
+    size_t pendingUploadBytes = 0;
+    dispatchJobs(0);
+    while (uploadedCount < jobs.size())
     {
-        auto& desc = getDesc(job.handle);
-        desc.state = desc.pTexture ? TextureState::Loaded : TextureState::Invalid;
-        mTextureToHandle[desc.pTexture.get()] = job.handle;
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(completedMutex);
+            completedCondition.wait(lock, [&]() { return !completed.empty(); });
+            index = completed.front();
+            completed.pop_front();
+        }
+
+        auto& job = jobs[index];
+        const auto uploadStart = CpuTimer::getCurrentTimePoint();
+        ref<Texture> pTexture;
+        try
+        {
+            pTexture = createTexture(mpDevice, job.decoded, job.key.generateMipLevels, job.key.loadAsSRGB, job.key.bindFlags);
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Error loading '{}': {}", job.key.fullPaths[0], e.what());
+        }
+        catch (...)
+        {
+            logWarning("Error loading '{}': Unknown error.", job.key.fullPaths[0]);
+        }
+        pendingUploadBytes += job.decoded.size;
+        job.decoded = {};
+
+        if (pendingUploadBytes >= kMaxUploadBytesBetweenFlushes)
+        {
+            mpDevice->flushAndSync();
+            pendingUploadBytes = 0;
+        }
+        counters.uploadTimeUs += toMicroseconds(uploadStart, CpuTimer::getCurrentTimePoint());
+
+        // Mark texture as loaded and add it to the lookup table.
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto& desc = getDesc(job.handle);
+            desc.pTexture = pTexture;
+            desc.state = pTexture ? TextureState::Loaded : TextureState::Invalid;
+            if (pTexture)
+                mTextureToHandle[pTexture.get()] = job.handle;
+        }
+
+        uploadedCount++;
+        counters.uploadedCount = uploadedCount;
+        dispatchJobs(dispatchedCount - uploadedCount);
     }
+
+    for (const auto& task : tasks)
+        task.finish();
+    mpDevice->flushAndSync();
+
+    const auto loadEnd = CpuTimer::getCurrentTimePoint();
+    counters.loadTimeUs = toMicroseconds(loadStart, loadEnd);
+    const double loadTime = CpuTimer::calcDuration(loadStart, loadEnd) * 1e-3;
+    logInfo(
+        "Loaded {} textures ({:.1f} MB, {} from cache) in {:.2f}s (decode {:.2f}s on {} threads, upload {:.2f}s).", jobs.size(),
+        counters.decodedBytes / (1024.0 * 1024.0), counters.cacheHitCount.load(), loadTime, counters.decodeTimeUs * 1e-6,
+        std::max<uint32_t>(1, Threading::getThreadCount()), counters.uploadTimeUs * 1e-6
+    );
 }
 
 void TextureManager::removeTexture(const TextureHandle& handle)
@@ -539,6 +844,16 @@ TextureManager::Stats TextureManager::getStats() const
         if (isCompressedFormat(t.pTexture->getFormat()))
             s.textureCompressedCount++;
     }
+
+    const auto& counters = mDeferredLoadingCounters;
+    s.deferredTextureCount = counters.textureCount;
+    s.deferredDecodedCount = counters.decodedCount;
+    s.deferredUploadedCount = counters.uploadedCount;
+    s.deferredDecodedBytes = counters.decodedBytes;
+    s.deferredCacheHitCount = counters.cacheHitCount;
+    s.deferredDecodeTime = counters.decodeTimeUs * 1e-6;
+    s.deferredUploadTime = counters.uploadTimeUs * 1e-6;
+    s.deferredLoadTime = counters.loadTimeUs * 1e-6;
     return s;
 }
 
@@ -27,11 +27,14 @@
  **************************************************************************/
 #pragma once
 #include "AsyncTextureLoader.h"
+#include "MipGenerator.h"
+#include "TextureCache.h"
 #include "Core/Macros.h"
 #include "Core/API/fwd.h"
 #include "Core/API/Resource.h"
 #include "Core/API/Texture.h"
 #include "Core/Program/ShaderVar.h"
+#include <atomic>
 #include <condition_variable>
 #include <limits>
 #include <map>
@@ -71,6 +74,16 @@ public:
         uint64_t textureTexelCount = 0;        ///< Total number of texels in all textures.
         uint64_t textureTexelChannelCount = 0; ///< Total number of texel channels in all textures.
         uint64_t textureMemoryInBytes = 0;     ///< Total memory in bytes used by the textures.
+
+        // Progress and throughput of the last endDeferredLoading() call. These are updated while loading is in progress.
+        uint64_t deferredTextureCount = 0;  ///< Number of textures to load.
+        uint64_t deferredDecodedCount = 0;  ///< Number of textures decoded so far.
+        uint64_t deferredUploadedCount = 0; ///< Number of textures uploaded so far.
+        uint64_t deferredDecodedBytes = 0;  ///< Size of the decoded image data in bytes.
+        uint64_t deferredCacheHitCount = 0; ///< Number of textures read from the texture cache.
+        double deferredDecodeTime = 0.0;    ///< Time spent decoding in seconds, summed over all worker threads.
+        double deferredUploadTime = 0.0;    ///< Time spent creating and uploading textures in seconds.
+        double deferredLoadTime = 0.0;      ///< Total time of the deferred loading in seconds.
     };
 
     /**
@@ -181,12 +194,44 @@ public:
      * Marks the beginning of a section where texture loading is deferred.
      * All loadTexture() and loadUdimTexture() calls after calling this will be put on a deferred list.
      * A later call to endDeferredLoading() will load all queued up textures in parallel.
+     * Image files are decoded on the global thread pool, while textures are created and uploaded by the calling thread
+     * as soon as their data is decoded. Progress is reported through getStats().
      * WARNING: This is a dangerous operation because Falcor is generally not thread-safe. Only use this
      * from the main thread when it is guaranteed to not be interleaved with any other thread.
      */
     void beginDeferredLoading();
     void endDeferredLoading();
 
+    /**
+     * Enable or disable the on-disk texture cache.
+     * When enabled, textures loaded from image files are stored decoded and with their mip chain in a TextureCache.
+     * Later loads of the same file contents read the cache instead of decoding the file and generating mips.
+     * @param[in] enabled True to enable the cache.
+     * @param[in] directory Cache directory.
+     * @param[in] maxSize Maximum size of the cache in bytes. The least recently used entries are evicted when it is exceeded.
+     */
+    void setTextureCacheEnabled(
+        bool enabled,
+        const std::filesystem::path& directory = TextureCache::getDefaultDirectory(),
+        uint64_t maxSize = TextureCache::kDefaultMaxSize
+    );
+
+    /**
+     * Check if the on-disk texture cache is enabled.
+     */
+    bool isTextureCacheEnabled() const { return mpTextureCache != nullptr; }
+
+    /**
+     * Set the options for generating mip chains on the CPU. Mips are generated on the CPU for all formats supported by
+     * MipGenerator, and on the GPU otherwise. The sRGB option is set per texture depending on how it is loaded.
+     */
+    void setMipGeneratorOptions(const MipGenerator::Options& options) { mMipGeneratorOptions = options; }
+
+    /**
+     * Get the options for generating mip chains on the CPU.
+     */
+    const MipGenerator::Options& getMipGeneratorOptions() const { return mMipGeneratorOptions; }
+
     /**
      * Remove a texture.
      * @param[in] handle Texture handle.
@@ -296,6 +341,23 @@ private:
 
     bool mUseDeferredLoading = false;
 
+    /// Progress and timing counters of deferred loading. Updated by worker threads, so all counters are atomic.
+    struct DeferredLoadingCounters
+    {
+        std::atomic<uint64_t> textureCount{0};
+        std::atomic<uint64_t> decodedCount{0};
+        std::atomic<uint64_t> uploadedCount{0};
+        std::atomic<uint64_t> decodedBytes{0};
+        std::atomic<uint64_t> cacheHitCount{0};
+        std::atomic<uint64_t> decodeTimeUs{0};
+        std::atomic<uint64_t> uploadTimeUs{0};
+        std::atomic<uint64_t> loadTimeUs{0};
+    };
+    DeferredLoadingCounters mDeferredLoadingCounters;
+
+    std::unique_ptr<TextureCache> mpTextureCache; ///< On-disk cache of decoded textures, or nullptr if disabled.
+    MipGenerator::Options mMipGeneratorOptions;   ///< Options for generating mip chains on the CPU.
+
     AsyncTextureLoader mAsyncTextureLoader; ///< Utility for asynchronous texture loading.
     size_t mLoadRequestsInProgress = 0;     ///< Number of load requests currently in progress.
 
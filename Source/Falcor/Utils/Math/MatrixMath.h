@@ -313,6 +313,29 @@ template<typename T>
     return inverse * oneOverDet;
 }
 
+/// Check if a 4x4 matrix is an affine transform, i.e. its last row is (0, 0, 0, 1).
+template<typename T>
+[[nodiscard]] inline bool isAffine(const matrix<T, 4, 4>& m)
+{
+    return m[3][0] == T(0) && m[3][1] == T(0) && m[3][2] == T(0) && m[3][3] == T(1);
+}
+
+/// Compute inverse of an affine 4x4 matrix (see isAffine()).
+/// Only the upper 3x3 part is inverted, which is considerably cheaper than the general 4x4 inverse.
+template<typename T>
+[[nodiscard]] inline matrix<T, 4, 4> inverseAffine(const matrix<T, 4, 4>& m)
+{
+    FALCOR_ASSERT(isAffine(m));
+    matrix<T, 3, 3> linearInverse = inverse(matrix<T, 3, 3>(m));
+    vector<T, 3> translation = -mul(linearInverse, vector<T, 3>(m[0][3], m[1][3], m[2][3]));
+
+    matrix<T, 4, 4> result(linearInverse);
+    result[0][3] = translation.x;
+    result[1][3] = translation.y;
+    result[2][3] = translation.z;
+    return result;
+}
+
 /// Compute the (X * Y * Z) euler angles of a 4x4 matrix.
 template<typename T>
 void extractEulerAngleXYZ(const matrix<T, 4, 4>& m, float& angleX, float& angleY, float& angleZ)
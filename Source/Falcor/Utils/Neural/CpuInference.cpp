@@ -0,0 +1,430 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "CpuInference.h"
+#include "CpuInferenceKernels.h"
+#include "Core/Errors.h"
+#include "Utils/Math/Float16.h"
+#include "Utils/Threading.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if FALCOR_CPU_INFERENCE_X86 && FALCOR_MSVC
+#include <intrin.h>
+#endif
+
+namespace Falcor
+{
+namespace
+{
+using ConvRowFunc = void (*)(const cpu_inference::ConvRowArgs&, uint32_t);
+using DenseFunc = void (*)(const cpu_inference::DenseArgs&, const float*, float*);
+
+bool hasAVX2()
+{
+#if FALCOR_CPU_INFERENCE_X86
+#if FALCOR_MSVC
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!fma || !osxsave || !avx)
+        return false;
+    // Check that the OS saves the YMM registers.
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#else
+    return false;
+#endif
+}
+
+void checkSimd(CpuSimd simd)
+{
+    if (!isCpuSimdSupported(simd))
+        throw ArgumentError("Instruction set '{}' is not supported on this CPU.", enumToString(simd));
+}
+
+ConvRowFunc getConvRowFunc(CpuSimd simd)
+{
+    switch (simd)
+    {
+#if FALCOR_CPU_INFERENCE_X86
+    case CpuSimd::SSE2:
+        return cpu_inference::convRow<cpu_inference::SSE2Ops>;
+    case CpuSimd::AVX2:
+        return cpu_inference::convRowAVX2;
+#endif
+#if FALCOR_CPU_INFERENCE_NEON
+    case CpuSimd::NEON:
+        return cpu_inference::convRow<cpu_inference::NEONOps>;
+#endif
+    default:
+        return cpu_inference::convRow<cpu_inference::ScalarOps>;
+    }
+}
+
+DenseFunc getDenseFunc(CpuSimd simd)
+{
+    switch (simd)
+    {
+#if FALCOR_CPU_INFERENCE_X86
+    case CpuSimd::SSE2:
+        return cpu_inference::dense<cpu_inference::SSE2Ops>;
+    case CpuSimd::AVX2:
+        return cpu_inference::denseAVX2;
+#endif
+#if FALCOR_CPU_INFERENCE_NEON
+    case CpuSimd::NEON:
+        return cpu_inference::dense<cpu_inference::NEONOps>;
+#endif
+    default:
+        return cpu_inference::dense<cpu_inference::ScalarOps>;
+    }
+}
+
+float quantize(float value, CpuConvNet::Precision precision)
+{
+    switch (precision)
+    {
+    case CpuConvNet::Precision::Half:
+        return math::float16ToFloat32(math::float32ToFloat16(value));
+    case CpuConvNet::Precision::UNorm:
+        return std::round(std::clamp(value, 0.f, 1.f) * 255.f) / 255.f;
+    default:
+        return value;
+    }
+}
+
+uint32_t alignUp(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+bool isCpuSimdSupported(CpuSimd simd)
+{
+    switch (simd)
+    {
+    case CpuSimd::Scalar:
+        return true;
+    case CpuSimd::SSE2:
+        return FALCOR_CPU_INFERENCE_X86 != 0;
+    case CpuSimd::AVX2:
+    {
+        static const bool kSupported = hasAVX2();
+        return kSupported;
+    }
+    case CpuSimd::NEON:
+        return FALCOR_CPU_INFERENCE_NEON != 0;
+    default:
+        return false;
+    }
+}
+
+CpuSimd getBestCpuSimd()
+{
+    if (isCpuSimdSupported(CpuSimd::AVX2))
+        return CpuSimd::AVX2;
+    if (isCpuSimdSupported(CpuSimd::SSE2))
+        return CpuSimd::SSE2;
+    if (isCpuSimdSupported(CpuSimd::NEON))
+        return CpuSimd::NEON;
+    return CpuSimd::Scalar;
+}
+
+// CpuConvNet
+
+void CpuConvNet::addLayer(const Layer& layer)
+{
+    if (layer.kernelWidth == 0 || layer.kernelHeight == 0 || layer.channelsIn == 0 || layer.channelsOut == 0)
+        throw ArgumentError("Convolution layer dimensions must be non-zero.");
+    const size_t weightCount = size_t(layer.kernelWidth) * layer.kernelHeight * layer.channelsIn * layer.channelsOut;
+    if (layer.weights.size() != weightCount)
+        throw ArgumentError("Convolution layer has {} weights, expected {}.", layer.weights.size(), weightCount);
+    if (!layer.bias.empty() && layer.bias.size() != layer.channelsOut)
+        throw ArgumentError("Convolution layer has {} biases, expected {}.", layer.bias.size(), layer.channelsOut);
+    if (!mLayers.empty() && mLayers.back().channelsOut != layer.channelsIn)
+        throw ArgumentError(
+            "Convolution layer expects {} input channels, but the previous layer outputs {}.", layer.channelsIn, mLayers.back().channelsOut
+        );
+
+    PackedLayer packed;
+    packed.kernelWidth = layer.kernelWidth;
+    packed.kernelHeight = layer.kernelHeight;
+    packed.channelsIn = layer.channelsIn;
+    packed.channelsOut = layer.channelsOut;
+    packed.activation = layer.activation;
+
+    const uint32_t blockCount = (layer.channelsOut + 3) / 4;
+    packed.bias.resize(blockCount * 4, 0.f);
+    std::copy(layer.bias.begin(), layer.bias.end(), packed.bias.begin());
+
+    packed.weights.resize(blockCount * 4 * size_t(layer.channelsIn) * layer.kernelHeight * layer.kernelWidth, 0.f);
+    float* pDst = packed.weights.data();
+    for (uint32_t block = 0; block < blockCount; ++block)
+    {
+        for (uint32_t chIn = 0; chIn < layer.channelsIn; ++chIn)
+        {
+            for (uint32_t ky = 0; ky < layer.kernelHeight; ++ky)
+            {
+                for (uint32_t kx = 0; kx < layer.kernelWidth; ++kx, pDst += 4)
+                {
+                    for (uint32_t i = 0; i < 4; ++i)
+                    {
+                        uint32_t chOut = block * 4 + i;
+                        if (chOut < layer.channelsOut)
+                            pDst[i] = layer.weights[((size_t(kx) * layer.kernelHeight + ky) * layer.channelsIn + chIn) * layer.channelsOut + chOut];
+                    }
+                }
+            }
+        }
+    }
+
+    mLayers.push_back(std::move(packed));
+}
+
+uint32_t CpuConvNet::getInputChannelCount() const
+{
+    return mLayers.empty() ? 0 : mLayers.front().channelsIn;
+}
+
+uint32_t CpuConvNet::getOutputChannelCount() const
+{
+    return mLayers.empty() ? 0 : mLayers.back().channelsOut;
+}
+
+void CpuConvNet::run(const CpuTensor& input, CpuTensor& output, const CpuTensor* pClampMin, const CpuTensor* pClampMax, CpuSimd simd)
+    const
+{
+    if (mLayers.empty())
+        throw RuntimeError("Cannot run a convolution network without layers.");
+    if (input.channels != getInputChannelCount())
+        throw ArgumentError("Input tensor has {} channels, expected {}.", input.channels, getInputChannelCount());
+    if (input.data.size() != input.getPlaneSize() * input.channels)
+        throw ArgumentError("Input tensor data size does not match its dimensions.");
+    if (&input == &output)
+        throw ArgumentError("Input and output tensors must be different.");
+
+    const bool usesClamp =
+        std::any_of(mLayers.begin(), mLayers.end(), [](const PackedLayer& layer) { return layer.activation == Activation::Clamp; });
+    if (usesClamp)
+    {
+        for (const CpuTensor* pBound : {pClampMin, pClampMax})
+        {
+            if (!pBound || pBound->width != input.width || pBound->height != input.height || pBound->channels != 1 ||
+                pBound->data.size() != input.getPlaneSize())
+                throw ArgumentError("Clamp activation requires single channel clampMin/clampMax tensors matching the input size.");
+        }
+    }
+    checkSimd(simd);
+
+    const ConvRowFunc convRowFunc = getConvRowFunc(simd);
+    const uint32_t width = input.width;
+    const uint32_t height = input.height;
+
+    std::vector<float> padded;
+    std::vector<const float*> inputPlanes;
+    std::vector<float*> outputPlanes;
+    CpuTensor intermediate[2];
+    const CpuTensor* pCurrent = &input;
+
+    for (size_t l = 0; l < mLayers.size(); ++l)
+    {
+        const PackedLayer& layer = mLayers[l];
+        const bool isLast = l + 1 == mLayers.size();
+
+        // Copy the input into zero padded planes so that the kernels can read all taps without bounds checks.
+        const uint32_t padX = layer.kernelWidth / 2;
+        const uint32_t padY = layer.kernelHeight / 2;
+        const size_t pitch = size_t(width) + layer.kernelWidth - 1;
+        const size_t paddedHeight = size_t(height) + layer.kernelHeight - 1;
+        const size_t paddedPlaneSize = pitch * paddedHeight;
+        padded.assign(paddedPlaneSize * layer.channelsIn, 0.f);
+        Threading::parallelFor(
+            0,
+            size_t(layer.channelsIn) * height,
+            [&](size_t i)
+            {
+                const uint32_t chIn = uint32_t(i / height);
+                const uint32_t y = uint32_t(i % height);
+                std::memcpy(
+                    padded.data() + chIn * paddedPlaneSize + (y + padY) * pitch + padX,
+                    pCurrent->getChannel(chIn) + size_t(y) * width,
+                    width * sizeof(float)
+                );
+            }
+        );
+
+        inputPlanes.resize(layer.channelsIn);
+        for (uint32_t chIn = 0; chIn < layer.channelsIn; ++chIn)
+            inputPlanes[chIn] = padded.data() + chIn * paddedPlaneSize;
+
+        CpuTensor& dst = isLast ? output : intermediate[l % 2];
+        dst.width = width;
+        dst.height = height;
+        dst.channels = layer.channelsOut;
+        dst.data.resize(dst.getPlaneSize() * dst.channels);
+
+        outputPlanes.resize(layer.channelsOut);
+        for (uint32_t chOut = 0; chOut < layer.channelsOut; ++chOut)
+            outputPlanes[chOut] = dst.getChannel(chOut);
+
+        cpu_inference::ConvRowArgs args = {};
+        args.pInputPlanes = inputPlanes.data();
+        args.inputPitch = pitch;
+        args.pWeights = layer.weights.data();
+        args.pBias = layer.bias.data();
+        args.kernelWidth = layer.kernelWidth;
+        args.kernelHeight = layer.kernelHeight;
+        args.channelsIn = layer.channelsIn;
+        args.channelsOut = layer.channelsOut;
+        args.pOutputPlanes = outputPlanes.data();
+        args.width = width;
+
+        const Precision precision = isLast ? Precision::Float : mIntermediatePrecision;
+        Threading::parallelFor(
+            0,
+            height,
+            [&](size_t y)
+            {
+                convRowFunc(args, uint32_t(y));
+
+                const size_t rowOffset = y * width;
+                for (uint32_t chOut = 0; chOut < layer.channelsOut; ++chOut)
+                {
+                    float* pRow = outputPlanes[chOut] + rowOffset;
+                    if (layer.activation == Activation::ReLU)
+                    {
+                        for (uint32_t x = 0; x < width; ++x)
+                            pRow[x] = std::max(pRow[x], 0.f);
+                    }
+                    else if (layer.activation == Activation::Clamp)
+                    {
+                        const float* pMin = pClampMin->data.data() + rowOffset;
+                        const float* pMax = pClampMax->data.data() + rowOffset;
+                        for (uint32_t x = 0; x < width; ++x)
+                            pRow[x] = std::min(std::max(pRow[x], pMin[x]), pMax[x]);
+                    }
+                    if (precision != Precision::Float)
+                    {
+                        for (uint32_t x = 0; x < width; ++x)
+                            pRow[x] = quantize(pRow[x], precision);
+                    }
+                }
+            }
+        );
+
+        pCurrent = &dst;
+    }
+}
+
+// CpuDenseNet
+
+void CpuDenseNet::addLayer(const Layer& layer)
+{
+    if (layer.inputs == 0 || layer.outputs == 0)
+        throw ArgumentError("Dense layer dimensions must be non-zero.");
+    if (layer.weights.size() != size_t(layer.inputs) * layer.outputs)
+        throw ArgumentError("Dense layer has {} weights, expected {}.", layer.weights.size(), size_t(layer.inputs) * layer.outputs);
+    if (!layer.bias.empty() && layer.bias.size() != layer.outputs)
+        throw ArgumentError("Dense layer has {} biases, expected {}.", layer.bias.size(), layer.outputs);
+    if (!mLayers.empty() && mLayers.back().outputs != layer.inputs)
+        throw ArgumentError("Dense layer expects {} inputs, but the previous layer outputs {}.", layer.inputs, mLayers.back().outputs);
+
+    PackedLayer packed;
+    packed.inputs = layer.inputs;
+    packed.outputs = layer.outputs;
+    packed.outputsPadded = alignUp(layer.outputs, cpu_inference::kMaxVectorWidth);
+    packed.activation = layer.activation;
+
+    packed.bias.resize(packed.outputsPadded, 0.f);
+    std::copy(layer.bias.begin(), layer.bias.end(), packed.bias.begin());
+
+    packed.weights.resize(size_t(packed.inputs) * packed.outputsPadded, 0.f);
+    for (uint32_t i = 0; i < layer.inputs; ++i)
+        std::copy_n(layer.weights.data() + size_t(i) * layer.outputs, layer.outputs, packed.weights.data() + size_t(i) * packed.outputsPadded);
+
+    mMaxWidth = std::max({mMaxWidth, packed.inputs, packed.outputsPadded});
+    mLayers.push_back(std::move(packed));
+}
+
+uint32_t CpuDenseNet::getInputCount() const
+{
+    return mLayers.empty() ? 0 : mLayers.front().inputs;
+}
+
+uint32_t CpuDenseNet::getOutputCount() const
+{
+    return mLayers.empty() ? 0 : mLayers.back().outputs;
+}
+
+void CpuDenseNet::evaluate(size_t count, const float* pInputs, float* pOutputs, CpuSimd simd) const
+{
+    if (mLayers.empty())
+        throw RuntimeError("Cannot evaluate a dense network without layers.");
+    checkSimd(simd);
+
+    const DenseFunc denseFunc = getDenseFunc(simd);
+    const uint32_t inputCount = getInputCount();
+    const uint32_t outputCount = getOutputCount();
+
+    std::vector<cpu_inference::DenseArgs> layerArgs(mLayers.size());
+    for (size_t l = 0; l < mLayers.size(); ++l)
+    {
+        const PackedLayer& layer = mLayers[l];
+        layerArgs[l] = {layer.weights.data(), layer.bias.data(), layer.inputs, layer.outputsPadded, layer.activation == Activation::ReLU};
+    }
+
+    Threading::parallelForChunked(
+        0,
+        count,
+        [&](size_t begin, size_t end)
+        {
+            std::vector<float> buffers[2] = {std::vector<float>(mMaxWidth), std::vector<float>(mMaxWidth)};
+            for (size_t sample = begin; sample < end; ++sample)
+            {
+                std::copy_n(pInputs + sample * inputCount, inputCount, buffers[0].data());
+                for (size_t l = 0; l < layerArgs.size(); ++l)
+                    denseFunc(layerArgs[l], buffers[l % 2].data(), buffers[(l + 1) % 2].data());
+                std::copy_n(buffers[layerArgs.size() % 2].data(), outputCount, pOutputs + sample * outputCount);
+            }
+        },
+        256
+    );
+}
+} // namespace Falcor
@@ -0,0 +1,231 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Core/Enum.h"
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Vector instruction set used by the CPU inference kernels.
+ */
+enum class CpuSimd
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON,
+};
+
+FALCOR_ENUM_INFO(
+    CpuSimd,
+    {
+        {CpuSimd::Scalar, "Scalar"},
+        {CpuSimd::SSE2, "SSE2"},
+        {CpuSimd::AVX2, "AVX2"},
+        {CpuSimd::NEON, "NEON"},
+    }
+);
+FALCOR_ENUM_REGISTER(CpuSimd);
+
+/**
+ * Returns true if the kernels for the given instruction set are compiled in and supported by the executing CPU.
+ */
+FALCOR_API bool isCpuSimdSupported(CpuSimd simd);
+
+/**
+ * Returns the fastest instruction set supported on the executing CPU.
+ */
+FALCOR_API CpuSimd getBestCpuSimd();
+
+/**
+ * Planar image tensor with float storage.
+ * Channel c of pixel (x, y) is stored at data[(c * height + y) * width + x],
+ * which matches the layout of a texture array with one single channel slice per channel.
+ */
+struct CpuTensor
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t channels = 0;
+    std::vector<float> data;
+
+    CpuTensor() = default;
+    CpuTensor(uint32_t width_, uint32_t height_, uint32_t channels_)
+        : width(width_), height(height_), channels(channels_), data(size_t(width_) * height_ * channels_, 0.f)
+    {}
+
+    size_t getPlaneSize() const { return size_t(width) * height; }
+    float* getChannel(uint32_t c) { return data.data() + c * getPlaneSize(); }
+    const float* getChannel(uint32_t c) const { return data.data() + c * getPlaneSize(); }
+    float& at(uint32_t x, uint32_t y, uint32_t c) { return data[c * getPlaneSize() + size_t(y) * width + x]; }
+    float at(uint32_t x, uint32_t y, uint32_t c) const { return data[c * getPlaneSize() + size_t(y) * width + x]; }
+};
+
+/**
+ * CPU reference implementation of a stack of 2D convolution layers.
+ * The evaluation matches the pixel shaders generated by the ConvolutionalNet render pass:
+ * - Kernels are centered at offset (kernelWidth / 2, kernelHeight / 2).
+ * - Pixels outside of the image read as zero.
+ * - Intermediate layer outputs can be quantized to the precision of the render targets used on the GPU.
+ * Rows are distributed over the Falcor thread pool and vectorized over neighboring pixels.
+ */
+class FALCOR_API CpuConvNet
+{
+public:
+    enum class Activation
+    {
+        None,
+        ReLU,
+        Clamp, ///< Clamp to the per pixel range given by the clampMin/clampMax tensors.
+    };
+
+    enum class Precision
+    {
+        Float,
+        Half,
+        UNorm,
+    };
+
+    struct Layer
+    {
+        uint32_t kernelWidth = 1;
+        uint32_t kernelHeight = 1;
+        uint32_t channelsIn = 0;
+        uint32_t channelsOut = 0;
+        std::vector<float> weights; ///< Weight of tap (kx, ky) is at [((kx * kernelHeight + ky) * channelsIn + chIn) * channelsOut + chOut].
+        std::vector<float> bias;    ///< One entry per output channel, empty for zero bias.
+        Activation activation = Activation::ReLU;
+    };
+
+    /**
+     * Appends a layer. Its input channel count has to match the output channel count of the previous layer.
+     * Throws an ArgumentError if the layer is malformed.
+     */
+    void addLayer(const Layer& layer);
+
+    /**
+     * Sets the storage precision of the outputs of all but the last layer (default is Float).
+     */
+    void setIntermediatePrecision(Precision precision) { mIntermediatePrecision = precision; }
+    Precision getIntermediatePrecision() const { return mIntermediatePrecision; }
+
+    uint32_t getLayerCount() const { return (uint32_t)mLayers.size(); }
+    uint32_t getInputChannelCount() const;
+    uint32_t getOutputChannelCount() const;
+
+    /**
+     * Runs the network on an image.
+     * @param[in] input Input tensor with getInputChannelCount() channels.
+     * @param[out] output Output tensor, resized to the input dimensions and getOutputChannelCount() channels.
+     * @param[in] pClampMin Single channel lower bound, required if a layer uses the Clamp activation.
+     * @param[in] pClampMax Single channel upper bound, required if a layer uses the Clamp activation.
+     * @param[in] simd Instruction set to use. Throws an ArgumentError if it is not supported.
+     */
+    void run(
+        const CpuTensor& input,
+        CpuTensor& output,
+        const CpuTensor* pClampMin = nullptr,
+        const CpuTensor* pClampMax = nullptr,
+        CpuSimd simd = getBestCpuSimd()
+    ) const;
+
+private:
+    struct PackedLayer
+    {
+        uint32_t kernelWidth;
+        uint32_t kernelHeight;
+        uint32_t channelsIn;
+        uint32_t channelsOut;
+        std::vector<float> weights; ///< Layout [chOut / 4][chIn][ky][kx][chOut % 4].
+        std::vector<float> bias;    ///< Padded to a multiple of 4.
+        Activation activation;
+    };
+
+    std::vector<PackedLayer> mLayers;
+    Precision mIntermediatePrecision = Precision::Float;
+};
+
+/**
+ * CPU reference implementation of a fully connected network (multi layer perceptron).
+ * Samples are distributed over the Falcor thread pool and each layer is vectorized over its outputs.
+ */
+class FALCOR_API CpuDenseNet
+{
+public:
+    enum class Activation
+    {
+        None,
+        ReLU,
+    };
+
+    struct Layer
+    {
+        uint32_t inputs = 0;
+        uint32_t outputs = 0;
+        std::vector<float> weights; ///< Weight from input i to output o is at [i * outputs + o].
+        std::vector<float> bias;    ///< One entry per output, empty for zero bias.
+        Activation activation = Activation::ReLU;
+    };
+
+    /**
+     * Appends a layer. Its input count has to match the output count of the previous layer.
+     * Throws an ArgumentError if the layer is malformed.
+     */
+    void addLayer(const Layer& layer);
+
+    uint32_t getLayerCount() const { return (uint32_t)mLayers.size(); }
+    uint32_t getInputCount() const;
+    uint32_t getOutputCount() const;
+
+    /**
+     * Evaluates the network for a batch of samples.
+     * @param[in] count Number of samples.
+     * @param[in] pInputs Inputs, count x getInputCount() floats in row-major order.
+     * @param[out] pOutputs Outputs, count x getOutputCount() floats in row-major order.
+     * @param[in] simd Instruction set to use. Throws an ArgumentError if it is not supported.
+     */
+    void evaluate(size_t count, const float* pInputs, float* pOutputs, CpuSimd simd = getBestCpuSimd()) const;
+
+private:
+    struct PackedLayer
+    {
+        uint32_t inputs;
+        uint32_t outputs;
+        uint32_t outputsPadded;
+        std::vector<float> weights; ///< Layout [inputs][outputsPadded].
+        std::vector<float> bias;    ///< Padded to outputsPadded.
+        Activation activation;
+    };
+
+    std::vector<PackedLayer> mLayers;
+    uint32_t mMaxWidth = 0;
+};
+} // namespace Falcor
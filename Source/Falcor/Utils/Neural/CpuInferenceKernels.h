@@ -0,0 +1,212 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define FALCOR_CPU_INFERENCE_X86 1
+#include <immintrin.h>
+#else
+#define FALCOR_CPU_INFERENCE_X86 0
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define FALCOR_CPU_INFERENCE_NEON 1
+#include <arm_neon.h>
+#else
+#define FALCOR_CPU_INFERENCE_NEON 0
+#endif
+
+/**
+ * Internal kernels of the CPU inference engine (see CpuInference.h).
+ * The kernels are templated on a small vector abstraction and are instantiated once per instruction set.
+ * This header is included by translation units compiled with different instruction set flags, so everything
+ * except the argument structs has internal linkage to keep the instantiations from being merged by the linker.
+ * For the same reason the kernels do not call into the standard library.
+ */
+namespace Falcor
+{
+namespace cpu_inference
+{
+/// Width in floats that all padded dense layer rows are a multiple of (the widest supported vector).
+constexpr uint32_t kMaxVectorWidth = 8;
+
+struct ConvRowArgs
+{
+    const float* const* pInputPlanes; ///< Zero padded input planes, one per input channel.
+    size_t inputPitch;                ///< Floats per padded input row.
+    const float* pWeights;            ///< Packed weights, see CpuConvNet::PackedLayer.
+    const float* pBias;               ///< Bias padded to a multiple of 4.
+    uint32_t kernelWidth;
+    uint32_t kernelHeight;
+    uint32_t channelsIn;
+    uint32_t channelsOut;
+    float* const* pOutputPlanes; ///< Output planes, one per output channel.
+    uint32_t width;              ///< Output width (equals the output pitch).
+};
+
+struct DenseArgs
+{
+    const float* pWeights; ///< Packed weights, see CpuDenseNet::PackedLayer.
+    const float* pBias;    ///< Bias padded to outputsPadded.
+    uint32_t inputs;
+    uint32_t outputsPadded; ///< Multiple of kMaxVectorWidth.
+    bool relu;
+};
+
+#if FALCOR_CPU_INFERENCE_X86
+void convRowAVX2(const ConvRowArgs& args, uint32_t y);
+void denseAVX2(const DenseArgs& args, const float* pInput, float* pOutput);
+#endif
+
+namespace
+{
+struct ScalarOps
+{
+    using Vec = float;
+    static constexpr uint32_t kWidth = 1;
+    static Vec load(const float* p) { return *p; }
+    static void store(float* p, Vec v) { *p = v; }
+    static Vec set1(float v) { return v; }
+    static Vec fmadd(Vec a, Vec b, Vec c) { return a * b + c; }
+    static Vec max0(Vec v) { return v > 0.f ? v : 0.f; }
+};
+
+#if FALCOR_CPU_INFERENCE_X86
+struct SSE2Ops
+{
+    using Vec = __m128;
+    static constexpr uint32_t kWidth = 4;
+    static Vec load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+    static Vec set1(float v) { return _mm_set1_ps(v); }
+    static Vec fmadd(Vec a, Vec b, Vec c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static Vec max0(Vec v) { return _mm_max_ps(v, _mm_setzero_ps()); }
+};
+#endif
+
+#if FALCOR_CPU_INFERENCE_NEON
+struct NEONOps
+{
+    using Vec = float32x4_t;
+    static constexpr uint32_t kWidth = 4;
+    static Vec load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, Vec v) { vst1q_f32(p, v); }
+    static Vec set1(float v) { return vdupq_n_f32(v); }
+    static Vec fmadd(Vec a, Vec b, Vec c) { return vmlaq_f32(c, a, b); }
+    static Vec max0(Vec v) { return vmaxq_f32(v, vdupq_n_f32(0.f)); }
+};
+#endif
+
+/**
+ * Computes output pixels [x0, x1) of row y for all output channels. (x1 - x0) must be a multiple of Ops::kWidth.
+ * Four output channels are accumulated at once so that every input load is reused four times.
+ */
+template<typename Ops>
+inline void convSpan(const ConvRowArgs& args, uint32_t y, uint32_t x0, uint32_t x1)
+{
+    using Vec = typename Ops::Vec;
+    const uint32_t blockCount = (args.channelsOut + 3) / 4;
+    const size_t blockWeightCount = size_t(args.channelsIn) * args.kernelHeight * args.kernelWidth * 4;
+    const size_t outputOffset = size_t(y) * args.width;
+
+    for (uint32_t block = 0; block < blockCount; ++block)
+    {
+        const float* pBlockWeights = args.pWeights + block * blockWeightCount;
+        const float* pBias = args.pBias + block * 4;
+        const uint32_t outCount = args.channelsOut - block * 4;
+
+        for (uint32_t x = x0; x < x1; x += Ops::kWidth)
+        {
+            Vec acc0 = Ops::set1(pBias[0]);
+            Vec acc1 = Ops::set1(pBias[1]);
+            Vec acc2 = Ops::set1(pBias[2]);
+            Vec acc3 = Ops::set1(pBias[3]);
+
+            const float* pW = pBlockWeights;
+            for (uint32_t chIn = 0; chIn < args.channelsIn; ++chIn)
+            {
+                const float* pPlane = args.pInputPlanes[chIn] + x;
+                for (uint32_t ky = 0; ky < args.kernelHeight; ++ky)
+                {
+                    const float* pRow = pPlane + (y + ky) * args.inputPitch;
+                    for (uint32_t kx = 0; kx < args.kernelWidth; ++kx, pW += 4)
+                    {
+                        Vec v = Ops::load(pRow + kx);
+                        acc0 = Ops::fmadd(v, Ops::set1(pW[0]), acc0);
+                        acc1 = Ops::fmadd(v, Ops::set1(pW[1]), acc1);
+                        acc2 = Ops::fmadd(v, Ops::set1(pW[2]), acc2);
+                        acc3 = Ops::fmadd(v, Ops::set1(pW[3]), acc3);
+                    }
+                }
+            }
+
+            float* const* pOut = args.pOutputPlanes + block * 4;
+            Ops::store(pOut[0] + outputOffset + x, acc0);
+            if (outCount > 1)
+                Ops::store(pOut[1] + outputOffset + x, acc1);
+            if (outCount > 2)
+                Ops::store(pOut[2] + outputOffset + x, acc2);
+            if (outCount > 3)
+                Ops::store(pOut[3] + outputOffset + x, acc3);
+        }
+    }
+}
+
+/**
+ * Computes row y of a convolution layer (without activation).
+ */
+template<typename Ops>
+inline void convRow(const ConvRowArgs& args, uint32_t y)
+{
+    const uint32_t vectorEnd = args.width - args.width % Ops::kWidth;
+    convSpan<Ops>(args, y, 0, vectorEnd);
+    convSpan<ScalarOps>(args, y, vectorEnd, args.width);
+}
+
+/**
+ * Evaluates a dense layer for a single sample. pOutput has to hold args.outputsPadded floats.
+ */
+template<typename Ops>
+inline void dense(const DenseArgs& args, const float* pInput, float* pOutput)
+{
+    for (uint32_t o = 0; o < args.outputsPadded; o += Ops::kWidth)
+    {
+        auto acc = Ops::load(args.pBias + o);
+        const float* pW = args.pWeights + o;
+        for (uint32_t i = 0; i < args.inputs; ++i, pW += args.outputsPadded)
+            acc = Ops::fmadd(Ops::set1(pInput[i]), Ops::load(pW), acc);
+        if (args.relu)
+            acc = Ops::max0(acc);
+        Ops::store(pOutput + o, acc);
+    }
+}
+} // namespace
+} // namespace cpu_inference
+} // namespace Falcor
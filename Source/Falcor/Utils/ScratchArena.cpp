@@ -0,0 +1,106 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "ScratchArena.h"
+#include "Core/Assert.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace Falcor
+{
+void* ScratchArena::do_allocate(size_t bytes, size_t alignment)
+{
+    FALCOR_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    bytes = std::max<size_t>(bytes, 1);
+
+    // Take the allocation from the current block, or move on to the next block that has room.
+    while (mBlockIndex < mBlocks.size())
+    {
+        Block& block = mBlocks[mBlockIndex];
+        const uintptr_t base = reinterpret_cast<uintptr_t>(block.pData.get());
+        const size_t offset = ((base + mOffset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (offset + bytes <= block.size)
+        {
+            mOffset = offset + bytes;
+            return block.pData.get() + offset;
+        }
+        if (mBlockIndex + 1 == mBlocks.size())
+            break;
+        mBlockIndex++;
+        mOffset = 0;
+    }
+
+    // Append a new block. Blocks are allocated with operator new[] and are aligned for any standard type.
+    const size_t size = std::max(mBlockSize, bytes + alignment);
+    mBlocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+    mBlockIndex = mBlocks.size() - 1;
+    mOffset = 0;
+    return do_allocate(bytes, alignment);
+}
+
+void ScratchArena::rewind(size_t blockIndex, size_t offset)
+{
+    FALCOR_ASSERT(blockIndex < mBlockIndex || (blockIndex == mBlockIndex && offset <= mOffset));
+    mBlockIndex = blockIndex;
+    mOffset = offset;
+
+    // Merge all blocks into one once the arena is empty, so that the next run fits into a single block.
+    // Memory beyond the maximum retained size is released.
+    if (mBlockIndex == 0 && mOffset == 0 && !mBlocks.empty())
+    {
+        const size_t capacity = getCapacity();
+        const size_t retainedSize = std::min(capacity, std::max(mBlockSize, mMaxRetainedSize));
+        if (mBlocks.size() > 1 || retainedSize < capacity)
+        {
+            mBlocks.clear();
+            mBlocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[retainedSize]), retainedSize});
+        }
+    }
+}
+
+size_t ScratchArena::getUsedSize() const
+{
+    size_t size = mOffset;
+    for (size_t i = 0; i < mBlockIndex && i < mBlocks.size(); ++i)
+        size += mBlocks[i].size;
+    return size;
+}
+
+size_t ScratchArena::getCapacity() const
+{
+    size_t capacity = 0;
+    for (const auto& block : mBlocks)
+        capacity += block.size;
+    return capacity;
+}
+
+ScratchArena& ScratchArena::getThreadLocal()
+{
+    static thread_local ScratchArena arena;
+    return arena;
+}
+} // namespace Falcor
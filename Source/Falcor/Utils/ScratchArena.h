@@ -0,0 +1,144 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Arena for temporary CPU allocations.
+ *
+ * Memory is bump allocated from a list of blocks and released in bulk when a Scope ends.
+ * The blocks are kept for reuse. Whenever the arena is rewound to the start, the blocks are merged into
+ * a single block, so that repeating a workload does not allocate from the system after the first run.
+ * The merged block is limited to the maximum retained size, so that a single large workload does not
+ * keep its memory alive for the lifetime of the arena (e.g. in the arena of a pool thread).
+ *
+ * ScratchArena implements std::pmr::memory_resource so it can back std::pmr containers.
+ * Deallocation is a no-op, memory is only reclaimed when the enclosing scope ends.
+ * An arena must only be used from a single thread, getThreadLocal() returns a separate arena per thread.
+ */
+class FALCOR_API ScratchArena : public std::pmr::memory_resource
+{
+public:
+    static constexpr size_t kDefaultBlockSize = 1 << 20;
+    static constexpr size_t kDefaultMaxRetainedSize = 16 << 20;
+
+    /**
+     * Records the current position of an arena and rewinds the arena to it on destruction.
+     * Scopes on the same arena must be strictly nested.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(ScratchArena& arena) : mArena(arena), mBlockIndex(arena.mBlockIndex), mOffset(arena.mOffset) {}
+        ~Scope() { mArena.rewind(mBlockIndex, mOffset); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ScratchArena& mArena;
+        size_t mBlockIndex;
+        size_t mOffset;
+    };
+
+    /**
+     * Create an arena.
+     * @param[in] blockSize Minimum size of the blocks allocated from the system.
+     * @param[in] maxRetainedSize Maximum capacity kept when the arena is rewound to the start. At least one block is kept.
+     */
+    explicit ScratchArena(size_t blockSize = kDefaultBlockSize, size_t maxRetainedSize = kDefaultMaxRetainedSize)
+        : mBlockSize(blockSize), mMaxRetainedSize(maxRetainedSize)
+    {}
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    /**
+     * Allocate uninitialized storage for an array of objects.
+     * Objects are never destroyed, so only trivially destructible types are allowed.
+     */
+    template<typename T>
+    T* allocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "ScratchArena objects are never destroyed");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * Rewind the arena to the start. This invalidates all allocations.
+     */
+    void reset() { rewind(0, 0); }
+
+    /**
+     * Returns the number of bytes in use, including alignment padding and unused space at the end of blocks.
+     */
+    size_t getUsedSize() const;
+
+    /**
+     * Returns the total size of the blocks owned by the arena.
+     */
+    size_t getCapacity() const;
+
+    /**
+     * Returns the number of blocks owned by the arena.
+     */
+    size_t getBlockCount() const { return mBlocks.size(); }
+
+    /**
+     * Returns the arena of the calling thread.
+     */
+    static ScratchArena& getThreadLocal();
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> pData;
+        size_t size;
+    };
+
+    void rewind(size_t blockIndex, size_t offset);
+
+    size_t mBlockSize;
+    size_t mMaxRetainedSize;
+    std::vector<Block> mBlocks;
+    size_t mBlockIndex = 0; ///< Block that allocations are currently taken from.
+    size_t mOffset = 0;     ///< Offset of the next free byte in the current block.
+};
+} // namespace Falcor
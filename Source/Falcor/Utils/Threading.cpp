@@ -26,18 +26,211 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "Threading.h"
-#include "Core/Assert.h"
+#include "Core/Errors.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <vector>
 
 namespace Falcor
 {
+struct Threading::TaskState
+{
+    std::function<void(void)> func;
+    std::atomic<bool> done{false};
+    std::exception_ptr exception;
+    std::vector<std::shared_ptr<TaskState>> continuations;
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
 namespace
 {
+using TaskStatePtr = std::shared_ptr<Threading::TaskState>;
+
+struct TaskQueue
+{
+    std::mutex mutex;
+    std::deque<TaskStatePtr> tasks;
+};
+
 struct ThreadingData
 {
-    bool initialized = false;
+    std::atomic<bool> initialized{false};
+    std::atomic<bool> stop{false};
     std::vector<std::thread> threads;
-    uint32_t current;
+    /// Per-worker task queues. Workers push/pop at the back, thieves take from the front.
+    std::vector<std::unique_ptr<TaskQueue>> workerQueues;
+    /// Queue for tasks dispatched from non-worker threads.
+    TaskQueue sharedQueue;
+    /// Number of tasks currently sitting in any of the queues.
+    std::atomic<size_t> queuedCount{0};
+    /// Number of tasks (including chained continuations) that have not finished yet.
+    std::atomic<size_t> pendingCount{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::mutex idleMutex;
+    std::condition_variable idleCondition;
 } gData; // TODO: REMOVEGLOBAL
+
+thread_local int32_t tWorkerIndex = -1;
+/// Number of tasks executing on this thread. Greater than one if a task helps out while waiting.
+thread_local uint32_t tTaskDepth = 0;
+
+constexpr std::chrono::milliseconds kHelpWaitInterval{1};
+
+TaskStatePtr createTaskState(std::function<void(void)> func)
+{
+    auto pState = std::make_shared<Threading::TaskState>();
+    pState->func = std::move(func);
+    gData.pendingCount.fetch_add(1);
+    return pState;
+}
+
+void enqueue(TaskStatePtr pState)
+{
+    gData.queuedCount.fetch_add(1);
+
+    TaskQueue& queue = tWorkerIndex >= 0 ? *gData.workerQueues[tWorkerIndex] : gData.sharedQueue;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(pState));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(gData.sleepMutex);
+    }
+    gData.sleepCondition.notify_one();
+}
+
+TaskStatePtr tryPop()
+{
+    if (gData.queuedCount.load() == 0)
+        return nullptr;
+
+    auto popFrom = [](TaskQueue& queue, bool back) -> TaskStatePtr
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return nullptr;
+        TaskStatePtr pState;
+        if (back)
+        {
+            pState = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            pState = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        gData.queuedCount.fetch_sub(1);
+        return pState;
+    };
+
+    const int32_t workerIndex = tWorkerIndex;
+    const size_t workerCount = gData.workerQueues.size();
+
+    // Own queue first (LIFO for cache locality), then the shared queue, then steal from other workers (FIFO).
+    if (workerIndex >= 0)
+    {
+        if (auto pState = popFrom(*gData.workerQueues[workerIndex], true))
+            return pState;
+    }
+    if (auto pState = popFrom(gData.sharedQueue, false))
+        return pState;
+    const size_t first = workerIndex >= 0 ? size_t(workerIndex) + 1 : 0;
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        size_t victim = (first + i) % workerCount;
+        if (int32_t(victim) == workerIndex)
+            continue;
+        if (auto pState = popFrom(*gData.workerQueues[victim], false))
+            return pState;
+    }
+    return nullptr;
+}
+
+void submit(TaskStatePtr pState);
+
+void execute(const TaskStatePtr& pState)
+{
+    tTaskDepth++;
+    try
+    {
+        pState->func();
+    }
+    catch (...)
+    {
+        pState->exception = std::current_exception();
+    }
+    tTaskDepth--;
+    pState->func = nullptr;
+
+    std::vector<TaskStatePtr> continuations;
+    {
+        std::lock_guard<std::mutex> lock(pState->mutex);
+        pState->done.store(true);
+        continuations.swap(pState->continuations);
+    }
+    pState->condition.notify_all();
+
+    for (auto& pContinuation : continuations)
+        submit(std::move(pContinuation));
+
+    if (gData.pendingCount.fetch_sub(1) == 1)
+    {
+        {
+            std::lock_guard<std::mutex> lock(gData.idleMutex);
+        }
+        gData.idleCondition.notify_all();
+    }
+}
+
+void submit(TaskStatePtr pState)
+{
+    if (gData.initialized.load())
+        enqueue(std::move(pState));
+    else
+        execute(pState);
+}
+
+void waitForTask(const TaskStatePtr& pState)
+{
+    while (!pState->done.load())
+    {
+        if (auto pOther = tryPop())
+        {
+            execute(pOther);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(pState->mutex);
+        pState->condition.wait_for(lock, kHelpWaitInterval, [&]() { return pState->done.load(); });
+    }
+}
+
+void workerMain(int32_t workerIndex)
+{
+    tWorkerIndex = workerIndex;
+
+    while (true)
+    {
+        if (auto pState = tryPop())
+        {
+            execute(pState);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(gData.sleepMutex);
+        gData.sleepCondition.wait(lock, []() { return gData.queuedCount.load() > 0 || gData.stop.load(); });
+        if (gData.stop.load() && gData.queuedCount.load() == 0)
+            break;
+    }
+
+    tWorkerIndex = -1;
+}
 } // namespace
 
 void Threading::start(uint32_t threadCount)
@@ -45,52 +238,174 @@ void Threading::start(uint32_t threadCount)
     if (gData.initialized)
         return;
 
-    gData.threads.resize(threadCount);
+    threadCount = std::max(threadCount, 1u);
+
+    gData.stop = false;
+    gData.workerQueues.resize(threadCount);
+    for (auto& pQueue : gData.workerQueues)
+        pQueue = std::make_unique<TaskQueue>();
+    gData.threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+        gData.threads.emplace_back(workerMain, int32_t(i));
+
     gData.initialized = true;
 }
 
 void Threading::shutdown()
 {
+    if (!gData.initialized)
+        return;
+
+    finish();
+
+    {
+        std::lock_guard<std::mutex> lock(gData.sleepMutex);
+        gData.stop = true;
+    }
+    gData.sleepCondition.notify_all();
+
     for (auto& t : gData.threads)
     {
         if (t.joinable())
             t.join();
     }
 
+    gData.threads.clear();
+    gData.workerQueues.clear();
     gData.initialized = false;
 }
 
-Threading::Task Threading::dispatchTask(const std::function<void(void)>& func)
+bool Threading::isStarted()
 {
-    FALCOR_ASSERT(gData.initialized);
+    return gData.initialized;
+}
 
-    std::thread& t = gData.threads[gData.current];
-    if (t.joinable())
-        t.join();
-    t = std::thread(func);
-    gData.current = (gData.current + 1) % gData.threads.size();
+uint32_t Threading::getThreadCount()
+{
+    return gData.initialized ? (uint32_t)gData.threads.size() : 0;
+}
 
-    return Task();
+int32_t Threading::getCurrentWorkerIndex()
+{
+    return tWorkerIndex;
+}
+
+Threading::Task Threading::dispatchTask(std::function<void(void)> func)
+{
+    auto pState = createTaskState(std::move(func));
+    submit(pState);
+    return Task(pState);
+}
+
+void Threading::parallelForChunked(size_t begin, size_t end, const std::function<void(size_t, size_t)>& func, size_t grainSize)
+{
+    if (end <= begin)
+        return;
+
+    const size_t count = end - begin;
+    const size_t threadCount = getThreadCount();
+    if (grainSize == 0)
+        grainSize = std::max<size_t>(1, (count + (threadCount + 1) * 4 - 1) / ((threadCount + 1) * 4));
+    const size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+    if (threadCount == 0 || chunkCount == 1)
+    {
+        func(begin, end);
+        return;
+    }
+
+    // Chunks are handed out through an atomic counter to a small number of helper tasks.
+    // The calling thread processes chunks as well and then helps with other queued work while waiting.
+    std::atomic<size_t> nextChunk{0};
+    std::mutex exceptionMutex;
+    std::exception_ptr exception;
+
+    auto processChunks = [&]()
+    {
+        size_t chunk;
+        while ((chunk = nextChunk.fetch_add(1)) < chunkCount)
+        {
+            const size_t chunkBegin = begin + chunk * grainSize;
+            const size_t chunkEnd = std::min(end, chunkBegin + grainSize);
+            try
+            {
+                func(chunkBegin, chunkEnd);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(exceptionMutex);
+                if (!exception)
+                    exception = std::current_exception();
+                nextChunk = chunkCount;
+            }
+        }
+    };
+
+    const size_t helperCount = std::min(chunkCount - 1, threadCount);
+    std::vector<Task> helpers;
+    helpers.reserve(helperCount);
+    for (size_t i = 0; i < helperCount; ++i)
+        helpers.push_back(dispatchTask(processChunks));
+
+    processChunks();
+
+    for (const auto& helper : helpers)
+        waitForTask(helper.mpState);
+
+    if (exception)
+        std::rethrow_exception(exception);
 }
 
 void Threading::finish()
 {
-    for (auto& t : gData.threads)
+    if (!gData.initialized)
+        return;
+
+    // The pending tasks include the calling task, so waiting for all of them would never return.
+    if (tTaskDepth > 0)
+        throw RuntimeError("Threading::finish() must not be called from within a task. Use Task::finish() to wait for specific tasks.");
+
+    while (gData.pendingCount.load() > 0)
     {
-        if (t.joinable())
-            t.join();
+        if (auto pState = tryPop())
+        {
+            execute(pState);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(gData.idleMutex);
+        gData.idleCondition.wait_for(lock, kHelpWaitInterval, []() { return gData.pendingCount.load() == 0; });
     }
 }
 
-Threading::Task::Task() {}
+bool Threading::Task::isRunning() const
+{
+    return mpState && !mpState->done.load();
+}
 
-bool Threading::Task::isRunning()
+void Threading::Task::finish() const
 {
-    FALCOR_UNIMPLEMENTED();
+    if (!mpState)
+        return;
+
+    waitForTask(mpState);
+
+    if (mpState->exception)
+        std::rethrow_exception(mpState->exception);
 }
 
-void Threading::Task::finish()
+Threading::Task Threading::Task::then(std::function<void(void)> func) const
 {
-    FALCOR_UNIMPLEMENTED();
+    auto pNext = createTaskState(std::move(func));
+    if (mpState)
+    {
+        std::lock_guard<std::mutex> lock(mpState->mutex);
+        if (!mpState->done.load())
+        {
+            mpState->continuations.push_back(pNext);
+            return Task(pNext);
+        }
+    }
+    submit(pNext);
+    return Task(pNext);
 }
 } // namespace Falcor
@@ -29,52 +29,98 @@
 #include "Core/Macros.h"
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <cstdint>
 
 namespace Falcor
 {
+/**
+ * Global task scheduler.
+ *
+ * The scheduler owns a set of persistent worker threads. Each worker has its own task deque, tasks spawned
+ * from a worker thread are pushed to that worker's deque and idle workers steal from the other deques.
+ * Tasks dispatched from non-worker threads are pushed to a shared queue.
+ * Threads waiting on a task (or in parallelFor()) help executing queued tasks, so tasks can safely wait on
+ * tasks they have spawned themselves.
+ */
 class FALCOR_API Threading
 {
 public:
     const static uint32_t kDefaultThreadCount = 16;
 
+    struct TaskState;
+
     /**
-     * Handle to a dispatched task
-     *
-     * TODO: Implementation
+     * Handle to a dispatched task.
+     * Handles are cheap to copy, all copies refer to the same task.
      */
-    class Task
+    class FALCOR_API Task
     {
     public:
-        ///  Check if task is still executing
-        bool isRunning();
+        /// Create an empty task handle. An empty handle is never running.
+        Task() = default;
+
+        /// Check if the handle refers to a task.
+        bool isValid() const { return mpState != nullptr; }
+
+        /// Check if task is still executing (or waiting to be executed).
+        bool isRunning() const;
+
+        /**
+         * Wait for task to finish executing.
+         * The calling thread executes other queued tasks while waiting.
+         * If the task function has thrown an exception, it is rethrown here.
+         */
+        void finish() const;
 
-        /// Wait for task to finish executing
-        void finish();
+        /**
+         * Chain a task that is dispatched once this task has finished.
+         * If this task has already finished (or the handle is empty), the continuation is dispatched immediately.
+         * @param[in] func Function to execute.
+         * @return Handle to the continuation task.
+         */
+        Task then(std::function<void(void)> func) const;
 
     private:
-        Task();
+        Task(std::shared_ptr<TaskState> pState) : mpState(std::move(pState)) {}
+        std::shared_ptr<TaskState> mpState;
         friend class Threading;
     };
 
     /**
      * Initializes the global thread pool
-     * @param[in] threadCount Number of threads in the pool
+     * @param[in] threadCount Number of worker threads in the pool
      */
     static void start(uint32_t threadCount = kDefaultThreadCount);
 
     /**
-     * Waits for all currently executing threads to finish
+     * Waits for all currently dispatched tasks to finish.
+     * Must not be called from within a task, as it would wait for the calling task itself. Throws a RuntimeError in that case.
      */
     static void finish();
 
     /**
-     * Waits for all currently executing threads to finish and shuts down the thread pool
+     * Waits for all currently dispatched tasks to finish and shuts down the thread pool
      */
     static void shutdown();
 
+    /**
+     * Returns true if the thread pool is running.
+     */
+    static bool isStarted();
+
+    /**
+     * Returns the number of worker threads in the pool (0 if the pool is not running).
+     */
+    static uint32_t getThreadCount();
+
+    /**
+     * Returns the index of the worker thread calling this function, or -1 if called from a non-worker thread.
+     */
+    static int32_t getCurrentWorkerIndex();
+
     /**
      * Returns the maximum number of concurrent threads supported by the hardware
      */
@@ -84,7 +130,41 @@ public:
      * Starts a task on an available thread.
      * @return Handle to the task
      */
-    static Task dispatchTask(const std::function<void(void)>& func);
+    static Task dispatchTask(std::function<void(void)> func);
+
+    /**
+     * Execute a function over a range in parallel, split into chunks.
+     * The calling thread participates in the work and the call returns once all chunks have finished.
+     * If the thread pool is not running, the range is processed serially on the calling thread.
+     * If any invocation throws, the first exception is rethrown after all chunks have finished.
+     * @param[in] begin First index of the range.
+     * @param[in] end One past the last index of the range.
+     * @param[in] func Function called as func(chunkBegin, chunkEnd) for each chunk.
+     * @param[in] grainSize Minimum number of indices per chunk (0 selects a chunk size automatically).
+     */
+    static void parallelForChunked(size_t begin, size_t end, const std::function<void(size_t, size_t)>& func, size_t grainSize = 0);
+
+    /**
+     * Execute a function for every index in a range in parallel.
+     * See parallelForChunked() for details.
+     * @param[in] begin First index of the range.
+     * @param[in] end One past the last index of the range.
+     * @param[in] func Function called as func(index) for each index.
+     * @param[in] grainSize Minimum number of indices per chunk (0 selects a chunk size automatically).
+     */
+    template<typename Func>
+    static void parallelFor(size_t begin, size_t end, Func&& func, size_t grainSize = 0)
+    {
+        parallelForChunked(
+            begin, end,
+            [&func](size_t chunkBegin, size_t chunkEnd)
+            {
+                for (size_t i = chunkBegin; i < chunkEnd; ++i)
+                    func(i);
+            },
+            grainSize
+        );
+    }
 };
 
 /**
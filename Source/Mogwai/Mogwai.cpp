@@ -545,6 +545,7 @@ namespace Mogwai
     {
         if (mOptions.useSceneCache) buildFlags |= SceneBuilder::Flags::UseCache;
         if (mOptions.rebuildSceneCache) buildFlags |= SceneBuilder::Flags::RebuildCache;
+        if (mOptions.uncompressedSceneCache) buildFlags |= SceneBuilder::Flags::UncompressedCache;
 
         while (true)
         {
@@ -866,6 +867,7 @@ int main(int argc, char** argv)
     args::Flag deferredFlag(parser, "deferred", "The script is loaded deferred.", {"deferred"});
     args::ValueFlag<std::string> sceneFlag(parser, "path", "Scene file (for example, a .pyscene file) to open.", { 'S', "scene" });
     args::ValueFlag<std::string> shaderCacheFlag(parser, "shadercache", "Path to the GFX shader cache.", { "shadercache" });
+    args::ValueFlag<uint32_t> shaderCacheEntriesFlag(parser, "count", "Maximum number of entries in the GFX shader cache (0=unlimited).", { "shadercache-entries" });
     args::ValueFlag<std::string> logfileFlag(parser, "path", "File to write log into.", {'l', "logfile"});
     args::ValueFlag<int32_t> verbosityFlag(parser, "verbosity", "Logging verbosity (0=disabled, 1=fatal errors, 2=errors, 3=warnings, 4=infos, 5=debugging)", { 'v', "verbosity" }, 4);
     args::Flag silentFlag(parser, "", "Start without opening a window and handling user input (deprecated: use --headless).", {"silent"});
@@ -874,6 +876,7 @@ int main(int argc, char** argv)
     args::ValueFlag<uint32_t> heightFlag(parser, "pixels", "Initial window height.", {"height"});
     args::Flag useSceneCacheFlag(parser, "", "Use scene cache to improve scene load times.", {'c', "use-cache"});
     args::Flag rebuildSceneCacheFlag(parser, "", "Rebuild the scene cache.", {"rebuild-cache"});
+    args::Flag uncompressedSceneCacheFlag(parser, "", "Use a scene cache with uncompressed, memory mapped mesh data.", {"uncompressed-cache"});
     args::Flag generateShaderDebugInfoFlag(parser, "", "Generate shader debug info.", {"debug-shaders"});
     args::Flag enableDebugLayerFlag(parser, "", "Enable debug layer (enabled by default in Debug build).", {"enable-debug-layer"});
     args::Flag preciseProgramFlag(parser, "", "Force all slang programs to run in precise mode", { "precise" });
@@ -950,6 +953,8 @@ int main(int argc, char** argv)
         config.headless = true;
     if (shaderCacheFlag)
         config.deviceDesc.shaderCachePath = args::get(shaderCacheFlag);
+    if (shaderCacheEntriesFlag)
+        config.deviceDesc.maxShaderCacheEntryCount = args::get(shaderCacheEntriesFlag);
     if (enableDebugLayerFlag)
         config.deviceDesc.enableDebugLayer = true;
     if (generateShaderDebugInfoFlag)
@@ -979,6 +984,7 @@ int main(int argc, char** argv)
     if (silentFlag) options.silentMode = true;
     if (useSceneCacheFlag) options.useSceneCache = true;
     if (rebuildSceneCacheFlag) options.rebuildSceneCache = true;
+    if (uncompressedSceneCacheFlag) options.uncompressedSceneCache = true;
 
     try
     {
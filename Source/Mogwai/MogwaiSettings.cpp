@@ -31,6 +31,7 @@
 #include "Utils/Scripting/Console.h"
 #include "Utils/Settings.h"
 #include <iomanip>
+#include <optional>
 #include <sstream>
 
 namespace Mogwai
@@ -243,11 +244,41 @@ namespace Mogwai
                 << "Program version time (total): " << s.programVersionTotalTime << " s" << std::endl
                 << "Program kernels time (total): " << s.programKernelsTotalTime << " s" << std::endl
                 << "Program version time (max): " << s.programVersionMaxTime << " s" << std::endl
-                << "Program kernels time (max): " << s.programKernelsMaxTime << " s" << std::endl;
+                << "Program kernels time (max): " << s.programKernelsMaxTime << " s" << std::endl
+                << "Version pool hits: " << s.versionPoolHitCount << std::endl
+                << "Shader cache hits: " << s.shaderCacheHitCount << std::endl
+                << "Shader cache misses: " << s.shaderCacheMissCount << std::endl
+                << "Shader cache entries: " << s.shaderCacheEntryCount << std::endl;
             g.text(oss.str());
 
             if (g.button("Reset"))
                 mpRenderer->getDevice()->getProgramManager()->resetCompilationStats();
+
+            // Scanning the shader cache touches every file in it, so only do it on request.
+            static std::optional<Device::ShaderCacheUsage> shaderCacheUsage;
+            if (g.button("Scan shader cache"))
+                shaderCacheUsage = mpRenderer->getDevice()->getShaderCacheUsage();
+            if (shaderCacheUsage)
+            {
+                std::ostringstream cacheOss;
+                cacheOss << "Shader cache size: " << shaderCacheUsage->fileCount << " files, " << std::fixed << std::setprecision(1)
+                         << shaderCacheUsage->size / (1024.0 * 1024.0) << " MB" << std::endl;
+                g.text(cacheOss.str());
+            }
+
+            if (const RenderGraph* pGraph = mpRenderer->getActiveGraph())
+            {
+                const auto& c = pGraph->getCompileStats();
+                std::ostringstream graphOss;
+                size_t passCount = c.compiledPasses.size() + c.reusedPasses.size();
+                graphOss << "Graph compilation:" << std::endl
+                         << "Compiled passes: " << c.compiledPasses.size() << " / " << passCount << std::endl
+                         << "Reused resources: " << c.reusedResourceCount << " / " << c.resourceCount << std::endl
+                         << "Compile time: " << c.compileTime * 1000.0 << " ms" << std::endl;
+                g.text(graphOss.str());
+                if (c.compiledPasses.size())
+                    g.tooltip(joinStrings(c.compiledPasses, "\n"));
+            }
         }
 
         // Scene UI
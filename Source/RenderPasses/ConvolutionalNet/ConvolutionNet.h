@@ -2,6 +2,7 @@
 #include "Falcor.h"
 #include <sstream>
 #include "../Utils/npy.h"
+#include "Utils/Neural/CpuInference.h"
 
 struct ConvolutionNet
 {
@@ -259,6 +260,45 @@ struct ConvolutionNet
         return res;
     }
 
+    /**
+     * \brief creates a CPU reference implementation of the network
+     * \param clampOutput true if the last layer uses the clamp activation (see ConvolutionalNet::createShader)
+     * \param precision precision of the intermediate layer textures
+     * \return network that evaluates the same layers as the generated shaders
+     */
+    Falcor::CpuConvNet createCpuNet(bool clampOutput, Precision precision) const
+    {
+        Falcor::CpuConvNet net;
+        for (size_t layer = 0; layer < kernels.size(); ++layer)
+        {
+            const auto& k = kernels[layer];
+            const auto& b = biases[layer];
+
+            Falcor::CpuConvNet::Layer cpuLayer;
+            cpuLayer.kernelWidth = k.kernelWidth;
+            cpuLayer.kernelHeight = k.kernelHeight;
+            cpuLayer.channelsIn = k.channelsIn;
+            cpuLayer.channelsOut = k.channelsOut;
+            cpuLayer.weights.resize(k.data.size());
+            for (int kx = 0; kx < k.kernelWidth; ++kx)
+                for (int ky = 0; ky < k.kernelHeight; ++ky)
+                    for (int chIn = 0; chIn < k.channelsIn; ++chIn)
+                        for (int chOut = 0; chOut < k.channelsOut; ++chOut)
+                            cpuLayer.weights[((kx * k.kernelHeight + ky) * k.channelsIn + chIn) * k.channelsOut + chOut] = k.get(kx, ky, chIn, chOut);
+            cpuLayer.bias = b.data;
+
+            cpuLayer.activation = Falcor::CpuConvNet::Activation::ReLU;
+            if (layer == kernels.size() - 1)
+                cpuLayer.activation = clampOutput ? Falcor::CpuConvNet::Activation::Clamp : Falcor::CpuConvNet::Activation::None;
+
+            net.addLayer(cpuLayer);
+        }
+
+        if (precision == Precision::Half) net.setIntermediatePrecision(Falcor::CpuConvNet::Precision::Half);
+        else if (precision == Precision::UNorm) net.setIntermediatePrecision(Falcor::CpuConvNet::Precision::UNorm);
+        return net;
+    }
+
     int getLayerCount() const { return int(kernels.size()); }
     int getOutputChannelCount(int layer) const { return kernels[layer].channelsOut; }
     int getInputChannelCount(int layer) const { return kernels[layer].channelsIn; }
@@ -51,6 +51,7 @@ namespace
     const std::string kReportRunningError = "ReportRunningError";
     const std::string kRunningErrorSigma = "RunningErrorSigma";
     const std::string kSelectedOutputId = "SelectedOutputId";
+    const std::string kReductionBackend = "ReductionBackend";
 }
 
 extern "C" FALCOR_API_EXPORT void registerPlugin(Falcor::PluginRegistry& registry)
@@ -84,6 +85,7 @@ ErrorMeasurePass::ErrorMeasurePass(ref<Device> pDevice, const Properties& props)
         else if (key == kReportRunningError) mReportRunningError = value;
         else if (key == kRunningErrorSigma) mRunningErrorSigma = value;
         else if (key == kSelectedOutputId) mSelectedOutputId = value;
+        else if (key == kReductionBackend) mReductionBackend = value;
         else
         {
             logWarning("Unknown property '{}' in ErrorMeasurePass properties.", key);
@@ -94,7 +96,7 @@ ErrorMeasurePass::ErrorMeasurePass(ref<Device> pDevice, const Properties& props)
     loadReference();
     openMeasurementsFile();
 
-    mpParallelReduction = std::make_unique<ParallelReduction>(mpDevice);
+    mpParallelReduction = std::make_unique<ParallelReduction>(mpDevice, mReductionBackend);
     mpErrorMeasurerPass = ComputePass::create(mpDevice, kErrorComputationShaderFile);
 }
 
@@ -110,6 +112,7 @@ Properties ErrorMeasurePass::getProperties() const
     props[kReportRunningError] = mReportRunningError;
     props[kRunningErrorSigma] = mRunningErrorSigma;
     props[kSelectedOutputId] = mSelectedOutputId;
+    props[kReductionBackend] = mReductionBackend;
     return props;
 }
 
@@ -272,6 +275,9 @@ void ErrorMeasurePass::renderUI(Gui::Widgets& widget)
     widget.checkbox("Compute RGB average", mComputeAverage);
     widget.tooltip("When enabled, the average error over the RGB components is computed when creating the difference image.\n"
         "The average is computed after squaring the differences when L2 error is selected.");
+    if (widget.dropdown("Reduction backend", mReductionBackend)) mpParallelReduction->setBackend(mReductionBackend);
+    widget.tooltip("Compute the error sum with compute passes on the GPU or multithreaded on the CPU.\n"
+        "The CPU backend reads back the difference image, which requires a GPU flush.");
 
     widget.checkbox("Use loaded reference image", mUseLoadedReference);
     widget.tooltip("Take the reference from the loaded image instead or the input channel.\n\n"
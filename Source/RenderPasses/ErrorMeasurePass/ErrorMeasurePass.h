@@ -102,6 +102,7 @@ private:
     float                   mRunningErrorSigma = 0.995f;        ///< Coefficient used for the exponential moving average. Larger values mean slower response.
 
     OutputId                mSelectedOutputId = OutputId::Source;
+    ParallelReduction::Backend mReductionBackend = ParallelReduction::Backend::GPU; ///< Backend used for summing the difference image.
 
     static const Gui::RadioButtonGroup sOutputSelectionButtons;
     static const Gui::RadioButtonGroup sOutputSelectionButtonsSourceOnly;
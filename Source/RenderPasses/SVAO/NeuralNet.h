@@ -2,6 +2,7 @@
 #include "Falcor.h"
 #include <sstream>
 #include "../Utils/npy.h"
+#include "Utils/Neural/CpuInference.h"
 
 // helper class that loads a neural net from a file
 struct NeuralNet
@@ -51,6 +52,26 @@ struct NeuralNet
         if (kernels.size() == 0)
             throw std::exception("Failed to load neural nets");
     }
+
+    // creates a CPU reference implementation (hidden layers use relu, the last layer is linear).
+    // weights with a magnitude below weightThreshold are dropped, like in the generated shader code.
+    Falcor::CpuDenseNet createCpuNet(float weightThreshold = 0.0f) const
+    {
+        Falcor::CpuDenseNet net;
+        for (size_t l = 0; l < kernels.size(); ++l)
+        {
+            Falcor::CpuDenseNet::Layer layer;
+            layer.inputs = kernels[l].rows;
+            layer.outputs = kernels[l].columns;
+            layer.weights = kernels[l].data;
+            for (auto& w : layer.weights)
+                if (std::abs(w) <= weightThreshold) w = 0.0f;
+            layer.bias = biases[l].data;
+            layer.activation = l + 1 == kernels.size() ? Falcor::CpuDenseNet::Activation::None : Falcor::CpuDenseNet::Activation::ReLU;
+            net.addLayer(layer);
+        }
+        return net;
+    }
     
     std::vector<Matrix> kernels;
     std::vector<Matrix> biases;
@@ -84,6 +105,24 @@ public:
         mLayers = (int)mNets[0].kernels.size();
     }
 
+    // magnitude below which weights are skipped in the generated shader code
+    static constexpr float kWeightThreshold = 0.0001f;
+
+    // CPU reference implementation of the generated evalClassifier/evalRegressor function
+    Falcor::CpuDenseNet createCpuNet(int net = 0) const
+    {
+        return mNets[net].createCpuNet(kWeightThreshold);
+    }
+
+    // bitmask returned by evalClassifier for the outputs of the CPU reference
+    static uint32_t getClassifierBitmask(const float* outputs, int count, float treshold = 0.0f)
+    {
+        uint32_t bitmask = 0;
+        for (int i = 0; i < count; ++i)
+            if (outputs[i] > treshold) bitmask |= 1u << i;
+        return bitmask;
+    }
+
     void writeDefinesToFile(const std::string& filename) const
     {
         std::ofstream file(filename);
@@ -157,7 +196,7 @@ private:
                 auto kernel = net.kernels[l];
                 auto bias = net.biases[l];
 
-                float weightThreshold = 0.0001f;
+                float weightThreshold = kWeightThreshold;
 
                 // load bias
                 //ss << "\tfloat layer" << l << "Output[" << bias.columns << "];\n";
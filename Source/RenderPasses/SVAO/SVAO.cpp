@@ -26,7 +26,9 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "SVAO.h"
+#include "Core/Program/ProgramManager.h"
 #include "RenderGraph/RenderGraph.h"
+#include "Utils/Threading.h"
 #include "../Utils/GuardBand/guardband.h"
 
 namespace
@@ -218,42 +220,17 @@ void SVAO::execute(RenderContext* pRenderContext, const RenderData& renderData)
         std::filesystem::path resPath;
         auto foundShader = findFileInShaderDirectories("RenderPasses/SVAO/SVAORaster.ps.slang", resPath);
 
-        DefineList defines;
-        defines.add("PRIMARY_DEPTH_MODE", std::to_string(uint32_t(mPrimaryDepthMode)));
-        defines.add("SECONDARY_DEPTH_MODE", std::to_string(uint32_t(mSecondaryDepthMode)));
-        defines.add("MSAA_SAMPLES", std::to_string(mStochSamples)); // TODO update this from gui
-        defines.add("TRACE_OUT_OF_SCREEN", mTraceOutOfScreen ? "1" : "0");
-        defines.add("STOCHASTIC_DEPTH_IMPL", std::to_string(uint32_t(mStochasticDepthImpl)));
-        defines.add("STOCH_MAP_DIVISOR", std::to_string(mStochMapDivisor) + "u");
-        defines.add("STOCH_MAP_NORMALS", mStochMapNormals ? "1" : "0");
-        defines.add("SD_JITTER", (mStochMapJitter && (mStochasticDepthImpl == Ray)) ? "1" : "0"); // only implemented for ray version
-        defines.add("DUAL_AO", mDualAo ? "1" : "0");
-        defines.add("USE_ALPHA_TEST", mAlphaTest ? "1" : "0");
-        defines.add("USE_RAY_INTERVAL", mUseRayInterval ? "1" : "0");
-        defines.add("AO_KERNEL", std::to_string(uint32_t(mKernel)));
         auto rayConeSpread = mpScene->getCamera()->computeScreenSpacePixelSpreadAngle(renderData.getDefaultTextureDims().y);
-        defines.add("RAY_CONE_SPREAD", std::to_string(rayConeSpread));
-        defines.add("CULL_MODE_RAY_FLAG", RasterizerState::CullModeToRayFlag(mCullMode));
-        defines.add("NUM_DIRECTIONS", std::to_string(mSampleCount));
-        defines.add(mpScene->getSceneDefines());
+        DefineList defines = getProgramDefines(rayConeSpread);
 
+        if (!mProgramsPrewarmed)
         {
-            Program::Desc csdesc;
-            csdesc.addShaderModules(mpScene->getShaderModules());
-            csdesc.addShaderLibrary(kRasterShader).csEntry("main");
-            csdesc.addTypeConformances(mpScene->getTypeConformances());
-            csdesc.setShaderModel("6_5");
-            mpComputePass = ComputePass::create(mpDevice, csdesc, defines);
+            prewarmPrograms(defines);
+            mProgramsPrewarmed = true;
         }
 
-        {
-            Program::Desc csdesc;
-            csdesc.addShaderModules(mpScene->getShaderModules());
-            csdesc.addShaderLibrary(kRasterShader2).csEntry("main");
-            csdesc.addTypeConformances(mpScene->getTypeConformances());
-            csdesc.setShaderModel("6_5");
-            mpComputePass2 = ComputePass::create(mpDevice, csdesc, defines);
-        }
+        mpComputePass = ComputePass::create(mpDevice, getComputeProgramDesc(kRasterShader), defines);
+        mpComputePass2 = ComputePass::create(mpDevice, getComputeProgramDesc(kRasterShader2), defines);
 
         // raster pass 2
         //csdesc.addShaderLibrary(kRasterShader2).csEntry("main");
@@ -261,20 +238,8 @@ void SVAO::execute(RenderContext* pRenderContext, const RenderData& renderData)
         //mpRasterPass2->getState()->setDepthStencilState(mpDepthStencilState);
 
         // ray pass
-        RtProgram::Desc desc;
-        desc.addShaderModules(mpScene->getShaderModules());
-        desc.addShaderLibrary(kRayShader);
-        desc.setMaxPayloadSize(kMaxPayloadSizePreventDarkHalos);
-        desc.setMaxAttributeSize(mpScene->getRaytracingMaxAttributeSize());
-        desc.setMaxTraceRecursionDepth(1);
-        desc.addTypeConformances(mpScene->getTypeConformances());
-        desc.setShaderModel("6_5");
-
-        auto sbt = RtBindingTable::create(1, 1, mpScene->getGeometryCount());
-        sbt->setRayGen(desc.addRayGen("rayGen"));
-        sbt->setMiss(0, desc.addMiss("miss"));
-        sbt->setHitGroup(0, mpScene->getGeometryIDs(GeometryType::TriangleMesh), desc.addHitGroup("closestHit", "anyHit"));
-        // TODO add remaining primitives
+        ref<RtBindingTable> sbt;
+        RtProgram::Desc desc = getRayProgramDesc(sbt);
         mpRayProgram = RtProgram::create(mpDevice, desc, defines);
         mRayVars = RtProgramVars::create(mpDevice, mpRayProgram, sbt);
         mDirty = true;
@@ -656,10 +621,114 @@ void SVAO::setScene(RenderContext* pRenderContext, const ref<Scene>& pScene)
     mpComputePass.reset();
     mpComputePass2.reset();
     mpRayProgram.reset();
+    mProgramsPrewarmed = false;
     if (mpStochasticDepthGraph)
         mpStochasticDepthGraph->setScene(pScene);
 }
 
+DefineList SVAO::getProgramDefines(float rayConeSpread) const
+{
+    DefineList defines;
+    defines.add("PRIMARY_DEPTH_MODE", std::to_string(uint32_t(mPrimaryDepthMode)));
+    defines.add("SECONDARY_DEPTH_MODE", std::to_string(uint32_t(mSecondaryDepthMode)));
+    defines.add("MSAA_SAMPLES", std::to_string(mStochSamples)); // TODO update this from gui
+    defines.add("TRACE_OUT_OF_SCREEN", mTraceOutOfScreen ? "1" : "0");
+    defines.add("STOCHASTIC_DEPTH_IMPL", std::to_string(uint32_t(mStochasticDepthImpl)));
+    defines.add("STOCH_MAP_DIVISOR", std::to_string(mStochMapDivisor) + "u");
+    defines.add("STOCH_MAP_NORMALS", mStochMapNormals ? "1" : "0");
+    defines.add("SD_JITTER", (mStochMapJitter && (mStochasticDepthImpl == Ray)) ? "1" : "0"); // only implemented for ray version
+    defines.add("DUAL_AO", mDualAo ? "1" : "0");
+    defines.add("USE_ALPHA_TEST", mAlphaTest ? "1" : "0");
+    defines.add("USE_RAY_INTERVAL", mUseRayInterval ? "1" : "0");
+    defines.add("AO_KERNEL", std::to_string(uint32_t(mKernel)));
+    defines.add("RAY_CONE_SPREAD", std::to_string(rayConeSpread));
+    defines.add("CULL_MODE_RAY_FLAG", RasterizerState::CullModeToRayFlag(mCullMode));
+    defines.add("NUM_DIRECTIONS", std::to_string(mSampleCount));
+    defines.add(mpScene->getSceneDefines());
+    return defines;
+}
+
+Program::Desc SVAO::getComputeProgramDesc(const std::string& filename) const
+{
+    Program::Desc desc;
+    desc.addShaderModules(mpScene->getShaderModules());
+    desc.addShaderLibrary(filename).csEntry("main");
+    desc.addTypeConformances(mpScene->getTypeConformances());
+    desc.setShaderModel("6_5");
+    return desc;
+}
+
+RtProgram::Desc SVAO::getRayProgramDesc(ref<RtBindingTable>& sbt) const
+{
+    RtProgram::Desc desc;
+    desc.addShaderModules(mpScene->getShaderModules());
+    desc.addShaderLibrary(kRayShader);
+    desc.setMaxPayloadSize(kMaxPayloadSizePreventDarkHalos);
+    desc.setMaxAttributeSize(mpScene->getRaytracingMaxAttributeSize());
+    desc.setMaxTraceRecursionDepth(1);
+    desc.addTypeConformances(mpScene->getTypeConformances());
+    desc.setShaderModel("6_5");
+
+    sbt = RtBindingTable::create(1, 1, mpScene->getGeometryCount());
+    sbt->setRayGen(desc.addRayGen("rayGen"));
+    sbt->setMiss(0, desc.addMiss("miss"));
+    sbt->setHitGroup(0, mpScene->getGeometryIDs(GeometryType::TriangleMesh), desc.addHitGroup("closestHit", "anyHit"));
+    // TODO add remaining primitives
+    return desc;
+}
+
+void SVAO::prewarmPrograms(const DefineList& defines)
+{
+    // Without worker threads the variants would be compiled one after another on the first frame.
+    if (!Threading::isStarted())
+        return;
+
+    // Variants that differ from the current settings in one of the options that the UI shows right now.
+    std::vector<DefineList> variants;
+    auto addVariant = [&](std::initializer_list<std::pair<std::string, std::string>> changes)
+    {
+        DefineList variant = defines;
+        for (const auto& [name, value] : changes)
+            variant.add(name, value);
+        if (variant != defines && std::find(variants.begin(), variants.end(), variant) == variants.end())
+            variants.push_back(variant);
+    };
+
+    if (mSecondaryDepthMode == DepthMode::StochasticDepth)
+    {
+        auto otherImpl = mStochasticDepthImpl == Raster ? Ray : Raster;
+        addVariant({{"STOCHASTIC_DEPTH_IMPL", std::to_string(uint32_t(otherImpl))}, {"SD_JITTER", (mStochMapJitter && otherImpl == Ray) ? "1" : "0"}});
+    }
+    addVariant({{"AO_KERNEL", std::to_string(uint32_t(mKernel == AOKernel::VAO ? AOKernel::HBAO : AOKernel::VAO))}});
+    addVariant({{"PRIMARY_DEPTH_MODE", std::to_string(uint32_t(mPrimaryDepthMode == DepthMode::SingleDepth ? DepthMode::DualDepth : DepthMode::SingleDepth))}});
+    for (auto mode : {DepthMode::SingleDepth, DepthMode::StochasticDepth, DepthMode::Raytraced})
+    {
+        // the ui switches the cull mode together with the secondary depth mode
+        auto cullMode = mode == DepthMode::Raytraced ? RasterizerState::CullMode::None : RasterizerState::CullMode::Back;
+        addVariant({{"SECONDARY_DEPTH_MODE", std::to_string(uint32_t(mode))}, {"CULL_MODE_RAY_FLAG", RasterizerState::CullModeToRayFlag(cullMode)}});
+    }
+    for (uint32_t sampleCount : {8u, 16u, 32u})
+        addVariant({{"NUM_DIRECTIONS", std::to_string(sampleCount)}});
+
+    // Compile the variants of the programs that execute() can dispatch in parallel. The programs are released right away,
+    // the program manager keeps their versions for the programs created when switching to a variant.
+    // The current settings are compiled by execute() itself, as before.
+    std::vector<ref<Program>> programs;
+    programs.push_back(ComputeProgram::create(mpDevice, getComputeProgramDesc(kRasterShader), defines));
+    programs.push_back(ComputeProgram::create(mpDevice, getComputeProgramDesc(kRasterShader2), defines));
+    if (mUseRayPipeline) // the ray pipeline can only be selected in the config, it is never used otherwise
+    {
+        ref<RtBindingTable> sbt;
+        programs.push_back(RtProgram::create(mpDevice, getRayProgramDesc(sbt), defines));
+    }
+
+    std::vector<ProgramManager::ProgramVersionRequest> requests;
+    for (const auto& pProgram : programs)
+        for (const auto& variant : variants)
+            requests.push_back({pProgram, variant});
+    mpDevice->getProgramManager()->compileProgramVersions(requests);
+}
+
 ref<Texture> SVAO::genNoiseTexture()
 {
     static const int NOISE_SIZE = 4;
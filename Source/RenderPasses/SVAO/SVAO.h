@@ -68,6 +68,12 @@ private:
     ref<Texture> genNoiseTexture();
 
     Program::Desc getFullscreenShaderDesc(const std::string& filename);
+    DefineList getProgramDefines(float rayConeSpread) const;
+    Program::Desc getComputeProgramDesc(const std::string& filename) const;
+    RtProgram::Desc getRayProgramDesc(ref<RtBindingTable>& sbt) const;
+    /** Compiles the program variants the UI can switch to, so that switching doesn't stall on shader compilation.
+    */
+    void prewarmPrograms(const DefineList& defines);
     int getExtraGuardBand() const;
     uint2 getStochMapSize(uint2 fullRes, bool includeGuard = true) const;
 
@@ -86,6 +92,7 @@ private:
 
     ref<RtProgram> mpRayProgram;
     ref<RtProgramVars> mRayVars;
+    bool mProgramsPrewarmed = false; // program variants are compiled once per scene
 
     uint mStochSamples = 4; // for stochastic depth map
 
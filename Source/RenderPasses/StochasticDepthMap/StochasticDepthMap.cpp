@@ -26,6 +26,8 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "StochasticDepthMap.h"
+#include "Core/Program/ProgramManager.h"
+#include "Utils/Threading.h"
 
 namespace
 {
@@ -254,14 +256,12 @@ void StochasticDepthMap::execute(RenderContext* pRenderContext, const RenderData
         desc.addShaderLibrary(kProgramFile).vsEntry("vsMain").psEntry("psMain");
         desc.addTypeConformances(mpScene->getTypeConformances());
         desc.setShaderModel("6_2");
-        auto defines = mpScene->getSceneDefines();
-        defines.add("NUM_SAMPLES", std::to_string(mSampleCount));
-        defines.add("ALPHA", std::to_string(mAlpha));
-        defines.add("INV_RESOLUTION", "float2(" + std::to_string(1.0f / mpFbo->getWidth()) + ", " + std::to_string(1.0f / mpFbo->getHeight()) + ")");
-        defines.add("USE_ALPHA_TEST", mAlphaTest ? "1" : "0");
-        defines.add("IMPLEMENTATION", std::to_string(uint32_t(mImplementation)));
-        defines.add("USE_RAY_INTERVAL", mUseRayInterval ? "1" : "0");
-        if (mLinearizeDepth) defines.add("LINEARIZE");
+        auto defines = getProgramDefines();
+        if (!mProgramsPrewarmed)
+        {
+            prewarmPrograms(desc, defines);
+            mProgramsPrewarmed = true;
+        }
         auto pProgram = GraphicsProgram::create(mpDevice, desc, defines);
 
         mpState = GraphicsState::create(mpDevice);
@@ -326,6 +326,41 @@ void StochasticDepthMap::execute(RenderContext* pRenderContext, const RenderData
     }
 }
 
+DefineList StochasticDepthMap::getProgramDefines() const
+{
+    auto defines = mpScene->getSceneDefines();
+    defines.add("NUM_SAMPLES", std::to_string(mSampleCount));
+    defines.add("ALPHA", std::to_string(mAlpha));
+    defines.add("INV_RESOLUTION", "float2(" + std::to_string(1.0f / mpFbo->getWidth()) + ", " + std::to_string(1.0f / mpFbo->getHeight()) + ")");
+    defines.add("USE_ALPHA_TEST", mAlphaTest ? "1" : "0");
+    defines.add("IMPLEMENTATION", std::to_string(uint32_t(mImplementation)));
+    defines.add("USE_RAY_INTERVAL", mUseRayInterval ? "1" : "0");
+    if (mLinearizeDepth) defines.add("LINEARIZE");
+    return defines;
+}
+
+void StochasticDepthMap::prewarmPrograms(const Program::Desc& desc, const DefineList& defines)
+{
+    // without worker threads the variants would be compiled one after another on the first frame
+    if (!Threading::isStarted())
+        return;
+
+    // compile the implementations and the toggles of the ui in parallel, the program manager keeps the versions
+    // after the program is released and hands them to the program created once one of the options is switched
+    auto pProgram = GraphicsProgram::create(mpDevice, desc, defines);
+    std::vector<ProgramManager::ProgramVersionRequest> requests = {{pProgram, defines}};
+    for (const auto& [implementation, name] : EnumInfo<StochasticDepthImplementation>::items())
+    {
+        if (implementation == mImplementation) continue;
+        requests.push_back({pProgram, DefineList(defines).add("IMPLEMENTATION", std::to_string(uint32_t(implementation)))});
+    }
+    requests.push_back({pProgram, DefineList(defines).add("USE_ALPHA_TEST", mAlphaTest ? "0" : "1")});
+    if (mLinearizeDepth) requests.push_back({pProgram, DefineList(defines).remove("LINEARIZE")});
+    else requests.push_back({pProgram, DefineList(defines).add("LINEARIZE")});
+
+    mpDevice->getProgramManager()->compileProgramVersions(requests);
+}
+
 void StochasticDepthMap::renderUI(Gui::Widgets& widget)
 {
     static const Gui::DropdownList kDepthFormats =
@@ -364,6 +399,7 @@ void StochasticDepthMap::setScene(RenderContext* pRenderContext, const ref<Scene
 {
     mpScene = pScene;
     mpState.reset();
+    mProgramsPrewarmed = false;
 
     // force reload of camera cbuffer
     mLastZNear = 0.0f;
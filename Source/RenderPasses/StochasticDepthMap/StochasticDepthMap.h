@@ -56,6 +56,10 @@ public:
     StochasticDepthMap(ref<Device> pDevice);
 
 private:
+    DefineList getProgramDefines() const;
+    /** Compiles the program variants that can be switched to at runtime, so that switching doesn't stall on shader compilation.
+    */
+    void prewarmPrograms(const Program::Desc& desc, const DefineList& defines);
 
     ref<Fbo> mpFbo;
     ref<GraphicsState> mpState;
@@ -79,4 +83,5 @@ private:
 
     ResourceFormat mDepthFormat = ResourceFormat::D32Float;
     StochasticDepthImplementation mImplementation = StochasticDepthImplementation::Default;
+    bool mProgramsPrewarmed = false; // program variants are compiled once per scene
 };
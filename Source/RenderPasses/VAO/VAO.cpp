@@ -26,6 +26,8 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "VAO.h"
+#include "Core/Program/ProgramManager.h"
+#include "Utils/Threading.h"
 
 #include <random>
 
@@ -241,6 +243,8 @@ void VAO::execute(RenderContext* pRenderContext, const RenderData& renderData)
             desc.addShaderLibrary(kSSAOShader).psEntry("main");
             desc.addTypeConformances(mpScene->getTypeConformances());
             desc.setShaderModel("6_5");
+            // add the vertex shader here instead of in FullScreenPass, so that the pre-warmed program has the same desc
+            desc.addShaderLibrary("Core/Pass/FullScreenPass.vs.slang").vsEntry("main");
             // program defines
             DefineList defines;
             defines.add(mpScene->getSceneDefines());
@@ -249,6 +253,12 @@ void VAO::execute(RenderContext* pRenderContext, const RenderData& renderData)
             defines.add("PREVENT_DARK_HALOS", mPreventDarkHalos ? "1" : "0");
             if (psDepth) defines.add("MSAA_SAMPLES", std::to_string(psDepth->getSampleCount()));
 
+            if (!mProgramsPrewarmed)
+            {
+                prewarmPrograms(desc, defines);
+                mProgramsPrewarmed = true;
+            }
+
             mpSSAOPass = FullScreenPass::create(mpDevice, desc, defines);
             mDirty = true;
 
@@ -345,6 +355,26 @@ void VAO::execute(RenderContext* pRenderContext, const RenderData& renderData)
     }
 }
 
+void VAO::prewarmPrograms(const Program::Desc& desc, const DefineList& defines)
+{
+    // without worker threads the variants would be compiled one after another on the first frame
+    if (!Threading::isStarted())
+        return;
+
+    // compile the depth modes and the dark halo toggle of the ui in parallel, the program manager keeps the versions
+    // after the program is released and hands them to the pass created once one of the options is switched
+    auto pProgram = GraphicsProgram::create(mpDevice, desc, defines);
+    std::vector<ProgramManager::ProgramVersionRequest> requests = {{pProgram, defines}};
+    for (auto depthMode : {DepthMode::SingleDepth, DepthMode::DualDepth, DepthMode::StochasticDepth, DepthMode::Raytraced})
+    {
+        if (depthMode == mDepthMode) continue;
+        requests.push_back({pProgram, DefineList(defines).add("DEPTH_MODE", std::to_string(uint32_t(depthMode)))});
+    }
+    requests.push_back({pProgram, DefineList(defines).add("PREVENT_DARK_HALOS", mPreventDarkHalos ? "0" : "1")});
+
+    mpDevice->getProgramManager()->compileProgramVersions(requests);
+}
+
 void VAO::renderUI(Gui::Widgets& widget)
 {
     widget.checkbox("Enabled", mEnabled);
@@ -402,6 +432,7 @@ void VAO::setScene(RenderContext* pRenderContext, const ref<Scene>& pScene)
     mpScene = pScene;
     mDirty = true;
     mpSSAOPass.reset();
+    mProgramsPrewarmed = false;
 }
 
 
@@ -83,6 +83,9 @@ private:
     void setNoiseTexture();
     void setKernel();
     std::vector<float> getSphereHeights() const;
+    /** Compiles the program variants the UI can switch to, so that switching doesn't stall on shader compilation.
+    */
+    void prewarmPrograms(const Program::Desc& desc, const DefineList& defines);
 
     VAOData mData;
     bool mDirty = true;
@@ -98,6 +101,7 @@ private:
     SampleDistribution mHemisphereDistribution = SampleDistribution::VanDerCorput;
 
     ref<FullScreenPass> mpSSAOPass;
+    bool mProgramsPrewarmed = false; // program variants are compiled once per scene
 
     ref<Scene> mpScene;
     bool mClearTexture = true;
@@ -34,6 +34,34 @@ namespace
     const std::string kDark = "dark";
     const std::string kDepth = "depth";
     const std::string kDepthInv = "invDepth"; // inverse depth (1/z)
+
+    const std::string kChannels[] = { kRef, kBright, kDark, kDepth, kDepthInv };
+
+    const std::string kExportFolder = "exportFolder";
+    const std::string kExportMode = "exportMode";
+    const std::string kExportOnCameraChange = "exportOnCameraChange";
+    const std::string kCompress = "compress";
+    const std::string kMaxShardSize = "maxShardSizeMB";
+
+    const std::string kArchivePrefix = "vao";
+
+    /** Returns the numpy type descriptor for the channels of a texture format.
+    */
+    std::string getNumpyDescr(ResourceFormat format)
+    {
+        if (isCompressedFormat(format)) throw RuntimeError("VAOExport doesn't support compressed format {}", to_string(format));
+
+        uint32_t bytesPerChannel = getFormatBytesPerBlock(format) / getFormatChannelCount(format);
+        char kind = 'u';
+        switch (getFormatType(format))
+        {
+        case FormatType::Float: kind = 'f'; break;
+        case FormatType::Sint:
+        case FormatType::Snorm: kind = 'i'; break;
+        default: break;
+        }
+        return fmt::format("{}{}{}", bytesPerChannel == 1 ? '|' : '<', kind, bytesPerChannel);
+    }
 }
 
 extern "C" FALCOR_API_EXPORT void registerPlugin(Falcor::PluginRegistry& registry)
@@ -44,11 +72,26 @@ extern "C" FALCOR_API_EXPORT void registerPlugin(Falcor::PluginRegistry& registr
 VAOExport::VAOExport(ref<Device> pDevice, const Properties& dict)
     : RenderPass(pDevice)
 {
+    for (const auto& [key, value] : dict)
+    {
+        if (key == kExportFolder) mExportFolder = value.operator std::string();
+        else if (key == kExportMode) mExportMode = value;
+        else if (key == kExportOnCameraChange) mExportOnCameraChange = value;
+        else if (key == kCompress) mCompress = value;
+        else if (key == kMaxShardSize) mMaxShardSizeMB = value;
+        else logWarning("Unknown field '" + key + "' in a VAOExport dictionary");
+    }
 }
 
 Properties VAOExport::getProperties() const
 {
-    return Properties();
+    Properties dict;
+    dict[kExportFolder] = mExportFolder;
+    dict[kExportMode] = mExportMode;
+    dict[kExportOnCameraChange] = mExportOnCameraChange;
+    dict[kCompress] = mCompress;
+    dict[kMaxShardSize] = mMaxShardSizeMB;
+    return dict;
 }
 
 RenderPassReflection VAOExport::reflect(const CompileData& compileData)
@@ -85,24 +128,103 @@ void VAOExport::execute(RenderContext* pRenderContext, const RenderData& renderD
 
     if(mSave)
     {
-        pRefTex->captureToFile(0, 0, getExportName("ref", ".npy"), Bitmap::FileFormat::NumpyFile);
-        pBrightTex->captureToFile(0, 0, getExportName("bright", ".npy"), Bitmap::FileFormat::NumpyFile);
-        pDarkTex->captureToFile(0, 0, getExportName("dark", ".npy"), Bitmap::FileFormat::NumpyFile);
-        pDepthTex->captureToFile(0, 0, getExportName("depth", ".npy"), Bitmap::FileFormat::NumpyFile);
-        pDepthInvTex->captureToFile(0, 0, getExportName("invDepth", ".npy"), Bitmap::FileFormat::NumpyFile);
+        if (mExportMode == ExportMode::Archive)
+        {
+            exportToArchive(pRenderContext, renderData);
+        }
+        else
+        {
+            std::filesystem::create_directories(mExportFolder);
+            pRefTex->captureToFile(0, 0, getExportName("ref", ".npy"), Bitmap::FileFormat::NumpyFile);
+            pBrightTex->captureToFile(0, 0, getExportName("bright", ".npy"), Bitmap::FileFormat::NumpyFile);
+            pDarkTex->captureToFile(0, 0, getExportName("dark", ".npy"), Bitmap::FileFormat::NumpyFile);
+            pDepthTex->captureToFile(0, 0, getExportName("depth", ".npy"), Bitmap::FileFormat::NumpyFile);
+            pDepthInvTex->captureToFile(0, 0, getExportName("invDepth", ".npy"), Bitmap::FileFormat::NumpyFile);
+        }
 
         mExportIndex++;
         mSave = false;
     }
 }
 
+void VAOExport::exportToArchive(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    if (!mpArchive)
+    {
+        mpArchive = std::make_shared<ShardedNpzWriter>(mExportFolder, kArchivePrefix, uint64_t(mMaxShardSizeMB) << 20);
+    }
+
+    // Queue the readback of all array slices of all channels. Waiting for the readback, encoding and compressing
+    // the arrays and appending the sample to the archive is done by the worker threads of the image write queue.
+    struct Channel
+    {
+        std::string name;
+        std::string descr;
+        std::vector<unsigned long> shape;
+        std::vector<CopyContext::ReadTextureTask::SharedPtr> readTasks;
+    };
+
+    std::vector<Channel> channels;
+    size_t memorySize = 0;
+    for (const auto& channelName : kChannels)
+    {
+        auto pTex = renderData[channelName]->asTexture();
+        ResourceFormat format = pTex->getFormat();
+
+        Channel channel;
+        channel.name = channelName + "_" + std::to_string(mExportIndex);
+        channel.descr = getNumpyDescr(format);
+        channel.shape = { pTex->getArraySize(), pTex->getHeight(), pTex->getWidth(), getFormatChannelCount(format) };
+        for (uint32_t layer = 0; layer < pTex->getArraySize(); ++layer)
+        {
+            channel.readTasks.push_back(pRenderContext->asyncReadTextureSubresource(pTex.get(), pTex->getSubresourceIndex(layer, 0)));
+        }
+        // Account for the read back data and the encoded copy.
+        memorySize += 2 * size_t(pTex->getArraySize()) * pTex->getWidth() * pTex->getHeight() * getFormatBytesPerBlock(format);
+        channels.push_back(std::move(channel));
+    }
+
+    auto writeSample = [pArchive = mpArchive, channels = std::move(channels), sampleIndex = mExportIndex, compress = mCompress]()
+    {
+        std::vector<NpzWriter::EncodedArray> arrays;
+        for (const auto& channel : channels)
+        {
+            std::vector<uint8_t> data;
+            for (const auto& pTask : channel.readTasks)
+            {
+                auto sliceData = pTask->getData();
+                data.insert(data.end(), sliceData.begin(), sliceData.end());
+            }
+            arrays.push_back(NpzWriter::encodeArray(channel.name, channel.descr, channel.shape, data.data(), data.size(), compress));
+        }
+        pArchive->append(sampleIndex, arrays);
+    };
+    mpDevice->getImageWriteQueue()->enqueue(memorySize, std::move(writeSample));
+}
+
 void VAOExport::renderUI(Gui::Widgets& widget)
 {
-    widget.textbox("Export Directory", mExportFolder);
+    // Changing the export settings starts a new archive.
+    bool archiveChanged = false;
+    archiveChanged |= widget.textbox("Export Directory", mExportFolder);
     widget.var("Number", mExportIndex);
     if (widget.button("Save")) mSave = true;
 
     widget.checkbox("Update on Camera Change", mExportOnCameraChange);
+
+    archiveChanged |= widget.dropdown("Export Mode", mExportMode);
+    widget.tooltip("NumpyFiles: Write a .npy file per channel and sample.\n"
+        "Archive: Append the samples to .npz archives, which are split into shards of the maximum shard size.");
+    if (mExportMode == ExportMode::Archive)
+    {
+        widget.checkbox("Compress", mCompress);
+        archiveChanged |= widget.var("Max Shard Size (MB)", mMaxShardSizeMB, 1u, 4095u);
+        if (widget.button("Close Archive")) archiveChanged = true;
+        if (mpArchive) widget.text("Shards: " + std::to_string(mpArchive->getShardCount()));
+    }
+
+    // The archive is finalized once the pending export jobs have finished.
+    if (archiveChanged) mpArchive.reset();
 }
 
 void VAOExport::setScene(RenderContext* pRenderContext, const ref<Scene>& pScene)
@@ -112,5 +234,5 @@ void VAOExport::setScene(RenderContext* pRenderContext, const ref<Scene>& pScene
 
 std::string VAOExport::getExportName(const std::string& type, const std::string& extension)
 {
-    return mExportFolder + type + "_" + std::to_string(mExportIndex) + extension;
+    return (std::filesystem::path(mExportFolder) / (type + "_" + std::to_string(mExportIndex) + extension)).string();
 }
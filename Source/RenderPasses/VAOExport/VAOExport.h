@@ -28,6 +28,7 @@
 #pragma once
 #include "Falcor.h"
 #include "RenderGraph/RenderPass.h"
+#include "Utils/Image/NpzWriter.h"
 
 using namespace Falcor;
 
@@ -49,17 +50,36 @@ public:
     virtual bool onMouseEvent(const MouseEvent& mouseEvent) override { return false; }
     virtual bool onKeyEvent(const KeyboardEvent& keyEvent) override { return false; }
 
+    enum class ExportMode : uint32_t
+    {
+        NumpyFiles, ///< Write a separate .npy file per channel and sample.
+        Archive,    ///< Append all channels of all samples to sharded .npz archives.
+    };
+
+    FALCOR_ENUM_INFO(ExportMode, {
+        { ExportMode::NumpyFiles, "NumpyFiles" },
+        { ExportMode::Archive, "Archive" },
+    });
+
 private:
     std::string getExportName(const std::string& type, const std::string& extension);
+    void exportToArchive(RenderContext* pRenderContext, const RenderData& renderData);
 
     ref<Scene> mpScene;
 
     const static uint mArraySize = 16;
     bool mSave = false;
 
-    std::string mExportFolder = "D:/VAO/";
+    std::string mExportFolder = "VAO";              ///< Export directory. Relative to the working directory, like the default capture output directory.
     uint mExportIndex = 0;
     bool mExportOnCameraChange = false;
 
+    ExportMode mExportMode = ExportMode::NumpyFiles;
+    bool mCompress = true;                          ///< Deflate the arrays stored in archives.
+    uint mMaxShardSizeMB = 2048;                    ///< Maximum size of an archive shard in MB.
+    std::shared_ptr<ShardedNpzWriter> mpArchive;    ///< Current archive. Shared with the export jobs, which finish writing after the archive is closed here.
+
     float3 mLastCameraPos = float3(0, 0, 0);
 };
+
+FALCOR_ENUM_REGISTER(VAOExport::ExportMode);
@@ -0,0 +1,150 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/Program/ProgramManager.h"
+
+namespace Falcor
+{
+namespace
+{
+const std::string kShaderFile = "Tests/Core/BufferTests.cs.slang";
+const std::string kValueShaderFile = "Tests/Core/ProgramManagerTests.cs.slang";
+
+DefineList getDefines(uint32_t type)
+{
+    return DefineList{{"TYPE", std::to_string(type)}};
+}
+
+DefineList getValueDefines(uint32_t value)
+{
+    return DefineList{{"VALUE", std::to_string(value)}};
+}
+
+/// Drop the versions of programs released by other tests, so that they are not reused.
+void clearVersionPool(ProgramManager* pProgramManager)
+{
+    size_t versionPoolSize = pProgramManager->getVersionPoolSize();
+    pProgramManager->setVersionPoolSize(0);
+    pProgramManager->setVersionPoolSize(versionPoolSize);
+}
+} // namespace
+
+GPU_TEST(ProgramManager_CompileProgramVersions)
+{
+    ref<Device> pDevice = ctx.getDevice();
+    ProgramManager* pProgramManager = pDevice->getProgramManager();
+    clearVersionPool(pProgramManager);
+
+    auto pProgram = ComputeProgram::createFromFile(pDevice, kShaderFile, "clearBuffer", getDefines(0));
+
+    std::vector<ProgramManager::ProgramVersionRequest> requests;
+    for (uint32_t type = 0; type < 3; ++type)
+        requests.push_back({pProgram, getDefines(type)});
+    // Duplicate requests are compiled once.
+    requests.push_back({pProgram, getDefines(1)});
+
+    pProgramManager->resetCompilationStats();
+    EXPECT_EQ(pProgramManager->compileProgramVersions(requests), 3);
+    EXPECT_EQ(pProgramManager->getCompilationStats().programVersionCount, 3);
+
+    // Switching between the compiled versions doesn't compile anymore.
+    for (uint32_t type = 0; type < 3; ++type)
+    {
+        pProgram->setDefines(getDefines(type));
+        const auto& pVersion = pProgram->getActiveVersion();
+        EXPECT(pVersion->getDefines() == getDefines(type));
+        EXPECT(pVersion->getProgram() == pProgram.get());
+    }
+    EXPECT_EQ(pProgramManager->getCompilationStats().programVersionCount, 3);
+
+    // Versions that are already available are skipped.
+    EXPECT_EQ(pProgramManager->compileProgramVersions(requests), 0);
+}
+
+GPU_TEST(ProgramManager_RunCompiledProgramVersions)
+{
+    ref<Device> pDevice = ctx.getDevice();
+    ProgramManager* pProgramManager = pDevice->getProgramManager();
+    clearVersionPool(pProgramManager);
+
+    // With the thread pool running, the versions are spread over the compile threads, so some of them
+    // are compiled in the program manager's own Slang global sessions instead of the device's one.
+    const uint32_t kVersionCount = 8;
+    const uint32_t kElementCount = 256;
+    ctx.createProgram(kValueShaderFile, "main", getValueDefines(0), Program::CompilerFlags::None, "", false);
+    ref<Program> pProgram(ctx.getProgram());
+
+    std::vector<ProgramManager::ProgramVersionRequest> requests;
+    for (uint32_t value = 0; value < kVersionCount; ++value)
+        requests.push_back({pProgram, getValueDefines(value)});
+    EXPECT_EQ(pProgramManager->compileProgramVersions(requests), kVersionCount);
+
+    // Every version runs on the GPU and produces the output of its defines.
+    for (uint32_t value = 0; value < kVersionCount; ++value)
+    {
+        pProgram->setDefines(getValueDefines(value));
+        ctx.createVars();
+        ctx.allocateStructuredBuffer("result", kElementCount);
+        ctx.runProgram(kElementCount);
+
+        std::vector<uint32_t> result = ctx.readBuffer<uint32_t>("result");
+        for (uint32_t i = 0; i < kElementCount; ++i)
+            EXPECT_EQ(result[i], value * 1000 + i) << "value = " << value << ", i = " << i;
+    }
+}
+
+GPU_TEST(ProgramManager_VersionPool)
+{
+    ref<Device> pDevice = ctx.getDevice();
+    ProgramManager* pProgramManager = pDevice->getProgramManager();
+    if (pProgramManager->getVersionPoolSize() == 0)
+        return;
+    clearVersionPool(pProgramManager);
+
+    // Compile a version with a program that is released right away.
+    pProgramManager->resetCompilationStats();
+    {
+        auto pProgram = ComputeProgram::createFromFile(pDevice, kShaderFile, "readBuffer", getDefines(2));
+        std::vector<ProgramManager::ProgramVersionRequest> requests = {{pProgram, getDefines(2)}};
+        EXPECT_EQ(pProgramManager->compileProgramVersions(requests), 1);
+    }
+    EXPECT_EQ(pProgramManager->getCompilationStats().programVersionCount, 1);
+
+    // A program created later with the same desc and defines reuses the version.
+    auto pProgram = ComputeProgram::createFromFile(pDevice, kShaderFile, "readBuffer", getDefines(2));
+    const auto& pVersion = pProgram->getActiveVersion();
+    EXPECT(pVersion->getProgram() == pProgram.get());
+    EXPECT_EQ(pProgramManager->getCompilationStats().programVersionCount, 1);
+    EXPECT_EQ(pProgramManager->getCompilationStats().versionPoolHitCount, 1);
+
+    // Different defines compile a new version.
+    auto pOtherProgram = ComputeProgram::createFromFile(pDevice, kShaderFile, "readBuffer", getDefines(1));
+    pOtherProgram->getActiveVersion();
+    EXPECT_EQ(pProgramManager->getCompilationStats().programVersionCount, 2);
+}
+} // namespace Falcor
@@ -0,0 +1,145 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderGraph/RenderGraph.h"
+#include <algorithm>
+
+namespace Falcor
+{
+namespace
+{
+class CompileCounterPass : public RenderPass
+{
+public:
+    FALCOR_PLUGIN_CLASS(CompileCounterPass, "CompileCounterPass", "Render pass counting compile() calls.");
+
+    CompileCounterPass(ref<Device> pDevice, bool hasInput) : RenderPass(pDevice), mHasInput(hasInput) {}
+
+    virtual RenderPassReflection reflect(const CompileData& compileData) override
+    {
+        RenderPassReflection reflector;
+        if (mHasInput)
+            reflector.addInput("src", "Input texture").texture2D(0, 0);
+        reflector.addOutput("dst", "Output texture").format(ResourceFormat::RGBA8Unorm).texture2D(mOutputSize.x, mOutputSize.y);
+        return reflector;
+    }
+
+    virtual void compile(RenderContext* pRenderContext, const CompileData& compileData) override { mCompileCount++; }
+    virtual void execute(RenderContext* pRenderContext, const RenderData& renderData) override {}
+
+    void setOutputSize(uint2 size)
+    {
+        mOutputSize = size;
+        requestRecompile();
+    }
+
+    void touch() { requestRecompile(); }
+
+    uint32_t getCompileCount() const { return mCompileCount; }
+
+private:
+    bool mHasInput;
+    uint2 mOutputSize = {0, 0};
+    uint32_t mCompileCount = 0;
+};
+
+bool contains(const std::vector<std::string>& names, const std::string& name)
+{
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+} // namespace
+
+GPU_TEST(RenderGraphCompiler_Incremental)
+{
+    ref<Device> pDevice = ctx.getDevice();
+    RenderContext* pRenderContext = ctx.getRenderContext();
+
+    // Graph with a chain A -> B and an independent pass C.
+    auto pA = make_ref<CompileCounterPass>(pDevice, false);
+    auto pB = make_ref<CompileCounterPass>(pDevice, true);
+    auto pC = make_ref<CompileCounterPass>(pDevice, false);
+    pA->setOutputSize({64, 64});
+
+    ref<RenderGraph> pGraph = RenderGraph::create(pDevice, "Incremental Compilation");
+    pGraph->addPass(pA, "A");
+    pGraph->addPass(pB, "B");
+    pGraph->addPass(pC, "C");
+    pGraph->addEdge("A.dst", "B.src");
+    pGraph->markOutput("B.dst");
+    pGraph->markOutput("C.dst");
+
+    ref<Fbo> pTargetFbo = Fbo::create2D(pDevice, 32, 32, ResourceFormat::RGBA8Unorm);
+    pGraph->onResize(pTargetFbo.get());
+
+    // The first compilation compiles everything.
+    pGraph->execute(pRenderContext);
+    EXPECT_EQ(pA->getCompileCount(), 1);
+    EXPECT_EQ(pB->getCompileCount(), 1);
+    EXPECT_EQ(pC->getCompileCount(), 1);
+    EXPECT_EQ(pGraph->getCompileStats().compiledPasses.size(), 3);
+    EXPECT_EQ(pGraph->getCompileStats().resourceCount, 3);
+    EXPECT_EQ(pGraph->getCompileStats().reusedResourceCount, 0);
+
+    ref<Resource> pOutputB = pGraph->getOutput("B.dst");
+    ref<Resource> pOutputC = pGraph->getOutput("C.dst");
+
+    // A pass requesting a recompile without changing its reflection only recompiles itself and keeps all resources.
+    pC->touch();
+    pGraph->execute(pRenderContext);
+    EXPECT_EQ(pA->getCompileCount(), 1);
+    EXPECT_EQ(pB->getCompileCount(), 1);
+    EXPECT_EQ(pC->getCompileCount(), 2);
+    EXPECT_EQ(pGraph->getCompileStats().compiledPasses.size(), 1);
+    EXPECT_EQ(pGraph->getCompileStats().reusedPasses.size(), 2);
+    EXPECT_EQ(pGraph->getCompileStats().reusedResourceCount, 3);
+    EXPECT(pGraph->getOutput("C.dst") == pOutputC);
+
+    // Changing the output size of A recompiles A and the connected pass B. C and the resources other than A.dst are reused.
+    pA->setOutputSize({128, 128});
+    pGraph->execute(pRenderContext);
+    EXPECT_EQ(pA->getCompileCount(), 2);
+    EXPECT_EQ(pB->getCompileCount(), 2);
+    EXPECT_EQ(pC->getCompileCount(), 2);
+    EXPECT(contains(pGraph->getCompileStats().compiledPasses, "A"));
+    EXPECT(contains(pGraph->getCompileStats().compiledPasses, "B"));
+    EXPECT(contains(pGraph->getCompileStats().reusedPasses, "C"));
+    EXPECT_EQ(pGraph->getCompileStats().reusedResourceCount, 2);
+    EXPECT(pGraph->getOutput("B.dst") == pOutputB);
+    EXPECT(pGraph->getOutput("C.dst") == pOutputC);
+
+    // Resizing changes the default texture dimensions of all passes.
+    pTargetFbo = Fbo::create2D(pDevice, 16, 16, ResourceFormat::RGBA8Unorm);
+    pGraph->onResize(pTargetFbo.get());
+    pGraph->execute(pRenderContext);
+    EXPECT_EQ(pA->getCompileCount(), 3);
+    EXPECT_EQ(pB->getCompileCount(), 3);
+    EXPECT_EQ(pC->getCompileCount(), 3);
+    EXPECT_EQ(pGraph->getCompileStats().reusedResourceCount, 0);
+    EXPECT_EQ(pGraph->getOutput("C.dst")->asTexture()->getWidth(), 16);
+}
+} // namespace Falcor
@@ -0,0 +1,185 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderGraph/TransientResourcePlanner.h"
+#include <algorithm>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+using Request = TransientResourcePlanner::Request;
+
+Request makeRequest(uint64_t size, uint32_t firstUse, uint32_t lastUse, uint32_t classId = 0, bool aliasable = true)
+{
+    Request r;
+    r.size = size;
+    r.firstUse = firstUse;
+    r.lastUse = lastUse;
+    r.classId = classId;
+    r.aliasable = aliasable;
+    return r;
+}
+
+bool overlaps(const Request& a, const Request& b)
+{
+    return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+}
+} // namespace
+
+CPU_TEST(TransientResourcePlanner)
+{
+    // A chain of passes where each output is read by the next pass only.
+    std::vector<Request> requests = {
+        makeRequest(100, 0, 1),
+        makeRequest(100, 1, 2),
+        makeRequest(100, 2, 3),
+        makeRequest(100, 3, 4),
+    };
+    auto plan = TransientResourcePlanner::plan(requests);
+    EXPECT_EQ(2, plan.stats.slotCount);
+    EXPECT_EQ(plan.requestSlots[0], plan.requestSlots[2]);
+    EXPECT_EQ(plan.requestSlots[1], plan.requestSlots[3]);
+    EXPECT_NE(plan.requestSlots[0], plan.requestSlots[1]);
+    EXPECT_EQ(400, plan.stats.unaliasedBytes);
+    EXPECT_EQ(200, plan.stats.aliasedBytes);
+    EXPECT_EQ(200, plan.stats.peakLiveBytes);
+
+    // Requests of different classes never share a slot.
+    requests = {makeRequest(100, 0, 0, 0), makeRequest(100, 1, 1, 1), makeRequest(100, 2, 2, 0)};
+    plan = TransientResourcePlanner::plan(requests);
+    EXPECT_EQ(2, plan.stats.slotCount);
+    EXPECT_EQ(plan.requestSlots[0], plan.requestSlots[2]);
+    EXPECT_EQ(100, plan.stats.peakLiveBytes);
+
+    // Non-aliasable requests get their own slot and are alive at all times.
+    requests = {makeRequest(100, 0, 0), makeRequest(100, 1, 1, 0, false), makeRequest(100, 2, 2)};
+    plan = TransientResourcePlanner::plan(requests);
+    EXPECT_EQ(2, plan.stats.slotCount);
+    EXPECT_EQ(plan.requestSlots[0], plan.requestSlots[2]);
+    EXPECT_EQ(1, plan.slots[plan.requestSlots[1]].requests.size());
+    EXPECT_EQ(200, plan.stats.peakLiveBytes);
+
+    // Empty input.
+    plan = TransientResourcePlanner::plan({});
+    EXPECT_EQ(0, plan.stats.slotCount);
+    EXPECT_EQ(0, plan.stats.aliasedBytes);
+}
+
+CPU_TEST(TransientResourcePlanner_BestFit)
+{
+    std::vector<Request> requests = {
+        makeRequest(100, 0, 0),
+        makeRequest(50, 0, 0),
+        makeRequest(40, 1, 1),  // Smallest free slot that fits is the 50 byte one.
+        makeRequest(200, 1, 1), // Nothing fits, the largest free slot grows.
+    };
+    auto plan = TransientResourcePlanner::plan(requests);
+    EXPECT_EQ(2, plan.stats.slotCount);
+    EXPECT_EQ(plan.requestSlots[1], plan.requestSlots[2]);
+    EXPECT_EQ(plan.requestSlots[0], plan.requestSlots[3]);
+    EXPECT_EQ(200, plan.slots[plan.requestSlots[3]].size);
+    EXPECT_EQ(250, plan.stats.aliasedBytes);
+    EXPECT_EQ(240, plan.stats.peakLiveBytes);
+}
+
+CPU_TEST(TransientResourcePlanner_GraphOutputs)
+{
+    // Resources used until the end of the graph must not be reused.
+    std::vector<Request> requests = {makeRequest(100, 0, uint32_t(-1)), makeRequest(100, 1, 1), makeRequest(100, 2, uint32_t(-1))};
+    auto plan = TransientResourcePlanner::plan(requests);
+    EXPECT_EQ(2, plan.stats.slotCount);
+    EXPECT_EQ(plan.requestSlots[1], plan.requestSlots[2]);
+    EXPECT_EQ(200, plan.stats.peakLiveBytes);
+}
+
+CPU_TEST(TransientResourcePlanner_Random)
+{
+    std::mt19937 rng(1234);
+    const uint32_t kPassCount = 64;
+    const uint32_t kClassCount = 4;
+
+    for (uint32_t iter = 0; iter < 20; iter++)
+    {
+        // Each pass produces a few outputs that are read by passes up to 8 steps later.
+        std::vector<Request> requests;
+        for (uint32_t pass = 0; pass < kPassCount; pass++)
+        {
+            uint32_t outputCount = rng() % 4;
+            for (uint32_t o = 0; o < outputCount; o++)
+            {
+                uint32_t classId = rng() % kClassCount;
+                uint64_t size = (classId + 1) * 1024;
+                requests.push_back(makeRequest(size, pass, pass + rng() % 8, classId, rng() % 8 != 0));
+            }
+        }
+
+        auto plan = TransientResourcePlanner::plan(requests);
+        EXPECT_EQ(requests.size(), plan.requestSlots.size());
+        EXPECT_LE(plan.stats.peakLiveBytes, plan.stats.aliasedBytes);
+        EXPECT_LE(plan.stats.aliasedBytes, plan.stats.unaliasedBytes);
+
+        // Requests in a slot are of the same class, fit the slot and have disjoint lifetimes.
+        size_t assignedCount = 0;
+        for (uint32_t s = 0; s < plan.slots.size(); s++)
+        {
+            const auto& slot = plan.slots[s];
+            assignedCount += slot.requests.size();
+            for (size_t i = 0; i < slot.requests.size(); i++)
+            {
+                const Request& a = requests[slot.requests[i]];
+                EXPECT_EQ(s, plan.requestSlots[slot.requests[i]]);
+                EXPECT_EQ(slot.classId, a.classId);
+                EXPECT_LE(a.size, slot.size);
+                if (!a.aliasable)
+                    EXPECT_EQ(1, slot.requests.size());
+                for (size_t j = i + 1; j < slot.requests.size(); j++)
+                    EXPECT(!overlaps(a, requests[slot.requests[j]])) << "slot " << s;
+            }
+        }
+        EXPECT_EQ(requests.size(), assignedCount);
+
+        // Per class, the number of slots equals the largest number of simultaneously alive requests.
+        for (uint32_t c = 0; c < kClassCount; c++)
+        {
+            uint32_t maxAlive = 0;
+            for (uint32_t t = 0; t < kPassCount + 8; t++)
+            {
+                uint32_t alive = 0;
+                for (const auto& r : requests)
+                    alive += (r.classId == c && (!r.aliasable || (r.firstUse <= t && t <= r.lastUse))) ? 1 : 0;
+                maxAlive = std::max(maxAlive, alive);
+            }
+            uint32_t slotCount =
+                (uint32_t)std::count_if(plan.slots.begin(), plan.slots.end(), [&](const auto& s) { return s.classId == c; });
+            EXPECT_EQ(maxAlive, slotCount) << "class " << c;
+        }
+    }
+}
+} // namespace Falcor
@@ -0,0 +1,136 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Lights/LightBVHBuilder.h"
+#include "Utils/Timing/CpuTimer.h"
+#include "Utils/Logger.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using MeshLightTriangle = LightCollection::MeshLightTriangle;
+
+/// Create a list of random emissive triangles distributed over a few clusters.
+std::vector<MeshLightTriangle> createTriangles(uint32_t count, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    auto randomFloat3 = [&]() { return float3(u(rng), u(rng), u(rng)); };
+
+    std::vector<float3> clusterCenters(16);
+    for (auto& c : clusterCenters)
+        c = randomFloat3() * 100.f;
+
+    std::vector<MeshLightTriangle> triangles(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        MeshLightTriangle& tri = triangles[i];
+        float3 center = clusterCenters[i % clusterCenters.size()] + randomFloat3() * 10.f;
+        for (uint32_t j = 0; j < 3; j++)
+            tri.vtx[j].pos = center + randomFloat3() - 0.5f;
+        float3 n = cross(tri.vtx[1].pos - tri.vtx[0].pos, tri.vtx[2].pos - tri.vtx[0].pos);
+        tri.area = 0.5f * length(n);
+        tri.normal = tri.area > 0.f ? normalize(n) : float3(0.f, 0.f, 1.f);
+        tri.averageRadiance = randomFloat3();
+        // Make some triangles non-emissive to exercise culling with pre-integration.
+        tri.flux = (i % 7 == 0) ? 0.f : tri.area * (tri.averageRadiance.x + tri.averageRadiance.y + tri.averageRadiance.z);
+    }
+    return triangles;
+}
+
+LightBVHBuilder::BuildResult buildNodes(const std::vector<MeshLightTriangle>& triangles, LightBVHBuilder::Options options, bool parallel)
+{
+    options.useParallelBuild = parallel;
+    LightBVHBuilder builder(options);
+    return builder.buildNodes(triangles);
+}
+
+void testParallelBuild(CPUUnitTestContext& ctx, LightBVHBuilder::SplitHeuristic heuristic, uint32_t triangleCount)
+{
+    auto triangles = createTriangles(triangleCount, 1234);
+
+    LightBVHBuilder::Options options;
+    options.splitHeuristicSelection = heuristic;
+
+    auto serial = buildNodes(triangles, options, false);
+    auto parallel = buildNodes(triangles, options, true);
+
+    EXPECT(!serial.nodes.empty());
+    ASSERT_EQ(serial.nodes.size(), parallel.nodes.size());
+    for (size_t i = 0; i < serial.nodes.size(); i++)
+    {
+        EXPECT(std::memcmp(&serial.nodes[i], &parallel.nodes[i], sizeof(PackedNode)) == 0) << "i = " << i;
+    }
+    EXPECT(serial.triangleIndices == parallel.triangleIndices);
+    EXPECT(serial.triangleBitmasks == parallel.triangleBitmasks);
+}
+} // namespace
+
+CPU_TEST(LightBVHBuilder_ParallelBuildEqual)
+{
+    testParallelBuild(ctx, LightBVHBuilder::SplitHeuristic::Equal, 20000);
+}
+
+CPU_TEST(LightBVHBuilder_ParallelBuildBinnedSAH)
+{
+    testParallelBuild(ctx, LightBVHBuilder::SplitHeuristic::BinnedSAH, 100000);
+}
+
+CPU_TEST(LightBVHBuilder_ParallelBuildBinnedSAOH)
+{
+    testParallelBuild(ctx, LightBVHBuilder::SplitHeuristic::BinnedSAOH, 100000);
+}
+
+CPU_TEST(LightBVHBuilder_BuildBenchmark, TAGS("benchmark"))
+{
+    LightBVHBuilder::Options options;
+    for (uint32_t triangleCount : {10000u, 100000u, 1000000u})
+    {
+        auto triangles = createTriangles(triangleCount, 4321);
+        for (bool parallel : {false, true})
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            auto result = buildNodes(triangles, options, parallel);
+            double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+            EXPECT(!result.nodes.empty());
+            logInfo(
+                "LightBVHBuilder: {} build of {} emissive triangles took {:.2f} ms ({} nodes)",
+                parallel ? "parallel" : "serial",
+                triangleCount,
+                duration,
+                result.nodes.size()
+            );
+        }
+    }
+}
+} // namespace Falcor
@@ -0,0 +1,330 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Animation/AnimationEvaluator.h"
+#include "Utils/Timing/CpuTimer.h"
+#include "Utils/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+struct AnimationDesc
+{
+    uint32_t nodeID = 0;
+    Animation::InterpolationMode mode = Animation::InterpolationMode::Linear;
+    Animation::Behavior preInfinityBehavior = Animation::Behavior::Constant;
+    Animation::Behavior postInfinityBehavior = Animation::Behavior::Constant;
+    bool warping = false;
+    std::vector<Animation::Keyframe> keyframes;
+};
+
+/// Create random animation descriptions covering all interpolation modes and infinity behaviors.
+std::vector<AnimationDesc> createDescs(uint32_t animationCount, uint32_t maxKeyframeCount, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(-1.f, 1.f);
+
+    std::vector<AnimationDesc> descs(animationCount);
+    for (uint32_t i = 0; i < animationCount; ++i)
+    {
+        auto& desc = descs[i];
+        desc.nodeID = i;
+        desc.mode = rng() % 4 == 0 ? Animation::InterpolationMode::Hermite : Animation::InterpolationMode::Linear;
+        desc.preInfinityBehavior = Animation::Behavior(rng() % 4);
+        desc.postInfinityBehavior = Animation::Behavior(rng() % 4);
+        desc.warping = rng() % 4 == 0;
+
+        uint32_t keyframeCount = 1 + rng() % maxKeyframeCount;
+        double time = 0.5 + 0.5 * (rng() % 4);
+        for (uint32_t k = 0; k < keyframeCount; ++k)
+        {
+            Animation::Keyframe keyframe;
+            keyframe.time = time;
+            keyframe.translation = float3(u(rng), u(rng), u(rng)) * 10.f;
+            keyframe.scaling = float3(1.f + 0.5f * u(rng), 1.f + 0.5f * u(rng), 1.f + 0.5f * u(rng));
+            keyframe.rotation = normalize(quatf(u(rng), u(rng), u(rng), u(rng)));
+            desc.keyframes.push_back(keyframe);
+            time += 0.01 + 0.2 * (rng() % 8) / 8.0;
+        }
+    }
+    return descs;
+}
+
+std::vector<ref<Animation>> createAnimations(const std::vector<AnimationDesc>& descs)
+{
+    std::vector<ref<Animation>> animations;
+    for (const auto& desc : descs)
+    {
+        auto pAnimation = Animation::create("", NodeID{desc.nodeID}, desc.keyframes.back().time + 1.0);
+        pAnimation->setInterpolationMode(desc.mode);
+        pAnimation->setPreInfinityBehavior(desc.preInfinityBehavior);
+        pAnimation->setPostInfinityBehavior(desc.postInfinityBehavior);
+        pAnimation->setEnableWarping(desc.warping);
+        for (const auto& keyframe : desc.keyframes)
+            pAnimation->addKeyframe(keyframe);
+        animations.push_back(pAnimation);
+    }
+    return animations;
+}
+
+bool isNear(const float4x4& a, const float4x4& b)
+{
+    for (int r = 0; r < 4; ++r)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            if (std::abs(a[r][c] - b[r][c]) > 1e-4f * std::max(1.f, std::abs(b[r][c])))
+                return false;
+        }
+    }
+    return true;
+}
+
+std::vector<double> createTimes(uint32_t seed)
+{
+    // Playback forward and backward, followed by random access including times outside of the keyframe range.
+    std::vector<double> times;
+    for (double t = -1.0; t < 12.0; t += 0.0371)
+        times.push_back(t);
+    for (double t = 12.0; t > -1.0; t -= 0.0523)
+        times.push_back(t);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> u(-5.0, 30.0);
+    for (uint32_t i = 0; i < 200; ++i)
+        times.push_back(u(rng));
+    return times;
+}
+} // namespace
+
+CPU_TEST(AnimationEvaluator_MatchesAnimate)
+{
+    const uint32_t animationCount = 300;
+    auto descs = createDescs(animationCount, 40, 1);
+    auto animations = createAnimations(descs);
+    auto references = createAnimations(descs);
+
+    AnimationEvaluator evaluator(animations);
+    EXPECT_EQ(evaluator.getAnimationCount(), animationCount);
+
+    std::vector<float4x4> local(animationCount);
+    std::vector<uint8_t> changed(animationCount);
+    uint32_t mismatchCount = 0;
+    for (double time : createTimes(2))
+    {
+        std::fill(changed.begin(), changed.end(), 0);
+        evaluator.evaluate(time, local, changed);
+
+        for (uint32_t i = 0; i < animationCount; ++i)
+        {
+            float4x4 expected = references[i]->animate(time);
+            EXPECT_EQ(changed[i], 1);
+            if (!isNear(local[i], expected) || !isNear(evaluator.evaluate(i, time), expected))
+                mismatchCount++;
+        }
+    }
+    EXPECT_EQ(mismatchCount, 0);
+}
+
+CPU_TEST(AnimationEvaluator_SameNode)
+{
+    auto descs = createDescs(3, 8, 3);
+    descs[0].nodeID = 1;
+    descs[1].nodeID = 1;
+    descs[2].nodeID = 0;
+    auto animations = createAnimations(descs);
+
+    AnimationEvaluator evaluator(animations);
+    std::vector<float4x4> local(3, float4x4::identity());
+    std::vector<uint8_t> changed(3, 0);
+    evaluator.evaluate(0.75, local, changed);
+
+    // The last animation of a node takes effect.
+    EXPECT(isNear(local[1], animations[1]->animate(0.75)));
+    EXPECT(isNear(local[0], animations[2]->animate(0.75)));
+    EXPECT(local[2] == float4x4::identity());
+    EXPECT_EQ(changed[0], 1);
+    EXPECT_EQ(changed[1], 1);
+    EXPECT_EQ(changed[2], 0);
+
+    // Nodes outside of the output range are an error.
+    bool caught = false;
+    try
+    {
+        evaluator.evaluate(0.75, fstd::span<float4x4>(local.data(), 1), changed);
+    }
+    catch (const ArgumentError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+}
+
+CPU_TEST(AnimationEvaluator_OutOfDate)
+{
+    auto animations = createAnimations(createDescs(4, 8, 4));
+    AnimationEvaluator evaluator(animations);
+    EXPECT(!evaluator.isOutOfDate(animations));
+
+    animations[2]->setPostInfinityBehavior(Animation::Behavior::Cycle);
+    EXPECT(evaluator.isOutOfDate(animations));
+
+    evaluator = AnimationEvaluator(animations);
+    EXPECT(!evaluator.isOutOfDate(animations));
+
+    Animation::Keyframe keyframe;
+    keyframe.time = 0.1;
+    animations[0]->addKeyframe(keyframe);
+    EXPECT(evaluator.isOutOfDate(animations));
+
+    evaluator = AnimationEvaluator(animations);
+    animations.pop_back();
+    EXPECT(evaluator.isOutOfDate(animations));
+}
+
+CPU_TEST(AnimationEvaluator_ZeroLength)
+{
+    // An animation with a single keyframe cannot cycle or oscillate, all behaviors hold the keyframe like Constant.
+    const Animation::Behavior behaviors[] = {
+        Animation::Behavior::Constant, Animation::Behavior::Linear, Animation::Behavior::Cycle, Animation::Behavior::Oscillate};
+
+    for (auto behavior : behaviors)
+    {
+        AnimationDesc desc;
+        desc.preInfinityBehavior = behavior;
+        desc.postInfinityBehavior = behavior;
+        Animation::Keyframe keyframe;
+        keyframe.time = 1.0;
+        keyframe.translation = float3(1.f, 2.f, 3.f);
+        keyframe.scaling = float3(2.f);
+        keyframe.rotation = normalize(quatf(0.1f, 0.2f, 0.3f, 0.9f));
+        desc.keyframes.push_back(keyframe);
+
+        auto animations = createAnimations({desc});
+        AnimationEvaluator evaluator(animations);
+        const float4x4 expected = animations[0]->animate(keyframe.time);
+
+        for (double time : {-2.5, 0.0, 0.5, 1.5, 4.0})
+        {
+            float4x4 transform = animations[0]->animate(time);
+            for (int r = 0; r < 4; ++r)
+                for (int c = 0; c < 4; ++c)
+                    EXPECT(std::isfinite(transform[r][c])) << "behavior = " << (int)behavior << ", time = " << time;
+            EXPECT(isNear(transform, expected)) << "behavior = " << (int)behavior << ", time = " << time;
+            EXPECT(isNear(evaluator.evaluate(0, time), expected)) << "behavior = " << (int)behavior << ", time = " << time;
+        }
+    }
+}
+
+CPU_TEST(AnimationEvaluator_Benchmark, TAGS("benchmark"))
+{
+    struct Config
+    {
+        uint32_t animationCount;
+        uint32_t keyframeCount;
+    };
+
+    for (const Config& config : {Config{64, 16384}, Config{10000, 100}})
+    {
+        std::mt19937 rng(5);
+        std::uniform_real_distribution<float> u(-1.f, 1.f);
+        std::vector<ref<Animation>> animations;
+        for (uint32_t i = 0; i < config.animationCount; ++i)
+        {
+            auto pAnimation = Animation::create("", NodeID{i}, config.keyframeCount * 0.1);
+            for (uint32_t k = 0; k < config.keyframeCount; ++k)
+            {
+                Animation::Keyframe keyframe;
+                keyframe.time = k * 0.1;
+                keyframe.translation = float3(u(rng), u(rng), u(rng));
+                keyframe.rotation = normalize(quatf(u(rng), u(rng), u(rng), u(rng)));
+                pAnimation->addKeyframe(keyframe);
+            }
+            animations.push_back(pAnimation);
+        }
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        AnimationEvaluator evaluator(animations);
+        double buildDuration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        logInfo(
+            "AnimationEvaluator: setup of {} animations with {} keyframes each took {:.2f} ms",
+            config.animationCount,
+            config.keyframeCount,
+            buildDuration
+        );
+
+        // Playback advances by a fraction of a keyframe per frame, scrubbing jumps to random times.
+        const uint32_t frameCount = 100;
+        const double animationLength = config.keyframeCount * 0.1;
+        std::vector<double> playbackTimes(frameCount);
+        std::vector<double> scrubTimes(frameCount);
+        for (uint32_t f = 0; f < frameCount; ++f)
+        {
+            playbackTimes[f] = f * 0.033;
+            scrubTimes[f] = std::uniform_real_distribution<double>(0.0, animationLength)(rng);
+        }
+
+        std::vector<float4x4> local(config.animationCount);
+        std::vector<uint8_t> changed(config.animationCount);
+        for (const auto& [name, times] : {std::make_pair("playback", &playbackTimes), std::make_pair("scrubbing", &scrubTimes)})
+        {
+            startTime = CpuTimer::getCurrentTimePoint();
+            for (double time : *times)
+            {
+                for (auto& pAnimation : animations)
+                    local[pAnimation->getNodeID().get()] = pAnimation->animate(time);
+            }
+            double animateDuration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+            double evaluatorDuration[2];
+            for (bool parallel : {false, true})
+            {
+                startTime = CpuTimer::getCurrentTimePoint();
+                for (double time : *times)
+                    evaluator.evaluate(time, local, changed, parallel);
+                evaluatorDuration[parallel] = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+            }
+
+            logInfo(
+                "AnimationEvaluator: {} frames of {} ({} animations): Animation::animate {:.3f} ms, serial evaluator {:.3f} ms, parallel evaluator {:.3f} ms per frame",
+                frameCount,
+                name,
+                config.animationCount,
+                animateDuration / frameCount,
+                evaluatorDuration[0] / frameCount,
+                evaluatorDuration[1] / frameCount
+            );
+        }
+    }
+}
+} // namespace Falcor
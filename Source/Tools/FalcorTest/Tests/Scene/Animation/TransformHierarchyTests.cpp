@@ -0,0 +1,304 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Animation/TransformHierarchy.h"
+#include "Utils/Timing/CpuTimer.h"
+#include "Utils/Logger.h"
+
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+const uint32_t kInvalid = TransformHierarchy::kInvalidNode;
+
+/// Create a scene graph of many small skeletons below a common scene root, like a crowd scene built by SceneBuilder.
+/// Every node's parent has a lower index.
+std::vector<uint32_t> createParents(uint32_t nodeCount, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> parents(nodeCount);
+    uint32_t skeletonRoot = 0;
+    for (uint32_t i = 0; i < nodeCount; ++i)
+    {
+        if (i == 0)
+        {
+            parents[i] = kInvalid;
+        }
+        else if (i == 1 || rng() % 64 == 0)
+        {
+            // Start a new skeleton, most of them attached to the scene root.
+            parents[i] = rng() % 8 == 0 ? kInvalid : 0;
+            skeletonRoot = i;
+        }
+        else
+        {
+            // Attach to one of the recent nodes of the current skeleton to get chains as well as branches.
+            parents[i] = i - 1 - rng() % std::min(i - skeletonRoot, 8u);
+        }
+    }
+    return parents;
+}
+
+std::vector<float4x4> createLocalMatrices(uint32_t nodeCount, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(-1.f, 1.f);
+    std::vector<float4x4> matrices(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i)
+    {
+        matrices[i] = mul(
+            math::matrixFromTranslation(float3(u(rng), u(rng), u(rng))),
+            mul(math::matrixFromRotationXYZ(u(rng), u(rng), u(rng)), math::matrixFromScaling(float3(1.f + 0.1f * u(rng))))
+        );
+    }
+    // Include a few non-affine matrices to exercise the general inverse.
+    for (uint32_t i = 0; i < nodeCount; i += 97)
+        matrices[i][3] = float4(0.01f * u(rng), 0.f, 0.f, 1.f);
+    return matrices;
+}
+
+struct Result
+{
+    std::vector<float4x4> global;
+    std::vector<float4x4> invTransposeGlobal;
+    std::vector<float4x4> skinning;
+    std::vector<float4x4> invTransposeSkinning;
+
+    explicit Result(size_t count) : global(count), invTransposeGlobal(count), skinning(count), invTransposeSkinning(count) {}
+
+    TransformHierarchy::Matrices getMatrices(const std::vector<float4x4>& local, const std::vector<float4x4>& localToBindSpace)
+    {
+        TransformHierarchy::Matrices m;
+        m.local = local;
+        m.global = global;
+        m.invTransposeGlobal = invTransposeGlobal;
+        m.localToBindSpace = localToBindSpace;
+        m.skinning = skinning;
+        m.invTransposeSkinning = invTransposeSkinning;
+        return m;
+    }
+};
+
+bool almostEqual(const float4x4& a, const float4x4& b, float epsilon)
+{
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            if (std::abs(a[r][c] - b[r][c]) > epsilon * std::max(1.f, std::abs(b[r][c])))
+                return false;
+    return true;
+}
+} // namespace
+
+CPU_TEST(TransformHierarchy_Levels)
+{
+    // Parents stored after their children are supported.
+    TransformHierarchy hierarchy({kInvalid, 0, 3, 0, kInvalid, 4});
+    EXPECT_EQ(hierarchy.getNodeCount(), 6u);
+    EXPECT_EQ(hierarchy.getLevelCount(), 3u);
+    EXPECT_EQ(hierarchy.getTopLevelCount(), 3u);
+    EXPECT_EQ(hierarchy.getRangeCount(), 0u);
+
+    // Parents stored first allow processing in index ranges.
+    TransformHierarchy ordered({kInvalid, 0, 0, 2, kInvalid, 4});
+    EXPECT_EQ(ordered.getTopLevelCount(), 0u);
+    EXPECT_EQ(ordered.getRangeCount(), 1u);
+
+    EXPECT_EQ(TransformHierarchy(std::vector<uint32_t>()).getLevelCount(), 0u);
+
+    bool caught = false;
+    try
+    {
+        TransformHierarchy hierarchy(std::vector<uint32_t>{1, 2, 0});
+    }
+    catch (const ArgumentError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+
+    caught = false;
+    try
+    {
+        TransformHierarchy hierarchy(std::vector<uint32_t>{kInvalid, 5});
+    }
+    catch (const ArgumentError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+}
+
+CPU_TEST(TransformHierarchy_Propagate)
+{
+    const uint32_t nodeCount = 20000;
+    auto parents = createParents(nodeCount, 1);
+    auto local = createLocalMatrices(nodeCount, 2);
+    auto localToBindSpace = createLocalMatrices(nodeCount, 3);
+    TransformHierarchy hierarchy(parents);
+
+    // Reference: the serial in-order traversal previously used by AnimationController.
+    std::vector<float4x4> refGlobal(nodeCount);
+    std::vector<float4x4> refInvTransposeGlobal(nodeCount);
+    std::vector<float4x4> refInvTransposeSkinning(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i)
+    {
+        refGlobal[i] = parents[i] == kInvalid ? local[i] : mul(refGlobal[parents[i]], local[i]);
+        refInvTransposeGlobal[i] = transpose(inverse(refGlobal[i]));
+        refInvTransposeSkinning[i] = transpose(inverse(mul(refGlobal[i], localToBindSpace[i])));
+    }
+
+    EXPECT_GT(hierarchy.getRangeCount(), 1u);
+
+    // The same hierarchy with reversed node order (children before parents) is processed level by level.
+    auto reversed = [nodeCount](uint32_t i) { return i == kInvalid ? kInvalid : nodeCount - 1 - i; };
+    std::vector<uint32_t> reversedParents(nodeCount);
+    std::vector<float4x4> reversedLocal(nodeCount);
+    std::vector<float4x4> reversedLocalToBindSpace(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i)
+    {
+        reversedParents[reversed(i)] = reversed(parents[i]);
+        reversedLocal[reversed(i)] = local[i];
+        reversedLocalToBindSpace[reversed(i)] = localToBindSpace[i];
+    }
+    TransformHierarchy reversedHierarchy(reversedParents);
+    EXPECT_EQ(reversedHierarchy.getTopLevelCount(), reversedHierarchy.getLevelCount());
+
+    for (bool parallel : {false, true})
+    {
+        Result result(nodeCount);
+        std::vector<uint8_t> changed(nodeCount, 0);
+        hierarchy.propagate(result.getMatrices(local, localToBindSpace), changed, true, parallel);
+
+        Result reversedResult(nodeCount);
+        reversedHierarchy.propagate(reversedResult.getMatrices(reversedLocal, reversedLocalToBindSpace), changed, true, parallel);
+
+        bool ok = true;
+        for (uint32_t i = 0; i < nodeCount && ok; ++i)
+        {
+            ok = almostEqual(result.global[i], refGlobal[i], 1e-4f) && almostEqual(result.invTransposeGlobal[i], refInvTransposeGlobal[i], 1e-3f) &&
+                 almostEqual(result.skinning[i], mul(result.global[i], localToBindSpace[i]), 1e-5f) &&
+                 almostEqual(result.invTransposeSkinning[i], refInvTransposeSkinning[i], 1e-3f) &&
+                 almostEqual(reversedResult.global[reversed(i)], result.global[i], 0.f) &&
+                 almostEqual(reversedResult.invTransposeSkinning[reversed(i)], result.invTransposeSkinning[i], 0.f);
+            EXPECT(ok) << "node " << i << (parallel ? " (parallel)" : " (serial)");
+        }
+    }
+}
+
+CPU_TEST(TransformHierarchy_ChangedFlags)
+{
+    //     0       4
+    //    / \      |
+    //   1   2     5
+    //   |
+    //   3
+    std::vector<uint32_t> parents = {kInvalid, 0, 0, 1, kInvalid, 4};
+    std::vector<float4x4> local(parents.size(), float4x4::identity());
+    TransformHierarchy hierarchy(parents);
+
+    Result result(parents.size());
+    std::vector<float4x4> empty;
+    auto matrices = result.getMatrices(local, empty);
+    matrices.skinning = {};
+    matrices.invTransposeSkinning = {};
+
+    std::vector<uint8_t> changed(parents.size(), 0);
+    hierarchy.propagate(matrices, changed, true);
+
+    // Change node 1: only its subtree is updated.
+    local[1] = math::matrixFromTranslation(float3(1.f, 2.f, 3.f));
+    local[2] = math::matrixFromTranslation(float3(5.f, 0.f, 0.f)); // Not flagged, must not be picked up.
+    changed = {0, 1, 0, 0, 0, 0};
+    hierarchy.propagate(matrices, changed, false);
+
+    EXPECT_EQ(changed, std::vector<uint8_t>({0, 1, 0, 1, 0, 0}));
+    EXPECT(almostEqual(result.global[3], local[1], 0.f));
+    EXPECT(almostEqual(result.global[2], float4x4::identity(), 0.f));
+    EXPECT(almostEqual(result.invTransposeGlobal[3], transpose(inverse(local[1])), 1e-6f));
+}
+
+CPU_TEST(TransformHierarchy_Benchmark, TAGS("benchmark"))
+{
+    const uint32_t nodeCount = 1000000;
+    auto parents = createParents(nodeCount, 4);
+    auto local = createLocalMatrices(nodeCount, 5);
+    auto localToBindSpace = createLocalMatrices(nodeCount, 6);
+
+    auto startTime = CpuTimer::getCurrentTimePoint();
+    TransformHierarchy hierarchy(parents);
+    double buildDuration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    logInfo(
+        "TransformHierarchy: layout of {} nodes with {} levels ({} top levels, {} index ranges) took {:.2f} ms",
+        nodeCount,
+        hierarchy.getLevelCount(),
+        hierarchy.getTopLevelCount(),
+        hierarchy.getRangeCount(),
+        buildDuration
+    );
+
+    Result result(nodeCount);
+    std::vector<uint8_t> changed(nodeCount, 1);
+    for (bool skinning : {false, true})
+    {
+        auto matrices = result.getMatrices(local, localToBindSpace);
+        if (!skinning)
+        {
+            matrices.localToBindSpace = {};
+            matrices.skinning = {};
+            matrices.invTransposeSkinning = {};
+        }
+
+        for (bool parallel : {false, true})
+        {
+            startTime = CpuTimer::getCurrentTimePoint();
+            hierarchy.propagate(matrices, changed, false, parallel);
+            double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+            logInfo(
+                "TransformHierarchy: {} propagation of {} nodes{} took {:.2f} ms",
+                parallel ? "parallel" : "serial",
+                nodeCount,
+                skinning ? " with skinning" : "",
+                duration
+            );
+        }
+    }
+
+    // Serial in-order traversal with general inverses, as previously done by AnimationController.
+    startTime = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < nodeCount; ++i)
+    {
+        result.global[i] = parents[i] == kInvalid ? local[i] : mul(result.global[parents[i]], local[i]);
+        result.invTransposeGlobal[i] = transpose(inverse(result.global[i]));
+    }
+    double baselineDuration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    logInfo("TransformHierarchy: baseline propagation of {} nodes took {:.2f} ms", nodeCount, baselineDuration);
+}
+} // namespace Falcor
@@ -0,0 +1,115 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Volume/BC4Encode.h"
+
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Decode a BC4 block into 16 values.
+void decodeBC4(uint64_t block, uint8_t* values)
+{
+    const int alpha0 = int(block & 0xff);
+    const int alpha1 = int((block >> 8) & 0xff);
+    uint8_t codes[8] = {(uint8_t)alpha0, (uint8_t)alpha1};
+    if (alpha0 > alpha1)
+    {
+        for (int i = 1; i < 7; ++i)
+            codes[1 + i] = (uint8_t)(((7 - i) * alpha0 + i * alpha1) / 7);
+    }
+    else
+    {
+        for (int i = 1; i < 5; ++i)
+            codes[1 + i] = (uint8_t)(((5 - i) * alpha0 + i * alpha1) / 5);
+        codes[6] = 0;
+        codes[7] = 255;
+    }
+    for (int i = 0; i < 16; ++i)
+        values[i] = codes[(block >> (16 + 3 * i)) & 7];
+}
+
+/// Encode a tile and return the largest absolute error of the decoded values.
+int encodeTile(uint8_t* tile)
+{
+    uint64_t block = 0;
+    CompressAlphaDxt5(tile, &block);
+    uint8_t decoded[16];
+    decodeBC4(block, decoded);
+    int maxError = 0;
+    for (int i = 0; i < 16; ++i)
+        maxError = std::max(maxError, std::abs(int(decoded[i]) - int(tile[i])));
+    return maxError;
+}
+} // namespace
+
+CPU_TEST(BC4Encode)
+{
+    // Constant tiles and tiles with at most two distinct values are exact.
+    for (int value : {0, 1, 128, 254, 255})
+    {
+        uint8_t tile[16];
+        std::fill(tile, tile + 16, (uint8_t)value);
+        EXPECT_EQ(encodeTile(tile), 0) << "value = " << value;
+    }
+    {
+        uint8_t tile[16];
+        for (int i = 0; i < 16; ++i)
+            tile[i] = (i & 1) ? 17 : 200;
+        EXPECT_EQ(encodeTile(tile), 0);
+    }
+
+    // The extremes 0 and 255 are exact next to values in a narrow range.
+    {
+        uint8_t tile[16];
+        for (int i = 0; i < 16; ++i)
+            tile[i] = i == 0 ? 0 : (i == 15 ? 255 : uint8_t(100 + i));
+        uint64_t block = 0;
+        CompressAlphaDxt5(tile, &block);
+        uint8_t decoded[16];
+        decodeBC4(block, decoded);
+        EXPECT_EQ(decoded[0], 0);
+        EXPECT_EQ(decoded[15], 255);
+    }
+
+    // Random tiles stay within half a step of the interpolated codes, which are at most 255 / 5 apart.
+    std::mt19937 rng;
+    for (int t = 0; t < 10000; ++t)
+    {
+        uint8_t tile[16];
+        const int base = int(rng() % 256);
+        const int span = 1 + int(rng() % 256);
+        for (int i = 0; i < 16; ++i)
+            tile[i] = (uint8_t)std::min(255, base + int(rng() % span));
+        const int maxError = encodeTile(tile);
+        EXPECT_LE(maxError, 26) << "tile " << t;
+    }
+}
+} // namespace Falcor
@@ -0,0 +1,229 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Curves/CurveTessellation.h"
+#include "Utils/Timing/CpuTimer.h"
+#include "Utils/Logger.h"
+
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+const uint32_t kSubdivPerSegment = 2;
+const uint32_t kPointCountPerCrossSection = 4;
+
+struct Strands
+{
+    std::vector<uint32_t> vertexCounts;
+    std::vector<float3> points;
+    std::vector<float> widths;
+
+    void add(const std::vector<float3>& strandPoints, float width)
+    {
+        vertexCounts.push_back((uint32_t)strandPoints.size());
+        points.insert(points.end(), strandPoints.begin(), strandPoints.end());
+        widths.insert(widths.end(), strandPoints.size(), width);
+    }
+
+    CurveTessellation::MeshResult toPolytube(uint32_t keepOneEveryXStrands = 1) const
+    {
+        return CurveTessellation::convertToPolytube(
+            (uint32_t)vertexCounts.size(), vertexCounts.data(), points.data(), widths.data(), nullptr, kSubdivPerSegment,
+            keepOneEveryXStrands, 1, 1.f, kPointCountPerCrossSection
+        );
+    }
+
+    CurveTessellation::SweptSphereResult toSweptSphere(uint32_t keepOneEveryXStrands = 1) const
+    {
+        return CurveTessellation::convertToLinearSweptSphere(
+            (uint32_t)vertexCounts.size(), vertexCounts.data(), points.data(), widths.data(), nullptr, 1, kSubdivPerSegment,
+            keepOneEveryXStrands, 1, 1.f, float4x4::identity()
+        );
+    }
+};
+
+/// Straight strand along the x-axis with 4 control points, offset by the given vector.
+std::vector<float3> createStraightStrand(float3 offset)
+{
+    return {offset, offset + float3(1.f, 0.f, 0.f), offset + float3(2.f, 0.f, 0.f), offset + float3(3.f, 0.f, 0.f)};
+}
+
+/// Random wavy strands going upwards.
+Strands createRandomStrands(uint32_t strandCount, uint32_t pointsPerStrand, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(-1.f, 1.f);
+    Strands strands;
+    std::vector<float3> strandPoints(pointsPerStrand);
+    for (uint32_t i = 0; i < strandCount; ++i)
+    {
+        float3 p(u(rng), 0.f, u(rng));
+        for (auto& point : strandPoints)
+        {
+            point = p;
+            p += float3(0.05f * u(rng), 0.1f, 0.05f * u(rng));
+        }
+        strands.add(strandPoints, 0.01f);
+    }
+    return strands;
+}
+} // namespace
+
+CPU_TEST(CurveTessellation_Polytube)
+{
+    Strands strands;
+    strands.add(createStraightStrand(float3(0.f)), 0.2f);
+    auto result = strands.toPolytube();
+
+    // 3 segments with 2 sub-segments each give 7 cross-sections.
+    EXPECT_EQ(result.vertices.size(), 7 * kPointCountPerCrossSection);
+    EXPECT_EQ(result.normals.size(), result.vertices.size());
+    EXPECT_EQ(result.tangents.size(), result.vertices.size());
+    EXPECT_EQ(result.radii.size(), result.vertices.size());
+    EXPECT(result.texCrds.empty());
+    EXPECT_EQ(result.faceVertexCounts.size(), 2 * 6 * kPointCountPerCrossSection);
+    EXPECT_EQ(result.faceVertexIndices.size(), 3 * result.faceVertexCounts.size());
+
+    for (size_t i = 0; i < result.vertices.size(); ++i)
+    {
+        const float3 center = float3(0.5f * (i / kPointCountPerCrossSection), 0.f, 0.f);
+        EXPECT_LE(std::abs(length(result.vertices[i] - center) - result.radii[i]), 1e-5f) << "vertex " << i;
+        EXPECT_LE(std::abs(length(result.normals[i]) - 1.f), 1e-5f) << "vertex " << i;
+        EXPECT_LE(std::abs(result.normals[i].x), 1e-5f) << "vertex " << i;
+    }
+    for (uint32_t index : result.faceVertexIndices)
+        EXPECT_LT(index, result.vertices.size());
+}
+
+CPU_TEST(CurveTessellation_SweptSphere)
+{
+    Strands strands;
+    strands.add(createStraightStrand(float3(0.f)), 0.2f);
+    auto result = strands.toSweptSphere();
+
+    EXPECT_EQ(result.degree, 1u);
+    EXPECT_EQ(result.points.size(), 7);
+    EXPECT_EQ(result.radius.size(), 7);
+    EXPECT_EQ(result.indices.size(), 6);
+    for (uint32_t i = 0; i < result.indices.size(); ++i)
+        EXPECT_EQ(result.indices[i], i);
+    for (size_t i = 0; i < result.points.size(); ++i)
+    {
+        EXPECT_LE(length(result.points[i] - float3(0.5f * i, 0.f, 0.f)), 1e-5f) << "point " << i;
+        EXPECT_LE(std::abs(result.radius[i] - 0.1f), 1e-6f) << "point " << i;
+    }
+}
+
+CPU_TEST(CurveTessellation_ManyStrands)
+{
+    // Many strands are tessellated in parallel, every strand must end up in its own range of the output.
+    const uint32_t strandCount = 1000;
+    Strands strands;
+    for (uint32_t i = 0; i < strandCount; ++i)
+    {
+        auto strandPoints = createStraightStrand(float3(0.f, float(i), 0.f));
+        // Duplicated control points are removed before tessellation.
+        if (i % 3 == 0)
+            strandPoints.insert(strandPoints.begin() + 2, strandPoints[2]);
+        strands.add(strandPoints, 0.2f);
+    }
+
+    for (uint32_t keepOneEveryXStrands : {1u, 2u})
+    {
+        auto mesh = strands.toPolytube(keepOneEveryXStrands);
+        auto curves = strands.toSweptSphere(keepOneEveryXStrands);
+
+        const uint32_t keptStrandCount = strandCount / keepOneEveryXStrands;
+        const uint32_t strandVertexCount = 7 * kPointCountPerCrossSection;
+        const uint32_t strandIndexCount = 3 * 2 * 6 * kPointCountPerCrossSection;
+        EXPECT_EQ(mesh.vertices.size(), keptStrandCount * strandVertexCount);
+        EXPECT_EQ(mesh.faceVertexIndices.size(), keptStrandCount * strandIndexCount);
+        EXPECT_EQ(curves.points.size(), keptStrandCount * 7);
+        EXPECT_EQ(curves.indices.size(), keptStrandCount * 6);
+        if (mesh.faceVertexIndices.size() != keptStrandCount * strandIndexCount || curves.indices.size() != keptStrandCount * 6)
+            continue;
+
+        for (uint32_t s = 0; s < keptStrandCount; ++s)
+        {
+            const float y = float(s * keepOneEveryXStrands);
+            for (uint32_t i = 0; i < strandIndexCount; ++i)
+            {
+                EXPECT_EQ(mesh.faceVertexIndices[s * strandIndexCount + i], mesh.faceVertexIndices[i] + s * strandVertexCount)
+                    << "strand " << s;
+            }
+            for (uint32_t i = 0; i < strandVertexCount; ++i)
+            {
+                const float3 offset = mesh.vertices[s * strandVertexCount + i] - mesh.vertices[i];
+                EXPECT_LE(length(offset - float3(0.f, y, 0.f)), 1e-4f) << "strand " << s;
+            }
+            for (uint32_t i = 0; i < 6; ++i)
+                EXPECT_EQ(curves.indices[s * 6 + i], curves.indices[i] + s * 7) << "strand " << s;
+            for (uint32_t i = 0; i < 7; ++i)
+            {
+                const float3 offset = curves.points[s * 7 + i] - curves.points[i];
+                EXPECT_LE(length(offset - float3(0.f, y, 0.f)), 1e-4f) << "strand " << s;
+            }
+        }
+    }
+}
+
+CPU_TEST(CurveTessellation_Benchmark, TAGS("benchmark"))
+{
+    const uint32_t strandCount = 100000;
+    const uint32_t pointsPerStrand = 16;
+    Strands strands = createRandomStrands(strandCount, pointsPerStrand, 1);
+
+    auto startTime = CpuTimer::getCurrentTimePoint();
+    auto mesh = strands.toPolytube();
+    double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    const size_t triangleCount = mesh.faceVertexCounts.size();
+    logInfo(
+        "CurveTessellation: polytube tessellation of {} strands into {} vertices and {} triangles took {:.2f} ms ({:.2f} M vertices/s, {:.2f} M triangles/s)",
+        strandCount,
+        mesh.vertices.size(),
+        triangleCount,
+        duration,
+        mesh.vertices.size() / (duration * 1e3),
+        triangleCount / (duration * 1e3)
+    );
+
+    startTime = CpuTimer::getCurrentTimePoint();
+    auto curves = strands.toSweptSphere();
+    duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    logInfo(
+        "CurveTessellation: swept sphere tessellation of {} strands into {} points took {:.2f} ms ({:.2f} M vertices/s)",
+        strandCount,
+        curves.points.size(),
+        duration,
+        curves.points.size() / (duration * 1e3)
+    );
+}
+} // namespace Falcor
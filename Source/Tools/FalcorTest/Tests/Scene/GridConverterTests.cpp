@@ -0,0 +1,285 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Volume/GridConverter.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4244 4267)
+#endif
+// GridBuilder.h uses the std::result_of type trait which is removed in C++20, see Grid.cpp.
+#define result_of invoke_result
+#include <nanovdb/util/GridBuilder.h>
+#undef result_of
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+const int kBrickSize = 8;
+
+/// Reference conversion of a grid computed serially, one brick at a time, through the grid accessor.
+struct ReferenceBricks
+{
+    int3 bbMin;
+    int3 leafDim;
+    uint3 atlasSizeBricks;
+    uint32_t occupiedBrickCount;
+    std::vector<uint32_t> range;    ///< Range of the finest level, majorant in the low and minorant in the high 16 bits.
+    std::vector<uint32_t> ptr;      ///< Atlas location of every brick, zero if not occupied.
+    std::vector<uint8_t> atlas;     ///< Atlas texture data.
+};
+
+/// Fill a sphere of voxels with random values that are exactly representable in fp16.
+void fillSphere(nanovdb::GridBuilder<float>& builder, int3 center, int radius, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(1, 256);
+    auto acc = builder.getAccessor();
+    for (int z = -radius; z <= radius; ++z)
+        for (int y = -radius; y <= radius; ++y)
+            for (int x = -radius; x <= radius; ++x)
+                if (x * x + y * y + z * z <= radius * radius)
+                    acc.setValue(nanovdb::Coord(center.x + x, center.y + y, center.z + z), dist(rng) / 256.f);
+}
+
+void fillBox(nanovdb::GridBuilder<float>& builder, int3 min, int3 max, float value)
+{
+    auto acc = builder.getAccessor();
+    for (int z = min.z; z < max.z; ++z)
+        for (int y = min.y; y < max.y; ++y)
+            for (int x = min.x; x < max.x; ++x)
+                acc.setValue(nanovdb::Coord(x, y, z), value);
+}
+
+template<typename TexelType, unsigned int kBitsPerTexel>
+ReferenceBricks computeReference(const nanovdb::FloatGrid* pGrid)
+{
+    const bool bc4 = kBitsPerTexel == 4;
+    ReferenceBricks reference;
+    auto acc = pGrid->getAccessor();
+
+    // The bricks cover the grid bounds aligned to the brick size, padded for 4 range mips.
+    const auto& bbox = pGrid->indexBBox();
+    reference.bbMin = int3(bbox.min().x(), bbox.min().y(), bbox.min().z()) & ~7;
+    int3 bbMax = (int3(bbox.max().x(), bbox.max().y(), bbox.max().z()) + 7) & ~7;
+    reference.leafDim = ((bbMax - reference.bbMin + 63) & ~63) / kBrickSize;
+
+    // Value range over each brick and its 1-voxel halo. Bricks without a leaf or with a constant range are not occupied.
+    std::vector<uint32_t> occupied;
+    for (int z = 0; z < reference.leafDim.z; ++z)
+    {
+        for (int y = 0; y < reference.leafDim.y; ++y)
+        {
+            for (int x = 0; x < reference.leafDim.x; ++x)
+            {
+                nanovdb::Coord origin(reference.bbMin.x + x * kBrickSize, reference.bbMin.y + y * kBrickSize, reference.bbMin.z + z * kBrickSize);
+                float minorant = acc.getValue(origin);
+                float majorant = minorant;
+                bool hasLeaf = acc.probeLeaf(origin) != nullptr;
+                if (hasLeaf)
+                {
+                    for (int k = -1; k <= kBrickSize; ++k)
+                        for (int j = -1; j <= kBrickSize; ++j)
+                            for (int i = -1; i <= kBrickSize; ++i)
+                            {
+                                float value = acc.getValue(origin + nanovdb::Coord(i, j, k));
+                                minorant = std::min(minorant, value);
+                                majorant = std::max(majorant, value);
+                            }
+                }
+                if (!hasLeaf || majorant == minorant)
+                {
+                    reference.range.push_back(f32tof16(majorant) | (f32tof16(majorant) << 16));
+                    reference.ptr.push_back(0);
+                }
+                else
+                {
+                    reference.range.push_back((f32tof16(majorant) + 1) | (f32tof16(minorant) << 16));
+                    reference.ptr.push_back(1);
+                    occupied.push_back((uint32_t)reference.range.size() - 1);
+                }
+            }
+        }
+    }
+
+    // The atlas holds the occupied bricks in index order, with power of 2 sized xy slices.
+    uint32_t n = (uint32_t)occupied.size();
+    reference.occupiedBrickCount = n;
+    uint32_t slice = 1;
+    while (slice * 2 <= 256 && (slice * 2) * (slice * 2) * (slice * 2) <= n + 1)
+        slice *= 2;
+    while (slice < 256 && (n + slice * slice - 1) / (slice * slice) > 256)
+        slice *= 2;
+    reference.atlasSizeBricks = uint3(slice, slice, std::max(1u, (n + slice * slice - 1) / (slice * slice)));
+    uint3 atlasSize = reference.atlasSizeBricks * (uint32_t)kBrickSize;
+    size_t texelCount = size_t(atlasSize.x) * atlasSize.y * atlasSize.z;
+    reference.atlas.resize(bc4 ? texelCount / 2 : texelCount * sizeof(TexelType));
+
+    for (uint32_t brick = 0; brick < n; ++brick)
+    {
+        uint32_t index = occupied[brick];
+        uint3 atlasBrick(
+            brick % reference.atlasSizeBricks.x, (brick / reference.atlasSizeBricks.x) % reference.atlasSizeBricks.y, brick / (slice * slice)
+        );
+        reference.ptr[index] = atlasBrick.x | (atlasBrick.y << 8) | (atlasBrick.z << 16);
+
+        int x = index % reference.leafDim.x;
+        int y = (index / reference.leafDim.x) % reference.leafDim.y;
+        int z = index / (reference.leafDim.x * reference.leafDim.y);
+        nanovdb::Coord origin(reference.bbMin.x + x * kBrickSize, reference.bbMin.y + y * kBrickSize, reference.bbMin.z + z * kBrickSize);
+        float majorant = f16tof32(reference.range[index] & 0xffff);
+        float minorant = f16tof32(reference.range[index] >> 16);
+        float invRange = (bc4 ? 255.f : ((1 << kBitsPerTexel) - 1.f)) / (majorant - minorant);
+
+        for (int k = 0; k < kBrickSize; ++k)
+        {
+            size_t pz = atlasBrick.z * kBrickSize + k;
+            if (bc4)
+            {
+                // Encode 4x4 tiles of each brick slice into blocks, stored in rows of blocks.
+                for (int tj = 0; tj < kBrickSize; tj += 4)
+                {
+                    for (int ti = 0; ti < kBrickSize; ti += 4)
+                    {
+                        uint8_t tile[16];
+                        for (int j = 0; j < 4; ++j)
+                            for (int i = 0; i < 4; ++i)
+                                tile[j * 4 + i] = uint8_t((acc.getValue(origin + nanovdb::Coord(ti + i, tj + j, k)) - minorant) * invRange);
+                        size_t bx = (atlasBrick.x * kBrickSize + ti) / 4;
+                        size_t by = (atlasBrick.y * kBrickSize + tj) / 4;
+                        size_t block = (pz * (atlasSize.y / 4) + by) * (atlasSize.x / 4) + bx;
+                        CompressAlphaDxt5(tile, reference.atlas.data() + block * sizeof(uint64_t));
+                    }
+                }
+            }
+            else
+            {
+                TexelType* atlas = reinterpret_cast<TexelType*>(reference.atlas.data());
+                for (int j = 0; j < kBrickSize; ++j)
+                {
+                    for (int i = 0; i < kBrickSize; ++i)
+                    {
+                        size_t px = atlasBrick.x * kBrickSize + i;
+                        size_t py = atlasBrick.y * kBrickSize + j;
+                        float value = acc.getValue(origin + nanovdb::Coord(i, j, k));
+                        atlas[(pz * atlasSize.y + py) * atlasSize.x + px] = TexelType((value - minorant) * invRange);
+                    }
+                }
+            }
+        }
+    }
+
+    return reference;
+}
+
+template<typename T>
+uint32_t countMismatches(const std::vector<uint8_t>& data, const std::vector<T>& expected)
+{
+    if (data.size() != expected.size() * sizeof(T))
+        return (uint32_t)expected.size();
+    const T* values = reinterpret_cast<const T*>(data.data());
+    uint32_t mismatches = 0;
+    for (size_t i = 0; i < expected.size(); ++i)
+        if (values[i] != expected[i])
+            ++mismatches;
+    return mismatches;
+}
+
+template<typename TexelType, unsigned int kBitsPerTexel>
+void testConversion(GPUUnitTestContext& ctx, const nanovdb::FloatGrid* pGrid, const ReferenceBricks& reference)
+{
+    NanoVDBToBricksConverter<TexelType, kBitsPerTexel> converter(pGrid);
+    BrickedGrid bricks = converter.convert(ctx.getDevice());
+    const auto& stats = converter.getStats();
+
+    EXPECT_EQ(stats.brickCount, reference.ptr.size());
+    EXPECT_EQ(stats.occupiedBrickCount, reference.occupiedBrickCount);
+    EXPECT_EQ(stats.atlasSize, reference.atlas.size());
+
+    ASSERT(bricks.range && bricks.indirection && bricks.atlas);
+    EXPECT_EQ(bricks.range->getWidth(), (uint32_t)reference.leafDim.x);
+    EXPECT_EQ(bricks.range->getHeight(), (uint32_t)reference.leafDim.y);
+    EXPECT_EQ(bricks.range->getDepth(), (uint32_t)reference.leafDim.z);
+    EXPECT_EQ(bricks.atlas->getWidth(), reference.atlasSizeBricks.x * kBrickSize);
+    EXPECT_EQ(bricks.atlas->getHeight(), reference.atlasSizeBricks.y * kBrickSize);
+    EXPECT_EQ(bricks.atlas->getDepth(), reference.atlasSizeBricks.z * kBrickSize);
+    EXPECT_GE(reference.atlasSizeBricks.x * reference.atlasSizeBricks.y * reference.atlasSizeBricks.z, reference.occupiedBrickCount);
+
+    RenderContext* pRenderContext = ctx.getRenderContext();
+    EXPECT_EQ(countMismatches(pRenderContext->readTextureSubresource(bricks.range.get(), 0), reference.range), 0u);
+    EXPECT_EQ(countMismatches(pRenderContext->readTextureSubresource(bricks.indirection.get(), 0), reference.ptr), 0u);
+    EXPECT_EQ(countMismatches(pRenderContext->readTextureSubresource(bricks.atlas.get(), 0), reference.atlas), 0u);
+}
+
+void testConversions(GPUUnitTestContext& ctx, const nanovdb::FloatGrid* pGrid)
+{
+    testConversion<uint8_t, 8>(ctx, pGrid, computeReference<uint8_t, 8>(pGrid));
+    testConversion<uint16_t, 16>(ctx, pGrid, computeReference<uint16_t, 16>(pGrid));
+    testConversion<uint64_t, 4>(ctx, pGrid, computeReference<uint64_t, 4>(pGrid));
+}
+} // namespace
+
+GPU_TEST(GridConverter_SmallGrid)
+{
+    // A random sphere and a constant box, whose inner bricks have a constant range and are not stored in the atlas.
+    nanovdb::GridBuilder<float> builder(0.f);
+    fillSphere(builder, int3(0), 12, 1);
+    fillBox(builder, int3(32), int3(56), 0.5f);
+    auto handle = builder.getHandle(1.0, nanovdb::Vec3d(0.0), "small");
+    const nanovdb::FloatGrid* pGrid = handle.grid<float>();
+    ASSERT(pGrid != nullptr);
+
+    auto reference = computeReference<uint8_t, 8>(pGrid);
+    int3 constantBrick = (int3(40) - reference.bbMin) / kBrickSize;
+    size_t constantIndex = (constantBrick.z * reference.leafDim.y + constantBrick.y) * reference.leafDim.x + constantBrick.x;
+    EXPECT_EQ(reference.ptr[constantIndex], 0u);
+    EXPECT_EQ(reference.range[constantIndex], f32tof16(0.5f) | (f32tof16(0.5f) << 16));
+
+    testConversions(ctx, pGrid);
+}
+
+GPU_TEST(GridConverter_LargeCoordinates)
+{
+    // Two spheres far from the origin and from each other, so most of the bricks covering the bounds are empty.
+    nanovdb::GridBuilder<float> builder(0.f);
+    fillSphere(builder, int3(100000, -50000, 70000), 20, 2);
+    fillSphere(builder, int3(100180, -49890, 69800), 14, 3);
+    auto handle = builder.getHandle(1.0, nanovdb::Vec3d(0.0), "large");
+    const nanovdb::FloatGrid* pGrid = handle.grid<float>();
+    ASSERT(pGrid != nullptr);
+
+    testConversions(ctx, pGrid);
+}
+} // namespace Falcor
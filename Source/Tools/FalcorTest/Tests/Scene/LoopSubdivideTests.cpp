@@ -0,0 +1,218 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "PBRTImporter/LoopSubdivide.h"
+
+namespace Falcor
+{
+namespace
+{
+// Closed mesh, all vertices are interior vertices.
+const std::vector<float3> kTetrahedronPositions = {{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, 1.f}};
+const std::vector<uint32_t> kTetrahedronIndices = {0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3};
+
+// Open fan of triangles around vertex 0, all other vertices are boundary vertices.
+const std::vector<float3> kFanPositions = {{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {1.f, 1.f, 0.f}, {0.f, 1.f, 0.f}, {-1.f, 0.5f, 0.25f}};
+const std::vector<uint32_t> kFanIndices = {0, 1, 2, 0, 2, 3, 0, 3, 4};
+
+// Output of the original implementation based on std::set/std::map and heap allocated vertices and faces.
+const pbrt::LoopSubdivideResult kTetrahedronLevel1 = {
+    // positions
+    {
+        {0.200000003f, 0.199999988f, 0.200000018f}, {0.399999976f, 0.200000018f, 0.199999988f}, {0.199999988f, 0.399999976f, 0.200000018f},
+        {0.200000018f, 0.199999988f, 0.399999976f}, {0.177083328f, 0.322916657f, 0.177083328f}, {0.322916657f, 0.322916687f, 0.177083328f},
+        {0.322916687f, 0.177083328f, 0.177083328f}, {0.322916687f, 0.177083328f, 0.322916657f}, {0.177083328f, 0.177083328f, 0.322916687f},
+        {0.177083328f, 0.322916657f, 0.322916687f},
+    },
+    // normals
+    {
+        {0.0184180867f, 0.0184180811f, 0.0184180774f}, {-0.0184180867f, -1.88194815e-09f, 2.22044605e-16f}, {4.3461732e-09f, -0.0184180867f, 2.17308527e-09f},
+        {-1.88194815e-09f, 2.22044605e-16f, -0.0184180867f}, {0.0873543099f, -1.86264515e-08f, 0.0873543546f}, {-0.0873542577f, -0.0873543024f, -4.47034836e-08f},
+        {2.42143869e-08f, 0.0873542652f, 0.0873543024f}, {-0.0873543024f, -5.21540642e-08f, -0.0873542577f}, {0.0873542503f, 0.0873543173f, 2.04890966e-08f},
+        {-3.35276127e-08f, -0.0873542577f, -0.087354295f},
+    },
+    // indices
+    {
+        0, 4, 6, 4, 2, 5, 6, 5, 1, 4, 5, 6, 0, 6, 8, 6, 1, 7, 8, 7, 3, 6, 7, 8,
+        0, 8, 4, 8, 3, 9, 4, 9, 2, 8, 9, 4, 1, 5, 7, 5, 2, 9, 7, 9, 3, 5, 9, 7,
+    },
+};
+
+const pbrt::LoopSubdivideResult kTetrahedronLevel2 = {
+    // positions
+    {
+        {0.200000003f, 0.200000003f, 0.200000003f}, {0.400000006f, 0.200000003f, 0.200000003f}, {0.200000003f, 0.400000006f, 0.200000003f},
+        {0.200000003f, 0.200000003f, 0.400000006f}, {0.177083328f, 0.322916657f, 0.177083328f}, {0.322916657f, 0.322916687f, 0.177083328f},
+        {0.322916687f, 0.177083328f, 0.177083328f}, {0.322916687f, 0.177083328f, 0.322916657f}, {0.177083328f, 0.177083328f, 0.322916687f},
+        {0.177083328f, 0.322916657f, 0.322916687f}, {0.187825516f, 0.238606766f, 0.187825531f}, {0.256510437f, 0.256510407f, 0.145833328f},
+        {0.238606766f, 0.187825516f, 0.187825516f}, {0.187825516f, 0.385742188f, 0.187825516f}, {0.238606766f, 0.385742188f, 0.187825531f},
+        {0.256510407f, 0.341145843f, 0.145833328f}, {0.341145843f, 0.256510437f, 0.145833328f}, {0.385742188f, 0.238606766f, 0.187825516f},
+        {0.385742188f, 0.187825516f, 0.187825531f}, {0.256510407f, 0.145833328f, 0.256510437f}, {0.187825516f, 0.187825516f, 0.238606766f},
+        {0.385742188f, 0.187825531f, 0.238606766f}, {0.341145843f, 0.145833328f, 0.256510407f}, {0.256510437f, 0.145833328f, 0.341145843f},
+        {0.238606766f, 0.187825516f, 0.385742188f}, {0.187825516f, 0.187825531f, 0.385742188f}, {0.145833328f, 0.256510437f, 0.256510407f},
+        {0.187825531f, 0.238606766f, 0.385742188f}, {0.145833328f, 0.256510407f, 0.341145843f}, {0.145833328f, 0.341145843f, 0.256510437f},
+        {0.187825516f, 0.385742188f, 0.238606766f}, {0.341145843f, 0.256510407f, 0.256510437f}, {0.256510437f, 0.341145843f, 0.256510407f},
+        {0.256510407f, 0.256510437f, 0.341145843f},
+    },
+    // normals
+    {
+        {0.002233251f, 0.00223324937f, 0.00223324983f}, {-0.002233251f, 7.56699592e-10f, 1.51339918e-09f}, {1.51339918e-09f, -0.002233251f, 7.5669937e-10f},
+        {7.56699592e-10f, 1.51339918e-09f, -0.002233251f}, {0.0444300845f, -1.3038516e-08f, 0.0444301106f}, {-0.0444300584f, -0.0444300845f, -3.16649675e-08f},
+        {1.3038516e-08f, 0.0444300584f, 0.0444300808f}, {-0.0444300845f, -3.16649675e-08f, -0.0444300584f}, {0.0444300584f, 0.0444300808f, 1.3038516e-08f},
+        {-3.16649675e-08f, -0.0444300584f, -0.0444300845f}, {0.0267910827f, 0.0097769592f, 0.0267911106f}, {0.0155314431f, 0.0155314719f, 0.0633297488f},
+        {0.00977698062f, 0.0267910622f, 0.0267910827f}, {0.017014116f, -0.00977698062f, 0.0170141179f}, {-0.0170140881f, -0.0267910827f, -1.67638063e-08f},
+        {6.05359674e-09f, -0.0155314431f, 0.0477982983f}, {-0.0155314719f, -6.05359674e-09f, 0.0477983654f}, {-0.0267910622f, -0.017014116f, -2.98023224e-08f},
+        {-0.0097769592f, 0.0170140881f, 0.0170140974f}, {0.0155314701f, 0.0633297488f, 0.0155314384f}, {0.0267910622f, 0.0267910827f, 0.00977698062f},
+        {-0.026791079f, -1.86264515e-08f, -0.0170140881f}, {-0.0155314431f, 0.0477982983f, 6.05359674e-09f}, {-6.05359674e-09f, 0.0477983654f, -0.0155314719f},
+        {-0.017014116f, -2.98023224e-08f, -0.0267910622f}, {0.0170140881f, 0.0170140974f, -0.0097769592f}, {0.0633297488f, 0.0155314384f, 0.0155314691f},
+        {-1.86264515e-08f, -0.0170140881f, -0.026791079f}, {0.0477982983f, 6.05359674e-09f, -0.0155314431f}, {0.0477983654f, -0.0155314701f, -7.4505806e-09f},
+        {-2.98023224e-08f, -0.0267910622f, -0.017014116f}, {-0.0633297488f, -0.0477983654f, -0.0477982983f}, {-0.0477982983f, -0.0633297488f, -0.0477983654f},
+        {-0.0477983654f, -0.0477982983f, -0.0633297488f},
+    },
+    // indices
+    {
+        0, 10, 12, 10, 4, 11, 12, 11, 6, 10, 11, 12, 4, 13, 15, 13, 2, 14, 15, 14, 5, 13, 14, 15,
+        6, 16, 18, 16, 5, 17, 18, 17, 1, 16, 17, 18, 4, 15, 11, 15, 5, 16, 11, 16, 6, 15, 16, 11,
+        0, 12, 20, 12, 6, 19, 20, 19, 8, 12, 19, 20, 6, 18, 22, 18, 1, 21, 22, 21, 7, 18, 21, 22,
+        8, 23, 25, 23, 7, 24, 25, 24, 3, 23, 24, 25, 6, 22, 19, 22, 7, 23, 19, 23, 8, 22, 23, 19,
+        0, 20, 10, 20, 8, 26, 10, 26, 4, 20, 26, 10, 8, 25, 28, 25, 3, 27, 28, 27, 9, 25, 27, 28,
+        4, 29, 13, 29, 9, 30, 13, 30, 2, 29, 30, 13, 8, 28, 26, 28, 9, 29, 26, 29, 4, 28, 29, 26,
+        1, 17, 21, 17, 5, 31, 21, 31, 7, 17, 31, 21, 5, 14, 32, 14, 2, 30, 32, 30, 9, 14, 30, 32,
+        7, 33, 24, 33, 9, 27, 24, 27, 3, 33, 27, 24, 5, 32, 31, 32, 9, 33, 31, 33, 7, 32, 33, 31,
+    },
+};
+
+const pbrt::LoopSubdivideResult kFanLevel1 = {
+    // positions
+    {
+        {0.f, 0.087500006f, 0.043750003f}, {0.825000048f, 0.175000012f, 0.f}, {0.825000048f, 0.825000048f, 0.f},
+        {0.f, 0.912499964f, 0.043750003f}, {-0.650000036f, 0.5f, 0.162500009f}, {0.475000024f, 0.0375000015f, 0.00625000009f},
+        {0.950000048f, 0.5f, 0.f}, {0.489583343f, 0.50000006f, 0.00520833349f}, {0.475000024f, 0.962500036f, 0.00625000009f},
+        {0.f, 0.572916687f, 0.0416666679f}, {-0.450000018f, 0.737500012f, 0.118750006f}, {-0.450000018f, 0.262500018f, 0.118750006f},
+    },
+    // normals
+    {
+        {-0.214687541f, -0.00250000507f, -1.76020861f}, {-0.00406249985f, 0.00156250002f, -0.19312501f}, {-0.00444010459f, -0.000377604039f, -0.309505224f},
+        {-0.0386718698f, 0.0019270851f, -0.314114571f}, {-0.0415625013f, 0.f, -0.190000013f}, {-0.0687239617f, 0.0104947984f, -1.274948f},
+        {-0.014895834f, -0.f, -1.05354178f}, {-0.0977999642f, -0.00622458151f, -2.08076119f}, {-0.0696354136f, 0.00388021208f, -1.3208853f},
+        {-0.253470272f, -0.000586360693f, -2.09203768f}, {-0.195182294f, 0.0027083382f, -1.05895841f}, {-0.229817718f, -0.0027083382f, -1.24854159f},
+    },
+    // indices
+    {
+        0, 5, 7, 5, 1, 6, 7, 6, 2, 5, 6, 7, 0, 7, 9, 7, 2, 8, 9, 8, 3, 7, 8, 9,
+        0, 9, 11, 9, 3, 10, 11, 10, 4, 9, 10, 11,
+    },
+};
+
+const pbrt::LoopSubdivideResult kFanLevel2 = {
+    // positions
+    {
+        {0.f, 0.0843750015f, 0.0421875007f}, {0.831250012f, 0.168750003f, 0.f}, {0.831250012f, 0.831250012f, 0.f},
+        {0.f, 0.915625036f, 0.0421875007f}, {-0.662500024f, 0.5f, 0.165625006f}, {0.478125036f, 0.0328125022f, 0.00546875037f},
+        {0.956250012f, 0.5f, 0.f}, {0.489583343f, 0.5f, 0.00520833349f}, {0.478125036f, 0.967187524f, 0.00546875037f},
+        {0.f, 0.572916627f, 0.0416666679f}, {-0.456250012f, 0.739062488f, 0.119531251f}, {-0.456250012f, 0.260937512f, 0.119531251f},
+        {0.246875018f, 0.0390625f, 0.0179687515f}, {0.495442718f, 0.261067688f, 0.00520833349f}, {0.249348953f, 0.284505218f, 0.0175781269f},
+        {0.678125024f, 0.0734375045f, 0.000781250012f}, {0.925000012f, 0.318749994f, 0.f}, {0.72656256f, 0.26953125f, 0.000651041686f},
+        {0.728515685f, 0.485026002f, 0.000651041686f}, {0.925000012f, 0.681250036f, 0.f}, {0.699869812f, 0.701171935f, 0.000651041686f},
+        {0.24804686f, 0.53125f, 0.0175781287f}, {0.f, 0.332682312f, 0.0416666679f}, {0.678125024f, 0.926562488f, 0.000781250012f},
+        {0.481119812f, 0.738932252f, 0.00520833349f}, {0.247395828f, 0.763671875f, 0.017578125f}, {0.246875018f, 0.9609375f, 0.0179687496f},
+        {0.f, 0.783203185f, 0.0416666679f}, {-0.244791657f, 0.408203095f, 0.0787760466f}, {-0.243750006f, 0.160937503f, 0.078906253f},
+        {-0.243750006f, 0.839062512f, 0.078906253f}, {-0.244791657f, 0.641276002f, 0.0787760392f}, {-0.458333373f, 0.5078125f, 0.119791672f},
+        {-0.606249988f, 0.623437524f, 0.15234375f}, {-0.606249988f, 0.376562506f, 0.15234375f},
+    },
+    // normals
+    {
+        {-0.0603979491f, -0.000592857599f, -0.485095233f}, {-0.000234374995f, 0.000146484424f, -0.0280663855f}, {-0.000261332141f, -5.80851192e-05f, -0.0643422231f},
+        {-0.00813293271f, 0.00025553361f, -0.0649694726f}, {-0.0065576206f, 0.f, -0.0277734566f}, {-0.0145601416f, 0.00192342279f, -0.361480266f},
+        {-0.000944010564f, -0.f, -0.308974534f}, {-0.0207959488f, -0.000858950545f, -0.581287503f}, {-0.0145825231f, 0.000440676697f, -0.366770089f},
+        {-0.0724249706f, -3.45110893e-05f, -0.582936168f}, {-0.0629585832f, 0.000364588574f, -0.309703767f}, {-0.0725207403f, -0.000364573672f, -0.356904268f},
+        {-0.0348543264f, 0.000830886886f, -0.455014646f}, {-0.0205202028f, 2.70344317e-05f, -0.574225247f}, {-0.0466024503f, -0.00066718366f, -0.628209591f},
+        {-0.00375000015f, 0.00146321673f, -0.205771461f}, {-0.000948893256f, 0.000358072924f, -0.196777314f}, {-0.0055807014f, 0.000485776807f, -0.450547546f},
+        {-0.00578912674f, -0.000408180989f, -0.514547288f}, {-0.000862630259f, -0.000325520843f, -0.298785746f}, {-0.00576828746f, -0.000827040116f, -0.456721067f},
+        {-0.0453873947f, -0.000390561298f, -0.606005013f}, {-0.0779241994f, -0.000624660403f, -0.628294587f}, {-0.00485554989f, 5.29002864e-06f, -0.313661277f},
+        {-0.0204237942f, -0.000412898138f, -0.538563251f}, {-0.0409917459f, 0.0002647285f, -0.53991878f}, {-0.0243054163f, 0.000833334401f, -0.315317363f},
+        {-0.0573071279f, 0.000692490488f, -0.459760308f}, {-0.097791411f, -0.000281452114f, -0.57360816f}, {-0.0768888444f, -0.000755209476f, -0.451842517f},
+        {-0.0513090044f, 0.000755209476f, -0.300947309f}, {-0.0880289972f, 0.000281441957f, -0.515926182f}, {-0.091502361f, 0.f, -0.449576199f},
+        {-0.0439526401f, 8.46376643e-05f, -0.196230471f}, {-0.0453930683f, -8.46320763e-05f, -0.202675804f},
+    },
+    // indices
+    {
+        0, 12, 14, 12, 5, 13, 14, 13, 7, 12, 13, 14, 5, 15, 17, 15, 1, 16, 17, 16, 6, 15, 16, 17,
+        7, 18, 20, 18, 6, 19, 20, 19, 2, 18, 19, 20, 5, 17, 13, 17, 6, 18, 13, 18, 7, 17, 18, 13,
+        0, 14, 22, 14, 7, 21, 22, 21, 9, 14, 21, 22, 7, 20, 24, 20, 2, 23, 24, 23, 8, 20, 23, 24,
+        9, 25, 27, 25, 8, 26, 27, 26, 3, 25, 26, 27, 7, 24, 21, 24, 8, 25, 21, 25, 9, 24, 25, 21,
+        0, 22, 29, 22, 9, 28, 29, 28, 11, 22, 28, 29, 9, 27, 31, 27, 3, 30, 31, 30, 10, 27, 30, 31,
+        11, 32, 34, 32, 10, 33, 34, 33, 4, 32, 33, 34, 9, 31, 28, 31, 10, 32, 28, 32, 11, 31, 32, 28,
+    },
+};
+
+void testLoopSubdivide(
+    CPUUnitTestContext& ctx,
+    const std::vector<float3>& positions,
+    const std::vector<uint32_t>& indices,
+    uint32_t levels,
+    const pbrt::LoopSubdivideResult& expected
+)
+{
+    pbrt::LoopSubdivideResult result = pbrt::loopSubdivide(levels, positions, indices);
+
+    // The topology has to match exactly. Positions and normals are compared with a small tolerance,
+    // as the normals are computed with trigonometric functions.
+    ASSERT_EQ(result.positions.size(), expected.positions.size());
+    ASSERT_EQ(result.normals.size(), expected.normals.size());
+    ASSERT(result.indices == expected.indices);
+    for (size_t i = 0; i < expected.positions.size(); i++)
+    {
+        EXPECT(all(abs(result.positions[i] - expected.positions[i]) <= float3(1e-6f))) << "i = " << i;
+        EXPECT(all(abs(result.normals[i] - expected.normals[i]) <= float3(1e-6f))) << "i = " << i;
+    }
+}
+} // namespace
+
+CPU_TEST(LoopSubdivide_Closed)
+{
+    testLoopSubdivide(ctx, kTetrahedronPositions, kTetrahedronIndices, 1, kTetrahedronLevel1);
+    testLoopSubdivide(ctx, kTetrahedronPositions, kTetrahedronIndices, 2, kTetrahedronLevel2);
+}
+
+CPU_TEST(LoopSubdivide_Boundary)
+{
+    testLoopSubdivide(ctx, kFanPositions, kFanIndices, 1, kFanLevel1);
+    testLoopSubdivide(ctx, kFanPositions, kFanIndices, 2, kFanLevel2);
+}
+
+CPU_TEST(LoopSubdivide_Repeated)
+{
+    // Repeated runs reuse the scratch memory of the thread and produce the same output.
+    for (int i = 0; i < 3; i++)
+    {
+        testLoopSubdivide(ctx, kFanPositions, kFanIndices, 2, kFanLevel2);
+        testLoopSubdivide(ctx, kTetrahedronPositions, kTetrahedronIndices, 2, kTetrahedronLevel2);
+    }
+}
+} // namespace Falcor
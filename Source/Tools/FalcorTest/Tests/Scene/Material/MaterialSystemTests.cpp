@@ -0,0 +1,76 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Material/MaterialSystem.h"
+#include "Scene/Material/StandardMaterial.h"
+
+namespace Falcor
+{
+GPU_TEST(MaterialSystem_RemoveDuplicateMaterials)
+{
+    ref<Device> pDevice = ctx.getDevice();
+    MaterialSystem materialSystem(pDevice);
+
+    // Create materials with three distinct sets of parameters.
+    const uint32_t materialCount = 300;
+    std::vector<ref<StandardMaterial>> materials;
+    for (uint32_t i = 0; i < materialCount; ++i)
+    {
+        auto pMaterial = StandardMaterial::create(pDevice, fmt::format("material{}", i));
+        pMaterial->setBaseColor(float4(0.5f, 0.5f, 0.5f, 1.f));
+        pMaterial->setRoughness(0.25f * (i % 3));
+        materials.push_back(pMaterial);
+        EXPECT_EQ(materialSystem.addMaterial(pMaterial), MaterialID(i));
+    }
+
+    // Adding a material again returns the existing ID.
+    EXPECT_EQ(materialSystem.addMaterial(materials[7]), MaterialID(7));
+    EXPECT_EQ(materialSystem.getMaterialCount(), materialCount);
+
+    // Equal materials have equal hashes.
+    EXPECT(materials[0]->isEqual(materials[3]));
+    EXPECT_EQ(materials[0]->computeHash(), materials[3]->computeHash());
+    EXPECT(!materials[0]->isEqual(materials[1]));
+    EXPECT_NE(materials[0]->computeHash(), materials[1]->computeHash());
+
+    std::vector<MaterialID> idMap;
+    size_t removed = materialSystem.removeDuplicateMaterials(idMap);
+    EXPECT_EQ(removed, materialCount - 3);
+    EXPECT_EQ(materialSystem.getMaterialCount(), 3);
+    EXPECT_EQ(idMap.size(), materialCount);
+    for (uint32_t i = 0; i < materialCount; ++i)
+        EXPECT_EQ(idMap[i], MaterialID(i % 3)) << "material " << i;
+
+    // The first material of each set is kept.
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        EXPECT(materialSystem.getMaterial(MaterialID(i)) == materials[i]);
+        EXPECT_EQ(materialSystem.addMaterial(materials[i]), MaterialID(i));
+    }
+}
+} // namespace Falcor
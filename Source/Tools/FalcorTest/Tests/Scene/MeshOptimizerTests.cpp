@@ -0,0 +1,175 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+using Triangle = std::array<uint32_t, 3>;
+
+/// Create a regular grid of n x n quads in the xy-plane.
+void createGrid(uint32_t n, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+{
+    for (uint32_t y = 0; y <= n; y++)
+        for (uint32_t x = 0; x <= n; x++)
+            positions.push_back(float3(float(x), float(y), 0.f));
+
+    for (uint32_t y = 0; y < n; y++)
+    {
+        for (uint32_t x = 0; x < n; x++)
+        {
+            uint32_t i = y * (n + 1) + x;
+            indices.insert(indices.end(), {i, i + 1, i + n + 1, i + 1, i + n + 2, i + n + 1});
+        }
+    }
+}
+
+/// Return the sorted list of triangles, keeping the vertex order within each triangle.
+std::vector<Triangle> getTriangles(const std::vector<uint32_t>& indices)
+{
+    std::vector<Triangle> triangles;
+    for (size_t i = 0; i < indices.size(); i += 3)
+        triangles.push_back({indices[i], indices[i + 1], indices[i + 2]});
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+void shuffleTriangles(std::vector<uint32_t>& indices)
+{
+    std::vector<Triangle> triangles = getTriangles(indices);
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1234));
+    indices.clear();
+    for (const auto& t : triangles)
+        indices.insert(indices.end(), t.begin(), t.end());
+}
+} // namespace
+
+CPU_TEST(MeshOptimizer_analyzeVertexCache)
+{
+    // Single triangle.
+    {
+        std::vector<uint32_t> indices = {0, 1, 2};
+        auto stats = MeshOptimizer::analyzeVertexCache(indices, 3);
+        EXPECT_EQ(stats.triangleCount, 1u);
+        EXPECT_EQ(stats.vertexCount, 3u);
+        EXPECT_EQ(stats.transformedVertexCount, 3u);
+        EXPECT_EQ(stats.getACMR(), 3.f);
+        EXPECT_EQ(stats.getATVR(), 1.f);
+    }
+
+    // Quad with shared edge.
+    {
+        std::vector<uint32_t> indices = {0, 1, 2, 2, 1, 3};
+        auto stats = MeshOptimizer::analyzeVertexCache(indices, 4);
+        EXPECT_EQ(stats.transformedVertexCount, 4u);
+        EXPECT_EQ(stats.getACMR(), 2.f);
+    }
+
+    // Cache of size 3 evicts vertex 0 before it is reused.
+    {
+        std::vector<uint32_t> indices = {0, 1, 2, 3, 4, 5, 0, 1, 2};
+        auto stats = MeshOptimizer::analyzeVertexCache(indices, 6, 3);
+        EXPECT_EQ(stats.vertexCount, 6u);
+        EXPECT_EQ(stats.transformedVertexCount, 9u);
+    }
+}
+
+CPU_TEST(MeshOptimizer_optimizeVertexCache)
+{
+    std::vector<float3> positions;
+    std::vector<uint32_t> indices;
+    createGrid(64, positions, indices);
+    shuffleTriangles(indices);
+
+    const auto triangles = getTriangles(indices);
+    const uint32_t vertexCount = (uint32_t)positions.size();
+
+    auto before = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+    MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+    auto after = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+
+    // The triangles (including their winding) must be unchanged.
+    EXPECT(getTriangles(indices) == triangles);
+
+    // A shuffled grid has an ACMR close to 3, a good ordering is well below 1.
+    EXPECT_GT(before.getACMR(), 2.5f);
+    EXPECT_LT(after.getACMR(), 0.8f);
+    EXPECT_LT(after.getATVR(), 1.6f);
+}
+
+CPU_TEST(MeshOptimizer_optimizeOverdraw)
+{
+    // Create a closed box from six grids.
+    std::vector<float3> positions;
+    std::vector<uint32_t> indices;
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        std::vector<float3> facePositions;
+        std::vector<uint32_t> faceIndices;
+        createGrid(16, facePositions, faceIndices);
+
+        uint32_t offset = (uint32_t)positions.size();
+        for (float3 p : facePositions)
+        {
+            float3 q = float3(p.x / 16.f - 0.5f, p.y / 16.f - 0.5f, 0.5f);
+            switch (face)
+            {
+            case 0: positions.push_back(float3(q.x, q.y, q.z)); break;
+            case 1: positions.push_back(float3(q.y, q.x, -q.z)); break;
+            case 2: positions.push_back(float3(q.z, q.x, q.y)); break;
+            case 3: positions.push_back(float3(-q.z, q.y, q.x)); break;
+            case 4: positions.push_back(float3(q.y, q.z, q.x)); break;
+            case 5: positions.push_back(float3(q.x, -q.z, q.y)); break;
+            }
+        }
+        for (uint32_t i : faceIndices)
+            indices.push_back(offset + i);
+    }
+
+    const auto triangles = getTriangles(indices);
+    const uint32_t vertexCount = (uint32_t)positions.size();
+    const float threshold = 1.05f;
+
+    MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+    auto before = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+    MeshOptimizer::optimizeOverdraw(indices, positions, threshold);
+    auto after = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+
+    EXPECT(getTriangles(indices) == triangles);
+
+    // Each cluster meets the ACMR target, but the cache is not shared across clusters so allow some slack.
+    EXPECT_LT(after.getACMR(), before.getACMR() * threshold * 1.1f);
+}
+} // namespace Falcor
@@ -0,0 +1,352 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/Platform/OS.h"
+#include "Utils/Threading.h"
+#include "Utils/Timing/CpuTimer.h"
+#include "PBRTImporter/Parser.h"
+
+#include <fstream>
+#include <iterator>
+
+namespace Falcor
+{
+namespace
+{
+using namespace pbrt;
+
+/// Parser target that records all directives as strings, without their file locations.
+class RecordingTarget : public ParserTarget
+{
+public:
+    std::vector<std::string> directives;
+    size_t directiveCount = 0;
+    bool recordDirectives = true; ///< If false, directives are only counted.
+
+    void onScale(Float sx, Float sy, Float sz, FileLoc loc) override { record("Scale", {sx, sy, sz}); }
+    void onShape(const std::string& name, ParsedParameterVector params, FileLoc loc) override { record("Shape " + name, params); }
+    void onOption(const std::string& name, const std::string& value, FileLoc loc) override { record("Option " + name + " " + value); }
+    void onIdentity(FileLoc loc) override { record("Identity"); }
+    void onTranslate(Float dx, Float dy, Float dz, FileLoc loc) override { record("Translate", {dx, dy, dz}); }
+    void onRotate(Float angle, Float ax, Float ay, Float az, FileLoc loc) override { record("Rotate", {angle, ax, ay, az}); }
+    void onLookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz, Float ux, Float uy, Float uz, FileLoc loc) override
+    {
+        record("LookAt", {ex, ey, ez, lx, ly, lz, ux, uy, uz});
+    }
+    void onConcatTransform(Float transform[16], FileLoc loc) override { record("ConcatTransform", std::vector<Float>(transform, transform + 16)); }
+    void onTransform(Float transform[16], FileLoc loc) override { record("Transform", std::vector<Float>(transform, transform + 16)); }
+    void onCoordinateSystem(const std::string& name, FileLoc loc) override { record("CoordinateSystem " + name); }
+    void onCoordSysTransform(const std::string& name, FileLoc loc) override { record("CoordSysTransform " + name); }
+    void onActiveTransformAll(FileLoc loc) override { record("ActiveTransform All"); }
+    void onActiveTransformEndTime(FileLoc loc) override { record("ActiveTransform EndTime"); }
+    void onActiveTransformStartTime(FileLoc loc) override { record("ActiveTransform StartTime"); }
+    void onTransformTimes(Float start, Float end, FileLoc loc) override { record("TransformTimes", {start, end}); }
+    void onColorSpace(const std::string& name, FileLoc loc) override { record("ColorSpace " + name); }
+    void onPixelFilter(const std::string& name, ParsedParameterVector params, FileLoc loc) override { record("PixelFilter " + name, params); }
+    void onFilm(const std::string& type, ParsedParameterVector params, FileLoc loc) override { record("Film " + type, params); }
+    void onAccelerator(const std::string& name, ParsedParameterVector params, FileLoc loc) override { record("Accelerator " + name, params); }
+    void onIntegrator(const std::string& name, ParsedParameterVector params, FileLoc loc) override { record("Integrator " + name, params); }
+    void onCamera(const std::string& name, ParsedParameterVector params, FileLoc loc) override { record("Camera " + name, params); }
+    void onMakeNamedMedium(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        record("MakeNamedMedium " + name, params);
+    }
+    void onMediumInterface(const std::string& insideName, const std::string& outsideName, FileLoc loc) override
+    {
+        record("MediumInterface " + insideName + " " + outsideName);
+    }
+    void onSampler(const std::string& name, ParsedParameterVector params, FileLoc loc) override { record("Sampler " + name, params); }
+    void onWorldBegin(FileLoc loc) override { record("WorldBegin"); }
+    void onAttributeBegin(FileLoc loc) override { record("AttributeBegin"); }
+    void onAttributeEnd(FileLoc loc) override { record("AttributeEnd"); }
+    void onAttribute(const std::string& target, ParsedParameterVector params, FileLoc loc) override { record("Attribute " + target, params); }
+    void onTexture(const std::string& name, const std::string& type, const std::string& texname, ParsedParameterVector params, FileLoc loc)
+        override
+    {
+        record("Texture " + name + " " + type + " " + texname, params);
+    }
+    void onMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override { record("Material " + name, params); }
+    void onMakeNamedMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        record("MakeNamedMaterial " + name, params);
+    }
+    void onNamedMaterial(const std::string& name, FileLoc loc) override { record("NamedMaterial " + name); }
+    void onLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override { record("LightSource " + name, params); }
+    void onAreaLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        record("AreaLightSource " + name, params);
+    }
+    void onReverseOrientation(FileLoc loc) override { record("ReverseOrientation"); }
+    void onObjectBegin(const std::string& name, FileLoc loc) override { record("ObjectBegin " + name); }
+    void onObjectEnd(FileLoc loc) override { record("ObjectEnd"); }
+    void onObjectInstance(const std::string& name, FileLoc loc) override { record("ObjectInstance " + name); }
+    void onEndOfFiles() override { record("EndOfFiles"); }
+
+private:
+    void record(std::string directive)
+    {
+        directiveCount++;
+        if (recordDirectives)
+            directives.push_back(std::move(directive));
+    }
+
+    void record(std::string directive, const std::vector<Float>& values)
+    {
+        if (recordDirectives)
+        {
+            for (Float v : values)
+                directive += fmt::format(" {}", v);
+        }
+        record(std::move(directive));
+    }
+
+    void record(std::string directive, const ParsedParameterVector& params)
+    {
+        if (recordDirectives)
+        {
+            for (const auto& param : params)
+                directive += " " + param.toString();
+        }
+        record(std::move(directive));
+    }
+};
+
+void writeFile(const std::filesystem::path& path, const std::string& contents)
+{
+    std::ofstream fs(path, std::ios_base::binary);
+    fs << contents;
+}
+
+std::vector<std::string> tokenize(Tokenizer& tokenizer)
+{
+    std::vector<std::string> tokens;
+    while (auto token = tokenizer.next())
+        tokens.emplace_back(token->token);
+    return tokens;
+}
+
+std::vector<std::string> parseFileDirectives(const std::filesystem::path& path)
+{
+    RecordingTarget target;
+    parseFile(target, path);
+    return target.directives;
+}
+
+std::vector<std::string> parseStringDirectives(const std::string& str)
+{
+    RecordingTarget target;
+    parseString(target, str);
+    return target.directives;
+}
+
+/// Create a file with a list of shapes, large enough to still be parsed while the importing file continues.
+std::string createShapes(uint32_t count, float radiusOffset)
+{
+    std::string str;
+    for (uint32_t i = 0; i < count; i++)
+        str += fmt::format("Translate {} 0 0\nShape \"sphere\" \"float radius\" [ {} ]\n", i, radiusOffset + i);
+    return str;
+}
+
+/// Create a file with triangle meshes of about the given size, similar to the geometry files of large pbrt-v4 exports.
+std::string createMeshes(size_t size, uint32_t seed)
+{
+    std::string str;
+    str.reserve(size + 4096);
+    for (uint32_t mesh = 0; str.size() < size; mesh++)
+    {
+        str += "AttributeBegin\nShape \"trianglemesh\"\n  \"point3 P\" [";
+        for (uint32_t i = 0; i < 1000; i++)
+            str += fmt::format(" {:.6f} {:.6f} {:.6f}", (seed + i) * 0.001f, (mesh + i) * 0.002f, i * 0.003f);
+        str += " ]\n  \"integer indices\" [";
+        for (uint32_t i = 0; i < 999; i++)
+            str += fmt::format(" {} {} {}", i, (i + 1) % 1000, (i + 2) % 1000);
+        str += " ]\nAttributeEnd\n";
+    }
+    return str;
+}
+
+double toMBps(uint64_t byteCount, double durationMs)
+{
+    return durationMs > 0.0 ? byteCount / (1024.0 * 1024.0) / (durationMs * 1e-3) : 0.0;
+}
+} // namespace
+
+CPU_TEST(PBRTParser_TokenizeFile)
+{
+    auto directory = getTempFilePath();
+    std::filesystem::create_directories(directory);
+
+    // Memory mapped files are tokenized like strings, including escaped strings and comments.
+    const std::string contents = "WorldBegin # comment\nShape \"sphere\" \"float radius\" [ 0.5 ]\nTexture \"a\\\"b\" \"spectrum\" \"imagemap\"\n";
+    auto path = directory / "scene.pbrt";
+    writeFile(path, contents);
+
+    auto pFileTokenizer = Tokenizer::createFromFile(path);
+    auto pStringTokenizer = Tokenizer::createFromString(contents);
+    EXPECT_EQ(pFileTokenizer->getSize(), contents.size());
+    EXPECT_EQ(pFileTokenizer->getPath(), path);
+    EXPECT(tokenize(*pFileTokenizer) == tokenize(*pStringTokenizer));
+
+    // Empty files can't be mapped and are read instead.
+    auto emptyPath = directory / "empty.pbrt";
+    writeFile(emptyPath, "");
+    auto pEmptyTokenizer = Tokenizer::createFromFile(emptyPath);
+    EXPECT_EQ(pEmptyTokenizer->getSize(), 0u);
+    EXPECT(tokenize(*pEmptyTokenizer).empty());
+
+    std::filesystem::remove_all(directory);
+}
+
+CPU_TEST(PBRTParser_Import)
+{
+    auto directory = getTempFilePath();
+    std::filesystem::create_directories(directory);
+
+    const std::string a = "Translate 4 5 6\nShape \"trianglemesh\" \"point3 P\" [ 0 0 0 1 0 0 0 1 0 ] \"integer indices\" [ 0 1 2 ]\n";
+    const std::string b = createShapes(500, 1.f);
+    const std::string c = createShapes(50, 1000.f);
+    writeFile(directory / "a.pbrt", a);
+    writeFile(directory / "b.pbrt", b);
+    writeFile(directory / "c.pbrt", c);
+
+    const std::string main = "WorldBegin\n"
+                             "AttributeBegin\n"
+                             "Translate 1 2 3\n"
+                             "Import \"b.pbrt\"\n"
+                             "Shape \"sphere\" \"float radius\" [ 1 ]\n"
+                             "Import \"a.pbrt\"\n"
+                             "AttributeEnd\n"
+                             "Import \"c.pbrt\"\n"
+                             "Shape \"sphere\" \"float radius\" [ 2 ]\n";
+    writeFile(directory / "main.pbrt", main);
+
+    // The directives of imported files are replayed in file order, with their graphics state scoped to the file.
+    auto scope = [](const std::string& str) { return "AttributeBegin\n" + str + "AttributeEnd\n"; };
+    const std::string expected = "WorldBegin\n"
+                                 "AttributeBegin\n"
+                                 "Translate 1 2 3\n" +
+                                 scope(b) + "Shape \"sphere\" \"float radius\" [ 1 ]\n" + scope(a) + "AttributeEnd\n" + scope(c) +
+                                 "Shape \"sphere\" \"float radius\" [ 2 ]\n";
+
+    auto directives = parseFileDirectives(directory / "main.pbrt");
+    auto expectedDirectives = parseStringDirectives(expected);
+    ASSERT_EQ(directives.size(), expectedDirectives.size());
+    for (size_t i = 0; i < directives.size(); i++)
+        EXPECT_EQ(directives[i], expectedDirectives[i]) << "i = " << i;
+
+    // Errors in imported files are reported.
+    writeFile(directory / "missing.pbrt", "WorldBegin\nImport \"does_not_exist.pbrt\"\n");
+    bool caught = false;
+    try
+    {
+        parseFileDirectives(directory / "missing.pbrt");
+    }
+    catch (const RuntimeError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+
+    std::filesystem::remove_all(directory);
+}
+
+CPU_TEST(PBRTParser_Benchmark, TAGS("benchmark"))
+{
+    auto directory = getTempFilePath();
+    std::filesystem::create_directories(directory);
+
+    // The same geometry is referenced once through Import (parsed concurrently) and once through Include (parsed serially).
+    const uint32_t fileCount = 16;
+    const size_t fileSize = 8 << 20;
+    std::string importMain = "WorldBegin\n";
+    std::string includeMain = "WorldBegin\n";
+    uint64_t byteCount = 0;
+    for (uint32_t i = 0; i < fileCount; i++)
+    {
+        std::string name = fmt::format("geometry_{}.pbrt", i);
+        std::string contents = createMeshes(fileSize, i);
+        byteCount += contents.size();
+        writeFile(directory / name, contents);
+        importMain += fmt::format("Import \"{}\"\n", name);
+        includeMain += fmt::format("AttributeBegin\nInclude \"{}\"\nAttributeEnd\n", name);
+    }
+    writeFile(directory / "import.pbrt", importMain);
+    writeFile(directory / "include.pbrt", includeMain);
+
+    // Tokenize the files from memory mapped files and, for comparison, from strings read from the files.
+    for (bool mapped : {false, true})
+    {
+        size_t tokenCount = 0;
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < fileCount; i++)
+        {
+            auto path = directory / fmt::format("geometry_{}.pbrt", i);
+            std::unique_ptr<Tokenizer> pTokenizer;
+            if (mapped)
+            {
+                pTokenizer = Tokenizer::createFromFile(path);
+            }
+            else
+            {
+                std::ifstream fs(path, std::ios_base::binary);
+                pTokenizer = Tokenizer::createFromString(std::string(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>()));
+            }
+            while (pTokenizer->next())
+                tokenCount++;
+        }
+        double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        EXPECT_GT(tokenCount, 0u);
+        logInfo(
+            "PBRTParser: {} tokenization of {:.1f} MB took {:.2f} ms ({:.1f} MB/s, {} tokens)", mapped ? "mapped" : "read",
+            byteCount / (1024.0 * 1024.0), duration, toMBps(byteCount, duration), tokenCount
+        );
+    }
+
+    // Parse the scene with serial includes and with concurrent imports.
+    size_t serialDirectiveCount = 0;
+    for (bool import : {false, true})
+    {
+        RecordingTarget target;
+        target.recordDirectives = false;
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        parseFile(target, directory / (import ? "import.pbrt" : "include.pbrt"));
+        double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        if (import)
+            EXPECT_EQ(target.directiveCount, serialDirectiveCount);
+        else
+            serialDirectiveCount = target.directiveCount;
+        logInfo(
+            "PBRTParser: parsing {:.1f} MB with {} took {:.2f} ms ({:.1f} MB/s, {} threads)", byteCount / (1024.0 * 1024.0),
+            import ? "concurrent imports" : "serial includes", duration, toMBps(byteCount, duration), Threading::getThreadCount()
+        );
+    }
+
+    std::filesystem::remove_all(directory);
+}
+} // namespace Falcor
@@ -0,0 +1,225 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBuilder.h"
+#include "Scene/TriangleMesh.h"
+#include "Scene/Material/StandardMaterial.h"
+
+#include <pybind11/pytypes.h>
+
+namespace Falcor
+{
+namespace
+{
+Settings createWeldSettings(float epsilon)
+{
+    pybind11::dict options;
+    options["SceneBuilder"] = pybind11::dict();
+    options["SceneBuilder"]["vertexWeldEpsilon"] = epsilon;
+
+    Settings settings;
+    settings.addOptions(options);
+    return settings;
+}
+
+/// Process two triangles sharing an edge, given as a triangle soup with separate vertices for each triangle.
+void testWeldTriangleSoup(GPUUnitTestContext& ctx, float epsilon, const std::vector<float3>& positions, uint32_t expectedVertexCount)
+{
+    SceneBuilder builder(ctx.getDevice(), createWeldSettings(epsilon), SceneBuilder::Flags::WeldVertices);
+
+    const std::vector<uint32_t> indices = {0, 1, 2, 3, 4, 5};
+    const float3 normal(0.f, 0.f, 1.f);
+    const float4 tangent(1.f, 0.f, 0.f, 1.f);
+
+    SceneBuilder::Mesh mesh;
+    mesh.name = "soup";
+    mesh.faceCount = 2;
+    mesh.vertexCount = (uint32_t)positions.size();
+    mesh.indexCount = (uint32_t)indices.size();
+    mesh.pIndices = indices.data();
+    mesh.topology = Vao::Topology::TriangleList;
+    mesh.pMaterial = StandardMaterial::create(ctx.getDevice(), "soup");
+    mesh.positions = {positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex};
+    mesh.normals = {&normal, SceneBuilder::Mesh::AttributeFrequency::Constant};
+    mesh.tangents = {&tangent, SceneBuilder::Mesh::AttributeFrequency::Constant};
+    mesh.useOriginalTangentSpace = true;
+
+    SceneBuilder::ProcessedMesh processed = builder.processMesh(mesh);
+    EXPECT_EQ(processed.staticData.size(), expectedVertexCount);
+    EXPECT_EQ(processed.weldedVertexCount, positions.size() - expectedVertexCount);
+    ASSERT_EQ(processed.indexCount, indices.size());
+    ASSERT(processed.use16BitIndices);
+
+    // Each corner is replaced by a vertex within the weld tolerance.
+    const uint16_t* pIndices = reinterpret_cast<const uint16_t*>(processed.indexData.data());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        ASSERT_LT(pIndices[i], processed.staticData.size());
+        float3 position = processed.staticData[pIndices[i]].position;
+        EXPECT(all(abs(position - positions[i]) <= float3(epsilon))) << "i = " << i;
+    }
+}
+
+std::vector<ref<TriangleMesh>> createTriangleMeshes()
+{
+    return {
+        TriangleMesh::createQuad(),
+        TriangleMesh::createCube(),
+        TriangleMesh::createSphere(0.5f, 8, 4),
+        TriangleMesh::createSphere(1.f, 16, 8),
+        TriangleMesh::createCube(float3(2.f)),
+    };
+}
+
+std::vector<ref<Material>> createMaterials(ref<Device> pDevice, size_t count)
+{
+    std::vector<ref<Material>> materials;
+    for (size_t i = 0; i < count; i++)
+        materials.push_back(StandardMaterial::create(pDevice, fmt::format("material{}", i)));
+    return materials;
+}
+
+/// Add one instance of each mesh and build the scene.
+ref<Scene> buildScene(SceneBuilder& builder, const std::vector<MeshID>& meshIDs)
+{
+    for (size_t i = 0; i < meshIDs.size(); i++)
+    {
+        NodeID nodeID = builder.addNode({fmt::format("node{}", i), float4x4::identity(), float4x4::identity()});
+        builder.addMeshInstance(nodeID, meshIDs[i]);
+    }
+    return builder.getScene();
+}
+} // namespace
+
+GPU_TEST(SceneBuilder_AddTriangleMeshes)
+{
+    // Adding a batch of meshes gives the same mesh IDs and scene as adding them one by one.
+    auto meshes = createTriangleMeshes();
+
+    SceneBuilder batchBuilder(ctx.getDevice(), Settings(), SceneBuilder::Flags::Default);
+    auto batchMaterials = createMaterials(ctx.getDevice(), meshes.size());
+    std::vector<MeshID> batchIDs = batchBuilder.addTriangleMeshes(meshes, batchMaterials);
+
+    SceneBuilder sequentialBuilder(ctx.getDevice(), Settings(), SceneBuilder::Flags::Default);
+    auto sequentialMaterials = createMaterials(ctx.getDevice(), meshes.size());
+    std::vector<MeshID> sequentialIDs;
+    for (size_t i = 0; i < meshes.size(); i++)
+        sequentialIDs.push_back(sequentialBuilder.addTriangleMesh(meshes[i], sequentialMaterials[i]));
+
+    ASSERT_EQ(batchIDs.size(), meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+        EXPECT_EQ(batchIDs[i].get(), sequentialIDs[i].get()) << "i = " << i;
+
+    ref<Scene> pBatchScene = buildScene(batchBuilder, batchIDs);
+    ref<Scene> pSequentialScene = buildScene(sequentialBuilder, sequentialIDs);
+    ASSERT_EQ(pBatchScene->getMeshCount(), pSequentialScene->getMeshCount());
+    for (uint32_t i = 0; i < pBatchScene->getMeshCount(); i++)
+    {
+        const auto& batchMesh = pBatchScene->getMesh(MeshID{i});
+        const auto& sequentialMesh = pSequentialScene->getMesh(MeshID{i});
+        EXPECT_EQ(pBatchScene->getMeshName(i), pSequentialScene->getMeshName(i)) << "i = " << i;
+        EXPECT_EQ(batchMesh.vertexCount, sequentialMesh.vertexCount) << "i = " << i;
+        EXPECT_EQ(batchMesh.indexCount, sequentialMesh.indexCount) << "i = " << i;
+        EXPECT_EQ(batchMesh.materialID, sequentialMesh.materialID) << "i = " << i;
+    }
+}
+
+GPU_TEST(SceneBuilder_AddMeshesErrors)
+{
+    SceneBuilder builder(ctx.getDevice(), Settings(), SceneBuilder::Flags::Default);
+    auto meshes = createTriangleMeshes();
+
+    // Each mesh needs a material.
+    {
+        auto materials = createMaterials(ctx.getDevice(), meshes.size() - 1);
+        bool caught = false;
+        try
+        {
+            builder.addTriangleMeshes(meshes, materials);
+        }
+        catch (const ArgumentError&)
+        {
+            caught = true;
+        }
+        EXPECT(caught);
+    }
+
+    // Errors when processing a mesh of the batch are reported to the caller.
+    {
+        const std::vector<uint32_t> indices = {0, 1, 2};
+        SceneBuilder::Mesh valid;
+        valid.name = "valid";
+        valid.faceCount = 1;
+        valid.vertexCount = 3;
+        valid.indexCount = 3;
+        valid.pIndices = indices.data();
+        valid.topology = Vao::Topology::TriangleList;
+        valid.pMaterial = StandardMaterial::create(ctx.getDevice(), "valid");
+        const std::vector<float3> positions = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}};
+        valid.positions = {positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex};
+
+        SceneBuilder::Mesh invalid = valid;
+        invalid.name = "invalid";
+        invalid.positions = {};
+
+        const std::vector<SceneBuilder::Mesh> batch = {valid, invalid, valid};
+        bool caught = false;
+        try
+        {
+            builder.addMeshes(batch);
+        }
+        catch (const RuntimeError&)
+        {
+            caught = true;
+        }
+        EXPECT(caught);
+    }
+}
+
+GPU_TEST(SceneBuilder_WeldExact)
+{
+    // The shared edge is duplicated exactly, -0 matches +0.
+    testWeldTriangleSoup(ctx, 0.f, {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 1, 0}, {1, 0, 0}, {1, 1, 0}}, 4);
+    testWeldTriangleSoup(ctx, 0.f, {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {-0.f, 1, 0}, {1, 0, -0.f}, {1, 1, 0}}, 4);
+
+    // Vertices that are close but not equal are kept without a tolerance.
+    testWeldTriangleSoup(ctx, 0.f, {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 1.0001f, 0}, {1.0001f, 0, 0}, {1, 1, 0}}, 6);
+}
+
+GPU_TEST(SceneBuilder_WeldEpsilon)
+{
+    // Vertices within the tolerance are welded, also across grid cell borders.
+    const std::vector<float3> jittered = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 1.0001f, 0}, {0.9999f, 0, 0}, {1, 1, 0}};
+    testWeldTriangleSoup(ctx, 1e-3f, jittered, 4);
+    testWeldTriangleSoup(ctx, 1e-5f, jittered, 6);
+
+    // Positions far outside of the range of grid cells are still welded correctly.
+    const std::vector<float3> large = {{0, 0, 0}, {1e30f, 0, 0}, {0, -1e30f, 0}, {0, -1e30f, 0}, {1e30f, 0, 0}, {1e30f, -1e30f, 0}};
+    testWeldTriangleSoup(ctx, 1e-3f, large, 4);
+}
+} // namespace Falcor
@@ -0,0 +1,181 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneCache.h"
+#include "Utils/CryptoUtils.h"
+
+#include <fstream>
+
+namespace Falcor
+{
+namespace
+{
+// Large enough to be split into several 4 MB chunks.
+const uint32_t kVertexCount = 300000;
+const uint32_t kIndexCount = 1500000;
+
+SceneCache::Key createKey(const std::string& name)
+{
+    SHA1 sha1;
+    sha1.update(name);
+    return sha1.finalize();
+}
+
+std::filesystem::path getCachePath(const SceneCache::Key& key)
+{
+    return getAppDataDirectory() / "NVIDIA/Falcor/SceneCache" / SHA1::toString(key);
+}
+
+Scene::SceneData createSceneData(ref<Device> pDevice)
+{
+    Scene::SceneData sceneData;
+    sceneData.path = "test.pyscene";
+    sceneData.pMaterials = std::make_unique<MaterialSystem>(pDevice);
+    sceneData.meshNames = {"mesh"};
+
+    sceneData.meshStaticData.resize(kVertexCount);
+    for (uint32_t i = 0; i < kVertexCount; ++i)
+    {
+        auto& v = sceneData.meshStaticData[i];
+        v.position = float3(float(i), float(i % 7), float(i % 13));
+        v.packedNormalTangentCurveRadius = float3(float(i % 3), 0.f, 1.f);
+        v.texCrd = float2(float(i % 11), float(i % 17));
+    }
+
+    sceneData.meshIndexData.resize(kIndexCount);
+    for (uint32_t i = 0; i < kIndexCount; ++i)
+        sceneData.meshIndexData[i] = (i * 2654435761u) % kVertexCount;
+
+    return sceneData;
+}
+
+void checkSceneData(GPUUnitTestContext& ctx, const Scene::SceneData& expected, const Scene::SceneData& sceneData)
+{
+    EXPECT_EQ(sceneData.path, expected.path);
+    ASSERT_EQ(sceneData.meshNames.size(), expected.meshNames.size());
+    EXPECT_EQ(sceneData.meshNames[0], expected.meshNames[0]);
+
+    ASSERT_EQ(sceneData.meshStaticData.size(), expected.meshStaticData.size());
+    EXPECT(std::memcmp(sceneData.meshStaticData.data(), expected.meshStaticData.data(), expected.meshStaticData.size() * sizeof(PackedStaticVertexData)) == 0);
+
+    EXPECT(sceneData.meshIndexData == expected.meshIndexData);
+}
+} // namespace
+
+GPU_TEST(SceneCache_RoundTripChunked)
+{
+    const auto key = createKey("SceneCache_RoundTripChunked");
+    const auto sceneData = createSceneData(ctx.getDevice());
+
+    SceneCache::writeCache(sceneData, key);
+    EXPECT(SceneCache::hasValidCache(key));
+
+    {
+        auto readData = SceneCache::readCache(ctx.getDevice(), key);
+        EXPECT(!readData.mappedMeshData);
+        checkSceneData(ctx, sceneData, readData);
+    }
+
+    // Reading a subset of the sections leaves the other fields default initialized.
+    {
+        auto readData = SceneCache::readCache(ctx.getDevice(), key, SceneCache::Sections::Metadata);
+        EXPECT_EQ(readData.path, sceneData.path);
+        EXPECT(readData.meshStaticData.empty());
+        EXPECT(readData.meshIndexData.empty());
+    }
+
+    std::filesystem::remove(getCachePath(key));
+}
+
+GPU_TEST(SceneCache_RoundTripUncompressedMeshData)
+{
+    const auto key = createKey("SceneCache_RoundTripUncompressedMeshData");
+    auto sceneData = createSceneData(ctx.getDevice());
+    sceneData.meshSkinningData.resize(1000);
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        auto& v = sceneData.meshSkinningData[i];
+        v.boneID = uint4(i, i + 1, i + 2, i + 3);
+        v.boneWeight = float4(0.25f);
+        v.staticIndex = i;
+        v.bindMatrixID = i % 5;
+        v.skeletonMatrixID = i % 3;
+    }
+
+    SceneCache::writeCache(sceneData, key, true);
+    EXPECT(SceneCache::hasValidCache(key));
+
+    {
+        // The mesh data is referenced in the mapped file instead of being copied to the vectors.
+        auto readData = SceneCache::readCache(ctx.getDevice(), key);
+        EXPECT(readData.meshStaticData.empty());
+        EXPECT(readData.meshIndexData.empty());
+        EXPECT(readData.meshSkinningData.empty());
+        ASSERT(readData.mappedMeshData.has_value());
+
+        const auto& mapped = *readData.mappedMeshData;
+        EXPECT(mapped.pFile != nullptr);
+        ASSERT_EQ(mapped.staticData.size(), sceneData.meshStaticData.size());
+        ASSERT_EQ(mapped.indexData.size(), sceneData.meshIndexData.size());
+        ASSERT_EQ(mapped.skinningData.size(), sceneData.meshSkinningData.size());
+        EXPECT(std::memcmp(mapped.staticData.data(), sceneData.meshStaticData.data(), sceneData.meshStaticData.size() * sizeof(PackedStaticVertexData)) == 0);
+        EXPECT(std::memcmp(mapped.indexData.data(), sceneData.meshIndexData.data(), sceneData.meshIndexData.size() * sizeof(uint32_t)) == 0);
+        EXPECT(std::memcmp(mapped.skinningData.data(), sceneData.meshSkinningData.data(), sceneData.meshSkinningData.size() * sizeof(SkinningVertexData)) == 0);
+        EXPECT_EQ(readData.path, sceneData.path);
+    }
+
+    std::filesystem::remove(getCachePath(key));
+}
+
+GPU_TEST(SceneCache_InvalidChunkCount)
+{
+    const auto key = createKey("SceneCache_InvalidChunkCount");
+    SceneCache::writeCache(createSceneData(ctx.getDevice()), key);
+
+    // Corrupt the chunk count in the header (following the magic, version, section count and table of contents offset).
+    {
+        std::fstream fs(getCachePath(key), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+        const uint64_t chunkCount = 1ull << 60;
+        fs.seekp(24);
+        fs.write(reinterpret_cast<const char*>(&chunkCount), sizeof(chunkCount));
+    }
+
+    bool thrown = false;
+    try
+    {
+        SceneCache::readCache(ctx.getDevice(), key);
+    }
+    catch (const RuntimeError&)
+    {
+        thrown = true;
+    }
+    EXPECT(thrown);
+
+    std::filesystem::remove(getCachePath(key));
+}
+} // namespace Falcor
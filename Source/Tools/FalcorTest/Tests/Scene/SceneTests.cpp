@@ -0,0 +1,102 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBuilder.h"
+#include "Scene/TriangleMesh.h"
+#include "Scene/Material/StandardMaterial.h"
+
+namespace Falcor
+{
+namespace
+{
+const uint32_t kInstanceCount = 3;
+const uint32_t kFlipMask = (uint32_t)GeometryInstanceFlags::TransformFlipped | (uint32_t)GeometryInstanceFlags::IsWorldFrontFaceCW;
+
+/// Create a scene with instances of a single cube mesh, each on its own node.
+ref<Scene> createInstancedScene(ref<Device> pDevice)
+{
+    SceneBuilder builder(pDevice, Settings(), SceneBuilder::Flags::DontOptimizeGraph);
+    MeshID meshID = builder.addTriangleMesh(TriangleMesh::createCube(), StandardMaterial::create(pDevice, "cube"));
+    for (uint32_t i = 0; i < kInstanceCount; i++)
+    {
+        float4x4 transform = math::matrixFromTranslation(float3(2.f * i, 0.f, 0.f));
+        NodeID nodeID = builder.addNode({fmt::format("node{}", i), transform, float4x4::identity()});
+        builder.addMeshInstance(nodeID, meshID);
+    }
+    return builder.getScene();
+}
+
+/// Check that the geometry instance data on the GPU matches the data on the CPU.
+void checkGeometryInstanceBuffer(GPUUnitTestContext& ctx, const ref<Scene>& pScene)
+{
+    ref<Buffer> pBuffer = pScene->getParameterBlock()->getBuffer("geometryInstances");
+    ASSERT(pBuffer != nullptr);
+    ASSERT_GE(pBuffer->getSize(), pScene->getGeometryInstanceCount() * sizeof(GeometryInstanceData));
+
+    const GeometryInstanceData* pData = reinterpret_cast<const GeometryInstanceData*>(pBuffer->map(Buffer::MapType::Read));
+    for (uint32_t i = 0; i < pScene->getGeometryInstanceCount(); i++)
+    {
+        EXPECT(std::memcmp(&pData[i], &pScene->getGeometryInstance(i), sizeof(GeometryInstanceData)) == 0) << "i = " << i;
+    }
+    pBuffer->unmap();
+}
+} // namespace
+
+GPU_TEST(Scene_UpdateGeometryInstanceFlags)
+{
+    ref<Scene> pScene = createInstancedScene(ctx.getDevice());
+    pScene->update(ctx.getRenderContext(), 0.0);
+    ASSERT_EQ(pScene->getGeometryInstanceCount(), kInstanceCount);
+
+    for (uint32_t i = 0; i < kInstanceCount; i++)
+        EXPECT_EQ(pScene->getGeometryInstance(i).flags & kFlipMask, 0u) << "i = " << i;
+    checkGeometryInstanceBuffer(ctx, pScene);
+
+    // Mirror the node of one instance. Only the flags of that instance change, on the CPU and the GPU.
+    const uint32_t flippedInstance = 1;
+    const uint32_t nodeID = pScene->getGeometryInstance(flippedInstance).globalMatrixID;
+    const float4x4 mirror = math::matrixFromScaling(float3(-1.f, 1.f, 1.f));
+    pScene->updateNodeTransform(nodeID, mirror);
+    pScene->update(ctx.getRenderContext(), 0.0);
+
+    for (uint32_t i = 0; i < kInstanceCount; i++)
+    {
+        uint32_t expectedFlags = i == flippedInstance ? kFlipMask : 0u;
+        EXPECT_EQ(pScene->getGeometryInstance(i).flags & kFlipMask, expectedFlags) << "i = " << i;
+    }
+    checkGeometryInstanceBuffer(ctx, pScene);
+
+    // Restore the node. The flags are cleared again.
+    pScene->updateNodeTransform(nodeID, float4x4::identity());
+    pScene->update(ctx.getRenderContext(), 0.0);
+
+    for (uint32_t i = 0; i < kInstanceCount; i++)
+        EXPECT_EQ(pScene->getGeometryInstance(i).flags & kFlipMask, 0u) << "i = " << i;
+    checkGeometryInstanceBuffer(ctx, pScene);
+}
+} // namespace Falcor
@@ -47,6 +47,7 @@ CPU_TEST(SHA1)
         std::string str{"Hello World!"};
         SHA1::MD md{0x2e, 0xf7, 0xbd, 0xe6, 0x08, 0xce, 0x54, 0x04, 0xe9, 0x7d, 0x5f, 0x04, 0x2f, 0x95, 0xf8, 0x9f, 0x1c, 0x23, 0x28, 0x71};
         EXPECT(SHA1::compute(str.data(), str.size()) == md);
+        EXPECT_EQ(SHA1::toString(md), "2ef7bde608ce5404e97d5f042f95f89f1c232871");
     }
 
     {
@@ -0,0 +1,136 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/ImageWriteQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace Falcor
+{
+CPU_TEST(ImageWriteQueue_Execute)
+{
+    std::atomic<uint32_t> counter = 0;
+    {
+        ImageWriteQueue queue;
+        for (uint32_t i = 0; i < 100; i++)
+            queue.enqueue(1, [&]() { counter++; });
+        queue.flush();
+        EXPECT_EQ(counter, 100u);
+
+        auto stats = queue.getStats();
+        EXPECT_EQ(stats.jobsQueued, 100u);
+        EXPECT_EQ(stats.jobsCompleted, 100u);
+        EXPECT_EQ(stats.jobsFailed, 0u);
+        EXPECT_EQ(stats.memoryInFlight, 0u);
+
+        // Jobs still queued are executed before the queue is destroyed.
+        for (uint32_t i = 0; i < 100; i++)
+            queue.enqueue(1, [&]() { counter++; });
+    }
+    EXPECT_EQ(counter, 200u);
+}
+
+CPU_TEST(ImageWriteQueue_MemoryBudget)
+{
+    const size_t kBudget = 1000;
+    const size_t kJobSize = 300;
+
+    ImageWriteQueue queue(kBudget, 4);
+    std::atomic<size_t> memoryInUse = 0;
+    std::atomic<size_t> peakMemoryInUse = 0;
+
+    for (uint32_t i = 0; i < 50; i++)
+    {
+        // Track the memory in use by the accepted jobs, which is released when the job is destroyed.
+        std::shared_ptr<void> pData(nullptr, [&](void*) { memoryInUse -= kJobSize; });
+        queue.enqueue(
+            kJobSize,
+            [&, pData]()
+            {
+                size_t peak = peakMemoryInUse;
+                while (peak < memoryInUse && !peakMemoryInUse.compare_exchange_weak(peak, memoryInUse))
+                    ;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        );
+        memoryInUse += kJobSize;
+    }
+    queue.flush();
+
+    EXPECT_EQ(memoryInUse, 0u);
+    EXPECT_LE(peakMemoryInUse, kBudget);
+    EXPECT_LE(queue.getStats().peakMemoryInFlight, kBudget);
+    EXPECT_EQ(queue.getStats().memoryInFlight, 0u);
+
+    // A job larger than the budget is accepted when the queue is empty.
+    bool executed = false;
+    queue.enqueue(2 * kBudget, [&]() { executed = true; });
+    queue.flush();
+    EXPECT(executed);
+}
+
+CPU_TEST(ImageWriteQueue_DestroyOnOwnerThread)
+{
+    ImageWriteQueue queue;
+    const auto ownerThreadId = std::this_thread::get_id();
+    std::atomic<uint32_t> destroyedOnOwner = 0;
+
+    for (uint32_t i = 0; i < 20; i++)
+    {
+        std::shared_ptr<void> pResource(
+            nullptr,
+            [&](void*)
+            {
+                if (std::this_thread::get_id() == ownerThreadId)
+                    destroyedOnOwner++;
+            }
+        );
+        queue.enqueue(1, [pResource]() {});
+    }
+    queue.flush();
+    EXPECT_EQ(destroyedOnOwner, 20u);
+}
+
+CPU_TEST(ImageWriteQueue_Exceptions)
+{
+    ImageWriteQueue queue;
+    std::atomic<uint32_t> counter = 0;
+    queue.enqueue(1, []() { throw std::runtime_error("Test error"); });
+    queue.enqueue(1, []() { throw 42; });
+    queue.enqueue(1, [&]() { counter++; });
+    queue.flush();
+
+    EXPECT_EQ(counter, 1u);
+    EXPECT_EQ(queue.getStats().jobsCompleted, 3u);
+    EXPECT_EQ(queue.getStats().jobsFailed, 2u);
+}
+} // namespace Falcor
@@ -0,0 +1,183 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/MipGenerator.h"
+
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+float srgbToLinear(uint8_t v)
+{
+    float f = v / 255.f;
+    return f <= 0.04045f ? f / 12.92f : std::pow((f + 0.055f) / 1.055f, 2.4f);
+}
+
+float computeCoverage(const Bitmap& bitmap, float alphaReference)
+{
+    const uint8_t* pData = bitmap.getData();
+    size_t texelCount = size_t(bitmap.getWidth()) * bitmap.getHeight();
+    size_t count = 0;
+    for (size_t i = 0; i < texelCount; ++i)
+        count += pData[i * 4 + 3] / 255.f > alphaReference ? 1 : 0;
+    return float(count) / float(texelCount);
+}
+} // namespace
+
+CPU_TEST(MipGenerator_MipSizes)
+{
+    EXPECT_EQ(MipGenerator::getMipCount(1, 1), 1);
+    EXPECT_EQ(MipGenerator::getMipCount(4, 4), 3);
+    EXPECT_EQ(MipGenerator::getMipCount(5, 3), 3);
+    EXPECT_EQ(MipGenerator::getMipCount(1024, 7), 11);
+
+    std::vector<float> data(5 * 3, 1.f);
+    auto pBase = Bitmap::create(5, 3, ResourceFormat::R32Float, reinterpret_cast<const uint8_t*>(data.data()));
+    auto mips = MipGenerator::generateMips(*pBase, {});
+    ASSERT_EQ(mips.size(), 2);
+    EXPECT_EQ(mips[0]->getWidth(), 2);
+    EXPECT_EQ(mips[0]->getHeight(), 1);
+    EXPECT_EQ(mips[1]->getWidth(), 1);
+    EXPECT_EQ(mips[1]->getHeight(), 1);
+
+    // Constant images stay constant for both filters.
+    for (auto filter : {MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser})
+    {
+        MipGenerator::Options options;
+        options.filter = filter;
+        for (const auto& pMip : MipGenerator::generateMips(*pBase, options))
+        {
+            const float* pData = reinterpret_cast<const float*>(pMip->getData());
+            for (uint32_t i = 0; i < pMip->getWidth() * pMip->getHeight(); ++i)
+                EXPECT(std::abs(pData[i] - 1.f) < 1e-5f) << "value=" << pData[i];
+        }
+    }
+
+    bool caught = false;
+    try
+    {
+        std::vector<uint8_t> bc(16);
+        MipGenerator::generateMips(*Bitmap::create(4, 4, ResourceFormat::BC1Unorm, bc.data()), {});
+    }
+    catch (const ArgumentError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+    EXPECT(!MipGenerator::isFormatSupported(ResourceFormat::RGB10A2Unorm));
+    EXPECT(MipGenerator::isFormatSupported(ResourceFormat::BGRA8UnormSrgb));
+}
+
+CPU_TEST(MipGenerator_Box)
+{
+    // 4x2 RGBA32Float with distinct values. Each texel of mip 1 is the average of a 2x2 block.
+    std::vector<float> data(4 * 2 * 4);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = float(i);
+    auto pBase = Bitmap::create(4, 2, ResourceFormat::RGBA32Float, reinterpret_cast<const uint8_t*>(data.data()));
+    auto mips = MipGenerator::generateMips(*pBase, {});
+    ASSERT_EQ(mips.size(), 2);
+
+    const float* pMip1 = reinterpret_cast<const float*>(mips[0]->getData());
+    for (uint32_t x = 0; x < 2; ++x)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            float expected = 0.f;
+            for (uint32_t y = 0; y < 2; ++y)
+                expected += 0.25f * (data[(y * 4 + 2 * x) * 4 + c] + data[(y * 4 + 2 * x + 1) * 4 + c]);
+            EXPECT(std::abs(pMip1[x * 4 + c] - expected) < 1e-4f) << "x=" << x << " c=" << c;
+        }
+    }
+
+    const float* pMip2 = reinterpret_cast<const float*>(mips[1]->getData());
+    for (uint32_t c = 0; c < 4; ++c)
+        EXPECT(std::abs(pMip2[c] - 0.5f * (pMip1[c] + pMip1[4 + c])) < 1e-4f);
+}
+
+CPU_TEST(MipGenerator_Srgb)
+{
+    // Black and white checkerboard with alpha 0 and 1.
+    std::vector<uint8_t> data(2 * 2 * 4);
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        uint8_t v = (i == 0 || i == 3) ? 255 : 0;
+        for (uint32_t c = 0; c < 4; ++c)
+            data[i * 4 + c] = v;
+    }
+
+    // Filtered in linear space, the color is 0.5 linear. Alpha is never sRGB encoded.
+    auto pBase = Bitmap::create(2, 2, ResourceFormat::RGBA8UnormSrgb, data.data());
+    auto mips = MipGenerator::generateMips(*pBase, {});
+    ASSERT_EQ(mips.size(), 1);
+    const uint8_t* pMip = mips[0]->getData();
+    for (uint32_t c = 0; c < 3; ++c)
+        EXPECT(std::abs(srgbToLinear(pMip[c]) - 0.5f) < 0.01f) << "value=" << (int)pMip[c];
+    EXPECT_EQ(pMip[3], 128);
+
+    // Linear formats are only treated as sRGB when requested.
+    auto pLinear = Bitmap::create(2, 2, ResourceFormat::RGBA8Unorm, data.data());
+    EXPECT_EQ(MipGenerator::generateMips(*pLinear, {})[0]->getData()[0], 128);
+    MipGenerator::Options options;
+    options.srgb = true;
+    EXPECT_EQ(MipGenerator::generateMips(*pLinear, options)[0]->getData()[0], pMip[0]);
+}
+
+CPU_TEST(MipGenerator_AlphaCoverage)
+{
+    // Noisy alpha around the reference value. Plain filtering pulls alpha towards the mean and changes the coverage.
+    const uint32_t size = 256;
+    std::vector<uint8_t> data(size * size * 4);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (uint32_t i = 0; i < size * size; ++i)
+    {
+        data[i * 4 + 0] = data[i * 4 + 1] = data[i * 4 + 2] = 255;
+        data[i * 4 + 3] = (uint8_t)(dist(rng) < 80 ? 255 : dist(rng) / 3);
+    }
+    auto pBase = Bitmap::create(size, size, ResourceFormat::RGBA8Unorm, data.data());
+    const float alphaReference = 0.5f;
+    const float baseCoverage = computeCoverage(*pBase, alphaReference);
+
+    MipGenerator::Options options;
+    options.alphaReference = alphaReference;
+    options.preserveAlphaCoverage = true;
+    auto mips = MipGenerator::generateMips(*pBase, options);
+    auto plainMips = MipGenerator::generateMips(*pBase, {});
+    ASSERT_EQ(mips.size(), 8);
+
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        EXPECT(std::abs(computeCoverage(*mips[i], alphaReference) - baseCoverage) < 0.02f)
+            << "mip=" << i + 1 << " coverage=" << computeCoverage(*mips[i], alphaReference) << " base=" << baseCoverage;
+    }
+    EXPECT(std::abs(computeCoverage(*plainMips[2], alphaReference) - baseCoverage) > 0.1f);
+}
+} // namespace Falcor
@@ -0,0 +1,306 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/Platform/OS.h"
+#include "Utils/Image/NpzWriter.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+struct ZipEntry
+{
+    std::string fileName;
+    uint16_t method;
+    uint32_t crc32;
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+    std::vector<uint8_t> data;
+};
+
+uint16_t read16(const uint8_t* p)
+{
+    return uint16_t(p[0] | (p[1] << 8));
+}
+
+uint32_t read32(const uint8_t* p)
+{
+    return uint32_t(read16(p)) | (uint32_t(read16(p + 2)) << 16);
+}
+
+/// Read the entries of a zip archive using its central directory.
+std::vector<ZipEntry> readZip(CPUUnitTestContext& ctx, const std::filesystem::path& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    std::vector<ZipEntry> entries;
+    if (file.size() < 22)
+        return entries;
+
+    const uint8_t* pEnd = file.data() + file.size() - 22;
+    EXPECT_EQ(read32(pEnd), 0x06054b50u);
+    uint16_t entryCount = read16(pEnd + 10);
+    uint32_t indexSize = read32(pEnd + 12);
+    uint32_t indexOffset = read32(pEnd + 16);
+    EXPECT_EQ(indexOffset + indexSize + 22, file.size());
+
+    const uint8_t* p = file.data() + indexOffset;
+    for (uint16_t i = 0; i < entryCount; i++)
+    {
+        EXPECT_EQ(read32(p), 0x02014b50u);
+        ZipEntry entry;
+        entry.method = read16(p + 10);
+        entry.crc32 = read32(p + 16);
+        entry.compressedSize = read32(p + 20);
+        entry.uncompressedSize = read32(p + 24);
+        uint16_t nameLength = read16(p + 28);
+        uint32_t localOffset = read32(p + 42);
+        entry.fileName = std::string(reinterpret_cast<const char*>(p + 46), nameLength);
+        p += 46 + nameLength;
+
+        const uint8_t* pLocal = file.data() + localOffset;
+        EXPECT_EQ(read32(pLocal), 0x04034b50u);
+        EXPECT_EQ(read16(pLocal + 8), entry.method);
+        EXPECT_EQ(read32(pLocal + 14), entry.crc32);
+        EXPECT_EQ(read16(pLocal + 26), nameLength);
+        const uint8_t* pData = pLocal + 30 + nameLength + read16(pLocal + 28);
+        entry.data.assign(pData, pData + entry.compressedSize);
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+} // namespace
+
+CPU_TEST(NpzWriter_Stored)
+{
+    std::vector<float> a = {1.f, 2.f, 3.f, 4.f, 5.f, 6.f};
+    std::vector<uint8_t> b = {7, 8, 9};
+
+    auto path = getTempFilePath();
+    {
+        NpzWriter writer(path);
+        writer.append(NpzWriter::encodeArray("a", "<f4", {2, 3}, a.data(), a.size() * sizeof(float), false));
+        writer.append(NpzWriter::encodeArray("b", "|u1", {3}, b.data(), b.size(), false));
+        EXPECT_EQ(writer.getArrayCount(), 2);
+    }
+
+    auto entries = readZip(ctx, path);
+    ASSERT_EQ(entries.size(), 2);
+    EXPECT_EQ(entries[0].fileName, "a.npy");
+    EXPECT_EQ(entries[1].fileName, "b.npy");
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        const auto& entry = entries[i];
+        EXPECT_EQ(entry.method, 0);
+        EXPECT_EQ(entry.compressedSize, entry.uncompressedSize);
+
+        // Check the .npy header and data.
+        ASSERT_GE(entry.data.size(), 10);
+        EXPECT(std::memcmp(entry.data.data(), "\x93NUMPY", 6) == 0);
+        uint16_t headerLength = read16(entry.data.data() + 8);
+        EXPECT_EQ((10 + headerLength) % 16, 0);
+        std::string header(reinterpret_cast<const char*>(entry.data.data() + 10), headerLength);
+        const void* pExpected = i == 0 ? (const void*)a.data() : (const void*)b.data();
+        size_t expectedSize = i == 0 ? a.size() * sizeof(float) : b.size();
+        ASSERT_EQ(entry.data.size(), 10 + headerLength + expectedSize);
+        EXPECT(std::memcmp(entry.data.data() + 10 + headerLength, pExpected, expectedSize) == 0);
+        EXPECT_NE(header.find(i == 0 ? "'descr': '<f4'" : "'descr': '|u1'"), std::string::npos);
+        EXPECT_NE(header.find(i == 0 ? "'shape': (2, 3)" : "'shape': (3,)"), std::string::npos);
+    }
+
+    std::filesystem::remove(path);
+}
+
+CPU_TEST(NpzWriter_Compressed)
+{
+    std::vector<float> data(64 * 1024, 0.5f);
+
+    auto stored = NpzWriter::encodeArray("data", "<f4", {data.size()}, data.data(), data.size() * sizeof(float), false);
+    auto compressed = NpzWriter::encodeArray("data", "<f4", {data.size()}, data.data(), data.size() * sizeof(float), true);
+    EXPECT(!stored.compressed);
+    EXPECT(compressed.compressed);
+    EXPECT_EQ(compressed.crc32, stored.crc32);
+    EXPECT_EQ(compressed.uncompressedSize, stored.uncompressedSize);
+    EXPECT_LT(compressed.data.size(), stored.data.size() / 10);
+
+    auto path = getTempFilePath();
+    {
+        NpzWriter writer(path);
+        writer.append(compressed);
+    }
+
+    auto entries = readZip(ctx, path);
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(entries[0].method, 8);
+    EXPECT_EQ(entries[0].crc32, stored.crc32);
+    EXPECT_EQ(entries[0].uncompressedSize, stored.uncompressedSize);
+    EXPECT(entries[0].data == compressed.data);
+
+    std::filesystem::remove(path);
+}
+
+CPU_TEST(NpzWriter_SizeMismatch)
+{
+    std::vector<float> data(5);
+    bool caught = false;
+    try
+    {
+        NpzWriter::encodeArray("data", "<f4", {6}, data.data(), data.size() * sizeof(float), false);
+    }
+    catch (const ArgumentError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+}
+
+CPU_TEST(ShardedNpzWriter_Shards)
+{
+    auto directory = getTempFilePath();
+    std::vector<uint8_t> data(1000, 1);
+
+    {
+        // Each sample consists of two arrays with about 1 KB each, so each shard holds two samples.
+        ShardedNpzWriter writer(directory, "test", 5000);
+        for (uint64_t i = 0; i < 5; i++)
+        {
+            std::vector<NpzWriter::EncodedArray> arrays;
+            arrays.push_back(NpzWriter::encodeArray("x_" + std::to_string(i), "|u1", {data.size()}, data.data(), data.size(), false));
+            arrays.push_back(NpzWriter::encodeArray("y_" + std::to_string(i), "|u1", {data.size()}, data.data(), data.size(), false));
+            writer.append(i, arrays);
+        }
+        EXPECT_EQ(writer.getShardCount(), 3);
+    }
+
+    for (uint64_t first : {0, 2, 4})
+    {
+        auto path = directory / ("test_" + std::to_string(first) + ".npz");
+        ASSERT(std::filesystem::exists(path));
+        auto entries = readZip(ctx, path);
+        EXPECT_EQ(entries.size(), first == 4 ? 2 : 4);
+        EXPECT_EQ(entries[0].fileName, "x_" + std::to_string(first) + ".npy");
+        EXPECT_LE(std::filesystem::file_size(path), 5000);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+CPU_TEST(ShardedNpzWriter_ShardSizeIncludesIndex)
+{
+    auto directory = getTempFilePath();
+    std::vector<uint8_t> data(1000, 1);
+
+    std::vector<std::vector<NpzWriter::EncodedArray>> samples;
+    uint64_t storedSize = 0;
+    for (uint64_t i = 0; i < 4; i++)
+    {
+        std::vector<NpzWriter::EncodedArray> arrays;
+        arrays.push_back(NpzWriter::encodeArray("x_" + std::to_string(i), "|u1", {data.size()}, data.data(), data.size(), false));
+        if (i < 2)
+            storedSize += NpzWriter::getStoredSize(arrays.back());
+        samples.push_back(std::move(arrays));
+    }
+
+    {
+        // Two samples fit into the limit without the index, but not with it.
+        ShardedNpzWriter writer(directory, "test", storedSize);
+        for (uint64_t i = 0; i < samples.size(); i++)
+            writer.append(i, samples[i]);
+        EXPECT_EQ(writer.getShardCount(), 4);
+    }
+
+    for (uint64_t i = 0; i < samples.size(); i++)
+    {
+        auto path = directory / ("test_" + std::to_string(i) + ".npz");
+        ASSERT(std::filesystem::exists(path));
+        EXPECT_EQ(readZip(ctx, path).size(), 1);
+        EXPECT_LE(std::filesystem::file_size(path), storedSize);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+CPU_TEST(ShardedNpzWriter_NoOverwrite)
+{
+    auto directory = getTempFilePath();
+    std::vector<uint8_t> data(100, 1);
+    auto array = NpzWriter::encodeArray("x_0", "|u1", {data.size()}, data.data(), data.size(), false);
+
+    // A second export starting at the same sample index must not overwrite the shards of the first one.
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        ShardedNpzWriter writer(directory, "test");
+        writer.append(0, {array});
+    }
+
+    for (auto name : {"test_0.npz", "test_0_1.npz", "test_0_2.npz"})
+    {
+        auto path = directory / name;
+        ASSERT(std::filesystem::exists(path)) << name;
+        EXPECT_EQ(readZip(ctx, path).size(), 1) << name;
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+#if FALCOR_LINUX
+CPU_TEST(NpzWriter_WriteError)
+{
+    std::vector<uint8_t> data(100, 1);
+    auto array = NpzWriter::encodeArray("x", "|u1", {data.size()}, data.data(), data.size(), false);
+
+    // Writes to /dev/full fail once the stream is flushed, which happens when the archive is closed.
+    bool caught = false;
+    try
+    {
+        NpzWriter writer("/dev/full");
+        writer.append(array);
+        writer.close();
+    }
+    catch (const RuntimeError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+
+    // The destructor logs the error instead of throwing.
+    {
+        NpzWriter writer("/dev/full");
+        writer.append(array);
+    }
+}
+#endif
+} // namespace Falcor
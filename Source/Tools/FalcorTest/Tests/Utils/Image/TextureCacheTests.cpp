@@ -0,0 +1,166 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/Platform/OS.h"
+#include "Utils/Image/TextureCache.h"
+
+#include <fstream>
+
+namespace Falcor
+{
+namespace
+{
+void writeFile(const std::filesystem::path& path, const std::string& contents)
+{
+    std::ofstream fs(path, std::ios_base::binary);
+    fs << contents;
+}
+
+Bitmap::UniqueConstPtr createGradient(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> data(width * height * 4);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = uint8_t(i * 7);
+    return Bitmap::create(width, height, ResourceFormat::RGBA8Unorm, data.data());
+}
+} // namespace
+
+CPU_TEST(TextureCache_Key)
+{
+    auto directory = getTempFilePath();
+    std::filesystem::create_directories(directory);
+    auto pathA = directory / "a.png";
+    auto pathB = directory / "b.png";
+    writeFile(pathA, "image data");
+    writeFile(pathB, "image data");
+
+    // Keys only depend on file contents and options.
+    MipGenerator::Options options;
+    auto key = TextureCache::computeKey(pathA, true, options);
+    EXPECT(key == TextureCache::computeKey(pathB, true, options));
+    EXPECT(key != TextureCache::computeKey(pathA, false, options));
+    options.srgb = true;
+    EXPECT(key != TextureCache::computeKey(pathA, true, options));
+    options.srgb = false;
+    options.filter = MipGenerator::Filter::Kaiser;
+    EXPECT(key != TextureCache::computeKey(pathA, true, options));
+
+    writeFile(pathB, "other data");
+    EXPECT(key != TextureCache::computeKey(pathB, true, {}));
+
+    std::filesystem::remove_all(directory);
+}
+
+CPU_TEST(TextureCache_ReadWrite)
+{
+    TextureCache cache(getTempFilePath());
+    TextureCache::Key key{};
+    key[0] = 1;
+
+    EXPECT(cache.read(key).empty());
+
+    auto pBase = createGradient(8, 4);
+    auto mips = MipGenerator::generateMips(*pBase, {});
+    std::vector<const Bitmap*> levels = {pBase.get()};
+    for (const auto& pMip : mips)
+        levels.push_back(pMip.get());
+    cache.write(key, levels);
+
+    auto cached = cache.read(key);
+    ASSERT_EQ(cached.size(), levels.size());
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        EXPECT_EQ(cached[i]->getWidth(), levels[i]->getWidth());
+        EXPECT_EQ(cached[i]->getHeight(), levels[i]->getHeight());
+        EXPECT(cached[i]->getFormat() == levels[i]->getFormat());
+        ASSERT_EQ(cached[i]->getSize(), levels[i]->getSize());
+        EXPECT(std::memcmp(cached[i]->getData(), levels[i]->getData(), levels[i]->getSize()) == 0) << "mip=" << i;
+    }
+
+    // Inconsistent mip chains are rejected.
+    bool caught = false;
+    try
+    {
+        cache.write(key, {pBase.get(), pBase.get()});
+    }
+    catch (const ArgumentError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+
+    // Truncated entries are ignored.
+    auto entryPath = cache.getDirectory() / SHA1::toString(key);
+    std::filesystem::resize_file(entryPath, std::filesystem::file_size(entryPath) - 1);
+    EXPECT(cache.read(key).empty());
+
+    cache.clear();
+    EXPECT(!std::filesystem::exists(cache.getDirectory()));
+}
+
+CPU_TEST(TextureCache_Eviction)
+{
+    auto pBase = createGradient(8, 4);
+    auto createKey = [](uint8_t i)
+    {
+        TextureCache::Key key{};
+        key[0] = i;
+        return key;
+    };
+
+    // Measure the size of a single entry.
+    uint64_t entrySize = 0;
+    {
+        TextureCache cache(getTempFilePath());
+        cache.write(createKey(0), {pBase.get()});
+        entrySize = cache.getSize();
+        cache.clear();
+    }
+    ASSERT_GT(entrySize, 0u);
+
+    // The cache holds two entries, but not three.
+    TextureCache cache(getTempFilePath(), entrySize * 5 / 2);
+    cache.write(createKey(1), {pBase.get()});
+    cache.write(createKey(2), {pBase.get()});
+    EXPECT_EQ(cache.getSize(), 2 * entrySize);
+
+    // Make entry 1 older than entry 2, then use it so that entry 2 is the least recently used one.
+    auto now = std::filesystem::file_time_type::clock::now();
+    std::filesystem::last_write_time(cache.getDirectory() / SHA1::toString(createKey(1)), now - std::chrono::hours(2));
+    std::filesystem::last_write_time(cache.getDirectory() / SHA1::toString(createKey(2)), now - std::chrono::hours(1));
+    EXPECT(!cache.read(createKey(1)).empty());
+
+    cache.write(createKey(3), {pBase.get()});
+    EXPECT_LE(cache.getSize(), cache.getMaxSize());
+    EXPECT(!cache.read(createKey(1)).empty());
+    EXPECT(cache.read(createKey(2)).empty());
+    EXPECT(!cache.read(createKey(3)).empty());
+
+    cache.clear();
+}
+} // namespace Falcor
@@ -51,4 +51,51 @@ GPU_TEST(TextureManager_LoadMips)
     EXPECT_EQ(tex->getMipCount(), 3);
     EXPECT_EQ(tex->getArraySize(), 1);
 }
+
+GPU_TEST(TextureManager_DeferredLoading)
+{
+    ref<Device> pDevice = ctx.getDevice();
+
+    TextureManager textureManager(pDevice, 10);
+
+    textureManager.beginDeferredLoading();
+    auto hMipped = textureManager.loadTexture(
+        getRuntimeDirectory() / "data/tests/tiny_<MIP>.png", false, false, ResourceBindFlags::ShaderResource, false
+    );
+    auto hSingle =
+        textureManager.loadTexture(getRuntimeDirectory() / "data/tests/tiny_mip0.png", true, true, ResourceBindFlags::ShaderResource, false);
+    auto hDDS = textureManager.loadTexture(
+        getRuntimeDirectory() / "data/tests/BC7UnormTiny.dds", false, false, ResourceBindFlags::ShaderResource, false
+    );
+    EXPECT(hMipped.isValid());
+    EXPECT(hSingle.isValid());
+    EXPECT(hDDS.isValid());
+
+    // Nothing is loaded until deferred loading ends.
+    EXPECT(textureManager.getTexture(hMipped) == nullptr);
+    textureManager.endDeferredLoading();
+
+    auto pMipped = textureManager.getTexture(hMipped);
+    ASSERT(pMipped != nullptr);
+    EXPECT_EQ(pMipped->getWidth(), 4);
+    EXPECT_EQ(pMipped->getHeight(), 4);
+    EXPECT_EQ(pMipped->getMipCount(), 3);
+
+    auto pSingle = textureManager.getTexture(hSingle);
+    ASSERT(pSingle != nullptr);
+    EXPECT_EQ(pSingle->getWidth(), 4);
+    EXPECT_EQ(pSingle->getMipCount(), 3);
+    EXPECT(isSrgbFormat(pSingle->getFormat()));
+
+    auto pDDS = textureManager.getTexture(hDDS);
+    ASSERT(pDDS != nullptr);
+    EXPECT(isCompressedFormat(pDDS->getFormat()));
+
+    auto stats = textureManager.getStats();
+    EXPECT_EQ(stats.textureCount, 3);
+    EXPECT_EQ(stats.deferredTextureCount, 3);
+    EXPECT_EQ(stats.deferredDecodedCount, 3);
+    EXPECT_EQ(stats.deferredUploadedCount, 3);
+    EXPECT_GT(stats.deferredDecodedBytes, 0);
+}
 } // namespace Falcor
@@ -275,6 +275,21 @@ CPU_TEST(Matrix_inverse)
     }
 }
 
+CPU_TEST(Matrix_inverseAffine)
+{
+    float4x4 m = mul(
+        math::matrixFromTranslation(float3(1.f, -2.f, 3.f)),
+        mul(math::matrixFromRotationXYZ(0.3f, -1.2f, 2.1f), math::matrixFromScaling(float3(2.f, 0.5f, 3.f)))
+    );
+    EXPECT_TRUE(isAffine(m));
+    EXPECT_FALSE(isAffine(math::perspective(1.f, 1.5f, 0.1f, 100.f)));
+
+    float4x4 a = inverseAffine(m);
+    float4x4 b = inverse(m);
+    for (int r = 0; r < 4; ++r)
+        EXPECT_ALMOST_EQ(a[r], b[r]);
+}
+
 CPU_TEST(Matrix_extractEulerAngleXYZ)
 {
     {
@@ -0,0 +1,346 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Neural/CpuInference.h"
+#include "Utils/Math/Float16.h"
+#include "Utils/Timing/CpuTimer.h"
+#include "Utils/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+const CpuSimd kAllSimd[] = {CpuSimd::Scalar, CpuSimd::SSE2, CpuSimd::AVX2, CpuSimd::NEON};
+
+std::vector<float> randomValues(size_t count, std::mt19937& rng, float scale = 1.f)
+{
+    std::uniform_real_distribution<float> u(-scale, scale);
+    std::vector<float> values(count);
+    for (auto& v : values)
+        v = u(rng);
+    return values;
+}
+
+CpuConvNet::Layer randomConvLayer(
+    std::mt19937& rng,
+    uint32_t kernelSize,
+    uint32_t channelsIn,
+    uint32_t channelsOut,
+    CpuConvNet::Activation activation
+)
+{
+    CpuConvNet::Layer layer;
+    layer.kernelWidth = kernelSize;
+    layer.kernelHeight = kernelSize;
+    layer.channelsIn = channelsIn;
+    layer.channelsOut = channelsOut;
+    layer.weights = randomValues(size_t(kernelSize) * kernelSize * channelsIn * channelsOut, rng, 0.5f);
+    layer.bias = randomValues(channelsOut, rng, 0.1f);
+    layer.activation = activation;
+    return layer;
+}
+
+CpuTensor randomTensor(uint32_t width, uint32_t height, uint32_t channels, std::mt19937& rng, float minValue, float maxValue)
+{
+    std::uniform_real_distribution<float> u(minValue, maxValue);
+    CpuTensor tensor(width, height, channels);
+    for (auto& v : tensor.data)
+        v = u(rng);
+    return tensor;
+}
+
+/// Straightforward evaluation of a single convolution layer with zero padding, as done by the generated shaders.
+CpuTensor referenceConv(const CpuTensor& input, const CpuConvNet::Layer& layer, const CpuTensor* pClampMin, const CpuTensor* pClampMax)
+{
+    CpuTensor output(input.width, input.height, layer.channelsOut);
+    for (uint32_t chOut = 0; chOut < layer.channelsOut; ++chOut)
+    {
+        for (uint32_t y = 0; y < input.height; ++y)
+        {
+            for (uint32_t x = 0; x < input.width; ++x)
+            {
+                float sum = layer.bias.empty() ? 0.f : layer.bias[chOut];
+                for (uint32_t chIn = 0; chIn < layer.channelsIn; ++chIn)
+                {
+                    for (uint32_t ky = 0; ky < layer.kernelHeight; ++ky)
+                    {
+                        for (uint32_t kx = 0; kx < layer.kernelWidth; ++kx)
+                        {
+                            int sx = int(x + kx) - int(layer.kernelWidth / 2);
+                            int sy = int(y + ky) - int(layer.kernelHeight / 2);
+                            if (sx < 0 || sy < 0 || sx >= int(input.width) || sy >= int(input.height))
+                                continue;
+                            size_t w = ((size_t(kx) * layer.kernelHeight + ky) * layer.channelsIn + chIn) * layer.channelsOut + chOut;
+                            sum += input.at(sx, sy, chIn) * layer.weights[w];
+                        }
+                    }
+                }
+                if (layer.activation == CpuConvNet::Activation::ReLU)
+                    sum = std::max(sum, 0.f);
+                else if (layer.activation == CpuConvNet::Activation::Clamp)
+                    sum = std::min(std::max(sum, pClampMin->at(x, y, 0)), pClampMax->at(x, y, 0));
+                output.at(x, y, chOut) = sum;
+            }
+        }
+    }
+    return output;
+}
+
+template<typename Func>
+bool throwsArgumentError(Func&& func)
+{
+    try
+    {
+        func();
+    }
+    catch (const ArgumentError&)
+    {
+        return true;
+    }
+    return false;
+}
+
+float maxAbsDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    float maxDiff = 0.f;
+    for (size_t i = 0; i < a.size(); ++i)
+        maxDiff = std::max(maxDiff, std::abs(a[i] - b[i]));
+    return maxDiff;
+}
+} // namespace
+
+CPU_TEST(CpuConvNet_Reference)
+{
+    std::mt19937 rng(1234);
+    // Odd dimensions exercise the scalar tail of the vectorized rows and the zero padding.
+    const uint32_t width = 37;
+    const uint32_t height = 23;
+
+    std::vector<CpuConvNet::Layer> layers = {
+        randomConvLayer(rng, 3, 4, 6, CpuConvNet::Activation::ReLU),
+        randomConvLayer(rng, 5, 6, 5, CpuConvNet::Activation::ReLU),
+        randomConvLayer(rng, 3, 5, 1, CpuConvNet::Activation::Clamp),
+    };
+    CpuConvNet net;
+    for (const auto& layer : layers)
+        net.addLayer(layer);
+    EXPECT_EQ(net.getLayerCount(), 3u);
+    EXPECT_EQ(net.getInputChannelCount(), 4u);
+    EXPECT_EQ(net.getOutputChannelCount(), 1u);
+
+    CpuTensor input = randomTensor(width, height, 4, rng, 0.f, 1.f);
+    CpuTensor clampMin = randomTensor(width, height, 1, rng, -0.5f, 0.f);
+    CpuTensor clampMax = randomTensor(width, height, 1, rng, 0.f, 0.5f);
+
+    CpuTensor expected = input;
+    for (const auto& layer : layers)
+        expected = referenceConv(expected, layer, &clampMin, &clampMax);
+
+    for (CpuSimd simd : kAllSimd)
+    {
+        if (!isCpuSimdSupported(simd))
+            continue;
+        CpuTensor output;
+        net.run(input, output, &clampMin, &clampMax, simd);
+        EXPECT_EQ(output.width, width);
+        EXPECT_EQ(output.height, height);
+        EXPECT_EQ(output.channels, 1u);
+        EXPECT_LE(maxAbsDifference(output.data, expected.data), 1e-4f) << enumToString(simd);
+    }
+}
+
+CPU_TEST(CpuConvNet_Precision)
+{
+    // Two 1x1 identity layers, the output of the first one is stored with the intermediate precision.
+    CpuConvNet::Layer identity;
+    identity.channelsIn = 1;
+    identity.channelsOut = 1;
+    identity.weights = {1.f};
+    identity.activation = CpuConvNet::Activation::None;
+
+    CpuConvNet net;
+    net.addLayer(identity);
+    net.addLayer(identity);
+
+    CpuTensor input(3, 1, 1);
+    input.data = {0.3f, -0.2f, 1.7f};
+
+    CpuTensor output;
+    net.run(input, output);
+    EXPECT_EQ(output.data, input.data);
+
+    net.setIntermediatePrecision(CpuConvNet::Precision::UNorm);
+    net.run(input, output);
+    EXPECT_EQ(output.data[0], std::round(0.3f * 255.f) / 255.f);
+    EXPECT_EQ(output.data[1], 0.f);
+    EXPECT_EQ(output.data[2], 1.f);
+
+    net.setIntermediatePrecision(CpuConvNet::Precision::Half);
+    net.run(input, output);
+    for (size_t i = 0; i < input.data.size(); ++i)
+        EXPECT_EQ(output.data[i], math::float16ToFloat32(math::float32ToFloat16(input.data[i])));
+}
+
+CPU_TEST(CpuDenseNet_Reference)
+{
+    std::mt19937 rng(4321);
+    const uint32_t sizes[] = {9, 32, 13, 4};
+    const size_t sampleCount = 1000;
+
+    std::vector<CpuDenseNet::Layer> layers;
+    CpuDenseNet net;
+    for (size_t l = 0; l + 1 < std::size(sizes); ++l)
+    {
+        CpuDenseNet::Layer layer;
+        layer.inputs = sizes[l];
+        layer.outputs = sizes[l + 1];
+        layer.weights = randomValues(size_t(layer.inputs) * layer.outputs, rng, 0.5f);
+        layer.bias = randomValues(layer.outputs, rng, 0.1f);
+        layer.activation = l + 2 < std::size(sizes) ? CpuDenseNet::Activation::ReLU : CpuDenseNet::Activation::None;
+        net.addLayer(layer);
+        layers.push_back(layer);
+    }
+    EXPECT_EQ(net.getInputCount(), 9u);
+    EXPECT_EQ(net.getOutputCount(), 4u);
+
+    std::vector<float> inputs = randomValues(sampleCount * net.getInputCount(), rng);
+    std::vector<float> expected;
+    for (size_t s = 0; s < sampleCount; ++s)
+    {
+        std::vector<float> values(inputs.begin() + s * net.getInputCount(), inputs.begin() + (s + 1) * net.getInputCount());
+        for (const auto& layer : layers)
+        {
+            std::vector<float> next(layer.bias);
+            for (uint32_t o = 0; o < layer.outputs; ++o)
+            {
+                for (uint32_t i = 0; i < layer.inputs; ++i)
+                    next[o] += values[i] * layer.weights[i * layer.outputs + o];
+                if (layer.activation == CpuDenseNet::Activation::ReLU)
+                    next[o] = std::max(next[o], 0.f);
+            }
+            values = std::move(next);
+        }
+        expected.insert(expected.end(), values.begin(), values.end());
+    }
+
+    for (CpuSimd simd : kAllSimd)
+    {
+        if (!isCpuSimdSupported(simd))
+            continue;
+        std::vector<float> outputs(sampleCount * net.getOutputCount());
+        net.evaluate(sampleCount, inputs.data(), outputs.data(), simd);
+        EXPECT_LE(maxAbsDifference(outputs, expected), 1e-4f) << enumToString(simd);
+    }
+}
+
+CPU_TEST(CpuInference_Errors)
+{
+    std::mt19937 rng(1);
+    CpuConvNet convNet;
+    convNet.addLayer(randomConvLayer(rng, 3, 4, 8, CpuConvNet::Activation::ReLU));
+    EXPECT(throwsArgumentError([&]() { convNet.addLayer(randomConvLayer(rng, 3, 6, 1, CpuConvNet::Activation::None)); }));
+    auto badLayer = randomConvLayer(rng, 3, 8, 1, CpuConvNet::Activation::None);
+    badLayer.weights.pop_back();
+    EXPECT(throwsArgumentError([&]() { convNet.addLayer(badLayer); }));
+
+    convNet.addLayer(randomConvLayer(rng, 1, 8, 1, CpuConvNet::Activation::Clamp));
+    CpuTensor input(8, 8, 4);
+    CpuTensor output;
+    EXPECT(throwsArgumentError([&]() { convNet.run(input, output); })); // Missing clamp bounds.
+    CpuTensor wrongInput(8, 8, 3);
+    CpuTensor bounds(8, 8, 1);
+    EXPECT(throwsArgumentError([&]() { convNet.run(wrongInput, output, &bounds, &bounds); }));
+    convNet.run(input, output, &bounds, &bounds);
+    EXPECT_EQ(output.channels, 1u);
+
+    CpuDenseNet denseNet;
+    CpuDenseNet::Layer dense;
+    dense.inputs = 4;
+    dense.outputs = 2;
+    dense.weights.resize(7);
+    EXPECT(throwsArgumentError([&]() { denseNet.addLayer(dense); }));
+}
+
+CPU_TEST(CpuInference_Benchmark, TAGS("benchmark"))
+{
+    std::mt19937 rng(42);
+
+    // Layer stack in the shape of the ConvolutionalNet pass, on a single quarter resolution 1080p slice.
+    const uint32_t width = 480;
+    const uint32_t height = 270;
+    CpuConvNet convNet;
+    convNet.addLayer(randomConvLayer(rng, 3, 4, 8, CpuConvNet::Activation::ReLU));
+    convNet.addLayer(randomConvLayer(rng, 3, 8, 8, CpuConvNet::Activation::ReLU));
+    convNet.addLayer(randomConvLayer(rng, 3, 8, 1, CpuConvNet::Activation::None));
+    CpuTensor input = randomTensor(width, height, 4, rng, 0.f, 1.f);
+
+    // Dense network in the shape of the SVAO classifier.
+    const size_t sampleCount = 1 << 20;
+    CpuDenseNet denseNet;
+    for (auto [inputs, outputs] : {std::pair(32u, 32u), std::pair(32u, 32u), std::pair(32u, 8u)})
+    {
+        CpuDenseNet::Layer layer;
+        layer.inputs = inputs;
+        layer.outputs = outputs;
+        layer.weights = randomValues(size_t(inputs) * outputs, rng);
+        denseNet.addLayer(layer);
+    }
+    std::vector<float> denseInputs = randomValues(sampleCount * denseNet.getInputCount(), rng);
+    std::vector<float> denseOutputs(sampleCount * denseNet.getOutputCount());
+
+    for (CpuSimd simd : kAllSimd)
+    {
+        if (!isCpuSimdSupported(simd))
+            continue;
+
+        CpuTensor output;
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        convNet.run(input, output, nullptr, nullptr, simd);
+        double convDuration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        startTime = CpuTimer::getCurrentTimePoint();
+        denseNet.evaluate(sampleCount, denseInputs.data(), denseOutputs.data(), simd);
+        double denseDuration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        logInfo(
+            "CpuInference ({}): {}x{} convolution net took {:.2f} ms, {} dense net samples took {:.2f} ms",
+            enumToString(simd),
+            width,
+            height,
+            convDuration,
+            sampleCount,
+            denseDuration
+        );
+    }
+}
+} // namespace Falcor
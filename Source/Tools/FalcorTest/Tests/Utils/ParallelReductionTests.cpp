@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "Testing/UnitTest.h"
 #include "Utils/Algorithm/ParallelReduction.h"
+#include "Utils/Timing/CpuTimer.h"
 #include <random>
 
 namespace Falcor
@@ -312,4 +313,141 @@ GPU_TEST(ParallelReduction)
     testReduction(ctx, reduction, ResourceFormat::R16Int, 64, 33);
     testReduction(ctx, reduction, ResourceFormat::RG8Int, 403, 57);
 }
+
+GPU_TEST(ParallelReductionCPU)
+{
+    // Same tests with the input read back and reduced on the CPU.
+    ParallelReduction reduction(ctx.getDevice(), ParallelReduction::Backend::CPU);
+
+    // Test floating-point formats.
+    testReduction(ctx, reduction, ResourceFormat::RGBA32Float, 1, 1);
+    testReduction(ctx, reduction, ResourceFormat::RGBA32Float, 32, 64);
+    testReduction(ctx, reduction, ResourceFormat::RGBA32Float, 127, 71);
+    testReduction(ctx, reduction, ResourceFormat::RGBA8Unorm, 256, 192);
+    testReduction(ctx, reduction, ResourceFormat::RGBA8Snorm, 91, 130);
+    testReduction(ctx, reduction, ResourceFormat::RG16Float, 220, 121);
+    testReduction(ctx, reduction, ResourceFormat::RG16Unorm, 256, 192);
+    testReduction(ctx, reduction, ResourceFormat::RG16Snorm, 333, 101);
+
+    // Test integer formats.
+    testReduction(ctx, reduction, ResourceFormat::RGBA32Uint, 33, 99);
+    testReduction(ctx, reduction, ResourceFormat::R32Uint, 22, 291);
+    testReduction(ctx, reduction, ResourceFormat::R16Int, 64, 33);
+    testReduction(ctx, reduction, ResourceFormat::RG8Int, 403, 57);
+
+    // Switching the backend at runtime creates the GPU programs on first use.
+    reduction.setBackend(ParallelReduction::Backend::GPU);
+    testReduction(ctx, reduction, ResourceFormat::RGBA32Float, 127, 71);
+}
+
+CPU_TEST(ParallelReduction_ExecuteCPU)
+{
+    // Sum and min/max over multiple blocks of pixels.
+    const uint32_t pixelCount = 300000;
+    std::vector<int16_t> data(pixelCount * 2);
+    int4 refSum(0), refMin(std::numeric_limits<int32_t>::max()), refMax(std::numeric_limits<int32_t>::lowest());
+    std::mt19937 rng;
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = int16_t(int32_t(rng() % 2001) - 1000);
+        refSum[i % 2] += data[i];
+        refMin[i % 2] = std::min(refMin[i % 2], (int32_t)data[i]);
+        refMax[i % 2] = std::max(refMax[i % 2], (int32_t)data[i]);
+    }
+    refMin[2] = refMin[3] = refMax[2] = refMax[3] = 0;
+
+    int4 sum;
+    ParallelReduction::executeCPU(data.data(), pixelCount, ResourceFormat::RG16Int, ParallelReduction::Type::Sum, &sum);
+    int4 minMax[2];
+    ParallelReduction::executeCPU(data.data(), pixelCount, ResourceFormat::RG16Int, ParallelReduction::Type::MinMax, minMax);
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(sum[i], refSum[i]) << "i = " << i;
+        EXPECT_EQ(minMax[0][i], refMin[i]) << "i = " << i;
+        EXPECT_EQ(minMax[1][i], refMax[i]) << "i = " << i;
+    }
+
+    // Unorm values are normalized and sums are accurate beyond float precision.
+    std::vector<uint8_t> unormData(pixelCount, 255);
+    float4 unormSum;
+    ParallelReduction::executeCPU(unormData.data(), pixelCount, ResourceFormat::R8Unorm, ParallelReduction::Type::Sum, &unormSum);
+    EXPECT_EQ(unormSum.x, (float)pixelCount);
+    EXPECT_EQ(unormSum.y, 0.f);
+
+    // Incompatible result types and unsupported formats throw.
+    bool caught = false;
+    try
+    {
+        ParallelReduction::executeCPU(data.data(), pixelCount, ResourceFormat::RG16Int, ParallelReduction::Type::Sum, &unormSum);
+    }
+    catch (const RuntimeError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+
+    caught = false;
+    try
+    {
+        ParallelReduction::executeCPU(data.data(), 1, ResourceFormat::BGRA8Unorm, ParallelReduction::Type::Sum, &unormSum);
+    }
+    catch (const RuntimeError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+}
+
+GPU_TEST(ParallelReduction_Benchmark, TAGS("benchmark"))
+{
+    ref<Device> pDevice = ctx.getDevice();
+    ParallelReduction gpuReduction(pDevice, ParallelReduction::Backend::GPU);
+    ParallelReduction cpuReduction(pDevice, ParallelReduction::Backend::CPU);
+
+    std::mt19937 rng;
+    auto dist = std::uniform_real_distribution<float>();
+    const uint32_t kIterations = 10;
+
+    for (uint32_t size : {256u, 1024u, 2048u, 4096u})
+    {
+        std::vector<float4> data(size_t(size) * size);
+        for (auto& v : data)
+            v = float4(dist(rng), dist(rng), dist(rng), dist(rng));
+        ref<Texture> pTexture = Texture::create2D(pDevice, size, size, ResourceFormat::RGBA32Float, 1, 1, data.data());
+
+        // Results are read back to the CPU, so all timings include the synchronization with the GPU.
+        auto measure = [&](auto&& func)
+        {
+            func();
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < kIterations; i++)
+                func();
+            return CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) / kIterations;
+        };
+
+        float4 result[2];
+        double gpuTime =
+            measure([&]() { gpuReduction.execute(ctx.getRenderContext(), pTexture, ParallelReduction::Type::Sum, result); });
+        double cpuTime =
+            measure([&]() { cpuReduction.execute(ctx.getRenderContext(), pTexture, ParallelReduction::Type::Sum, result); });
+        double memoryTime = measure(
+            [&]()
+            { ParallelReduction::executeCPU(data.data(), data.size(), ResourceFormat::RGBA32Float, ParallelReduction::Type::Sum, result); }
+        );
+
+        const double gigabytes = data.size() * sizeof(float4) / 1e9;
+        logInfo(
+            "ParallelReduction {}x{} RGBA32Float sum: GPU {:.3f} ms ({:.1f} GB/s), CPU backend {:.3f} ms ({:.1f} GB/s), "
+            "CPU in memory {:.3f} ms ({:.1f} GB/s)",
+            size,
+            size,
+            gpuTime,
+            gigabytes / (gpuTime * 1e-3),
+            cpuTime,
+            gigabytes / (cpuTime * 1e-3),
+            memoryTime,
+            gigabytes / (memoryTime * 1e-3)
+        );
+    }
+}
 } // namespace Falcor
@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "Testing/UnitTest.h"
 #include "Utils/Algorithm/PrefixSum.h"
+#include "Utils/Timing/CpuTimer.h"
 #include <random>
 
 namespace Falcor
@@ -46,11 +47,8 @@ uint32_t prefixSumRef(std::vector<uint32_t>& elems)
     return sum;
 }
 
-void testPrefixSum(GPUUnitTestContext& ctx, PrefixSum& prefixSum, uint32_t numElems)
+std::vector<uint32_t> createTestData(uint32_t numElems)
 {
-    ref<Device> pDevice = ctx.getDevice();
-
-    // Create a buffer of random data to use as test data.
     // We make sure the total sum fits in 32 bits.
     FALCOR_ASSERT(numElems > 0);
     const uint32_t maxVal = std::numeric_limits<uint32_t>::max() / numElems;
@@ -58,6 +56,15 @@ void testPrefixSum(GPUUnitTestContext& ctx, PrefixSum& prefixSum, uint32_t numEl
     std::mt19937 r;
     for (auto& it : testData)
         it = r() % maxVal;
+    return testData;
+}
+
+void testPrefixSum(GPUUnitTestContext& ctx, PrefixSum& prefixSum, uint32_t numElems)
+{
+    ref<Device> pDevice = ctx.getDevice();
+
+    // Create a buffer of random data to use as test data.
+    std::vector<uint32_t> testData = createTestData(numElems);
 
     ref<Buffer> pTestDataBuffer = Buffer::create(
         pDevice, numElems * sizeof(uint32_t), Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, testData.data()
@@ -113,4 +120,85 @@ GPU_TEST(PrefixSum)
     testPrefixSum(ctx, prefixSum, 1088921);
     testPrefixSum(ctx, prefixSum, 13912615);
 }
+
+GPU_TEST(PrefixSumCPU)
+{
+    // Same tests with the data read back and scanned on the CPU.
+    PrefixSum prefixSum(ctx.getDevice(), PrefixSum::Backend::CPU);
+
+    testPrefixSum(ctx, prefixSum, 1);
+    testPrefixSum(ctx, prefixSum, 27);
+    testPrefixSum(ctx, prefixSum, 2049);
+    testPrefixSum(ctx, prefixSum, 231917);
+    testPrefixSum(ctx, prefixSum, 13912615);
+
+    // Switching the backend at runtime creates the GPU programs on first use.
+    prefixSum.setBackend(PrefixSum::Backend::GPU);
+    testPrefixSum(ctx, prefixSum, 10201);
+}
+
+CPU_TEST(PrefixSum_ExecuteCPU)
+{
+    // Sizes below, at and above the block size of the parallel scan.
+    for (uint32_t numElems : {1u, 27u, 65535u, 65536u, 65537u, 1088921u})
+    {
+        std::vector<uint32_t> data = createTestData(numElems);
+        std::vector<uint32_t> refData = data;
+        const uint32_t refSum = prefixSumRef(refData);
+
+        const uint32_t sum = PrefixSum::executeCPU(data.data(), data.size());
+        EXPECT_EQ(sum, refSum) << "numElems = " << numElems;
+        for (uint32_t i = 0; i < numElems; i++)
+        {
+            EXPECT_EQ(data[i], refData[i]) << "numElems = " << numElems << ", i = " << i;
+        }
+    }
+
+    // An empty range is a no-op.
+    EXPECT_EQ(PrefixSum::executeCPU(nullptr, 0), 0u);
+}
+
+GPU_TEST(PrefixSum_Benchmark, TAGS("benchmark"))
+{
+    ref<Device> pDevice = ctx.getDevice();
+    PrefixSum gpuPrefixSum(pDevice, PrefixSum::Backend::GPU);
+    PrefixSum cpuPrefixSum(pDevice, PrefixSum::Backend::CPU);
+    const uint32_t kIterations = 10;
+
+    for (uint32_t numElems : {1u << 16, 1u << 20, 1u << 24})
+    {
+        std::vector<uint32_t> testData = createTestData(numElems);
+        ref<Buffer> pBuffer = Buffer::create(
+            pDevice, numElems * sizeof(uint32_t), Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, testData.data()
+        );
+
+        // The total sum is read back to the CPU, so all timings include the synchronization with the GPU.
+        auto measure = [&](auto&& func)
+        {
+            func();
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < kIterations; i++)
+                func();
+            return CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) / kIterations;
+        };
+
+        uint32_t sum = 0;
+        double gpuTime = measure([&]() { gpuPrefixSum.execute(ctx.getRenderContext(), pBuffer, numElems, &sum); });
+        double cpuTime = measure([&]() { cpuPrefixSum.execute(ctx.getRenderContext(), pBuffer, numElems, &sum); });
+        double memoryTime = measure([&]() { PrefixSum::executeCPU(testData.data(), testData.size()); });
+
+        const double gigabytes = numElems * sizeof(uint32_t) / 1e9;
+        logInfo(
+            "PrefixSum {} elements: GPU {:.3f} ms ({:.1f} GB/s), CPU backend {:.3f} ms ({:.1f} GB/s), "
+            "CPU in memory {:.3f} ms ({:.1f} GB/s)",
+            numElems,
+            gpuTime,
+            gigabytes / (gpuTime * 1e-3),
+            cpuTime,
+            gigabytes / (cpuTime * 1e-3),
+            memoryTime,
+            gigabytes / (memoryTime * 1e-3)
+        );
+    }
+}
 } // namespace Falcor
@@ -0,0 +1,123 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/ScratchArena.h"
+#include <thread>
+
+namespace Falcor
+{
+CPU_TEST(ScratchArena)
+{
+    ScratchArena arena(1024);
+    EXPECT_EQ(0, arena.getCapacity());
+    EXPECT_EQ(0, arena.getUsedSize());
+
+    // Allocations are aligned and taken from the same block.
+    char* c = arena.allocateArray<char>(3);
+    double* d = arena.allocateArray<double>(2);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(d) % alignof(double));
+    EXPECT(reinterpret_cast<char*>(d) >= c + 3);
+    void* p = arena.allocate(10, 64);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) % 64);
+    EXPECT_EQ(1, arena.getBlockCount());
+
+    const size_t usedSize = arena.getUsedSize();
+    {
+        // Allocations in a scope are released at the end of the scope.
+        ScratchArena::Scope scope(arena);
+        arena.allocateArray<uint32_t>(100);
+        EXPECT_GT(arena.getUsedSize(), usedSize);
+
+        // Allocations larger than the block size get their own block.
+        arena.allocateArray<uint32_t>(1000);
+        EXPECT_EQ(2, arena.getBlockCount());
+    }
+    EXPECT_EQ(2, arena.getBlockCount());
+    EXPECT_EQ(usedSize, arena.getUsedSize());
+
+    // Rewinding to the start merges the blocks, so the same allocations then fit into a single block.
+    const size_t capacity = arena.getCapacity();
+    arena.reset();
+    EXPECT_EQ(0, arena.getUsedSize());
+    EXPECT_EQ(1, arena.getBlockCount());
+    EXPECT_EQ(capacity, arena.getCapacity());
+    arena.allocateArray<uint32_t>(100);
+    arena.allocateArray<uint32_t>(1000);
+    EXPECT_EQ(1, arena.getBlockCount());
+    EXPECT_EQ(capacity, arena.getCapacity());
+}
+
+CPU_TEST(ScratchArenaMaxRetainedSize)
+{
+    ScratchArena arena(1024, 4096);
+    {
+        // A large workload allocates beyond the maximum retained size.
+        ScratchArena::Scope scope(arena);
+        for (int i = 0; i < 8; ++i)
+            arena.allocateArray<char>(1000);
+        arena.allocateArray<char>(10000);
+        EXPECT_GT(arena.getCapacity(), 4096);
+    }
+
+    // Rewinding to the start releases the memory beyond the limit.
+    EXPECT_EQ(1, arena.getBlockCount());
+    EXPECT_EQ(4096, arena.getCapacity());
+
+    // Workloads within the limit keep their memory.
+    {
+        ScratchArena::Scope scope(arena);
+        arena.allocateArray<char>(3000);
+    }
+    EXPECT_EQ(1, arena.getBlockCount());
+    EXPECT_EQ(4096, arena.getCapacity());
+}
+
+CPU_TEST(ScratchArenaContainers)
+{
+    ScratchArena arena(256);
+    {
+        ScratchArena::Scope scope(arena);
+        std::pmr::vector<uint32_t> values(&arena);
+        for (uint32_t i = 0; i < 1000; ++i)
+            values.push_back(i);
+        for (uint32_t i = 0; i < 1000; ++i)
+            EXPECT_EQ(i, values[i]);
+    }
+    EXPECT_EQ(0, arena.getUsedSize());
+}
+
+CPU_TEST(ScratchArenaThreadLocal)
+{
+    ScratchArena* pMainArena = &ScratchArena::getThreadLocal();
+    ScratchArena* pThreadArena = nullptr;
+    std::thread thread([&]() { pThreadArena = &ScratchArena::getThreadLocal(); });
+    thread.join();
+    EXPECT(pMainArena == &ScratchArena::getThreadLocal());
+    EXPECT(pThreadArena != pMainArena);
+}
+} // namespace Falcor
@@ -0,0 +1,168 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Threading.h"
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace Falcor
+{
+CPU_TEST(Threading_dispatchTask)
+{
+    std::atomic<uint32_t> counter{0};
+    std::vector<Threading::Task> tasks;
+    for (uint32_t i = 0; i < 1000; ++i)
+        tasks.push_back(Threading::dispatchTask([&]() { counter++; }));
+    for (const auto& task : tasks)
+        task.finish();
+
+    EXPECT_EQ(counter.load(), 1000u);
+    for (const auto& task : tasks)
+        EXPECT(!task.isRunning());
+
+    Threading::Task empty;
+    EXPECT(!empty.isValid());
+    EXPECT(!empty.isRunning());
+    empty.finish();
+}
+
+CPU_TEST(Threading_then)
+{
+    std::vector<uint32_t> order;
+    auto task = Threading::dispatchTask([&]() { order.push_back(0); })
+                    .then([&]() { order.push_back(1); })
+                    .then([&]() { order.push_back(2); });
+    task.finish();
+
+    ASSERT_EQ(order.size(), 3u);
+    for (uint32_t i = 0; i < 3; ++i)
+        EXPECT_EQ(order[i], i);
+
+    // Chaining on a finished task dispatches immediately.
+    bool executed = false;
+    task.then([&]() { executed = true; }).finish();
+    EXPECT(executed);
+}
+
+CPU_TEST(Threading_nestedTasks)
+{
+    // Recursive task spawning where every task waits on its children.
+    std::function<uint64_t(uint32_t)> fib = [&](uint32_t n) -> uint64_t
+    {
+        if (n < 2)
+            return n;
+        uint64_t a = 0;
+        auto task = Threading::dispatchTask([&]() { a = fib(n - 1); });
+        uint64_t b = fib(n - 2);
+        task.finish();
+        return a + b;
+    };
+    EXPECT_EQ(fib(20), 6765u);
+}
+
+CPU_TEST(Threading_parallelFor)
+{
+    const size_t count = 1000000;
+    std::vector<uint32_t> values(count, 0);
+    Threading::parallelFor(0, count, [&](size_t i) { values[i] += uint32_t(i % 7) + 1; });
+
+    uint64_t sum = std::accumulate(values.begin(), values.end(), uint64_t(0));
+    uint64_t expected = 0;
+    for (size_t i = 0; i < count; ++i)
+        expected += i % 7 + 1;
+    EXPECT_EQ(sum, expected);
+
+    // Chunks must cover the range exactly once.
+    std::atomic<size_t> covered{0};
+    Threading::parallelForChunked(
+        10, 10010, [&](size_t begin, size_t end) { covered += end - begin; }, 7
+    );
+    EXPECT_EQ(covered.load(), 10000u);
+
+    // Empty range.
+    Threading::parallelFor(5, 5, [&](size_t) { covered = 0; });
+    EXPECT_EQ(covered.load(), 10000u);
+}
+
+CPU_TEST(Threading_exceptions)
+{
+    bool caught = false;
+    try
+    {
+        Threading::parallelFor(0, 1000, [](size_t i) { if (i == 500) throw std::runtime_error("fail"); }, 1);
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+
+    caught = false;
+    auto task = Threading::dispatchTask([]() { throw std::runtime_error("fail"); });
+    try
+    {
+        task.finish();
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+}
+
+CPU_TEST(Threading_finishFromTask)
+{
+    bool caught = false;
+    auto task = Threading::dispatchTask([]() { Threading::finish(); });
+    try
+    {
+        task.finish();
+    }
+    catch (const RuntimeError&)
+    {
+        caught = true;
+    }
+    EXPECT(caught);
+
+    // Waiting for other tasks from within a task is fine.
+    std::atomic<uint32_t> counter{0};
+    task = Threading::dispatchTask(
+        [&]()
+        {
+            auto inner = Threading::dispatchTask([&]() { counter++; });
+            inner.finish();
+            counter++;
+        }
+    );
+    task.finish();
+    EXPECT_EQ(counter.load(), 2u);
+}
+} // namespace Falcor
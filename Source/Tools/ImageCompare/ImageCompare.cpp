@@ -27,15 +27,23 @@
  **************************************************************************/
 #include <FreeImage.h>
 #include <args.hxx>
+#include <nlohmann/json.hpp>
 
 #include <iostream>
+#include <fstream>
 #include <memory>
 #include <string>
 #include <vector>
 #include <stdexcept>
 #include <map>
+#include <set>
 #include <functional>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <limits>
 
 #include <cmath>
 #include <cstring>
@@ -58,17 +66,106 @@ T clamp(T x, T lo, T hi)
     return std::max(lo, std::min(hi, x));
 }
 
+/**
+ * Runs func(i) for i in [0, count) on up to threadCount threads (including the calling thread).
+ */
+static void parallelFor(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t)>& func)
+{
+    threadCount = std::min(threadCount, count);
+    if (threadCount <= 1)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    std::atomic<uint32_t> next{0};
+    auto worker = [&]()
+    {
+        for (uint32_t i = next++; i < count; i = next++)
+            func(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+/**
+ * Image backed by a FreeImage bitmap.
+ * Rows are converted to RGBA32F on demand so that large images are never duplicated in memory as a whole.
+ */
 class Image
 {
 public:
-    Image(uint32_t width, uint32_t height) : mWidth(width), mHeight(height), mData(std::make_unique<float[]>(width * height * 4)) {}
+    Image(FIBITMAP* bitmap, bool displayEncoded)
+        : mpBitmap(bitmap, FreeImage_Unload)
+        , mWidth(FreeImage_GetWidth(bitmap))
+        , mHeight(FreeImage_GetHeight(bitmap))
+        , mType(FreeImage_GetImageType(bitmap))
+        , mBitsPerPixel(FreeImage_GetBPP(bitmap))
+        , mDisplayEncoded(displayEncoded)
+    {}
 
     uint32_t getWidth() const { return mWidth; }
     uint32_t getHeight() const { return mHeight; }
-    const float* getData() const { return mData.get(); }
-    float* getData() { return mData.get(); }
 
-    static std::shared_ptr<Image> create(uint32_t width, uint32_t height) { return std::make_shared<Image>(width, height); }
+    /// True if the pixel values are display encoded (8/16-bit integer formats) rather than linear (floating point formats).
+    bool isDisplayEncoded() const { return mDisplayEncoded; }
+
+    /// Returns a pointer to row y (top-down) of an RGBA32F image.
+    float* getRow(uint32_t y)
+    {
+        if (mType != FIT_RGBAF)
+            throw std::runtime_error("Image is not in RGBA float format");
+        return reinterpret_cast<float*>(FreeImage_GetScanLine(mpBitmap.get(), mHeight - y - 1));
+    }
+
+    /// Converts row y (top-down) to RGBA32F. Pixels without alpha are written with an alpha of one.
+    void readRow(uint32_t y, float* dst) const
+    {
+        const BYTE* src = FreeImage_GetScanLine(mpBitmap.get(), mHeight - y - 1);
+        if (mType == FIT_RGBAF)
+        {
+            std::memcpy(dst, src, mWidth * 4 * sizeof(float));
+        }
+        else if (mType == FIT_RGBF)
+        {
+            const float* srcF = reinterpret_cast<const float*>(src);
+            for (uint32_t x = 0; x < mWidth; ++x)
+            {
+                dst[4 * x + 0] = srcF[3 * x + 0];
+                dst[4 * x + 1] = srcF[3 * x + 1];
+                dst[4 * x + 2] = srcF[3 * x + 2];
+                dst[4 * x + 3] = 1.f;
+            }
+        }
+        else
+        {
+            // 24/32-bit bitmap (other formats are converted at load time).
+            const uint32_t stride = mBitsPerPixel / 8;
+            const float scale = 1.f / 255.f;
+            for (uint32_t x = 0; x < mWidth; ++x)
+            {
+                const BYTE* p = src + stride * x;
+                dst[4 * x + 0] = p[FI_RGBA_RED] * scale;
+                dst[4 * x + 1] = p[FI_RGBA_GREEN] * scale;
+                dst[4 * x + 2] = p[FI_RGBA_BLUE] * scale;
+                dst[4 * x + 3] = stride == 4 ? p[FI_RGBA_ALPHA] * scale : 1.f;
+            }
+        }
+    }
+
+    static std::shared_ptr<Image> create(uint32_t width, uint32_t height)
+    {
+        FIBITMAP* bitmap = FreeImage_AllocateT(FIT_RGBAF, width, height);
+        if (!bitmap)
+            throw std::runtime_error("Cannot allocate image");
+        return std::make_shared<Image>(bitmap, false);
+    }
 
     static std::shared_ptr<Image> loadFromFile(const std::filesystem::path& path)
     {
@@ -90,22 +187,19 @@ public:
         if (!srcBitmap)
             throw std::runtime_error("Cannot read image");
 
-        // Convert to RGBA32F.
+        // Keep formats that rows can be read from directly, convert everything else to RGBA32F.
+        FREE_IMAGE_TYPE type = FreeImage_GetImageType(srcBitmap);
+        uint32_t bpp = FreeImage_GetBPP(srcBitmap);
+        bool displayEncoded = type != FIT_FLOAT && type != FIT_RGBF && type != FIT_RGBAF;
+        if (type == FIT_RGBAF || type == FIT_RGBF || (type == FIT_BITMAP && (bpp == 24 || bpp == 32)))
+            return std::make_shared<Image>(srcBitmap, displayEncoded);
+
         FIBITMAP* floatBitmap = FreeImage_ConvertToRGBAF(srcBitmap);
         FreeImage_Unload(srcBitmap);
         if (!floatBitmap)
             throw std::runtime_error("Cannot convert to RGBA float format");
 
-        // Create image.
-        auto image = create(FreeImage_GetWidth(floatBitmap), FreeImage_GetHeight(floatBitmap));
-        int bytesPerPixel = 4 * sizeof(float);
-        FreeImage_ConvertToRawBits(
-            reinterpret_cast<BYTE*>(image->getData()), floatBitmap, bytesPerPixel * image->getWidth(), bytesPerPixel * 8, FI_RGBA_RED_MASK,
-            FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, true
-        );
-        FreeImage_Unload(floatBitmap);
-
-        return image;
+        return std::make_shared<Image>(floatBitmap, displayEncoded);
     }
 
     void saveToFile(const std::filesystem::path& path, bool writeAlpha = true) const
@@ -127,17 +221,18 @@ public:
 
         // Create bitmap.
         FIBITMAP* bitmap;
-        const float* src = getData();
+        std::vector<float> row(mWidth * 4);
         if (writeFloat)
         {
             bitmap = FreeImage_AllocateT(writeAlpha ? FIT_RGBAF : FIT_RGBF, mWidth, mHeight);
             for (uint32_t y = 0; y < mHeight; y++)
             {
+                readRow(y, row.data());
+                const float* src = row.data();
                 float* dst = reinterpret_cast<float*>(FreeImage_GetScanLine(bitmap, mHeight - y - 1));
                 if (writeAlpha)
                 {
                     std::memcpy(dst, src, mWidth * 4 * sizeof(float));
-                    src += mWidth * 4;
                 }
                 else
                 {
@@ -157,14 +252,16 @@ public:
             bitmap = FreeImage_Allocate(mWidth, mHeight, writeAlpha ? 32 : 24);
             for (uint32_t y = 0; y < mHeight; y++)
             {
+                readRow(y, row.data());
+                const float* src = row.data();
                 uint8_t* dst = reinterpret_cast<uint8_t*>(FreeImage_GetScanLine(bitmap, mHeight - y - 1));
                 for (uint32_t x = 0; x < mWidth; ++x)
                 {
-                    dst[2] = clamp(int(src[0] * 255.f), 0, 255);
-                    dst[1] = clamp(int(src[1] * 255.f), 0, 255);
-                    dst[0] = clamp(int(src[2] * 255.f), 0, 255);
+                    dst[FI_RGBA_RED] = clamp(int(src[0] * 255.f), 0, 255);
+                    dst[FI_RGBA_GREEN] = clamp(int(src[1] * 255.f), 0, 255);
+                    dst[FI_RGBA_BLUE] = clamp(int(src[2] * 255.f), 0, 255);
                     if (writeAlpha)
-                        dst[3] = clamp(int(src[3] * 255.f), 0, 255);
+                        dst[FI_RGBA_ALPHA] = clamp(int(src[3] * 255.f), 0, 255);
                     dst += writeAlpha ? 4 : 3;
                     src += 4;
                 }
@@ -177,80 +274,599 @@ public:
     }
 
 private:
+    std::unique_ptr<FIBITMAP, decltype(&FreeImage_Unload)> mpBitmap;
     uint32_t mWidth;
     uint32_t mHeight;
-    std::unique_ptr<float[]> mData;
+    FREE_IMAGE_TYPE mType;
+    uint32_t mBitsPerPixel;
+    bool mDisplayEncoded;
 };
 
-struct MSE
+struct CompareOptions
+{
+    bool alpha = false;             ///< Include alpha channel (per-channel metrics only).
+    float pixelsPerDegree = 67.f;   ///< Observer pixels per degree of visual angle (FLIP only).
+    uint32_t threadCount = 1;       ///< Number of threads used for comparing a single image pair.
+};
+
+/**
+ * Separable 1D filter kernel with taps in [-radius, radius].
+ */
+struct Kernel
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    std::vector<float> taps;
+    int radius = 0;
+
+    /// Creates a kernel from a weight function, trimming negligible outer taps.
+    static Kernel create(int radius, const std::function<float(int)>& weight)
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i)
-            error += sqr(a[i] - b[i]);
-        return error / count;
+        Kernel kernel;
+        float maxWeight = 0.f;
+        for (int i = -radius; i <= radius; ++i)
+            maxWeight = std::max(maxWeight, std::fabs(weight(i)));
+        while (radius > 0 && std::fabs(weight(radius)) < 1e-4f * maxWeight && std::fabs(weight(-radius)) < 1e-4f * maxWeight)
+            --radius;
+        kernel.radius = radius;
+        for (int i = -radius; i <= radius; ++i)
+            kernel.taps.push_back(weight(i));
+        return kernel;
+    }
+
+    /// Scales the taps to sum to one.
+    Kernel& normalize()
+    {
+        float sum = 0.f;
+        for (float tap : taps)
+            sum += tap;
+        for (float& tap : taps)
+            tap /= sum;
+        return *this;
     }
 };
 
-struct RMSE
+/**
+ * Block of rows processed by one task. The source rows extend beyond the output rows by the filter radius
+ * so that filters can be evaluated without touching rows of other bands.
+ * Filters clamp to the image edges and operate on planes of either source rows or output rows.
+ */
+struct Band
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    uint32_t width;
+    uint32_t height;       ///< Image height.
+    uint32_t srcY0;        ///< First source row (inclusive).
+    uint32_t srcY1;        ///< Last source row (exclusive).
+    uint32_t y0;           ///< First output row (inclusive).
+    uint32_t y1;           ///< Last output row (exclusive).
+
+    uint32_t getSrcRowCount() const { return srcY1 - srcY0; }
+    uint32_t getRowCount() const { return y1 - y0; }
+    size_t getSrcPixelCount() const { return size_t(getSrcRowCount()) * width; }
+    size_t getPixelCount() const { return size_t(getRowCount()) * width; }
+
+    /**
+     * Filters the source rows horizontally (src and dst hold source rows).
+     */
+    void filterRows(const float* src, const Kernel& kernel, float* dst, std::vector<float>& padded) const
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i)
-            error += sqr(a[i] - b[i]) / (sqr(a[i]) + 1e-3);
-        return error / count;
+        // Rows are padded by replicating the edge pixels so that the per-tap loops vectorize without bounds checks.
+        const uint32_t r = uint32_t(kernel.radius);
+        padded.resize(width + 2 * r);
+        for (uint32_t y = 0; y < getSrcRowCount(); ++y)
+        {
+            const float* srcRow = src + size_t(y) * width;
+            float* dstRow = dst + size_t(y) * width;
+            std::fill_n(padded.begin(), r, srcRow[0]);
+            std::copy_n(srcRow, width, padded.begin() + r);
+            std::fill_n(padded.begin() + r + width, r, srcRow[width - 1]);
+
+            const float* p = padded.data();
+            const float w0 = kernel.taps[0];
+            for (uint32_t x = 0; x < width; ++x)
+                dstRow[x] = w0 * p[x];
+            for (uint32_t k = 1; k <= 2 * r; ++k)
+            {
+                const float weight = kernel.taps[k];
+                const float* pk = p + k;
+                for (uint32_t x = 0; x < width; ++x)
+                    dstRow[x] += weight * pk[x];
+            }
+        }
+    }
+
+    /**
+     * Filters vertically and accumulates the result scaled by the given factor (src holds source rows, dst output rows).
+     */
+    void filterColumns(const float* src, const Kernel& kernel, float scale, float* dst) const
+    {
+        const int r = kernel.radius;
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            float* dstRow = dst + size_t(y - y0) * width;
+            for (int k = -r; k <= r; ++k)
+            {
+                const uint32_t srcY = uint32_t(clamp(int(y) + k, 0, int(height) - 1));
+                const float* srcRow = src + size_t(srcY - srcY0) * width;
+                const float weight = scale * kernel.taps[k + r];
+                for (uint32_t x = 0; x < width; ++x)
+                    dstRow[x] += weight * srcRow[x];
+            }
+        }
     }
+
+    /**
+     * Applies a separable filter and accumulates the result scaled by the given factor (src holds source rows, dst output rows).
+     */
+    void filter(const float* src, const Kernel& kernelX, const Kernel& kernelY, float scale, float* dst, std::vector<float>& tmp) const
+    {
+        const size_t srcCount = getSrcPixelCount();
+        tmp.resize(srcCount);
+        std::vector<float> padded;
+        filterRows(src, kernelX, tmp.data(), padded);
+        filterColumns(tmp.data(), kernelY, scale, dst);
+    }
+};
+
+/**
+ * Sums a row of values.
+ * Partial sums are kept in independent lanes so the loop vectorizes without relaxing floating-point semantics.
+ */
+static double sumValues(const float* values, size_t count)
+{
+    constexpr size_t kLanes = 8;
+    float lanes[kLanes] = {};
+    size_t i = 0;
+    for (; i + kLanes <= count; i += kLanes)
+        for (size_t j = 0; j < kLanes; ++j)
+            lanes[j] += values[i + j];
+    double sum = 0.0;
+    for (float lane : lanes)
+        sum += lane;
+    for (; i < count; ++i)
+        sum += values[i];
+    return sum;
+}
+
+/**
+ * Evaluates a per-pixel error over the image in parallel bands.
+ * The band function receives the RGBA32F source rows of both images and writes the error of the output rows.
+ * Returns the mean error. If errorMap is not null, it receives the per-pixel error.
+ */
+template<typename BandFunc>
+double compareBands(
+    const Image& imageA,
+    const Image& imageB,
+    uint32_t radius,
+    const CompareOptions& options,
+    float* errorMap,
+    BandFunc func
+)
+{
+    constexpr uint32_t kBandHeight = 64;
+
+    const uint32_t width = imageA.getWidth();
+    const uint32_t height = imageA.getHeight();
+    const uint32_t bandCount = (height + kBandHeight - 1) / kBandHeight;
+
+    // Per-band sums are reduced in order to keep the result independent of the thread count.
+    std::vector<double> bandSums(bandCount, 0.0);
+
+    parallelFor(
+        bandCount, options.threadCount,
+        [&](uint32_t bandIndex)
+        {
+            Band band;
+            band.width = width;
+            band.height = height;
+            band.y0 = bandIndex * kBandHeight;
+            band.y1 = std::min(height, band.y0 + kBandHeight);
+            band.srcY0 = band.y0 - std::min(band.y0, radius);
+            band.srcY1 = std::min(height, band.y1 + radius);
+
+            std::vector<float> a(band.getSrcPixelCount() * 4);
+            std::vector<float> b(band.getSrcPixelCount() * 4);
+            for (uint32_t y = band.srcY0; y < band.srcY1; ++y)
+            {
+                imageA.readRow(y, a.data() + size_t(y - band.srcY0) * width * 4);
+                imageB.readRow(y, b.data() + size_t(y - band.srcY0) * width * 4);
+            }
+
+            std::vector<float> localError;
+            float* error = errorMap ? errorMap + size_t(band.y0) * width : nullptr;
+            if (!error)
+            {
+                localError.resize(band.getPixelCount());
+                error = localError.data();
+            }
+
+            func(band, a.data(), b.data(), error);
+            bandSums[bandIndex] = sumValues(error, band.getPixelCount());
+        }
+    );
+
+    double sum = 0.0;
+    for (double bandSum : bandSums)
+        sum += bandSum;
+    return sum / (double(width) * height);
+}
+
+struct MSE
+{
+    static constexpr float kScale = 1.f;
+    static float eval(float a, float b) { return sqr(a - b); }
+};
+
+struct RMSE
+{
+    static constexpr float kScale = 1.f;
+    static float eval(float a, float b) { return sqr(a - b) / (sqr(a) + 1e-3f); }
 };
 
 struct MAE
 {
-    double operator()(const float* a, const float* b, size_t count) const
-    {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i)
-            error += std::fabs(sqr(a[i] - b[i]));
-        return error / count;
-    }
+    static constexpr float kScale = 1.f;
+    static float eval(float a, float b) { return std::fabs(a - b); }
 };
 
 struct MAPE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static constexpr float kScale = 100.f;
+    static float eval(float a, float b) { return std::fabs((a - b) / (a + 1e-3f)); }
+};
+
+/**
+ * Per-channel metric averaged over the channels of a pixel.
+ */
+template<typename Metric, uint32_t kChannels>
+void evalRow(const float* a, const float* b, uint32_t width, float* error)
+{
+    const float scale = Metric::kScale / kChannels;
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        float e = 0.f;
+        for (uint32_t c = 0; c < kChannels; ++c)
+            e += Metric::eval(a[4 * x + c], b[4 * x + c]);
+        error[x] = e * scale;
+    }
+}
+
+template<typename Metric>
+double compare(const Image& imageA, const Image& imageB, const CompareOptions& options, float* errorMap)
+{
+    auto evalBand = [&](const Band& band, const float* a, const float* b, float* error)
+    {
+        const size_t count = band.getPixelCount();
+        if (options.alpha)
+            evalRow<Metric, 4>(a, b, uint32_t(count), error);
+        else
+            evalRow<Metric, 3>(a, b, uint32_t(count), error);
+    };
+    // Rows are contiguous, so a band is evaluated as a single row.
+    return compareBands(imageA, imageB, 0, options, errorMap, evalBand);
+}
+
+/**
+ * Relative luminance of a linear RGB color.
+ */
+static float luminance(const float* rgb)
+{
+    return 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+}
+
+/**
+ * Structural similarity (SSIM) of the luminance with an 11x11 Gaussian window (sigma = 1.5).
+ * The per-pixel error is 1 - SSIM.
+ */
+static double compareSSIM(const Image& imageA, const Image& imageB, const CompareOptions& options, float* errorMap)
+{
+    const float kC1 = sqr(0.01f);
+    const float kC2 = sqr(0.03f);
+    const Kernel kernel = Kernel::create(5, [](int i) { return std::exp(-float(i * i) / (2.f * 1.5f * 1.5f)); }).normalize();
+
+    auto evalBand = [&](const Band& band, const float* a, const float* b, float* error)
+    {
+        // Planes holding the moments of the luminance: a, b, a^2, b^2, ab.
+        const size_t srcCount = band.getSrcPixelCount();
+        std::vector<float> moments(srcCount * 5);
+        float* lumA = moments.data();
+        float* lumB = lumA + srcCount;
+        float* lumA2 = lumB + srcCount;
+        float* lumB2 = lumA2 + srcCount;
+        float* lumAB = lumB2 + srcCount;
+        for (size_t i = 0; i < srcCount; ++i)
+        {
+            lumA[i] = luminance(a + 4 * i);
+            lumB[i] = luminance(b + 4 * i);
+            lumA2[i] = lumA[i] * lumA[i];
+            lumB2[i] = lumB[i] * lumB[i];
+            lumAB[i] = lumA[i] * lumB[i];
+        }
+
+        const size_t count = band.getPixelCount();
+        std::vector<float> filtered(count * 5, 0.f);
+        std::vector<float> tmp;
+        for (size_t i = 0; i < 5; ++i)
+            band.filter(moments.data() + i * srcCount, kernel, kernel, 1.f, filtered.data() + i * count, tmp);
+
+        const float* muA = filtered.data();
+        const float* muB = muA + count;
+        const float* muA2 = muB + count;
+        const float* muB2 = muA2 + count;
+        const float* muAB = muB2 + count;
+        for (size_t i = 0; i < count; ++i)
+        {
+            float varA = muA2[i] - muA[i] * muA[i];
+            float varB = muB2[i] - muB[i] * muB[i];
+            float covAB = muAB[i] - muA[i] * muB[i];
+            float ssim = ((2.f * muA[i] * muB[i] + kC1) * (2.f * covAB + kC2)) /
+                         ((muA[i] * muA[i] + muB[i] * muB[i] + kC1) * (varA + varB + kC2));
+            error[i] = 1.f - ssim;
+        }
+    };
+    return compareBands(imageA, imageB, uint32_t(kernel.radius), options, errorMap, evalBand);
+}
+
+/**
+ * FLIP-style perceptual difference, following the LDR variant of
+ * "FLIP: A Difference Evaluator for Alternating Images" (Andersson et al. 2020).
+ * Images are compared in linear RGB clamped to [0, 1]; display encoded images are decoded from sRGB first.
+ * The per-pixel error is in [0, 1].
+ */
+class FLIP
+{
+public:
+    FLIP(float pixelsPerDegree)
+    {
+        // Contrast sensitivity filters of the achromatic, red-green and blue-yellow channels.
+        const float kMaxScale = 0.04f;
+        const int csfRadius = int(std::ceil(3.f * std::sqrt(kMaxScale / (2.f * kPi * kPi)) * pixelsPerDegree));
+        mCsf[0] = createCsf(csfRadius, pixelsPerDegree, 1.f, 0.0047f, 0.f, 1e-5f);
+        mCsf[1] = createCsf(csfRadius, pixelsPerDegree, 1.f, 0.0053f, 0.f, 1e-5f);
+        mCsf[2] = createCsf(csfRadius, pixelsPerDegree, 34.1f, 0.04f, 13.5f, 0.025f);
+
+        // Edge and point detectors (first and second derivative of Gaussian).
+        const float sd = 0.5f * 0.082f * pixelsPerDegree;
+        const int featureRadius = int(std::ceil(3.f * sd));
+        auto gaussian = [sd](int i) { return std::exp(-float(i * i) / (2.f * sd * sd)); };
+        mGaussian = Kernel::create(featureRadius, gaussian).normalize();
+        mEdge = createFeatureKernel(featureRadius, [&](int i) { return -float(i) * gaussian(i); });
+        mPoint = createFeatureKernel(featureRadius, [&](int i) { return (float(i * i) / (sd * sd) - 1.f) * gaussian(i); });
+
+        mRadius = uint32_t(std::max({mCsf[0].kernels[0].radius, mCsf[1].kernels[0].radius, mCsf[2].kernels[0].radius,
+                                     mCsf[2].kernels[1].radius, mGaussian.radius, mEdge.radius, mPoint.radius}));
+
+        // Maximum color difference (between green and blue).
+        const float green[3] = {0.f, 1.f, 0.f};
+        const float blue[3] = {0.f, 0.f, 1.f};
+        float labGreen[3], labBlue[3];
+        linearRGBToHuntLab(green, labGreen);
+        linearRGBToHuntLab(blue, labBlue);
+        mMaxColorError = std::pow(hyab(labGreen, labBlue), kQc);
+    }
+
+    double compare(const Image& imageA, const Image& imageB, const CompareOptions& options, float* errorMap) const
+    {
+        auto evalBand = [&](const Band& band, const float* a, const float* b, float* error)
+        {
+            const size_t count = band.getPixelCount();
+            std::vector<float> featuresA(count * 2), featuresB(count * 2);
+            std::vector<float> labA(count * 3), labB(count * 3);
+            preprocess(band, a, imageA.isDisplayEncoded(), labA.data(), featuresA.data());
+            preprocess(band, b, imageB.isDisplayEncoded(), labB.data(), featuresB.data());
+
+            const float kPc = 0.4f;
+            const float kPt = 0.95f;
+            const float kQf = 0.5f;
+            const float pcMax = kPc * mMaxColorError;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float labPixelA[3] = {labA[i], labA[count + i], labA[2 * count + i]};
+                const float labPixelB[3] = {labB[i], labB[count + i], labB[2 * count + i]};
+                float colorError = std::pow(hyab(labPixelA, labPixelB), kQc);
+                colorError = colorError < pcMax ? (kPt / pcMax) * colorError
+                                                : kPt + ((colorError - pcMax) / (mMaxColorError - pcMax)) * (1.f - kPt);
+
+                float featureError = std::max(std::fabs(featuresA[i] - featuresB[i]), std::fabs(featuresA[count + i] - featuresB[count + i]));
+                featureError = std::pow(featureError / std::sqrt(2.f), kQf);
+
+                error[i] = std::pow(colorError, 1.f - featureError);
+            }
+        };
+        return compareBands(imageA, imageB, mRadius, options, errorMap, evalBand);
+    }
+
+private:
+    static constexpr float kPi = 3.14159265358979f;
+    static constexpr float kQc = 0.7f;
+
+    struct Csf
+    {
+        Kernel kernels[2];
+        float weights[2] = {};
+    };
+
+    static Csf createCsf(int radius, float pixelsPerDegree, float a1, float b1, float a2, float b2)
+    {
+        // The 2D filter is a weighted sum of two Gaussians, filtered separably and normalized to one.
+        Csf csf;
+        const float dx = 1.f / pixelsPerDegree;
+        const float a[2] = {a1, a2};
+        const float b[2] = {b1, b2};
+        float total = 0.f;
+        for (int i = 0; i < 2; ++i)
+        {
+            const float bi = b[i];
+            csf.kernels[i] = Kernel::create(radius, [&](int x) { return std::exp(-kPi * kPi * sqr(x * dx) / bi); });
+            float sum = 0.f;
+            for (float tap : csf.kernels[i].taps)
+                sum += tap;
+            csf.kernels[i].normalize();
+            csf.weights[i] = a[i] * std::sqrt(kPi / b[i]) * sum * sum;
+            total += csf.weights[i];
+        }
+        for (float& weight : csf.weights)
+            weight /= total;
+        return csf;
+    }
+
+    static Kernel createFeatureKernel(int radius, const std::function<float(int)>& weight)
+    {
+        // Positive weights sum to one and negative weights sum to minus one.
+        Kernel kernel = Kernel::create(radius, weight);
+        float positive = 0.f, negative = 0.f;
+        for (float tap : kernel.taps)
+            (tap > 0.f ? positive : negative) += tap;
+        for (float& tap : kernel.taps)
+            tap = tap > 0.f ? tap / positive : tap / -negative;
+        return kernel;
+    }
+
+    // Linear sRGB <-> XYZ (D65).
+    static constexpr float kRGBToXYZ[3][3] = {
+        {10135552.f / 24577794.f, 8788810.f / 24577794.f, 4435075.f / 24577794.f},
+        {2613072.f / 12288897.f, 8788810.f / 12288897.f, 887015.f / 12288897.f},
+        {1425312.f / 73733382.f, 8788810.f / 73733382.f, 70074185.f / 73733382.f},
+    };
+    static constexpr float kXYZToRGB[3][3] = {
+        {3.241003275f, -1.537398934f, -0.498615861f},
+        {-0.969224334f, 1.875930071f, 0.041554224f},
+        {0.055639423f, -0.204011202f, 1.057148933f},
+    };
+    static constexpr float kWhite[3] = {
+        kRGBToXYZ[0][0] + kRGBToXYZ[0][1] + kRGBToXYZ[0][2],
+        kRGBToXYZ[1][0] + kRGBToXYZ[1][1] + kRGBToXYZ[1][2],
+        kRGBToXYZ[2][0] + kRGBToXYZ[2][1] + kRGBToXYZ[2][2],
+    };
+
+    static void transform(const float m[3][3], const float* src, float* dst)
+    {
+        for (int i = 0; i < 3; ++i)
+            dst[i] = m[i][0] * src[0] + m[i][1] * src[1] + m[i][2] * src[2];
+    }
+
+    static float srgbToLinear(float c)
+    {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    static void linearRGBToHuntLab(const float* rgb, float* lab)
+    {
+        float xyz[3];
+        transform(kRGBToXYZ, rgb, xyz);
+        auto f = [](float t)
+        {
+            const float delta = 6.f / 29.f;
+            return t > delta * delta * delta ? std::cbrt(t) : t / (3.f * delta * delta) + 4.f / 29.f;
+        };
+        const float fx = f(xyz[0] / kWhite[0]);
+        const float fy = f(xyz[1] / kWhite[1]);
+        const float fz = f(xyz[2] / kWhite[2]);
+        const float l = 116.f * fy - 16.f;
+        // Hunt adjustment scales the chromatic channels by the lightness.
+        lab[0] = l;
+        lab[1] = 0.01f * l * 500.f * (fx - fy);
+        lab[2] = 0.01f * l * 200.f * (fy - fz);
+    }
+
+    static float hyab(const float* labA, const float* labB)
+    {
+        return std::fabs(labA[0] - labB[0]) + std::sqrt(sqr(labA[1] - labB[1]) + sqr(labA[2] - labB[2]));
+    }
+
+    /**
+     * Computes the Hunt-adjusted L*a*b* color of the spatially filtered image (planar, 3 x pixel count)
+     * and the edge and point feature magnitudes (planar, 2 x pixel count) for the output rows of a band.
+     */
+    void preprocess(const Band& band, const float* rgba, bool displayEncoded, float* lab, float* features) const
     {
-        double error = 0.0;
+        const size_t srcCount = band.getSrcPixelCount();
+        const size_t count = band.getPixelCount();
+
+        // Convert to YCxCz (planar).
+        std::vector<float> ycxcz(srcCount * 3);
+        for (size_t i = 0; i < srcCount; ++i)
+        {
+            float rgb[3], xyz[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                float value = displayEncoded ? srgbToLinear(rgba[4 * i + c]) : rgba[4 * i + c];
+                rgb[c] = clamp(value, 0.f, 1.f);
+            }
+            transform(kRGBToXYZ, rgb, xyz);
+            ycxcz[i] = 116.f * xyz[1] / kWhite[1] - 16.f;
+            ycxcz[srcCount + i] = 500.f * (xyz[0] / kWhite[0] - xyz[1] / kWhite[1]);
+            ycxcz[2 * srcCount + i] = 200.f * (xyz[1] / kWhite[1] - xyz[2] / kWhite[2]);
+        }
+
+        // Color pipeline: spatial filtering, clamping to the RGB gamut and transformation to L*a*b*.
+        std::vector<float> filtered(count * 3, 0.f);
+        std::vector<float> tmp;
+        for (size_t c = 0; c < 3; ++c)
+        {
+            for (size_t i = 0; i < 2; ++i)
+            {
+                if (mCsf[c].weights[i] > 0.f)
+                {
+                    const Kernel& kernel = mCsf[c].kernels[i];
+                    band.filter(ycxcz.data() + c * srcCount, kernel, kernel, mCsf[c].weights[i], filtered.data() + c * count, tmp);
+                }
+            }
+        }
         for (size_t i = 0; i < count; ++i)
-            error += std::fabs((a[i] - b[i]) / (a[i] + 1e-3));
-        return 100.0 * error / count;
+        {
+            const float y = (filtered[i] + 16.f) / 116.f;
+            const float xyz[3] = {
+                (filtered[count + i] / 500.f + y) * kWhite[0],
+                y * kWhite[1],
+                (y - filtered[2 * count + i] / 200.f) * kWhite[2],
+            };
+            float rgb[3], pixelLab[3];
+            transform(kXYZToRGB, xyz, rgb);
+            for (float& value : rgb)
+                value = clamp(value, 0.f, 1.f);
+            linearRGBToHuntLab(rgb, pixelLab);
+            lab[i] = pixelLab[0];
+            lab[count + i] = pixelLab[1];
+            lab[2 * count + i] = pixelLab[2];
+        }
+
+        // Feature pipeline: edge and point detection on the normalized achromatic channel.
+        float* achromatic = ycxcz.data();
+        for (size_t i = 0; i < srcCount; ++i)
+            achromatic[i] = (achromatic[i] + 16.f) / 116.f;
+
+        // The 2D detectors are separable into a derivative and a Gaussian, the horizontal Gaussian pass is shared.
+        std::vector<float> smoothed(srcCount), detected(srcCount), gradients(count * 2), padded;
+        band.filterRows(achromatic, mGaussian, smoothed.data(), padded);
+        const Kernel* detectors[2] = {&mEdge, &mPoint};
+        for (size_t f = 0; f < 2; ++f)
+        {
+            std::fill(gradients.begin(), gradients.end(), 0.f);
+            band.filterRows(achromatic, *detectors[f], detected.data(), padded);
+            band.filterColumns(detected.data(), mGaussian, 1.f, gradients.data());
+            band.filterColumns(smoothed.data(), *detectors[f], 1.f, gradients.data() + count);
+            for (size_t i = 0; i < count; ++i)
+                features[f * count + i] = std::sqrt(sqr(gradients[i]) + sqr(gradients[count + i]));
+        }
     }
+
+    Csf mCsf[3];
+    Kernel mGaussian;
+    Kernel mEdge;
+    Kernel mPoint;
+    uint32_t mRadius = 0;
+    float mMaxColorError = 1.f;
 };
 
-template<typename Metric>
-double compare(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)
+static double compareFLIP(const Image& imageA, const Image& imageB, const CompareOptions& options, float* errorMap)
 {
-    Metric metric;
-    double sum = 0.0;
-    const float* a = imageA.getData();
-    const float* b = imageB.getData();
-    size_t count = imageA.getWidth() * imageA.getHeight();
-    for (size_t i = 0; i < count; ++i)
-    {
-        double error = metric(a, b, alpha ? 4 : 3);
-        if (errorMap)
-            *errorMap++ = float(error);
-        sum += error;
-        a += 4;
-        b += 4;
-    }
-    return sum / count;
+    return FLIP(options.pixelsPerDegree).compare(imageA, imageB, options, errorMap);
 }
 
 struct ErrorMetric
 {
     std::string name;
     std::string desc;
-    std::function<double(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)> compare;
+    std::function<double(const Image& imageA, const Image& imageB, const CompareOptions& options, float* errorMap)> compare;
 };
 
 static const std::vector<ErrorMetric> errorMetrics = {
@@ -258,6 +874,8 @@ static const std::vector<ErrorMetric> errorMetrics = {
     {"rmse", "Relative Mean Squared Error", compare<RMSE>},
     {"mae", "Mean Absolute Error", compare<MAE>},
     {"mape", "Mean Absolute Percentage Error", compare<MAPE>},
+    {"ssim", "Structural Dissimilarity of luminance (1 - SSIM)", compareSSIM},
+    {"flip", "FLIP perceptual difference (LDR)", compareFLIP},
 };
 
 static std::shared_ptr<Image> generateHeatMap(uint32_t width, uint32_t height, const float* errorMap)
@@ -278,30 +896,53 @@ static std::shared_ptr<Image> generateHeatMap(uint32_t width, uint32_t height, c
         *dst++ = 1.f;
     };
 
-    const auto [minValue, maxValue] = std::minmax_element(errorMap, errorMap + width * height);
+    const size_t count = size_t(width) * height;
+    const auto [minValue, maxValue] = std::minmax_element(errorMap, errorMap + count);
     const float range = std::max(1e-5f, *maxValue - *minValue);
     auto image = Image::create(width, height);
-    float* dst = image->getData();
-    for (size_t i = 0; i < width * height; ++i)
+    for (uint32_t y = 0; y < height; ++y)
     {
-        float t = clamp((errorMap[i] - *minValue) / range, 0.f, 1.f);
-        writeColor(t, dst);
-        dst += 4;
+        float* dst = image->getRow(y);
+        const float* src = errorMap + size_t(y) * width;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            float t = clamp((src[x] - *minValue) / range, 0.f, 1.f);
+            writeColor(t, dst);
+            dst += 4;
+        }
     }
 
     return image;
 }
 
-static bool compareImages(
+struct CompareResult
+{
+    bool success = false;
+    double error = std::numeric_limits<double>::quiet_NaN(); ///< NaN if the images could not be compared.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::string message;
+};
+
+static CompareResult compareImages(
     const std::filesystem::path& pathA,
     const std::filesystem::path& pathB,
-    ErrorMetric metric,
+    const ErrorMetric& metric,
     float threshold,
-    bool alpha,
+    const CompareOptions& options,
     const std::filesystem::path& heatMapPath
 )
 {
-    auto loadImage = [](const std::filesystem::path& path)
+    CompareResult result;
+
+    auto fail = [&result](const std::string& message)
+    {
+        std::cerr << message << std::endl;
+        result.message = message;
+        return result;
+    };
+
+    auto loadImage = [](const std::filesystem::path& path, std::string& message)
     {
         try
         {
@@ -309,7 +950,7 @@ static bool compareImages(
         }
         catch (const std::runtime_error& e)
         {
-            std::cerr << "Cannot load image from '" << path.string() << "' (Error: " << e.what() << ")." << std::endl;
+            message = "Cannot load image from '" + path.string() + "' (Error: " + e.what() + ").";
             return std::shared_ptr<Image>{};
         }
     };
@@ -326,27 +967,39 @@ static bool compareImages(
         }
     };
 
-    // Load images.
-    auto imageA = loadImage(pathA);
+    // Load images (concurrently if multiple threads are available).
+    std::string messageA, messageB;
+    std::shared_ptr<Image> imageA, imageB;
+    if (options.threadCount > 1)
+    {
+        auto futureA = std::async(std::launch::async, [&]() { return loadImage(pathA, messageA); });
+        imageB = loadImage(pathB, messageB);
+        imageA = futureA.get();
+    }
+    else
+    {
+        imageA = loadImage(pathA, messageA);
+        if (imageA)
+            imageB = loadImage(pathB, messageB);
+    }
     if (!imageA)
-        return false;
-    auto imageB = loadImage(pathB);
+        return fail(messageA);
     if (!imageB)
-        return false;
+        return fail(messageB);
 
     // Check resolution.
     if (imageA->getWidth() != imageB->getWidth() || imageA->getHeight() != imageB->getHeight())
-    {
-        std::cerr << "Cannot compare images with different resolutions." << std::endl;
-        return false;
-    }
+        return fail("Cannot compare images with different resolutions.");
 
     uint32_t width = imageA->getWidth();
     uint32_t height = imageB->getHeight();
+    result.width = width;
+    result.height = height;
 
     // Compare images.
-    std::unique_ptr<float[]> errorMap = heatMapPath.empty() ? nullptr : std::make_unique<float[]>(width * height);
-    double error = metric.compare(*imageA, *imageB, alpha, errorMap.get());
+    std::unique_ptr<float[]> errorMap = heatMapPath.empty() ? nullptr : std::make_unique<float[]>(size_t(width) * height);
+    double error = metric.compare(*imageA, *imageB, options, errorMap.get());
+    result.error = error;
 
     // Generate heat map.
     if (errorMap)
@@ -355,13 +1008,150 @@ static bool compareImages(
         saveImage(*heatMap, heatMapPath);
     }
 
-    std::cout << error << std::endl;
-
     // Treat nans and infs as errors.
-    if (std::isnan(error) || std::isinf(error))
+    result.success = !std::isnan(error) && !std::isinf(error) && error <= threshold;
+    return result;
+}
+
+static const std::set<std::string> kImageExtensions = {".png", ".jpg", ".tga", ".bmp", ".pfm", ".exr", ".hdr"};
+static const std::string kHeatMapSuffix = ".error.png";
+
+/**
+ * Collects images in a directory (recursively). Returns paths relative to the directory.
+ * Heat maps written by previous runs are skipped.
+ */
+static std::set<std::filesystem::path> collectImages(const std::filesystem::path& dir)
+{
+    std::set<std::filesystem::path> images;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir))
+    {
+        if (!entry.is_regular_file())
+            continue;
+        const auto& path = entry.path();
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return char(std::tolower(c)); });
+        const std::string filename = path.filename().string();
+        if (kImageExtensions.count(ext) == 0)
+            continue;
+        if (filename.size() >= kHeatMapSuffix.size() &&
+            filename.compare(filename.size() - kHeatMapSuffix.size(), kHeatMapSuffix.size(), kHeatMapSuffix) == 0)
+            continue;
+        images.insert(path.lexically_relative(dir));
+    }
+    return images;
+}
+
+struct ReportEntry
+{
+    std::string name;
+    CompareResult result;
+};
+
+static bool writeReport(
+    const std::filesystem::path& path,
+    const ErrorMetric& metric,
+    float threshold,
+    const CompareOptions& options,
+    const std::vector<ReportEntry>& entries
+)
+{
+    nlohmann::json images = nlohmann::json::array();
+    bool success = true;
+    for (const auto& entry : entries)
+    {
+        nlohmann::json image = {
+            {"name", entry.name},
+            {"success", entry.result.success},
+            {"error", entry.result.error},
+            {"tolerance", threshold},
+            {"width", entry.result.width},
+            {"height", entry.result.height},
+        };
+        if (!entry.result.message.empty())
+            image["message"] = entry.result.message;
+        images.push_back(image);
+        success &= entry.result.success;
+    }
+
+    nlohmann::json report = {
+        {"metric", metric.name},
+        {"threshold", threshold},
+        {"alpha", options.alpha},
+        {"success", success},
+        {"images", images},
+    };
+
+    std::ofstream stream(path);
+    if (!stream)
+    {
+        std::cerr << "Cannot write report to '" << path.string() << "'." << std::endl;
         return false;
+    }
+    stream << report.dump(4) << std::endl;
+    return true;
+}
+
+/**
+ * Compares all images with the same relative path in two directories.
+ * Images that only exist in one of the directories are reported as failures.
+ */
+static std::vector<ReportEntry> compareDirectories(
+    const std::filesystem::path& dirA,
+    const std::filesystem::path& dirB,
+    const ErrorMetric& metric,
+    float threshold,
+    const CompareOptions& options,
+    const std::filesystem::path& heatMapDir,
+    uint32_t jobCount
+)
+{
+    auto imagesA = collectImages(dirA);
+    auto imagesB = collectImages(dirB);
+
+    std::vector<ReportEntry> entries;
+    std::vector<size_t> pairs;
+    for (const auto& image : imagesA)
+    {
+        ReportEntry entry;
+        entry.name = image.generic_string();
+        if (imagesB.count(image) == 0)
+            entry.result.message = "Image '" + entry.name + "' does not exist in '" + dirB.string() + "'.";
+        else
+            pairs.push_back(entries.size());
+        entries.push_back(entry);
+    }
+    for (const auto& image : imagesB)
+    {
+        if (imagesA.count(image) == 0)
+        {
+            ReportEntry entry;
+            entry.name = image.generic_string();
+            entry.result.message = "Image '" + entry.name + "' does not exist in '" + dirA.string() + "'.";
+            entries.push_back(entry);
+        }
+    }
+
+    // Image pairs are compared concurrently, the remaining threads are used within each comparison.
+    CompareOptions pairOptions = options;
+    pairOptions.threadCount = std::max(1u, jobCount / std::max(1u, uint32_t(pairs.size())));
+
+    parallelFor(
+        uint32_t(pairs.size()), jobCount,
+        [&](uint32_t i)
+        {
+            auto& entry = entries[pairs[i]];
+            std::filesystem::path heatMapPath;
+            if (!heatMapDir.empty())
+            {
+                heatMapPath = heatMapDir / (entry.name + kHeatMapSuffix);
+                std::error_code ec;
+                std::filesystem::create_directories(heatMapPath.parent_path(), ec);
+            }
+            entry.result = compareImages(dirA / entry.name, dirB / entry.name, metric, threshold, pairOptions, heatMapPath);
+        }
+    );
 
-    return error <= threshold;
+    return entries;
 }
 
 static void printMetrics(std::ostream& stream = std::cout)
@@ -375,16 +1165,24 @@ static void printMetrics(std::ostream& stream = std::cout)
 
 int main(int argc, char** argv)
 {
-    args::ArgumentParser parser("Utility to compare images.");
+    args::ArgumentParser parser(
+        "Utility to compare images.",
+        "If both arguments are directories, all images with the same relative path are compared (batch mode)."
+    );
     parser.helpParams.programName = "ImageCompare";
     args::HelpFlag helpFlag(parser, "help", "Display this help menu.", {'h', "help"});
     args::Flag listMetricsFlag(parser, "", "List available error metrics.", {'l'});
     args::ValueFlag<std::string> metricFlag(parser, "metric", "The error metric.", {'m'});
     args::ValueFlag<float> thresholdFlag(parser, "threshold", "The error threshold.", {'t'});
     args::Flag alphaFlag(parser, "", "Include alpha channel.", {'a'});
-    args::ValueFlag<std::string> heatMapFlag(parser, "filename", "Generate error heat map.", {'e'});
-    args::Positional<std::string> image1(parser, "image1", "The first image.", args::Options::Required);
-    args::Positional<std::string> image2(parser, "image2", "The second image.", args::Options::Required);
+    args::ValueFlag<std::string> heatMapFlag(
+        parser, "filename", "Generate error heat map (in batch mode, the directory to write '<image>.error.png' heat maps to).", {'e'}
+    );
+    args::ValueFlag<std::string> reportFlag(parser, "filename", "Write a JSON report.", {'r', "report"});
+    args::ValueFlag<uint32_t> jobsFlag(parser, "count", "Number of threads (default: number of hardware threads).", {'j', "jobs"});
+    args::ValueFlag<float> ppdFlag(parser, "ppd", "Pixels per degree of visual angle for the FLIP metric (default: 67).", {"ppd"});
+    args::Positional<std::string> image1(parser, "image1", "The first image (or directory).", args::Options::Required);
+    args::Positional<std::string> image2(parser, "image2", "The second image (or directory).", args::Options::Required);
     args::CompletionFlag completionFlag(parser, {"complete"});
 
     try
@@ -435,9 +1233,46 @@ int main(int argc, char** argv)
         metric = *it;
     }
 
-    bool success = compareImages(
-        args::get(image1), args::get(image2), metric, thresholdFlag ? args::get(thresholdFlag) : 0.f,
-        alphaFlag ? args::get(alphaFlag) : false, heatMapFlag ? args::get(heatMapFlag) : ""
-    );
+    float threshold = thresholdFlag ? args::get(thresholdFlag) : 0.f;
+    uint32_t jobCount = jobsFlag ? std::max(1u, args::get(jobsFlag)) : std::max(1u, std::thread::hardware_concurrency());
+
+    CompareOptions options;
+    options.alpha = alphaFlag ? args::get(alphaFlag) : false;
+    options.pixelsPerDegree = ppdFlag ? args::get(ppdFlag) : 67.f;
+    options.threadCount = jobCount;
+    if (!(options.pixelsPerDegree > 0.f))
+    {
+        std::cerr << "Pixels per degree must be positive." << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path pathA = args::get(image1);
+    std::filesystem::path pathB = args::get(image2);
+    std::filesystem::path heatMapPath = heatMapFlag ? args::get(heatMapFlag) : "";
+
+    std::vector<ReportEntry> entries;
+    if (std::filesystem::is_directory(pathA) && std::filesystem::is_directory(pathB))
+    {
+        entries = compareDirectories(pathA, pathB, metric, threshold, options, heatMapPath, jobCount);
+        for (const auto& entry : entries)
+        {
+            std::cout << entry.name << " " << entry.result.error;
+            if (!entry.result.success)
+                std::cout << " FAILED";
+            std::cout << std::endl;
+        }
+    }
+    else
+    {
+        auto result = compareImages(pathA, pathB, metric, threshold, options, heatMapPath);
+        if (result.message.empty())
+            std::cout << result.error << std::endl;
+        entries.push_back({pathB.filename().string(), result});
+    }
+
+    bool success = std::all_of(entries.begin(), entries.end(), [](const ReportEntry& entry) { return entry.result.success; });
+    if (reportFlag && !writeReport(args::get(reportFlag), metric, threshold, options, entries))
+        success = false;
+
     return success ? 0 : 1;
 }
@@ -34,12 +34,13 @@
 #include "LoopSubdivide.h"
 #include "Core/Assert.h"
 #include "Core/Errors.h"
+#include "Utils/ScratchArena.h"
+#include "Utils/Math/FNVHash.h"
 
 #include <algorithm>
-#include <map>
-#include <memory>
 #include <memory_resource>
-#include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <cmath>
 
@@ -62,6 +63,7 @@ struct SDVertex
     float3 p;
     SDFace* startFace = nullptr;
     SDVertex* child = nullptr;
+    uint32_t index = 0; ///< Index into the final vertex list.
     bool regular = false;
     bool boundary = false;
 };
@@ -127,11 +129,18 @@ struct SDEdge
         return v[0] < e2.v[0];
     }
 
+    bool operator==(const SDEdge& e2) const { return v[0] == e2.v[0] && v[1] == e2.v[1]; }
+
     SDVertex* v[2];
     SDFace* f[2];
     int f0edgeNum;
 };
 
+struct SDEdgeHash
+{
+    size_t operator()(const SDEdge& e) const { return (size_t)fnvHashArray64(e.v, sizeof(e.v)); }
+};
+
 static float3 weightOneRing(SDVertex* vert, float beta);
 static float3 weightBoundary(SDVertex* vert, float beta);
 
@@ -174,20 +183,28 @@ inline float loopGamma(uint32_t valence)
 
 LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> positions, fstd::span<const uint32_t> indices)
 {
-    std::vector<SDVertex*> vertices;
-    std::vector<SDFace*> faces;
+    // All temporary mesh data is allocated from the scratch arena of the calling thread.
+    // This allows running several subdivisions in parallel and avoids system allocations when it is reused.
+    ScratchArena& arena = ScratchArena::getThreadLocal();
+    ScratchArena::Scope scope(arena);
+
+    std::pmr::vector<SDVertex*> vertices(&arena);
+    std::pmr::vector<SDFace*> faces(&arena);
 
     // Allocate vertices and faces.
-    std::unique_ptr<SDVertex[]> vertexBuffer = std::make_unique<SDVertex[]>(positions.size());
+    SDVertex* vertexBuffer = arena.allocateArray<SDVertex>(positions.size());
+    vertices.reserve(positions.size());
     for (size_t i = 0; i < positions.size(); ++i)
     {
-        vertexBuffer[i] = SDVertex(positions[i]);
+        new (&vertexBuffer[i]) SDVertex(positions[i]);
         vertices.push_back(&vertexBuffer[i]);
     }
     size_t faceCount = indices.size() / 3;
-    std::unique_ptr<SDFace[]> fs = std::make_unique<SDFace[]>(faceCount);
+    SDFace* fs = arena.allocateArray<SDFace>(faceCount);
+    faces.reserve(faceCount);
     for (size_t i = 0; i < faceCount; ++i)
     {
+        new (&fs[i]) SDFace();
         faces.push_back(&fs[i]);
     }
 
@@ -207,29 +224,33 @@ LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> posi
     }
 
     // Set neighbor pointers in faces.
-    std::set<SDEdge> edges;
-    for (size_t i = 0; i < faceCount; ++i)
     {
-        SDFace* f = faces[i];
-        for (uint32_t edgeNum = 0; edgeNum < 3; ++edgeNum)
+        std::pmr::unordered_set<SDEdge, SDEdgeHash> edges(&arena);
+        edges.reserve(faceCount * 3 / 2);
+        for (size_t i = 0; i < faceCount; ++i)
         {
-            // Update neighbor pointer for edgeNum.
-            int v0 = edgeNum, v1 = NEXT(edgeNum);
-            SDEdge e(f->v[v0], f->v[v1]);
-            if (edges.find(e) == edges.end())
-            {
-                // Handle new edge.
-                e.f[0] = f;
-                e.f0edgeNum = edgeNum;
-                edges.insert(e);
-            }
-            else
+            SDFace* f = faces[i];
+            for (uint32_t edgeNum = 0; edgeNum < 3; ++edgeNum)
             {
-                // Handle previously seen edge.
-                e = *edges.find(e);
-                e.f[0]->f[e.f0edgeNum] = f;
-                f->f[edgeNum] = e.f[0];
-                edges.erase(e);
+                // Update neighbor pointer for edgeNum.
+                int v0 = edgeNum, v1 = NEXT(edgeNum);
+                SDEdge e(f->v[v0], f->v[v1]);
+                auto it = edges.find(e);
+                if (it == edges.end())
+                {
+                    // Handle new edge.
+                    e.f[0] = f;
+                    e.f0edgeNum = edgeNum;
+                    edges.insert(e);
+                }
+                else
+                {
+                    // Handle previously seen edge.
+                    e = *it;
+                    e.f[0]->f[e.f0edgeNum] = f;
+                    f->f[edgeNum] = e.f[0];
+                    edges.erase(it);
+                }
             }
         }
     }
@@ -253,33 +274,35 @@ LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> posi
     }
 
     // Refine LoopSubdiv into triangles.
-    std::vector<SDFace*> f = faces;
-    std::vector<SDVertex*> v = vertices;
-
-    std::pmr::monotonic_buffer_resource buffer;
-    std::pmr::polymorphic_allocator<SDVertex> vertexAllocator(&buffer);
-    std::pmr::polymorphic_allocator<SDFace> faceAllocator(&buffer);
+    std::pmr::vector<SDFace*> f(faces, &arena);
+    std::pmr::vector<SDVertex*> v(vertices, &arena);
 
     for (size_t i = 0; i < levels; ++i)
     {
         // Update f and v for next level of subdivision.
-        std::vector<SDFace*> newFaces;
-        std::vector<SDVertex*> newVertices;
+        // Every face adds four children, the number of edges is at most 3/2 times the number of faces for manifold meshes.
+        std::pmr::vector<SDFace*> newFaces(&arena);
+        std::pmr::vector<SDVertex*> newVertices(&arena);
+        newFaces.reserve(4 * f.size());
+        newVertices.reserve(v.size() + f.size() * 3 / 2 + 1);
 
         // Allocate next level of children in mesh tree.
-        for (SDVertex* vertex : v)
+        SDVertex* children = arena.allocateArray<SDVertex>(v.size());
+        for (size_t j = 0; j < v.size(); ++j)
         {
-            vertex->child = vertexAllocator.allocate(1);
+            SDVertex* vertex = v[j];
+            vertex->child = &children[j];
             vertex->child->regular = vertex->regular;
             vertex->child->boundary = vertex->boundary;
             newVertices.push_back(vertex->child);
         }
-        for (SDFace* face : f)
+        SDFace* faceChildren = arena.allocateArray<SDFace>(4 * f.size());
+        for (size_t j = 0; j < f.size(); ++j)
         {
             for (uint32_t k = 0; k < 4; ++k)
             {
-                face->children[k] = faceAllocator.allocate(1);
-                newFaces.push_back(face->children[k]);
+                f[j]->children[k] = &faceChildren[4 * j + k];
+                newFaces.push_back(f[j]->children[k]);
             }
         }
 
@@ -304,37 +327,43 @@ LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> posi
         }
 
         // Compute new odd edge vertices.
-        std::map<SDEdge, SDVertex*> edgeVerts;
-        for (SDFace* face : f)
+        // The odd vertex of every face edge is recorded in faceEdgeVerts, so the edge map is only needed for deduplication.
+        SDVertex** faceEdgeVerts = arena.allocateArray<SDVertex*>(3 * f.size());
         {
-            for (uint32_t k = 0; k < 3; ++k)
+            std::pmr::unordered_map<SDEdge, SDVertex*, SDEdgeHash> edgeVerts(&arena);
+            edgeVerts.reserve(f.size() * 3 / 2 + 1);
+            for (size_t j = 0; j < f.size(); ++j)
             {
-                // Compute odd vertex on kth edge.
-                SDEdge edge(face->v[k], face->v[NEXT(k)]);
-                SDVertex* vert = edgeVerts[edge];
-                if (vert == nullptr)
+                SDFace* face = f[j];
+                for (uint32_t k = 0; k < 3; ++k)
                 {
-                    // Create and initialize new odd vertex
-                    vert = vertexAllocator.allocate(1);
-                    newVertices.push_back(vert);
-                    vert->regular = true;
-                    vert->boundary = (face->f[k] == nullptr);
-                    vert->startFace = face->children[3];
-
-                    // Apply edge rules to compute new vertex position
-                    if (vert->boundary)
+                    // Compute odd vertex on kth edge.
+                    SDEdge edge(face->v[k], face->v[NEXT(k)]);
+                    SDVertex*& vert = edgeVerts[edge];
+                    if (vert == nullptr)
                     {
-                        vert->p = 0.5f * edge.v[0]->p;
-                        vert->p += 0.5f * edge.v[1]->p;
+                        // Create and initialize new odd vertex
+                        vert = arena.allocateArray<SDVertex>(1);
+                        newVertices.push_back(vert);
+                        vert->regular = true;
+                        vert->boundary = (face->f[k] == nullptr);
+                        vert->startFace = face->children[3];
+
+                        // Apply edge rules to compute new vertex position
+                        if (vert->boundary)
+                        {
+                            vert->p = 0.5f * edge.v[0]->p;
+                            vert->p += 0.5f * edge.v[1]->p;
+                        }
+                        else
+                        {
+                            vert->p = 3.f / 8.f * edge.v[0]->p;
+                            vert->p += 3.f / 8.f * edge.v[1]->p;
+                            vert->p += 1.f / 8.f * face->otherVert(edge.v[0], edge.v[1])->p;
+                            vert->p += 1.f / 8.f * face->f[k]->otherVert(edge.v[0], edge.v[1])->p;
+                        }
                     }
-                    else
-                    {
-                        vert->p = 3.f / 8.f * edge.v[0]->p;
-                        vert->p += 3.f / 8.f * edge.v[1]->p;
-                        vert->p += 1.f / 8.f * face->otherVert(edge.v[0], edge.v[1])->p;
-                        vert->p += 1.f / 8.f * face->f[k]->otherVert(edge.v[0], edge.v[1])->p;
-                    }
-                    edgeVerts[edge] = vert;
+                    faceEdgeVerts[3 * j + k] = vert;
                 }
             }
         }
@@ -366,15 +395,16 @@ LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> posi
         }
 
         // Update face vertex pointers.
-        for (SDFace* face : f)
+        for (size_t k = 0; k < f.size(); ++k)
         {
+            SDFace* face = f[k];
             for (uint32_t j = 0; j < 3; ++j)
             {
                 // Update child vertex pointer to new even vertex
                 face->children[j]->v[j] = face->v[j]->child;
 
                 // Update child vertex pointer to new odd vertex
-                SDVertex* vert = edgeVerts[SDEdge(face->v[j], face->v[NEXT(j)])];
+                SDVertex* vert = faceEdgeVerts[3 * k + j];
                 face->children[j]->v[NEXT(j)] = vert;
                 face->children[NEXT(j)]->v[j] = vert;
                 face->children[3]->v[j] = vert;
@@ -382,8 +412,8 @@ LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> posi
         }
 
         // Prepare for next level of subdivision
-        f = newFaces;
-        v = newVertices;
+        f = std::move(newFaces);
+        v = std::move(newVertices);
     }
 
     // Push vertices to limit surface.
@@ -458,16 +488,15 @@ LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> posi
         std::vector<uint32_t> verts(3 * ntris);
         uint32_t* vp = verts.data();
         uint32_t totVerts = (uint32_t)v.size();
-        std::map<SDVertex*, uint32_t> usedVerts;
         for (uint32_t i = 0; i < totVerts; ++i)
         {
-            usedVerts[v[i]] = i;
+            v[i]->index = i;
         }
         for (size_t i = 0; i < ntris; ++i)
         {
             for (uint32_t j = 0; j < 3; ++j)
             {
-                *vp = usedVerts[f[i]->v[j]];
+                *vp = f[i]->v[j]->index;
                 ++vp;
             }
         }
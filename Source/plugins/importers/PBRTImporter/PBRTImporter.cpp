@@ -69,6 +69,8 @@
 #include "Core/API/Device.h"
 #include "Utils/Settings.h"
 #include "Utils/Logger.h"
+#include "Utils/Threading.h"
+#include "Utils/Timing/CpuTimer.h"
 #include "Utils/Timing/TimeReport.h"
 #include "Utils/Math/FalcorMath.h"
 #include "Utils/Math/FNVHash.h"
@@ -87,6 +89,7 @@
 
 #include <pybind11/pybind11.h>
 
+#include <set>
 #include <unordered_map>
 
 namespace Falcor
@@ -221,6 +224,8 @@ struct BuilderContext
 
     std::unordered_map<CurveAggregate::Key, CurveAggregate, CurveAggregate::KeyHash> curveAggregates;
 
+    std::unordered_map<const ShapeSceneEntity*, LoopSubdivideResult> subdividedShapes; ///< Loop subdivision results computed ahead of createShape().
+
     std::map<std::string, InstanceDefinition> instanceDefinitions;
 
     size_t curveCount = 0;
@@ -1393,6 +1398,79 @@ void createAreaLight(BuilderContext& ctx, const SceneEntity& entity, const Falco
     }
 }
 
+LoopSubdivideResult subdivideShape(const ShapeSceneEntity& entity)
+{
+    // Parameters:
+    // Int levels, Int[] indices, Point3[] P
+    const auto& params = entity.params;
+
+    auto levels = params.getInt("levels", 3);
+    auto indices = params.getIntArray("indices");
+    auto P = params.getPoint3Array("P");
+
+    if (indices.empty())
+        throwError(entity.loc, "Missing vertex indices in 'indices'.");
+    if (P.empty())
+        throwError(entity.loc, "Missing vertex positions in 'P'.");
+
+    return loopSubdivide(levels, P, fstd::span<const uint32_t>(reinterpret_cast<const uint32_t*>(indices.data()), indices.size()));
+}
+
+/**
+ * Subdivide all 'loopsubdiv' shapes of the scene in parallel.
+ * The results are stored in the context and picked up by createShape().
+ */
+void subdivideShapes(BuilderContext& ctx)
+{
+    std::vector<const ShapeSceneEntity*> entities;
+    auto collectShapes = [&](const std::vector<ShapeSceneEntity>& shapes)
+    {
+        for (const auto& entity : shapes)
+        {
+            if (entity.name == "loopsubdiv")
+                entities.push_back(&entity);
+        }
+    };
+
+    // Only consider instance definitions that are actually instantiated, the others are never built.
+    collectShapes(ctx.scene.getShapes());
+    std::set<std::string> instancedNames;
+    for (const auto& entity : ctx.scene.getInstances())
+        instancedNames.insert(entity.name);
+    for (const auto& [name, entity] : ctx.scene.getInstanceDefinitions())
+    {
+        if (instancedNames.count(name) > 0)
+            collectShapes(entity.shapes);
+    }
+
+    if (entities.empty())
+        return;
+
+    // Each entity owns its parameters, so the shapes can be processed concurrently.
+    auto startTime = CpuTimer::getCurrentTimePoint();
+    std::vector<LoopSubdivideResult> results(entities.size());
+    Threading::parallelFor(0, entities.size(), [&](size_t i) { results[i] = subdivideShape(*entities[i]); }, 1);
+    double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    for (size_t i = 0; i < entities.size(); ++i)
+    {
+        vertexCount += results[i].positions.size();
+        triangleCount += results[i].indices.size() / 3;
+        ctx.subdividedShapes.emplace(entities[i], std::move(results[i]));
+    }
+
+    logInfo(
+        "PBRTImporter: Subdivided {} shapes into {} vertices and {} triangles in {:.1f} ms ({:.2f} M triangles/s).",
+        entities.size(),
+        vertexCount,
+        triangleCount,
+        duration,
+        duration > 0.0 ? triangleCount / (duration * 1e3) : 0.0
+    );
+}
+
 Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
 {
     auto warnUnsupported = [&]() { warnUnsupportedType(entity.loc, "Shape", entity.name); };
@@ -1583,17 +1661,17 @@ Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
         // String scheme (also not supported in pbrt-v4)
         warnUnsupportedParameters(params, {"scheme"});
 
-        auto levels = params.getInt("levels", 3);
-        auto indices = params.getIntArray("indices");
-        auto P = params.getPoint3Array("P");
-
-        if (indices.empty())
-            throwError(entity.loc, "Missing vertex indices in 'indices'.");
-        if (P.empty())
-            throwError(entity.loc, "Missing vertex positions in 'P'.");
-
-        auto result =
-            loopSubdivide(levels, P, fstd::span<const uint32_t>(reinterpret_cast<const uint32_t*>(indices.data()), indices.size()));
+        // Use the result of subdivideShapes() if available.
+        LoopSubdivideResult result;
+        if (auto it = ctx.subdividedShapes.find(&entity); it != ctx.subdividedShapes.end())
+        {
+            result = std::move(it->second);
+            ctx.subdividedShapes.erase(it);
+        }
+        else
+        {
+            result = subdivideShape(entity);
+        }
 
         Falcor::TriangleMesh::VertexList vertexList(result.positions.size());
         for (size_t i = 0; i < result.positions.size(); ++i)
@@ -1645,27 +1723,41 @@ Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
     return shape;
 }
 
+using CurveGeometry = std::variant<CurveTessellation::SweptSphereResult, CurveTessellation::MeshResult>;
+
 /**
- * Create curve geometry from a curve aggregate.
+ * Tessellate a curve aggregate.
  * This can either result in mesh or curve geometry depending on the tesselation mode.
  */
-std::variant<Falcor::MeshID, Falcor::CurveID> createCurveGeometry(BuilderContext& ctx, const CurveAggregate& curveAggregate)
+CurveGeometry tessellateCurveAggregate(CurveTessellationMode mode, const CurveAggregate& curveAggregate)
 {
-    CurveTessellationMode mode = CurveTessellationMode::LinearSweptSphere;
-
-    if (is_set(ctx.builder.getFlags(), SceneBuilder::Flags::TessellateCurvesIntoPolyTubes))
-    {
-        mode = CurveTessellationMode::PolyTube;
-    }
-
     uint32_t subdivPerSegment = 1u << curveAggregate.splitDepth;
 
     if (mode == CurveTessellationMode::LinearSweptSphere)
     {
-        auto result = CurveTessellation::convertToLinearSweptSphere(
+        return CurveTessellation::convertToLinearSweptSphere(
             curveAggregate.strands.size(), curveAggregate.strands.data(), curveAggregate.points.data(), curveAggregate.widths.data(),
             nullptr, 1, subdivPerSegment, 1, 1, 1.f, float4x4::identity()
         );
+    }
+    else
+    {
+        FALCOR_ASSERT(mode == CurveTessellationMode::PolyTube);
+        return CurveTessellation::convertToPolytube(
+            curveAggregate.strands.size(), curveAggregate.strands.data(), curveAggregate.points.data(), curveAggregate.widths.data(),
+            nullptr, subdivPerSegment, 1, 1, 1.f, 4
+        );
+    }
+}
+
+/**
+ * Add tessellated curve geometry to the scene builder.
+ */
+std::variant<Falcor::MeshID, Falcor::CurveID> addCurveGeometry(BuilderContext& ctx, const CurveAggregate& curveAggregate, const CurveGeometry& geometry)
+{
+    if (auto pResult = std::get_if<CurveTessellation::SweptSphereResult>(&geometry))
+    {
+        const auto& result = *pResult;
 
         Falcor::SceneBuilder::Curve curve;
         curve.degree = result.degree;
@@ -1680,18 +1772,7 @@ std::variant<Falcor::MeshID, Falcor::CurveID> createCurveGeometry(BuilderContext
     }
     else
     {
-        Falcor::CurveTessellation::MeshResult result;
-        if (mode == CurveTessellationMode::PolyTube)
-        {
-            result = CurveTessellation::convertToPolytube(
-                curveAggregate.strands.size(), curveAggregate.strands.data(), curveAggregate.points.data(), curveAggregate.widths.data(),
-                nullptr, subdivPerSegment, 1, 1, 1.f, 4
-            );
-        }
-        else
-        {
-            FALCOR_UNREACHABLE();
-        }
+        const auto& result = std::get<CurveTessellation::MeshResult>(geometry);
 
         Falcor::SceneBuilder::Mesh mesh;
         mesh.faceCount = result.faceVertexIndices.size() / 3;
@@ -1715,40 +1796,85 @@ std::variant<Falcor::MeshID, Falcor::CurveID> createCurveGeometry(BuilderContext
     }
 }
 
+/**
+ * Create curve geometry from all curve aggregates assembled so far and clear the aggregates.
+ * The aggregates are tessellated in parallel, the geometry is then added to the scene builder sequentially.
+ * @return List of created mesh or curve IDs together with the transform of the curve aggregate.
+ */
+std::vector<std::pair<std::variant<Falcor::MeshID, Falcor::CurveID>, float4x4>> createCurveGeometries(BuilderContext& ctx)
+{
+    CurveTessellationMode mode = CurveTessellationMode::LinearSweptSphere;
+
+    if (is_set(ctx.builder.getFlags(), SceneBuilder::Flags::TessellateCurvesIntoPolyTubes))
+    {
+        mode = CurveTessellationMode::PolyTube;
+    }
+
+    std::vector<const CurveAggregate*> curveAggregates;
+    curveAggregates.reserve(ctx.curveAggregates.size());
+    for (const auto& [_, curveAggregate] : ctx.curveAggregates)
+        curveAggregates.push_back(&curveAggregate);
+
+    std::vector<CurveGeometry> geometries(curveAggregates.size());
+    Threading::parallelFor(
+        0, curveAggregates.size(), [&](size_t i) { geometries[i] = tessellateCurveAggregate(mode, *curveAggregates[i]); }, 1
+    );
+
+    std::vector<std::pair<std::variant<Falcor::MeshID, Falcor::CurveID>, float4x4>> result;
+    result.reserve(curveAggregates.size());
+    for (size_t i = 0; i < curveAggregates.size(); ++i)
+    {
+        result.emplace_back(addCurveGeometry(ctx, *curveAggregates[i], geometries[i]), curveAggregates[i]->transform);
+        geometries[i] = {};
+    }
+    ctx.curveAggregates.clear();
+
+    return result;
+}
+
 InstanceDefinition createInstanceDefinition(BuilderContext& ctx, const InstanceDefinitionSceneEntity& entity)
 {
     InstanceDefinition instanceDefinition;
 
+    // Triangle meshes are collected and added as a batch at the end.
+    std::vector<Falcor::ref<Falcor::TriangleMesh>> triangleMeshes;
+    std::vector<Falcor::ref<Falcor::Material>> materials;
+    std::vector<size_t> meshSlots;
+
     for (const auto& shapeEntity : entity.shapes)
     {
         // Process shapes and create meshes.
         auto shape = createShape(ctx, shapeEntity);
         if (shape.pTriangleMesh)
         {
-            auto meshID = ctx.builder.addTriangleMesh(shape.pTriangleMesh, shape.pMaterial);
-            instanceDefinition.meshes.emplace_back(meshID, shape.transform);
+            meshSlots.push_back(instanceDefinition.meshes.size());
+            instanceDefinition.meshes.emplace_back(Falcor::MeshID::Invalid(), shape.transform);
+            triangleMeshes.push_back(shape.pTriangleMesh);
+            materials.push_back(shape.pMaterial);
         }
 
         // Create curves from curve aggregates assembled during the processing step above.
-        for (const auto& [_, curveAggregate] : ctx.curveAggregates)
+        for (const auto& [meshOrCurveID, transform] : createCurveGeometries(ctx))
         {
-            auto meshOrCurveID = createCurveGeometry(ctx, curveAggregate);
             if (auto meshID = std::get_if<Falcor::MeshID>(&meshOrCurveID))
             {
-                instanceDefinition.meshes.emplace_back(*meshID, curveAggregate.transform);
+                instanceDefinition.meshes.emplace_back(*meshID, transform);
             }
             else if (auto curveID = std::get_if<Falcor::CurveID>(&meshOrCurveID))
             {
-                instanceDefinition.curves.emplace_back(*curveID, curveAggregate.transform);
+                instanceDefinition.curves.emplace_back(*curveID, transform);
             }
             else
             {
                 FALCOR_UNREACHABLE();
             }
         }
-        ctx.curveAggregates.clear();
     }
 
+    auto meshIDs = ctx.builder.addTriangleMeshes(triangleMeshes, materials);
+    for (size_t i = 0; i < meshIDs.size(); ++i)
+        instanceDefinition.meshes[meshSlots[i]].first = meshIDs[i];
+
     return instanceDefinition;
 }
 
@@ -1804,22 +1930,29 @@ void buildScene(BuilderContext& ctx)
     }
 
     // Process shapes and create meshes.
+    // Shapes are created sequentially, the resulting triangle meshes are then processed in parallel as a batch.
+    std::vector<Falcor::ref<Falcor::TriangleMesh>> triangleMeshes;
+    std::vector<Falcor::ref<Falcor::Material>> materials;
+    std::vector<Falcor::NodeID> nodeIDs;
     for (const auto& entity : ctx.scene.getShapes())
     {
         auto shape = createShape(ctx, entity);
         if (shape.pTriangleMesh)
         {
-            auto nodeID = ctx.builder.addNode({entity.name, shape.transform});
-            auto meshID = ctx.builder.addTriangleMesh(shape.pTriangleMesh, shape.pMaterial);
-            ctx.builder.addMeshInstance(nodeID, meshID);
+            nodeIDs.push_back(ctx.builder.addNode({entity.name, shape.transform}));
+            triangleMeshes.push_back(shape.pTriangleMesh);
+            materials.push_back(shape.pMaterial);
         }
     }
 
+    auto meshIDs = ctx.builder.addTriangleMeshes(triangleMeshes, materials);
+    for (size_t i = 0; i < meshIDs.size(); ++i)
+        ctx.builder.addMeshInstance(nodeIDs[i], meshIDs[i]);
+
     // Create curves from curve aggregates assembled during the processing step above.
-    for (const auto& [_, curveAggregate] : ctx.curveAggregates)
+    for (const auto& [meshOrCurveID, transform] : createCurveGeometries(ctx))
     {
-        auto nodeID = ctx.builder.addNode({"curves", curveAggregate.transform});
-        auto meshOrCurveID = createCurveGeometry(ctx, curveAggregate);
+        auto nodeID = ctx.builder.addNode({"curves", transform});
         if (auto meshID = std::get_if<Falcor::MeshID>(&meshOrCurveID))
         {
             ctx.builder.addMeshInstance(nodeID, *meshID);
@@ -1833,7 +1966,6 @@ void buildScene(BuilderContext& ctx)
             FALCOR_UNREACHABLE();
         }
     }
-    ctx.curveAggregates.clear();
 
     auto getInstanceDefinition = [&ctx](const InstanceSceneEntity& entity)
     {
@@ -1887,6 +2019,8 @@ void PBRTImporter::importScene(const std::filesystem::path& path, SceneBuilder&
 
         pbrt::BuilderContext ctx{pbrtScene, builder};
         ctx.usePBRTMaterials = builder.getSettings().getOption("PBRTImporter:usePBRTMaterials", false);
+        pbrt::subdivideShapes(ctx);
+        timeReport.measure("Subdividing pbrt shapes");
         pbrt::buildScene(ctx);
         timeReport.measure("Building pbrt scene");
         timeReport.printToLog();
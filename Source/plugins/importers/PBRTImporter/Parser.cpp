@@ -36,10 +36,15 @@
 #include "Core/Assert.h"
 #include "Core/Platform/OS.h"
 #include "Utils/Logger.h"
+#include "Utils/Threading.h"
+#include "Utils/Timing/CpuTimer.h"
 
 #include <fast_float/fast_float.h>
 
+#include <array>
 #include <atomic>
+#include <exception>
+#include <mutex>
 #include <utility>
 #include <charconv>
 
@@ -95,6 +100,11 @@ std::unique_ptr<Tokenizer> Tokenizer::createFromFile(const std::filesystem::path
     }
     else
     {
+        auto pMappedFile = std::make_unique<MemoryMappedFile>(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan);
+        if (pMappedFile->isOpen())
+            return std::make_unique<Tokenizer>(std::move(pMappedFile), path);
+
+        // Fall back to reading the file (empty files cannot be mapped).
         std::string str = readFile(path);
         return std::make_unique<Tokenizer>(std::move(str), path);
     }
@@ -107,13 +117,34 @@ std::unique_ptr<Tokenizer> Tokenizer::createFromString(std::string str)
 
 Tokenizer::Tokenizer(std::string str, const std::filesystem::path& path) : mPath(path), mContents(std::move(str))
 {
-    auto pFilename = std::make_unique<std::string>(path.string());
-    mLoc = FileLoc(*pFilename);
-    getFilenames().push_back(std::move(pFilename));
+    init(mContents.data(), mContents.size());
+}
+
+Tokenizer::Tokenizer(std::unique_ptr<MemoryMappedFile> pMappedFile, const std::filesystem::path& path)
+    : mPath(path), mpMappedFile(std::move(pMappedFile))
+{
+    FALCOR_ASSERT(mpMappedFile && mpMappedFile->isOpen());
+    init(static_cast<const char*>(mpMappedFile->getData()), mpMappedFile->getMappedSize());
+}
+
+std::string_view Tokenizer::registerFilename(const std::filesystem::path& path)
+{
+    static std::mutex mutex;
+    static std::vector<std::unique_ptr<std::string>> filenames;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    filenames.push_back(std::make_unique<std::string>(path.string()));
+    return *filenames.back();
+}
+
+void Tokenizer::init(const char* pData, size_t size)
+{
+    mLoc = FileLoc(registerFilename(mPath));
 
-    mPos = mContents.data();
-    mEnd = mPos + mContents.size();
-    if (isUTF16(mContents.data(), mContents.size()))
+    mPos = pData;
+    mEnd = pData + size;
+    mSize = size;
+    if (isUTF16(pData, size))
         throwError("File is encoded with UTF-16, which is not currently supported.");
 }
 
@@ -279,8 +310,19 @@ static std::string_view dequoteString(const Token& t)
 constexpr uint32_t TokenOptional = 0;
 constexpr uint32_t TokenRequired = 1;
 
+/**
+ * Scratch buffers for numeric parameter values, reused for all parameter lists of a file.
+ * Values are collected here and copied into exactly sized arrays once a parameter is complete,
+ * which avoids repeatedly growing the arrays of large parameters (e.g. mesh data).
+ */
+struct ParameterScratch
+{
+    std::vector<Float> floats;
+    std::vector<int> ints;
+};
+
 template<typename Next, typename Unget>
-static ParsedParameterVector parseParameters(Next nextToken, Unget ungetToken)
+static ParsedParameterVector parseParameters(Next nextToken, Unget ungetToken, ParameterScratch& scratch)
 {
     ParsedParameterVector parameterVector;
 
@@ -342,6 +384,9 @@ static ParsedParameterVector parseParameters(Next nextToken, Unget ungetToken)
         if (param.type == "integer")
             valType = Int;
 
+        scratch.floats.clear();
+        scratch.ints.clear();
+
         auto addVal = [&](const Token& t)
         {
             if (isQuotedString(t.token))
@@ -419,9 +464,9 @@ static ParsedParameterVector parseParameters(Next nextToken, Unget ungetToken)
                 }
 
                 if (valType == Int)
-                    param.addInt(parseInt(t));
+                    scratch.ints.push_back(parseInt(t));
                 else
-                    param.addFloat(parseFloat(t));
+                    scratch.floats.push_back(parseFloat(t));
             }
         };
 
@@ -442,19 +487,308 @@ static ParsedParameterVector parseParameters(Next nextToken, Unget ungetToken)
             addVal(val);
         }
 
-        parameterVector.push_back(param);
+        param.floats.assign(scratch.floats.begin(), scratch.floats.end());
+        param.ints.assign(scratch.ints.begin(), scratch.ints.end());
+        parameterVector.push_back(std::move(param));
     }
 
     return parameterVector;
 }
 
-void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
+uint64_t parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer);
+
+/**
+ * Parser target that keeps the order of directives while imported files are parsed concurrently.
+ * Directives are forwarded to the target until the first 'Import' directive. Once an import is pending,
+ * directives are recorded and flush() replays them in file order after the imported files have been parsed.
+ * Without a target, all directives are recorded. This is used for parsing the imported files themselves.
+ */
+class DirectiveQueue : public ParserTarget
+{
+public:
+    DirectiveQueue(ParserTarget* pTarget) : mpTarget(pTarget) {}
+
+    ~DirectiveQueue()
+    {
+        // Imports still reference their queues if parsing was aborted by an error.
+        for (auto& import : mImports)
+        {
+            try
+            {
+                import.task.finish();
+            }
+            catch (...)
+            {}
+        }
+    }
+
+    /**
+     * Start parsing an imported file on the thread pool.
+     * As in pbrt-v4, changes to the graphics state made by the imported file are not visible after the import.
+     */
+    void import(const std::filesystem::path& path, FileLoc loc)
+    {
+        Import& import = mImports.emplace_back();
+        import.loc = loc;
+        import.pDirectives = std::make_unique<DirectiveQueue>(nullptr);
+        import.task = Threading::dispatchTask(
+            [pDirectives = import.pDirectives.get(), path]() { pDirectives->mByteCount = parse(*pDirectives, Tokenizer::createFromFile(path)); }
+        );
+    }
+
+    /**
+     * Wait for all pending imports and replay the recorded directives in order.
+     * @return Number of bytes parsed in imported files.
+     */
+    uint64_t flush()
+    {
+        // Wait for all imports before replaying, so that errors are reported after all tasks have finished.
+        std::exception_ptr exception;
+        for (auto& import : mImports)
+        {
+            try
+            {
+                import.task.finish();
+            }
+            catch (...)
+            {
+                if (!exception)
+                    exception = std::current_exception();
+            }
+        }
+        if (exception)
+        {
+            mImports.clear();
+            std::rethrow_exception(exception);
+        }
+
+        uint64_t byteCount = 0;
+        auto imports = std::move(mImports);
+        for (auto& import : imports)
+        {
+            byteCount += import.pDirectives->mByteCount;
+            emit([loc = import.loc](ParserTarget& t) { t.onAttributeBegin(loc); });
+            for (auto& directive : import.pDirectives->mDirectives)
+                emit(std::move(directive));
+            emit([loc = import.loc](ParserTarget& t) { t.onAttributeEnd(loc); });
+            for (auto& directive : import.following)
+                emit(std::move(directive));
+        }
+        return byteCount;
+    }
+
+    void onScale(Float sx, Float sy, Float sz, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onScale(sx, sy, sz, loc); });
+    }
+    void onShape(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onShape(name, std::move(params), loc); });
+    }
+    void onOption(const std::string& name, const std::string& value, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onOption(name, value, loc); });
+    }
+    void onIdentity(FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onIdentity(loc); });
+    }
+    void onTranslate(Float dx, Float dy, Float dz, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onTranslate(dx, dy, dz, loc); });
+    }
+    void onRotate(Float angle, Float ax, Float ay, Float az, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onRotate(angle, ax, ay, az, loc); });
+    }
+    void onLookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz, Float ux, Float uy, Float uz, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onLookAt(ex, ey, ez, lx, ly, lz, ux, uy, uz, loc); });
+    }
+    void onConcatTransform(Float transform[16], FileLoc loc) override
+    {
+        std::array<Float, 16> m;
+        std::copy(transform, transform + 16, m.begin());
+        add([=](ParserTarget& t) mutable { t.onConcatTransform(m.data(), loc); });
+    }
+    void onTransform(Float transform[16], FileLoc loc) override
+    {
+        std::array<Float, 16> m;
+        std::copy(transform, transform + 16, m.begin());
+        add([=](ParserTarget& t) mutable { t.onTransform(m.data(), loc); });
+    }
+    void onCoordinateSystem(const std::string& name, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onCoordinateSystem(name, loc); });
+    }
+    void onCoordSysTransform(const std::string& name, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onCoordSysTransform(name, loc); });
+    }
+    void onActiveTransformAll(FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onActiveTransformAll(loc); });
+    }
+    void onActiveTransformEndTime(FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onActiveTransformEndTime(loc); });
+    }
+    void onActiveTransformStartTime(FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onActiveTransformStartTime(loc); });
+    }
+    void onTransformTimes(Float start, Float end, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onTransformTimes(start, end, loc); });
+    }
+    void onColorSpace(const std::string& name, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onColorSpace(name, loc); });
+    }
+    void onPixelFilter(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onPixelFilter(name, std::move(params), loc); });
+    }
+    void onFilm(const std::string& type, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onFilm(type, std::move(params), loc); });
+    }
+    void onAccelerator(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onAccelerator(name, std::move(params), loc); });
+    }
+    void onIntegrator(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onIntegrator(name, std::move(params), loc); });
+    }
+    void onCamera(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onCamera(name, std::move(params), loc); });
+    }
+    void onMakeNamedMedium(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onMakeNamedMedium(name, std::move(params), loc); });
+    }
+    void onMediumInterface(const std::string& insideName, const std::string& outsideName, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onMediumInterface(insideName, outsideName, loc); });
+    }
+    void onSampler(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onSampler(name, std::move(params), loc); });
+    }
+    void onWorldBegin(FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onWorldBegin(loc); });
+    }
+    void onAttributeBegin(FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onAttributeBegin(loc); });
+    }
+    void onAttributeEnd(FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onAttributeEnd(loc); });
+    }
+    void onAttribute(const std::string& target, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onAttribute(target, std::move(params), loc); });
+    }
+    void onTexture(const std::string& name, const std::string& type, const std::string& texname, ParsedParameterVector params, FileLoc loc)
+        override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onTexture(name, type, texname, std::move(params), loc); });
+    }
+    void onMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onMaterial(name, std::move(params), loc); });
+    }
+    void onMakeNamedMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onMakeNamedMaterial(name, std::move(params), loc); });
+    }
+    void onNamedMaterial(const std::string& name, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onNamedMaterial(name, loc); });
+    }
+    void onLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onLightSource(name, std::move(params), loc); });
+    }
+    void onAreaLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        add([=, params = std::move(params)](ParserTarget& t) mutable { t.onAreaLightSource(name, std::move(params), loc); });
+    }
+    void onReverseOrientation(FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onReverseOrientation(loc); });
+    }
+    void onObjectBegin(const std::string& name, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onObjectBegin(name, loc); });
+    }
+    void onObjectEnd(FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onObjectEnd(loc); });
+    }
+    void onObjectInstance(const std::string& name, FileLoc loc) override
+    {
+        add([=](ParserTarget& t) { t.onObjectInstance(name, loc); });
+    }
+    void onEndOfFiles() override { FALCOR_UNREACHABLE(); }
+
+private:
+    using Directive = std::function<void(ParserTarget&)>;
+
+    struct Import
+    {
+        FileLoc loc;
+        Threading::Task task;
+        std::unique_ptr<DirectiveQueue> pDirectives; ///< Directives of the imported file.
+        std::vector<Directive> following;            ///< Directives following the import, up to the next import.
+    };
+
+    /// Forward a directive to the target, or record it if imports are pending.
+    template<typename Func>
+    void add(Func&& func)
+    {
+        if (!mImports.empty())
+            mImports.back().following.emplace_back(std::forward<Func>(func));
+        else
+            emit(std::forward<Func>(func));
+    }
+
+    /// Forward a directive to the target, or record it if there is no target.
+    template<typename Func>
+    void emit(Func&& func)
+    {
+        if (mpTarget)
+            func(*mpTarget);
+        else
+            mDirectives.emplace_back(std::forward<Func>(func));
+    }
+
+    ParserTarget* mpTarget;
+    std::vector<Directive> mDirectives; ///< Recorded directives if there is no target.
+    std::vector<Import> mImports;
+    uint64_t mByteCount = 0;            ///< Number of bytes parsed into the recorded directives.
+};
+
+/**
+ * Parse a file and all files it includes.
+ * @return Number of bytes parsed, including included and imported files.
+ */
+uint64_t parse(ParserTarget& finalTarget, std::unique_ptr<Tokenizer> tokenizer)
 {
     static std::atomic<bool> warnedTransformBeginEndDeprecated{false};
 
     logInfo("PBRTImporter: Started parsing '{}'.", tokenizer->getPath().string());
 
     auto searchPath = tokenizer->getPath().parent_path();
+    uint64_t byteCount = tokenizer->getSize();
+
+    DirectiveQueue queue(&finalTarget);
+    ParserTarget& target = queue;
+    ParameterScratch scratch;
 
     std::vector<std::unique_ptr<Tokenizer>> fileStack;
     fileStack.push_back(std::move(tokenizer));
@@ -514,7 +848,7 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
         Token t = *nextToken(TokenRequired);
         std::string_view dequoted = dequoteString(t);
         std::string n = toString(dequoted);
-        ParsedParameterVector parameterVector = parseParameters(nextToken, unget);
+        ParsedParameterVector parameterVector = parseParameters(nextToken, unget, scratch);
         (target.*apiFunc)(n, std::move(parameterVector), loc);
     };
 
@@ -635,11 +969,14 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
                 auto path = searchPath / filename;
                 std::unique_ptr<Tokenizer> includeTokenizer = Tokenizer::createFromFile(path);
                 logInfo("PBRTImporter: Started parsing '{}'.", includeTokenizer->getPath().string());
+                byteCount += includeTokenizer->getSize();
                 fileStack.push_back(std::move(includeTokenizer));
             }
             else if (tok->token == "Import")
             {
-                throwError(tok->loc, "'Import' directive not supported yet.");
+                Token filenameToken = *nextToken(TokenRequired);
+                std::string filename = toString(dequoteString(filenameToken));
+                queue.import(searchPath / filename, tok->loc);
             }
             else if (tok->token == "Identity")
             {
@@ -850,7 +1187,7 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
                 Token t = *nextToken(TokenRequired);
                 std::string_view dequoted = dequoteString(t);
                 std::string texName = toString(dequoted);
-                ParsedParameterVector params = parseParameters(nextToken, unget);
+                ParsedParameterVector params = parseParameters(nextToken, unget, scratch);
                 target.onTexture(name, type, texName, std::move(params), tok->loc);
             }
             else
@@ -874,12 +1211,21 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             syntaxError(*tok);
         }
     }
+
+    byteCount += queue.flush();
+    return byteCount;
 }
 
 void parseFile(ParserTarget& target, const std::filesystem::path& path)
 {
+    auto startTime = CpuTimer::getCurrentTimePoint();
     auto tokenizer = Tokenizer::createFromFile(path);
-    parse(target, std::move(tokenizer));
+    uint64_t byteCount = parse(target, std::move(tokenizer));
+    double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+    double megabytes = byteCount / (1024.0 * 1024.0);
+    logInfo(
+        "PBRTImporter: Parsed {:.1f} MB in {:.2f} s ({:.1f} MB/s).", megabytes, duration, duration > 0.0 ? megabytes / duration : 0.0
+    );
     target.onEndOfFiles();
 }
 
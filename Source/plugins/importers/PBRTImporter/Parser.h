@@ -35,6 +35,7 @@
 
 #include "Types.h"
 #include "Parameters.h"
+#include "Core/Platform/MemoryMappedFile.h"
 #include <functional>
 #include <filesystem>
 #include <memory>
@@ -101,6 +102,11 @@ public:
     virtual void onEndOfFiles() = 0;
 };
 
+/**
+ * Parse a scene file and call the target for each directive.
+ * Files referenced by 'Import' directives are parsed concurrently on the thread pool.
+ * The target is always called from the calling thread and in file order.
+ */
 void parseFile(ParserTarget& target, const std::filesystem::path& path);
 void parseString(ParserTarget& target, std::string str);
 
@@ -117,7 +123,12 @@ class Tokenizer
 {
 public:
     Tokenizer(std::string str, const std::filesystem::path& path);
+    Tokenizer(std::unique_ptr<MemoryMappedFile> pMappedFile, const std::filesystem::path& path);
 
+    /**
+     * Create a tokenizer for a file.
+     * Uncompressed files are memory-mapped, compressed (.gz) files are decompressed into memory.
+     */
     static std::unique_ptr<Tokenizer> createFromFile(const std::filesystem::path& path);
     static std::unique_ptr<Tokenizer> createFromString(std::string str);
 
@@ -129,16 +140,17 @@ public:
 
     const std::filesystem::path& getPath() const { return mPath; }
 
+    /// Get the size of the tokenized input in bytes.
+    size_t getSize() const { return mSize; }
+
 private:
     /**
-     * Static list of filenames to allow file locations (FileLoc::filename) to be valid
-     * even after the tokenizer is destroyed.
+     * Register a filename in a static list to allow file locations (FileLoc::filename) to be valid
+     * even after the tokenizer is destroyed. Files may be tokenized concurrently, so the list is guarded by a mutex.
      */
-    static std::vector<std::unique_ptr<std::string>>& getFilenames()
-    {
-        static std::vector<std::unique_ptr<std::string>> filenames;
-        return filenames;
-    }
+    static std::string_view registerFilename(const std::filesystem::path& path);
+
+    void init(const char* pData, size_t size);
 
     bool isUTF16(const void* ptr, size_t len) const;
 
@@ -172,7 +184,9 @@ private:
 
     std::filesystem::path mPath; ///< File path we're reading from.
     FileLoc mLoc;                ///< File location.
-    std::string mContents;       ///< File contents we're parsing.
+    std::string mContents;       ///< File contents we're parsing (if not memory-mapped).
+    std::unique_ptr<MemoryMappedFile> mpMappedFile; ///< Memory-mapped file we're parsing.
+    size_t mSize = 0;            ///< Size of the contents in bytes.
 
     const char* mPos; ///< Current position in the file.
     const char* mEnd; ///< End of the file (one past).
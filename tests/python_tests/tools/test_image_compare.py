@@ -0,0 +1,134 @@
+import os
+import json
+import shutil
+import tempfile
+import subprocess
+import unittest
+from pathlib import Path
+import numpy as np
+
+IMAGE_COMPARE_EXE = shutil.which('ImageCompare')
+METRICS = ['mse', 'rmse', 'mae', 'mape', 'ssim', 'flip']
+
+def write_pfm(path, image):
+    """Write an RGB float image (rows from top to bottom) to a PFM file."""
+    height, width, _ = image.shape
+    with open(path, 'wb') as f:
+        f.write(f"PF\n{width} {height}\n-1.0\n".encode())
+        f.write(np.ascontiguousarray(image[::-1], dtype='<f4').tobytes())
+
+def create_image(seed, width=64, height=48):
+    rng = np.random.default_rng(seed)
+    return rng.random((height, width, 3), dtype=np.float32)
+
+@unittest.skipIf(IMAGE_COMPARE_EXE is None, "ImageCompare executable not found")
+class TestImageCompare(unittest.TestCase):
+
+    def setUp(self):
+        self.dir = Path(tempfile.mkdtemp())
+
+    def tearDown(self):
+        shutil.rmtree(self.dir)
+
+    def run_compare(self, *args):
+        return subprocess.run([IMAGE_COMPARE_EXE] + [str(a) for a in args], capture_output=True, text=True)
+
+    def compare(self, a, b, *args):
+        """Compare two images and return the error from the JSON report."""
+        report_path = self.dir / 'report.json'
+        self.run_compare(a, b, '-r', report_path, *args)
+        with open(report_path) as f:
+            return json.load(f)['images'][0]['error']
+
+    def test_identical(self):
+        path = self.dir / 'a.pfm'
+        write_pfm(path, create_image(1))
+        for metric in METRICS:
+            with self.subTest(metric=metric):
+                p = self.run_compare(path, path, '-m', metric)
+                self.assertEqual(p.returncode, 0)
+                self.assertAlmostEqual(float(p.stdout), 0.0, places=6)
+
+    def test_mae(self):
+        # MAE takes the absolute, not the squared difference.
+        a, b = self.dir / 'a.pfm', self.dir / 'b.pfm'
+        write_pfm(a, np.zeros((16, 16, 3), dtype=np.float32))
+        write_pfm(b, np.full((16, 16, 3), 0.25, dtype=np.float32))
+        self.assertAlmostEqual(self.compare(a, b, '-m', 'mae'), 0.25, places=6)
+        self.assertAlmostEqual(self.compare(a, b, '-m', 'mse'), 0.0625, places=6)
+
+    def test_threshold(self):
+        a, b = self.dir / 'a.pfm', self.dir / 'b.pfm'
+        write_pfm(a, create_image(1))
+        write_pfm(b, create_image(2))
+        for metric in METRICS:
+            with self.subTest(metric=metric):
+                error = self.compare(a, b, '-m', metric)
+                self.assertGreater(error, 0.0)
+                self.assertEqual(self.run_compare(a, b, '-m', metric, '-t', error * 0.5).returncode, 1)
+                self.assertEqual(self.run_compare(a, b, '-m', metric, '-t', error * 2.0).returncode, 0)
+
+    def test_ssim_flip_range(self):
+        # Both metrics grow with the amount of noise and stay within [0, 1].
+        a = create_image(1) * 0.5 + 0.25
+        write_pfm(self.dir / 'a.pfm', a)
+        rng = np.random.default_rng(3)
+        noise = rng.standard_normal(a.shape).astype(np.float32)
+        write_pfm(self.dir / 'b.pfm', np.clip(a + 0.02 * noise, 0, 1))
+        write_pfm(self.dir / 'c.pfm', np.clip(a + 0.2 * noise, 0, 1))
+        for metric in ['ssim', 'flip']:
+            with self.subTest(metric=metric):
+                small = self.compare(self.dir / 'a.pfm', self.dir / 'b.pfm', '-m', metric)
+                large = self.compare(self.dir / 'a.pfm', self.dir / 'c.pfm', '-m', metric)
+                self.assertGreater(small, 0.0)
+                self.assertGreater(large, small)
+                self.assertLessEqual(large, 1.0)
+
+    def test_thread_count(self):
+        # Results do not depend on the number of threads.
+        a, b = self.dir / 'a.pfm', self.dir / 'b.pfm'
+        write_pfm(a, create_image(1, 301, 157))
+        write_pfm(b, create_image(2, 301, 157))
+        for metric in METRICS:
+            with self.subTest(metric=metric):
+                self.assertEqual(self.compare(a, b, '-m', metric, '-j', 1), self.compare(a, b, '-m', metric, '-j', 7))
+
+    def test_batch(self):
+        dir_a, dir_b, heat_maps = self.dir / 'a', self.dir / 'b', self.dir / 'heatmaps'
+        for d in [dir_a / 'sub', dir_b / 'sub']:
+            d.mkdir(parents=True)
+        write_pfm(dir_a / 'same.pfm', create_image(1))
+        write_pfm(dir_b / 'same.pfm', create_image(1))
+        write_pfm(dir_a / 'sub' / 'diff.pfm', create_image(1))
+        write_pfm(dir_b / 'sub' / 'diff.pfm', create_image(2))
+        write_pfm(dir_a / 'only_a.pfm', create_image(1))
+        write_pfm(dir_b / 'only_b.pfm', create_image(1))
+
+        report_path = self.dir / 'report.json'
+        p = self.run_compare(dir_a, dir_b, '-m', 'mse', '-t', 1e-3, '-e', heat_maps, '-r', report_path)
+        self.assertEqual(p.returncode, 1)
+
+        with open(report_path) as f:
+            report = json.load(f)
+        self.assertEqual(report['metric'], 'mse')
+        self.assertFalse(report['success'])
+        images = {image['name']: image for image in report['images']}
+        self.assertEqual(set(images.keys()), {'same.pfm', 'sub/diff.pfm', 'only_a.pfm', 'only_b.pfm'})
+        self.assertTrue(images['same.pfm']['success'])
+        self.assertEqual(images['same.pfm']['error'], 0.0)
+        self.assertFalse(images['sub/diff.pfm']['success'])
+        self.assertGreater(images['sub/diff.pfm']['error'], 1e-3)
+        for name in ['only_a.pfm', 'only_b.pfm']:
+            self.assertFalse(images[name]['success'])
+            self.assertIn('does not exist', images[name]['message'])
+
+        self.assertTrue((heat_maps / 'same.pfm.error.png').exists())
+        self.assertTrue((heat_maps / 'sub' / 'diff.pfm.error.png').exists())
+
+        # Without the failing images, the batch succeeds.
+        os.remove(dir_a / 'only_a.pfm')
+        os.remove(dir_b / 'only_b.pfm')
+        self.assertEqual(self.run_compare(dir_a, dir_b, '-m', 'mse', '-t', 1.0).returncode, 0)
+
+if __name__ == '__main__':
+    unittest.main()